@@ -0,0 +1,290 @@
+/*
+ * \file thinkey_ble_conn_check.c
+ *
+ * \brief BLE connection table check on the BLE simulator
+ *
+ * Drives the connection table from a random stream of simulated connects
+ * and disconnects on all the links the stack allows, more than the table
+ * holds, opening and closing contexts from the GAP events the way the
+ * firmware does and disconnecting the links it rejects. After every event
+ * the table is compared with a model: TKey_BleConn_Find() for every
+ * handle, TKey_BleConn_FindByRole(), the iteration and the count. Also
+ * checks reopening a handle after a missed disconnect, and lookups while
+ * a full table of scattered handles is closed in random order. Host
+ * builds only; built with THINKEY_BLE_CONN_CHECK_MAIN it is a standalone
+ * program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_ble_sim.h"
+#include "thinkey_ble_conn.h"
+#include "thinkey_debug.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_BLE_CONN_CHECK_EVENTS 4000
+#define TKEY_BLE_CONN_CHECK_NONE 0xFF
+#define TKEY_BLE_CONN_CHECK_ROUNDS 500
+
+static TKey_BYTE gaucModelRole[TKEY_BLE_SIM_MAX_LINKS];    /* or NONE */
+static TKey_BOOL gabLinkUp[TKEY_BLE_SIM_MAX_LINKS];
+static TKey_UINT32 guiModelCount;
+static TKey_UINT32 guiLastGeneration;
+static TKey_UINT32 guiRejected;
+static TKey_UINT16 gusRejectHandle;
+static TKey_BOOL gbEventsOk = TKey_TRUE;
+static TKey_UINT32 guiCheckRandom = 0x6C078965;
+
+static TKey_UINT32 tkey_ble_conn_check_random(TKey_UINT32 uiRange)
+{
+    guiCheckRandom ^= guiCheckRandom << 13;
+    guiCheckRandom ^= guiCheckRandom >> 17;
+    guiCheckRandom ^= guiCheckRandom << 5;
+    return guiCheckRandom % uiRange;
+}
+
+static TKey_VOID tkey_ble_conn_check_result(const TKey_CHAR *pcCheck,
+                                            TKey_BOOL bPassed,
+                                            TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+/* The GAP part of the firmware BLE event handler */
+static TKey_VOID tkey_ble_conn_check_evt(const TKey_BleSimEvt_t *psEvt)
+{
+    TKey_BleConnRole_t eRole;
+    TKey_BleConn_t *psConn = TKey_NULL;
+    TKey_BleConnStatus_t eStatus;
+
+    switch(psEvt->eType) {
+    case E_TKEY_BLE_SIM_EVT_CONNECTED:
+        eRole = (0 == tkey_ble_conn_check_random(4)) ? E_TKEY_BLE_CONN_ROLE_TAB :
+                E_TKEY_BLE_CONN_ROLE_PHONE;
+        gabLinkUp[psEvt->usConnHandle] = TKey_TRUE;
+        eStatus = TKey_BleConn_Open(psEvt->usConnHandle, eRole, &psConn);
+        if(E_TKEY_BLE_CONN_FULL == eStatus) {
+            /* Disconnected once the event is handled */
+            gbEventsOk = gbEventsOk && (TKEY_BLE_CONN_MAX == guiModelCount);
+            gusRejectHandle = psEvt->usConnHandle;
+            guiRejected++;
+            break;
+        }
+        gbEventsOk = gbEventsOk && (E_TKEY_BLE_CONN_SUCCESS == eStatus) &&
+                     (psConn->usConnHandle == psEvt->usConnHandle) &&
+                     (psConn->uiGeneration > guiLastGeneration) &&
+                     (0 == psConn->usL2capCid);
+        if(E_TKEY_BLE_CONN_SUCCESS == eStatus) {
+            guiLastGeneration = psConn->uiGeneration;
+            gaucModelRole[psEvt->usConnHandle] = (TKey_BYTE)eRole;
+            guiModelCount++;
+        }
+        break;
+    case E_TKEY_BLE_SIM_EVT_DISCONNECTED:
+        gabLinkUp[psEvt->usConnHandle] = TKey_FALSE;
+        eStatus = TKey_BleConn_Close(psEvt->usConnHandle);
+        if(TKEY_BLE_CONN_CHECK_NONE == gaucModelRole[psEvt->usConnHandle]) {
+            gbEventsOk = gbEventsOk && (E_TKEY_BLE_CONN_NOT_FOUND == eStatus);
+        } else {
+            gbEventsOk = gbEventsOk && (E_TKEY_BLE_CONN_SUCCESS == eStatus);
+            gaucModelRole[psEvt->usConnHandle] = TKEY_BLE_CONN_CHECK_NONE;
+            guiModelCount--;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* The table holds exactly the model */
+static TKey_BOOL tkey_ble_conn_check_matches(TKey_VOID)
+{
+    TKey_BleConn_t *psConn;
+    TKey_BOOL abSeen[TKEY_BLE_SIM_MAX_LINKS];
+    TKey_BOOL abRole[2] = { TKey_FALSE, TKey_FALSE };
+    TKey_UINT16 usHandle;
+    TKey_UINT16 usCid;
+    TKey_UINT32 uiIndex;
+
+    for(usHandle = 0; usHandle < TKEY_BLE_SIM_MAX_LINKS; usHandle++) {
+        psConn = TKey_BleConn_Find(usHandle);
+        if(TKEY_BLE_CONN_CHECK_NONE == gaucModelRole[usHandle]) {
+            if(TKey_NULL != psConn) {
+                return TKey_FALSE;
+            }
+            continue;
+        }
+        if(TKey_NULL == psConn || psConn->usConnHandle != usHandle ||
+           psConn->ucRole != gaucModelRole[usHandle] ||
+           E_TKEY_BLE_CONN_NOT_FOUND != TKey_BleConn_GetL2capCid(usHandle, &usCid)) {
+            return TKey_FALSE;
+        }
+        abRole[gaucModelRole[usHandle]] = TKey_TRUE;
+    }
+
+    /* Iteration visits each open context once */
+    memset(abSeen, 0, sizeof(abSeen));
+    for(uiIndex = 0; TKey_NULL != (psConn = TKey_BleConn_GetByIndex(uiIndex)); uiIndex++) {
+        if(psConn->usConnHandle >= TKEY_BLE_SIM_MAX_LINKS || abSeen[psConn->usConnHandle] ||
+           TKEY_BLE_CONN_CHECK_NONE == gaucModelRole[psConn->usConnHandle]) {
+            return TKey_FALSE;
+        }
+        abSeen[psConn->usConnHandle] = TKey_TRUE;
+    }
+    if(uiIndex != guiModelCount || TKey_BleConn_GetCount() != guiModelCount) {
+        return TKey_FALSE;
+    }
+
+    for(uiIndex = 0; uiIndex < 2; uiIndex++) {
+        psConn = TKey_BleConn_FindByRole((TKey_BleConnRole_t)uiIndex);
+        if(abRole[uiIndex] != (TKey_NULL != psConn) ||
+           (TKey_NULL != psConn && psConn->ucRole != uiIndex)) {
+            return TKey_FALSE;
+        }
+    }
+    return TKey_TRUE;
+}
+
+/* Random connects and disconnects on all the stack links */
+static TKey_BOOL tkey_ble_conn_check_stream(TKey_VOID)
+{
+    TKey_BleConnStats_t sStats;
+    TKey_UINT32 uiEvent;
+    TKey_UINT16 usHandle;
+
+    memset(gaucModelRole, TKEY_BLE_CONN_CHECK_NONE, sizeof(gaucModelRole));
+    TKey_BleSim_Init(tkey_ble_conn_check_evt);
+    TKey_BleConn_Init();
+    for(uiEvent = 0; uiEvent < TKEY_BLE_CONN_CHECK_EVENTS; uiEvent++) {
+        /* Lean towards connects so the table fills up */
+        if(tkey_ble_conn_check_random(8) < 5) {
+            gusRejectHandle = TKEY_BLE_CONN_HANDLE_INVALID;
+            if(E_TKEY_SUCCESS == TKey_BleSim_Connect(&usHandle) &&
+               TKEY_BLE_CONN_HANDLE_INVALID != gusRejectHandle) {
+                (void)TKey_BleSim_Disconnect(gusRejectHandle);
+            }
+        } else {
+            usHandle = (TKey_UINT16)tkey_ble_conn_check_random(TKEY_BLE_SIM_MAX_LINKS);
+            if(gabLinkUp[usHandle]) {
+                (void)TKey_BleSim_Disconnect(usHandle);
+            }
+        }
+        if(!gbEventsOk || !tkey_ble_conn_check_matches()) {
+            printf("table differs after event %lu\r\n", (unsigned long)uiEvent);
+            return TKey_FALSE;
+        }
+    }
+
+    TKey_BleConn_GetStats(&sStats);
+    printf("%lu opened, %lu closed, %lu rejected, %lu at most\r\n",
+           (unsigned long)sStats.uiOpened, (unsigned long)sStats.uiClosed,
+           (unsigned long)sStats.uiRejected, (unsigned long)sStats.uiMaxActive);
+    return (0 != guiRejected) && (sStats.uiRejected == guiRejected) &&
+           (TKEY_BLE_CONN_MAX == sStats.uiMaxActive) &&
+           (sStats.uiActive == guiModelCount) &&
+           (sStats.uiOpened - sStats.uiClosed == guiModelCount);
+}
+
+/* A connect on a handle still open, after a missed disconnect, resets the
+ * context in place */
+static TKey_BOOL tkey_ble_conn_check_reopen(TKey_VOID)
+{
+    TKey_BleConn_t *psFirst;
+    TKey_BleConn_t *psAgain;
+    TKey_UINT32 uiGeneration;
+    TKey_UINT16 usCid;
+
+    TKey_BleConn_Init();
+    if(E_TKEY_BLE_CONN_SUCCESS != TKey_BleConn_Open(3, E_TKEY_BLE_CONN_ROLE_PHONE,
+                                                    &psFirst)) {
+        return TKey_FALSE;
+    }
+    psFirst->usL2capCid = 0x40;
+    psFirst->ucSecState = E_TKEY_BLE_CONN_SEC_BONDED;
+    uiGeneration = psFirst->uiGeneration;
+    if(E_TKEY_BLE_CONN_SUCCESS != TKey_BleConn_GetL2capCid(3, &usCid) || 0x40 != usCid ||
+       E_TKEY_BLE_CONN_SUCCESS != TKey_BleConn_Open(3, E_TKEY_BLE_CONN_ROLE_TAB,
+                                                    &psAgain)) {
+        return TKey_FALSE;
+    }
+    return (psAgain == psFirst) && (psAgain->uiGeneration > uiGeneration) &&
+           (0 == psAgain->usL2capCid) &&
+           (E_TKEY_BLE_CONN_SEC_NONE == psAgain->ucSecState) &&
+           (E_TKEY_BLE_CONN_ROLE_TAB == psAgain->ucRole) &&
+           (1 == TKey_BleConn_GetCount()) &&
+           (E_TKEY_BLE_CONN_SUCCESS == TKey_BleConn_Close(3)) &&
+           (E_TKEY_BLE_CONN_NOT_FOUND == TKey_BleConn_Close(3)) &&
+           (E_TKEY_BLE_CONN_INVALID_ARG == TKey_BleConn_Open(
+                TKEY_BLE_CONN_HANDLE_INVALID, E_TKEY_BLE_CONN_ROLE_PHONE, &psAgain));
+}
+
+/* A full table of handles spread over the whole range, closed in random
+ * order: half the map is in use, so entries share clusters and each close
+ * shifts others back. Every handle left must still be found. */
+static TKey_BOOL tkey_ble_conn_check_scattered(TKey_VOID)
+{
+    TKey_UINT16 ausHandle[TKEY_BLE_CONN_MAX];
+    TKey_BleConn_t *psConn;
+    TKey_UINT32 uiRound;
+    TKey_UINT32 uiOpen;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiPick;
+
+    for(uiRound = 0; uiRound < TKEY_BLE_CONN_CHECK_ROUNDS; uiRound++) {
+        TKey_BleConn_Init();
+        for(uiOpen = 0; uiOpen < TKEY_BLE_CONN_MAX; uiOpen++) {
+            do {
+                ausHandle[uiOpen] = (TKey_UINT16)tkey_ble_conn_check_random(
+                                        TKEY_BLE_CONN_HANDLE_INVALID);
+            } while(TKey_NULL != TKey_BleConn_Find(ausHandle[uiOpen]));
+            if(E_TKEY_BLE_CONN_SUCCESS != TKey_BleConn_Open(ausHandle[uiOpen],
+                                              E_TKEY_BLE_CONN_ROLE_PHONE, &psConn)) {
+                return TKey_FALSE;
+            }
+        }
+        while(0 != uiOpen) {
+            uiPick = tkey_ble_conn_check_random(uiOpen);
+            if(E_TKEY_BLE_CONN_SUCCESS != TKey_BleConn_Close(ausHandle[uiPick]) ||
+               TKey_NULL != TKey_BleConn_Find(ausHandle[uiPick])) {
+                return TKey_FALSE;
+            }
+            ausHandle[uiPick] = ausHandle[--uiOpen];
+            for(uiIndex = 0; uiIndex < uiOpen; uiIndex++) {
+                psConn = TKey_BleConn_Find(ausHandle[uiIndex]);
+                if(TKey_NULL == psConn || psConn->usConnHandle != ausHandle[uiIndex]) {
+                    return TKey_FALSE;
+                }
+            }
+        }
+        if(0 != TKey_BleConn_GetCount()) {
+            return TKey_FALSE;
+        }
+    }
+    return TKey_TRUE;
+}
+
+#if defined(THINKEY_BLE_CONN_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiFailed = 0;
+
+    (void)argc;
+    (void)argv;
+    /* Reopened handles are logged as warnings */
+    (void)TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_BLE, THINKEY_DEBUG_LEVEL_NONE);
+
+    tkey_ble_conn_check_result("connect stream", tkey_ble_conn_check_stream(),
+                               &uiFailed);
+    tkey_ble_conn_check_result("missed disconnect", tkey_ble_conn_check_reopen(),
+                               &uiFailed);
+    tkey_ble_conn_check_result("scattered handles",
+                               tkey_ble_conn_check_scattered(), &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_BLE_CONN_CHECK_MAIN */
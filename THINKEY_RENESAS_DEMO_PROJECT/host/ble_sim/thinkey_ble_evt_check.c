@@ -0,0 +1,374 @@
+/*
+ * \file thinkey_ble_evt_check.c
+ *
+ * \brief BLE stack event batching check on the BLE simulator
+ *
+ * The simulator queues its GAP events as the SoftDevice does and raises
+ * the stack interrupt for each; the interrupt handler is the firmware's
+ * SD_EVT_IRQHandler(), run with TKey_OsalPosix_RunIsr(), and the task
+ * loop is that of task_process_events(): drain on a wakeup, queue another
+ * when the batch was cut short, drain on the receive timeout in case a
+ * wakeup did not fit the queue. Checks that a burst of events costs one
+ * wakeup, that long bursts are drained in batches of at most
+ * TKEY_BLE_EVT_BATCH_MAX, that a wakeup lost to a full queue is made up
+ * by the timeout, that events raised during a drain get a wakeup of their
+ * own, and, with the task on its own thread against random bursts, that
+ * every event is dispatched once and in order, with as many interrupts
+ * as events and at most as many wakeups. Host builds only; built with
+ * THINKEY_BLE_EVT_CHECK_MAIN it is a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_ble_sim.h"
+#include "thinkey_ble_evt.h"
+#include "thinkey_osal.h"
+#include "thinkey_osal_posix.h"
+#include <stdio.h>
+
+#define TKEY_BLE_EVT_CHECK_EXPECTED 256     /* events raised, not dispatched */
+#define TKEY_BLE_EVT_CHECK_QUEUE 4          /* task queue, as vProcessQueue */
+#define TKEY_BLE_EVT_CHECK_TIMEOUT_MS 2     /* task receive timeout */
+#define TKEY_BLE_EVT_CHECK_BURSTS 2000
+#define TKEY_BLE_EVT_CHECK_BURST_MAX 40
+#define TKEY_BLE_EVT_CHECK_WAIT_MS 2000
+
+/* Task queue messages */
+#define TKEY_BLE_EVT_CHECK_PROCESS 1        /* E_THINKEY_BLE_PROCESS_EVENTS */
+#define TKEY_BLE_EVT_CHECK_OTHER 2          /* notifications and the rest */
+
+/* Events raised and not yet dispatched, in order */
+static TKey_BleSimEvtType_t gaeExpectType[TKEY_BLE_EVT_CHECK_EXPECTED];
+static TKey_UINT16 gausExpectHandle[TKEY_BLE_EVT_CHECK_EXPECTED];
+static volatile TKey_UINT32 guiRaised;
+static volatile TKey_UINT32 guiDispatched;
+static TKey_BOOL gbInOrder = TKey_TRUE;
+
+static TKey_UINT16 gausOpen[TKEY_BLE_SIM_MAX_LINKS];
+static TKey_UINT32 guiOpen;
+static TKey_UINT32 guiRaiseInHandler;     /* events the handler raises */
+
+static THINKey_HANDLE ghQueue;
+static TKey_UINT32 guiIsrWakeups;         /* IsrSignal asking for a wakeup */
+static TKey_UINT32 guiIsrDropped;         /* of them, not fitting the queue */
+static TKey_UINT32 guiCheckRandom = 0x2545F491;
+
+static TKey_UINT32 tkey_ble_evt_check_random(TKey_UINT32 uiRange)
+{
+    guiCheckRandom ^= guiCheckRandom << 13;
+    guiCheckRandom ^= guiCheckRandom >> 17;
+    guiCheckRandom ^= guiCheckRandom << 5;
+    return guiCheckRandom % uiRange;
+}
+
+static TKey_VOID tkey_ble_evt_check_result(const TKey_CHAR *pcCheck,
+                                           TKey_BOOL bPassed,
+                                           TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+/* Has the simulator raise one GAP event: a connect, or the disconnect of
+ * an open link */
+static TKey_VOID tkey_ble_evt_check_raise(TKey_VOID)
+{
+    TKey_BleSimEvtType_t eType;
+    TKey_UINT32 uiIndex;
+    TKey_UINT16 usHandle;
+
+    THINKey_OSAL_vEnterCritical();
+    if((0 == guiOpen) ||
+       ((TKEY_BLE_SIM_MAX_LINKS > guiOpen) && (0 == tkey_ble_evt_check_random(2)))) {
+        (void)TKey_BleSim_Connect(&usHandle);
+        gausOpen[guiOpen++] = usHandle;
+        eType = E_TKEY_BLE_SIM_EVT_CONNECTED;
+    } else {
+        uiIndex = tkey_ble_evt_check_random(guiOpen);
+        usHandle = gausOpen[uiIndex];
+        gausOpen[uiIndex] = gausOpen[--guiOpen];
+        (void)TKey_BleSim_Disconnect(usHandle);
+        eType = E_TKEY_BLE_SIM_EVT_DISCONNECTED;
+    }
+    /* Queued, not dispatched yet: the fetch takes the critical section */
+    gaeExpectType[guiRaised % TKEY_BLE_EVT_CHECK_EXPECTED] = eType;
+    gausExpectHandle[guiRaised % TKEY_BLE_EVT_CHECK_EXPECTED] = usHandle;
+    guiRaised++;
+    THINKey_OSAL_vExitCritical();
+}
+
+/* The firmware BLE event handler, run by the fetch */
+static TKey_VOID tkey_ble_evt_check_evt(const TKey_BleSimEvt_t *psEvt)
+{
+    TKey_UINT32 uiSlot = guiDispatched % TKEY_BLE_EVT_CHECK_EXPECTED;
+
+    if((guiDispatched == guiRaised) || (psEvt->eType != gaeExpectType[uiSlot]) ||
+       (psEvt->usConnHandle != gausExpectHandle[uiSlot])) {
+        gbInOrder = TKey_FALSE;
+    }
+    guiDispatched++;
+    if(0 != guiRaiseInHandler) {
+        guiRaiseInHandler--;
+        tkey_ble_evt_check_raise();
+    }
+}
+
+/* sd_ble_evt_get() and the observers, for TKey_BleEvt_Drain() */
+static TKey_BOOL tkey_ble_evt_check_fetch(TKey_VOID *pvContext)
+{
+    TKey_BOOL bFetched;
+
+    (void)pvContext;
+    THINKey_OSAL_vEnterCritical();
+    bFetched = TKey_BleSim_EvtGet();
+    THINKey_OSAL_vExitCritical();
+    return bFetched;
+}
+
+/* SD_EVT_IRQHandler() */
+static TKey_VOID tkey_ble_evt_check_isr(TKey_VOID *pvArg)
+{
+    TKey_UINT32 uiMessage = TKEY_BLE_EVT_CHECK_PROCESS;
+    TKey_UINT32 uiWoken = 0;
+
+    (void)pvArg;
+    if(TKey_BleEvt_IsrSignal()) {
+        guiIsrWakeups++;
+        if(E_THINKEY_SUCCESS != THINKey_OSAL_eQueueSendToFromISR(ghQueue, &uiMessage,
+                                                                &uiWoken)) {
+            guiIsrDropped++;
+        }
+    }
+}
+
+static TKey_VOID tkey_ble_evt_check_irq(TKey_VOID)
+{
+    TKey_OsalPosix_RunIsr(tkey_ble_evt_check_isr, TKey_NULL);
+}
+
+/* One pass of the task_process_events() loop. Returns TKey_FALSE when the
+ * receive timed out. */
+static TKey_BOOL tkey_ble_evt_check_task_step(TKey_UINT32 uiTimeoutMs)
+{
+    TKey_UINT32 uiMessage;
+
+    if(E_THINKEY_SUCCESS != THINKey_OSAL_eTimedQueueReceive(ghQueue, &uiMessage,
+                                                           uiTimeoutMs)) {
+        /* Timed out: drain events whose wakeup did not fit the queue */
+        if(TKey_BleEvt_Drain()) {
+            uiMessage = TKEY_BLE_EVT_CHECK_PROCESS;
+            (void)THINKey_OSAL_eQueueSend(ghQueue, &uiMessage);
+        }
+        return TKey_FALSE;
+    }
+    if((TKEY_BLE_EVT_CHECK_PROCESS == uiMessage) && TKey_BleEvt_Drain()) {
+        /* A full batch goes to the back of the queue */
+        (void)THINKey_OSAL_eQueueSend(ghQueue, &uiMessage);
+    }
+    return TKey_TRUE;
+}
+
+static TKey_VOID tkey_ble_evt_check_task(TKey_VOID *pvParams)
+{
+    (void)pvParams;
+    for(;;) {
+        (void)tkey_ble_evt_check_task_step(TKEY_BLE_EVT_CHECK_TIMEOUT_MS);
+    }
+}
+
+/* Runs the task inline until its queue is empty and nothing is pending */
+static TKey_VOID tkey_ble_evt_check_task_idle(TKey_VOID)
+{
+    while(tkey_ble_evt_check_task_step(THINKEY_OSAL_ZERO)) {
+    }
+}
+
+static TKey_VOID tkey_ble_evt_check_setup(TKey_VOID)
+{
+    guiRaised = 0;
+    guiDispatched = 0;
+    guiOpen = 0;
+    guiIsrWakeups = 0;
+    guiIsrDropped = 0;
+    ghQueue = THINKey_OSAL_hCreateQueue(TKEY_BLE_EVT_CHECK_QUEUE, sizeof(TKey_UINT32));
+    TKey_BleSim_Init(tkey_ble_evt_check_evt);
+    TKey_BleSim_SetEvtQueue(tkey_ble_evt_check_irq);
+    TKey_BleEvt_Init(tkey_ble_evt_check_fetch, TKey_NULL);
+}
+
+/* Every burst shorter than the batch costs one wakeup and one drain */
+static TKey_BOOL tkey_ble_evt_check_burst(TKey_VOID)
+{
+    TKey_BleEvtStats_t sStats;
+    THINKey_OSAL_QueueStats_t sQueue;
+    TKey_UINT32 uiBurst;
+    TKey_UINT32 uiEvent;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    tkey_ble_evt_check_setup();
+    for(uiBurst = 1; uiBurst < TKEY_BLE_EVT_BATCH_MAX && bPassed; uiBurst++) {
+        for(uiEvent = 0; uiEvent < uiBurst; uiEvent++) {
+            tkey_ble_evt_check_raise();
+        }
+        THINKey_OSAL_vQueueGetStats(ghQueue, &sQueue);
+        bPassed = (uiBurst == guiIsrWakeups) && (1 == sQueue.uiDepth);
+        tkey_ble_evt_check_task_idle();
+        bPassed = bPassed && (guiDispatched == guiRaised);
+    }
+
+    TKey_BleEvt_GetStats(&sStats);
+    return bPassed && gbInOrder && (guiRaised == sStats.uiIrqs) &&
+           (guiRaised == sStats.uiEvents) &&
+           (TKEY_BLE_EVT_BATCH_MAX - 1 == sStats.uiWakeups) &&
+           (TKEY_BLE_EVT_BATCH_MAX - 1 == sStats.uiDrains) && (0 == sStats.uiCutShort) &&
+           (TKEY_BLE_EVT_BATCH_MAX - 1 == sStats.uiMaxBatch);
+}
+
+/* A burst longer than the batch is drained over several wakeups, the
+ * first one from the interrupt and the rest queued by the task */
+static TKey_BOOL tkey_ble_evt_check_cut_short(TKey_VOID)
+{
+    TKey_BleEvtStats_t sStats;
+    THINKey_OSAL_QueueStats_t sQueue;
+    TKey_UINT32 uiEvent;
+
+    tkey_ble_evt_check_setup();
+    for(uiEvent = 0; uiEvent < 3 * TKEY_BLE_EVT_BATCH_MAX + 5; uiEvent++) {
+        tkey_ble_evt_check_raise();
+    }
+    tkey_ble_evt_check_task_idle();
+
+    TKey_BleEvt_GetStats(&sStats);
+    THINKey_OSAL_vQueueGetStats(ghQueue, &sQueue);
+    return gbInOrder && (guiDispatched == guiRaised) && (1 == guiIsrWakeups) &&
+           (guiRaised == sStats.uiIrqs) && (guiRaised == sStats.uiEvents) &&
+           (4 == sStats.uiDrains) && (3 == sStats.uiCutShort) &&
+           (TKEY_BLE_EVT_BATCH_MAX == sStats.uiMaxBatch) && (4 == sQueue.uiSent);
+}
+
+/* A wakeup not fitting the full queue is not asked for again by the
+ * events that follow; the receive timeout drains them all */
+static TKey_BOOL tkey_ble_evt_check_lost_wakeup(TKey_VOID)
+{
+    TKey_BleEvtStats_t sStats;
+    TKey_UINT32 uiMessage = TKEY_BLE_EVT_CHECK_OTHER;
+    TKey_UINT32 uiEvent;
+    TKey_BOOL bPassed;
+
+    tkey_ble_evt_check_setup();
+    while(E_THINKEY_SUCCESS == THINKey_OSAL_eQueueSend(ghQueue, &uiMessage)) {
+    }
+    for(uiEvent = 0; uiEvent < 5; uiEvent++) {
+        tkey_ble_evt_check_raise();
+    }
+    bPassed = (1 == guiIsrWakeups) && (1 == guiIsrDropped);
+
+    /* The other messages are handled, the events stay pending */
+    for(uiEvent = 0; uiEvent < TKEY_BLE_EVT_CHECK_QUEUE; uiEvent++) {
+        bPassed = bPassed && tkey_ble_evt_check_task_step(THINKEY_OSAL_ZERO);
+    }
+    bPassed = bPassed && (0 == guiDispatched);
+    tkey_ble_evt_check_raise();
+    bPassed = bPassed && (1 == guiIsrWakeups);
+
+    /* Timed out */
+    bPassed = bPassed && !tkey_ble_evt_check_task_step(TKEY_BLE_EVT_CHECK_TIMEOUT_MS);
+    TKey_BleEvt_GetStats(&sStats);
+    return bPassed && gbInOrder && (6 == guiDispatched) && (6 == sStats.uiIrqs) &&
+           (6 == sStats.uiEvents) && (1 == sStats.uiWakeups) && (1 == sStats.uiDrains);
+}
+
+/* Events raised by the handlers while a batch is drained ask for a wakeup
+ * of their own, and are not left pending without one */
+static TKey_BOOL tkey_ble_evt_check_during_drain(TKey_VOID)
+{
+    TKey_BleEvtStats_t sStats;
+    TKey_UINT32 uiEvent;
+
+    tkey_ble_evt_check_setup();
+    for(uiEvent = 0; uiEvent < 3; uiEvent++) {
+        tkey_ble_evt_check_raise();
+    }
+    /* Each dispatch raises the next, up to 30 */
+    guiRaiseInHandler = 30;
+    tkey_ble_evt_check_task_idle();
+
+    TKey_BleEvt_GetStats(&sStats);
+    return gbInOrder && (0 == guiRaiseInHandler) && (33 == guiRaised) &&
+           (guiDispatched == guiRaised) && (guiRaised == sStats.uiIrqs) &&
+           (guiRaised == sStats.uiEvents) && (guiIsrWakeups == sStats.uiWakeups) &&
+           (1 < sStats.uiWakeups) && (0 == guiIsrDropped);
+}
+
+/* The task on its own thread against random bursts, the queue now and
+ * then filled by other messages */
+static TKey_BOOL tkey_ble_evt_check_threaded(TKey_VOID)
+{
+    TKey_BleEvtStats_t sStats;
+    TKey_BleSimCounters_t sCounters;
+    TKey_UINT32 uiMessage = TKEY_BLE_EVT_CHECK_OTHER;
+    TKey_UINT32 uiBurst;
+    TKey_UINT32 uiEvent;
+    TKey_UINT32 uiWaitMs;
+
+    tkey_ble_evt_check_setup();
+    if(E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("BLE events", tkey_ble_evt_check_task,
+                                                     TKey_NULL, 2, 512, TKey_NULL)) {
+        return TKey_FALSE;
+    }
+    for(uiBurst = 0; uiBurst < TKEY_BLE_EVT_CHECK_BURSTS; uiBurst++) {
+        if(0 == tkey_ble_evt_check_random(8)) {
+            (void)THINKey_OSAL_eQueueSend(ghQueue, &uiMessage);
+        }
+        for(uiEvent = tkey_ble_evt_check_random(TKEY_BLE_EVT_CHECK_BURST_MAX);
+            uiEvent != 0; uiEvent--) {
+            tkey_ble_evt_check_raise();
+        }
+        /* Room in the stack event queue for the next burst */
+        for(uiWaitMs = 0; (guiRaised - guiDispatched >
+                           TKEY_BLE_SIM_EVT_QUEUE - TKEY_BLE_EVT_CHECK_BURST_MAX) &&
+            (uiWaitMs < TKEY_BLE_EVT_CHECK_WAIT_MS); uiWaitMs++) {
+            THINKey_OSAL_Delay(1);
+        }
+    }
+    for(uiWaitMs = 0; (guiRaised != guiDispatched) &&
+        (uiWaitMs < TKEY_BLE_EVT_CHECK_WAIT_MS); uiWaitMs++) {
+        THINKey_OSAL_Delay(1);
+    }
+
+    THINKey_OSAL_vEnterCritical();
+    TKey_BleEvt_GetStats(&sStats);
+    TKey_BleSim_GetCounters(&sCounters);
+    THINKey_OSAL_vExitCritical();
+    return gbInOrder && (guiRaised == guiDispatched) && (0 == sCounters.uiEvtOverflow) &&
+           (guiRaised == sCounters.uiEvtQueued) && (guiRaised == sStats.uiIrqs) &&
+           (guiRaised == sStats.uiEvents) && (guiIsrWakeups == sStats.uiWakeups) &&
+           (sStats.uiWakeups <= sStats.uiIrqs) &&
+           (sStats.uiMaxBatch <= TKEY_BLE_EVT_BATCH_MAX);
+}
+
+#if defined(THINKEY_BLE_EVT_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiFailed = 0;
+
+    (void)argc;
+    (void)argv;
+
+    tkey_ble_evt_check_result("one wakeup per burst", tkey_ble_evt_check_burst(),
+                              &uiFailed);
+    tkey_ble_evt_check_result("burst cut short", tkey_ble_evt_check_cut_short(),
+                              &uiFailed);
+    tkey_ble_evt_check_result("lost wakeup", tkey_ble_evt_check_lost_wakeup(),
+                              &uiFailed);
+    tkey_ble_evt_check_result("events during drain",
+                              tkey_ble_evt_check_during_drain(), &uiFailed);
+    tkey_ble_evt_check_result("threaded bursts", tkey_ble_evt_check_threaded(),
+                              &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_BLE_EVT_CHECK_MAIN */
@@ -0,0 +1,350 @@
+/*
+ * \file thinkey_ble_link_policy_check.c
+ *
+ * \brief BLE link policy check
+ *
+ * Feeds the link policy of one link with TKey_BleLinkPolicy_Activity(),
+ * TKey_BleLinkPolicy_Rssi() and TKey_BleLinkPolicy_Update() calls on a
+ * time line, as the BLE event task does, and logs the connection
+ * parameter and PHY requests made to the stack. Checks when the interval
+ * and the PHY change: the idle parameters and 2M on the first update,
+ * a burst as soon as the guard allows and idle after the quiet time,
+ * LE Coded below the RSSI threshold and 2M again above the exit one, a
+ * refused request retried, and over a long random run the guard times
+ * between requests and the values requested. Host builds only; built with
+ * THINKEY_BLE_LINK_POLICY_CHECK_MAIN it is a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_ble_link_policy.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_BLE_LINK_POLICY_CHECK_UPDATE_MS 50     /* update period */
+#define TKEY_BLE_LINK_POLICY_CHECK_LOG 512
+#define TKEY_BLE_LINK_POLICY_CHECK_RANDOM_MS (600 * 1000)
+
+/* A request made to the stack */
+typedef struct
+{
+    TKey_UINT32 uiMs;
+    TKey_BOOL bPhy;
+    TKey_BOOL bAccepted;
+    TKey_BleLinkParams_t sParams;
+    TKey_BleLinkPhy_t ePhy;
+} TKey_BleLinkPolicyCheckRequest_t;
+
+static TKey_BleLinkPolicyCheckRequest_t gasLog[TKEY_BLE_LINK_POLICY_CHECK_LOG];
+static TKey_UINT32 guiLogged;
+static TKey_UINT32 guiNowMs;
+static TKey_UINT32 guiRefuseNext;           /* requests the stack refuses */
+static TKey_UINT32 guiRefuseOneIn;          /* or at random, 0 for none */
+static TKey_UINT32 guiCheckRandom = 0x1B873593;
+
+static TKey_UINT32 tkey_ble_link_policy_check_random(TKey_UINT32 uiRange)
+{
+    guiCheckRandom ^= guiCheckRandom << 13;
+    guiCheckRandom ^= guiCheckRandom >> 17;
+    guiCheckRandom ^= guiCheckRandom << 5;
+    return guiCheckRandom % uiRange;
+}
+
+static TKey_VOID tkey_ble_link_policy_check_result(const TKey_CHAR *pcCheck,
+                                                   TKey_BOOL bPassed,
+                                                   TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+static TKey_BOOL tkey_ble_link_policy_check_accept(TKey_VOID)
+{
+    if(0 != guiRefuseNext) {
+        guiRefuseNext--;
+        return TKey_FALSE;
+    }
+    return (0 == guiRefuseOneIn) ||
+           (0 != tkey_ble_link_policy_check_random(guiRefuseOneIn));
+}
+
+/* Logs the request; the log keeps the latest ones when full */
+static TKey_BleLinkPolicyCheckRequest_t* tkey_ble_link_policy_check_log(TKey_BOOL bPhy)
+{
+    TKey_BleLinkPolicyCheckRequest_t *psRequest =
+            &gasLog[guiLogged % TKEY_BLE_LINK_POLICY_CHECK_LOG];
+
+    memset(psRequest, 0, sizeof(*psRequest));
+    psRequest->uiMs = guiNowMs;
+    psRequest->bPhy = bPhy;
+    psRequest->bAccepted = tkey_ble_link_policy_check_accept();
+    guiLogged++;
+    return psRequest;
+}
+
+/* sd_ble_gap_conn_param_update() */
+static TKey_BOOL tkey_ble_link_policy_check_set_params(TKey_VOID *pvContext,
+        const TKey_BleLinkParams_t *psParams)
+{
+    TKey_BleLinkPolicyCheckRequest_t *psRequest = tkey_ble_link_policy_check_log(TKey_FALSE);
+
+    (void)pvContext;
+    psRequest->sParams = *psParams;
+    return psRequest->bAccepted;
+}
+
+/* sd_ble_gap_phy_update() */
+static TKey_BOOL tkey_ble_link_policy_check_set_phy(TKey_VOID *pvContext,
+        TKey_BleLinkPhy_t ePhy)
+{
+    TKey_BleLinkPolicyCheckRequest_t *psRequest = tkey_ble_link_policy_check_log(TKey_TRUE);
+
+    (void)pvContext;
+    psRequest->ePhy = ePhy;
+    return psRequest->bAccepted;
+}
+
+static TKey_VOID tkey_ble_link_policy_check_start(TKey_BleLinkPolicy_t *psPolicy)
+{
+    guiLogged = 0;
+    guiNowMs = 1000;
+    guiRefuseNext = 0;
+    guiRefuseOneIn = 0;
+    TKey_BleLinkPolicy_Init(psPolicy, tkey_ble_link_policy_check_set_params,
+                            tkey_ble_link_policy_check_set_phy, TKey_NULL, guiNowMs);
+}
+
+/* Updates the link every period until uiUntilMs, with activity every
+ * uiActivityMs (0 for none) and an RSSI sample each period (RSSI_NONE
+ * for none) */
+static TKey_VOID tkey_ble_link_policy_check_run(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_UINT32 uiUntilMs, TKey_UINT32 uiActivityMs, TKey_INT32 iRssi)
+{
+    while(guiNowMs < uiUntilMs) {
+        guiNowMs += TKEY_BLE_LINK_POLICY_CHECK_UPDATE_MS;
+        if(0 != uiActivityMs && 0 == guiNowMs % uiActivityMs) {
+            TKey_BleLinkPolicy_Activity(psPolicy, guiNowMs);
+        }
+        if(TKEY_BLE_POLICY_RSSI_NONE != iRssi) {
+            TKey_BleLinkPolicy_Rssi(psPolicy, iRssi);
+        }
+        TKey_BleLinkPolicy_Update(psPolicy, 0, guiNowMs);
+    }
+}
+
+static TKey_BOOL tkey_ble_link_policy_check_is_mode(
+        const TKey_BleLinkPolicyCheckRequest_t *psRequest, TKey_BleLinkMode_t eMode)
+{
+    TKey_UINT16 usMin = (E_TKEY_BLE_POLICY_MODE_BURST == eMode) ?
+                        TKEY_BLE_POLICY_BURST_INTERVAL_MIN : TKEY_BLE_POLICY_IDLE_INTERVAL_MIN;
+    TKey_UINT16 usMax = (E_TKEY_BLE_POLICY_MODE_BURST == eMode) ?
+                        TKEY_BLE_POLICY_BURST_INTERVAL_MAX : TKEY_BLE_POLICY_IDLE_INTERVAL_MAX;
+    TKey_UINT16 usLatency = (E_TKEY_BLE_POLICY_MODE_BURST == eMode) ?
+                            0 : TKEY_BLE_POLICY_IDLE_LATENCY;
+
+    return !psRequest->bPhy && (usMin == psRequest->sParams.usIntervalMin) &&
+           (usMax == psRequest->sParams.usIntervalMax) &&
+           (usLatency == psRequest->sParams.usLatency) &&
+           (TKEY_BLE_POLICY_SUP_TIMEOUT == psRequest->sParams.usSupTimeout);
+}
+
+/* The first update asks for the idle parameters and 2M at once, and
+ * nothing more while the link stays quiet */
+static TKey_BOOL tkey_ble_link_policy_check_first(TKey_VOID)
+{
+    TKey_BleLinkPolicy_t sPolicy;
+
+    tkey_ble_link_policy_check_start(&sPolicy);
+    TKey_BleLinkPolicy_Update(&sPolicy, 0, guiNowMs);
+    tkey_ble_link_policy_check_run(&sPolicy, 30000, 0, TKEY_BLE_POLICY_RSSI_NONE);
+    return (2 == guiLogged) && (1000 == gasLog[0].uiMs) &&
+           tkey_ble_link_policy_check_is_mode(&gasLog[0], E_TKEY_BLE_POLICY_MODE_IDLE) &&
+           (1000 == gasLog[1].uiMs) && gasLog[1].bPhy &&
+           (E_TKEY_BLE_POLICY_PHY_2M == gasLog[1].ePhy);
+}
+
+/* Activity gets the short interval on that update; TKEY_BLE_POLICY_IDLE_MS
+ * after the last SDU the long one comes back. Activity right after going
+ * idle waits for the burst guard, and idle after it for the full guard. */
+static TKey_BOOL tkey_ble_link_policy_check_burst(TKey_VOID)
+{
+    TKey_BleLinkPolicy_t sPolicy;
+    TKey_BleLinkStats_t sStats;
+    TKey_BOOL bPassed;
+
+    tkey_ble_link_policy_check_start(&sPolicy);
+    TKey_BleLinkPolicy_Update(&sPolicy, 0, guiNowMs);
+    tkey_ble_link_policy_check_run(&sPolicy, 5000, 0, TKEY_BLE_POLICY_RSSI_NONE);
+
+    /* A transaction from 5000 to 8000 ms: SDUs queued, then exchanged */
+    TKey_BleLinkPolicy_Update(&sPolicy, 1, guiNowMs);
+    tkey_ble_link_policy_check_run(&sPolicy, 8000, 100, TKEY_BLE_POLICY_RSSI_NONE);
+    tkey_ble_link_policy_check_run(&sPolicy, 10100, 0, TKEY_BLE_POLICY_RSSI_NONE);
+    bPassed = (4 == guiLogged) &&
+              (5000 == gasLog[2].uiMs) &&
+              tkey_ble_link_policy_check_is_mode(&gasLog[2], E_TKEY_BLE_POLICY_MODE_BURST) &&
+              (8000 + TKEY_BLE_POLICY_IDLE_MS == gasLog[3].uiMs) &&
+              tkey_ble_link_policy_check_is_mode(&gasLog[3], E_TKEY_BLE_POLICY_MODE_IDLE);
+
+    /* One SDU 100 ms after going idle */
+    TKey_BleLinkPolicy_Activity(&sPolicy, guiNowMs);
+    tkey_ble_link_policy_check_run(&sPolicy, 16000, 0, TKEY_BLE_POLICY_RSSI_NONE);
+    TKey_BleLinkPolicy_GetStats(&sPolicy, &sStats);
+    return bPassed && (6 == guiLogged) &&
+           (10000 + TKEY_BLE_POLICY_BURST_GUARD_MS == gasLog[4].uiMs) &&
+           tkey_ble_link_policy_check_is_mode(&gasLog[4], E_TKEY_BLE_POLICY_MODE_BURST) &&
+           (gasLog[4].uiMs + TKEY_BLE_POLICY_GUARD_MS == gasLog[5].uiMs) &&
+           tkey_ble_link_policy_check_is_mode(&gasLog[5], E_TKEY_BLE_POLICY_MODE_IDLE) &&
+           (2 == sStats.uiBursts) && (0 != sStats.uiDeferred) && (5 == sStats.uiParamRequests);
+}
+
+/* The PHY goes to LE Coded once the filtered RSSI is below the enter
+ * threshold, stays there between the thresholds, and goes back to 2M
+ * above the exit threshold, no sooner than the PHY guard allows */
+static TKey_BOOL tkey_ble_link_policy_check_phy(TKey_VOID)
+{
+    TKey_BleLinkPolicy_t sPolicy;
+    TKey_BOOL bPassed;
+
+    tkey_ble_link_policy_check_start(&sPolicy);
+    TKey_BleLinkPolicy_Update(&sPolicy, 0, guiNowMs);
+    tkey_ble_link_policy_check_run(&sPolicy, 10000, 0, TKEY_BLE_POLICY_CODED_EXIT_DBM + 5);
+    bPassed = (2 == guiLogged);
+
+    /* Walks off: a second of samples below the enter threshold */
+    tkey_ble_link_policy_check_run(&sPolicy, 11000, 0, TKEY_BLE_POLICY_CODED_ENTER_DBM - 10);
+    bPassed = bPassed && (3 == guiLogged) && gasLog[2].bPhy &&
+              (E_TKEY_BLE_POLICY_PHY_CODED == gasLog[2].ePhy) && (10000 < gasLog[2].uiMs);
+
+    /* Between the thresholds, then back close */
+    tkey_ble_link_policy_check_run(&sPolicy, 30000, 0,
+            (TKEY_BLE_POLICY_CODED_ENTER_DBM + TKEY_BLE_POLICY_CODED_EXIT_DBM) / 2);
+    bPassed = bPassed && (3 == guiLogged);
+    tkey_ble_link_policy_check_run(&sPolicy, 31000, 0, TKEY_BLE_POLICY_CODED_EXIT_DBM + 10);
+    bPassed = bPassed && (4 == guiLogged) && gasLog[3].bPhy &&
+              (E_TKEY_BLE_POLICY_PHY_2M == gasLog[3].ePhy) && (30000 < gasLog[3].uiMs);
+
+    /* Far again right away: held back by the PHY guard */
+    tkey_ble_link_policy_check_run(&sPolicy, 32000, 0, TKEY_BLE_POLICY_CODED_ENTER_DBM - 10);
+    bPassed = bPassed && (4 == guiLogged);
+    tkey_ble_link_policy_check_run(&sPolicy, 40000, 0, TKEY_BLE_POLICY_CODED_ENTER_DBM - 10);
+    return bPassed && (5 == guiLogged) && (E_TKEY_BLE_POLICY_PHY_CODED == gasLog[4].ePhy) &&
+           (gasLog[3].uiMs + TKEY_BLE_POLICY_PHY_GUARD_MS == gasLog[4].uiMs);
+}
+
+/* A request the stack refuses is made again once the guard allows */
+static TKey_BOOL tkey_ble_link_policy_check_refused(TKey_VOID)
+{
+    TKey_BleLinkPolicy_t sPolicy;
+    TKey_BleLinkStats_t sStats;
+
+    tkey_ble_link_policy_check_start(&sPolicy);
+    TKey_BleLinkPolicy_Update(&sPolicy, 0, guiNowMs);
+    tkey_ble_link_policy_check_run(&sPolicy, 5000, 0, TKEY_BLE_POLICY_RSSI_NONE);
+    guiRefuseNext = 1;
+    TKey_BleLinkPolicy_Update(&sPolicy, 1, guiNowMs);
+    tkey_ble_link_policy_check_run(&sPolicy, 6000, 100, TKEY_BLE_POLICY_RSSI_NONE);
+    TKey_BleLinkPolicy_GetStats(&sPolicy, &sStats);
+    return (4 == guiLogged) && !gasLog[2].bAccepted &&
+           tkey_ble_link_policy_check_is_mode(&gasLog[2], E_TKEY_BLE_POLICY_MODE_BURST) &&
+           gasLog[3].bAccepted &&
+           tkey_ble_link_policy_check_is_mode(&gasLog[3], E_TKEY_BLE_POLICY_MODE_BURST) &&
+           (gasLog[2].uiMs + TKEY_BLE_POLICY_BURST_GUARD_MS == gasLog[3].uiMs) &&
+           (1 == sStats.uiRefused) && (1 == sStats.uiBursts);
+}
+
+/* Random traffic, RSSI and refusals: parameter requests are at least the
+ * burst guard apart, and the full guard before going idle; PHY requests
+ * the PHY guard apart; every request is one of the configured sets, and
+ * no accepted request repeats the one before */
+static TKey_BOOL tkey_ble_link_policy_check_random_run(TKey_VOID)
+{
+    TKey_BleLinkPolicy_t sPolicy;
+    TKey_BleLinkStats_t sStats;
+    TKey_BleLinkPolicyCheckRequest_t *psRequest;
+    TKey_UINT32 uiLastParamsMs = 0;
+    TKey_UINT32 uiLastPhyMs = 0;
+    TKey_BOOL bParams = TKey_FALSE;
+    TKey_BOOL bPhy = TKey_FALSE;
+    TKey_BOOL bBurst = TKey_FALSE;
+    TKey_BOOL bLastBurst = TKey_FALSE;
+    TKey_BleLinkPhy_t eLastPhy = E_TKEY_BLE_POLICY_PHY_1M;
+    TKey_UINT32 uiChecked = 0;
+    TKey_INT32 iRssi = -60;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    tkey_ble_link_policy_check_start(&sPolicy);
+    guiRefuseOneIn = 5;
+    while(guiNowMs < TKEY_BLE_LINK_POLICY_CHECK_RANDOM_MS && bPassed) {
+        guiNowMs += TKEY_BLE_LINK_POLICY_CHECK_UPDATE_MS;
+        if(0 == tkey_ble_link_policy_check_random(40)) {
+            TKey_BleLinkPolicy_Activity(&sPolicy, guiNowMs);
+        }
+        iRssi += (TKey_INT32)tkey_ble_link_policy_check_random(7) - 3;
+        iRssi = (iRssi < -100) ? -100 : ((iRssi > -50) ? -50 : iRssi);
+        TKey_BleLinkPolicy_Rssi(&sPolicy, iRssi);
+        TKey_BleLinkPolicy_Update(&sPolicy, (0 == tkey_ble_link_policy_check_random(100)) ?
+                                  2 : 0, guiNowMs);
+
+        for(; uiChecked < guiLogged && bPassed; uiChecked++) {
+            psRequest = &gasLog[uiChecked % TKEY_BLE_LINK_POLICY_CHECK_LOG];
+            if(psRequest->bPhy) {
+                bPassed = (!bPhy ||
+                           psRequest->uiMs - uiLastPhyMs >= TKEY_BLE_POLICY_PHY_GUARD_MS) &&
+                          (E_TKEY_BLE_POLICY_PHY_2M == psRequest->ePhy ||
+                           E_TKEY_BLE_POLICY_PHY_CODED == psRequest->ePhy) &&
+                          (psRequest->ePhy != eLastPhy);
+                if(psRequest->bAccepted) {
+                    eLastPhy = psRequest->ePhy;
+                }
+                uiLastPhyMs = psRequest->uiMs;
+                bPhy = TKey_TRUE;
+                continue;
+            }
+            bBurst = tkey_ble_link_policy_check_is_mode(psRequest,
+                                                        E_TKEY_BLE_POLICY_MODE_BURST);
+            bPassed = (bBurst ||
+                       tkey_ble_link_policy_check_is_mode(psRequest,
+                                                          E_TKEY_BLE_POLICY_MODE_IDLE)) &&
+                      (!bParams || psRequest->uiMs - uiLastParamsMs >=
+                       (bBurst ? TKEY_BLE_POLICY_BURST_GUARD_MS : TKEY_BLE_POLICY_GUARD_MS)) &&
+                      (!bParams || bBurst != bLastBurst);
+            if(psRequest->bAccepted) {
+                bLastBurst = bBurst;
+                bParams = TKey_TRUE;
+            }
+            uiLastParamsMs = psRequest->uiMs;
+        }
+    }
+
+    TKey_BleLinkPolicy_GetStats(&sPolicy, &sStats);
+    return bPassed && (guiLogged == sStats.uiParamRequests + sStats.uiPhyRequests) &&
+           (0 != sStats.uiRefused) && (0 != sStats.uiBursts) &&
+           (sStats.uiPhyRequests > 2);
+}
+
+#if defined(THINKEY_BLE_LINK_POLICY_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiFailed = 0;
+
+    (void)argc;
+    (void)argv;
+
+    tkey_ble_link_policy_check_result("first update", tkey_ble_link_policy_check_first(),
+                                      &uiFailed);
+    tkey_ble_link_policy_check_result("burst and idle", tkey_ble_link_policy_check_burst(),
+                                      &uiFailed);
+    tkey_ble_link_policy_check_result("phy coded and back", tkey_ble_link_policy_check_phy(),
+                                      &uiFailed);
+    tkey_ble_link_policy_check_result("refused request",
+                                      tkey_ble_link_policy_check_refused(), &uiFailed);
+    tkey_ble_link_policy_check_result("random run",
+                                      tkey_ble_link_policy_check_random_run(), &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_BLE_LINK_POLICY_CHECK_MAIN */
@@ -0,0 +1,464 @@
+/*
+ * \file thinkey_ble_sim.c
+ *
+ * \brief Host BLE stack simulator
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_ble_sim.h"
+#include <string.h>
+
+typedef struct
+{
+    TKey_BYTE *pucData;
+    TKey_UINT16 usSize;
+} TKey_BleSimBuffer_t;
+
+typedef struct
+{
+    TKey_UINT16 usLen;
+    TKey_BYTE aucData[TKEY_BLE_SIM_MAX_SDU];
+} TKey_BleSimPeerSdu_t;
+
+typedef struct
+{
+    TKey_BOOL bUsed;
+    TKey_UINT16 usConnHandle;
+    TKey_UINT16 usCid;
+    TKey_UINT32 uiHead;
+    TKey_UINT32 uiCount;
+    TKey_BleSimBuffer_t asBuffer[TKEY_BLE_SIM_RX_BUFFERS];
+    /* Credit based link model */
+    TKey_BOOL bFlow;
+    TKey_UINT16 usMps;
+    TKey_UINT16 usCreditTarget;
+    TKey_UINT16 usPeerCredits;
+    TKey_UINT16 usGrantPending;
+    TKey_UINT32 uiGrantAtUs;
+    TKey_BOOL bInSdu;                   /* receiving an SDU */
+    TKey_BleSimBuffer_t sSduBuffer;     /* its buffer, TKey_NULL if dropped */
+    TKey_UINT16 usSduOffset;
+    TKey_UINT32 uiPeerHead;
+    TKey_UINT32 uiPeerCount;
+    TKey_BleSimPeerSdu_t asPeer[TKEY_BLE_SIM_PEER_QUEUE];
+} TKey_BleSimChannel_t;
+
+typedef struct
+{
+    TKey_BleSimHandler_t pfnHandler;
+    TKey_BleSimIrq_t pfnIrq;
+    TKey_UINT32 uiEvtHead;
+    TKey_UINT32 uiEvtCount;
+    TKey_BleSimEvt_t asEvt[TKEY_BLE_SIM_EVT_QUEUE];
+    TKey_BleSimChannel_t asChannel[TKEY_BLE_SIM_MAX_CHANNELS];
+    TKey_BleSimCounters_t sCounters;
+    TKey_UINT32 uiNowUs;
+    TKey_UINT32 uiRunToUs;
+    TKey_UINT16 usLlPayload;
+    TKey_UINT32 uiPhyKbps;
+    TKey_UINT32 uiCreditDelayUs;
+    TKey_UINT32 uiNextChannel;
+    TKey_BOOL abLink[TKEY_BLE_SIM_MAX_LINKS];
+} TKey_BleSim_t;
+
+#define TKEY_BLE_SIM_L2CAP_HEADER 4
+#define TKEY_BLE_SIM_LL_OVERHEAD 10     /* preamble, access address, header, CRC */
+#define TKEY_BLE_SIM_IFS_US 150
+
+static TKey_BleSim_t gsBleSim;
+
+static TKey_BleSimChannel_t* tkey_ble_sim_channel(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_BOOL bCreate)
+{
+    TKey_BleSimChannel_t *psFree = TKey_NULL;
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < TKEY_BLE_SIM_MAX_CHANNELS; uiIndex++) {
+        TKey_BleSimChannel_t *psChannel = &gsBleSim.asChannel[uiIndex];
+
+        if(psChannel->bUsed && psChannel->usConnHandle == usConnHandle &&
+           psChannel->usCid == usCid) {
+            return psChannel;
+        }
+        if(!psChannel->bUsed && TKey_NULL == psFree) {
+            psFree = psChannel;
+        }
+    }
+    if(!bCreate || TKey_NULL == psFree) {
+        return TKey_NULL;
+    }
+    memset(psFree, 0, sizeof(*psFree));
+    psFree->bUsed = TKey_TRUE;
+    psFree->usConnHandle = usConnHandle;
+    psFree->usCid = usCid;
+    return psFree;
+}
+
+static TKey_VOID tkey_ble_sim_emit_link(TKey_BleSimEvtType_t eType,
+        TKey_UINT16 usConnHandle, TKey_UINT16 usCid, TKey_BYTE *pucData,
+        TKey_UINT16 usLen)
+{
+    TKey_BleSimEvt_t sEvt;
+
+    sEvt.eType = eType;
+    sEvt.usConnHandle = usConnHandle;
+    sEvt.usCid = usCid;
+    sEvt.pucData = pucData;
+    sEvt.usLen = usLen;
+    if(TKey_NULL != gsBleSim.pfnIrq) {
+        if(TKEY_BLE_SIM_EVT_QUEUE == gsBleSim.uiEvtCount) {
+            gsBleSim.sCounters.uiEvtOverflow++;
+            return;
+        }
+        gsBleSim.asEvt[(gsBleSim.uiEvtHead + gsBleSim.uiEvtCount) %
+                       TKEY_BLE_SIM_EVT_QUEUE] = sEvt;
+        gsBleSim.uiEvtCount++;
+        gsBleSim.sCounters.uiEvtQueued++;
+        gsBleSim.pfnIrq();
+        return;
+    }
+    if(TKey_NULL != gsBleSim.pfnHandler) {
+        gsBleSim.pfnHandler(&sEvt);
+    }
+}
+
+static TKey_VOID tkey_ble_sim_emit(TKey_BleSimEvtType_t eType,
+        const TKey_BleSimChannel_t *psChannel, TKey_BYTE *pucData,
+        TKey_UINT16 usLen)
+{
+    tkey_ble_sim_emit_link(eType, psChannel->usConnHandle, psChannel->usCid,
+                           pucData, usLen);
+}
+
+TKey_VOID TKey_BleSim_Init(TKey_BleSimHandler_t pfnHandler)
+{
+    memset(&gsBleSim, 0, sizeof(gsBleSim));
+    gsBleSim.pfnHandler = pfnHandler;
+    gsBleSim.usLlPayload = 251;
+    gsBleSim.uiPhyKbps = 2000;
+    gsBleSim.uiCreditDelayUs = 7500;
+}
+
+TKey_StatusType TKey_BleSim_L2capRx(TKey_UINT16 usConnHandle, TKey_UINT16 usCid,
+                                    TKey_BYTE *pucBuf, TKey_UINT16 usSize)
+{
+    TKey_BleSimChannel_t *psChannel;
+    TKey_BleSimBuffer_t *psBuffer;
+
+    psChannel = tkey_ble_sim_channel(usConnHandle, usCid, TKey_TRUE);
+    if(TKey_NULL == pucBuf || TKey_NULL == psChannel ||
+       TKEY_BLE_SIM_RX_BUFFERS == psChannel->uiCount) {
+        return E_TKEY_FAILURE;
+    }
+    psBuffer = &psChannel->asBuffer[(psChannel->uiHead + psChannel->uiCount) %
+                                    TKEY_BLE_SIM_RX_BUFFERS];
+    psBuffer->pucData = pucBuf;
+    psBuffer->usSize = usSize;
+    psChannel->uiCount++;
+    return E_TKEY_SUCCESS;
+}
+
+TKey_StatusType TKey_BleSim_PeerSend(TKey_UINT16 usConnHandle, TKey_UINT16 usCid,
+                                     const TKey_BYTE *pucSdu, TKey_UINT16 usLen)
+{
+    TKey_BleSimChannel_t *psChannel;
+    TKey_BleSimBuffer_t sBuffer;
+
+    psChannel = tkey_ble_sim_channel(usConnHandle, usCid, TKey_FALSE);
+    if(TKey_NULL == psChannel || 0 == psChannel->uiCount ||
+       usLen > psChannel->asBuffer[psChannel->uiHead].usSize) {
+        gsBleSim.sCounters.uiRefused++;
+        return E_TKEY_FAILURE;
+    }
+    sBuffer = psChannel->asBuffer[psChannel->uiHead];
+    psChannel->uiHead = (psChannel->uiHead + 1) % TKEY_BLE_SIM_RX_BUFFERS;
+    psChannel->uiCount--;
+    /* The radio writing the reassembled PDUs */
+    memcpy(sBuffer.pucData, pucSdu, usLen);
+    gsBleSim.sCounters.uiStackBytes += usLen;
+    gsBleSim.sCounters.uiSdus++;
+    tkey_ble_sim_emit(E_TKEY_BLE_SIM_EVT_L2CAP_RX, psChannel, sBuffer.pucData,
+                      usLen);
+    return E_TKEY_SUCCESS;
+}
+
+TKey_VOID TKey_BleSim_Release(TKey_UINT16 usConnHandle, TKey_UINT16 usCid)
+{
+    TKey_BleSimChannel_t *psChannel;
+    TKey_BleSimChannel_t sReleased;
+
+    psChannel = tkey_ble_sim_channel(usConnHandle, usCid, TKey_FALSE);
+    if(TKey_NULL == psChannel) {
+        return;
+    }
+    /* The channel is gone before its buffers are returned */
+    sReleased = *psChannel;
+    psChannel->bUsed = TKey_FALSE;
+    while(0 != sReleased.uiCount) {
+        tkey_ble_sim_emit(E_TKEY_BLE_SIM_EVT_L2CAP_RELEASED, &sReleased,
+                          sReleased.asBuffer[sReleased.uiHead].pucData, 0);
+        sReleased.uiHead = (sReleased.uiHead + 1) % TKEY_BLE_SIM_RX_BUFFERS;
+        sReleased.uiCount--;
+    }
+}
+
+TKey_StatusType TKey_BleSim_Connect(TKey_UINT16 *pusConnHandle)
+{
+    TKey_UINT16 usConnHandle;
+
+    for(usConnHandle = 0; usConnHandle < TKEY_BLE_SIM_MAX_LINKS; usConnHandle++) {
+        if(!gsBleSim.abLink[usConnHandle]) {
+            break;
+        }
+    }
+    if(TKEY_BLE_SIM_MAX_LINKS == usConnHandle) {
+        return E_TKEY_FAILURE;
+    }
+    gsBleSim.abLink[usConnHandle] = TKey_TRUE;
+    *pusConnHandle = usConnHandle;
+    tkey_ble_sim_emit_link(E_TKEY_BLE_SIM_EVT_CONNECTED, usConnHandle, 0,
+                           TKey_NULL, 0);
+    return E_TKEY_SUCCESS;
+}
+
+TKey_StatusType TKey_BleSim_Disconnect(TKey_UINT16 usConnHandle)
+{
+    TKey_UINT32 uiIndex;
+
+    if(usConnHandle >= TKEY_BLE_SIM_MAX_LINKS || !gsBleSim.abLink[usConnHandle]) {
+        return E_TKEY_FAILURE;
+    }
+    for(uiIndex = 0; uiIndex < TKEY_BLE_SIM_MAX_CHANNELS; uiIndex++) {
+        if(gsBleSim.asChannel[uiIndex].bUsed &&
+           gsBleSim.asChannel[uiIndex].usConnHandle == usConnHandle) {
+            TKey_BleSim_Release(usConnHandle, gsBleSim.asChannel[uiIndex].usCid);
+        }
+    }
+    gsBleSim.abLink[usConnHandle] = TKey_FALSE;
+    tkey_ble_sim_emit_link(E_TKEY_BLE_SIM_EVT_DISCONNECTED, usConnHandle, 0,
+                           TKey_NULL, 0);
+    return E_TKEY_SUCCESS;
+}
+
+TKey_VOID TKey_BleSim_SetEvtQueue(TKey_BleSimIrq_t pfnIrq)
+{
+    gsBleSim.pfnIrq = pfnIrq;
+}
+
+TKey_BOOL TKey_BleSim_EvtGet(TKey_VOID)
+{
+    TKey_BleSimEvt_t sEvt;
+
+    if(0 == gsBleSim.uiEvtCount) {
+        return TKey_FALSE;
+    }
+    /* Taken off the queue first: the handler may cause more events */
+    sEvt = gsBleSim.asEvt[gsBleSim.uiEvtHead];
+    gsBleSim.uiEvtHead = (gsBleSim.uiEvtHead + 1) % TKEY_BLE_SIM_EVT_QUEUE;
+    gsBleSim.uiEvtCount--;
+    if(TKey_NULL != gsBleSim.pfnHandler) {
+        gsBleSim.pfnHandler(&sEvt);
+    }
+    return TKey_TRUE;
+}
+
+TKey_VOID TKey_BleSim_GetCounters(TKey_BleSimCounters_t *psCounters)
+{
+    *psCounters = gsBleSim.sCounters;
+}
+
+TKey_VOID TKey_BleSim_SetLink(TKey_UINT16 usLlPayload, TKey_UINT32 uiPhyKbps,
+                              TKey_UINT32 uiCreditDelayUs)
+{
+    gsBleSim.usLlPayload = (usLlPayload < 27) ? 27 : usLlPayload;
+    gsBleSim.uiPhyKbps = (0 == uiPhyKbps) ? 1000 : uiPhyKbps;
+    gsBleSim.uiCreditDelayUs = uiCreditDelayUs;
+}
+
+TKey_StatusType TKey_BleSim_L2capSetup(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_UINT16 usRxMps, TKey_UINT16 usCredits)
+{
+    TKey_BleSimChannel_t *psChannel;
+
+    psChannel = tkey_ble_sim_channel(usConnHandle, usCid, TKey_TRUE);
+    if(TKey_NULL == psChannel || 0 == usRxMps) {
+        return E_TKEY_FAILURE;
+    }
+    psChannel->bFlow = TKey_TRUE;
+    psChannel->usMps = usRxMps;
+    psChannel->usCreditTarget = usCredits;
+    return E_TKEY_SUCCESS;
+}
+
+TKey_StatusType TKey_BleSim_FlowControl(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_UINT16 usCredits)
+{
+    TKey_BleSimChannel_t *psChannel;
+
+    psChannel = tkey_ble_sim_channel(usConnHandle, usCid, TKey_FALSE);
+    if(TKey_NULL == psChannel || !psChannel->bFlow) {
+        return E_TKEY_FAILURE;
+    }
+    psChannel->usCreditTarget = usCredits;
+    return E_TKEY_SUCCESS;
+}
+
+TKey_StatusType TKey_BleSim_PeerQueue(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, const TKey_BYTE *pucSdu, TKey_UINT16 usLen)
+{
+    TKey_BleSimChannel_t *psChannel;
+    TKey_BleSimPeerSdu_t *psSdu;
+
+    psChannel = tkey_ble_sim_channel(usConnHandle, usCid, TKey_FALSE);
+    if(TKey_NULL == psChannel || !psChannel->bFlow || 0 == usLen ||
+       usLen > TKEY_BLE_SIM_MAX_SDU ||
+       TKEY_BLE_SIM_PEER_QUEUE == psChannel->uiPeerCount) {
+        return E_TKEY_FAILURE;
+    }
+    psSdu = &psChannel->asPeer[(psChannel->uiPeerHead + psChannel->uiPeerCount) %
+                               TKEY_BLE_SIM_PEER_QUEUE];
+    memcpy(psSdu->aucData, pucSdu, usLen);
+    psSdu->usLen = usLen;
+    psChannel->uiPeerCount++;
+    return E_TKEY_SUCCESS;
+}
+
+TKey_UINT32 TKey_BleSim_PeerPending(TKey_UINT16 usConnHandle, TKey_UINT16 usCid)
+{
+    TKey_BleSimChannel_t *psChannel;
+
+    psChannel = tkey_ble_sim_channel(usConnHandle, usCid, TKey_FALSE);
+    return (TKey_NULL == psChannel) ? 0 : psChannel->uiPeerCount;
+}
+
+/* Air time of a K-frame of usLen bytes, with its link layer acknowledgement */
+static TKey_UINT32 tkey_ble_sim_frame_us(TKey_UINT16 usLen)
+{
+    TKey_UINT32 uiBytes = usLen + TKEY_BLE_SIM_L2CAP_HEADER;
+    TKey_UINT32 uiPdus = (uiBytes + gsBleSim.usLlPayload - 1) /
+                         gsBleSim.usLlPayload;
+    TKey_UINT32 uiAirBits = (uiBytes + uiPdus * 2 * TKEY_BLE_SIM_LL_OVERHEAD) * 8;
+
+    return uiAirBits * 1000 / gsBleSim.uiPhyKbps +
+           uiPdus * 2 * TKEY_BLE_SIM_IFS_US;
+}
+
+/* The stack tops up the peer credits while it has somewhere to receive */
+static TKey_VOID tkey_ble_sim_credits(TKey_BleSimChannel_t *psChannel)
+{
+    TKey_BOOL bCanReceive = (0 != psChannel->uiCount || psChannel->bInSdu);
+
+    /* Granted when sent, if the stack can still take an SDU by then */
+    if(0 != psChannel->usGrantPending &&
+       (TKey_INT32)(gsBleSim.uiNowUs - psChannel->uiGrantAtUs) >= 0) {
+        if(bCanReceive && psChannel->usPeerCredits < psChannel->usCreditTarget) {
+            psChannel->usPeerCredits = psChannel->usCreditTarget;
+        }
+        psChannel->usGrantPending = 0;
+    }
+    if(0 == psChannel->usGrantPending && bCanReceive &&
+       psChannel->usPeerCredits < psChannel->usCreditTarget) {
+        psChannel->usGrantPending = psChannel->usCreditTarget -
+                                    psChannel->usPeerCredits;
+        psChannel->uiGrantAtUs = gsBleSim.uiNowUs + gsBleSim.uiCreditDelayUs;
+    }
+}
+
+static TKey_VOID tkey_ble_sim_frame(TKey_BleSimChannel_t *psChannel)
+{
+    TKey_BleSimPeerSdu_t *psSdu = &psChannel->asPeer[psChannel->uiPeerHead];
+    TKey_UINT16 usFrame;
+    TKey_UINT16 usData;
+
+    if(!psChannel->bInSdu) {
+        psChannel->bInSdu = TKey_TRUE;
+        psChannel->usSduOffset = 0;
+        psChannel->sSduBuffer.pucData = TKey_NULL;
+        if(0 != psChannel->uiCount &&
+           psSdu->usLen <= psChannel->asBuffer[psChannel->uiHead].usSize) {
+            psChannel->sSduBuffer = psChannel->asBuffer[psChannel->uiHead];
+            psChannel->uiHead = (psChannel->uiHead + 1) % TKEY_BLE_SIM_RX_BUFFERS;
+            psChannel->uiCount--;
+        } else {
+            gsBleSim.sCounters.uiDropped++;
+        }
+        usFrame = psSdu->usLen + 2;
+        if(usFrame > psChannel->usMps) {
+            usFrame = psChannel->usMps;
+        }
+        usData = usFrame - 2;
+    } else {
+        usData = psSdu->usLen - psChannel->usSduOffset;
+        if(usData > psChannel->usMps) {
+            usData = psChannel->usMps;
+        }
+        usFrame = usData;
+    }
+    gsBleSim.uiNowUs += tkey_ble_sim_frame_us(usFrame);
+    psChannel->usPeerCredits--;
+    gsBleSim.sCounters.uiFrames++;
+    if(TKey_NULL != psChannel->sSduBuffer.pucData) {
+        memcpy(psChannel->sSduBuffer.pucData + psChannel->usSduOffset,
+               psSdu->aucData + psChannel->usSduOffset, usData);
+        gsBleSim.sCounters.uiStackBytes += usData;
+    }
+    psChannel->usSduOffset += usData;
+    if(psChannel->usSduOffset < psSdu->usLen) {
+        return;
+    }
+    psChannel->bInSdu = TKey_FALSE;
+    psChannel->uiPeerHead = (psChannel->uiPeerHead + 1) % TKEY_BLE_SIM_PEER_QUEUE;
+    psChannel->uiPeerCount--;
+    if(TKey_NULL != psChannel->sSduBuffer.pucData) {
+        gsBleSim.sCounters.uiSdus++;
+        tkey_ble_sim_emit(E_TKEY_BLE_SIM_EVT_L2CAP_RX, psChannel,
+                          psChannel->sSduBuffer.pucData, psSdu->usLen);
+    }
+}
+
+TKey_VOID TKey_BleSim_Run(TKey_UINT32 uiUs)
+{
+    TKey_UINT32 uiEnd;
+    TKey_BleSimChannel_t *psChannel;
+    TKey_BleSimChannel_t *psReady;
+    TKey_UINT32 uiNext;
+    TKey_UINT32 uiIndex;
+
+    /* A frame may end past uiEnd; the next run starts from there */
+    gsBleSim.uiRunToUs += uiUs;
+    uiEnd = gsBleSim.uiRunToUs;
+    while((TKey_INT32)(uiEnd - gsBleSim.uiNowUs) > 0) {
+        psReady = TKey_NULL;
+        uiNext = uiEnd;
+        for(uiIndex = 0; uiIndex < TKEY_BLE_SIM_MAX_CHANNELS; uiIndex++) {
+            psChannel = &gsBleSim.asChannel[(gsBleSim.uiNextChannel + uiIndex) %
+                                            TKEY_BLE_SIM_MAX_CHANNELS];
+            if(!psChannel->bUsed || !psChannel->bFlow) {
+                continue;
+            }
+            tkey_ble_sim_credits(psChannel);
+            if(TKey_NULL == psReady && 0 != psChannel->uiPeerCount &&
+               0 != psChannel->usPeerCredits) {
+                psReady = psChannel;
+                gsBleSim.uiNextChannel = (gsBleSim.uiNextChannel + uiIndex + 1) %
+                                         TKEY_BLE_SIM_MAX_CHANNELS;
+            }
+            if(0 != psChannel->usGrantPending &&
+               (TKey_INT32)(psChannel->uiGrantAtUs - uiNext) < 0) {
+                uiNext = psChannel->uiGrantAtUs;
+            }
+        }
+        if(TKey_NULL != psReady) {
+            tkey_ble_sim_frame(psReady);
+        } else {
+            gsBleSim.uiNowUs = uiNext;
+        }
+    }
+}
+
+TKey_UINT32 TKey_BleSim_GetTimeUs(TKey_VOID)
+{
+    return gsBleSim.uiNowUs;
+}
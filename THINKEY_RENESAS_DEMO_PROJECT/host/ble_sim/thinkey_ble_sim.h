@@ -0,0 +1,183 @@
+/*
+ * \file thinkey_ble_sim.h
+ *
+ * \brief Host BLE stack simulator
+ *
+ * Stands in for the SoftDevice on the L2CAP CoC receive path: the
+ * application hands receive buffers to a channel, like sd_ble_l2cap_ch_rx,
+ * and a simulated peer sends SDUs that the stack writes into the oldest
+ * buffer and reports with an L2CAP_RX event. A peer SDU finding no buffer
+ * is refused, as a peer without credits would hold it back. Events are
+ * delivered synchronously to the registered handler. Host builds only
+ * (THINKEY_HOST_BUILD); not part of the firmware image.
+ *
+ * A channel set up with TKey_BleSim_L2capSetup() also models the link in
+ * simulated time: the peer queues SDUs and TKey_BleSim_Run() sends them as
+ * K-frames of the channel MPS, one credit each, over a link of the given
+ * data length and PHY rate. Like the SoftDevice, the stack tops the peer
+ * credits up to the credit target while it holds a receive buffer for the
+ * channel; credits reach the peer after the configured delay. An SDU that
+ * starts with no buffer queued is dropped.
+ *
+ * Links are made and dropped with TKey_BleSim_Connect() and
+ * TKey_BleSim_Disconnect(), which hand out the lowest free connection
+ * handle and report GAP events the way the SoftDevice does: on disconnect
+ * the channels of the link are released first, returning their buffers.
+ *
+ * With TKey_BleSim_SetEvtQueue() events are queued instead, as the
+ * SoftDevice queues them, and the stack interrupt is raised for each one;
+ * TKey_BleSim_EvtGet() then takes the oldest and delivers it, as
+ * sd_ble_evt_get() and the observer dispatch do.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_BLE_SIM_H
+#define THINKEY_BLE_SIM_H
+
+#include "thinkey_platform_types.h"
+
+#define TKEY_BLE_SIM_MAX_CHANNELS 8
+#define TKEY_BLE_SIM_RX_BUFFERS 8       /* per channel */
+#define TKEY_BLE_SIM_PEER_QUEUE 16      /* SDUs the peer holds per channel */
+#define TKEY_BLE_SIM_MAX_SDU 512
+#define TKEY_BLE_SIM_MAX_LINKS 20       /* SoftDevice link count */
+#define TKEY_BLE_SIM_EVT_QUEUE 64       /* events the stack holds */
+
+/**
+ *  @brief Simulated stack events
+ */
+typedef enum
+{
+    E_TKEY_BLE_SIM_EVT_L2CAP_RX,        /* SDU received into pucData */
+    E_TKEY_BLE_SIM_EVT_L2CAP_RELEASED,  /* channel gone, pucData returned */
+    E_TKEY_BLE_SIM_EVT_CONNECTED,
+    E_TKEY_BLE_SIM_EVT_DISCONNECTED
+} TKey_BleSimEvtType_t;
+
+typedef struct
+{
+    TKey_BleSimEvtType_t eType;
+    TKey_UINT16 usConnHandle;
+    TKey_UINT16 usCid;
+    TKey_BYTE *pucData;
+    TKey_UINT16 usLen;
+} TKey_BleSimEvt_t;
+
+typedef TKey_VOID (*TKey_BleSimHandler_t)(const TKey_BleSimEvt_t *psEvt);
+
+/* The stack interrupt, raised for each queued event */
+typedef TKey_VOID (*TKey_BleSimIrq_t)(TKey_VOID);
+
+/**
+ *  @brief Simulator counters
+ */
+typedef struct
+{
+    TKey_UINT32 uiSdus;             /* delivered to the application */
+    TKey_UINT32 uiStackBytes;       /* written by the stack into app buffers */
+    TKey_UINT32 uiRefused;          /* peer SDUs finding no buffer */
+    TKey_UINT32 uiFrames;           /* K-frames sent by the peer */
+    TKey_UINT32 uiDropped;          /* SDUs started with no buffer */
+    TKey_UINT32 uiEvtQueued;        /* events queued for TKey_BleSim_EvtGet() */
+    TKey_UINT32 uiEvtOverflow;      /* events lost to a full event queue */
+} TKey_BleSimCounters_t;
+
+/**
+ * \brief   Resets the simulator and sets the event handler
+ */
+TKey_VOID TKey_BleSim_Init(TKey_BleSimHandler_t pfnHandler);
+
+/**
+ * \brief   Gives the stack a buffer of usSize bytes to receive the next SDU
+ *          of the channel into, as sd_ble_l2cap_ch_rx does
+ */
+TKey_StatusType TKey_BleSim_L2capRx(TKey_UINT16 usConnHandle, TKey_UINT16 usCid,
+                                    TKey_BYTE *pucBuf, TKey_UINT16 usSize);
+
+/**
+ * \brief   The peer sends an SDU on the channel. Fails when the application
+ *          has no buffer queued on it or the SDU does not fit.
+ */
+TKey_StatusType TKey_BleSim_PeerSend(TKey_UINT16 usConnHandle, TKey_UINT16 usCid,
+                                     const TKey_BYTE *pucSdu, TKey_UINT16 usLen);
+
+/**
+ * \brief   Releases the channel, returning each queued buffer with an
+ *          L2CAP_RELEASED event
+ */
+TKey_VOID TKey_BleSim_Release(TKey_UINT16 usConnHandle, TKey_UINT16 usCid);
+
+/**
+ * \brief   Sets the link model: link layer data length (27..251), PHY rate
+ *          and the delay before granted credits reach the peer
+ */
+TKey_VOID TKey_BleSim_SetLink(TKey_UINT16 usLlPayload, TKey_UINT32 uiPhyKbps,
+                              TKey_UINT32 uiCreditDelayUs);
+
+/**
+ * \brief   Sets up a credit based channel with the receive MPS and the
+ *          credit target of the setup reply
+ */
+TKey_StatusType TKey_BleSim_L2capSetup(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_UINT16 usRxMps, TKey_UINT16 usCredits);
+
+/**
+ * \brief   Changes the credit target, as sd_ble_l2cap_ch_flow_control does
+ */
+TKey_StatusType TKey_BleSim_FlowControl(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_UINT16 usCredits);
+
+/**
+ * \brief   Queues an SDU at the peer for TKey_BleSim_Run() to send. Fails
+ *          when the peer queue is full.
+ */
+TKey_StatusType TKey_BleSim_PeerQueue(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, const TKey_BYTE *pucSdu, TKey_UINT16 usLen);
+
+/**
+ * \brief   Returns the number of SDUs the peer still holds for the channel
+ */
+TKey_UINT32 TKey_BleSim_PeerPending(TKey_UINT16 usConnHandle, TKey_UINT16 usCid);
+
+/**
+ * \brief   Advances simulated time by uiUs, sending peer K-frames as the
+ *          credits allow
+ */
+TKey_VOID TKey_BleSim_Run(TKey_UINT32 uiUs);
+
+/**
+ * \brief   Returns the simulated time
+ */
+TKey_UINT32 TKey_BleSim_GetTimeUs(TKey_VOID);
+
+/**
+ * \brief   A peer connects: takes the lowest free connection handle and
+ *          reports CONNECTED. Fails when all links are in use.
+ */
+TKey_StatusType TKey_BleSim_Connect(TKey_UINT16 *pusConnHandle);
+
+/**
+ * \brief   The link drops: releases its channels, then reports DISCONNECTED
+ */
+TKey_StatusType TKey_BleSim_Disconnect(TKey_UINT16 usConnHandle);
+
+/**
+ * \brief   Queues events from now on, raising pfnIrq for each, instead of
+ *          delivering them as they happen. TKey_NULL delivers them again.
+ */
+TKey_VOID TKey_BleSim_SetEvtQueue(TKey_BleSimIrq_t pfnIrq);
+
+/**
+ * \brief   Delivers the oldest queued event to the handler
+ *
+ * \return  TKey_FALSE when no event is queued
+ */
+TKey_BOOL TKey_BleSim_EvtGet(TKey_VOID);
+
+/**
+ * \brief   Returns the simulator counters
+ */
+TKey_VOID TKey_BleSim_GetCounters(TKey_BleSimCounters_t *psCounters);
+
+#endif /* THINKEY_BLE_SIM_H */
@@ -0,0 +1,368 @@
+/*
+ * \file thinkey_l2cap_flow_check.c
+ *
+ * \brief L2CAP CoC receive flow control check on the BLE simulator
+ *
+ * A simulated peer keeps its queue full on a credit based channel while a
+ * consumer drains the L2CAP pool fast, then slowly, then not at all, then
+ * fast again. The BLE event handler calls TKey_L2capFlow_BufferDone() and
+ * TKey_L2capFlow_Update() as the firmware does, and Update also runs every
+ * millisecond of simulated time. Checks that the credits set on the stack
+ * never exceed the buffers it holds nor the pool, that no SDU is started
+ * without a buffer, that every SDU arrives once and in order, and that
+ * the window closes on the stalled consumer and reopens after it. Before
+ * that, two more links have their peers send a full window each at the
+ * same time, which must land without a drop. Host builds only; built with
+ * THINKEY_L2CAP_FLOW_CHECK_MAIN it is a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_ble_sim.h"
+#include "thinkey_l2cap_flow.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_L2CAP_FLOW_CHECK_CONN 0
+#define TKEY_L2CAP_FLOW_CHECK_CID 0x40
+#define TKEY_L2CAP_FLOW_CHECK_LL_PAYLOAD 27     /* SDUs take several K-frames */
+#define TKEY_L2CAP_FLOW_CHECK_PHY_KBPS 1000
+#define TKEY_L2CAP_FLOW_CHECK_CREDIT_US 7500
+#define TKEY_L2CAP_FLOW_CHECK_LINKS 2           /* beside the phased one */
+#define TKEY_L2CAP_FLOW_CHECK_LINK_SDU 16       /* one K-frame: a credit each */
+
+/* A channel and its flow control, the context of the flow callbacks */
+typedef struct
+{
+    TKey_UINT16 usConnHandle;
+    TKey_UINT16 usCid;
+    TKey_L2capFlow_t sFlow;
+} TKey_L2capFlowCheckLink_t;
+
+/* Consumer phases: SDUs taken per second, 0 when stalled */
+typedef struct
+{
+    const TKey_CHAR *pcName;
+    TKey_UINT32 uiMs;
+    TKey_UINT32 uiRate;
+} TKey_L2capFlowCheckPhase_t;
+
+static const TKey_L2capFlowCheckPhase_t gasCheckPhases[] = {
+    { "fast", 500, 1000 },
+    { "slow", 500, 50 },
+    { "stalled", 300, 0 },
+    { "recovered", 500, 1000 }
+};
+
+#define TKEY_L2CAP_FLOW_CHECK_PHASES \
+    (sizeof(gasCheckPhases) / sizeof(gasCheckPhases[0]))
+
+static TKey_L2capFlowCheckLink_t gsCheckLink;
+static TKey_L2capFlowCheckLink_t gasCheckLinks[TKEY_L2CAP_FLOW_CHECK_LINKS];
+static TKey_UINT32 guiPeerSeq;          /* next SDU the peer queues */
+static TKey_UINT32 guiTakenSeq;         /* next SDU the consumer expects */
+static TKey_UINT32 guiMaxCredits;
+static TKey_BOOL gbCreditsOverPosted;
+static TKey_BOOL gbOrderBroken;
+
+static TKey_VOID tkey_l2cap_flow_check_result(const TKey_CHAR *pcCheck,
+                                              TKey_BOOL bPassed,
+                                              TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+static TKey_UINT32 tkey_l2cap_flow_check_now_ms(TKey_VOID)
+{
+    return TKey_BleSim_GetTimeUs() / 1000;
+}
+
+static TKey_BOOL tkey_l2cap_flow_check_post(TKey_VOID *pvContext,
+                                            TKey_BYTE *pucBuf, TKey_UINT16 usSize)
+{
+    TKey_L2capFlowCheckLink_t *psLink = (TKey_L2capFlowCheckLink_t *)pvContext;
+
+    return (E_TKEY_SUCCESS == TKey_BleSim_L2capRx(psLink->usConnHandle,
+                                  psLink->usCid, pucBuf, usSize));
+}
+
+static TKey_VOID tkey_l2cap_flow_check_credits(TKey_VOID *pvContext,
+                                               TKey_UINT16 usCredits)
+{
+    TKey_L2capFlowCheckLink_t *psLink = (TKey_L2capFlowCheckLink_t *)pvContext;
+
+    if(usCredits > guiMaxCredits) {
+        guiMaxCredits = usCredits;
+    }
+    /* Credits with no buffer behind them would let the peer start an SDU
+     * the stack has to drop */
+    if(usCredits > psLink->sFlow.sStats.usPosted) {
+        gbCreditsOverPosted = TKey_TRUE;
+    }
+    (void)TKey_BleSim_FlowControl(psLink->usConnHandle, psLink->usCid,
+                                  usCredits);
+}
+
+static TKey_L2capFlowCheckLink_t* tkey_l2cap_flow_check_link(
+        TKey_UINT16 usConnHandle)
+{
+    TKey_UINT32 uiLink;
+
+    if(gsCheckLink.usConnHandle != usConnHandle) {
+        for(uiLink = 0; uiLink < TKEY_L2CAP_FLOW_CHECK_LINKS; uiLink++) {
+            if(gasCheckLinks[uiLink].usConnHandle == usConnHandle) {
+                return &gasCheckLinks[uiLink];
+            }
+        }
+    }
+    return &gsCheckLink;
+}
+
+/* The BLE event handler of the firmware, for the L2CAP receive part */
+static TKey_VOID tkey_l2cap_flow_check_evt(const TKey_BleSimEvt_t *psEvt)
+{
+    TKey_L2capFlow_t *psFlow = &tkey_l2cap_flow_check_link(
+                                        psEvt->usConnHandle)->sFlow;
+
+    switch(psEvt->eType) {
+    case E_TKEY_BLE_SIM_EVT_L2CAP_RX:
+        TKey_L2capFlow_BufferDone(psFlow);
+        (void)TKey_L2capPool_RxDone(psEvt->usConnHandle, psEvt->usCid,
+                                    psEvt->pucData, psEvt->usLen);
+        TKey_L2capFlow_Update(psFlow, tkey_l2cap_flow_check_now_ms());
+        break;
+    case E_TKEY_BLE_SIM_EVT_L2CAP_RELEASED:
+        TKey_L2capFlow_BufferDone(psFlow);
+        TKey_L2capPool_Free(psEvt->pucData);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Sets up the channel of psLink and opens its receive window */
+static TKey_BOOL tkey_l2cap_flow_check_setup(TKey_L2capFlowCheckLink_t *psLink)
+{
+    TKey_L2capFlowParams_t sParams;
+
+    if(E_TKEY_L2CAP_FLOW_SUCCESS != TKey_L2capFlow_Init(&psLink->sFlow,
+                                        TKEY_L2CAP_FLOW_CHECK_LL_PAYLOAD,
+                                        tkey_l2cap_flow_check_post,
+                                        tkey_l2cap_flow_check_credits, psLink,
+                                        tkey_l2cap_flow_check_now_ms(), &sParams) ||
+       E_TKEY_SUCCESS != TKey_BleSim_L2capSetup(psLink->usConnHandle,
+                             psLink->usCid, sParams.usRxMps,
+                             TKEY_L2CAP_FLOW_CREDITS_DEFAULT)) {
+        return TKey_FALSE;
+    }
+    TKey_L2capFlow_Update(&psLink->sFlow, tkey_l2cap_flow_check_now_ms());
+    return TKey_TRUE;
+}
+
+/* Two links open together each get their full window of credits, and
+ * both peers spending them at once find a buffer for every SDU */
+static TKey_BOOL tkey_l2cap_flow_check_links(TKey_VOID)
+{
+    TKey_BYTE aucSdu[TKEY_L2CAP_FLOW_CHECK_LINK_SDU];
+    TKey_BleSimCounters_t sCounters;
+    TKey_L2capFlowStats_t sStats;
+    TKey_L2capSdu_t sSdu;
+    TKey_UINT32 auiTaken[TKEY_L2CAP_FLOW_CHECK_LINKS] = { 0 };
+    TKey_UINT32 uiLink;
+    TKey_UINT32 uiSdu;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    memset(aucSdu, 0x5a, sizeof(aucSdu));
+    for(uiLink = 0; uiLink < TKEY_L2CAP_FLOW_CHECK_LINKS && bPassed; uiLink++) {
+        gasCheckLinks[uiLink].usConnHandle = (TKey_UINT16)(1 + uiLink);
+        gasCheckLinks[uiLink].usCid = TKEY_L2CAP_FLOW_CHECK_CID;
+        bPassed = tkey_l2cap_flow_check_setup(&gasCheckLinks[uiLink]);
+    }
+    for(uiLink = 0; uiLink < TKEY_L2CAP_FLOW_CHECK_LINKS && bPassed; uiLink++) {
+        TKey_L2capFlow_GetStats(&gasCheckLinks[uiLink].sFlow, &sStats);
+        bPassed = (TKEY_L2CAP_POOL_LINK_BUFFERS == sStats.usPosted) &&
+                  (TKEY_L2CAP_POOL_LINK_BUFFERS == sStats.usCredits);
+        for(uiSdu = 0; uiSdu < TKEY_L2CAP_POOL_LINK_BUFFERS && bPassed; uiSdu++) {
+            bPassed = (E_TKEY_SUCCESS == TKey_BleSim_PeerQueue(
+                            gasCheckLinks[uiLink].usConnHandle,
+                            gasCheckLinks[uiLink].usCid, aucSdu,
+                            sizeof(aucSdu)));
+        }
+    }
+    if(!bPassed) {
+        return TKey_FALSE;
+    }
+
+    /* Nobody consumes until both windows are spent */
+    TKey_BleSim_Run(100000);
+    for(uiLink = 0; uiLink < TKEY_L2CAP_FLOW_CHECK_LINKS; uiLink++) {
+        bPassed = bPassed && (0 == TKey_BleSim_PeerPending(
+                                        gasCheckLinks[uiLink].usConnHandle,
+                                        gasCheckLinks[uiLink].usCid));
+    }
+    while(E_TKEY_L2CAP_POOL_SUCCESS == TKey_L2capPool_Receive(&sSdu, 0)) {
+        for(uiLink = 0; uiLink < TKEY_L2CAP_FLOW_CHECK_LINKS; uiLink++) {
+            if(sSdu.usConnHandle == gasCheckLinks[uiLink].usConnHandle &&
+               sSdu.usLen == sizeof(aucSdu) &&
+               0 == memcmp(sSdu.pucData, aucSdu, sSdu.usLen)) {
+                auiTaken[uiLink]++;
+            }
+        }
+        TKey_L2capPool_Release(&sSdu);
+    }
+    for(uiLink = 0; uiLink < TKEY_L2CAP_FLOW_CHECK_LINKS; uiLink++) {
+        bPassed = bPassed && (TKEY_L2CAP_POOL_LINK_BUFFERS == auiTaken[uiLink]);
+        TKey_BleSim_Release(gasCheckLinks[uiLink].usConnHandle,
+                            gasCheckLinks[uiLink].usCid);
+    }
+    TKey_BleSim_GetCounters(&sCounters);
+    return bPassed && (0 == sCounters.uiDropped) && (0 == sCounters.uiRefused) &&
+           (TKEY_L2CAP_POOL_BUFFERS == TKey_L2capPool_GetFree());
+}
+
+/* SDUs of several K-frames, numbered in their first four bytes */
+static TKey_VOID tkey_l2cap_flow_check_peer_fill(TKey_VOID)
+{
+    TKey_BYTE aucSdu[TKEY_L2CAP_POOL_SDU_SIZE];
+    TKey_UINT16 usLen;
+    TKey_UINT16 usIndex;
+
+    for(;;) {
+        usLen = (TKey_UINT16)(4 + (guiPeerSeq * 29) % (TKEY_L2CAP_POOL_SDU_SIZE - 3));
+        memcpy(aucSdu, &guiPeerSeq, sizeof(guiPeerSeq));
+        for(usIndex = 4; usIndex < usLen; usIndex++) {
+            aucSdu[usIndex] = (TKey_BYTE)(guiPeerSeq + usIndex);
+        }
+        if(E_TKEY_SUCCESS != TKey_BleSim_PeerQueue(TKEY_L2CAP_FLOW_CHECK_CONN,
+                                 TKEY_L2CAP_FLOW_CHECK_CID, aucSdu, usLen)) {
+            return;
+        }
+        guiPeerSeq++;
+    }
+}
+
+static TKey_BOOL tkey_l2cap_flow_check_take(TKey_VOID)
+{
+    TKey_L2capSdu_t sSdu;
+    TKey_UINT32 uiSeq;
+
+    if(E_TKEY_L2CAP_POOL_SUCCESS != TKey_L2capPool_Receive(&sSdu, 0)) {
+        return TKey_FALSE;
+    }
+    memcpy(&uiSeq, sSdu.pucData, sizeof(uiSeq));
+    if(uiSeq != guiTakenSeq ||
+       sSdu.usLen != 4 + (uiSeq * 29) % (TKEY_L2CAP_POOL_SDU_SIZE - 3) ||
+       (sSdu.usLen > 4 &&
+        sSdu.pucData[sSdu.usLen - 1] != (TKey_BYTE)(uiSeq + sSdu.usLen - 1))) {
+        gbOrderBroken = TKey_TRUE;
+    }
+    guiTakenSeq = uiSeq + 1;
+    TKey_L2capPool_Release(&sSdu);
+    return TKey_TRUE;
+}
+
+/* Runs one consumer phase a millisecond at a time; returns the SDUs taken */
+static TKey_UINT32 tkey_l2cap_flow_check_phase(const TKey_L2capFlowCheckPhase_t *psPhase,
+                                               TKey_BOOL *pbBounded)
+{
+    TKey_L2capFlowStats_t sStats;
+    TKey_UINT32 uiAllowance = 0;
+    TKey_UINT32 uiTaken = 0;
+    TKey_UINT32 uiMs;
+
+    for(uiMs = 0; uiMs < psPhase->uiMs; uiMs++) {
+        tkey_l2cap_flow_check_peer_fill();
+        TKey_BleSim_Run(1000);
+        uiAllowance += psPhase->uiRate;
+        while(uiAllowance >= 1000 && tkey_l2cap_flow_check_take()) {
+            uiAllowance -= 1000;
+            uiTaken++;
+        }
+        if(uiAllowance > 1000) {
+            uiAllowance = 1000;
+        }
+        TKey_L2capFlow_Update(&gsCheckLink.sFlow, tkey_l2cap_flow_check_now_ms());
+
+        /* Buffers with the stack and SDUs queued to the consumer share the
+         * channel's part of the pool, and the stack is never promised more
+         * than it holds */
+        TKey_L2capFlow_GetStats(&gsCheckLink.sFlow, &sStats);
+        if(sStats.usPosted + sStats.uiQueueDepth > TKEY_L2CAP_POOL_LINK_BUFFERS ||
+           sStats.usCredits > TKEY_L2CAP_POOL_LINK_BUFFERS ||
+           (0 != sStats.usPosted && sStats.usCredits > sStats.usPosted)) {
+            *pbBounded = TKey_FALSE;
+        }
+    }
+    return uiTaken;
+}
+
+#if defined(THINKEY_L2CAP_FLOW_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 auiTaken[TKEY_L2CAP_FLOW_CHECK_PHASES];
+    TKey_L2capFlowStats_t sStats;
+    TKey_BleSimCounters_t sCounters;
+    TKey_UINT32 uiBackPressure = 0;
+    TKey_UINT32 uiPhase;
+    TKey_UINT32 uiFailed = 0;
+    TKey_BOOL bBounded = TKey_TRUE;
+    TKey_BOOL bStalled = TKey_FALSE;
+
+    (void)argc;
+    (void)argv;
+    TKey_BleSim_Init(tkey_l2cap_flow_check_evt);
+    TKey_BleSim_SetLink(TKEY_L2CAP_FLOW_CHECK_LL_PAYLOAD,
+                        TKEY_L2CAP_FLOW_CHECK_PHY_KBPS,
+                        TKEY_L2CAP_FLOW_CHECK_CREDIT_US);
+    if(E_TKEY_L2CAP_POOL_SUCCESS != TKey_L2capPool_Init()) {
+        printf("l2cap_flow_check: setup failed\r\n");
+        return 1;
+    }
+    tkey_l2cap_flow_check_result("two links full credits",
+                                 tkey_l2cap_flow_check_links(), &uiFailed);
+    gsCheckLink.usConnHandle = TKEY_L2CAP_FLOW_CHECK_CONN;
+    gsCheckLink.usCid = TKEY_L2CAP_FLOW_CHECK_CID;
+    if(!tkey_l2cap_flow_check_setup(&gsCheckLink)) {
+        printf("l2cap_flow_check: setup failed\r\n");
+        return 1;
+    }
+
+    for(uiPhase = 0; uiPhase < TKEY_L2CAP_FLOW_CHECK_PHASES; uiPhase++) {
+        auiTaken[uiPhase] = tkey_l2cap_flow_check_phase(&gasCheckPhases[uiPhase],
+                                                        &bBounded);
+        TKey_L2capFlow_GetStats(&gsCheckLink.sFlow, &sStats);
+        printf("%-10s %4lu SDUs taken, drain %lu/s, window %u, credits %u\r\n",
+               gasCheckPhases[uiPhase].pcName, (unsigned long)auiTaken[uiPhase],
+               (unsigned long)sStats.uiDrainRate, sStats.usTarget,
+               sStats.usCredits);
+        if(0 == gasCheckPhases[uiPhase].uiRate) {
+            /* Closed: nothing posted, the pool full of what was let in */
+            bStalled = (0 == sStats.usTarget) && (0 == sStats.usPosted) &&
+                       (sStats.uiBackPressure > uiBackPressure);
+        }
+        uiBackPressure = sStats.uiBackPressure;
+    }
+
+    TKey_BleSim_GetCounters(&sCounters);
+    tkey_l2cap_flow_check_result("credits within buffers",
+                                 bBounded && !gbCreditsOverPosted &&
+                                 (0 != guiMaxCredits) &&
+                                 (guiMaxCredits <= TKEY_L2CAP_POOL_LINK_BUFFERS),
+                                 &uiFailed);
+    tkey_l2cap_flow_check_result("no sdu dropped",
+                                 (0 == sCounters.uiDropped) &&
+                                 (0 == sCounters.uiRefused), &uiFailed);
+    tkey_l2cap_flow_check_result("sdus in order", !gbOrderBroken &&
+                                 (sCounters.uiSdus >= guiTakenSeq), &uiFailed);
+    tkey_l2cap_flow_check_result("window closes on stall", bStalled, &uiFailed);
+    tkey_l2cap_flow_check_result("window reopens",
+                                 auiTaken[TKEY_L2CAP_FLOW_CHECK_PHASES - 1] >
+                                 auiTaken[1], &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_L2CAP_FLOW_CHECK_MAIN */
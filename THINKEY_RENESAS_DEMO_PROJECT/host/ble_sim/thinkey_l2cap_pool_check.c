@@ -0,0 +1,388 @@
+/*
+ * \file thinkey_l2cap_pool_check.c
+ *
+ * \brief L2CAP SDU buffer pool check on the BLE simulator
+ *
+ * Hands pool buffers to a simulated channel, has the peer send SDUs, and
+ * passes each through TKey_L2capPool_RxDone(), TKey_L2capPool_Receive()
+ * and the release calls, as the firmware receive path does. Checks that
+ * the consumer gets the very buffer the stack wrote into, that the stack
+ * wrote each payload byte once and nothing else copied it, that retained
+ * buffers stay out of the pool, and that buffers returned on channel
+ * release go back with TKey_L2capPool_Free(). The event path is run too:
+ * the descriptor rides in a data received event to a handler task, which
+ * checks and releases it, over many more SDUs than the pool has buffers.
+ * Host builds only; built with THINKEY_L2CAP_POOL_CHECK_MAIN it is a
+ * standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_ble_sim.h"
+#include "thinkey_l2cap_pool.h"
+#include "thinkey_osal.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_L2CAP_POOL_CHECK_CONN 0
+#define TKEY_L2CAP_POOL_CHECK_CID 0x40
+#define TKEY_L2CAP_POOL_CHECK_SDUS 64
+#define TKEY_L2CAP_POOL_CHECK_STACK 512
+#define TKEY_L2CAP_POOL_CHECK_PRIORITY 2
+#define TKEY_L2CAP_POOL_CHECK_WAIT_MS 2000  /* for the handler to free a buffer */
+
+/* Buffers the channel takes in a refill from uiFree free ones */
+#define TKEY_L2CAP_POOL_CHECK_CHANNEL(uiFree) \
+    (((uiFree) < TKEY_BLE_SIM_RX_BUFFERS) ? (uiFree) : TKEY_BLE_SIM_RX_BUFFERS)
+
+/* The transport event queue message, as far as the data path uses it */
+typedef enum
+{
+    E_TKEY_L2CAP_POOL_CHECK_DATA_RECEIVED,  /* E_THINKEY_DATA_RECEIVED */
+    E_TKEY_L2CAP_POOL_CHECK_STOP
+} TKey_L2capPoolCheckCommand_t;
+
+typedef struct
+{
+    TKey_L2capPoolCheckCommand_t eCommand;
+    TKey_UINT32 uiParam1;
+    TKey_UINT32 uiParam2;
+} TKey_L2capPoolCheckEvent_t;
+
+static TKey_BYTE *gpucStackWrote;       /* buffer of the last L2CAP_RX */
+static TKey_UINT32 guiReleased;
+static TKey_BYTE gaucPeerSdu[TKEY_L2CAP_POOL_SDU_SIZE];
+static TKey_HANDLE ghCheckEvents;       /* the transport event queue */
+static TKey_HANDLE ghCheckDone;
+static TKey_BOOL gbCheckEventPath;
+
+static TKey_VOID tkey_l2cap_pool_check_result(const TKey_CHAR *pcCheck,
+                                              TKey_BOOL bPassed,
+                                              TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+/* Posts a received SDU as a data received event, as the firmware does */
+static TKey_VOID tkey_l2cap_pool_check_post_event(const TKey_BleSimEvt_t *psEvt)
+{
+    TKey_L2capPoolCheckEvent_t sEvent;
+    TKey_L2capSdu_t sSdu;
+
+    sEvent.eCommand = E_TKEY_L2CAP_POOL_CHECK_DATA_RECEIVED;
+    if(E_TKEY_L2CAP_POOL_SUCCESS != TKey_L2capPool_RxEvent(psEvt->usConnHandle,
+                                        psEvt->usCid, psEvt->pucData,
+                                        psEvt->usLen, &sEvent.uiParam1,
+                                        &sEvent.uiParam2)) {
+        return;
+    }
+    if(E_THINKEY_SUCCESS != THINKey_OSAL_eQueueSend(ghCheckEvents, &sEvent) &&
+       E_TKEY_L2CAP_POOL_SUCCESS == TKey_L2capPool_FromEvent(sEvent.uiParam1,
+                                        sEvent.uiParam2, &sSdu)) {
+        TKey_L2capPool_Release(&sSdu);
+    }
+}
+
+/* The BLE event handler of the firmware, for the L2CAP part */
+static TKey_VOID tkey_l2cap_pool_check_evt(const TKey_BleSimEvt_t *psEvt)
+{
+    switch(psEvt->eType) {
+    case E_TKEY_BLE_SIM_EVT_L2CAP_RX:
+        gpucStackWrote = psEvt->pucData;
+        if(gbCheckEventPath) {
+            tkey_l2cap_pool_check_post_event(psEvt);
+        } else {
+            (void)TKey_L2capPool_RxDone(psEvt->usConnHandle, psEvt->usCid,
+                                        psEvt->pucData, psEvt->usLen);
+        }
+        break;
+    case E_TKEY_BLE_SIM_EVT_L2CAP_RELEASED:
+        guiReleased++;
+        TKey_L2capPool_Free(psEvt->pucData);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Hands free pool buffers to the channel until either runs out */
+static TKey_VOID tkey_l2cap_pool_check_refill(TKey_VOID)
+{
+    TKey_BYTE *pucBuf;
+
+    while(TKey_NULL != (pucBuf = TKey_L2capPool_Alloc())) {
+        if(E_TKEY_SUCCESS != TKey_BleSim_L2capRx(TKEY_L2CAP_POOL_CHECK_CONN,
+                                 TKEY_L2CAP_POOL_CHECK_CID, pucBuf,
+                                 TKEY_L2CAP_POOL_SDU_SIZE)) {
+            TKey_L2capPool_Free(pucBuf);
+            break;
+        }
+    }
+}
+
+static TKey_UINT16 tkey_l2cap_pool_check_peer_sdu(TKey_UINT32 uiSdu)
+{
+    TKey_UINT16 usLen = (TKey_UINT16)(1 + (uiSdu * 37) % TKEY_L2CAP_POOL_SDU_SIZE);
+    TKey_UINT16 usIndex;
+
+    for(usIndex = 0; usIndex < usLen; usIndex++) {
+        gaucPeerSdu[usIndex] = (TKey_BYTE)(uiSdu * 13 + usIndex);
+    }
+    return usLen;
+}
+
+/* Every SDU reaches the consumer in the buffer the stack wrote it into */
+static TKey_BOOL tkey_l2cap_pool_check_zero_copy(TKey_VOID)
+{
+    TKey_BleSimCounters_t sCounters;
+    TKey_L2capPoolStats_t sStats;
+    TKey_L2capSdu_t sSdu;
+    TKey_UINT32 uiBytes = 0;
+    TKey_UINT32 uiSdu;
+    TKey_UINT16 usLen;
+
+    for(uiSdu = 0; uiSdu < TKEY_L2CAP_POOL_CHECK_SDUS; uiSdu++) {
+        tkey_l2cap_pool_check_refill();
+        usLen = tkey_l2cap_pool_check_peer_sdu(uiSdu);
+        gpucStackWrote = TKey_NULL;
+        if(E_TKEY_SUCCESS != TKey_BleSim_PeerSend(TKEY_L2CAP_POOL_CHECK_CONN,
+                                 TKEY_L2CAP_POOL_CHECK_CID, gaucPeerSdu, usLen) ||
+           E_TKEY_L2CAP_POOL_SUCCESS != TKey_L2capPool_Receive(&sSdu, 0)) {
+            return TKey_FALSE;
+        }
+        if(sSdu.pucData != gpucStackWrote || sSdu.usLen != usLen ||
+           sSdu.usConnHandle != TKEY_L2CAP_POOL_CHECK_CONN ||
+           sSdu.usCid != TKEY_L2CAP_POOL_CHECK_CID ||
+           0 != memcmp(sSdu.pucData, gaucPeerSdu, usLen)) {
+            return TKey_FALSE;
+        }
+        uiBytes += usLen;
+        TKey_L2capPool_Release(&sSdu);
+    }
+
+    /* The stack wrote each byte once, the pool counted them without
+     * touching them */
+    TKey_BleSim_GetCounters(&sCounters);
+    TKey_L2capPool_GetStats(&sStats);
+    return (uiBytes == sCounters.uiStackBytes) && (uiBytes == sStats.uiRxBytes) &&
+           (TKEY_L2CAP_POOL_CHECK_SDUS == sStats.uiRxSdus) &&
+           (sStats.uiRxSdus == sStats.uiRxTaken) &&
+           (E_TKEY_L2CAP_POOL_TIMEOUT == TKey_L2capPool_Receive(&sSdu, 0));
+}
+
+/* The transport event handler: consumes each SDU in the buffer the event
+ * names, then releases it. On stop it replies with the SDUs that checked
+ * out and waits on. */
+static TKey_VOID tkey_l2cap_pool_check_event_task(TKey_VOID *pvParams)
+{
+    TKey_L2capPoolCheckEvent_t sEvent;
+    TKey_L2capSdu_t sSdu;
+    TKey_UINT32 uiGood = 0;
+    TKey_UINT32 uiSeq = 0;
+    TKey_UINT16 usLen;
+    TKey_UINT16 usIndex;
+    TKey_BOOL bGood;
+
+    (void)pvParams;
+    for(;;) {
+        if(E_THINKEY_SUCCESS != THINKey_OSAL_eQueueReceive(ghCheckEvents,
+                                                           &sEvent)) {
+            continue;
+        }
+        if(E_TKEY_L2CAP_POOL_CHECK_STOP == sEvent.eCommand) {
+            (void)THINKey_OSAL_eQueueSend(ghCheckDone, &uiGood);
+            continue;
+        }
+        if(E_TKEY_L2CAP_POOL_SUCCESS != TKey_L2capPool_FromEvent(
+                sEvent.uiParam1, sEvent.uiParam2, &sSdu)) {
+            uiSeq++;
+            continue;
+        }
+        /* The payload of tkey_l2cap_pool_check_peer_sdu(uiSeq) */
+        usLen = (TKey_UINT16)(1 + (uiSeq * 37) % TKEY_L2CAP_POOL_SDU_SIZE);
+        bGood = (sSdu.usLen == usLen) &&
+                (sSdu.usConnHandle == TKEY_L2CAP_POOL_CHECK_CONN) &&
+                (sSdu.usCid == TKEY_L2CAP_POOL_CHECK_CID) &&
+                ((TKey_UINT16)sEvent.uiParam2 == usLen) &&
+                ((TKey_UINT16)sEvent.uiParam1 == TKEY_L2CAP_POOL_CHECK_CID);
+        for(usIndex = 0; usIndex < usLen && bGood; usIndex++) {
+            bGood = (sSdu.pucData[usIndex] == (TKey_BYTE)(uiSeq * 13 + usIndex));
+        }
+        /* Slower than the peer now and then, so it waits for buffers */
+        if(0 == uiSeq % 8) {
+            THINKey_OSAL_Delay(1);
+        }
+        TKey_L2capPool_Release(&sSdu);
+        uiGood += bGood ? 1 : 0;
+        uiSeq++;
+    }
+}
+
+/* Receive, event, release: each SDU reaches the event handler in its pool
+ * buffer, and the buffers it releases carry the next SDUs */
+static TKey_BOOL tkey_l2cap_pool_check_event(TKey_VOID)
+{
+    TKey_L2capPoolCheckEvent_t sStop = { E_TKEY_L2CAP_POOL_CHECK_STOP, 0, 0 };
+    TKey_L2capPoolStats_t sBefore;
+    TKey_L2capPoolStats_t sStats;
+    TKey_UINT32 uiGood = 0;
+    TKey_UINT32 uiTaskID = 0;
+    TKey_UINT32 uiWaitMs;
+    TKey_UINT32 uiSdu;
+    TKey_UINT16 usLen;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    /* One event per pool buffer at most, so it never fills */
+    ghCheckEvents = THINKey_OSAL_hCreateQueue(TKEY_L2CAP_POOL_BUFFERS,
+                                              sizeof(TKey_L2capPoolCheckEvent_t));
+    ghCheckDone = THINKey_OSAL_hCreateQueue(1, sizeof(TKey_UINT32));
+    if(TKey_NULL == ghCheckEvents || TKey_NULL == ghCheckDone ||
+       E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("l2cap_chk_evt",
+               tkey_l2cap_pool_check_event_task, TKey_NULL,
+               TKEY_L2CAP_POOL_CHECK_PRIORITY, TKEY_L2CAP_POOL_CHECK_STACK,
+               &uiTaskID)) {
+        return TKey_FALSE;
+    }
+    TKey_L2capPool_GetStats(&sBefore);
+    gbCheckEventPath = TKey_TRUE;
+    for(uiSdu = 0; uiSdu < TKEY_L2CAP_POOL_CHECK_SDUS && bPassed; uiSdu++) {
+        usLen = tkey_l2cap_pool_check_peer_sdu(uiSdu);
+        for(uiWaitMs = 0; ; uiWaitMs++) {
+            tkey_l2cap_pool_check_refill();
+            if(E_TKEY_SUCCESS == TKey_BleSim_PeerSend(TKEY_L2CAP_POOL_CHECK_CONN,
+                                     TKEY_L2CAP_POOL_CHECK_CID, gaucPeerSdu,
+                                     usLen)) {
+                break;
+            }
+            if(uiWaitMs == TKEY_L2CAP_POOL_CHECK_WAIT_MS) {
+                bPassed = TKey_FALSE;
+                break;
+            }
+            THINKey_OSAL_Delay(1);
+        }
+    }
+    gbCheckEventPath = TKey_FALSE;
+    bPassed = bPassed &&
+              (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueSendTimed(ghCheckEvents,
+                   &sStop, TKEY_L2CAP_POOL_CHECK_WAIT_MS,
+                   E_THINKEY_OSAL_QUEUE_BACK)) &&
+              (E_THINKEY_SUCCESS == THINKey_OSAL_eTimedQueueReceive(ghCheckDone,
+                   &uiGood, TKEY_L2CAP_POOL_CHECK_WAIT_MS));
+
+    /* Every descriptor taken and every buffer back once the channel lets
+     * go of the ones it still holds */
+    TKey_BleSim_Release(TKEY_L2CAP_POOL_CHECK_CONN, TKEY_L2CAP_POOL_CHECK_CID);
+    TKey_L2capPool_GetStats(&sStats);
+    return bPassed && (TKEY_L2CAP_POOL_CHECK_SDUS == uiGood) &&
+           (TKEY_L2CAP_POOL_CHECK_SDUS == sStats.uiRxSdus - sBefore.uiRxSdus) &&
+           (sStats.uiRxSdus == sStats.uiRxTaken) &&
+           (TKEY_L2CAP_POOL_BUFFERS == TKey_L2capPool_GetFree());
+}
+
+/* A retained buffer stays out of the pool, and intact, until its last
+ * reference is dropped; with every buffer held the peer is refused */
+static TKey_BOOL tkey_l2cap_pool_check_retain(TKey_VOID)
+{
+    TKey_L2capSdu_t asHeld[TKEY_L2CAP_POOL_BUFFERS];
+    TKey_BYTE aucFirst[TKEY_L2CAP_POOL_SDU_SIZE];
+    TKey_UINT32 uiSdu;
+    TKey_UINT16 usLen;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    for(uiSdu = 0; uiSdu < TKEY_L2CAP_POOL_BUFFERS && bPassed; uiSdu++) {
+        tkey_l2cap_pool_check_refill();
+        usLen = tkey_l2cap_pool_check_peer_sdu(uiSdu + 100);
+        if(0 == uiSdu) {
+            memcpy(aucFirst, gaucPeerSdu, usLen);
+        }
+        bPassed = (E_TKEY_SUCCESS == TKey_BleSim_PeerSend(TKEY_L2CAP_POOL_CHECK_CONN,
+                                        TKEY_L2CAP_POOL_CHECK_CID, gaucPeerSdu,
+                                        usLen)) &&
+                  (E_TKEY_L2CAP_POOL_SUCCESS == TKey_L2capPool_Receive(&asHeld[uiSdu],
+                                                                       0));
+    }
+    if(!bPassed) {
+        return TKey_FALSE;
+    }
+
+    /* Nothing left to receive into */
+    bPassed = (0 == TKey_L2capPool_GetFree()) && (TKey_NULL == TKey_L2capPool_Alloc()) &&
+              (E_TKEY_SUCCESS != TKey_BleSim_PeerSend(TKEY_L2CAP_POOL_CHECK_CONN,
+                                     TKEY_L2CAP_POOL_CHECK_CID, gaucPeerSdu, 1));
+
+    /* A second owner keeps the first buffer while the rest cycle */
+    TKey_L2capPool_Retain(&asHeld[0]);
+    TKey_L2capPool_Release(&asHeld[0]);
+    for(uiSdu = 1; uiSdu < TKEY_L2CAP_POOL_BUFFERS; uiSdu++) {
+        TKey_L2capPool_Release(&asHeld[uiSdu]);
+    }
+    bPassed = bPassed && (TKEY_L2CAP_POOL_BUFFERS - 1 == TKey_L2capPool_GetFree());
+    for(uiSdu = 0; uiSdu < 2 * TKEY_L2CAP_POOL_BUFFERS && bPassed; uiSdu++) {
+        tkey_l2cap_pool_check_refill();
+        usLen = tkey_l2cap_pool_check_peer_sdu(uiSdu + 200);
+        bPassed = (E_TKEY_SUCCESS == TKey_BleSim_PeerSend(TKEY_L2CAP_POOL_CHECK_CONN,
+                                        TKEY_L2CAP_POOL_CHECK_CID, gaucPeerSdu,
+                                        usLen)) &&
+                  (E_TKEY_L2CAP_POOL_SUCCESS == TKey_L2capPool_Receive(&asHeld[1], 0)) &&
+                  (asHeld[1].pucData != asHeld[0].pucData);
+        TKey_L2capPool_Release(&asHeld[1]);
+    }
+    bPassed = bPassed && (0 == memcmp(asHeld[0].pucData, aucFirst, asHeld[0].usLen));
+    TKey_L2capPool_Release(&asHeld[0]);
+
+    /* The channel still holds what it was refilled with beside the
+     * retained buffer, bar the last SDU's */
+    return bPassed &&
+           (TKEY_L2CAP_POOL_BUFFERS + 1 -
+            TKEY_L2CAP_POOL_CHECK_CHANNEL(TKEY_L2CAP_POOL_BUFFERS - 1) ==
+            TKey_L2capPool_GetFree());
+}
+
+/* Buffers the stack gives back on channel release return to the pool;
+ * a buffer from outside the pool is not taken */
+static TKey_BOOL tkey_l2cap_pool_check_release(TKey_VOID)
+{
+    static TKey_BYTE aucForeign[TKEY_L2CAP_POOL_SDU_SIZE];
+    TKey_L2capPoolStats_t sStats;
+
+    tkey_l2cap_pool_check_refill();
+    guiReleased = 0;
+    TKey_BleSim_Release(TKEY_L2CAP_POOL_CHECK_CONN, TKEY_L2CAP_POOL_CHECK_CID);
+    TKey_L2capPool_GetStats(&sStats);
+    return (TKEY_L2CAP_POOL_CHECK_CHANNEL(TKEY_L2CAP_POOL_BUFFERS) == guiReleased) &&
+           (TKEY_L2CAP_POOL_BUFFERS == TKey_L2capPool_GetFree()) &&
+           (0 == sStats.uiMinFree) &&
+           (E_TKEY_L2CAP_POOL_INVALID_ARG == TKey_L2capPool_RxDone(
+                TKEY_L2CAP_POOL_CHECK_CONN, TKEY_L2CAP_POOL_CHECK_CID,
+                aucForeign, 1));
+}
+
+#if defined(THINKEY_L2CAP_POOL_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiFailed = 0;
+
+    (void)argc;
+    (void)argv;
+    TKey_BleSim_Init(tkey_l2cap_pool_check_evt);
+    if(E_TKEY_L2CAP_POOL_SUCCESS != TKey_L2capPool_Init()) {
+        printf("l2cap_pool_check: setup failed\r\n");
+        return 1;
+    }
+
+    tkey_l2cap_pool_check_result("sdu zero copy",
+                                 tkey_l2cap_pool_check_zero_copy(), &uiFailed);
+    tkey_l2cap_pool_check_result("rx event release",
+                                 tkey_l2cap_pool_check_event(), &uiFailed);
+    tkey_l2cap_pool_check_result("retain and exhaust",
+                                 tkey_l2cap_pool_check_retain(), &uiFailed);
+    tkey_l2cap_pool_check_result("channel release",
+                                 tkey_l2cap_pool_check_release(), &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_L2CAP_POOL_CHECK_MAIN */
@@ -0,0 +1,365 @@
+/*
+ * \file thinkey_rssi_ranging_check.c
+ *
+ * \brief BLE RSSI ranging trace replay check
+ *
+ * Replays RSSI traces through the RSSI ranging engine at the rate of the
+ * connection events. Each trace is a walk given by way points; its RSSI
+ * follows the log-distance model of the anchor, with a few dB of noise and
+ * now and then a deep fade, rounded to whole dBm as the stack reports it.
+ * Checks the range against the true distance when standing, the trend
+ * and the confidence reported when walking up and walking away, that the
+ * confidence does not follow the range estimate back and forth across a
+ * threshold, and the fusion of two anchors, one of them going stale. Host
+ * builds only; built with THINKEY_RSSI_RANGING_CHECK_MAIN it is a
+ * standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_rssi_ranging.h"
+#include "thinkey_debug.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_RSSI_RANGING_CHECK_EVENT_MS 50     /* connection interval */
+#define TKEY_RSSI_RANGING_CHECK_SETTLE_MS 3000
+#define TKEY_RSSI_RANGING_CHECK_NOISE_DB 3      /* peak, triangular */
+#define TKEY_RSSI_RANGING_CHECK_FADE_DB 12
+#define TKEY_RSSI_RANGING_CHECK_FADE_ONE_IN 20
+#define TKEY_RSSI_RANGING_CHECK_ANCHOR2 7
+
+/* Distance of the device at a time, the walk in between linear */
+typedef struct
+{
+    TKey_UINT32 uiMs;
+    TKey_UINT32 uiMm;
+} TKey_RssiRangingCheckPoint_t;
+
+/* What the callback was told */
+typedef struct
+{
+    TKey_UINT32 uiReports;
+    TKey_DeviceApproachConfidence_t eConfidence;
+    TKey_RssiTrend_t eTrend;
+    TKey_UINT32 uiConfidenceChanges;
+    TKey_UINT32 uiTrendChanges;
+    TKey_BOOL bConfidenceRose;
+    TKey_BOOL bConfidenceFell;
+    TKey_UINT32 uiApproachMm;           /* range when approach was reported */
+    TKey_UINT32 uiDepartMm;
+    TKey_UINT32 uiNumAnchors;
+    TKey_UINT32 auiAnchorID[TKEY_RSSI_MAX_ANCHORS];
+} TKey_RssiRangingCheckSeen_t;
+
+static TKey_RssiRangingCheckSeen_t gsSeen;
+static TKey_UINT32 guiCheckDevice;
+static TKey_UINT32 guiCheckRandom = 0x9E3779B9;
+
+static TKey_UINT32 tkey_rssi_ranging_check_random(TKey_UINT32 uiRange)
+{
+    guiCheckRandom ^= guiCheckRandom << 13;
+    guiCheckRandom ^= guiCheckRandom >> 17;
+    guiCheckRandom ^= guiCheckRandom << 5;
+    return guiCheckRandom % uiRange;
+}
+
+static TKey_VOID tkey_rssi_ranging_check_result(const TKey_CHAR *pcCheck,
+                                                TKey_BOOL bPassed,
+                                                TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+static TKey_VOID tkey_rssi_ranging_check_cb(TKey_HANDLE hKeyHandle,
+        const TKey_AnchorRanges_t *psRanges, TKey_UINT32 uiRangeMm,
+        const TKey_RssiApproach_t *psApproach)
+{
+    TKey_UINT32 uiIndex;
+
+    (void)hKeyHandle;
+    if(0 != gsSeen.uiReports && psApproach->eConfidence != gsSeen.eConfidence) {
+        gsSeen.uiConfidenceChanges++;
+        if(psApproach->eConfidence > gsSeen.eConfidence) {
+            gsSeen.bConfidenceRose = TKey_TRUE;
+        } else {
+            gsSeen.bConfidenceFell = TKey_TRUE;
+        }
+    }
+    if(0 != gsSeen.uiReports && psApproach->eTrend != gsSeen.eTrend) {
+        gsSeen.uiTrendChanges++;
+    }
+    if(E_TKEY_RSSI_TREND_APPROACHING == psApproach->eTrend && 0 == gsSeen.uiApproachMm) {
+        gsSeen.uiApproachMm = uiRangeMm;
+    }
+    if(E_TKEY_RSSI_TREND_DEPARTING == psApproach->eTrend && 0 == gsSeen.uiDepartMm) {
+        gsSeen.uiDepartMm = uiRangeMm;
+    }
+    gsSeen.uiReports++;
+    gsSeen.eConfidence = psApproach->eConfidence;
+    gsSeen.eTrend = psApproach->eTrend;
+    gsSeen.uiNumAnchors = psRanges->uiNumAnchors;
+    for(uiIndex = 0; uiIndex < psRanges->uiNumAnchors; uiIndex++) {
+        gsSeen.auiAnchorID[uiIndex] = psRanges->psRangeInfo[uiIndex].uiAnchorID;
+    }
+}
+
+/* A new device each time, so nothing is carried over */
+static TKey_HANDLE tkey_rssi_ranging_check_start(TKey_VOID)
+{
+    TKey_HANDLE hKey = (TKey_HANDLE)(TKey_VOID *)&gsSeen;
+
+    (void)TKey_RssiRanging_Stop(hKey);
+    memset(&gsSeen, 0, sizeof(gsSeen));
+    guiCheckDevice++;
+    (void)TKey_RssiRanging_Start(hKey, guiCheckDevice);
+    return hKey;
+}
+
+static TKey_UINT32 tkey_rssi_ranging_check_distance(
+        const TKey_RssiRangingCheckPoint_t *psTrace, TKey_UINT32 uiPoints,
+        TKey_UINT32 uiMs)
+{
+    TKey_UINT32 uiPoint;
+    TKey_INT32 iSpan;
+
+    for(uiPoint = 1; uiPoint < uiPoints; uiPoint++) {
+        if(uiMs <= psTrace[uiPoint].uiMs) {
+            iSpan = (TKey_INT32)psTrace[uiPoint].uiMm - (TKey_INT32)psTrace[uiPoint - 1].uiMm;
+            return (TKey_UINT32)((TKey_INT32)psTrace[uiPoint - 1].uiMm + iSpan *
+                    (TKey_INT32)(uiMs - psTrace[uiPoint - 1].uiMs) /
+                    (TKey_INT32)(psTrace[uiPoint].uiMs - psTrace[uiPoint - 1].uiMs));
+        }
+    }
+    return psTrace[uiPoints - 1].uiMm;
+}
+
+/* RSSI of one connection event at a distance */
+static TKey_INT32 tkey_rssi_ranging_check_rssi(const TKey_RssiCalib_t *psCalib,
+                                               TKey_UINT32 uiMm)
+{
+    double dRssi = psCalib->sRssiAt1m -
+                   psCalib->usPathLossExp10 * log10((double)uiMm / 1000.0) -
+                   psCalib->sOffset;
+
+    dRssi += ((double)tkey_rssi_ranging_check_random(1001) +
+              (double)tkey_rssi_ranging_check_random(1001) - 1000.0) *
+             TKEY_RSSI_RANGING_CHECK_NOISE_DB / 1000.0;
+    if(0 == tkey_rssi_ranging_check_random(TKEY_RSSI_RANGING_CHECK_FADE_ONE_IN)) {
+        dRssi -= TKEY_RSSI_RANGING_CHECK_FADE_DB;
+    }
+    return (TKey_INT32)floor(dRssi + 0.5);
+}
+
+static TKey_UINT32 tkey_rssi_ranging_check_trace_ms(
+        const TKey_RssiRangingCheckPoint_t *psTrace, TKey_UINT32 uiPoints)
+{
+    return psTrace[uiPoints - 1].uiMs;
+}
+
+/* Standing still, nine estimates in ten are within a quarter of the true
+ * distance, fades and all; the trend stays steady and the confidence ends
+ * as that of the distance */
+static TKey_BOOL tkey_rssi_ranging_check_standing(TKey_VOID)
+{
+    static const TKey_UINT32 auiDistanceMm[] = { 700, 1500, 2500, 4000, 6000, 10000 };
+    const TKey_RssiCalib_t sCalib = TKEY_RSSI_CALIB_DEFAULT;
+    TKey_DeviceApproachConfidence_t eExpected;
+    TKey_RssiApproach_t sApproach;
+    TKey_HANDLE hKey;
+    TKey_UINT32 uiEstimates;
+    TKey_UINT32 uiWithin;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiMm;
+    TKey_UINT32 uiMs;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    for(uiIndex = 0; uiIndex < sizeof(auiDistanceMm) / sizeof(auiDistanceMm[0]) &&
+        bPassed; uiIndex++) {
+        uiMm = auiDistanceMm[uiIndex];
+        eExpected = (uiMm <= TKEY_RSSI_NEAR_MM) ? E_TKEY_DEVICE_APPROACH_CONFIDENCE_HIGH :
+                    E_TKEY_DEVICE_APPROACH_CONFIDENCE_LOW;
+        hKey = tkey_rssi_ranging_check_start();
+        uiEstimates = 0;
+        uiWithin = 0;
+        for(uiMs = 0; uiMs < 4 * TKEY_RSSI_RANGING_CHECK_SETTLE_MS && bPassed;
+            uiMs += TKEY_RSSI_RANGING_CHECK_EVENT_MS) {
+            bPassed = (E_TKEY_RSSI_SUCCESS == TKey_RssiRanging_AddSample(hKey,
+                            TKEY_RSSI_ANCHOR_LOCAL,
+                            tkey_rssi_ranging_check_rssi(&sCalib, uiMm), uiMs)) &&
+                      (E_TKEY_RSSI_SUCCESS == TKey_RssiRanging_GetEstimate(hKey, &sApproach));
+            if(!bPassed || uiMs < TKEY_RSSI_RANGING_CHECK_SETTLE_MS) {
+                continue;
+            }
+            uiEstimates++;
+            if(4 * sApproach.uiRangeMm >= 3 * uiMm && 4 * sApproach.uiRangeMm <= 5 * uiMm) {
+                uiWithin++;
+            }
+            bPassed = (E_TKEY_RSSI_TREND_STEADY == sApproach.eTrend) &&
+                      (1 == sApproach.uiAnchorsUsed);
+        }
+        bPassed = bPassed && (10 * uiWithin >= 9 * uiEstimates) &&
+                  (eExpected == gsSeen.eConfidence);
+    }
+    return bPassed;
+}
+
+/* Replays a trace on the local anchor */
+static TKey_BOOL tkey_rssi_ranging_check_replay(TKey_HANDLE hKey,
+        const TKey_RssiRangingCheckPoint_t *psTrace, TKey_UINT32 uiPoints)
+{
+    const TKey_RssiCalib_t sCalib = TKEY_RSSI_CALIB_DEFAULT;
+    TKey_UINT32 uiEndMs = tkey_rssi_ranging_check_trace_ms(psTrace, uiPoints);
+    TKey_UINT32 uiMs;
+
+    for(uiMs = 0; uiMs <= uiEndMs; uiMs += TKEY_RSSI_RANGING_CHECK_EVENT_MS) {
+        if(E_TKEY_RSSI_SUCCESS != TKey_RssiRanging_AddSample(hKey, TKEY_RSSI_ANCHOR_LOCAL,
+                tkey_rssi_ranging_check_rssi(&sCalib,
+                        tkey_rssi_ranging_check_distance(psTrace, uiPoints, uiMs)),
+                uiMs)) {
+            return TKey_FALSE;
+        }
+    }
+    return TKey_TRUE;
+}
+
+/* Walking up from 15 m at 1.3 m/s: the approach is reported before the
+ * device is near, and the confidence ends high and steady */
+static TKey_BOOL tkey_rssi_ranging_check_walk_up(TKey_VOID)
+{
+    static const TKey_RssiRangingCheckPoint_t asTrace[] = {
+        { 0, 15000 }, { 3000, 15000 }, { 14000, 800 }, { 20000, 800 }
+    };
+    TKey_HANDLE hKey = tkey_rssi_ranging_check_start();
+
+    return tkey_rssi_ranging_check_replay(hKey, asTrace,
+                                          sizeof(asTrace) / sizeof(asTrace[0])) &&
+           (gsSeen.uiApproachMm > TKEY_RSSI_NEAR_MM) &&
+           gsSeen.bConfidenceRose &&
+           (E_TKEY_DEVICE_APPROACH_CONFIDENCE_HIGH == gsSeen.eConfidence) &&
+           (E_TKEY_RSSI_TREND_STEADY == gsSeen.eTrend) && (2 >= gsSeen.uiTrendChanges) &&
+           (0 == gsSeen.uiDepartMm);
+}
+
+/* Walking away to 15 m: departure is reported, and the confidence ends
+ * low and steady */
+static TKey_BOOL tkey_rssi_ranging_check_walk_away(TKey_VOID)
+{
+    static const TKey_RssiRangingCheckPoint_t asTrace[] = {
+        { 0, 800 }, { 3000, 800 }, { 14000, 15000 }, { 20000, 15000 }
+    };
+    TKey_HANDLE hKey = tkey_rssi_ranging_check_start();
+
+    return tkey_rssi_ranging_check_replay(hKey, asTrace,
+                                          sizeof(asTrace) / sizeof(asTrace[0])) &&
+           (0 != gsSeen.uiDepartMm) && (0 == gsSeen.uiApproachMm) &&
+           gsSeen.bConfidenceFell &&
+           (E_TKEY_DEVICE_APPROACH_CONFIDENCE_LOW == gsSeen.eConfidence) &&
+           (E_TKEY_RSSI_TREND_STEADY == gsSeen.eTrend) && (2 >= gsSeen.uiTrendChanges);
+}
+
+/* Standing on the near threshold the range estimate keeps crossing it;
+ * the confidence, kept until the range is a quarter past the threshold,
+ * changes at least ten times less often */
+static TKey_BOOL tkey_rssi_ranging_check_hysteresis(TKey_VOID)
+{
+    const TKey_RssiCalib_t sCalib = TKEY_RSSI_CALIB_DEFAULT;
+    TKey_RssiApproach_t sApproach;
+    TKey_HANDLE hKey = tkey_rssi_ranging_check_start();
+    TKey_UINT32 uiCrossings = 0;
+    TKey_BOOL bNear = TKey_FALSE;
+    TKey_UINT32 uiMs;
+
+    for(uiMs = 0; uiMs < 20 * TKEY_RSSI_RANGING_CHECK_SETTLE_MS;
+        uiMs += TKEY_RSSI_RANGING_CHECK_EVENT_MS) {
+        if(E_TKEY_RSSI_SUCCESS != TKey_RssiRanging_AddSample(hKey, TKEY_RSSI_ANCHOR_LOCAL,
+                tkey_rssi_ranging_check_rssi(&sCalib, TKEY_RSSI_NEAR_MM), uiMs) ||
+           E_TKEY_RSSI_SUCCESS != TKey_RssiRanging_GetEstimate(hKey, &sApproach)) {
+            return TKey_FALSE;
+        }
+        if(uiMs > TKEY_RSSI_RANGING_CHECK_SETTLE_MS &&
+           bNear != (sApproach.uiRangeMm <= TKEY_RSSI_NEAR_MM)) {
+            uiCrossings++;
+        }
+        bNear = (sApproach.uiRangeMm <= TKEY_RSSI_NEAR_MM);
+    }
+    return (20 <= uiCrossings) && (10 * gsSeen.uiConfidenceChanges <= uiCrossings) &&
+           (0 == gsSeen.uiTrendChanges);
+}
+
+/* Two anchors with their own path loss models: the fused range leans to
+ * the nearer, both are reported, and the one no longer heard is dropped
+ * after TKEY_RSSI_STALE_MS */
+static TKey_BOOL tkey_rssi_ranging_check_fusion(TKey_VOID)
+{
+    const TKey_RssiCalib_t sLocal = TKEY_RSSI_CALIB_DEFAULT;
+    const TKey_RssiCalib_t sAnchor2 = { -65, 25, 4 };
+    TKey_RssiApproach_t sApproach;
+    TKey_HANDLE hKey;
+    TKey_UINT32 uiMs;
+    TKey_BOOL bPassed;
+
+    if(E_TKEY_RSSI_SUCCESS != TKey_RssiRanging_SetAnchor(TKEY_RSSI_RANGING_CHECK_ANCHOR2,
+                                                         &sAnchor2)) {
+        return TKey_FALSE;
+    }
+    hKey = tkey_rssi_ranging_check_start();
+    for(uiMs = 0; uiMs < TKEY_RSSI_RANGING_CHECK_SETTLE_MS;
+        uiMs += TKEY_RSSI_RANGING_CHECK_EVENT_MS) {
+        (void)TKey_RssiRanging_AddSample(hKey, TKEY_RSSI_ANCHOR_LOCAL,
+                                         tkey_rssi_ranging_check_rssi(&sLocal, 2000), uiMs);
+        (void)TKey_RssiRanging_AddSample(hKey, TKEY_RSSI_RANGING_CHECK_ANCHOR2,
+                                         tkey_rssi_ranging_check_rssi(&sAnchor2, 8000),
+                                         uiMs + 1);
+    }
+    /* 1/r^2 weights: (2 * 16 + 8) / 17 m */
+    bPassed = (E_TKEY_RSSI_SUCCESS == TKey_RssiRanging_GetEstimate(hKey, &sApproach)) &&
+              (2 == sApproach.uiAnchorsUsed) && (sApproach.uiRangeMm > 2000) &&
+              (sApproach.uiRangeMm < 3000) && (2 == gsSeen.uiNumAnchors) &&
+              (TKEY_RSSI_ANCHOR_LOCAL == gsSeen.auiAnchorID[0]) &&
+              (TKEY_RSSI_RANGING_CHECK_ANCHOR2 == gsSeen.auiAnchorID[1]);
+
+    /* The second anchor goes silent */
+    for(; uiMs < 3 * TKEY_RSSI_RANGING_CHECK_SETTLE_MS;
+        uiMs += TKEY_RSSI_RANGING_CHECK_EVENT_MS) {
+        (void)TKey_RssiRanging_AddSample(hKey, TKEY_RSSI_ANCHOR_LOCAL,
+                                         tkey_rssi_ranging_check_rssi(&sLocal, 2000), uiMs);
+    }
+    return bPassed && (E_TKEY_RSSI_SUCCESS == TKey_RssiRanging_GetEstimate(hKey, &sApproach)) &&
+           (1 == sApproach.uiAnchorsUsed) && (4 * sApproach.uiRangeMm >= 3 * 2000) &&
+           (4 * sApproach.uiRangeMm <= 5 * 2000) && (1 == gsSeen.uiNumAnchors);
+}
+
+#if defined(THINKEY_RSSI_RANGING_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiFailed = 0;
+
+    (void)argc;
+    (void)argv;
+    (void)TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_RANGING, THINKEY_DEBUG_LEVEL_NONE);
+    if(E_TKEY_RSSI_SUCCESS != TKey_RssiRanging_Init(tkey_rssi_ranging_check_cb) ||
+       E_TKEY_RSSI_SUCCESS != TKey_RssiRanging_SetAnchor(TKEY_RSSI_ANCHOR_LOCAL, TKey_NULL)) {
+        printf("rssi_ranging_check: setup failed\r\n");
+        return 1;
+    }
+
+    tkey_rssi_ranging_check_result("standing range",
+                                   tkey_rssi_ranging_check_standing(), &uiFailed);
+    tkey_rssi_ranging_check_result("walk up", tkey_rssi_ranging_check_walk_up(),
+                                   &uiFailed);
+    tkey_rssi_ranging_check_result("walk away", tkey_rssi_ranging_check_walk_away(),
+                                   &uiFailed);
+    tkey_rssi_ranging_check_result("threshold hysteresis",
+                                   tkey_rssi_ranging_check_hysteresis(), &uiFailed);
+    tkey_rssi_ranging_check_result("anchor fusion", tkey_rssi_ranging_check_fusion(),
+                                   &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_RSSI_RANGING_CHECK_MAIN */
@@ -0,0 +1,233 @@
+/*
+ * \file thinkey_flash_sim.c
+ *
+ * \brief Host NOR flash simulator
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_flash_sim.h"
+#include <string.h>
+#include <unistd.h>
+
+#define TKEY_FLASH_SIM_MIN_ERASE_SIZE 64
+
+typedef struct
+{
+    TKey_FlashDev_t sDev;
+    TKey_UINT32 uiArmedOps;
+    TKey_FlashSimFault_t eArmedFault;
+    TKey_BOOL bPowerLost;
+    TKey_VOID (*pfBusyHook)(TKey_VOID);
+    TKey_UINT32 uiProgramUs;
+    TKey_UINT32 uiEraseUs;
+    TKey_FlashSimCounters_t sCounters;
+    TKey_UINT32 auiEraseCount[TKEY_FLASH_SIM_MAX_SIZE /
+                              TKEY_FLASH_SIM_MIN_ERASE_SIZE];
+    TKey_BYTE aucMem[TKEY_FLASH_SIM_MAX_SIZE];
+} TKey_FlashSim_t;
+
+static TKey_FlashSim_t gsFlashSim;
+
+static TKey_BOOL tkey_flash_sim_range_ok(TKey_UINT32 uiOffset, TKey_UINT32 uiLen,
+                                         TKey_UINT32 uiUnit)
+{
+    return (uiOffset + uiLen <= gsFlashSim.sDev.uiSize &&
+            uiOffset + uiLen >= uiOffset &&
+            0 == (uiOffset % uiUnit) && 0 == (uiLen % uiUnit));
+}
+
+/* Returns the fault hitting this program or erase, if any */
+static TKey_FlashSimFault_t tkey_flash_sim_fault(TKey_VOID)
+{
+    TKey_FlashSimFault_t eFault;
+
+    if(E_TKEY_FLASH_SIM_FAULT_NONE == gsFlashSim.eArmedFault) {
+        return E_TKEY_FLASH_SIM_FAULT_NONE;
+    }
+    if(0 != gsFlashSim.uiArmedOps) {
+        gsFlashSim.uiArmedOps--;
+        return E_TKEY_FLASH_SIM_FAULT_NONE;
+    }
+    eFault = gsFlashSim.eArmedFault;
+    gsFlashSim.eArmedFault = E_TKEY_FLASH_SIM_FAULT_NONE;
+    if(E_TKEY_FLASH_SIM_FAULT_POWER_CUT == eFault) {
+        gsFlashSim.bPowerLost = TKey_TRUE;
+    }
+    return eFault;
+}
+
+static TKey_StatusType tkey_flash_sim_read(TKey_VOID *pvCtx, TKey_UINT32 uiOffset,
+                                           TKey_BYTE *pucBuf, TKey_UINT32 uiLen)
+{
+    (TKey_VOID)pvCtx;
+    if(gsFlashSim.bPowerLost || !tkey_flash_sim_range_ok(uiOffset, uiLen, 1)) {
+        return E_TKEY_FAILURE;
+    }
+    gsFlashSim.sCounters.uiReads++;
+    memcpy(pucBuf, &gsFlashSim.aucMem[uiOffset], uiLen);
+    return E_TKEY_SUCCESS;
+}
+
+static TKey_StatusType tkey_flash_sim_program(TKey_VOID *pvCtx,
+        TKey_UINT32 uiOffset, const TKey_BYTE *pucBuf, TKey_UINT32 uiLen)
+{
+    TKey_FlashSimFault_t eFault;
+    TKey_UINT32 uiIndex;
+
+    (TKey_VOID)pvCtx;
+    if(gsFlashSim.bPowerLost ||
+       !tkey_flash_sim_range_ok(uiOffset, uiLen, gsFlashSim.sDev.uiWriteSize)) {
+        return E_TKEY_FAILURE;
+    }
+    eFault = tkey_flash_sim_fault();
+    if(E_TKEY_FLASH_SIM_FAULT_FAIL == eFault) {
+        return E_TKEY_FAILURE;
+    }
+    if(E_TKEY_FLASH_SIM_FAULT_POWER_CUT == eFault) {
+        /* Only the first half of the program units made it */
+        uiLen = (uiLen / gsFlashSim.sDev.uiWriteSize / 2) *
+                gsFlashSim.sDev.uiWriteSize;
+    }
+    gsFlashSim.sCounters.uiPrograms++;
+    if(0 != gsFlashSim.uiProgramUs) {
+        usleep(gsFlashSim.uiProgramUs * (uiLen / gsFlashSim.sDev.uiWriteSize));
+    }
+    for(uiIndex = 0; uiIndex < uiLen; uiIndex++) {
+        if(uiIndex == uiLen / 2 && TKey_NULL != gsFlashSim.pfBusyHook) {
+            gsFlashSim.pfBusyHook();
+        }
+        if(0xFF != gsFlashSim.aucMem[uiOffset + uiIndex]) {
+            gsFlashSim.sCounters.uiOverwrites++;
+        }
+        gsFlashSim.aucMem[uiOffset + uiIndex] &= pucBuf[uiIndex];
+    }
+    return (E_TKEY_FLASH_SIM_FAULT_NONE == eFault) ? E_TKEY_SUCCESS :
+           E_TKEY_FAILURE;
+}
+
+static TKey_StatusType tkey_flash_sim_erase(TKey_VOID *pvCtx,
+        TKey_UINT32 uiOffset, TKey_UINT32 uiLen)
+{
+    TKey_FlashSimFault_t eFault;
+    TKey_UINT32 uiUnit = gsFlashSim.sDev.uiEraseSize;
+    TKey_UINT32 uiDone;
+
+    (TKey_VOID)pvCtx;
+    if(gsFlashSim.bPowerLost || !tkey_flash_sim_range_ok(uiOffset, uiLen, uiUnit)) {
+        return E_TKEY_FAILURE;
+    }
+    eFault = tkey_flash_sim_fault();
+    if(E_TKEY_FLASH_SIM_FAULT_FAIL == eFault) {
+        return E_TKEY_FAILURE;
+    }
+    if(0 != gsFlashSim.uiEraseUs) {
+        usleep(gsFlashSim.uiEraseUs * (uiLen / uiUnit));
+    }
+    for(uiDone = 0; uiDone < uiLen; uiDone += uiUnit) {
+        if(uiDone == uiLen / 2 && TKey_NULL != gsFlashSim.pfBusyHook) {
+            gsFlashSim.pfBusyHook();
+        }
+        if(E_TKEY_FLASH_SIM_FAULT_POWER_CUT == eFault && uiDone >= uiLen / 2) {
+            /* The unit being erased when power went is left half erased */
+            memset(&gsFlashSim.aucMem[uiOffset + uiDone], 0xFF, uiUnit / 2);
+            return E_TKEY_FAILURE;
+        }
+        memset(&gsFlashSim.aucMem[uiOffset + uiDone], 0xFF, uiUnit);
+        gsFlashSim.auiEraseCount[(uiOffset + uiDone) / uiUnit]++;
+        gsFlashSim.sCounters.uiErases++;
+    }
+    return E_TKEY_SUCCESS;
+}
+
+static TKey_StatusType tkey_flash_sim_blank_check(TKey_VOID *pvCtx,
+        TKey_UINT32 uiOffset, TKey_UINT32 uiLen, TKey_BOOL *pbBlank)
+{
+    TKey_UINT32 uiIndex;
+
+    (TKey_VOID)pvCtx;
+    if(gsFlashSim.bPowerLost || !tkey_flash_sim_range_ok(uiOffset, uiLen, 1)) {
+        return E_TKEY_FAILURE;
+    }
+    *pbBlank = TKey_TRUE;
+    for(uiIndex = 0; uiIndex < uiLen; uiIndex++) {
+        if(0xFF != gsFlashSim.aucMem[uiOffset + uiIndex]) {
+            *pbBlank = TKey_FALSE;
+            break;
+        }
+    }
+    return E_TKEY_SUCCESS;
+}
+
+const TKey_FlashDev_t* TKey_FlashSim_Init(TKey_UINT32 uiSize,
+        TKey_UINT32 uiEraseSize, TKey_UINT32 uiWriteSize,
+        TKey_BOOL bBlankCheck)
+{
+    if(uiSize > TKEY_FLASH_SIM_MAX_SIZE ||
+       uiEraseSize < TKEY_FLASH_SIM_MIN_ERASE_SIZE ||
+       0 == uiWriteSize || 0 != (uiSize % uiEraseSize) ||
+       0 != (uiEraseSize % uiWriteSize)) {
+        return TKey_NULL;
+    }
+    memset(&gsFlashSim, 0, sizeof(gsFlashSim));
+    memset(gsFlashSim.aucMem, 0xFF, sizeof(gsFlashSim.aucMem));
+    gsFlashSim.sDev.pcName = "sim-flash";
+    gsFlashSim.sDev.uiSize = uiSize;
+    gsFlashSim.sDev.uiEraseSize = uiEraseSize;
+    gsFlashSim.sDev.uiWriteSize = uiWriteSize;
+    gsFlashSim.sDev.pvCtx = TKey_NULL;
+    gsFlashSim.sDev.pucMapped = gsFlashSim.aucMem;
+    gsFlashSim.sDev.eRead = tkey_flash_sim_read;
+    gsFlashSim.sDev.eProgram = tkey_flash_sim_program;
+    gsFlashSim.sDev.eErase = tkey_flash_sim_erase;
+    gsFlashSim.sDev.eBlankCheck = bBlankCheck ? tkey_flash_sim_blank_check :
+                                  TKey_NULL;
+    return &gsFlashSim.sDev;
+}
+
+TKey_VOID TKey_FlashSim_FailAfter(TKey_UINT32 uiOps, TKey_FlashSimFault_t eFault)
+{
+    gsFlashSim.uiArmedOps = uiOps;
+    gsFlashSim.eArmedFault = eFault;
+}
+
+TKey_VOID TKey_FlashSim_SetTiming(TKey_UINT32 uiProgramUs, TKey_UINT32 uiEraseUs)
+{
+    gsFlashSim.uiProgramUs = uiProgramUs;
+    gsFlashSim.uiEraseUs = uiEraseUs;
+}
+
+TKey_VOID TKey_FlashSim_SetBusyHook(TKey_VOID (*pfHook)(TKey_VOID))
+{
+    gsFlashSim.pfBusyHook = pfHook;
+}
+
+TKey_VOID TKey_FlashSim_PowerCycle(TKey_VOID)
+{
+    gsFlashSim.bPowerLost = TKey_FALSE;
+    gsFlashSim.eArmedFault = E_TKEY_FLASH_SIM_FAULT_NONE;
+}
+
+TKey_VOID TKey_FlashSim_GetCounters(TKey_FlashSimCounters_t *psCounters)
+{
+    TKey_UINT32 uiUnits = gsFlashSim.sDev.uiSize / gsFlashSim.sDev.uiEraseSize;
+    TKey_UINT32 uiUnit;
+
+    gsFlashSim.sCounters.uiMinEraseCount = 0xFFFFFFFF;
+    gsFlashSim.sCounters.uiMaxEraseCount = 0;
+    for(uiUnit = 0; uiUnit < uiUnits; uiUnit++) {
+        if(gsFlashSim.auiEraseCount[uiUnit] < gsFlashSim.sCounters.uiMinEraseCount) {
+            gsFlashSim.sCounters.uiMinEraseCount = gsFlashSim.auiEraseCount[uiUnit];
+        }
+        if(gsFlashSim.auiEraseCount[uiUnit] > gsFlashSim.sCounters.uiMaxEraseCount) {
+            gsFlashSim.sCounters.uiMaxEraseCount = gsFlashSim.auiEraseCount[uiUnit];
+        }
+    }
+    *psCounters = gsFlashSim.sCounters;
+}
+
+TKey_BYTE* TKey_FlashSim_Memory(TKey_VOID)
+{
+    return gsFlashSim.aucMem;
+}
@@ -0,0 +1,93 @@
+/*
+ * \file thinkey_flash_sim.h
+ *
+ * \brief Host NOR flash simulator
+ *
+ * A RAM backed TKey_FlashDev_t with NOR semantics: erase sets an erase
+ * unit to 0xFF, programming can only clear bits. The image is memory
+ * mapped for reads like the RA data flash. A hook can run half way through
+ * every program and erase, standing in for a task that preempts the flash
+ * operation. A fault can be armed to cut power in the middle of a later
+ * operation, leaving a partly written or partly erased area, to exercise
+ * the recovery of flash users. Host builds only (THINKEY_HOST_BUILD); not
+ * part of the firmware image.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_FLASH_SIM_H
+#define THINKEY_FLASH_SIM_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_flash_al.h"
+
+#define TKEY_FLASH_SIM_MAX_SIZE 0x10000
+
+/**
+ *  @brief Simulated faults
+ */
+typedef enum
+{
+    E_TKEY_FLASH_SIM_FAULT_NONE,
+    E_TKEY_FLASH_SIM_FAULT_POWER_CUT,   /* cuts the operation half way */
+    E_TKEY_FLASH_SIM_FAULT_FAIL         /* fails without touching flash */
+} TKey_FlashSimFault_t;
+
+/**
+ *  @brief Simulator counters
+ */
+typedef struct
+{
+    TKey_UINT32 uiReads;
+    TKey_UINT32 uiPrograms;
+    TKey_UINT32 uiErases;
+    TKey_UINT32 uiOverwrites;       /* programs over bytes not erased */
+    TKey_UINT32 uiMinEraseCount;    /* per erase unit */
+    TKey_UINT32 uiMaxEraseCount;
+} TKey_FlashSimCounters_t;
+
+/**
+ * \brief   Resets the simulated device to uiSize bytes of erased flash
+ *          and returns it. bBlankCheck selects whether the device offers
+ *          eBlankCheck, as the RA data flash does.
+ */
+const TKey_FlashDev_t* TKey_FlashSim_Init(TKey_UINT32 uiSize,
+        TKey_UINT32 uiEraseSize, TKey_UINT32 uiWriteSize,
+        TKey_BOOL bBlankCheck);
+
+/**
+ * \brief   Arms a fault on the uiOps-th program or erase from now (0 is
+ *          the next one). After a power cut every operation fails until
+ *          TKey_FlashSim_PowerCycle().
+ */
+TKey_VOID TKey_FlashSim_FailAfter(TKey_UINT32 uiOps, TKey_FlashSimFault_t eFault);
+
+/**
+ * \brief   Makes programs and erases take time: uiProgramUs per program
+ *          unit and uiEraseUs per erase unit (RA6M5 data flash: about 50 us
+ *          per 4 bytes, 400 us per 64 byte block)
+ */
+TKey_VOID TKey_FlashSim_SetTiming(TKey_UINT32 uiProgramUs, TKey_UINT32 uiEraseUs);
+
+/**
+ * \brief   Sets a function called half way through every program and
+ *          erase, TKey_NULL to remove it
+ */
+TKey_VOID TKey_FlashSim_SetBusyHook(TKey_VOID (*pfHook)(TKey_VOID));
+
+/**
+ * \brief   Restores power and disarms any pending fault; contents are kept
+ */
+TKey_VOID TKey_FlashSim_PowerCycle(TKey_VOID);
+
+/**
+ * \brief   Returns the simulator counters
+ */
+TKey_VOID TKey_FlashSim_GetCounters(TKey_FlashSimCounters_t *psCounters);
+
+/**
+ * \brief   Returns the simulated flash contents
+ */
+TKey_BYTE* TKey_FlashSim_Memory(TKey_VOID);
+
+#endif /* THINKEY_FLASH_SIM_H */
@@ -0,0 +1,236 @@
+/*
+ * \file thinkey_keystore_bench.c
+ *
+ * \brief Key store lookup benchmark on the flash simulator
+ *
+ * Fills the key store with TKEY_KEYSTORE_MAX_KEYS keys on flash_sim,
+ * reloads it from the flash, and times lookups by key ID and by public
+ * key, hits and misses, checking every result. Built for 256 keys: the
+ * program compiles its own copy of the object store and key store with
+ * the larger configuration (host/CMakeLists.txt). Host builds only; built
+ * with THINKEY_KEYSTORE_BENCH_MAIN it is a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_flash_sim.h"
+#include "thinkey_objstore_async.h"
+#include "thinkey_keystore.h"
+#include "thinkey_bench.h"
+#include "thinkey_debug.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_KEYSTORE_BENCH_LOADS 4
+#define TKEY_KEYSTORE_BENCH_ROUNDS 16
+
+typedef enum
+{
+    E_TKEY_KEYSTORE_BENCH_LOAD,
+    E_TKEY_KEYSTORE_BENCH_FIND_ID,
+    E_TKEY_KEYSTORE_BENCH_FIND_KEY,
+    E_TKEY_KEYSTORE_BENCH_MISS_ID,
+    E_TKEY_KEYSTORE_BENCH_MISS_KEY,
+    E_TKEY_KEYSTORE_BENCH_CASES
+} TKey_KeyStoreBenchCase_t;
+
+static TKey_ObjStore_t gsBenchStore;
+
+static TKey_UINT32 tkey_keystore_bench_key_id(TKey_UINT32 uiKey)
+{
+    /* Odd multiplier: distinct IDs, added out of order */
+    return (uiKey + 1) * 2654435761u;
+}
+
+static TKey_VOID tkey_keystore_bench_public_key(TKey_UINT32 uiKey,
+                                                TKey_BYTE *pucKey)
+{
+    TKey_UINT32 uiRandom = 0x9E3779B9u ^ (uiKey * 0x85EBCA6Bu);
+    TKey_UINT32 uiIndex;
+
+    pucKey[0] = 0x04;
+    for(uiIndex = 1; uiIndex < TKEY_KEYSTORE_PUBLIC_KEY_SIZE; uiIndex++) {
+        uiRandom ^= uiRandom << 13;
+        uiRandom ^= uiRandom >> 17;
+        uiRandom ^= uiRandom << 5;
+        pucKey[uiIndex] = (TKey_BYTE)uiRandom;
+    }
+    /* Keys differ in their last bytes at least */
+    pucKey[TKEY_KEYSTORE_PUBLIC_KEY_SIZE - 2] = (TKey_BYTE)(uiKey >> 8);
+    pucKey[TKEY_KEYSTORE_PUBLIC_KEY_SIZE - 1] = (TKey_BYTE)uiKey;
+}
+
+static TKey_INT32 tkey_keystore_bench_fill(TKey_VOID)
+{
+    TKey_KeyRecord_t sRecord;
+    TKey_UINT32 uiKey;
+
+    for(uiKey = 0; uiKey < TKEY_KEYSTORE_MAX_KEYS; uiKey++) {
+        memset(&sRecord, 0, sizeof(sRecord));
+        sRecord.uiKeyId = tkey_keystore_bench_key_id(uiKey);
+        sRecord.uiEntitlements = TKEY_KEY_ENT_UNLOCK | TKEY_KEY_ENT_LOCK;
+        sRecord.uiNotBefore = TKEY_KEY_NOT_BEFORE_ANY;
+        sRecord.uiNotAfter = TKEY_KEY_NOT_AFTER_ANY;
+        sRecord.ucRole = (0 == uiKey) ? E_TKEY_KEY_ROLE_OWNER : E_TKEY_KEY_ROLE_FRIEND;
+        tkey_keystore_bench_public_key(uiKey, sRecord.aucPublicKey);
+        if(E_TKEY_KEYSTORE_SUCCESS != TKey_KeyStore_Add(&sRecord)) {
+            return 1;
+        }
+    }
+    /* One more does not fit */
+    sRecord.uiKeyId = 0;
+    tkey_keystore_bench_public_key(TKEY_KEYSTORE_MAX_KEYS, sRecord.aucPublicKey);
+    return (E_TKEY_KEYSTORE_FULL == TKey_KeyStore_Add(&sRecord)) ? 0 : 1;
+}
+
+/* Remounts the flash and loads the key store from it */
+static TKey_INT32 tkey_keystore_bench_load(TKey_BenchResult_t *psRes,
+                                           const TKey_FlashDev_t *psDev)
+{
+    TKey_KeyRecord_t sPrev;
+    TKey_KeyRecord_t sRecord;
+    TKey_UINT64 ullStart;
+    TKey_UINT32 uiIndex;
+
+    memset(&gsBenchStore, 0, sizeof(gsBenchStore));
+    if(E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Mount(&gsBenchStore, psDev) ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStoreAsync_Init(&gsBenchStore)) {
+        return 1;
+    }
+    ullStart = TKey_Bench_Now();
+    if(E_TKEY_KEYSTORE_SUCCESS != TKey_KeyStore_Init()) {
+        return 1;
+    }
+    TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+    if(TKEY_KEYSTORE_MAX_KEYS != TKey_KeyStore_GetCount()) {
+        return 1;
+    }
+    /* Enumerated in key ID order */
+    for(uiIndex = 0; uiIndex < TKEY_KEYSTORE_MAX_KEYS; uiIndex++) {
+        if(E_TKEY_KEYSTORE_SUCCESS != TKey_KeyStore_GetByIndex(uiIndex, &sRecord) ||
+           (0 != uiIndex && sRecord.uiKeyId <= sPrev.uiKeyId)) {
+            return 1;
+        }
+        sPrev = sRecord;
+    }
+    return 0;
+}
+
+static TKey_INT32 tkey_keystore_bench_find(TKey_BenchResult_t *psResults)
+{
+    TKey_BYTE aucKey[TKEY_KEYSTORE_PUBLIC_KEY_SIZE];
+    TKey_KeyRecord_t sRecord;
+    TKey_UINT64 ullStart;
+    TKey_KeyStoreStatus_t eStatus;
+    TKey_UINT32 uiRound;
+    TKey_UINT32 uiKey;
+    TKey_UINT32 uiKeyId;
+    TKey_INT32 iStatus = 0;
+
+    for(uiRound = 0; uiRound < TKEY_KEYSTORE_BENCH_ROUNDS; uiRound++) {
+        for(uiKey = 0; uiKey < TKEY_KEYSTORE_MAX_KEYS; uiKey++) {
+            uiKeyId = tkey_keystore_bench_key_id(uiKey);
+            tkey_keystore_bench_public_key(uiKey, aucKey);
+
+            ullStart = TKey_Bench_Now();
+            eStatus = TKey_KeyStore_FindById(uiKeyId, &sRecord);
+            TKey_Bench_Record(&psResults[E_TKEY_KEYSTORE_BENCH_FIND_ID], ullStart,
+                              TKey_Bench_Now());
+            if(E_TKEY_KEYSTORE_SUCCESS != eStatus || uiKeyId != sRecord.uiKeyId ||
+               0 != memcmp(aucKey, sRecord.aucPublicKey, sizeof(aucKey))) {
+                psResults[E_TKEY_KEYSTORE_BENCH_FIND_ID].iStatus = 1;
+            }
+
+            ullStart = TKey_Bench_Now();
+            eStatus = TKey_KeyStore_FindByPublicKey(aucKey, &sRecord);
+            TKey_Bench_Record(&psResults[E_TKEY_KEYSTORE_BENCH_FIND_KEY], ullStart,
+                              TKey_Bench_Now());
+            if(E_TKEY_KEYSTORE_SUCCESS != eStatus || uiKeyId != sRecord.uiKeyId) {
+                psResults[E_TKEY_KEYSTORE_BENCH_FIND_KEY].iStatus = 1;
+            }
+
+            /* Misses: an ID between two stored ones, a key off by a bit */
+            ullStart = TKey_Bench_Now();
+            eStatus = TKey_KeyStore_FindById(uiKeyId + 1, &sRecord);
+            TKey_Bench_Record(&psResults[E_TKEY_KEYSTORE_BENCH_MISS_ID], ullStart,
+                              TKey_Bench_Now());
+            if(E_TKEY_KEYSTORE_NOT_FOUND != eStatus) {
+                psResults[E_TKEY_KEYSTORE_BENCH_MISS_ID].iStatus = 1;
+            }
+
+            aucKey[1 + uiKey % (TKEY_KEYSTORE_PUBLIC_KEY_SIZE - 3)] ^= 0x01;
+            ullStart = TKey_Bench_Now();
+            eStatus = TKey_KeyStore_FindByPublicKey(aucKey, &sRecord);
+            TKey_Bench_Record(&psResults[E_TKEY_KEYSTORE_BENCH_MISS_KEY], ullStart,
+                              TKey_Bench_Now());
+            if(E_TKEY_KEYSTORE_NOT_FOUND != eStatus) {
+                psResults[E_TKEY_KEYSTORE_BENCH_MISS_KEY].iStatus = 1;
+            }
+        }
+    }
+    for(uiKey = 0; uiKey < E_TKEY_KEYSTORE_BENCH_CASES; uiKey++) {
+        iStatus |= psResults[uiKey].iStatus;
+    }
+    return iStatus;
+}
+
+static TKey_INT32 tkey_keystore_bench_run(TKey_BenchResult_t *psResults)
+{
+    static const TKey_CHAR *const apcNames[E_TKEY_KEYSTORE_BENCH_CASES] = {
+        "load", "find_by_id", "find_by_public_key", "miss_by_id",
+        "miss_by_public_key"
+    };
+    const TKey_FlashDev_t *psDev;
+    TKey_UINT32 uiCase;
+    TKey_UINT32 uiLoad;
+
+    for(uiCase = 0; uiCase < E_TKEY_KEYSTORE_BENCH_CASES; uiCase++) {
+        memset(&psResults[uiCase], 0, sizeof(TKey_BenchResult_t));
+        psResults[uiCase].pcSuite = "keystore";
+        psResults[uiCase].pcName = apcNames[uiCase];
+        psResults[uiCase].uiBytes = (E_TKEY_KEYSTORE_BENCH_LOAD == uiCase) ?
+                                    TKEY_KEYSTORE_MAX_KEYS * sizeof(TKey_KeyRecord_t) : 0;
+    }
+
+    psDev = TKey_FlashSim_Init(TKEY_FLASH_SIM_MAX_SIZE, 64, 4, TKey_TRUE);
+    memset(&gsBenchStore, 0, sizeof(gsBenchStore));
+    if(TKey_NULL == psDev ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Mount(&gsBenchStore, psDev) ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStoreAsync_Init(&gsBenchStore) ||
+       E_TKEY_KEYSTORE_SUCCESS != TKey_KeyStore_Init() ||
+       0 != tkey_keystore_bench_fill()) {
+        return 1;
+    }
+
+    /* Everything comes back from the flash alone */
+    for(uiLoad = 0; uiLoad < TKEY_KEYSTORE_BENCH_LOADS; uiLoad++) {
+        psResults[E_TKEY_KEYSTORE_BENCH_LOAD].iStatus |=
+            tkey_keystore_bench_load(&psResults[E_TKEY_KEYSTORE_BENCH_LOAD], psDev);
+    }
+    return psResults[E_TKEY_KEYSTORE_BENCH_LOAD].iStatus |
+           tkey_keystore_bench_find(psResults);
+}
+
+#if defined(THINKEY_KEYSTORE_BENCH_MAIN)
+static TKey_VOID tkey_keystore_bench_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    TKey_BenchResult_t asResults[E_TKEY_KEYSTORE_BENCH_CASES];
+    TKey_INT32 iFailed;
+
+    (void)argc;
+    (void)argv;
+    (void)TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_STORAGE, THINKEY_DEBUG_LEVEL_ERROR);
+    TKey_Bench_TimerInit();
+    iFailed = tkey_keystore_bench_run(asResults);
+    TKey_Bench_PrintHeader(tkey_keystore_bench_print);
+    TKey_Bench_PrintResults(tkey_keystore_bench_print, asResults,
+                            E_TKEY_KEYSTORE_BENCH_CASES);
+    return (0 == iFailed) ? 0 : 1;
+}
+#endif /* THINKEY_KEYSTORE_BENCH_MAIN */
@@ -0,0 +1,204 @@
+/*
+ * \file thinkey_objstore_async_bench.c
+ *
+ * \brief Write-behind latency benchmark on the flash simulator
+ *
+ * Times TKey_ObjStoreAsync_Write() as the caller sees it, first before the
+ * worker is started, when it programs the flash in the calling task, then
+ * with the worker, when it only queues the write. The flash simulator
+ * takes RA6M5 data flash program and erase times. Each round of queued
+ * writes is flushed and the flush timed too, so the time the data takes
+ * to reach the flash is reported alongside. Host builds only; built with
+ * THINKEY_OBJSTORE_ASYNC_BENCH_MAIN it is a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_flash_sim.h"
+#include "thinkey_objstore_async.h"
+#include "thinkey_bench.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_OBJSTORE_ASYNC_BENCH_PAGES 16
+#define TKEY_OBJSTORE_ASYNC_BENCH_ROUNDS 8
+#define TKEY_OBJSTORE_ASYNC_BENCH_SIZE 64
+#define TKEY_OBJSTORE_ASYNC_BENCH_FLUSH_MS 5000
+#define TKEY_OBJSTORE_ASYNC_BENCH_PROGRAM_US 50     /* per 4 bytes */
+#define TKEY_OBJSTORE_ASYNC_BENCH_ERASE_US 400      /* per 64 bytes */
+/* Queued writes must cost the caller less than this share of a
+ * synchronous write */
+#define TKEY_OBJSTORE_ASYNC_BENCH_MAX_RATIO 4
+
+typedef enum
+{
+    E_TKEY_OBJSTORE_ASYNC_BENCH_SYNC,
+    E_TKEY_OBJSTORE_ASYNC_BENCH_ASYNC,
+    E_TKEY_OBJSTORE_ASYNC_BENCH_FLUSH,
+    E_TKEY_OBJSTORE_ASYNC_BENCH_CASES
+} TKey_ObjStoreAsyncBenchCase_t;
+
+static TKey_ObjStore_t gsBenchStore;
+static TKey_BYTE gaucBenchData[TKEY_OBJSTORE_ASYNC_SLOTS][TKEY_OBJSTORE_ASYNC_BENCH_SIZE];
+
+static TKey_VOID tkey_objstore_async_bench_fill(TKey_UINT32 uiRound)
+{
+    TKey_UINT32 uiSlot;
+    TKey_UINT32 uiIndex;
+
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_ASYNC_SLOTS; uiSlot++) {
+        for(uiIndex = 0; uiIndex < TKEY_OBJSTORE_ASYNC_BENCH_SIZE; uiIndex++) {
+            gaucBenchData[uiSlot][uiIndex] = (TKey_BYTE)(uiRound * 31 + uiSlot * 7 +
+                                                         uiIndex);
+        }
+    }
+}
+
+/* One round: a write of each object, timed one by one, then the flush */
+static TKey_INT32 tkey_objstore_async_bench_round(TKey_BenchResult_t *psWrite,
+                                                  TKey_BenchResult_t *psFlush,
+                                                  TKey_UINT32 uiRound)
+{
+    TKey_BYTE aucRead[TKEY_OBJSTORE_ASYNC_BENCH_SIZE];
+    TKey_UINT64 ullStart;
+    TKey_UINT32 uiSlot;
+    TKey_UINT32 uiLen;
+    TKey_INT32 iStatus = 0;
+
+    tkey_objstore_async_bench_fill(uiRound);
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_ASYNC_SLOTS; uiSlot++) {
+        ullStart = TKey_Bench_Now();
+        if(E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStoreAsync_Write(
+                                          (TKey_UINT16)(uiSlot + 1),
+                                          gaucBenchData[uiSlot],
+                                          TKEY_OBJSTORE_ASYNC_BENCH_SIZE,
+                                          TKey_NULL, TKey_NULL)) {
+            iStatus = 1;
+        }
+        TKey_Bench_Record(psWrite, ullStart, TKey_Bench_Now());
+    }
+
+    ullStart = TKey_Bench_Now();
+    if(E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStoreAsync_Flush(
+                                      TKEY_OBJSTORE_ASYNC_BENCH_FLUSH_MS)) {
+        iStatus = 1;
+    }
+    if(TKey_NULL != psFlush) {
+        TKey_Bench_Record(psFlush, ullStart, TKey_Bench_Now());
+    }
+
+    /* Everything reached the flash */
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_ASYNC_SLOTS; uiSlot++) {
+        if(E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Read(&gsBenchStore,
+                                          (TKey_UINT16)(uiSlot + 1), aucRead,
+                                          sizeof(aucRead), &uiLen) ||
+           sizeof(aucRead) != uiLen ||
+           0 != memcmp(aucRead, gaucBenchData[uiSlot], uiLen)) {
+            iStatus = 1;
+        }
+    }
+    return iStatus;
+}
+
+static TKey_INT32 tkey_objstore_async_bench_run(TKey_BenchResult_t *psResults)
+{
+    static const TKey_CHAR *const apcNames[E_TKEY_OBJSTORE_ASYNC_BENCH_CASES] = {
+        "sync_write", "async_write", "async_flush"
+    };
+    const TKey_FlashDev_t *psDev;
+    TKey_ObjStoreAsyncStats_t sStats;
+    TKey_UINT32 uiCase;
+    TKey_UINT32 uiRound;
+
+    for(uiCase = 0; uiCase < E_TKEY_OBJSTORE_ASYNC_BENCH_CASES; uiCase++) {
+        memset(&psResults[uiCase], 0, sizeof(TKey_BenchResult_t));
+        psResults[uiCase].pcSuite = "objstore";
+        psResults[uiCase].pcName = apcNames[uiCase];
+        psResults[uiCase].uiBytes = (E_TKEY_OBJSTORE_ASYNC_BENCH_FLUSH == uiCase) ?
+                                    TKEY_OBJSTORE_ASYNC_SLOTS *
+                                    TKEY_OBJSTORE_ASYNC_BENCH_SIZE :
+                                    TKEY_OBJSTORE_ASYNC_BENCH_SIZE;
+    }
+
+    psDev = TKey_FlashSim_Init(TKEY_OBJSTORE_ASYNC_BENCH_PAGES * TKEY_OBJSTORE_PAGE_SIZE,
+                               64, 4, TKey_TRUE);
+    memset(&gsBenchStore, 0, sizeof(gsBenchStore));
+    if(TKey_NULL == psDev ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Mount(&gsBenchStore, psDev) ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStoreAsync_Init(&gsBenchStore)) {
+        return 1;
+    }
+    TKey_FlashSim_SetTiming(TKEY_OBJSTORE_ASYNC_BENCH_PROGRAM_US,
+                            TKEY_OBJSTORE_ASYNC_BENCH_ERASE_US);
+
+    /* Without the worker the write is programmed in the calling task */
+    for(uiRound = 0; uiRound < TKEY_OBJSTORE_ASYNC_BENCH_ROUNDS; uiRound++) {
+        psResults[E_TKEY_OBJSTORE_ASYNC_BENCH_SYNC].iStatus |=
+            tkey_objstore_async_bench_round(
+                &psResults[E_TKEY_OBJSTORE_ASYNC_BENCH_SYNC], TKey_NULL, uiRound);
+    }
+
+    if(E_TKEY_SUCCESS != TKey_ObjStoreAsync_StartWorker()) {
+        return 1;
+    }
+    for(uiRound = 0; uiRound < TKEY_OBJSTORE_ASYNC_BENCH_ROUNDS; uiRound++) {
+        psResults[E_TKEY_OBJSTORE_ASYNC_BENCH_ASYNC].iStatus |=
+            tkey_objstore_async_bench_round(
+                &psResults[E_TKEY_OBJSTORE_ASYNC_BENCH_ASYNC],
+                &psResults[E_TKEY_OBJSTORE_ASYNC_BENCH_FLUSH],
+                TKEY_OBJSTORE_ASYNC_BENCH_ROUNDS + uiRound);
+    }
+
+    /* Every queued write completed on its own, none was merged */
+    TKey_ObjStoreAsync_GetStats(&sStats);
+    if(sStats.uiQueued != TKEY_OBJSTORE_ASYNC_BENCH_ROUNDS * TKEY_OBJSTORE_ASYNC_SLOTS ||
+       sStats.uiCompleted != sStats.uiQueued || 0 != sStats.uiFailed ||
+       0 != sStats.uiCoalesced || 0 != sStats.uiQueueFull) {
+        psResults[E_TKEY_OBJSTORE_ASYNC_BENCH_ASYNC].iStatus = 1;
+    }
+    return 0;
+}
+
+#if defined(THINKEY_OBJSTORE_ASYNC_BENCH_MAIN)
+static TKey_VOID tkey_objstore_async_bench_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    TKey_BenchResult_t asResults[E_TKEY_OBJSTORE_ASYNC_BENCH_CASES];
+    const TKey_BenchResult_t *psSync = &asResults[E_TKEY_OBJSTORE_ASYNC_BENCH_SYNC];
+    const TKey_BenchResult_t *psAsync = &asResults[E_TKEY_OBJSTORE_ASYNC_BENCH_ASYNC];
+    TKey_UINT32 uiCase;
+    TKey_INT32 iFailed;
+
+    (void)argc;
+    (void)argv;
+    TKey_Bench_TimerInit();
+    iFailed = tkey_objstore_async_bench_run(asResults);
+    if(0 != iFailed) {
+        fputs("objstore_async_bench: setup failed\r\n", stdout);
+        return 1;
+    }
+    TKey_Bench_PrintHeader(tkey_objstore_async_bench_print);
+    TKey_Bench_PrintResults(tkey_objstore_async_bench_print, asResults,
+                            E_TKEY_OBJSTORE_ASYNC_BENCH_CASES);
+    for(uiCase = 0; uiCase < E_TKEY_OBJSTORE_ASYNC_BENCH_CASES; uiCase++) {
+        if(0 != asResults[uiCase].iStatus) {
+            iFailed++;
+        }
+    }
+
+    /* Both ran the same number of writes, so totals compare as means */
+    if(0 == psSync->uiIterations || psAsync->uiIterations != psSync->uiIterations ||
+       psAsync->ullTotalTicks * TKEY_OBJSTORE_ASYNC_BENCH_MAX_RATIO >=
+       psSync->ullTotalTicks) {
+        fputs("objstore_async_bench: queued writes not faster than synchronous\r\n",
+              stdout);
+        iFailed++;
+    }
+    return (0 == iFailed) ? 0 : 1;
+}
+#endif /* THINKEY_OBJSTORE_ASYNC_BENCH_MAIN */
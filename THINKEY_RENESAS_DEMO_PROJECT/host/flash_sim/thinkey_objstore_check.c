@@ -0,0 +1,334 @@
+/*
+ * \file thinkey_objstore_check.c
+ *
+ * \brief Object store check on the flash simulator
+ *
+ * Cuts power at random points of writes, deletes and compactions, and
+ * during the recovery that follows, and checks that every remount brings
+ * back the last committed value of each object, and that views point into
+ * the flash mapping without a copy. Host builds only; built
+ * with THINKEY_OBJSTORE_CHECK_MAIN it is a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_flash_sim.h"
+#include "thinkey_objstore.h"
+#include "thinkey_debug.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_OBJSTORE_CHECK_PAGES 8
+#define TKEY_OBJSTORE_CHECK_ERASE_SIZE 64
+#define TKEY_OBJSTORE_CHECK_WRITE_SIZE 4
+#define TKEY_OBJSTORE_CHECK_OBJECTS 8
+#define TKEY_OBJSTORE_CHECK_MAX_LEN 200
+#define TKEY_OBJSTORE_CHECK_CUTS 400
+#define TKEY_OBJSTORE_CHECK_MAX_OPS 40      /* program/erase ops before a cut */
+#define TKEY_OBJSTORE_CHECK_VIEW_ID 1
+#define TKEY_OBJSTORE_CHECK_PINNED_ID 2
+
+/* What the store is expected to hold */
+typedef struct
+{
+    TKey_UINT32 uiLen;                  /* 0 when deleted or never written */
+    TKey_BYTE aucData[TKEY_OBJSTORE_CHECK_MAX_LEN];
+} TKey_ObjStoreCheckObj_t;
+
+static TKey_ObjStore_t gsCheckStore;
+static TKey_ObjStoreCheckObj_t gasCommitted[TKEY_OBJSTORE_CHECK_OBJECTS];
+static TKey_ObjStoreCheckObj_t gsPending;
+static TKey_UINT32 guiCheckRandom = 0x2545F491;
+static TKey_ObjStoreStatus_t geBusyView;
+static TKey_ObjStoreStatus_t geBusyPinned;
+static TKey_ObjView_t gsBusyPinned;
+
+static TKey_UINT32 tkey_objstore_check_random(TKey_UINT32 uiRange)
+{
+    guiCheckRandom ^= guiCheckRandom << 13;
+    guiCheckRandom ^= guiCheckRandom >> 17;
+    guiCheckRandom ^= guiCheckRandom << 5;
+    return guiCheckRandom % uiRange;
+}
+
+static TKey_VOID tkey_objstore_check_result(const TKey_CHAR *pcCheck,
+                                            TKey_BOOL bPassed,
+                                            TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+static TKey_BOOL tkey_objstore_check_holds(TKey_UINT16 usId,
+                                           const TKey_ObjStoreCheckObj_t *psObj)
+{
+    static TKey_BYTE aucRead[TKEY_OBJSTORE_CHECK_MAX_LEN];
+    TKey_UINT32 uiLen = 0;
+    TKey_ObjStoreStatus_t eStatus;
+
+    eStatus = TKey_ObjStore_Read(&gsCheckStore, usId, aucRead, sizeof(aucRead),
+                                 &uiLen);
+    if(0 == psObj->uiLen) {
+        return (E_TKEY_OBJSTORE_NOT_FOUND == eStatus);
+    }
+    return (E_TKEY_OBJSTORE_SUCCESS == eStatus) && (uiLen == psObj->uiLen) &&
+           (0 == memcmp(aucRead, psObj->aucData, uiLen));
+}
+
+/* Remounts after a power cut, possibly cutting the recovery too. The
+ * object of an interrupted update holds its old or its new value. */
+static TKey_BOOL tkey_objstore_check_recover(const TKey_FlashDev_t *psDev,
+                                             TKey_UINT32 uiPendingId)
+{
+    TKey_ObjStoreStatus_t eStatus;
+    TKey_UINT32 uiId;
+
+    TKey_FlashSim_PowerCycle();
+    if(0 == tkey_objstore_check_random(4)) {
+        TKey_FlashSim_FailAfter(tkey_objstore_check_random(4),
+                                E_TKEY_FLASH_SIM_FAULT_POWER_CUT);
+    }
+    memset(&gsCheckStore, 0, sizeof(gsCheckStore));
+    eStatus = TKey_ObjStore_Mount(&gsCheckStore, psDev);
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+        TKey_FlashSim_PowerCycle();
+        memset(&gsCheckStore, 0, sizeof(gsCheckStore));
+        eStatus = TKey_ObjStore_Mount(&gsCheckStore, psDev);
+    }
+    TKey_FlashSim_PowerCycle();
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+        return TKey_FALSE;
+    }
+
+    for(uiId = 0; uiId < TKEY_OBJSTORE_CHECK_OBJECTS; uiId++) {
+        if(tkey_objstore_check_holds((TKey_UINT16)uiId, &gasCommitted[uiId])) {
+            continue;
+        }
+        if(uiId != uiPendingId ||
+           !tkey_objstore_check_holds((TKey_UINT16)uiId, &gsPending)) {
+            printf("object %lu lost after a cut\r\n", (unsigned long)uiId);
+            return TKey_FALSE;
+        }
+        gasCommitted[uiId] = gsPending;
+    }
+    return TKey_TRUE;
+}
+
+/* Random updates, deletes and compactions until the armed cut hits.
+ * Returns the object of the interrupted update, or
+ * TKEY_OBJSTORE_CHECK_OBJECTS when the cut hit a compaction. */
+static TKey_UINT32 tkey_objstore_check_run(TKey_BOOL *pbPassed)
+{
+    TKey_UINT32 uiId;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiOp;
+    TKey_ObjStoreStatus_t eStatus;
+
+    for(uiOp = 0; uiOp < 10 * TKEY_OBJSTORE_CHECK_MAX_OPS; uiOp++) {
+        uiId = tkey_objstore_check_random(TKEY_OBJSTORE_CHECK_OBJECTS);
+        switch(tkey_objstore_check_random(8)) {
+            case 0:
+                /* A cut compaction shows as a failing later operation */
+                (void)TKey_ObjStore_Compact(&gsCheckStore);
+                continue;
+
+            case 1:
+                if(0 == gasCommitted[uiId].uiLen) {
+                    continue;
+                }
+                gsPending.uiLen = 0;
+                eStatus = TKey_ObjStore_Delete(&gsCheckStore, (TKey_UINT16)uiId);
+                break;
+
+            default:
+                gsPending.uiLen = 1 + tkey_objstore_check_random(
+                                          TKEY_OBJSTORE_CHECK_MAX_LEN);
+                for(uiIndex = 0; uiIndex < gsPending.uiLen; uiIndex++) {
+                    gsPending.aucData[uiIndex] =
+                        (TKey_BYTE)tkey_objstore_check_random(256);
+                }
+                eStatus = TKey_ObjStore_Write(&gsCheckStore, (TKey_UINT16)uiId,
+                                              gsPending.aucData, gsPending.uiLen);
+                break;
+        }
+        if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+            return uiId;
+        }
+        gasCommitted[uiId] = gsPending;
+        /* Committed values read back at once, not only after a cut */
+        if(!tkey_objstore_check_holds((TKey_UINT16)uiId, &gasCommitted[uiId])) {
+            *pbPassed = TKey_FALSE;
+        }
+    }
+    *pbPassed = TKey_FALSE;
+    return TKEY_OBJSTORE_CHECK_OBJECTS;
+}
+
+static TKey_BOOL tkey_objstore_check_power_cut(TKey_UINT32 *puiCuts)
+{
+    const TKey_FlashDev_t *psDev;
+    TKey_UINT32 uiPendingId;
+    TKey_UINT32 uiCut;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    psDev = TKey_FlashSim_Init(TKEY_OBJSTORE_CHECK_PAGES * TKEY_OBJSTORE_PAGE_SIZE,
+                               TKEY_OBJSTORE_CHECK_ERASE_SIZE,
+                               TKEY_OBJSTORE_CHECK_WRITE_SIZE, TKey_TRUE);
+    memset(gasCommitted, 0, sizeof(gasCommitted));
+    memset(&gsCheckStore, 0, sizeof(gsCheckStore));
+    if(TKey_NULL == psDev ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Mount(&gsCheckStore, psDev)) {
+        return TKey_FALSE;
+    }
+
+    for(uiCut = 0; uiCut < TKEY_OBJSTORE_CHECK_CUTS && bPassed; uiCut++) {
+        TKey_FlashSim_FailAfter(tkey_objstore_check_random(
+                                    TKEY_OBJSTORE_CHECK_MAX_OPS),
+                                E_TKEY_FLASH_SIM_FAULT_POWER_CUT);
+        uiPendingId = tkey_objstore_check_run(&bPassed);
+        bPassed = bPassed && tkey_objstore_check_recover(psDev, uiPendingId);
+    }
+    *puiCuts = uiCut;
+    return bPassed;
+}
+
+static TKey_BOOL tkey_objstore_check_in_flash(const TKey_BYTE *pucData,
+                                               TKey_UINT32 uiLen)
+{
+    const TKey_BYTE *pucFlash = TKey_FlashSim_Memory();
+
+    return (pucData >= pucFlash) &&
+           (pucData + uiLen <= pucFlash + TKEY_OBJSTORE_CHECK_PAGES *
+                                          TKEY_OBJSTORE_PAGE_SIZE);
+}
+
+/* Runs half way through a program: only pinned objects can be viewed */
+static TKey_VOID tkey_objstore_check_busy_hook(TKey_VOID)
+{
+    TKey_ObjView_t sView;
+
+    geBusyView = TKey_ObjStore_View(&gsCheckStore, TKEY_OBJSTORE_CHECK_VIEW_ID,
+                                    &sView);
+    geBusyPinned = TKey_ObjStore_View(&gsCheckStore,
+                                      TKEY_OBJSTORE_CHECK_PINNED_ID,
+                                      &gsBusyPinned);
+}
+
+static TKey_BOOL tkey_objstore_check_view(TKey_VOID)
+{
+    TKey_BYTE aucData[TKEY_OBJSTORE_CHECK_MAX_LEN];
+    TKey_BYTE aucPinned[TKEY_OBJSTORE_SHADOW_SIZE];
+    const TKey_FlashDev_t *psDev;
+    TKey_FlashDev_t sUnmapped;
+    TKey_FlashSimCounters_t sBefore;
+    TKey_FlashSimCounters_t sAfter;
+    TKey_ObjView_t sView;
+    TKey_ObjView_t sNext;
+    TKey_UINT32 uiIndex;
+    TKey_BOOL bPassed;
+
+    psDev = TKey_FlashSim_Init(TKEY_OBJSTORE_CHECK_PAGES * TKEY_OBJSTORE_PAGE_SIZE,
+                               TKEY_OBJSTORE_CHECK_ERASE_SIZE,
+                               TKEY_OBJSTORE_CHECK_WRITE_SIZE, TKey_TRUE);
+    memset(&gsCheckStore, 0, sizeof(gsCheckStore));
+    for(uiIndex = 0; uiIndex < sizeof(aucData); uiIndex++) {
+        aucData[uiIndex] = (TKey_BYTE)(uiIndex * 5 + 1);
+    }
+    for(uiIndex = 0; uiIndex < sizeof(aucPinned); uiIndex++) {
+        aucPinned[uiIndex] = (TKey_BYTE)(0xA0 ^ uiIndex);
+    }
+    if(TKey_NULL == psDev ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Mount(&gsCheckStore, psDev) ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Write(&gsCheckStore,
+                                      TKEY_OBJSTORE_CHECK_VIEW_ID, aucData,
+                                      sizeof(aucData)) ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Write(&gsCheckStore,
+                                      TKEY_OBJSTORE_CHECK_PINNED_ID, aucPinned,
+                                      sizeof(aucPinned)) ||
+       E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStore_Pin(&gsCheckStore,
+                                      TKEY_OBJSTORE_CHECK_PINNED_ID)) {
+        return TKey_FALSE;
+    }
+
+    /* The view is the record in the flash mapping; nothing is read */
+    TKey_FlashSim_GetCounters(&sBefore);
+    bPassed = (E_TKEY_OBJSTORE_SUCCESS == TKey_ObjStore_View(&gsCheckStore,
+                                              TKEY_OBJSTORE_CHECK_VIEW_ID, &sView));
+    TKey_FlashSim_GetCounters(&sAfter);
+    bPassed = bPassed && (sAfter.uiReads == sBefore.uiReads) &&
+              (TKey_NULL == sView.psShadow) && (sizeof(aucData) == sView.uiLen) &&
+              tkey_objstore_check_in_flash(sView.pucData, sView.uiLen) &&
+              (0 == memcmp(sView.pucData, aucData, sizeof(aucData))) &&
+              TKey_ObjStore_ViewValid(&gsCheckStore, &sView);
+
+    /* Taken again, it is the same bytes */
+    bPassed = bPassed &&
+              (E_TKEY_OBJSTORE_SUCCESS == TKey_ObjStore_View(&gsCheckStore,
+                                              TKEY_OBJSTORE_CHECK_VIEW_ID, &sNext)) &&
+              (sNext.pucData == sView.pucData);
+
+    /* During a program only the pinned object is served, from RAM; after
+     * it every earlier view is stale */
+    aucData[0] ^= 0xFF;
+    TKey_FlashSim_SetBusyHook(tkey_objstore_check_busy_hook);
+    bPassed = bPassed &&
+              (E_TKEY_OBJSTORE_SUCCESS == TKey_ObjStore_Write(&gsCheckStore,
+                                              TKEY_OBJSTORE_CHECK_VIEW_ID, aucData,
+                                              sizeof(aucData)));
+    TKey_FlashSim_SetBusyHook(TKey_NULL);
+    bPassed = bPassed && (E_TKEY_OBJSTORE_BUSY == geBusyView) &&
+              (E_TKEY_OBJSTORE_SUCCESS == geBusyPinned) &&
+              (TKey_NULL != gsBusyPinned.psShadow) &&
+              !tkey_objstore_check_in_flash(gsBusyPinned.pucData, gsBusyPinned.uiLen) &&
+              (sizeof(aucPinned) == gsBusyPinned.uiLen) &&
+              (0 == memcmp(gsBusyPinned.pucData, aucPinned, sizeof(aucPinned))) &&
+              !TKey_ObjStore_ViewValid(&gsCheckStore, &sView);
+    bPassed = bPassed &&
+              (E_TKEY_OBJSTORE_SUCCESS == TKey_ObjStore_View(&gsCheckStore,
+                                              TKEY_OBJSTORE_CHECK_VIEW_ID, &sNext)) &&
+              (sNext.uiGeneration > sView.uiGeneration) &&
+              tkey_objstore_check_in_flash(sNext.pucData, sNext.uiLen) &&
+              (0 == memcmp(sNext.pucData, aucData, sizeof(aucData)));
+
+    /* No mapping, no view */
+    sUnmapped = *psDev;
+    sUnmapped.pucMapped = TKey_NULL;
+    memset(&gsCheckStore, 0, sizeof(gsCheckStore));
+    bPassed = bPassed &&
+              (E_TKEY_OBJSTORE_SUCCESS == TKey_ObjStore_Mount(&gsCheckStore,
+                                                              &sUnmapped)) &&
+              (E_TKEY_OBJSTORE_BUSY == TKey_ObjStore_View(&gsCheckStore,
+                                           TKEY_OBJSTORE_CHECK_VIEW_ID, &sView));
+    return bPassed;
+}
+
+#if defined(THINKEY_OBJSTORE_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_FlashSimCounters_t sCounters;
+    TKey_UINT32 uiFailed = 0;
+    TKey_UINT32 uiCuts = 0;
+    TKey_BOOL bPassed;
+
+    (void)argc;
+    (void)argv;
+    /* Every injected fault would be logged as a failed operation */
+    (void)TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_STORAGE, THINKEY_DEBUG_LEVEL_NONE);
+
+    bPassed = tkey_objstore_check_power_cut(&uiCuts);
+    TKey_FlashSim_GetCounters(&sCounters);
+    printf("%lu power cuts, %lu programs, %lu erases\r\n",
+           (unsigned long)uiCuts, (unsigned long)sCounters.uiPrograms,
+           (unsigned long)sCounters.uiErases);
+    bPassed = bPassed && (0 == sCounters.uiOverwrites);
+    tkey_objstore_check_result("power cut recovery", bPassed, &uiFailed);
+
+    tkey_objstore_check_result("view zero copy", tkey_objstore_check_view(),
+                               &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_OBJSTORE_CHECK_MAIN */
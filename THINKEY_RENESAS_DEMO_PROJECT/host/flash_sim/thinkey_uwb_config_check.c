@@ -0,0 +1,336 @@
+/*
+ * \file thinkey_uwb_config_check.c
+ *
+ * \brief UWB parameter save and reload check on the flash simulator
+ *
+ * Changes each field of param_block_t in turn, saves the block with
+ * save_bssConfig(), remounts the object store and checks that
+ * load_bssConfig() brings back every field saved so far. The field table
+ * must cover the saved part of param_block_t byte for byte, so a field
+ * added to the block fails the check until it is listed here. Also checks
+ * the fall back to the defaults on a corrupted or deleted record, and the
+ * migration of records from other versions: a version 0 record is
+ * rejected, one cut after any field, as saved before the later fields were
+ * appended, keeps their defaults, and one from a newer version with fields
+ * appended after ours loads what we know of it. Host
+ * builds only; built with THINKEY_UWB_CONFIG_CHECK_MAIN it is a standalone
+ * program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_flash_sim.h"
+#include "thinkey_objstore.h"
+#include "thinkey_objstore_async.h"
+#include "thinkey_debug.h"
+#include "uwb_config.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TKEY_UWB_CONFIG_CHECK_PAGES 8
+#define TKEY_UWB_CONFIG_CHECK_PAYLOAD offsetof(param_block_t, free)
+/* version, length and CRC32 ahead of the payload, as uwb_config.c saves it */
+#define TKEY_UWB_CONFIG_CHECK_HEADER 8
+#define TKEY_UWB_CONFIG_CHECK_VERSION 1
+#define TKEY_UWB_CONFIG_CHECK_NEWER 4       /* bytes a newer version appends */
+
+#define TKEY_UWB_CONFIG_CHECK_FIELD(field) \
+    { #field, offsetof(param_block_t, field), sizeof(((param_block_t *)0)->field) }
+
+typedef struct
+{
+    const TKey_CHAR *pcName;
+    TKey_UINT32 uiOffset;
+    TKey_UINT32 uiSize;
+} TKey_UwbConfigCheckField_t;
+
+/* Every saved field of param_block_t, in layout order */
+static const TKey_UwbConfigCheckField_t gasCheckFields[] = {
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.chan),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.txPreambLength),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.rxPAC),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.txCode),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.rxCode),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.sfdType),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.dataRate),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.phrMode),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.phrRate),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.sfdTO),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.stsMode),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.stsLength),
+    TKEY_UWB_CONFIG_CHECK_FIELD(dwt_config.pdoaMode),
+    TKEY_UWB_CONFIG_CHECK_FIELD(knownTagList),
+    TKEY_UWB_CONFIG_CHECK_FIELD(v.ver0),
+    TKEY_UWB_CONFIG_CHECK_FIELD(v.ver1),
+    TKEY_UWB_CONFIG_CHECK_FIELD(v.ver2),
+    TKEY_UWB_CONFIG_CHECK_FIELD(v.ver3),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.addr1),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.addr2),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.addr3),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.addr4),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.gw_addr1),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.gw_addr2),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.gw_addr3),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.gw_addr4),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.nm_addr1),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.nm_addr2),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.nm_addr3),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.nm_addr4),
+    TKEY_UWB_CONFIG_CHECK_FIELD(static_config.use_static_ip),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.sfConfig.slotPeriod),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.sfConfig.numSlots),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.sfConfig.sfPeriod_ms),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.sfConfig.tag_replyDly_us),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.sfConfig.tag_pollTxFinalTx_us),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.txConfig.PGdly),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.txConfig.power),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.txConfig.PGcount),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.addr),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.panID),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.uartEn),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.pdoaOffset_deg),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.rngOffset_mm),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.pdoa_temp_coeff_mrad),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.accEn),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.diagEn),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.phaseCorrEn),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.reportLevel),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.faultyRanges),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.debugEn),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.rcDelay_us),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.rcRxTo_us),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.antRx_a),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.antTx_a),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.antRx_b),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.fixed_pos_x_mm),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.fixed_pos_y_mm),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.fixed_pos_z_mm),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.default_event),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.lotId),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.partId),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsKey.key0),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsKey.key1),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsKey.key2),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsKey.key3),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsIv.iv0),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsIv.iv1),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsIv.iv2),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsIv.iv3),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.stsStatic),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.xtalTrim),
+    TKEY_UWB_CONFIG_CHECK_FIELD(s.update_uwb_config_flag)
+};
+
+#define TKEY_UWB_CONFIG_CHECK_FIELDS \
+    (sizeof(gasCheckFields) / sizeof(gasCheckFields[0]))
+
+extern const param_block_t FConfig;
+
+static TKey_ObjStore_t gsCheckStore;
+static const TKey_FlashDev_t *gpsCheckDev;
+static param_block_t gsExpected;
+static TKey_BYTE gaucRecord[TKEY_UWB_CONFIG_CHECK_HEADER + TKEY_UWB_CONFIG_CHECK_PAYLOAD +
+                            TKEY_UWB_CONFIG_CHECK_NEWER];
+
+static TKey_VOID tkey_uwb_config_check_result(const TKey_CHAR *pcCheck,
+                                              TKey_BOOL bPassed,
+                                              TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+/* Power cycle, as a reset would, and mount the store again */
+static TKey_BOOL tkey_uwb_config_check_remount(TKey_VOID)
+{
+    TKey_FlashSim_PowerCycle();
+    memset(&gsCheckStore, 0, sizeof(gsCheckStore));
+    return (E_TKEY_OBJSTORE_SUCCESS == TKey_ObjStore_Mount(&gsCheckStore, gpsCheckDev)) &&
+           (E_TKEY_OBJSTORE_SUCCESS == TKey_ObjStoreAsync_Init(&gsCheckStore));
+}
+
+static TKey_BOOL tkey_uwb_config_check_loads(const param_block_t *psExpected)
+{
+    load_bssConfig();
+    return (0 == memcmp(get_pbssConfig(), psExpected, TKEY_UWB_CONFIG_CHECK_PAYLOAD));
+}
+
+/* The table covers the saved part of the block with no gap or overlap */
+static TKey_BOOL tkey_uwb_config_check_fields(TKey_VOID)
+{
+    TKey_UINT32 uiEnd = 0;
+    TKey_UINT32 uiField;
+
+    for(uiField = 0; uiField < TKEY_UWB_CONFIG_CHECK_FIELDS; uiField++) {
+        if(gasCheckFields[uiField].uiOffset != uiEnd) {
+            printf("field %s not at %lu\r\n", gasCheckFields[uiField].pcName,
+                   (unsigned long)uiEnd);
+            return TKey_FALSE;
+        }
+        uiEnd += gasCheckFields[uiField].uiSize;
+    }
+    if(TKEY_UWB_CONFIG_CHECK_PAYLOAD != uiEnd) {
+        printf("%lu saved bytes not in the field table\r\n",
+               (unsigned long)(TKEY_UWB_CONFIG_CHECK_PAYLOAD - uiEnd));
+        return TKey_FALSE;
+    }
+    return TKey_TRUE;
+}
+
+/* Each field in turn: change it, save, remount, and everything saved so
+ * far comes back */
+static TKey_BOOL tkey_uwb_config_check_round_trip(TKey_VOID)
+{
+    const TKey_UwbConfigCheckField_t *psField;
+    TKey_BYTE *pucField;
+    TKey_UINT32 uiField;
+    TKey_UINT32 uiIndex;
+    TKey_BOOL bChanged;
+
+    memcpy(&gsExpected, &FConfig, sizeof(gsExpected));
+    for(uiField = 0; uiField < TKEY_UWB_CONFIG_CHECK_FIELDS; uiField++) {
+        psField = &gasCheckFields[uiField];
+        load_bssConfig();
+        pucField = (TKey_BYTE *)get_pbssConfig() + psField->uiOffset;
+        bChanged = TKey_FALSE;
+        for(uiIndex = 0; uiIndex < psField->uiSize; uiIndex++) {
+            TKey_BYTE ucNew = (TKey_BYTE)(0xA5 ^ (uiField * 17 + uiIndex * 3));
+
+            bChanged = bChanged || (pucField[uiIndex] != ucNew);
+            pucField[uiIndex] = ucNew;
+        }
+        if(!bChanged) {
+            pucField[0] ^= 0xFF;
+        }
+        memcpy((TKey_BYTE *)&gsExpected + psField->uiOffset, pucField,
+               psField->uiSize);
+
+        if(_NO_ERR != save_bssConfig(get_pbssConfig()) ||
+           !tkey_uwb_config_check_remount() ||
+           !tkey_uwb_config_check_loads(&gsExpected)) {
+            printf("field %s not reloaded\r\n", psField->pcName);
+            return TKey_FALSE;
+        }
+    }
+    return TKey_TRUE;
+}
+
+/* Writes a record as another version or a damaged save would have left it */
+static TKey_BOOL tkey_uwb_config_check_put(const TKey_BYTE *pucPayload,
+                                           TKey_UINT16 usVersion,
+                                           TKey_UINT16 usLength,
+                                           TKey_UINT32 uiCrcFlip)
+{
+    TKey_UINT32 uiCrc;
+
+    uiCrc = TKey_ObjStore_Crc32(0, pucPayload, usLength) ^ uiCrcFlip;
+    memcpy(&gaucRecord[0], &usVersion, sizeof(usVersion));
+    memcpy(&gaucRecord[2], &usLength, sizeof(usLength));
+    memcpy(&gaucRecord[4], &uiCrc, sizeof(uiCrc));
+    memcpy(&gaucRecord[TKEY_UWB_CONFIG_CHECK_HEADER], pucPayload, usLength);
+    return (E_TKEY_OBJSTORE_SUCCESS ==
+            TKey_ObjStore_Write(&gsCheckStore, TKEY_OBJ_ID_UWB_CONFIG, gaucRecord,
+                                TKEY_UWB_CONFIG_CHECK_HEADER + usLength)) &&
+           tkey_uwb_config_check_remount();
+}
+
+/* A bad CRC loads the defaults */
+static TKey_BOOL tkey_uwb_config_check_damaged(TKey_VOID)
+{
+    return tkey_uwb_config_check_put((const TKey_BYTE *)&gsExpected,
+                                     TKEY_UWB_CONFIG_CHECK_VERSION,
+                                     TKEY_UWB_CONFIG_CHECK_PAYLOAD, 0x00000001) &&
+           tkey_uwb_config_check_loads(&FConfig);
+}
+
+/* Version 0 was never saved, so its record is rejected whole. A record cut
+ * after any field, as a version before the later fields were appended
+ * saved it, loads those fields and the defaults fill the rest. A newer
+ * version's record loads the fields we know and skips what it appended. */
+static TKey_BOOL tkey_uwb_config_check_migrate(TKey_VOID)
+{
+    TKey_BYTE aucNewer[TKEY_UWB_CONFIG_CHECK_PAYLOAD + TKEY_UWB_CONFIG_CHECK_NEWER];
+    param_block_t sOlder;
+    TKey_UINT32 uiField;
+    TKey_UINT16 usLength;
+
+    if(!tkey_uwb_config_check_put((const TKey_BYTE *)&gsExpected, 0,
+                                  TKEY_UWB_CONFIG_CHECK_PAYLOAD, 0) ||
+       !tkey_uwb_config_check_loads(&FConfig)) {
+        printf("version 0 record not rejected\r\n");
+        return TKey_FALSE;
+    }
+
+    for(uiField = 1; uiField < TKEY_UWB_CONFIG_CHECK_FIELDS; uiField++) {
+        usLength = (TKey_UINT16)gasCheckFields[uiField].uiOffset;
+        memcpy(&sOlder, &FConfig, sizeof(sOlder));
+        memcpy(&sOlder, &gsExpected, usLength);
+        if(!tkey_uwb_config_check_put((const TKey_BYTE *)&gsExpected,
+                                      TKEY_UWB_CONFIG_CHECK_VERSION, usLength, 0) ||
+           !tkey_uwb_config_check_loads(&sOlder)) {
+            printf("record cut before %s not migrated\r\n",
+                   gasCheckFields[uiField].pcName);
+            return TKey_FALSE;
+        }
+    }
+
+    memcpy(aucNewer, &gsExpected, TKEY_UWB_CONFIG_CHECK_PAYLOAD);
+    memset(&aucNewer[TKEY_UWB_CONFIG_CHECK_PAYLOAD], 0x5A, TKEY_UWB_CONFIG_CHECK_NEWER);
+    if(!tkey_uwb_config_check_put(aucNewer, TKEY_UWB_CONFIG_CHECK_VERSION + 1,
+                                  sizeof(aucNewer), 0) ||
+       !tkey_uwb_config_check_loads(&gsExpected)) {
+        printf("newer record not loaded\r\n");
+        return TKey_FALSE;
+    }
+    return TKey_TRUE;
+}
+
+/* restore_bssConfig() drops the saved record, for good */
+static TKey_BOOL tkey_uwb_config_check_restore(TKey_VOID)
+{
+    restore_bssConfig();
+    return (0 == memcmp(get_pbssConfig(), &FConfig, TKEY_UWB_CONFIG_CHECK_PAYLOAD)) &&
+           tkey_uwb_config_check_remount() &&
+           tkey_uwb_config_check_loads(&FConfig);
+}
+
+#if defined(THINKEY_UWB_CONFIG_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiFailed = 0;
+
+    (void)argc;
+    (void)argv;
+    /* The damaged record is logged as a failed read */
+    (void)TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_STORAGE, THINKEY_DEBUG_LEVEL_NONE);
+
+    gpsCheckDev = TKey_FlashSim_Init(TKEY_UWB_CONFIG_CHECK_PAGES * TKEY_OBJSTORE_PAGE_SIZE,
+                                     64, 4, TKey_TRUE);
+    if(TKey_NULL == gpsCheckDev || !tkey_uwb_config_check_remount()) {
+        printf("uwb_config_check: setup failed\r\n");
+        return 1;
+    }
+    printf("%lu fields, %lu saved bytes\r\n",
+           (unsigned long)TKEY_UWB_CONFIG_CHECK_FIELDS,
+           (unsigned long)TKEY_UWB_CONFIG_CHECK_PAYLOAD);
+
+    tkey_uwb_config_check_result("field table complete",
+                                 tkey_uwb_config_check_fields(), &uiFailed);
+    tkey_uwb_config_check_result("defaults when unsaved",
+                                 tkey_uwb_config_check_loads(&FConfig), &uiFailed);
+    tkey_uwb_config_check_result("field round trip",
+                                 tkey_uwb_config_check_round_trip(), &uiFailed);
+    tkey_uwb_config_check_result("damaged record",
+                                 tkey_uwb_config_check_damaged(), &uiFailed);
+    tkey_uwb_config_check_result("version migration",
+                                 tkey_uwb_config_check_migrate(), &uiFailed);
+    tkey_uwb_config_check_result("restore defaults",
+                                 tkey_uwb_config_check_restore(), &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_UWB_CONFIG_CHECK_MAIN */
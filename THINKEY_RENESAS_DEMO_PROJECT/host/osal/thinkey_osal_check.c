@@ -0,0 +1,540 @@
+/*
+ * \file thinkey_osal_check.c
+ *
+ * \brief OSAL queue, task, semaphore and memory check
+ *
+ * Checks the OSAL calls the THINKey layers rely on, against the host
+ * POSIX port: queue order, front sends, full and empty queues with and
+ * without timeouts and their statistics; tasks started with their
+ * parameters and listed in the task statistics; static queues and tasks
+ * built from THINKEY_OSAL_*_STORAGE, and the storage they refuse.
+ *
+ * The OSAL has no semaphore calls: THINKey signals with queues, as the
+ * FreeRTOS semaphores are queues themselves. A binary semaphore is a queue
+ * of one one-byte item, given by a send without waiting and taken by a
+ * receive; a counting semaphore is a queue of as many items as the count,
+ * and a mutex a binary semaphore given once at the start. The semaphore
+ * checks use them so: given from an ISR and taken by a task, counted, and
+ * held around shared data by tasks running in parallel.
+ *
+ * The memory copy and compares are checked against the C library: every
+ * length up to a few words past the 16-byte copy loop, at every alignment
+ * of either buffer, with the bytes around the destination left untouched,
+ * a difference at each position, and the NULL and zero length cases.
+ *
+ * Host builds only; built with THINKEY_OSAL_CHECK_MAIN it is a standalone
+ * program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_osal.h"
+#include "thinkey_osal_posix.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_OSAL_CHECK_STACK 512
+#define TKEY_OSAL_CHECK_PRIORITY 2
+#define TKEY_OSAL_CHECK_WAIT_MS 20          /* timed calls that must time out */
+#define TKEY_OSAL_CHECK_REPLY_MS 2000       /* for a task to answer */
+#define TKEY_OSAL_CHECK_ISR_ROUNDS 200
+#define TKEY_OSAL_CHECK_LOCKERS 4
+#define TKEY_OSAL_CHECK_LOCKS 20000         /* per locker */
+#define TKEY_OSAL_CHECK_SLEEP_EVERY 1000    /* holders sleep 1 ms */
+#define TKEY_OSAL_CHECK_MAX_TASKS 16
+#define TKEY_OSAL_CHECK_MEM_MAX 67          /* four 16-byte rounds and a tail */
+#define TKEY_OSAL_CHECK_MEM_GUARD 8
+#define TKEY_OSAL_CHECK_MEM_BUF \
+    (TKEY_OSAL_CHECK_MEM_MAX + 3 + 2 * TKEY_OSAL_CHECK_MEM_GUARD)
+
+typedef struct
+{
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiValue;
+} TKey_OsalCheckMsg_t;
+
+/* Queues as semaphores */
+typedef struct
+{
+    TKey_HANDLE hIsrSem;                /* binary, given by the ISR */
+    TKey_HANDLE hDoneSem;               /* counting, given by the tasks */
+    TKey_HANDLE hLock;                  /* mutex */
+    TKey_HANDLE hStartSem;              /* counting, lets the lockers go */
+    TKey_HANDLE hPark;                  /* never given: tasks wait here */
+    volatile TKey_UINT32 uiIsrTaken;
+    TKey_UINT32 uiShared;               /* only under hLock */
+} TKey_OsalCheckSem_t;
+
+static TKey_OsalCheckSem_t gsSem;
+
+/* Word aligned, so the offsets below are the misalignment */
+typedef union
+{
+    TKey_UINT32 auiAlign[(TKEY_OSAL_CHECK_MEM_BUF + 3) / 4];
+    TKey_BYTE aucData[TKEY_OSAL_CHECK_MEM_BUF];
+} TKey_OsalCheckMemBuf_t;
+
+THINKEY_OSAL_QUEUE_STORAGE(check, gsCheckQueue, 4, sizeof(TKey_OsalCheckMsg_t));
+THINKEY_OSAL_TASK_STORAGE(check, gsCheckTask, TKEY_OSAL_CHECK_STACK);
+
+static TKey_VOID tkey_osal_check_result(const TKey_CHAR *pcCheck, TKey_BOOL bPassed,
+                                        TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+static TKey_BOOL tkey_osal_check_give(TKey_HANDLE hSem)
+{
+    TKey_BYTE bToken = 0;
+
+    return (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueSend(hSem, &bToken));
+}
+
+static TKey_BOOL tkey_osal_check_take(TKey_HANDLE hSem, TKey_UINT32 uiTimeoutMs)
+{
+    TKey_BYTE bToken;
+
+    return (E_THINKEY_SUCCESS == THINKey_OSAL_eTimedQueueReceive(hSem, &bToken, uiTimeoutMs));
+}
+
+/* Tasks must not return on the target: done, they wait for good */
+static TKey_VOID tkey_osal_check_park(TKey_VOID)
+{
+    for(;;) {
+        tkey_osal_check_take(gsSem.hPark, THINKEY_OSAL_FOREVER);
+    }
+}
+
+/* Messages come out in order, a front send ahead of the waiting ones; a
+ * full queue refuses and an empty one has nothing, both counted */
+static TKey_BOOL tkey_osal_check_queue_order(TKey_VOID)
+{
+    TKey_HANDLE hQueue = THINKey_OSAL_hCreateQueue(4, sizeof(TKey_OsalCheckMsg_t));
+    THINKey_OSAL_QueueStats_t sStats;
+    TKey_OsalCheckMsg_t sMsg;
+    TKey_UINT32 uiSeq;
+    TKey_BOOL bPassed = (TKey_NULL != hQueue);
+
+    for(uiSeq = 1; uiSeq <= 4 && bPassed; uiSeq++) {
+        sMsg.uiSeq = uiSeq;
+        sMsg.uiValue = uiSeq * 10;
+        bPassed = (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueSend(hQueue, &sMsg));
+    }
+    sMsg.uiSeq = 5;
+    bPassed = bPassed && (E_THINKEY_SUCCESS != THINKey_OSAL_eQueueSend(hQueue, &sMsg)) &&
+              (E_THINKEY_SUCCESS == THINKey_OSAL_eTimedQueueReceive(hQueue, &sMsg,
+                                                                    THINKEY_OSAL_ZERO)) &&
+              (1 == sMsg.uiSeq) && (10 == sMsg.uiValue);
+
+    /* Urgent: ahead of 2, 3 and 4 */
+    sMsg.uiSeq = 100;
+    bPassed = bPassed && (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueSendTimed(hQueue, &sMsg,
+                          THINKEY_OSAL_ZERO, E_THINKEY_OSAL_QUEUE_FRONT));
+    THINKey_OSAL_vQueueGetStats(hQueue, &sStats);
+    bPassed = bPassed && (5 == sStats.uiSent) && (1 == sStats.uiDropped) &&
+              (4 == sStats.uiMaxDepth) && (4 == sStats.uiDepth);
+
+    bPassed = bPassed && (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueReceive(hQueue, &sMsg)) &&
+              (100 == sMsg.uiSeq);
+    for(uiSeq = 2; uiSeq <= 4 && bPassed; uiSeq++) {
+        bPassed = (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueReceive(hQueue, &sMsg)) &&
+                  (uiSeq == sMsg.uiSeq) && (uiSeq * 10 == sMsg.uiValue);
+    }
+    THINKey_OSAL_vQueueGetStats(hQueue, &sStats);
+    return bPassed && (E_THINKEY_SUCCESS != THINKey_OSAL_eTimedQueueReceive(hQueue, &sMsg,
+                       THINKEY_OSAL_ZERO)) && (0 == sStats.uiDepth);
+}
+
+/* A timed receive on an empty queue and a timed send on a full one give
+ * up after their timeout, not before */
+static TKey_BOOL tkey_osal_check_queue_timeout(TKey_VOID)
+{
+    TKey_HANDLE hQueue = THINKey_OSAL_hCreateQueue(1, sizeof(TKey_OsalCheckMsg_t));
+    TKey_OsalCheckMsg_t sMsg = { 1, 1 };
+    TKey_UINT32 uiStartMs;
+    TKey_BOOL bPassed = (TKey_NULL != hQueue);
+
+    uiStartMs = TKey_OsalPosix_NowMs();
+    bPassed = bPassed && (E_THINKEY_SUCCESS != THINKey_OSAL_eTimedQueueReceive(hQueue, &sMsg,
+                          TKEY_OSAL_CHECK_WAIT_MS)) &&
+              (TKey_OsalPosix_NowMs() - uiStartMs >= TKEY_OSAL_CHECK_WAIT_MS);
+
+    bPassed = bPassed && (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueSend(hQueue, &sMsg));
+    uiStartMs = TKey_OsalPosix_NowMs();
+    return bPassed && (E_THINKEY_SUCCESS != THINKey_OSAL_eQueueSendTimed(hQueue, &sMsg,
+                       TKEY_OSAL_CHECK_WAIT_MS, E_THINKEY_OSAL_QUEUE_BACK)) &&
+           (TKey_OsalPosix_NowMs() - uiStartMs >= TKEY_OSAL_CHECK_WAIT_MS);
+}
+
+/* Answers each request on the queue it was given with the value plus one */
+static TKey_VOID tkey_osal_check_echo_task(TKey_VOID *pvParams)
+{
+    TKey_HANDLE *phQueues = (TKey_HANDLE*)pvParams;
+    TKey_OsalCheckMsg_t sMsg;
+
+    for(;;) {
+        if(E_THINKEY_SUCCESS == THINKey_OSAL_eQueueReceive(phQueues[0], &sMsg)) {
+            sMsg.uiValue++;
+            THINKey_OSAL_eQueueSendTimed(phQueues[1], &sMsg, THINKEY_OSAL_FOREVER,
+                                         E_THINKEY_OSAL_QUEUE_BACK);
+        }
+    }
+}
+
+/* Sends requests to a task started with uiTaskID and checks the answers,
+ * and that the task is in the task statistics under its name */
+static TKey_BOOL tkey_osal_check_echo(TKey_HANDLE *phQueues, TKey_UINT32 uiTaskID,
+                                      const TKey_CHAR *pcName)
+{
+    static THINKey_OSAL_TaskStats_t sasStats[TKEY_OSAL_CHECK_MAX_TASKS];
+    TKey_OsalCheckMsg_t sMsg;
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_BOOL bListed = TKey_FALSE;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    for(uiSeq = 0; uiSeq < 100 && bPassed; uiSeq++) {
+        sMsg.uiSeq = uiSeq;
+        sMsg.uiValue = uiSeq * 3;
+        bPassed = (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueSendTimed(phQueues[0], &sMsg,
+                   TKEY_OSAL_CHECK_REPLY_MS, E_THINKEY_OSAL_QUEUE_BACK)) &&
+                  (E_THINKEY_SUCCESS == THINKey_OSAL_eTimedQueueReceive(phQueues[1], &sMsg,
+                   TKEY_OSAL_CHECK_REPLY_MS)) &&
+                  (uiSeq == sMsg.uiSeq) && (uiSeq * 3 + 1 == sMsg.uiValue);
+    }
+
+    uiCount = THINKey_OSAL_uiTaskGetStats(sasStats, TKEY_OSAL_CHECK_MAX_TASKS, TKey_NULL);
+    for(uiIndex = 0; uiIndex < uiCount; uiIndex++) {
+        if(uiTaskID == sasStats[uiIndex].uiTaskNumber) {
+            bListed = (0 == strcmp(pcName, sasStats[uiIndex].strName)) &&
+                      (TKEY_OSAL_CHECK_PRIORITY == sasStats[uiIndex].uiPriority);
+        }
+    }
+    return bPassed && bListed;
+}
+
+/* A task gets its parameters and talks over queues */
+static TKey_BOOL tkey_osal_check_task(TKey_VOID)
+{
+    static TKey_HANDLE ahQueues[2];
+    TKey_UINT32 uiTaskID = 0;
+
+    ahQueues[0] = THINKey_OSAL_hCreateQueue(2, sizeof(TKey_OsalCheckMsg_t));
+    ahQueues[1] = THINKey_OSAL_hCreateQueue(2, sizeof(TKey_OsalCheckMsg_t));
+    if(TKey_NULL == ahQueues[0] || TKey_NULL == ahQueues[1] ||
+       E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("osal_chk_echo",
+               tkey_osal_check_echo_task, ahQueues, TKEY_OSAL_CHECK_PRIORITY,
+               TKEY_OSAL_CHECK_STACK, &uiTaskID)) {
+        return TKey_FALSE;
+    }
+    return (0 != uiTaskID) && tkey_osal_check_echo(ahQueues, uiTaskID, "osal_chk_echo");
+}
+
+/* Static objects: the queue keeps its items in the storage given, named
+ * and listed as any queue; the task runs as a dynamic one. Storage that is
+ * missing or too small is refused. */
+static TKey_BOOL tkey_osal_check_static(TKey_VOID)
+{
+    static THINKey_OSAL_QueueCb_t sSmallCb;
+    static TKey_HANDLE ahQueues[2];
+    THINKey_OSAL_TaskCb_t sTaskCb;
+    TKey_HANDLE ahListed[TKEY_OSAL_CHECK_MAX_TASKS * 2];
+    TKey_OsalCheckMsg_t sMsg = { 7, 0x5A5A5A5A };
+    TKey_BYTE abSmall[sizeof(TKey_OsalCheckMsg_t)];
+    TKey_UINT32 uiStack[4];
+    TKey_UINT32 uiTaskID = 0;
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_BOOL bListed = TKey_FALSE;
+    TKey_BOOL bPassed;
+
+    ahQueues[0] = THINKEY_OSAL_CREATE_STATIC_QUEUE(gsCheckQueue, 4, sizeof(TKey_OsalCheckMsg_t));
+    ahQueues[1] = THINKey_OSAL_hCreateQueue(4, sizeof(TKey_OsalCheckMsg_t));
+    bPassed = (TKey_NULL != ahQueues[0]) && (TKey_NULL != ahQueues[1]) &&
+              ((TKey_HANDLE)&gsCheckQueue_sCb == ahQueues[0]);
+    if(!bPassed) {
+        return TKey_FALSE;
+    }
+    THINKey_OSAL_vQueueSetName(ahQueues[0], "osal_chk_static");
+    bPassed = (0 == strcmp("osal_chk_static", THINKey_OSAL_strQueueGetName(ahQueues[0])));
+
+    /* The item is in the storage while it waits */
+    bPassed = bPassed && (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueSend(ahQueues[0], &sMsg)) &&
+              (0 == memcmp(gsCheckQueue_aullItems, &sMsg, sizeof(sMsg))) &&
+              (E_THINKEY_SUCCESS == THINKey_OSAL_eQueueReceive(ahQueues[0], &sMsg)) &&
+              (7 == sMsg.uiSeq);
+
+    uiCount = THINKey_OSAL_uiQueueList(ahListed, TKEY_OSAL_CHECK_MAX_TASKS * 2);
+    for(uiIndex = 0; uiIndex < uiCount && uiIndex < TKEY_OSAL_CHECK_MAX_TASKS * 2; uiIndex++) {
+        bListed = bListed || (ahQueues[0] == ahListed[uiIndex]);
+    }
+    bPassed = bPassed && bListed;
+
+    bPassed = bPassed &&
+              (TKey_NULL == THINKey_OSAL_hCreateStaticQueue(2, sizeof(TKey_OsalCheckMsg_t),
+                      abSmall, sizeof(abSmall), &sSmallCb)) &&
+              (TKey_NULL == THINKey_OSAL_hCreateStaticQueue(1, sizeof(TKey_OsalCheckMsg_t),
+                      abSmall, sizeof(abSmall), TKey_NULL)) &&
+              (E_THINKEY_SUCCESS != THINKey_OSAL_eCreateStaticTask("osal_chk_nocb",
+                      tkey_osal_check_echo_task, ahQueues, TKEY_OSAL_CHECK_PRIORITY,
+                      4, uiStack, TKey_NULL, TKey_NULL)) &&
+              (E_THINKEY_SUCCESS != THINKey_OSAL_eCreateStaticTask("osal_chk_nostack",
+                      tkey_osal_check_echo_task, ahQueues, TKEY_OSAL_CHECK_PRIORITY,
+                      4, TKey_NULL, &sTaskCb, TKey_NULL));
+
+    bPassed = bPassed &&
+              (E_THINKEY_SUCCESS == THINKEY_OSAL_CREATE_STATIC_TASK(gsCheckTask,
+                      "osal_chk_static", tkey_osal_check_echo_task, ahQueues,
+                      TKEY_OSAL_CHECK_PRIORITY, &uiTaskID));
+    return bPassed && (0 != uiTaskID) &&
+           tkey_osal_check_echo(ahQueues, uiTaskID, "osal_chk_static");
+}
+
+/* A binary semaphore holds one give; a counting one as many as its
+ * length. Taking an empty one times out. */
+static TKey_BOOL tkey_osal_check_sem_count(TKey_VOID)
+{
+    TKey_HANDLE hBinary = THINKey_OSAL_hCreateQueue(1, 1);
+    TKey_HANDLE hCounting = THINKey_OSAL_hCreateQueue(3, 1);
+    TKey_BOOL bPassed = (TKey_NULL != hBinary) && (TKey_NULL != hCounting);
+
+    bPassed = bPassed && tkey_osal_check_give(hBinary) && !tkey_osal_check_give(hBinary) &&
+              tkey_osal_check_take(hBinary, THINKEY_OSAL_ZERO) &&
+              !tkey_osal_check_take(hBinary, TKEY_OSAL_CHECK_WAIT_MS);
+    bPassed = bPassed && tkey_osal_check_give(hCounting) && tkey_osal_check_give(hCounting) &&
+              tkey_osal_check_give(hCounting) && !tkey_osal_check_give(hCounting) &&
+              tkey_osal_check_take(hCounting, THINKEY_OSAL_ZERO) &&
+              tkey_osal_check_take(hCounting, THINKEY_OSAL_ZERO) &&
+              tkey_osal_check_take(hCounting, THINKEY_OSAL_ZERO) &&
+              !tkey_osal_check_take(hCounting, THINKEY_OSAL_ZERO);
+    return bPassed;
+}
+
+static TKey_VOID tkey_osal_check_isr_give(TKey_VOID *pvArg)
+{
+    TKey_UINT32 *puiWoken = (TKey_UINT32*)pvArg;
+    TKey_BYTE bToken = 0;
+
+    THINKey_OSAL_eQueueSendToFromISR(gsSem.hIsrSem, &bToken, puiWoken);
+}
+
+/* Takes the ISR semaphore and gives the done one, as a driver task does */
+static TKey_VOID tkey_osal_check_isr_task(TKey_VOID *pvParams)
+{
+    (void)pvParams;
+    for(;;) {
+        if(tkey_osal_check_take(gsSem.hIsrSem, THINKEY_OSAL_FOREVER)) {
+            gsSem.uiIsrTaken++;
+            tkey_osal_check_give(gsSem.hDoneSem);
+        }
+    }
+}
+
+/* Every give from the ISR wakes the task once */
+static TKey_BOOL tkey_osal_check_sem_isr(TKey_VOID)
+{
+    TKey_UINT32 uiRound;
+    TKey_UINT32 uiWoken = 0;
+    TKey_BOOL bPassed;
+
+    bPassed = (E_THINKEY_SUCCESS == THINKey_OSAL_eCreateTask("osal_chk_isr",
+               tkey_osal_check_isr_task, TKey_NULL, TKEY_OSAL_CHECK_PRIORITY,
+               TKEY_OSAL_CHECK_STACK, TKey_NULL));
+    for(uiRound = 0; uiRound < TKEY_OSAL_CHECK_ISR_ROUNDS && bPassed; uiRound++) {
+        TKey_OsalPosix_RunIsr(tkey_osal_check_isr_give, &uiWoken);
+        bPassed = tkey_osal_check_take(gsSem.hDoneSem, TKEY_OSAL_CHECK_REPLY_MS);
+    }
+    return bPassed && (TKEY_OSAL_CHECK_ISR_ROUNDS == gsSem.uiIsrTaken) &&
+           !tkey_osal_check_take(gsSem.hDoneSem, THINKEY_OSAL_ZERO);
+}
+
+/* Increments the shared count under the mutex, in two steps and now and
+ * then sleeping between them, so that a second holder would lose updates */
+static TKey_VOID tkey_osal_check_lock_task(TKey_VOID *pvParams)
+{
+    volatile TKey_UINT32 uiValue;
+    TKey_UINT32 uiLock;
+
+    (void)pvParams;
+    tkey_osal_check_take(gsSem.hStartSem, THINKEY_OSAL_FOREVER);
+    for(uiLock = 0; uiLock < TKEY_OSAL_CHECK_LOCKS; uiLock++) {
+        tkey_osal_check_take(gsSem.hLock, THINKEY_OSAL_FOREVER);
+        uiValue = gsSem.uiShared;
+        if(0 == uiLock % TKEY_OSAL_CHECK_SLEEP_EVERY) {
+            THINKey_OSAL_Delay(1);
+        }
+        gsSem.uiShared = uiValue + 1;
+        tkey_osal_check_give(gsSem.hLock);
+    }
+    tkey_osal_check_give(gsSem.hDoneSem);
+    tkey_osal_check_park();
+}
+
+/* Tasks running in parallel, started together, hold the mutex one at a
+ * time */
+static TKey_BOOL tkey_osal_check_sem_mutex(TKey_VOID)
+{
+    TKey_UINT32 uiTask;
+    TKey_BOOL bPassed = tkey_osal_check_give(gsSem.hLock);
+
+    for(uiTask = 0; uiTask < TKEY_OSAL_CHECK_LOCKERS && bPassed; uiTask++) {
+        bPassed = (E_THINKEY_SUCCESS == THINKey_OSAL_eCreateTask("osal_chk_lock",
+                   tkey_osal_check_lock_task, TKey_NULL, TKEY_OSAL_CHECK_PRIORITY,
+                   TKEY_OSAL_CHECK_STACK, TKey_NULL));
+    }
+    for(uiTask = 0; uiTask < TKEY_OSAL_CHECK_LOCKERS && bPassed; uiTask++) {
+        bPassed = tkey_osal_check_give(gsSem.hStartSem);
+    }
+    for(uiTask = 0; uiTask < TKEY_OSAL_CHECK_LOCKERS && bPassed; uiTask++) {
+        bPassed = tkey_osal_check_take(gsSem.hDoneSem, 10 * TKEY_OSAL_CHECK_REPLY_MS);
+    }
+    return bPassed && tkey_osal_check_take(gsSem.hLock, THINKEY_OSAL_ZERO) &&
+           (TKEY_OSAL_CHECK_LOCKERS * TKEY_OSAL_CHECK_LOCKS == gsSem.uiShared);
+}
+
+static TKey_VOID tkey_osal_check_mem_fill(TKey_BYTE *pucBuf, TKey_UINT32 uiLen,
+                                          TKey_BYTE ucSeed)
+{
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < uiLen; uiIndex++) {
+        pucBuf[uiIndex] = (TKey_BYTE)(ucSeed + uiIndex * 7);
+    }
+}
+
+/* Every size and both alignments; the guard bytes around the copy, filled
+ * alike in both destinations, must come out as memcpy leaves them */
+static TKey_BOOL tkey_osal_check_mem_copy(TKey_VOID)
+{
+    TKey_OsalCheckMemBuf_t sSrc;
+    TKey_OsalCheckMemBuf_t sDst;
+    TKey_OsalCheckMemBuf_t sRef;
+    TKey_UINT32 uiSize;
+    TKey_UINT32 uiDstOff;
+    TKey_UINT32 uiSrcOff;
+    TKey_BYTE *pucDst;
+
+    tkey_osal_check_mem_fill(sSrc.aucData, sizeof(sSrc.aucData), 0x11);
+    for(uiSize = 0; uiSize <= TKEY_OSAL_CHECK_MEM_MAX; uiSize++) {
+        for(uiDstOff = 0; uiDstOff < 4; uiDstOff++) {
+            for(uiSrcOff = 0; uiSrcOff < 4; uiSrcOff++) {
+                memset(sDst.aucData, 0xe5, sizeof(sDst.aucData));
+                memset(sRef.aucData, 0xe5, sizeof(sRef.aucData));
+                pucDst = sDst.aucData + TKEY_OSAL_CHECK_MEM_GUARD + uiDstOff;
+                if(E_THINKEY_SUCCESS != THINKey_OSAL_eMemCpy(pucDst,
+                                            sSrc.aucData + uiSrcOff, uiSize)) {
+                    return TKey_FALSE;
+                }
+                memcpy(sRef.aucData + TKEY_OSAL_CHECK_MEM_GUARD + uiDstOff,
+                       sSrc.aucData + uiSrcOff, uiSize);
+                if(0 != memcmp(sDst.aucData, sRef.aucData, sizeof(sDst.aucData))) {
+                    printf("memcpy: size %u, dst +%u, src +%u\r\n",
+                           uiSize, uiDstOff, uiSrcOff);
+                    return TKey_FALSE;
+                }
+            }
+        }
+    }
+    return TKey_TRUE;
+}
+
+/* Equal buffers, then one byte flipped at each position in turn, for
+ * every length and alignment of the second buffer */
+static TKey_BOOL tkey_osal_check_mem_compare(TKey_VOID)
+{
+    TKey_OsalCheckMemBuf_t sMem1;
+    TKey_OsalCheckMemBuf_t sMem2;
+    TKey_UINT32 uiSize;
+    TKey_UINT32 uiOff;
+    TKey_UINT32 uiPos;
+    TKey_BYTE *pucMem2;
+
+    tkey_osal_check_mem_fill(sMem1.aucData, sizeof(sMem1.aucData), 0x3c);
+    for(uiSize = 0; uiSize <= TKEY_OSAL_CHECK_MEM_MAX; uiSize++) {
+        for(uiOff = 0; uiOff < 4; uiOff++) {
+            pucMem2 = sMem2.aucData + uiOff;
+            memcpy(pucMem2, sMem1.aucData, uiSize);
+            if(!THINKey_OSAL_eMemCmp(sMem1.aucData, pucMem2, uiSize) ||
+               !THINKey_OSAL_bMemCmpConstTime(sMem1.aucData, pucMem2, uiSize)) {
+                printf("memcmp: size %u, +%u equal\r\n", uiSize, uiOff);
+                return TKey_FALSE;
+            }
+            for(uiPos = 0; uiPos < uiSize; uiPos++) {
+                pucMem2[uiPos] ^= 0x80;
+                if(THINKey_OSAL_eMemCmp(sMem1.aucData, pucMem2, uiSize) ||
+                   THINKey_OSAL_bMemCmpConstTime(sMem1.aucData, pucMem2, uiSize)) {
+                    printf("memcmp: size %u, +%u, byte %u differs\r\n",
+                           uiSize, uiOff, uiPos);
+                    return TKey_FALSE;
+                }
+                pucMem2[uiPos] ^= 0x80;
+            }
+        }
+    }
+    return TKey_TRUE;
+}
+
+/* NULL buffers are ignored by the copy and compare equal as they always
+ * have; the constant time compare, used on secrets, refuses them */
+static TKey_BOOL tkey_osal_check_mem_null(TKey_VOID)
+{
+    TKey_BYTE aucBuf[8];
+    TKey_BYTE aucRef[8];
+    TKey_BYTE aucSrc[8];
+
+    memset(aucBuf, 0xe5, sizeof(aucBuf));
+    memset(aucRef, 0xe5, sizeof(aucRef));
+    memset(aucSrc, 0x42, sizeof(aucSrc));
+    return (E_THINKEY_SUCCESS == THINKey_OSAL_eMemCpy(TKey_NULL, aucSrc,
+                                                       sizeof(aucSrc))) &&
+           (E_THINKEY_SUCCESS == THINKey_OSAL_eMemCpy(aucBuf, TKey_NULL,
+                                                       sizeof(aucBuf))) &&
+           (E_THINKEY_SUCCESS == THINKey_OSAL_eMemCpy(aucBuf, aucSrc, 0)) &&
+           (0 == memcmp(aucBuf, aucRef, sizeof(aucBuf))) &&
+           THINKey_OSAL_eMemCmp(TKey_NULL, aucSrc, sizeof(aucSrc)) &&
+           THINKey_OSAL_eMemCmp(aucSrc, TKey_NULL, sizeof(aucSrc)) &&
+           THINKey_OSAL_eMemCmp(aucBuf, aucSrc, 0) &&
+           !THINKey_OSAL_bMemCmpConstTime(TKey_NULL, aucSrc, sizeof(aucSrc)) &&
+           !THINKey_OSAL_bMemCmpConstTime(aucSrc, TKey_NULL, sizeof(aucSrc)) &&
+           THINKey_OSAL_bMemCmpConstTime(aucBuf, aucSrc, 0);
+}
+
+#if defined(THINKEY_OSAL_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiFailed = 0;
+
+    (void)argc;
+    (void)argv;
+
+    gsSem.hIsrSem = THINKey_OSAL_hCreateQueue(1, 1);
+    gsSem.hDoneSem = THINKey_OSAL_hCreateQueue(TKEY_OSAL_CHECK_LOCKERS, 1);
+    gsSem.hLock = THINKey_OSAL_hCreateQueue(1, 1);
+    gsSem.hStartSem = THINKey_OSAL_hCreateQueue(TKEY_OSAL_CHECK_LOCKERS, 1);
+    gsSem.hPark = THINKey_OSAL_hCreateQueue(1, 1);
+    if(TKey_NULL == gsSem.hIsrSem || TKey_NULL == gsSem.hDoneSem ||
+       TKey_NULL == gsSem.hLock || TKey_NULL == gsSem.hStartSem ||
+       TKey_NULL == gsSem.hPark) {
+        printf("osal check: no queues\r\n");
+        return 1;
+    }
+
+    tkey_osal_check_result("queue order", tkey_osal_check_queue_order(), &uiFailed);
+    tkey_osal_check_result("queue timeout", tkey_osal_check_queue_timeout(), &uiFailed);
+    tkey_osal_check_result("task", tkey_osal_check_task(), &uiFailed);
+    tkey_osal_check_result("static queue and task", tkey_osal_check_static(), &uiFailed);
+    tkey_osal_check_result("semaphore count", tkey_osal_check_sem_count(), &uiFailed);
+    tkey_osal_check_result("semaphore from isr", tkey_osal_check_sem_isr(), &uiFailed);
+    tkey_osal_check_result("semaphore as mutex", tkey_osal_check_sem_mutex(), &uiFailed);
+    tkey_osal_check_result("mem copy", tkey_osal_check_mem_copy(), &uiFailed);
+    tkey_osal_check_result("mem compare", tkey_osal_check_mem_compare(), &uiFailed);
+    tkey_osal_check_result("mem null and empty", tkey_osal_check_mem_null(), &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_OSAL_CHECK_MAIN */
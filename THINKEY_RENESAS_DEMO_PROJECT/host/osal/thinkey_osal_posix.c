@@ -0,0 +1,717 @@
+/*
+ * \file thinkey_osal_posix.c
+ *
+ * \brief Host POSIX port of the OSAL
+ *
+ * The pthreads counterpart of type2ab/thinkey_osal.c; the memory, buffer
+ * pool and timer wheel parts of the OSAL are shared with the target and
+ * built alongside. Queues live in their THINKey_OSAL_QueueCb_t as on the
+ * target: a mutex, two condition variables on CLOCK_MONOTONIC and a ring
+ * of items. The critical section is one recursive mutex. Task stacks are
+ * painted, as by FreeRTOS, for their high water marks, and the run time of
+ * a task is the CPU time of its thread.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define _GNU_SOURCE
+#include "thinkey_osal.h"
+#include "thinkey_osal_timer.h"
+#include "thinkey_osal_posix.h"
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef THINKEY_HOST_BUILD
+#error "thinkey_osal_posix.c is for host builds"
+#endif
+
+#ifndef THINKEY_OSAL_TIMER_STACK_WORDS
+#define THINKEY_OSAL_TIMER_STACK_WORDS 512
+#endif
+/* configTIMER_TASK_PRIORITY on the target */
+#define TKEY_OSAL_POSIX_TIMER_PRIORITY (THINKEY_OSAL_GET_MAX_TASK_PRIORITY - 2)
+
+typedef struct
+{
+	THINKey_CONST_STRING strName;
+	THINKey_pfnTaskFunction pfnTaskFunction;
+	THINKey_VOID *pvTaskParams;
+	THINKey_UINT32 uiPriority;
+	THINKey_UINT32 uiStackWords;
+	THINKey_BYTE *pbStack;
+	size_t uiStackBytes;
+	pthread_t sThread;
+	THINKey_BOOL bUsed;
+	THINKey_BOOL bReturned;
+} TKey_OsalPosixTask_t;
+
+#define TKEY_OSAL_POSIX_STACK_FILL 0xA5
+
+/* The kernel part of a THINKey_OSAL_QueueCb_t */
+typedef struct
+{
+	pthread_mutex_t sLock;
+	pthread_cond_t sNotEmpty;
+	pthread_cond_t sNotFull;
+	THINKey_BYTE *pbItems;
+	THINKey_UINT32 uiLength;
+	THINKey_UINT32 uiItemSize;
+	THINKey_UINT32 uiHead;
+	THINKey_UINT32 uiCount;
+	THINKey_UINT32 uiReceiversWaiting;
+} TKey_OsalPosixQueue_t;
+
+_Static_assert(sizeof(TKey_OsalPosixQueue_t) <=
+		sizeof(((THINKey_OSAL_QueueCb_t *)0)->apvCb),
+		"THINKEY_OSAL_QUEUE_CB_WORDS too small");
+
+#define TKEY_OSAL_POSIX_QUEUE(hQHandle) \
+	((TKey_OsalPosixQueue_t *)(THINKey_VOID *)((THINKey_OSAL_QueueCb_t *)(hQHandle))->apvCb)
+#define TKEY_OSAL_QUEUE_STATS(hQHandle) \
+	(&((THINKey_OSAL_QueueCb_t *)(hQHandle))->sStats)
+
+static pthread_mutex_t gsCritical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread THINKey_UINT32 guiCriticalNesting;
+static __thread THINKey_BOOL gbInIsr;
+
+static pthread_mutex_t gsTaskLock = PTHREAD_MUTEX_INITIALIZER;
+static TKey_OsalPosixTask_t gasTasks[TKEY_OSAL_POSIX_MAX_TASKS];
+
+static THINKey_OSAL_QueueCb_t *gpsQueueFirst;
+static THINKey_OSAL_QueueCb_t *gpsQueueLast;
+
+static pthread_mutex_t gsStartLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gsStopped = PTHREAD_COND_INITIALIZER;
+static THINKey_BOOL gbStop;
+
+static pthread_mutex_t gsTimerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gsTimerWake;
+static THINKey_BOOL gbTimerWoken;
+
+/* The target would hang or corrupt its state; the host stops at once */
+static THINKey_VOID tkey_osal_posix_may_block(const char *pcCall)
+{
+	if(gbInIsr || (guiCriticalNesting != 0))
+	{
+		fprintf(stderr, "OSAL: %s blocks %s\n", pcCall,
+				gbInIsr ? "in an ISR" : "in a critical section");
+		abort();
+	}
+}
+
+static THINKey_VOID tkey_osal_posix_cond_init(pthread_cond_t *psCond)
+{
+	pthread_condattr_t sAttr;
+
+	pthread_condattr_init(&sAttr);
+	pthread_condattr_setclock(&sAttr, CLOCK_MONOTONIC);
+	pthread_cond_init(psCond, &sAttr);
+	pthread_condattr_destroy(&sAttr);
+}
+
+static THINKey_VOID tkey_osal_posix_deadline(struct timespec *psDeadline,
+		THINKey_UINT32 uiTimeoutMs)
+{
+	clock_gettime(CLOCK_MONOTONIC, psDeadline);
+	psDeadline->tv_sec += uiTimeoutMs / 1000;
+	psDeadline->tv_nsec += (long)(uiTimeoutMs % 1000) * 1000000L;
+	if(psDeadline->tv_nsec >= 1000000000L)
+	{
+		psDeadline->tv_sec++;
+		psDeadline->tv_nsec -= 1000000000L;
+	}
+}
+
+/* Waits on psCond until woken, or until the deadline unless the wait is
+ * THINKEY_OSAL_FOREVER. Returns TKey_FALSE once the deadline passed. */
+static THINKey_BOOL tkey_osal_posix_wait(pthread_cond_t *psCond,
+		pthread_mutex_t *psLock, THINKey_UINT32 uiTimeoutMs,
+		const struct timespec *psDeadline)
+{
+	if(uiTimeoutMs == THINKEY_OSAL_FOREVER)
+	{
+		pthread_cond_wait(psCond, psLock);
+		return THINKey_TRUE;
+	}
+	return (pthread_cond_timedwait(psCond, psLock, psDeadline) != ETIMEDOUT) ?
+			THINKey_TRUE : THINKey_FALSE;
+}
+
+/* Tasks */
+
+static THINKey_VOID* tkey_osal_posix_task(THINKey_VOID *pvTask)
+{
+	TKey_OsalPosixTask_t *psTask = (TKey_OsalPosixTask_t *)pvTask;
+
+	pthread_setname_np(pthread_self(), psTask->strName);
+	psTask->pfnTaskFunction(psTask->pvTaskParams);
+
+	/* A task returning is a bug on the target. The slot is not reused,
+	 * as the thread may still be on its stack. */
+	fprintf(stderr, "OSAL: task %s returned\n", psTask->strName);
+	pthread_mutex_lock(&gsTaskLock);
+	psTask->bReturned = THINKey_TRUE;
+	pthread_mutex_unlock(&gsTaskLock);
+
+	return NULL;
+}
+
+THINKey_eStatusType
+THINKey_OSAL_eCreateTask
+(THINKey_CONST_STRING strTaskName, THINKey_pfnTaskFunction pfnTaskFunction,
+THINKey_VOID* pvTaskParams, THINKey_UINT32 uiTaskPriority,
+THINKey_UINT32 uiStackSize,THINKey_UINT32* puiTaskID)
+{
+	TKey_OsalPosixTask_t *psTask = THINKey_NULL;
+	pthread_attr_t sAttr;
+	size_t uiStackBytes;
+	THINKey_UINT32 uiIndex;
+	int iResult;
+
+	if(pfnTaskFunction == THINKey_NULL)
+		return E_THINKEY_FAILURE;
+
+	/* As the scheduler start does on the target */
+	THINKey_OSAL_vRunTimeCounterInit();
+
+	pthread_mutex_lock(&gsTaskLock);
+	for(uiIndex = 0; uiIndex < TKEY_OSAL_POSIX_MAX_TASKS; uiIndex++)
+	{
+		if(!gasTasks[uiIndex].bUsed)
+		{
+			psTask = &gasTasks[uiIndex];
+			break;
+		}
+	}
+	if(psTask == THINKey_NULL)
+	{
+		pthread_mutex_unlock(&gsTaskLock);
+		return E_THINKEY_FAILURE;
+	}
+	psTask->strName = (strTaskName != THINKey_NULL) ? strTaskName : "task";
+	psTask->pfnTaskFunction = pfnTaskFunction;
+	psTask->pvTaskParams = pvTaskParams;
+	psTask->uiPriority = uiTaskPriority;
+	psTask->uiStackWords = uiStackSize;
+	psTask->bReturned = THINKey_FALSE;
+
+	uiStackBytes = (size_t)uiStackSize * TKEY_OSAL_POSIX_STACK_SCALE;
+	if(uiStackBytes < TKEY_OSAL_POSIX_MIN_STACK)
+		uiStackBytes = TKEY_OSAL_POSIX_MIN_STACK;
+	uiStackBytes = (uiStackBytes + 4095) & ~(size_t)4095;
+	if(posix_memalign((void **)&psTask->pbStack, 4096, uiStackBytes) != 0)
+	{
+		pthread_mutex_unlock(&gsTaskLock);
+		return E_THINKEY_FAILURE;
+	}
+	memset(psTask->pbStack, TKEY_OSAL_POSIX_STACK_FILL, uiStackBytes);
+	psTask->uiStackBytes = uiStackBytes;
+	psTask->bUsed = THINKey_TRUE;
+
+	pthread_attr_init(&sAttr);
+	pthread_attr_setstack(&sAttr, psTask->pbStack, uiStackBytes);
+	pthread_attr_setdetachstate(&sAttr, PTHREAD_CREATE_DETACHED);
+	iResult = pthread_create(&psTask->sThread, &sAttr, tkey_osal_posix_task, psTask);
+	pthread_attr_destroy(&sAttr);
+	if(iResult != 0)
+	{
+		free(psTask->pbStack);
+		psTask->pbStack = THINKey_NULL;
+		psTask->bUsed = THINKey_FALSE;
+	}
+	pthread_mutex_unlock(&gsTaskLock);
+
+	if(iResult != 0)
+		return E_THINKEY_FAILURE;
+
+	/* The task number, from 1 */
+	if(puiTaskID != THINKey_NULL)
+		*puiTaskID = uiIndex + 1;
+
+	return E_THINKEY_SUCCESS;
+}
+
+/* The stack is sized for the target and not used: see
+ * TKEY_OSAL_POSIX_STACK_SCALE */
+THINKey_eStatusType
+THINKey_OSAL_eCreateStaticTask
+(THINKey_CONST_STRING strTaskName, THINKey_pfnTaskFunction pfnTaskFunction,
+THINKey_VOID* pvTaskParams, THINKey_UINT32 uiTaskPriority,
+THINKey_UINT32 uiStackSize, THINKey_UINT32* puiStack,
+THINKey_OSAL_TaskCb_t* psTaskCb, THINKey_UINT32* puiTaskID)
+{
+	if((puiStack == THINKey_NULL) || (psTaskCb == THINKey_NULL))
+		return E_THINKEY_FAILURE;
+
+	return THINKey_OSAL_eCreateTask(strTaskName, pfnTaskFunction, pvTaskParams,
+			uiTaskPriority, uiStackSize, puiTaskID);
+}
+
+THINKey_VOID THINKey_OSAL_vOSStart(THINKey_VOID)
+{
+	pthread_mutex_lock(&gsStartLock);
+	while(!gbStop)
+		pthread_cond_wait(&gsStopped, &gsStartLock);
+	gbStop = THINKey_FALSE;
+	pthread_mutex_unlock(&gsStartLock);
+}
+
+TKey_VOID TKey_OsalPosix_Stop(TKey_VOID)
+{
+	pthread_mutex_lock(&gsStartLock);
+	gbStop = THINKey_TRUE;
+	pthread_cond_broadcast(&gsStopped);
+	pthread_mutex_unlock(&gsStartLock);
+}
+
+TKey_VOID THINKey_OSAL_Delay(TKey_UINT32 uiDelayMs)
+{
+	struct timespec sDelay;
+
+	tkey_osal_posix_may_block("THINKey_OSAL_Delay");
+	sDelay.tv_sec = uiDelayMs / 1000;
+	sDelay.tv_nsec = (long)(uiDelayMs % 1000) * 1000000L;
+	while((nanosleep(&sDelay, &sDelay) != 0) && (errno == EINTR))
+		;
+}
+
+/* Task statistics */
+
+/* Bytes at the bottom of the stack the thread never wrote */
+static THINKey_UINT32 tkey_osal_posix_stack_free(const TKey_OsalPosixTask_t *psTask)
+{
+	size_t uiFree = 0;
+
+	while((uiFree < psTask->uiStackBytes) &&
+		  (psTask->pbStack[uiFree] == TKEY_OSAL_POSIX_STACK_FILL))
+		uiFree++;
+
+	return (THINKey_UINT32)uiFree;
+}
+
+THINKey_UINT32 THINKey_OSAL_uiTaskGetStats
+(THINKey_OSAL_TaskStats_t* pasStats, THINKey_UINT32 uiMaxTasks,
+		THINKey_UINT32* puiRunTime)
+{
+	TKey_OsalPosixTask_t *psTask;
+	struct timespec sCpu;
+	clockid_t sClock;
+	THINKey_UINT32 uiCount = 0;
+	THINKey_UINT32 uiIndex;
+
+	if(pasStats == THINKey_NULL)
+		return 0;
+
+	pthread_mutex_lock(&gsTaskLock);
+	if(puiRunTime != THINKey_NULL)
+		*puiRunTime = THINKey_OSAL_uiRunTimeCounter();
+	for(uiIndex = 0; (uiIndex < TKEY_OSAL_POSIX_MAX_TASKS) && (uiCount < uiMaxTasks);
+			uiIndex++)
+	{
+		psTask = &gasTasks[uiIndex];
+		if(!psTask->bUsed || psTask->bReturned)
+			continue;
+		pasStats[uiCount].strName = psTask->strName;
+		pasStats[uiCount].uiTaskNumber = uiIndex + 1;
+		pasStats[uiCount].uiPriority = psTask->uiPriority;
+		pasStats[uiCount].uiRunTime = 0;
+		if((pthread_getcpuclockid(psTask->sThread, &sClock) == 0) &&
+		   (clock_gettime(sClock, &sCpu) == 0))
+			pasStats[uiCount].uiRunTime = (THINKey_UINT32)
+					((THINKey_UINT64)sCpu.tv_sec * 1000000u + sCpu.tv_nsec / 1000);
+		/* In words of the host stack, which is TKEY_OSAL_POSIX_STACK_SCALE
+		 * times larger */
+		pasStats[uiCount].uiStackFreeMin = tkey_osal_posix_stack_free(psTask) /
+				sizeof(THINKey_UINT32);
+		uiCount++;
+	}
+	pthread_mutex_unlock(&gsTaskLock);
+
+	return uiCount;
+}
+
+/* The run time counter is CLOCK_MONOTONIC in us from its first use, the
+ * run time of a task the CPU time of its thread */
+static pthread_once_t gsRunTimeOnce = PTHREAD_ONCE_INIT;
+static THINKey_UINT64 gullRunTimeBase;
+
+static THINKey_UINT64 tkey_osal_posix_monotonic_us(THINKey_VOID)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return (THINKey_UINT64)sNow.tv_sec * 1000000u + (THINKey_UINT64)sNow.tv_nsec / 1000u;
+}
+
+static THINKey_VOID tkey_osal_posix_run_time_base(THINKey_VOID)
+{
+	gullRunTimeBase = tkey_osal_posix_monotonic_us();
+}
+
+THINKey_VOID THINKey_OSAL_vRunTimeCounterInit(THINKey_VOID)
+{
+	pthread_once(&gsRunTimeOnce, tkey_osal_posix_run_time_base);
+}
+
+THINKey_UINT32 THINKey_OSAL_uiRunTimeCounter(THINKey_VOID)
+{
+	THINKey_OSAL_vRunTimeCounterInit();
+	return (THINKey_UINT32)(tkey_osal_posix_monotonic_us() - gullRunTimeBase);
+}
+
+THINKey_UINT32 THINKey_OSAL_uiRunTimeCounterHz(THINKey_VOID)
+{
+	return 1000000u;
+}
+
+TKey_UINT32 TKey_OsalPosix_NowMs(TKey_VOID)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return (TKey_UINT32)((THINKey_UINT64)sNow.tv_sec * 1000u +
+			(THINKey_UINT64)sNow.tv_nsec / 1000000u);
+}
+
+/* Critical sections and interrupts */
+
+TKey_VOID THINKey_OSAL_vEnterCritical(TKey_VOID)
+{
+	pthread_mutex_lock(&gsCritical);
+	guiCriticalNesting++;
+}
+
+TKey_VOID THINKey_OSAL_vExitCritical(TKey_VOID)
+{
+	guiCriticalNesting--;
+	pthread_mutex_unlock(&gsCritical);
+}
+
+TKey_VOID TKey_OsalPosix_RunIsr(TKey_OsalPosixIsr_t pfnIsr, TKey_VOID *pvArg)
+{
+	TKey_BOOL bWasInIsr = gbInIsr;
+
+	/* Masked by the critical sections of the tasks, as on the target */
+	pthread_mutex_lock(&gsCritical);
+	gbInIsr = THINKey_TRUE;
+	pfnIsr(pvArg);
+	gbInIsr = bWasInIsr;
+	pthread_mutex_unlock(&gsCritical);
+}
+
+TKey_BOOL TKey_OsalPosix_InIsr(TKey_VOID)
+{
+	return gbInIsr;
+}
+
+/* Queues */
+
+THINKey_HANDLE THINKey_OSAL_hCreateStaticQueue
+(THINKey_UINT32 uiNumQElements, THINKey_UINT32 uiQElementSize,
+THINKey_BYTE* pbStorage, THINKey_UINT32 uiStorageSize,
+THINKey_OSAL_QueueCb_t* psQueueCb)
+{
+	TKey_OsalPosixQueue_t *psQueue;
+
+	if((pbStorage == THINKey_NULL) || (psQueueCb == THINKey_NULL) ||
+	   (uiNumQElements == 0) || (uiQElementSize == 0) ||
+	   (uiNumQElements * uiQElementSize > uiStorageSize))
+		return THINKey_NULL;
+
+	psQueue = TKEY_OSAL_POSIX_QUEUE(psQueueCb);
+	pthread_mutex_init(&psQueue->sLock, NULL);
+	tkey_osal_posix_cond_init(&psQueue->sNotEmpty);
+	tkey_osal_posix_cond_init(&psQueue->sNotFull);
+	psQueue->pbItems = pbStorage;
+	psQueue->uiLength = uiNumQElements;
+	psQueue->uiItemSize = uiQElementSize;
+	psQueue->uiHead = 0;
+	psQueue->uiCount = 0;
+	psQueue->uiReceiversWaiting = 0;
+	psQueueCb->sStats.uiSent = 0;
+	psQueueCb->sStats.uiDropped = 0;
+	psQueueCb->sStats.uiMaxDepth = 0;
+	psQueueCb->sStats.uiDepth = 0;
+	psQueueCb->strName = THINKey_NULL;
+	psQueueCb->pvNext = THINKey_NULL;
+
+	THINKey_OSAL_vEnterCritical();
+	if(gpsQueueLast != THINKey_NULL)
+		gpsQueueLast->pvNext = psQueueCb;
+	else
+		gpsQueueFirst = psQueueCb;
+	gpsQueueLast = psQueueCb;
+	THINKey_OSAL_vExitCritical();
+
+	return (THINKey_HANDLE)psQueueCb;
+}
+
+THINKey_HANDLE THINKey_OSAL_hCreateQueue
+(THINKey_UINT32 uiNumQElements, THINKey_UINT32 uiQElementSize)
+{
+	THINKey_OSAL_QueueCb_t *psQueueCb;
+	THINKey_UINT32 uiStorageSize = uiNumQElements * uiQElementSize;
+	THINKey_HANDLE hQueue;
+
+	/* Control block and items in one allocation */
+	psQueueCb = malloc(sizeof(THINKey_OSAL_QueueCb_t) + uiStorageSize);
+	if(psQueueCb == THINKey_NULL)
+		return THINKey_NULL;
+
+	hQueue = THINKey_OSAL_hCreateStaticQueue(uiNumQElements, uiQElementSize,
+			(THINKey_BYTE *)(psQueueCb + 1), uiStorageSize, psQueueCb);
+	if(hQueue == THINKey_NULL)
+		free(psQueueCb);
+
+	return hQueue;
+}
+
+static THINKey_eStatusType tkey_osal_posix_receive
+(THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage, THINKey_UINT32 uiTimeoutMs)
+{
+	TKey_OsalPosixQueue_t *psQueue;
+	struct timespec sDeadline;
+	THINKey_BOOL bWaited = THINKey_TRUE;
+
+	if((hQHandle == THINKey_NULL) || (pvMessage == THINKey_NULL))
+		return E_THINKEY_FAILURE;
+
+	psQueue = TKEY_OSAL_POSIX_QUEUE(hQHandle);
+	if(uiTimeoutMs != THINKEY_OSAL_ZERO)
+	{
+		tkey_osal_posix_may_block("queue receive");
+		tkey_osal_posix_deadline(&sDeadline, uiTimeoutMs);
+	}
+
+	pthread_mutex_lock(&psQueue->sLock);
+	psQueue->uiReceiversWaiting++;
+	while((psQueue->uiCount == 0) && (uiTimeoutMs != THINKEY_OSAL_ZERO) && bWaited)
+		bWaited = tkey_osal_posix_wait(&psQueue->sNotEmpty, &psQueue->sLock,
+				uiTimeoutMs, &sDeadline);
+	psQueue->uiReceiversWaiting--;
+	if(psQueue->uiCount == 0)
+	{
+		pthread_mutex_unlock(&psQueue->sLock);
+		return E_THINKEY_FAILURE;
+	}
+	memcpy(pvMessage, psQueue->pbItems + psQueue->uiHead * psQueue->uiItemSize,
+			psQueue->uiItemSize);
+	psQueue->uiHead = (psQueue->uiHead + 1) % psQueue->uiLength;
+	psQueue->uiCount--;
+	pthread_cond_signal(&psQueue->sNotFull);
+	pthread_mutex_unlock(&psQueue->sLock);
+
+	return E_THINKEY_SUCCESS;
+}
+
+THINKey_eStatusType	THINKey_OSAL_eQueueReceive
+(THINKey_HANDLE hQHandle,THINKey_VOID* pvMessage)
+{
+	return tkey_osal_posix_receive(hQHandle, pvMessage, THINKEY_OSAL_FOREVER);
+}
+
+THINKey_eStatusType	THINKey_OSAL_eTimedQueueReceive
+(THINKey_HANDLE hQHandle,THINKey_VOID* pvMessage, TKey_UINT32 uiTimeout)
+{
+	return tkey_osal_posix_receive(hQHandle, pvMessage, uiTimeout);
+}
+
+/* Sends, counting the send or the drop. Sets *pbWoken when a receiver was
+ * waiting. */
+static THINKey_eStatusType tkey_osal_posix_send
+(THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage, THINKey_UINT32 uiTimeoutMs,
+THINKey_OSAL_eQueuePosType ePos, THINKey_BOOL *pbWoken)
+{
+	THINKey_OSAL_QueueStats_t *psStats;
+	TKey_OsalPosixQueue_t *psQueue;
+	struct timespec sDeadline;
+	THINKey_BOOL bWaited = THINKey_TRUE;
+	THINKey_UINT32 uiSlot;
+
+	if((hQHandle == THINKey_NULL) || (pvMessage == THINKey_NULL))
+		return E_THINKEY_FAILURE;
+
+	psQueue = TKEY_OSAL_POSIX_QUEUE(hQHandle);
+	psStats = TKEY_OSAL_QUEUE_STATS(hQHandle);
+	if(uiTimeoutMs != THINKEY_OSAL_ZERO)
+	{
+		tkey_osal_posix_may_block("queue send");
+		tkey_osal_posix_deadline(&sDeadline, uiTimeoutMs);
+	}
+
+	pthread_mutex_lock(&psQueue->sLock);
+	while((psQueue->uiCount == psQueue->uiLength) &&
+		  (uiTimeoutMs != THINKEY_OSAL_ZERO) && bWaited)
+		bWaited = tkey_osal_posix_wait(&psQueue->sNotFull, &psQueue->sLock,
+				uiTimeoutMs, &sDeadline);
+	if(psQueue->uiCount == psQueue->uiLength)
+	{
+		psStats->uiDropped++;
+		pthread_mutex_unlock(&psQueue->sLock);
+		return E_THINKEY_FAILURE;
+	}
+
+	if(ePos == E_THINKEY_OSAL_QUEUE_FRONT)
+	{
+		psQueue->uiHead = (psQueue->uiHead + psQueue->uiLength - 1) % psQueue->uiLength;
+		uiSlot = psQueue->uiHead;
+	}
+	else
+	{
+		uiSlot = (psQueue->uiHead + psQueue->uiCount) % psQueue->uiLength;
+	}
+	memcpy(psQueue->pbItems + uiSlot * psQueue->uiItemSize, pvMessage,
+			psQueue->uiItemSize);
+	psQueue->uiCount++;
+	psStats->uiSent++;
+	if(psQueue->uiCount > psStats->uiMaxDepth)
+		psStats->uiMaxDepth = psQueue->uiCount;
+	if(pbWoken != THINKey_NULL)
+		*pbWoken = (psQueue->uiReceiversWaiting != 0);
+	pthread_cond_signal(&psQueue->sNotEmpty);
+	pthread_mutex_unlock(&psQueue->sLock);
+
+	return E_THINKEY_SUCCESS;
+}
+
+THINKey_eStatusType THINKey_OSAL_eQueueSend
+(THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage)
+{
+	/* Do not wait if no space is available in the queue.*/
+	return tkey_osal_posix_send(hQHandle, pvMessage, THINKEY_OSAL_ZERO,
+			E_THINKEY_OSAL_QUEUE_BACK, THINKey_NULL);
+}
+
+THINKey_eStatusType THINKey_OSAL_eQueueSendTimed
+(THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
+THINKey_UINT32 uiTimeoutMs, THINKey_OSAL_eQueuePosType ePos)
+{
+	return tkey_osal_posix_send(hQHandle, pvMessage, uiTimeoutMs, ePos,
+			THINKey_NULL);
+}
+
+THINKey_eStatusType THINKey_OSAL_eQueueSendToFromISR(
+        THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
+        THINKey_HANDLE hHigherPriorityTaskWoken)
+{
+	/* To the back, not to overtake the messages of the tasks */
+	return THINKey_OSAL_eQueueSendFromISR(hQHandle, pvMessage,
+			E_THINKEY_OSAL_QUEUE_BACK, hHigherPriorityTaskWoken);
+}
+
+THINKey_eStatusType THINKey_OSAL_eQueueSendFromISR(
+        THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
+        THINKey_OSAL_eQueuePosType ePos,
+        THINKey_HANDLE hHigherPriorityTaskWoken)
+{
+	THINKey_eStatusType eStatus;
+	THINKey_BOOL bWoken = THINKey_FALSE;
+
+	eStatus = tkey_osal_posix_send(hQHandle, pvMessage, THINKEY_OSAL_ZERO,
+			ePos, &bWoken);
+	/* Only ever set, as by FreeRTOS */
+	if(bWoken && (hHigherPriorityTaskWoken != THINKey_NULL))
+		*(TKey_UINT32 *)hHigherPriorityTaskWoken = TKey_TRUE;
+
+	return eStatus;
+}
+
+THINKey_VOID THINKey_OSAL_vQueueGetStats
+(THINKey_HANDLE hQHandle, THINKey_OSAL_QueueStats_t* psStats)
+{
+	TKey_OsalPosixQueue_t *psQueue;
+
+	if((hQHandle == THINKey_NULL) || (psStats == THINKey_NULL))
+		return;
+
+	psQueue = TKEY_OSAL_POSIX_QUEUE(hQHandle);
+	pthread_mutex_lock(&psQueue->sLock);
+	*psStats = *TKEY_OSAL_QUEUE_STATS(hQHandle);
+	psStats->uiDepth = psQueue->uiCount;
+	pthread_mutex_unlock(&psQueue->sLock);
+}
+
+THINKey_VOID THINKey_OSAL_vQueueSetName
+(THINKey_HANDLE hQHandle, THINKey_CONST_STRING strName)
+{
+	if(hQHandle == THINKey_NULL)
+		return;
+
+	((THINKey_OSAL_QueueCb_t *)hQHandle)->strName = strName;
+}
+
+THINKey_CONST_STRING THINKey_OSAL_strQueueGetName
+(THINKey_HANDLE hQHandle)
+{
+	if(hQHandle == THINKey_NULL)
+		return THINKey_NULL;
+
+	return ((THINKey_OSAL_QueueCb_t *)hQHandle)->strName;
+}
+
+THINKey_UINT32 THINKey_OSAL_uiQueueList
+(THINKey_HANDLE* phQueues, THINKey_UINT32 uiMaxQueues)
+{
+	THINKey_OSAL_QueueCb_t *psQueueCb;
+	THINKey_UINT32 uiCount = 0;
+
+	THINKey_OSAL_vEnterCritical();
+	for(psQueueCb = gpsQueueFirst; psQueueCb != THINKey_NULL;
+			psQueueCb = (THINKey_OSAL_QueueCb_t *)psQueueCb->pvNext)
+	{
+		if((phQueues != THINKey_NULL) && (uiCount < uiMaxQueues))
+			phQueues[uiCount] = (THINKey_HANDLE)psQueueCb;
+		uiCount++;
+	}
+	THINKey_OSAL_vExitCritical();
+
+	return uiCount;
+}
+
+/* Timer service port, see thinkey_osal_timer.c */
+
+static THINKey_VOID tkey_osal_posix_timer_service(THINKey_VOID *pvParams)
+{
+	struct timespec sDeadline;
+	THINKey_UINT32 uiWait;
+	(void)pvParams;
+
+	for(;;)
+	{
+		uiWait = THINKey_OSAL_uiTimerService(THINKey_OSAL_uiTimerPortNow());
+		if(uiWait != THINKEY_OSAL_FOREVER)
+			tkey_osal_posix_deadline(&sDeadline, uiWait);
+		pthread_mutex_lock(&gsTimerLock);
+		if(!gbTimerWoken)
+			(void)tkey_osal_posix_wait(&gsTimerWake, &gsTimerLock, uiWait, &sDeadline);
+		gbTimerWoken = THINKey_FALSE;
+		pthread_mutex_unlock(&gsTimerLock);
+	}
+}
+
+THINKey_UINT32 THINKey_OSAL_uiTimerPortNow(THINKey_VOID)
+{
+	return TKey_OsalPosix_NowMs();
+}
+
+THINKey_eStatusType THINKey_OSAL_eTimerPortStart(THINKey_VOID)
+{
+	tkey_osal_posix_cond_init(&gsTimerWake);
+	return THINKey_OSAL_eCreateTask("OSAL Timers", tkey_osal_posix_timer_service,
+			THINKey_NULL, TKEY_OSAL_POSIX_TIMER_PRIORITY, THINKEY_OSAL_TIMER_STACK_WORDS,
+			THINKey_NULL);
+}
+
+THINKey_VOID THINKey_OSAL_vTimerPortWake(THINKey_VOID)
+{
+	pthread_mutex_lock(&gsTimerLock);
+	gbTimerWoken = THINKey_TRUE;
+	pthread_cond_signal(&gsTimerWake);
+	pthread_mutex_unlock(&gsTimerLock);
+}
@@ -0,0 +1,72 @@
+/*
+ * \file thinkey_osal_posix.h
+ *
+ * \brief Host POSIX port of the OSAL, host only calls
+ *
+ * thinkey_osal_posix.c implements all of thinkey_osal.h on pthreads, so
+ * the THINKey layers above the OSAL run on a Linux host against the
+ * simulators in host/. The differences from the FreeRTOS port:
+ *
+ * - Tasks are threads and run truly in parallel, with no priorities. Any
+ *   data shared without a queue must be under the critical section, which
+ *   is stricter than the single core target, not looser.
+ * - Interrupts are emulated with TKey_OsalPosix_RunIsr(): the handler
+ *   runs on the calling thread, excluded from the critical sections as by
+ *   the interrupt mask on the target.
+ * - Blocking in an ISR or in a critical section, which the target only
+ *   survives by luck, aborts with a message naming the call.
+ * - THINKey_OSAL_vOSStart() returns once TKey_OsalPosix_Stop() is called,
+ *   so a test can tear down.
+ * - Time is CLOCK_MONOTONIC in ms.
+ * - The run time counter counts us; the run time of a task is the CPU
+ *   time of its thread, and its stack high water mark is in words of the
+ *   larger host stack.
+ *
+ * Host builds only (THINKEY_HOST_BUILD); see host/CMakeLists.txt.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_OSAL_POSIX_H
+#define THINKEY_OSAL_POSIX_H
+
+#include "thinkey_platform_types.h"
+
+#ifndef TKEY_OSAL_POSIX_MAX_TASKS
+#define TKEY_OSAL_POSIX_MAX_TASKS 32
+#endif
+/* Host threads need far more stack than the target tasks: each gets its
+ * stack size in words times this, in bytes, and at least the minimum */
+#ifndef TKEY_OSAL_POSIX_STACK_SCALE
+#define TKEY_OSAL_POSIX_STACK_SCALE 64
+#endif
+#ifndef TKEY_OSAL_POSIX_MIN_STACK
+#define TKEY_OSAL_POSIX_MIN_STACK (256 * 1024)
+#endif
+
+typedef TKey_VOID (*TKey_OsalPosixIsr_t)(TKey_VOID *pvArg);
+
+/**
+ * \brief   Runs pfnIsr as an interrupt handler: not during a critical
+ *          section, and with the blocking calls refused. The FromISR calls
+ *          set their higher priority task woken argument, a TKey_UINT32 on
+ *          the host, when they wake a waiting task.
+ */
+TKey_VOID TKey_OsalPosix_RunIsr(TKey_OsalPosixIsr_t pfnIsr, TKey_VOID *pvArg);
+
+/**
+ * \brief   Returns TKey_TRUE in TKey_OsalPosix_RunIsr()
+ */
+TKey_BOOL TKey_OsalPosix_InIsr(TKey_VOID);
+
+/**
+ * \brief   Returns the OSAL time, in ms
+ */
+TKey_UINT32 TKey_OsalPosix_NowMs(TKey_VOID);
+
+/**
+ * \brief   Makes THINKey_OSAL_vOSStart() return. The tasks keep running.
+ */
+TKey_VOID TKey_OsalPosix_Stop(TKey_VOID);
+
+#endif /* THINKEY_OSAL_POSIX_H */
@@ -0,0 +1,246 @@
+/*
+ * \file thinkey_psa_drv_check.c
+ *
+ * \brief PSA crypto check through the THINKey driver entry points
+ *
+ * Generates, signs with, verifies with and exports P-256 keys through the
+ * psa_* API, built with MBEDTLS_PSA_CRYPTO_C, MBEDTLS_PSA_CRYPTO_DRIVERS
+ * and TKEY_PSA_CRYPTO_DRIVER as on the target. Local keys go to a counting
+ * accelerator registered with the crypto driver layer, keys in
+ * TKEY_PSA_CRYPTO_LOCATION to the THINKey opaque driver, and random bytes
+ * come from the source set with TKey_Crypto_SetRng(). Host builds only;
+ * built with THINKEY_PSA_DRV_CHECK_MAIN it is a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_crypto_psa_drv.h"
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(MBEDTLS_PSA_CRYPTO_C) || !defined(MBEDTLS_PSA_CRYPTO_DRIVERS) || \
+    !defined(TKEY_PSA_CRYPTO_DRIVER) || !defined(MBEDTLS_PSA_CRYPTO_EXTERNAL_RNG)
+#error "config.h must enable the PSA core, its drivers and the THINKey driver"
+#endif
+
+#define TKEY_PSA_DRV_CHECK_ALG PSA_ALG_ECDSA(PSA_ALG_SHA_256)
+
+/* Calls that reached the accelerator, by operation */
+typedef struct
+{
+    TKey_UINT32 uiPublicKey;
+    TKey_UINT32 uiSign;
+    TKey_UINT32 uiVerify;
+} TKey_PsaDrvCheckCalls_t;
+
+static TKey_PsaDrvCheckCalls_t gsCalls;
+static TKey_UINT32 guiRngState = 0x2545f491;
+static TKey_UINT32 guiRngBytes;
+
+static TKey_VOID tkey_psa_drv_check_result(const TKey_CHAR *pcCheck,
+                                           TKey_BOOL bPassed,
+                                           TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+/* xorshift32: reproducible keys for the check, not for real use */
+static int tkey_psa_drv_check_rng(TKey_VOID *pvCtx, unsigned char *pucOut,
+                                  size_t uiLen)
+{
+    (void)pvCtx;
+    while(uiLen--) {
+        guiRngState ^= guiRngState << 13;
+        guiRngState ^= guiRngState >> 17;
+        guiRngState ^= guiRngState << 5;
+        *pucOut++ = (unsigned char)guiRngState;
+        guiRngBytes++;
+    }
+    return 0;
+}
+
+/* Accelerator standing in for the SCE: counts and defers to software */
+static TKey_CryptoStatus_t tkey_psa_drv_check_public_key(
+        const TKey_BYTE *pucPriv, TKey_BYTE *pucPub)
+{
+    gsCalls.uiPublicKey++;
+    return gsTKeyCryptoSwDriver.eEcP256PublicKey(pucPriv, pucPub);
+}
+
+static TKey_CryptoStatus_t tkey_psa_drv_check_sign(const TKey_BYTE *pucPriv,
+        const TKey_BYTE *pucHash, TKey_BYTE *pucSig)
+{
+    gsCalls.uiSign++;
+    return gsTKeyCryptoSwDriver.eEcdsaP256Sign(pucPriv, pucHash, pucSig);
+}
+
+static TKey_CryptoStatus_t tkey_psa_drv_check_verify(const TKey_BYTE *pucPub,
+        const TKey_BYTE *pucHash, const TKey_BYTE *pucSig)
+{
+    gsCalls.uiVerify++;
+    return gsTKeyCryptoSwDriver.eEcdsaP256Verify(pucPub, pucHash, pucSig);
+}
+
+static const TKey_CryptoTransparentDrv_t gsCheckAccel =
+{
+    "psa check accel",
+    TKEY_CRYPTO_DRIVER_ID_NONE,
+    TKey_NULL,
+    TKey_NULL,
+    TKey_NULL,
+    TKey_NULL,
+    TKey_NULL,
+    TKey_NULL,
+    tkey_psa_drv_check_public_key,
+    TKey_NULL,
+    tkey_psa_drv_check_sign,
+    tkey_psa_drv_check_verify
+};
+
+static TKey_VOID tkey_psa_drv_check_attributes(psa_key_attributes_t *psAttr,
+                                               psa_key_location_t location)
+{
+    *psAttr = psa_key_attributes_init();
+    psa_set_key_type(psAttr,
+                     PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(psAttr, 256);
+    psa_set_key_usage_flags(psAttr, PSA_KEY_USAGE_SIGN_HASH |
+                                    PSA_KEY_USAGE_VERIFY_HASH |
+                                    PSA_KEY_USAGE_EXPORT);
+    psa_set_key_algorithm(psAttr, TKEY_PSA_DRV_CHECK_ALG);
+    psa_set_key_lifetime(psAttr,
+            PSA_KEY_LIFETIME_FROM_PERSISTENCE_AND_LOCATION(
+                    PSA_KEY_PERSISTENCE_VOLATILE, location));
+}
+
+/* Sign and verify with hKey, reject a tampered signature, then check the
+ * exported public key against the signature on its own */
+static TKey_BOOL tkey_psa_drv_check_key(psa_key_id_t hKey)
+{
+    TKey_BYTE aucHash[TKEY_CRYPTO_SHA256_SIZE];
+    TKey_BYTE aucSig[PSA_SIGNATURE_MAX_SIZE];
+    TKey_BYTE aucPub[PSA_EXPORT_PUBLIC_KEY_MAX_SIZE];
+    psa_key_attributes_t sAttr = PSA_KEY_ATTRIBUTES_INIT;
+    psa_key_id_t hPub = 0;
+    size_t uiSigLen = 0;
+    size_t uiPubLen = 0;
+    TKey_BOOL bPassed;
+
+    memset(aucHash, 0xa5, sizeof(aucHash));
+    bPassed = (PSA_SUCCESS == psa_sign_hash(hKey, TKEY_PSA_DRV_CHECK_ALG,
+                                  aucHash, sizeof(aucHash), aucSig,
+                                  sizeof(aucSig), &uiSigLen)) &&
+              (TKEY_CRYPTO_P256_SIG_SIZE == uiSigLen) &&
+              (PSA_SUCCESS == psa_verify_hash(hKey, TKEY_PSA_DRV_CHECK_ALG,
+                                  aucHash, sizeof(aucHash), aucSig, uiSigLen));
+    if(!bPassed) {
+        return TKey_FALSE;
+    }
+    aucSig[7] ^= 0x10;
+    bPassed = (PSA_ERROR_INVALID_SIGNATURE == psa_verify_hash(hKey,
+                                  TKEY_PSA_DRV_CHECK_ALG, aucHash,
+                                  sizeof(aucHash), aucSig, uiSigLen));
+    aucSig[7] ^= 0x10;
+
+    bPassed = bPassed &&
+              (PSA_SUCCESS == psa_export_public_key(hKey, aucPub,
+                                  sizeof(aucPub), &uiPubLen)) &&
+              (TKEY_CRYPTO_P256_PUB_KEY_SIZE == uiPubLen) &&
+              (0x04 == aucPub[0]);
+    if(!bPassed) {
+        return TKey_FALSE;
+    }
+    psa_set_key_type(&sAttr,
+                     PSA_KEY_TYPE_ECC_PUBLIC_KEY(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&sAttr, 256);
+    psa_set_key_usage_flags(&sAttr, PSA_KEY_USAGE_VERIFY_HASH);
+    psa_set_key_algorithm(&sAttr, TKEY_PSA_DRV_CHECK_ALG);
+    bPassed = (PSA_SUCCESS == psa_import_key(&sAttr, aucPub, uiPubLen,
+                                             &hPub)) &&
+              (PSA_SUCCESS == psa_verify_hash(hPub, TKEY_PSA_DRV_CHECK_ALG,
+                                  aucHash, sizeof(aucHash), aucSig, uiSigLen));
+    psa_destroy_key(hPub);
+    return bPassed;
+}
+
+/* Local key: PSA holds the material, the accelerator does the work */
+static TKey_BOOL tkey_psa_drv_check_transparent(TKey_VOID)
+{
+    psa_key_attributes_t sAttr;
+    psa_key_id_t hKey = 0;
+    TKey_BOOL bPassed;
+
+    tkey_psa_drv_check_attributes(&sAttr, PSA_KEY_LOCATION_LOCAL_STORAGE);
+    memset(&gsCalls, 0, sizeof(gsCalls));
+    bPassed = (PSA_SUCCESS == psa_generate_key(&sAttr, &hKey)) &&
+              tkey_psa_drv_check_key(hKey);
+    psa_destroy_key(hKey);
+    /* One sign; verifies of the good, tampered and imported-key
+     * signatures; public key derivation for verify and export */
+    return bPassed && (1 == gsCalls.uiSign) && (3 == gsCalls.uiVerify) &&
+           (2 <= gsCalls.uiPublicKey);
+}
+
+/* Opaque key: PSA holds only the driver slot reference */
+static TKey_BOOL tkey_psa_drv_check_opaque(TKey_VOID)
+{
+    psa_key_attributes_t sAttr;
+    psa_key_id_t hKey = 0;
+    TKey_UINT32 uiRngBytes = guiRngBytes;
+    TKey_BOOL bPassed;
+
+    tkey_psa_drv_check_attributes(&sAttr, TKEY_PSA_CRYPTO_LOCATION);
+    memset(&gsCalls, 0, sizeof(gsCalls));
+    bPassed = (PSA_SUCCESS == psa_generate_key(&sAttr, &hKey)) &&
+              (guiRngBytes > uiRngBytes);
+    bPassed = bPassed && tkey_psa_drv_check_key(hKey);
+    psa_destroy_key(hKey);
+    /* Signing stays in the opaque driver; verification only needs the
+     * public key, so all three verifies may use the accelerator */
+    return bPassed && (0 == gsCalls.uiSign) && (3 == gsCalls.uiVerify);
+}
+
+/* PSA random bytes come from the THINKey random source */
+static TKey_BOOL tkey_psa_drv_check_random(TKey_VOID)
+{
+    TKey_BYTE aucOut[48];
+    TKey_UINT32 uiRngBytes = guiRngBytes;
+
+    return (PSA_SUCCESS == psa_generate_random(aucOut, sizeof(aucOut))) &&
+           (guiRngBytes >= uiRngBytes + sizeof(aucOut));
+}
+
+#if defined(THINKEY_PSA_DRV_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiFailed = 0;
+    TKey_BOOL bPassed;
+
+    (void)argc;
+    (void)argv;
+    if(E_TKEY_SUCCESS != TKey_Crypto_Init() ||
+       E_TKEY_CRYPTO_SUCCESS !=
+       TKey_Crypto_RegisterTransparentDriver(&gsCheckAccel)) {
+        return 1;
+    }
+    TKey_Crypto_SetRng(tkey_psa_drv_check_rng, TKey_NULL);
+
+    bPassed = (PSA_SUCCESS == psa_crypto_init());
+    tkey_psa_drv_check_result("psa init", bPassed, &uiFailed);
+    if(!bPassed) {
+        return 1;
+    }
+    tkey_psa_drv_check_result("random", tkey_psa_drv_check_random(),
+                              &uiFailed);
+    tkey_psa_drv_check_result("transparent p256",
+                              tkey_psa_drv_check_transparent(), &uiFailed);
+    tkey_psa_drv_check_result("opaque p256", tkey_psa_drv_check_opaque(),
+                              &uiFailed);
+    mbedtls_psa_crypto_free();
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_PSA_DRV_CHECK_MAIN */
@@ -0,0 +1,444 @@
+/*
+ * \file thinkey_se_al_check.c
+ *
+ * \brief SE AL check against the secure element simulator
+ *
+ * Drives the APDU channel, command batching, the worker task, key storage
+ * and signing of the SE AL and the SE crypto driver through se_sim. Host
+ * builds only; built with THINKEY_SE_AL_CHECK_MAIN it is a standalone
+ * program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_se_sim.h"
+#include "thinkey_se_al.h"
+#include "thinkey_crypto_drv.h"
+#include "thinkey_osal.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_SE_AL_CHECK_SLOT 1         /* provisioned range, raw APDUs */
+#define TKEY_SE_AL_CHECK_WAIT_MS 2000
+
+static const TKey_BYTE gaucCheckSeed[] = "thinkey se al check";
+
+static const TKey_BYTE gaucCheckAesKey[TKEY_CRYPTO_AES128_KEY_SIZE] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const TKey_BYTE gaucCheckEcPriv[TKEY_CRYPTO_P256_PRIV_KEY_SIZE] = {
+    0xc9, 0xaf, 0xa9, 0xd8, 0x45, 0xba, 0x75, 0x16,
+    0x6b, 0x5c, 0x21, 0x57, 0x67, 0xb1, 0xd6, 0x93,
+    0x4e, 0x50, 0xc3, 0xdb, 0x36, 0xe8, 0x9b, 0x12,
+    0x7b, 0x8a, 0x62, 0x2b, 0x12, 0x0f, 0x67, 0x21
+};
+
+static TKey_HANDLE ghCheckDone;
+
+static TKey_VOID tkey_se_al_check_result(const TKey_CHAR *pcCheck,
+                                         TKey_BOOL bPassed,
+                                         TKey_UINT32 *puiFailed)
+{
+    printf("%-24s %s\r\n", pcCheck, bPassed ? "pass" : "FAIL");
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+static TKey_VOID tkey_se_al_check_apdu(TKey_SeApdu_t *psApdu, TKey_BYTE ucIns,
+                                       TKey_BYTE ucP1, TKey_BYTE ucP2,
+                                       const TKey_BYTE *pucData,
+                                       TKey_UINT32 uiLc, TKey_UINT32 uiLe)
+{
+    psApdu->ucCla = TKEY_SE_CLA;
+    psApdu->ucIns = ucIns;
+    psApdu->ucP1 = ucP1;
+    psApdu->ucP2 = ucP2;
+    psApdu->pucData = pucData;
+    psApdu->uiLc = uiLc;
+    psApdu->uiLe = uiLe;
+}
+
+static TKey_BOOL tkey_se_al_check_open(TKey_BOOL bEnvelope)
+{
+    if(E_TKEY_SUCCESS != TKey_SeSim_Init(gaucCheckSeed,
+                                         sizeof(gaucCheckSeed) - 1)) {
+        return TKey_FALSE;
+    }
+    TKey_SeSim_SetEnvelopeSupport(bEnvelope);
+    return (E_TKEY_SUCCESS == TKey_Se_Init(&gsTKeySeSimBus, TKey_NULL));
+}
+
+/* Short and extended forms survive encode and decode */
+static TKey_BOOL tkey_se_al_check_codec(TKey_VOID)
+{
+    static TKey_BYTE aucData[300];
+    static TKey_BYTE aucFrame[320];
+    const TKey_UINT32 auiLc[] = { 0, 0, 16, 16, 300, 300, 0 };
+    const TKey_UINT32 auiLe[] = { 0, 256, 0, 32, 0, 0x10000, 0x10000 };
+    TKey_SeApdu_t sApdu;
+    TKey_SeApdu_t sDecoded;
+    TKey_UINT32 uiCase;
+    TKey_UINT32 uiLen;
+
+    for(uiLen = 0; uiLen < sizeof(aucData); uiLen++) {
+        aucData[uiLen] = (TKey_BYTE)(uiLen * 13);
+    }
+    for(uiCase = 0; uiCase < sizeof(auiLc) / sizeof(auiLc[0]); uiCase++) {
+        tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_CMAC, 0x12, 0x34, aucData,
+                              auiLc[uiCase], auiLe[uiCase]);
+        uiLen = TKey_Se_EncodeApdu(&sApdu, aucFrame, sizeof(aucFrame));
+        if(0 == uiLen ||
+           E_TKEY_SE_SUCCESS != TKey_Se_DecodeApdu(aucFrame, uiLen, &sDecoded) ||
+           sDecoded.ucCla != TKEY_SE_CLA || sDecoded.ucIns != TKEY_SE_INS_CMAC ||
+           sDecoded.ucP1 != 0x12 || sDecoded.ucP2 != 0x34 ||
+           sDecoded.uiLc != sApdu.uiLc || sDecoded.uiLe != sApdu.uiLe ||
+           (0 != sApdu.uiLc && 0 != memcmp(sDecoded.pucData, aucData,
+                                           sApdu.uiLc))) {
+            return TKey_FALSE;
+        }
+    }
+    /* Does not fit, and a frame with a missing data byte */
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_CMAC, 0, 0, aucData, 300, 0);
+    uiLen = TKey_Se_EncodeApdu(&sApdu, aucFrame, sizeof(aucFrame));
+    return (0 == TKey_Se_EncodeApdu(&sApdu, aucFrame, 200)) &&
+           (E_TKEY_SE_INVALID_ARG == TKey_Se_DecodeApdu(aucFrame, uiLen - 1,
+                                                        &sDecoded));
+}
+
+/* One APDU is one bus transaction */
+static TKey_BOOL tkey_se_al_check_transceive(TKey_VOID)
+{
+    TKey_BYTE aucRandom[32];
+    TKey_SeApdu_t sApdu;
+    TKey_SeResponse_t sResp = { aucRandom, sizeof(aucRandom), 0, 0 };
+    TKey_SeStats_t sStats;
+    TKey_SeSimCounters_t sCounters;
+    TKey_SeStatus_t eStatus;
+
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_GET_RANDOM, 0, 0, TKey_NULL, 0,
+                          sizeof(aucRandom));
+    eStatus = TKey_Se_Transceive(&sApdu, &sResp);
+    TKey_Se_GetStats(&sStats);
+    TKey_SeSim_GetCounters(&sCounters);
+    if(E_TKEY_SE_SUCCESS != eStatus || TKEY_SE_SW_OK != sResp.usSw ||
+       sizeof(aucRandom) != sResp.uiLen || 1 != sStats.uiBusTransactions ||
+       1 != sStats.uiApdus || 1 != sCounters.uiTransactions) {
+        return TKey_FALSE;
+    }
+
+    /* A response larger than the buffer is cut and reported */
+    sResp.uiSize = 8;
+    sApdu.uiLe = 16;
+    eStatus = TKey_Se_Transceive(&sApdu, &sResp);
+    return (E_TKEY_SE_BUFFER_TOO_SMALL == eStatus) && (8 == sResp.uiLen) &&
+           (TKEY_SE_SW_OK == sResp.usSw);
+}
+
+/* uiCommands GET RANDOM of uiLe bytes each, executed as one batch */
+static TKey_BOOL tkey_se_al_check_batch(TKey_UINT32 uiCommands, TKey_UINT32 uiLe)
+{
+    static TKey_BYTE aucData[TKEY_SE_MAX_BATCH][128];
+    TKey_SeApdu_t asApdu[TKEY_SE_MAX_BATCH];
+    TKey_SeResponse_t asResp[TKEY_SE_MAX_BATCH];
+    TKey_SeBatch_t sBatch;
+    TKey_UINT32 uiIndex;
+
+    TKey_SeBatch_Init(&sBatch);
+    for(uiIndex = 0; uiIndex < uiCommands; uiIndex++) {
+        tkey_se_al_check_apdu(&asApdu[uiIndex], TKEY_SE_INS_GET_RANDOM, 0, 0,
+                              TKey_NULL, 0, uiLe);
+        asResp[uiIndex].pucData = aucData[uiIndex];
+        asResp[uiIndex].uiSize = sizeof(aucData[uiIndex]);
+        asResp[uiIndex].uiLen = 0;
+        asResp[uiIndex].usSw = 0;
+        if(E_TKEY_SE_SUCCESS != TKey_SeBatch_Add(&sBatch, &asApdu[uiIndex],
+                                                 &asResp[uiIndex])) {
+            return TKey_FALSE;
+        }
+    }
+    if(E_TKEY_SE_SUCCESS != TKey_Se_ExecuteBatch(&sBatch)) {
+        return TKey_FALSE;
+    }
+    for(uiIndex = 0; uiIndex < uiCommands; uiIndex++) {
+        if(TKEY_SE_SW_OK != asResp[uiIndex].usSw || uiLe != asResp[uiIndex].uiLen) {
+            return TKey_FALSE;
+        }
+    }
+    /* Successive draws from the SE DRBG differ */
+    return (uiCommands < 2) || (0 != memcmp(aucData[0], aucData[1], uiLe));
+}
+
+static TKey_BOOL tkey_se_al_check_batch_full(TKey_VOID)
+{
+    TKey_SeApdu_t sApdu;
+    TKey_SeResponse_t sResp;
+    TKey_SeBatch_t sBatch;
+    TKey_UINT32 uiIndex;
+
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_GET_RANDOM, 0, 0, TKey_NULL, 0, 1);
+    TKey_SeBatch_Init(&sBatch);
+    for(uiIndex = 0; uiIndex < TKEY_SE_MAX_BATCH; uiIndex++) {
+        if(E_TKEY_SE_SUCCESS != TKey_SeBatch_Add(&sBatch, &sApdu, &sResp)) {
+            return TKey_FALSE;
+        }
+    }
+    return (E_TKEY_SE_QUEUE_FULL == TKey_SeBatch_Add(&sBatch, &sApdu, &sResp)) &&
+           (E_TKEY_SE_INVALID_ARG == TKey_SeBatch_Add(&sBatch, TKey_NULL, &sResp));
+}
+
+/* Key import, use and delete with raw APDUs */
+static TKey_BOOL tkey_se_al_check_key_slot(TKey_VOID)
+{
+    static const TKey_BYTE aucMsg[] = "secure element key storage";
+    TKey_BYTE aucMac[TKEY_CRYPTO_CMAC_SIZE];
+    TKey_BYTE aucExpected[TKEY_CRYPTO_CMAC_SIZE];
+    TKey_SeApdu_t sApdu;
+    TKey_SeResponse_t sResp = { aucMac, sizeof(aucMac), 0, 0 };
+    TKey_BOOL bPassed;
+
+    if(E_TKEY_CRYPTO_SUCCESS != gsTKeyCryptoSwDriver.eAesCmac(gaucCheckAesKey,
+                                    sizeof(gaucCheckAesKey), aucMsg,
+                                    sizeof(aucMsg) - 1, aucExpected)) {
+        return TKey_FALSE;
+    }
+
+    /* Nothing in the slot yet */
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_CMAC, TKEY_SE_AL_CHECK_SLOT, 0,
+                          aucMsg, sizeof(aucMsg) - 1, TKEY_CRYPTO_CMAC_SIZE);
+    bPassed = (E_TKEY_SE_SUCCESS == TKey_Se_Transceive(&sApdu, &sResp)) &&
+              (TKEY_SE_SW_NOT_FOUND == sResp.usSw);
+
+    /* A key of the wrong length is refused */
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_IMPORT_KEY, TKEY_SE_AL_CHECK_SLOT,
+                          TKEY_SE_KEY_TYPE_AES, gaucCheckAesKey, 15, 0);
+    bPassed = bPassed && (E_TKEY_SE_SUCCESS == TKey_Se_Transceive(&sApdu, &sResp)) &&
+              (TKEY_SE_SW_WRONG_LENGTH == sResp.usSw);
+
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_IMPORT_KEY, TKEY_SE_AL_CHECK_SLOT,
+                          TKEY_SE_KEY_TYPE_AES, gaucCheckAesKey,
+                          sizeof(gaucCheckAesKey), 0);
+    bPassed = bPassed && (E_TKEY_SE_SUCCESS == TKey_Se_Transceive(&sApdu, &sResp)) &&
+              (TKEY_SE_SW_OK == sResp.usSw) && (0 == sResp.uiLen);
+
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_CMAC, TKEY_SE_AL_CHECK_SLOT, 0,
+                          aucMsg, sizeof(aucMsg) - 1, TKEY_CRYPTO_CMAC_SIZE);
+    bPassed = bPassed && (E_TKEY_SE_SUCCESS == TKey_Se_Transceive(&sApdu, &sResp)) &&
+              (TKEY_SE_SW_OK == sResp.usSw) && (sizeof(aucMac) == sResp.uiLen) &&
+              (0 == memcmp(aucMac, aucExpected, sizeof(aucMac)));
+
+    /* The key is not a P-256 key */
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_GET_PUBLIC_KEY,
+                          TKEY_SE_AL_CHECK_SLOT, 0, TKey_NULL, 0,
+                          TKEY_CRYPTO_P256_PUB_KEY_SIZE);
+    bPassed = bPassed && (E_TKEY_SE_SUCCESS == TKey_Se_Transceive(&sApdu, &sResp)) &&
+              (TKEY_SE_SW_NOT_FOUND == sResp.usSw);
+
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_DELETE_KEY, TKEY_SE_AL_CHECK_SLOT,
+                          0, TKey_NULL, 0, 0);
+    bPassed = bPassed && (E_TKEY_SE_SUCCESS == TKey_Se_Transceive(&sApdu, &sResp)) &&
+              (TKEY_SE_SW_OK == sResp.usSw);
+    bPassed = bPassed && (E_TKEY_SE_SUCCESS == TKey_Se_Transceive(&sApdu, &sResp)) &&
+              (TKEY_SE_SW_NOT_FOUND == sResp.usSw);
+    return bPassed;
+}
+
+/* Signatures made in the SE verify with the exported public key */
+static TKey_BOOL tkey_se_al_check_sign(TKey_CryptoKey_t *psKey,
+                                       const TKey_BYTE *pucExpectedPub)
+{
+    static const TKey_BYTE aucMsg[] = "sign me in the secure element";
+    TKey_BYTE aucHash[TKEY_CRYPTO_SHA256_SIZE];
+    TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    TKey_BYTE aucSig[TKEY_CRYPTO_P256_SIG_SIZE];
+
+    if(E_TKEY_CRYPTO_SUCCESS != TKey_Crypto_Sha256(aucMsg, sizeof(aucMsg) - 1,
+                                                   aucHash) ||
+       E_TKEY_CRYPTO_SUCCESS != TKey_Crypto_EcP256PublicKey(psKey, aucPub) ||
+       E_TKEY_CRYPTO_SUCCESS != TKey_Crypto_EcdsaP256Sign(psKey, aucHash,
+                                                          aucSig)) {
+        return TKey_FALSE;
+    }
+    if(TKey_NULL != pucExpectedPub &&
+       0 != memcmp(aucPub, pucExpectedPub, sizeof(aucPub))) {
+        return TKey_FALSE;
+    }
+    if(E_TKEY_CRYPTO_SUCCESS != TKey_Crypto_EcdsaP256Verify(aucPub, aucHash,
+                                                            aucSig)) {
+        return TKey_FALSE;
+    }
+    aucHash[0] ^= 0x01;
+    return (E_TKEY_CRYPTO_SUCCESS != TKey_Crypto_EcdsaP256Verify(aucPub, aucHash,
+                                                                 aucSig));
+}
+
+static TKey_BOOL tkey_se_al_check_opaque(TKey_VOID)
+{
+    TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    TKey_BYTE aucHash[TKEY_CRYPTO_SHA256_SIZE] = { 0 };
+    TKey_BYTE aucSig[TKEY_CRYPTO_P256_SIG_SIZE];
+    TKey_CryptoKey_t sImported;
+    TKey_CryptoKey_t sGenerated;
+    TKey_SeSimCounters_t sBefore;
+    TKey_SeSimCounters_t sAfter;
+    TKey_BOOL bPassed;
+
+    if(E_TKEY_CRYPTO_SUCCESS != TKey_SeCrypto_Register() ||
+       E_TKEY_CRYPTO_SUCCESS != gsTKeyCryptoSwDriver.eEcP256PublicKey(
+                                    gaucCheckEcPriv, aucPub)) {
+        return TKey_FALSE;
+    }
+
+    /* Imported and generated keys live in separate SE slots */
+    bPassed = (E_TKEY_CRYPTO_SUCCESS == TKey_Crypto_ImportKey(
+                   TKEY_CRYPTO_DRIVER_ID_SE, E_TKEY_CRYPTO_KEY_P256_PRIVATE,
+                   gaucCheckEcPriv, sizeof(gaucCheckEcPriv), &sImported)) &&
+              (E_TKEY_CRYPTO_SUCCESS == TKey_Crypto_GenerateKey(
+                   TKEY_CRYPTO_DRIVER_ID_SE, E_TKEY_CRYPTO_KEY_P256_PRIVATE,
+                   TKEY_CRYPTO_P256_PRIV_KEY_SIZE, &sGenerated));
+    if(!bPassed) {
+        return TKey_FALSE;
+    }
+    bPassed = (E_TKEY_CRYPTO_KEY_OPAQUE == sImported.eLocation) &&
+              (sImported.uiSlot != sGenerated.uiSlot) &&
+              (sImported.uiSlot >= TKEY_SE_FIRST_DYNAMIC_SLOT) &&
+              (sGenerated.uiSlot >= TKEY_SE_FIRST_DYNAMIC_SLOT);
+
+    /* Signing goes over the bus, one transaction per signature */
+    TKey_SeSim_GetCounters(&sBefore);
+    bPassed = bPassed && tkey_se_al_check_sign(&sImported, aucPub) &&
+              tkey_se_al_check_sign(&sGenerated, TKey_NULL);
+    TKey_SeSim_GetCounters(&sAfter);
+    bPassed = bPassed && (sAfter.uiCommands - sBefore.uiCommands == 4);
+
+    /* A destroyed key signs no more */
+    bPassed = bPassed &&
+              (E_TKEY_CRYPTO_SUCCESS == TKey_Crypto_DestroyKey(&sImported)) &&
+              (E_TKEY_CRYPTO_SUCCESS != TKey_Crypto_EcdsaP256Sign(&sImported,
+                                                                  aucHash, aucSig)) &&
+              tkey_se_al_check_sign(&sGenerated, TKey_NULL) &&
+              (E_TKEY_CRYPTO_SUCCESS == TKey_Crypto_DestroyKey(&sGenerated));
+    return bPassed;
+}
+
+static TKey_VOID tkey_se_al_check_done(TKey_SeBatch_t *psBatch,
+                                       TKey_SeStatus_t eStatus,
+                                       TKey_VOID *pvCtx)
+{
+    TKey_BYTE aucRandom[4];
+    TKey_SeApdu_t sApdu;
+    TKey_SeResponse_t sResp = { aucRandom, sizeof(aucRandom), 0, 0 };
+    TKey_SeStatus_t eResult = eStatus;
+
+    (TKey_VOID)psBatch;
+    /* Synchronous calls are allowed from the completion callback */
+    tkey_se_al_check_apdu(&sApdu, TKEY_SE_INS_GET_RANDOM, 0, 0, TKey_NULL, 0,
+                          sizeof(aucRandom));
+    if(E_TKEY_SE_SUCCESS == eResult) {
+        eResult = TKey_Se_Transceive(&sApdu, &sResp);
+    }
+    *(TKey_SeStatus_t *)pvCtx = eResult;
+    (void)THINKey_OSAL_eQueueSend(ghCheckDone, &eResult);
+}
+
+/* Batches submitted to the worker complete by callback; the bus belongs
+ * to the worker meanwhile */
+static TKey_BOOL tkey_se_al_check_worker(TKey_VOID)
+{
+    TKey_BYTE aucRandom[2][16];
+    TKey_SeApdu_t asApdu[2];
+    TKey_SeResponse_t asResp[2];
+    TKey_SeBatch_t sBatch;
+    TKey_SeStatus_t eCtx = E_TKEY_SE_FAILURE;
+    TKey_SeStatus_t eDone;
+    TKey_UINT32 uiIndex;
+    TKey_BOOL bPassed;
+
+    ghCheckDone = THINKey_OSAL_hCreateQueue(2, sizeof(TKey_SeStatus_t));
+    if(TKey_NULL == ghCheckDone) {
+        return TKey_FALSE;
+    }
+    TKey_SeBatch_Init(&sBatch);
+    for(uiIndex = 0; uiIndex < 2; uiIndex++) {
+        tkey_se_al_check_apdu(&asApdu[uiIndex], TKEY_SE_INS_GET_RANDOM, 0, 0,
+                              TKey_NULL, 0, sizeof(aucRandom[uiIndex]));
+        asResp[uiIndex].pucData = aucRandom[uiIndex];
+        asResp[uiIndex].uiSize = sizeof(aucRandom[uiIndex]);
+        (void)TKey_SeBatch_Add(&sBatch, &asApdu[uiIndex], &asResp[uiIndex]);
+    }
+
+    bPassed = (E_TKEY_SE_FAILURE == TKey_Se_SubmitBatch(&sBatch,
+                                        tkey_se_al_check_done, &eCtx)) &&
+              (E_TKEY_SUCCESS == TKey_Se_StartWorker()) &&
+              (E_TKEY_SE_BUSY == TKey_Se_Transceive(&asApdu[0], &asResp[0])) &&
+              (E_TKEY_SE_BUSY == TKey_Se_ExecuteBatch(&sBatch));
+    bPassed = bPassed &&
+              (E_TKEY_SE_SUCCESS == TKey_Se_SubmitBatch(&sBatch,
+                                        tkey_se_al_check_done, &eCtx)) &&
+              (E_THINKEY_SUCCESS == THINKey_OSAL_eTimedQueueReceive(ghCheckDone,
+                                        &eDone, TKEY_SE_AL_CHECK_WAIT_MS)) &&
+              (E_TKEY_SE_SUCCESS == eDone) && (E_TKEY_SE_SUCCESS == eCtx) &&
+              (TKEY_SE_SW_OK == asResp[0].usSw) && (TKEY_SE_SW_OK == asResp[1].usSw) &&
+              (sizeof(aucRandom[1]) == asResp[1].uiLen);
+    return bPassed;
+}
+
+#if defined(THINKEY_SE_AL_CHECK_MAIN)
+int main(int argc, char *argv[])
+{
+    TKey_SeStats_t sStats;
+    TKey_SeSimCounters_t sCounters;
+    TKey_UINT32 uiFailed = 0;
+    TKey_BOOL bPassed;
+
+    (void)argc;
+    (void)argv;
+    if(E_TKEY_SUCCESS != TKey_Crypto_Init()) {
+        return 1;
+    }
+
+    tkey_se_al_check_result("apdu codec", tkey_se_al_check_codec(), &uiFailed);
+
+    bPassed = tkey_se_al_check_open(TKey_TRUE) && tkey_se_al_check_transceive();
+    tkey_se_al_check_result("transceive", bPassed, &uiFailed);
+
+    /* Four small commands go in one envelope */
+    bPassed = tkey_se_al_check_open(TKey_TRUE) && tkey_se_al_check_batch(4, 16);
+    TKey_Se_GetStats(&sStats);
+    TKey_SeSim_GetCounters(&sCounters);
+    bPassed = bPassed && (1 == sStats.uiBusTransactions) && (1 == sStats.uiEnvelopes) &&
+              (4 == sStats.uiApdus) && (4 == sCounters.uiCommands);
+    tkey_se_al_check_result("batch one envelope", bPassed, &uiFailed);
+
+    /* Responses of 100 bytes: four to a frame */
+    bPassed = tkey_se_al_check_open(TKey_TRUE) &&
+              tkey_se_al_check_batch(TKEY_SE_MAX_BATCH, 100);
+    TKey_Se_GetStats(&sStats);
+    bPassed = bPassed && (2 == sStats.uiEnvelopes) && (2 == sStats.uiBusTransactions);
+    tkey_se_al_check_result("batch split by frame", bPassed, &uiFailed);
+
+    /* Without envelope support the batch is resent one command at a time,
+     * and later batches skip the envelope */
+    bPassed = tkey_se_al_check_open(TKey_FALSE) && tkey_se_al_check_batch(4, 16);
+    TKey_Se_GetStats(&sStats);
+    bPassed = bPassed && (1 == sStats.uiFallbacks) && (5 == sStats.uiBusTransactions) &&
+              tkey_se_al_check_batch(4, 16);
+    TKey_Se_GetStats(&sStats);
+    bPassed = bPassed && (1 == sStats.uiFallbacks) && (9 == sStats.uiBusTransactions);
+    tkey_se_al_check_result("envelope fallback", bPassed, &uiFailed);
+
+    tkey_se_al_check_result("batch full", tkey_se_al_check_batch_full(), &uiFailed);
+
+    bPassed = tkey_se_al_check_open(TKey_TRUE) && tkey_se_al_check_key_slot();
+    tkey_se_al_check_result("key slot", bPassed, &uiFailed);
+
+    tkey_se_al_check_result("opaque sign", tkey_se_al_check_opaque(), &uiFailed);
+
+    tkey_se_al_check_result("worker batch", tkey_se_al_check_worker(), &uiFailed);
+
+    return (0 == uiFailed) ? 0 : 1;
+}
+#endif /* THINKEY_SE_AL_CHECK_MAIN */
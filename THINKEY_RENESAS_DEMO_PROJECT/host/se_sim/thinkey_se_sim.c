@@ -0,0 +1,450 @@
+/*
+ * \file thinkey_se_sim.c
+ *
+ * \brief Host secure element simulator
+ *
+ * Build together with the SE AL, the crypto driver layer and mbedtls, e.g.
+ *     gcc -DTHINKEY_HOST_BUILD -Iplatform/... host/se_sim/thinkey_se_sim.c
+ *         platform/thinkey_security_al/source/thinkey_se_al.c ...
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_se_sim.h"
+#include "thinkey_crypto_drv.h"
+#include "mbedtls/hmac_drbg.h"
+#include "mbedtls/md.h"
+#include "mbedtls/platform_util.h"
+#include <string.h>
+#include <unistd.h>
+
+#define TKEY_SE_SIM_MAX_KEY 32
+
+typedef struct
+{
+    TKey_BOOL bUsed;
+    TKey_BYTE ucType;
+    TKey_UINT32 uiKeyLen;
+    TKey_BYTE aucKey[TKEY_SE_SIM_MAX_KEY];
+} TKey_SeSimSlot_t;
+
+typedef struct
+{
+    TKey_SeSimSlot_t asSlot[TKEY_SE_NUM_KEY_SLOTS];
+    mbedtls_hmac_drbg_context sDrbg;
+    TKey_BOOL bDrbgReady;
+    TKey_BOOL bNoEnvelope;
+    TKey_UINT32 uiLatencyUs;
+    TKey_SeSimCounters_t sCounters;
+} TKey_SeSim_t;
+
+static TKey_SeSim_t gsSeSim;
+
+/* Response under construction: data followed by the status word */
+typedef struct
+{
+    TKey_BYTE *pucBuf;
+    TKey_UINT32 uiSize;
+    TKey_UINT32 uiLen;
+} TKey_SeSimResp_t;
+
+static TKey_UINT16 tkey_se_sim_sw(TKey_CryptoStatus_t eStatus)
+{
+    switch(eStatus) {
+        case E_TKEY_CRYPTO_SUCCESS:
+            return TKEY_SE_SW_OK;
+        case E_TKEY_CRYPTO_AUTH_FAILED:
+            return TKEY_SE_SW_AUTH_FAILED;
+        case E_TKEY_CRYPTO_INVALID_ARG:
+            return TKEY_SE_SW_WRONG_DATA;
+        case E_TKEY_CRYPTO_NO_MEMORY:
+            return TKEY_SE_SW_NO_MEMORY;
+        case E_TKEY_CRYPTO_NOT_SUPPORTED:
+            return TKEY_SE_SW_INS_NOT_SUPPORTED;
+        default:
+            return 0x6F00;
+    }
+}
+
+static TKey_SeSimSlot_t* tkey_se_sim_slot(TKey_BYTE ucSlot, TKey_BYTE ucType)
+{
+    if(ucSlot >= TKEY_SE_NUM_KEY_SLOTS || !gsSeSim.asSlot[ucSlot].bUsed ||
+       gsSeSim.asSlot[ucSlot].ucType != ucType) {
+        return TKey_NULL;
+    }
+    return &gsSeSim.asSlot[ucSlot];
+}
+
+static TKey_UINT16 tkey_se_sim_store_key(TKey_BYTE ucSlot, TKey_BYTE ucType,
+                                         const TKey_BYTE *pucKey,
+                                         TKey_UINT32 uiKeyLen)
+{
+    TKey_SeSimSlot_t *psSlot;
+    TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+
+    if(ucSlot >= TKEY_SE_NUM_KEY_SLOTS) {
+        return TKEY_SE_SW_WRONG_DATA;
+    }
+    if(TKEY_SE_KEY_TYPE_AES == ucType) {
+        if(TKEY_CRYPTO_AES128_KEY_SIZE != uiKeyLen &&
+           TKEY_CRYPTO_AES256_KEY_SIZE != uiKeyLen) {
+            return TKEY_SE_SW_WRONG_LENGTH;
+        }
+    } else if(TKEY_SE_KEY_TYPE_P256 == ucType) {
+        if(TKEY_CRYPTO_P256_PRIV_KEY_SIZE != uiKeyLen) {
+            return TKEY_SE_SW_WRONG_LENGTH;
+        }
+        /* Reject scalars outside [1, n-1] like a real SE would */
+        if(E_TKEY_CRYPTO_SUCCESS !=
+           gsTKeyCryptoSwDriver.eEcP256PublicKey(pucKey, aucPub)) {
+            return TKEY_SE_SW_WRONG_DATA;
+        }
+    } else {
+        return TKEY_SE_SW_WRONG_DATA;
+    }
+    psSlot = &gsSeSim.asSlot[ucSlot];
+    psSlot->bUsed = TKey_TRUE;
+    psSlot->ucType = ucType;
+    psSlot->uiKeyLen = uiKeyLen;
+    memcpy(psSlot->aucKey, pucKey, uiKeyLen);
+    return TKEY_SE_SW_OK;
+}
+
+static TKey_UINT16 tkey_se_sim_generate(const TKey_SeApdu_t *psApdu)
+{
+    TKey_BYTE aucKey[TKEY_SE_SIM_MAX_KEY];
+    TKey_UINT32 uiKeyLen = TKEY_CRYPTO_P256_PRIV_KEY_SIZE;
+    TKey_UINT16 usSw = TKEY_SE_SW_WRONG_DATA;
+    TKey_UINT32 uiTry;
+
+    if(TKEY_SE_KEY_TYPE_AES == psApdu->ucP2) {
+        if(1 != psApdu->uiLc) {
+            return TKEY_SE_SW_WRONG_LENGTH;
+        }
+        uiKeyLen = psApdu->pucData[0];
+        if(uiKeyLen > sizeof(aucKey)) {
+            return TKEY_SE_SW_WRONG_LENGTH;
+        }
+    }
+    /* P-256 scalars out of range are rejected by the store; redraw */
+    for(uiTry = 0; uiTry < 8 && TKEY_SE_SW_WRONG_DATA == usSw; uiTry++) {
+        if(0 != mbedtls_hmac_drbg_random(&gsSeSim.sDrbg, aucKey, uiKeyLen)) {
+            return 0x6F00;
+        }
+        usSw = tkey_se_sim_store_key(psApdu->ucP1, psApdu->ucP2, aucKey,
+                                     uiKeyLen);
+    }
+    mbedtls_platform_zeroize(aucKey, sizeof(aucKey));
+    return usSw;
+}
+
+/* Parses nonce_len(1) || nonce || aad_len(2) || aad || payload */
+static TKey_BOOL tkey_se_sim_ccm_parse(const TKey_SeApdu_t *psApdu,
+        TKey_UINT32 uiTrailer, const TKey_BYTE **ppucNonce,
+        TKey_UINT32 *puiNonceLen, const TKey_BYTE **ppucAad,
+        TKey_UINT32 *puiAadLen, const TKey_BYTE **ppucIn, TKey_UINT32 *puiLen)
+{
+    const TKey_BYTE *pucData = psApdu->pucData;
+    TKey_UINT32 uiPos = 0;
+
+    if(psApdu->uiLc < 3) {
+        return TKey_FALSE;
+    }
+    *puiNonceLen = pucData[uiPos++];
+    *ppucNonce = &pucData[uiPos];
+    uiPos += *puiNonceLen;
+    if(uiPos + 2 > psApdu->uiLc) {
+        return TKey_FALSE;
+    }
+    *puiAadLen = ((TKey_UINT32)pucData[uiPos] << 8) | pucData[uiPos + 1];
+    uiPos += 2;
+    *ppucAad = &pucData[uiPos];
+    uiPos += *puiAadLen;
+    if(uiPos + uiTrailer > psApdu->uiLc) {
+        return TKey_FALSE;
+    }
+    *ppucIn = &pucData[uiPos];
+    *puiLen = psApdu->uiLc - uiPos - uiTrailer;
+    return TKey_TRUE;
+}
+
+static TKey_UINT16 tkey_se_sim_ccm(const TKey_SeApdu_t *psApdu,
+                                   TKey_SeSimResp_t *psResp)
+{
+    TKey_SeSimSlot_t *psSlot = tkey_se_sim_slot(psApdu->ucP1,
+                                                TKEY_SE_KEY_TYPE_AES);
+    TKey_BOOL bEncrypt = (TKEY_SE_INS_CCM_ENCRYPT == psApdu->ucIns);
+    TKey_UINT32 uiTagLen = psApdu->ucP2;
+    const TKey_BYTE *pucNonce;
+    const TKey_BYTE *pucAad;
+    const TKey_BYTE *pucIn;
+    TKey_UINT32 uiNonceLen;
+    TKey_UINT32 uiAadLen;
+    TKey_UINT32 uiLen;
+    TKey_CryptoStatus_t eStatus;
+
+    if(TKey_NULL == psSlot) {
+        return TKEY_SE_SW_NOT_FOUND;
+    }
+    if(!tkey_se_sim_ccm_parse(psApdu, bEncrypt ? 0 : uiTagLen, &pucNonce,
+                              &uiNonceLen, &pucAad, &uiAadLen, &pucIn,
+                              &uiLen)) {
+        return TKEY_SE_SW_WRONG_LENGTH;
+    }
+    if(uiLen + (bEncrypt ? uiTagLen : 0) > psResp->uiSize) {
+        return TKEY_SE_SW_WRONG_LENGTH;
+    }
+    if(bEncrypt) {
+        eStatus = gsTKeyCryptoSwDriver.eAesCcmEncrypt(psSlot->aucKey,
+                        psSlot->uiKeyLen, pucNonce, uiNonceLen, pucAad,
+                        uiAadLen, pucIn, uiLen, psResp->pucBuf,
+                        &psResp->pucBuf[uiLen], uiTagLen);
+        uiLen += uiTagLen;
+    } else {
+        eStatus = gsTKeyCryptoSwDriver.eAesCcmDecrypt(psSlot->aucKey,
+                        psSlot->uiKeyLen, pucNonce, uiNonceLen, pucAad,
+                        uiAadLen, pucIn, uiLen, psResp->pucBuf, &pucIn[uiLen],
+                        uiTagLen);
+    }
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        psResp->uiLen = uiLen;
+    }
+    return tkey_se_sim_sw(eStatus);
+}
+
+/* Executes one command; response data is written to psResp */
+static TKey_UINT16 tkey_se_sim_execute(const TKey_SeApdu_t *psApdu,
+                                       TKey_SeSimResp_t *psResp)
+{
+    TKey_SeSimSlot_t *psSlot;
+    TKey_CryptoStatus_t eStatus;
+    TKey_UINT32 uiOutLen = 0;
+
+    gsSeSim.sCounters.uiCommands++;
+    psResp->uiLen = 0;
+    if(TKEY_SE_CLA != psApdu->ucCla) {
+        return 0x6E00;
+    }
+    switch(psApdu->ucIns) {
+        case TKEY_SE_INS_IMPORT_KEY:
+            return tkey_se_sim_store_key(psApdu->ucP1, psApdu->ucP2,
+                                         psApdu->pucData, psApdu->uiLc);
+
+        case TKEY_SE_INS_GENERATE_KEY:
+            return tkey_se_sim_generate(psApdu);
+
+        case TKEY_SE_INS_DELETE_KEY:
+            if(psApdu->ucP1 >= TKEY_SE_NUM_KEY_SLOTS ||
+               !gsSeSim.asSlot[psApdu->ucP1].bUsed) {
+                return TKEY_SE_SW_NOT_FOUND;
+            }
+            mbedtls_platform_zeroize(&gsSeSim.asSlot[psApdu->ucP1],
+                                     sizeof(TKey_SeSimSlot_t));
+            return TKEY_SE_SW_OK;
+
+        case TKEY_SE_INS_GET_PUBLIC_KEY:
+            psSlot = tkey_se_sim_slot(psApdu->ucP1, TKEY_SE_KEY_TYPE_P256);
+            if(TKey_NULL == psSlot) {
+                return TKEY_SE_SW_NOT_FOUND;
+            }
+            uiOutLen = TKEY_CRYPTO_P256_PUB_KEY_SIZE;
+            eStatus = gsTKeyCryptoSwDriver.eEcP256PublicKey(psSlot->aucKey,
+                                                            psResp->pucBuf);
+            break;
+
+        case TKEY_SE_INS_SIGN:
+            psSlot = tkey_se_sim_slot(psApdu->ucP1, TKEY_SE_KEY_TYPE_P256);
+            if(TKey_NULL == psSlot) {
+                return TKEY_SE_SW_NOT_FOUND;
+            }
+            if(TKEY_CRYPTO_SHA256_SIZE != psApdu->uiLc) {
+                return TKEY_SE_SW_WRONG_LENGTH;
+            }
+            uiOutLen = TKEY_CRYPTO_P256_SIG_SIZE;
+            eStatus = gsTKeyCryptoSwDriver.eEcdsaP256Sign(psSlot->aucKey,
+                            psApdu->pucData, psResp->pucBuf);
+            break;
+
+        case TKEY_SE_INS_ECDH:
+            psSlot = tkey_se_sim_slot(psApdu->ucP1, TKEY_SE_KEY_TYPE_P256);
+            if(TKey_NULL == psSlot) {
+                return TKEY_SE_SW_NOT_FOUND;
+            }
+            if(TKEY_CRYPTO_P256_PUB_KEY_SIZE != psApdu->uiLc) {
+                return TKEY_SE_SW_WRONG_LENGTH;
+            }
+            uiOutLen = TKEY_CRYPTO_P256_SECRET_SIZE;
+            eStatus = gsTKeyCryptoSwDriver.eEcdhP256(psSlot->aucKey,
+                            psApdu->pucData, psResp->pucBuf);
+            break;
+
+        case TKEY_SE_INS_CCM_ENCRYPT:
+        case TKEY_SE_INS_CCM_DECRYPT:
+            return tkey_se_sim_ccm(psApdu, psResp);
+
+        case TKEY_SE_INS_CMAC:
+            psSlot = tkey_se_sim_slot(psApdu->ucP1, TKEY_SE_KEY_TYPE_AES);
+            if(TKey_NULL == psSlot) {
+                return TKEY_SE_SW_NOT_FOUND;
+            }
+            uiOutLen = TKEY_CRYPTO_CMAC_SIZE;
+            eStatus = gsTKeyCryptoSwDriver.eAesCmac(psSlot->aucKey,
+                            psSlot->uiKeyLen, psApdu->pucData, psApdu->uiLc,
+                            psResp->pucBuf);
+            break;
+
+        case TKEY_SE_INS_GET_RANDOM:
+            if(psApdu->uiLe > psResp->uiSize) {
+                return TKEY_SE_SW_WRONG_LENGTH;
+            }
+            uiOutLen = psApdu->uiLe;
+            eStatus = (0 == mbedtls_hmac_drbg_random(&gsSeSim.sDrbg,
+                                psResp->pucBuf, uiOutLen)) ?
+                      E_TKEY_CRYPTO_SUCCESS : E_TKEY_CRYPTO_FAILURE;
+            break;
+
+        default:
+            return TKEY_SE_SW_INS_NOT_SUPPORTED;
+    }
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        psResp->uiLen = uiOutLen;
+    }
+    return tkey_se_sim_sw(eStatus);
+}
+
+/* Unpacks the envelope: each entry is len(2) || command APDU, and each
+ * response entry len(2) || data || SW1 SW2 */
+static TKey_UINT16 tkey_se_sim_envelope(const TKey_SeApdu_t *psApdu,
+                                        TKey_SeSimResp_t *psResp)
+{
+    TKey_SeApdu_t sInner;
+    TKey_SeSimResp_t sInnerResp;
+    TKey_UINT32 uiPos = 0;
+    TKey_UINT32 uiOut = 0;
+    TKey_UINT32 uiEntryLen;
+    TKey_UINT32 uiCount = 0;
+    TKey_UINT16 usSw;
+
+    gsSeSim.sCounters.uiEnvelopes++;
+    while(uiPos < psApdu->uiLc) {
+        if(uiPos + 2 > psApdu->uiLc) {
+            return TKEY_SE_SW_WRONG_LENGTH;
+        }
+        uiEntryLen = ((TKey_UINT32)psApdu->pucData[uiPos] << 8) |
+                     psApdu->pucData[uiPos + 1];
+        uiPos += 2;
+        if(uiPos + uiEntryLen > psApdu->uiLc ||
+           E_TKEY_SE_SUCCESS != TKey_Se_DecodeApdu(&psApdu->pucData[uiPos],
+                                                   uiEntryLen, &sInner)) {
+            return TKEY_SE_SW_WRONG_DATA;
+        }
+        uiPos += uiEntryLen;
+        if(uiOut + 4 > psResp->uiSize) {
+            return TKEY_SE_SW_WRONG_LENGTH;
+        }
+        sInnerResp.pucBuf = &psResp->pucBuf[uiOut + 2];
+        sInnerResp.uiSize = psResp->uiSize - uiOut - 4;
+        usSw = tkey_se_sim_execute(&sInner, &sInnerResp);
+        sInnerResp.pucBuf[sInnerResp.uiLen] = (TKey_BYTE)(usSw >> 8);
+        sInnerResp.pucBuf[sInnerResp.uiLen + 1] = (TKey_BYTE)usSw;
+        psResp->pucBuf[uiOut] = (TKey_BYTE)((sInnerResp.uiLen + 2) >> 8);
+        psResp->pucBuf[uiOut + 1] = (TKey_BYTE)(sInnerResp.uiLen + 2);
+        uiOut += 2 + sInnerResp.uiLen + 2;
+        uiCount++;
+    }
+    if(uiCount != psApdu->ucP1) {
+        return TKEY_SE_SW_WRONG_DATA;
+    }
+    psResp->uiLen = uiOut;
+    return TKEY_SE_SW_OK;
+}
+
+static TKey_SeStatus_t tkey_se_sim_open(TKey_VOID *pvCtx)
+{
+    (TKey_VOID)pvCtx;
+    return gsSeSim.bDrbgReady ? E_TKEY_SE_SUCCESS : E_TKEY_SE_FAILURE;
+}
+
+static TKey_SeStatus_t tkey_se_sim_transceive(TKey_VOID *pvCtx,
+        const TKey_BYTE *pucTx, TKey_UINT32 uiTxLen, TKey_BYTE *pucRx,
+        TKey_UINT32 uiRxSize, TKey_UINT32 *puiRxLen)
+{
+    TKey_SeApdu_t sApdu;
+    TKey_SeSimResp_t sResp;
+    TKey_UINT16 usSw;
+
+    (TKey_VOID)pvCtx;
+    if(uiRxSize < 2) {
+        return E_TKEY_SE_BUFFER_TOO_SMALL;
+    }
+    gsSeSim.sCounters.uiTransactions++;
+    if(0 != gsSeSim.uiLatencyUs) {
+        usleep(gsSeSim.uiLatencyUs);
+    }
+
+    sResp.pucBuf = pucRx;
+    sResp.uiSize = uiRxSize - 2;
+    sResp.uiLen = 0;
+    if(E_TKEY_SE_SUCCESS != TKey_Se_DecodeApdu(pucTx, uiTxLen, &sApdu)) {
+        usSw = TKEY_SE_SW_WRONG_LENGTH;
+    } else if(TKEY_SE_CLA == sApdu.ucCla &&
+              TKEY_SE_INS_ENVELOPE == sApdu.ucIns) {
+        usSw = gsSeSim.bNoEnvelope ? TKEY_SE_SW_INS_NOT_SUPPORTED :
+               tkey_se_sim_envelope(&sApdu, &sResp);
+    } else {
+        usSw = tkey_se_sim_execute(&sApdu, &sResp);
+    }
+    if(TKEY_SE_SW_OK != usSw) {
+        sResp.uiLen = 0;
+    }
+    pucRx[sResp.uiLen] = (TKey_BYTE)(usSw >> 8);
+    pucRx[sResp.uiLen + 1] = (TKey_BYTE)usSw;
+    *puiRxLen = sResp.uiLen + 2;
+    return E_TKEY_SE_SUCCESS;
+}
+
+static TKey_VOID tkey_se_sim_close(TKey_VOID *pvCtx)
+{
+    (TKey_VOID)pvCtx;
+}
+
+const TKey_SeBusOps_t gsTKeySeSimBus =
+{
+    "se-sim",
+    tkey_se_sim_open,
+    tkey_se_sim_transceive,
+    tkey_se_sim_close
+};
+
+TKey_StatusType TKey_SeSim_Init(const TKey_BYTE *pucSeed, TKey_UINT32 uiSeedLen)
+{
+    if(gsSeSim.bDrbgReady) {
+        mbedtls_hmac_drbg_free(&gsSeSim.sDrbg);
+    }
+    mbedtls_platform_zeroize(&gsSeSim, sizeof(gsSeSim));
+    mbedtls_hmac_drbg_init(&gsSeSim.sDrbg);
+    if(0 != mbedtls_hmac_drbg_seed_buf(&gsSeSim.sDrbg,
+                    mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), pucSeed,
+                    uiSeedLen)) {
+        mbedtls_hmac_drbg_free(&gsSeSim.sDrbg);
+        return E_TKEY_FAILURE;
+    }
+    gsSeSim.bDrbgReady = TKey_TRUE;
+    return E_TKEY_SUCCESS;
+}
+
+TKey_VOID TKey_SeSim_SetEnvelopeSupport(TKey_BOOL bEnable)
+{
+    gsSeSim.bNoEnvelope = !bEnable;
+}
+
+TKey_VOID TKey_SeSim_SetLatency(TKey_UINT32 uiMicroseconds)
+{
+    gsSeSim.uiLatencyUs = uiMicroseconds;
+}
+
+TKey_VOID TKey_SeSim_GetCounters(TKey_SeSimCounters_t *psCounters)
+{
+    *psCounters = gsSeSim.sCounters;
+}
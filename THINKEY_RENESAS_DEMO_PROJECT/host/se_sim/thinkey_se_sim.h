@@ -0,0 +1,59 @@
+/*
+ * \file thinkey_se_sim.h
+ *
+ * \brief Host secure element simulator
+ *
+ * Implements the THINKey SE applet command set (thinkey_se_al.h) behind a
+ * TKey_SeBusOps_t, executing the commands with the software crypto driver.
+ * It lets the SE AL, the SE crypto driver and their users run on a host
+ * without hardware. Host builds only (THINKEY_HOST_BUILD); not part of the
+ * firmware image.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_SE_SIM_H
+#define THINKEY_SE_SIM_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_se_al.h"
+
+/**
+ *  @brief Simulator counters
+ */
+typedef struct
+{
+    TKey_UINT32 uiTransactions;   /* bus frames received */
+    TKey_UINT32 uiCommands;       /* commands executed, envelope content included */
+    TKey_UINT32 uiEnvelopes;
+} TKey_SeSimCounters_t;
+
+/**
+ * \brief   Bus operations of the simulated SE; the context is unused
+ */
+extern const TKey_SeBusOps_t gsTKeySeSimBus;
+
+/**
+ * \brief   Resets the simulator: clears all key slots and counters and
+ *          seeds the internal DRBG, so runs are reproducible
+ */
+TKey_StatusType TKey_SeSim_Init(const TKey_BYTE *pucSeed, TKey_UINT32 uiSeedLen);
+
+/**
+ * \brief   Enables or disables the envelope command, to exercise the
+ *          one-APDU-at-a-time fallback of the SE AL
+ */
+TKey_VOID TKey_SeSim_SetEnvelopeSupport(TKey_BOOL bEnable);
+
+/**
+ * \brief   Adds a fixed delay to every bus transaction, modelling the
+ *          I2C/SPI round trip when comparing batched and unbatched use
+ */
+TKey_VOID TKey_SeSim_SetLatency(TKey_UINT32 uiMicroseconds);
+
+/**
+ * \brief   Returns the simulator counters
+ */
+TKey_VOID TKey_SeSim_GetCounters(TKey_SeSimCounters_t *psCounters);
+
+#endif /* THINKEY_SE_SIM_H */
@@ -0,0 +1,87 @@
+/*
+ * \file thinkey_bench.h
+ *
+ * \brief Header file for the benchmark timing and reporting helpers
+ *
+ * On the target the timer is the DWT cycle counter (CPU cycles); host
+ * builds (THINKEY_HOST_BUILD) use CLOCK_MONOTONIC (nanoseconds). Results
+ * are reported as CSV lines so they can be collected per release and
+ * compared by scripts.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_BENCH_H
+#define THINKEY_BENCH_H
+
+#include "thinkey_platform_types.h"
+
+/**
+ *  @brief Marker at the start of every report line, to pick the table
+ *         out of mixed log output
+ */
+#define TKEY_BENCH_LINE_TAG "TKBENCH"
+
+#ifndef TKEY_BENCH_LINE_SIZE
+#define TKEY_BENCH_LINE_SIZE 160
+#endif
+
+/**
+ *  @brief Result of one benchmark case
+ */
+typedef struct
+{
+    const TKey_CHAR *pcSuite;
+    const TKey_CHAR *pcName;
+    TKey_UINT32 uiBytes;        /* payload bytes per operation, 0 if n/a */
+    TKey_UINT32 uiIterations;
+    TKey_UINT64 ullTotalTicks;
+    TKey_UINT64 ullMinTicks;    /* fastest single iteration */
+    TKey_INT32 iStatus;         /* 0 on success */
+} TKey_BenchResult_t;
+
+/**
+ *  @brief Line sink used to emit the report (RTT, UART, stdout)
+ */
+typedef TKey_VOID (*TKey_BenchPrint_t)(const TKey_CHAR *pcLine);
+
+/**
+ * \brief   Enables the benchmark timer. Must be called once before
+ *          TKey_Bench_Now().
+ */
+TKey_VOID TKey_Bench_TimerInit(TKey_VOID);
+
+/**
+ * \brief   Returns the current timer value in ticks
+ */
+TKey_UINT64 TKey_Bench_Now(TKey_VOID);
+
+/**
+ * \brief   Returns the number of timer ticks per second
+ */
+TKey_UINT64 TKey_Bench_TicksPerSecond(TKey_VOID);
+
+/**
+ * \brief   Returns the tick unit name, "cycles" or "ns"
+ */
+const TKey_CHAR* TKey_Bench_TickUnit(TKey_VOID);
+
+/**
+ * \brief   Records one timed iteration into psResult
+ */
+TKey_VOID TKey_Bench_Record(TKey_BenchResult_t *psResult,
+                            TKey_UINT64 ullStart, TKey_UINT64 ullEnd);
+
+/**
+ * \brief   Emits the CSV header line
+ */
+TKey_VOID TKey_Bench_PrintHeader(TKey_BenchPrint_t pfnPrint);
+
+/**
+ * \brief   Emits one CSV line per result
+ */
+TKey_VOID TKey_Bench_PrintResults(TKey_BenchPrint_t pfnPrint,
+                                  const TKey_BenchResult_t *psResults,
+                                  TKey_UINT32 uiCount);
+
+#endif /* THINKEY_BENCH_H */
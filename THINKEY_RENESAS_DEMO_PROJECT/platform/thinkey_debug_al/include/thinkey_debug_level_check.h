@@ -0,0 +1,27 @@
+/*
+ * \file thinkey_debug_level_check.h
+ *
+ * \brief Header file for the debug level check
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_DEBUG_LEVEL_CHECK_H
+#define THINKEY_DEBUG_LEVEL_CHECK_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+/**
+ * \brief   Prints at every level from a module built with its compile time
+ *          level at warnings, to the deferred log. Checks that the errors
+ *          and warnings are logged, that the prints above the level do not
+ *          evaluate their arguments and left no format string in the
+ *          format section nor, on the host, in the program file, and that
+ *          the run time level filters the rest. Prints one line per check
+ *          through pfnPrint and returns 0 when all passed. Reads the
+ *          deferred log itself, so its drain must not be started.
+ */
+TKey_INT32 TKey_DebugLevelCheck_Report(TKey_BenchPrint_t pfnPrint);
+
+#endif /* THINKEY_DEBUG_LEVEL_CHECK_H */
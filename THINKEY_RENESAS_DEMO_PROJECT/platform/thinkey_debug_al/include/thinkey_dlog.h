@@ -0,0 +1,192 @@
+/*
+ * \file thinkey_dlog.h
+ *
+ * \brief Header file for the deferred binary log
+ *
+ * A log call stores the ID of its format string, a timestamp and its
+ * arguments as raw words in a ring, with no formatting, no allocation and
+ * no lock: space is reserved with a compare and swap on the ring head, so
+ * TKEY_DLOG() and TKEY_DLOG_BUF() may be called from tasks and interrupts
+ * alike. The format strings are placed in the tkey_dlog_fmt section and a
+ * format's ID is its offset there.
+ *
+ * A low priority task drains the ring, either as binary records to the
+ * log channel of thinkey_rtt.h, which script/dlog_decode.py formats with
+ * the strings from the ELF file, or formatted as text on the target.
+ *
+ * Records, in little endian words:
+ *   header: 0xD1 (bits 31-24), buffer flag (bit 20), level (bits 19-16),
+ *           argument count (bits 11-8), words in the record (bits 7-0)
+ *   format ID, timestamp in run time counter ticks,
+ *   then the arguments, or for a buffer its length in bytes and up to
+ *   TKEY_DLOG_MAX_BUF of its bytes.
+ * An info record, with format ID TKEY_DLOG_ID_INFO, carries the counter
+ * rate and the drop counts; the drain sends one first and whenever a
+ * count changes.
+ *
+ * Arguments are stored as 32-bit words, so the formats may only take
+ * integers, characters and pointers. A %s argument is stored as its
+ * pointer and must outlive the record: a string literal or a task name.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_DLOG_H
+#define THINKEY_DLOG_H
+
+#include "thinkey_platform_types.h"
+#include <stdint.h>
+
+/* Ring size, a power of two */
+#ifndef TKEY_DLOG_RING_WORDS
+#define TKEY_DLOG_RING_WORDS 1024
+#endif
+/* Bytes of a buffer kept in its record */
+#ifndef TKEY_DLOG_MAX_BUF
+#define TKEY_DLOG_MAX_BUF 64
+#endif
+#ifndef TKEY_DLOG_DRAIN_MS
+#define TKEY_DLOG_DRAIN_MS 10
+#endif
+/* task_debug_init() drains as text lines to the terminal channel when (1), as
+ * binary records for script/dlog_decode.py when (0) */
+#ifndef TKEY_DLOG_TEXT
+#define TKEY_DLOG_TEXT (0)
+#endif
+/* Text line length when formatting on the target */
+#ifndef TKEY_DLOG_LINE_SIZE
+#define TKEY_DLOG_LINE_SIZE 160
+#endif
+
+#define TKEY_DLOG_LEVEL_ERROR 1
+#define TKEY_DLOG_LEVEL_WARNING 2
+#define TKEY_DLOG_LEVEL_INFO 3
+#define TKEY_DLOG_LEVEL_DEBUG 4
+
+#define TKEY_DLOG_MAX_ARGS 8
+#define TKEY_DLOG_MAGIC 0xD1u
+#define TKEY_DLOG_FLAG_BUF 0x00100000u
+#define TKEY_DLOG_ID_INFO 0xFFFFFFFFu
+#define TKEY_DLOG_HEADER_WORDS 3
+#define TKEY_DLOG_RECORD_MAX_WORDS \
+    (TKEY_DLOG_HEADER_WORDS + 1 + (TKEY_DLOG_MAX_BUF + 3) / 4)
+
+#define TKEY_DLOG_WORDS(uiHeader) ((uiHeader) & 0xFFu)
+#define TKEY_DLOG_ARG_COUNT(uiHeader) (((uiHeader) >> 8) & 0xFu)
+#define TKEY_DLOG_LEVEL(uiHeader) (((uiHeader) >> 16) & 0xFu)
+
+/* Places a format string in the tkey_dlog_fmt section */
+#define TKEY_DLOG_FORMAT(name, fmt) \
+    static const TKey_CHAR name[] __attribute__((section("tkey_dlog_fmt"), used)) = fmt
+
+#define TKEY_DLOG_ARG(x) ((TKey_UINT32)(uintptr_t)(x))
+#define TKEY_DLOG_ARGS_1(a) TKEY_DLOG_ARG(a)
+#define TKEY_DLOG_ARGS_2(a, ...) TKEY_DLOG_ARG(a), TKEY_DLOG_ARGS_1(__VA_ARGS__)
+#define TKEY_DLOG_ARGS_3(a, ...) TKEY_DLOG_ARG(a), TKEY_DLOG_ARGS_2(__VA_ARGS__)
+#define TKEY_DLOG_ARGS_4(a, ...) TKEY_DLOG_ARG(a), TKEY_DLOG_ARGS_3(__VA_ARGS__)
+#define TKEY_DLOG_ARGS_5(a, ...) TKEY_DLOG_ARG(a), TKEY_DLOG_ARGS_4(__VA_ARGS__)
+#define TKEY_DLOG_ARGS_6(a, ...) TKEY_DLOG_ARG(a), TKEY_DLOG_ARGS_5(__VA_ARGS__)
+#define TKEY_DLOG_ARGS_7(a, ...) TKEY_DLOG_ARG(a), TKEY_DLOG_ARGS_6(__VA_ARGS__)
+#define TKEY_DLOG_ARGS_8(a, ...) TKEY_DLOG_ARG(a), TKEY_DLOG_ARGS_7(__VA_ARGS__)
+
+#define TKEY_DLOG_0(level, fmt) do { \
+        TKEY_DLOG_FORMAT(acTKeyDLogFmt, fmt); \
+        TKey_DLog_Write((level), acTKeyDLogFmt, TKey_NULL, 0); \
+    } while(0)
+#define TKEY_DLOG_N(n, level, fmt, ...) do { \
+        TKEY_DLOG_FORMAT(acTKeyDLogFmt, fmt); \
+        const TKey_UINT32 auiTKeyDLogArgs[n] = { TKEY_DLOG_ARGS_##n(__VA_ARGS__) }; \
+        TKey_DLog_Write((level), acTKeyDLogFmt, auiTKeyDLogArgs, n); \
+    } while(0)
+#define TKEY_DLOG_1(level, fmt, ...) TKEY_DLOG_N(1, level, fmt, __VA_ARGS__)
+#define TKEY_DLOG_2(level, fmt, ...) TKEY_DLOG_N(2, level, fmt, __VA_ARGS__)
+#define TKEY_DLOG_3(level, fmt, ...) TKEY_DLOG_N(3, level, fmt, __VA_ARGS__)
+#define TKEY_DLOG_4(level, fmt, ...) TKEY_DLOG_N(4, level, fmt, __VA_ARGS__)
+#define TKEY_DLOG_5(level, fmt, ...) TKEY_DLOG_N(5, level, fmt, __VA_ARGS__)
+#define TKEY_DLOG_6(level, fmt, ...) TKEY_DLOG_N(6, level, fmt, __VA_ARGS__)
+#define TKEY_DLOG_7(level, fmt, ...) TKEY_DLOG_N(7, level, fmt, __VA_ARGS__)
+#define TKEY_DLOG_8(level, fmt, ...) TKEY_DLOG_N(8, level, fmt, __VA_ARGS__)
+#define TKEY_DLOG_PICK(_f, _1, _2, _3, _4, _5, _6, _7, _8, name, ...) name
+
+/**
+ *  @brief Logs a format string literal and up to TKEY_DLOG_MAX_ARGS
+ *         arguments, e.g. TKEY_DLOG(TKEY_DLOG_LEVEL_INFO, "cid %d", usCid)
+ */
+#define TKEY_DLOG(level, ...) \
+    TKEY_DLOG_PICK(__VA_ARGS__, TKEY_DLOG_8, TKEY_DLOG_7, TKEY_DLOG_6, \
+                   TKEY_DLOG_5, TKEY_DLOG_4, TKEY_DLOG_3, TKEY_DLOG_2, \
+                   TKEY_DLOG_1, TKEY_DLOG_0, TKEY_DLOG_0)(level, __VA_ARGS__)
+
+/**
+ *  @brief Logs a format string literal, printed ahead of the bytes of a
+ *         buffer; only the first TKEY_DLOG_MAX_BUF bytes are kept
+ */
+#define TKEY_DLOG_BUF(level, fmt, pvData, uiLength) do { \
+        TKEY_DLOG_FORMAT(acTKeyDLogFmt, fmt); \
+        TKey_DLog_WriteBuf((level), acTKeyDLogFmt, (pvData), (uiLength)); \
+    } while(0)
+
+/**
+ *  @brief Ring counters
+ */
+typedef struct
+{
+    TKey_UINT32 uiWritten;              /* records stored */
+    TKey_UINT32 uiDropped;              /* records not stored, ring full */
+    TKey_UINT32 uiSinkDropped;          /* records the sink did not take */
+} TKey_DLogCounts_t;
+
+/**
+ *  @brief Sink of the drain; returns the bytes taken, a record or line not
+ *         taken whole is counted as dropped
+ */
+typedef TKey_UINT32 (*TKey_DLogWrite_t)(const TKey_BYTE *pbData,
+                                        TKey_UINT32 uiLength);
+
+/**
+ * \brief   Stores a record. Use TKEY_DLOG(), which places the format.
+ */
+TKey_VOID TKey_DLog_Write(TKey_UINT32 uiLevel, const TKey_CHAR *pcFormat,
+                          const TKey_UINT32 *puiArgs, TKey_UINT32 uiArgs);
+
+/**
+ * \brief   Stores a buffer record. Use TKEY_DLOG_BUF(), which places the
+ *          format.
+ */
+TKey_VOID TKey_DLog_WriteBuf(TKey_UINT32 uiLevel, const TKey_CHAR *pcFormat,
+                             const TKey_VOID *pvData, TKey_UINT32 uiLength);
+
+/**
+ * \brief   Takes the oldest record into puiRecord, which holds
+ *          TKEY_DLOG_RECORD_MAX_WORDS words. Returns its words, 0 when the
+ *          ring is empty or the oldest record is still being written.
+ *          One reader at a time.
+ */
+TKey_UINT32 TKey_DLog_Read(TKey_UINT32 *puiRecord);
+
+/**
+ * \brief   Formats a record as a text line ending in "\r\n". Returns the
+ *          characters written, not counting the terminating zero.
+ */
+TKey_UINT32 TKey_DLog_Format(const TKey_UINT32 *puiRecord, TKey_CHAR *pcOut,
+                             TKey_UINT32 uiMax);
+
+/**
+ * \brief   Returns the format string of an ID, THINKey_NULL if unknown
+ */
+const TKey_CHAR* TKey_DLog_GetFormat(TKey_UINT32 uiId);
+
+/**
+ * \brief   Returns the counters
+ */
+TKey_VOID TKey_DLog_GetCounts(TKey_DLogCounts_t *psCounts);
+
+/**
+ * \brief   Starts the task draining the ring every TKEY_DLOG_DRAIN_MS into
+ *          pfnWrite, as binary records or as text lines if bText. A
+ *          THINKey_NULL pfnWrite is the log channel of thinkey_rtt.h for
+ *          records and the terminal channel for text.
+ */
+THINKey_eStatusType TKey_DLog_Start(TKey_DLogWrite_t pfnWrite, TKey_BOOL bText);
+
+#endif /* THINKEY_DLOG_H */
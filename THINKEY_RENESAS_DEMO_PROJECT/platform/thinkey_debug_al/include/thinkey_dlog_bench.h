@@ -0,0 +1,54 @@
+/*
+ * \file thinkey_dlog_bench.h
+ *
+ * \brief Header file for the deferred log benchmark
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_DLOG_BENCH_H
+#define THINKEY_DLOG_BENCH_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+#define TKEY_DLOG_BENCH_MAX_RESULTS 7
+
+/**
+ *  @brief Default iteration count. Each iteration times
+ *         TKEY_DLOG_BENCH_BATCH log calls, fewer than the 16 messages the
+ *         old debug queue holds.
+ */
+#ifndef TKEY_DLOG_BENCH_ITERATIONS
+#define TKEY_DLOG_BENCH_ITERATIONS 1000
+#endif
+#define TKEY_DLOG_BENCH_BATCH 8
+
+/* Records per writer in the concurrent case */
+#ifndef TKEY_DLOG_BENCH_CONCURRENT_RECORDS
+#define TKEY_DLOG_BENCH_CONCURRENT_RECORDS 20000
+#endif
+
+/**
+ * \brief   Times a log call with three arguments the way task_debug_printf
+ *          did it (allocate, print the task name, format, queue) and a
+ *          bare vsnprintf, against TKEY_DLOG() with none and three
+ *          arguments and TKEY_DLOG_BUF() of 32 bytes, and the drain side
+ *          formatting of a record. A case fails when the records read back
+ *          differ from what was logged. On the host, three tasks and an
+ *          emulated interrupt also log at once while the ring is read, and
+ *          that case fails when a record is torn, out of order per writer
+ *          or not counted. Returns the number of results written.
+ */
+TKey_UINT32 TKey_DLogBench_Run(TKey_BenchResult_t *psResults,
+                               TKey_UINT32 uiMaxResults,
+                               TKey_UINT32 uiIterations);
+
+/**
+ * \brief   Runs the suite and emits the CSV table through pfnPrint.
+ *          Returns 0 when every case succeeded.
+ */
+TKey_INT32 TKey_DLogBench_Report(TKey_BenchPrint_t pfnPrint,
+                                 TKey_UINT32 uiIterations);
+
+#endif /* THINKEY_DLOG_BENCH_H */
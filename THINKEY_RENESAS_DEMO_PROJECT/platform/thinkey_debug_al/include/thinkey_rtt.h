@@ -0,0 +1,152 @@
+/*
+ * \file thinkey_rtt.h
+ *
+ * \brief Header file for the RTT up channels
+ *
+ * Each kind of debug output has its own RTT up channel, so that a fast
+ * stream cannot stall or break into another:
+ *   0 terminal  printf and the text lines of the deferred log
+ *   1 sysmon    frames of thinkey_sysmon.h
+ *   2 log       records of thinkey_dlog.h
+ *   3 report    ranging report records, below
+ *   4 trace     trace events, below
+ * A write never blocks. A channel with the skip policy writes a record
+ * whole or drops it, one with the trim policy writes what fits. Writes and
+ * drops are counted per channel.
+ *
+ * With a mux set by TKey_Rtt_SetMux(), as on the host or for a probe that
+ * reads one stream, every write goes to it instead, in frames of
+ *   0xA7, channel, payload length (2 bytes), payload,
+ *   checksum making the bytes after 0xA7 sum to 0
+ * which script/rtt_demux.py splits back into one file per channel. Writes
+ * longer than TKEY_RTT_MUX_PAYLOAD take several frames.
+ *
+ * Report records: type, payload length (1 byte), payload. The TWR record
+ * (TKEY_RTT_REPORT_TWR) carries, little endian, the tag address and range
+ * number (2 bytes each), the reception time in us (4), the distance, X and
+ * Y in cm (4 each, signed), the PDoA of the final and poll in hundredths of
+ * a degree and the clock offset in hundredths of ppm (2 each, signed), the
+ * flags (2) and the accelerations X, Y, Z in mg (2 each, signed).
+ *
+ * Trace records: timestamp in run time counter ticks, event, argument, as
+ * three little endian words. TKEY_TRACE_CLOCK carries the counter rate.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_RTT_H
+#define THINKEY_RTT_H
+
+#include "thinkey_platform_types.h"
+
+#define TKEY_RTT_CHANNEL_TERMINAL 0
+#define TKEY_RTT_CHANNEL_SYSMON 1
+#define TKEY_RTT_CHANNEL_LOG 2
+#define TKEY_RTT_CHANNEL_REPORT 3
+#define TKEY_RTT_CHANNEL_TRACE 4
+#define TKEY_RTT_CHANNEL_COUNT 5
+
+/* Buffer sizes of the channels configured here; the terminal buffer is
+ * BUFFER_SIZE_UP of SEGGER_RTT_Conf.h */
+#ifndef TKEY_RTT_SYSMON_BUFFER_SIZE
+#define TKEY_RTT_SYSMON_BUFFER_SIZE 1024
+#endif
+#ifndef TKEY_RTT_LOG_BUFFER_SIZE
+#define TKEY_RTT_LOG_BUFFER_SIZE 2048
+#endif
+#ifndef TKEY_RTT_REPORT_BUFFER_SIZE
+#define TKEY_RTT_REPORT_BUFFER_SIZE 1024
+#endif
+#ifndef TKEY_RTT_TRACE_BUFFER_SIZE
+#define TKEY_RTT_TRACE_BUFFER_SIZE 512
+#endif
+/* TKEY_TRACE() is compiled out when (0) */
+#ifndef TKEY_RTT_TRACE
+#define TKEY_RTT_TRACE (1)
+#endif
+
+#define TKEY_RTT_POLICY_SKIP 0
+#define TKEY_RTT_POLICY_TRIM 1
+
+#define TKEY_RTT_MUX_SYNC 0xA7
+#define TKEY_RTT_MUX_PAYLOAD 256
+#define TKEY_RTT_MUX_FRAME_MAX (TKEY_RTT_MUX_PAYLOAD + 5)
+
+#define TKEY_RTT_REPORT_MAX 64
+#define TKEY_RTT_REPORT_TWR 'T'
+#define TKEY_RTT_REPORT_TWR_SIZE 34
+
+#define TKEY_TRACE_CLOCK 0
+#define TKEY_TRACE_STATUS_MESSAGE 1
+#define TKEY_TRACE_TWR_REPORT 2
+/* Events of the application start here */
+#define TKEY_TRACE_USER 0x100
+
+#if (TKEY_RTT_TRACE)
+#define TKEY_TRACE(uiEvent, uiArg) TKey_Rtt_Trace((uiEvent), (TKey_UINT32)(uiArg))
+#else
+#define TKEY_TRACE(uiEvent, uiArg) do { } while(0)
+#endif
+
+/* Writes a whole frame and returns its length, or returns less to drop it */
+typedef TKey_UINT32 (*TKey_RttWrite_t)(const TKey_BYTE *pbData, TKey_UINT32 uiLength);
+
+typedef struct
+{
+    TKey_UINT32 uiWrites;           /* written whole */
+    TKey_UINT32 uiBytes;            /* bytes written */
+    TKey_UINT32 uiDropped;          /* dropped or trimmed */
+    TKey_UINT32 uiDroppedBytes;     /* bytes not written */
+} TKey_RttCounts_t;
+
+/**
+ * \brief   Configures the up channels, once, before the first write.
+ *          Writes before it are dropped.
+ */
+TKey_VOID TKey_Rtt_Init(TKey_VOID);
+
+/**
+ * \brief   Sends every write through pfnWrite in mux frames, or again to
+ *          the RTT channels when THINKey_NULL. pfnWrite may be called from
+ *          several tasks and interrupts at once.
+ */
+TKey_VOID TKey_Rtt_SetMux(TKey_RttWrite_t pfnWrite);
+
+/**
+ * \brief   Writes to a channel without blocking and returns the bytes
+ *          written, as the policy of the channel allows
+ */
+TKey_UINT32 TKey_Rtt_Write(TKey_UINT32 uiChannel, const TKey_VOID *pvData,
+                           TKey_UINT32 uiLength);
+
+/**
+ * \brief   Reads what the probe sent on a down channel, without blocking,
+ *          and returns the bytes read. Always 0 on host builds.
+ */
+TKey_UINT32 TKey_Rtt_Read(TKey_UINT32 uiChannel, TKey_VOID *pvData,
+                          TKey_UINT32 uiMaxLength);
+
+/**
+ * \brief   Writes a report record of up to TKEY_RTT_REPORT_MAX bytes of
+ *          payload to the report channel. Returns E_THINKEY_FAILURE if it
+ *          was dropped.
+ */
+THINKey_eStatusType TKey_Rtt_Report(TKey_UINT32 uiType, const TKey_VOID *pvPayload,
+                                    TKey_UINT32 uiLength);
+
+/**
+ * \brief   Writes a trace record. Use TKEY_TRACE(), which can be compiled out.
+ */
+TKey_VOID TKey_Rtt_Trace(TKey_UINT32 uiEvent, TKey_UINT32 uiArg);
+
+/**
+ * \brief   Returns the counters of a channel
+ */
+TKey_VOID TKey_Rtt_GetCounts(TKey_UINT32 uiChannel, TKey_RttCounts_t *psCounts);
+
+/**
+ * \brief   Returns the name of a channel, THINKey_NULL if unknown
+ */
+const TKey_CHAR* TKey_Rtt_ChannelName(TKey_UINT32 uiChannel);
+
+#endif /* THINKEY_RTT_H */
@@ -0,0 +1,33 @@
+/*
+ * \file thinkey_rtt_check.h
+ *
+ * \brief Header file for the RTT channel check
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_RTT_CHECK_H
+#define THINKEY_RTT_CHECK_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+/* Records per writer in the concurrent case */
+#ifndef TKEY_RTT_CHECK_RECORDS
+#define TKEY_RTT_CHECK_RECORDS 500
+#endif
+
+/**
+ * \brief   Sends the channels through a mux capturing to memory and checks
+ *          the frames of each channel, a write split over several frames,
+ *          the skip policy and the drop counters when the capture is full,
+ *          a report record, three tasks and an emulated interrupt writing
+ *          to four channels at once, and the deferred log drained to the
+ *          log channel. Prints one line per check through pfnPrint and
+ *          returns 0 when all passed. Sets the mux and starts the deferred
+ *          log drain, so it can run once only. The interrupt is emulated
+ *          on the host only.
+ */
+TKey_INT32 TKey_RttCheck_Report(TKey_BenchPrint_t pfnPrint);
+
+#endif /* THINKEY_RTT_CHECK_H */
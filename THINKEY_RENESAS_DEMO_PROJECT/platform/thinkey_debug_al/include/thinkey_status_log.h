@@ -0,0 +1,80 @@
+/*
+ * \file thinkey_status_log.h
+ *
+ * \brief Header file for the status message history
+ *
+ * The status messages shown on the tab app are kept in a ring of records,
+ * each a header (text length, sequence number, timestamp in run time
+ * counter ticks) and the text, padded to a word. A new message overwrites
+ * the oldest ones when the ring is full, so the latest are always there to
+ * be queried with TKey_StatusLog_GetLast().
+ *
+ * Every consumer reads with its own TKey_StatusReader_t and gets a copy of
+ * each record, in order. A consumer that falls behind by more than the
+ * ring holds finds the overwritten records counted in its reader.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_STATUS_LOG_H
+#define THINKEY_STATUS_LOG_H
+
+#include "thinkey_platform_types.h"
+
+/* Bytes of the ring, headers included, a power of two */
+#ifndef TKEY_STATUS_LOG_SIZE
+#define TKEY_STATUS_LOG_SIZE 2048
+#endif
+/* Longest text kept, without its terminating NUL */
+#define TKEY_STATUS_LOG_TEXT_MAX 63
+
+typedef struct
+{
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiTime;
+    TKey_UINT32 uiLength;
+    TKey_CHAR acText[TKEY_STATUS_LOG_TEXT_MAX + 1];
+} TKey_StatusRecord_t;
+
+typedef struct
+{
+    TKey_UINT32 uiNext;             /* sequence number to read next */
+    TKey_UINT32 uiAt;               /* its place in the ring */
+    TKey_UINT32 uiLost;             /* overwritten before being read */
+} TKey_StatusReader_t;
+
+/**
+ * \brief   Adds a message, cut to TKEY_STATUS_LOG_TEXT_MAX bytes, and
+ *          returns its sequence number. Not from an interrupt.
+ */
+TKey_UINT32 TKey_StatusLog_Write(const TKey_CHAR *pcText, TKey_UINT32 uiLength);
+
+/**
+ * \brief   Sets a reader to the oldest message kept if bFromOldest, or else
+ *          to the next message written
+ */
+TKey_VOID TKey_StatusLog_ReaderInit(TKey_StatusReader_t *psReader, TKey_BOOL bFromOldest);
+
+/**
+ * \brief   Copies the next message of a reader to psRecord. Returns
+ *          E_THINKEY_FAILURE when there is none. Messages overwritten
+ *          since the last read are skipped and added to psReader->uiLost.
+ */
+THINKey_eStatusType TKey_StatusLog_Read(TKey_StatusReader_t *psReader,
+                                        TKey_StatusRecord_t *psRecord);
+
+/**
+ * \brief   Copies the last uiCount messages kept, or fewer if not as many
+ *          are, oldest first. Returns how many were copied. The copy runs
+ *          with interrupts enabled and is tried again when writers
+ *          overwrite the records being copied; 0 is returned if they keep
+ *          doing so.
+ */
+TKey_UINT32 TKey_StatusLog_GetLast(TKey_StatusRecord_t *pasRecords, TKey_UINT32 uiCount);
+
+/**
+ * \brief   Returns the messages written and overwritten so far
+ */
+TKey_VOID TKey_StatusLog_GetCounts(TKey_UINT32 *puiWritten, TKey_UINT32 *puiOverwritten);
+
+#endif /* THINKEY_STATUS_LOG_H */
@@ -0,0 +1,30 @@
+/*
+ * \file thinkey_status_log_check.h
+ *
+ * \brief Header file for the status message history check
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_STATUS_LOG_CHECK_H
+#define THINKEY_STATUS_LOG_CHECK_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+/* Messages per writer in the concurrent case */
+#ifndef TKEY_STATUS_LOG_CHECK_MESSAGES
+#define TKEY_STATUS_LOG_CHECK_MESSAGES 2000
+#endif
+
+/**
+ * \brief   Checks the messages read back in order with their length and
+ *          timestamp, long messages cut, two readers at their own pace,
+ *          the oldest overwritten and counted as lost by a reader left
+ *          behind, the last N query, and two tasks writing while a reader
+ *          reads. Prints one line per check through pfnPrint and returns 0
+ *          when all passed. Writes to the history, so nothing else may.
+ */
+TKey_INT32 TKey_StatusLogCheck_Report(TKey_BenchPrint_t pfnPrint);
+
+#endif /* THINKEY_STATUS_LOG_CHECK_H */
@@ -0,0 +1,140 @@
+/*
+ * \file thinkey_sysmon.h
+ *
+ * \brief Header file for the task, stack and queue monitor
+ *
+ * Samples the OSAL task and queue statistics: the CPU share of every task
+ * since the previous sample, its stack high water mark, and the depth,
+ * peak and drops of every queue. A sample is printed by the TASKSTAT
+ * debug command, and sent periodically as compact binary frames on an RTT
+ * channel; script/sysmon_decode.py decodes a capture of that channel.
+ *
+ * The periodic report task also reads the RTT terminal down channel and
+ * answers a TASKSTAT line there with the table, at its next report.
+ *
+ * Frames, little endian: 0xA5, type, payload length (2 bytes), payload,
+ * and a checksum making the bytes from the type on sum to 0 (mod 256).
+ *
+ * 'S' stats: seq (2), window in us (4),
+ *            task count (1) and per task: number (1), priority (1),
+ *                CPU in 0.01 % of one CPU (2), stack words free (2),
+ *            queue count (1) and per queue: index (1), depth (2),
+ *                peak (2), dropped (2)
+ * 'N' names: count (1) and per name: kind (1, 0 task, 1 queue),
+ *            number or index (1), length (1), characters
+ *
+ * A names frame goes ahead of the first stats frame, every
+ * TKEY_SYSMON_NAMES_EVERY frames and when the tasks or queues change.
+ * Counts above 0xFFFF are sent as 0xFFFF.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_SYSMON_H
+#define THINKEY_SYSMON_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_osal.h"
+
+#ifndef TKEY_SYSMON_MAX_TASKS
+#define TKEY_SYSMON_MAX_TASKS 16
+#endif
+#ifndef TKEY_SYSMON_MAX_QUEUES
+#define TKEY_SYSMON_MAX_QUEUES 16
+#endif
+#ifndef TKEY_SYSMON_NAMES_EVERY
+#define TKEY_SYSMON_NAMES_EVERY 16
+#endif
+/* Periodic report, 0 for none */
+#ifndef TKEY_SYSMON_PERIOD_MS
+#define TKEY_SYSMON_PERIOD_MS 1000
+#endif
+
+#define TKEY_SYSMON_FRAME_SYNC 0xA5
+#define TKEY_SYSMON_FRAME_STATS 'S'
+#define TKEY_SYSMON_FRAME_NAMES 'N'
+#define TKEY_SYSMON_NAME_MAX 15
+#define TKEY_SYSMON_CPU_FULL 10000     /* one CPU, in 0.01 % */
+#define TKEY_SYSMON_COMMAND "TASKSTAT"
+
+/* Bytes for a names frame and a stats frame with every task and queue */
+#define TKEY_SYSMON_FRAME_MAX \
+    (5 + 1 + (TKEY_SYSMON_MAX_TASKS + TKEY_SYSMON_MAX_QUEUES) * (3 + TKEY_SYSMON_NAME_MAX) + \
+     5 + 8 + TKEY_SYSMON_MAX_TASKS * 6 + TKEY_SYSMON_MAX_QUEUES * 7)
+
+/**
+ *  @brief One sample
+ */
+typedef struct
+{
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiWindowUs;             /* since the previous sample */
+    TKey_UINT32 uiTasks;
+    THINKey_OSAL_TaskStats_t asTasks[TKEY_SYSMON_MAX_TASKS];
+    TKey_UINT32 auiCpu[TKEY_SYSMON_MAX_TASKS];  /* 0.01 % of one CPU */
+    TKey_UINT32 uiQueues;
+    THINKey_HANDLE ahQueues[TKEY_SYSMON_MAX_QUEUES];
+    THINKey_OSAL_QueueStats_t asQueues[TKEY_SYSMON_MAX_QUEUES];
+} TKey_SysMonSnapshot_t;
+
+/**
+ *  @brief Line sink of the text report
+ */
+typedef TKey_VOID (*TKey_SysMonPrint_t)(const TKey_CHAR *pcLine);
+
+/**
+ *  @brief Sink of the binary report; returns the bytes taken, a frame not
+ *         taken whole is counted as dropped
+ */
+typedef TKey_UINT32 (*TKey_SysMonWrite_t)(const TKey_BYTE *pbData,
+                                          TKey_UINT32 uiLength);
+
+/**
+ * \brief   Samples the tasks and queues. The CPU shares are over the window
+ *          since the previous sample by any caller, or since the run time
+ *          counter started.
+ */
+TKey_VOID TKey_SysMon_Sample(TKey_SysMonSnapshot_t *psSnap);
+
+/**
+ * \brief   Prints the sample as a table through pfnPrint
+ */
+TKey_VOID TKey_SysMon_Print(const TKey_SysMonSnapshot_t *psSnap,
+                            TKey_SysMonPrint_t pfnPrint);
+
+/**
+ * \brief   Samples and prints. One caller at a time: the sample is static.
+ */
+TKey_VOID TKey_SysMon_Report(TKey_SysMonPrint_t pfnPrint);
+
+/**
+ * \brief   Takes debug command input as it comes and runs every complete
+ *          line: TASKSTAT, in any case, samples and prints through
+ *          pfnPrint; other lines are ignored. Returns the commands run.
+ *          One caller at a time: the line is static.
+ */
+TKey_UINT32 TKey_SysMon_Input(const TKey_CHAR *pcData, TKey_UINT32 uiLength,
+                              TKey_SysMonPrint_t pfnPrint);
+
+/**
+ * \brief   Encodes the sample as a stats frame, after a names frame if
+ *          bNames. Returns the bytes written, 0 if uiMaxBytes is too small.
+ */
+TKey_UINT32 TKey_SysMon_Encode(const TKey_SysMonSnapshot_t *psSnap,
+                               TKey_BOOL bNames, TKey_BYTE *pbOut,
+                               TKey_UINT32 uiMaxBytes);
+
+/**
+ * \brief   Starts the task sending a report every uiPeriodMs through
+ *          pfnWrite, or to the sysmon channel of thinkey_rtt.h when
+ *          pfnWrite is THINKey_NULL
+ */
+THINKey_eStatusType TKey_SysMon_Start(TKey_UINT32 uiPeriodMs,
+                                      TKey_SysMonWrite_t pfnWrite);
+
+/**
+ * \brief   Returns the periodic reports sent and dropped so far
+ */
+TKey_VOID TKey_SysMon_GetCounts(TKey_UINT32 *puiSent, TKey_UINT32 *puiDropped);
+
+#endif /* THINKEY_SYSMON_H */
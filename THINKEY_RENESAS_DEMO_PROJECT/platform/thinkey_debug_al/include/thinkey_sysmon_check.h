@@ -0,0 +1,26 @@
+/*
+ * \file thinkey_sysmon_check.h
+ *
+ * \brief Header file for the task, stack and queue monitor check
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_SYSMON_CHECK_H
+#define THINKEY_SYSMON_CHECK_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+/**
+ * \brief   Runs a task spinning half of the time, an idle task and a task
+ *          using a deep stack, and checks their CPU shares and stack marks
+ *          in a sample, the depth, peak and drops of a queue, the binary
+ *          frames against the sample, the TASKSTAT command and the
+ *          periodic report. Prints one
+ *          line per check through pfnPrint and returns 0 when all passed.
+ *          Starts the periodic report, so it can run once only.
+ */
+TKey_INT32 TKey_SysMonCheck_Report(TKey_BenchPrint_t pfnPrint);
+
+#endif /* THINKEY_SYSMON_CHECK_H */
@@ -0,0 +1,126 @@
+/*
+ * \file thinkey_bench.c
+ *
+ * \brief Benchmark timing and CSV reporting helpers
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_bench.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(THINKEY_HOST_BUILD)
+#include <time.h>
+#else
+#include "bsp_api.h"
+#endif
+
+TKey_VOID TKey_Bench_TimerInit(TKey_VOID)
+{
+#if !defined(THINKEY_HOST_BUILD)
+    /* Enable trace so the DWT cycle counter runs, then start it */
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+TKey_UINT64 TKey_Bench_Now(TKey_VOID)
+{
+#if defined(THINKEY_HOST_BUILD)
+    struct timespec sTs;
+
+    clock_gettime(CLOCK_MONOTONIC, &sTs);
+    return ((TKey_UINT64)sTs.tv_sec * 1000000000ULL) + (TKey_UINT64)sTs.tv_nsec;
+#else
+    /* Extend the 32-bit counter; callers sample at least once per wrap
+     * (~21 s at 200 MHz) so a single wrap between samples is handled */
+    static TKey_UINT32 suiLast = 0;
+    static TKey_UINT32 suiHigh = 0;
+    TKey_UINT32 uiNow = DWT->CYCCNT;
+
+    if(uiNow < suiLast) {
+        suiHigh++;
+    }
+    suiLast = uiNow;
+    return ((TKey_UINT64)suiHigh << 32) | uiNow;
+#endif
+}
+
+TKey_UINT64 TKey_Bench_TicksPerSecond(TKey_VOID)
+{
+#if defined(THINKEY_HOST_BUILD)
+    return 1000000000ULL;
+#else
+    return (TKey_UINT64)SystemCoreClock;
+#endif
+}
+
+const TKey_CHAR* TKey_Bench_TickUnit(TKey_VOID)
+{
+#if defined(THINKEY_HOST_BUILD)
+    return "ns";
+#else
+    return "cycles";
+#endif
+}
+
+TKey_VOID TKey_Bench_Record(TKey_BenchResult_t *psResult,
+                            TKey_UINT64 ullStart, TKey_UINT64 ullEnd)
+{
+    TKey_UINT64 ullTicks = ullEnd - ullStart;
+
+    if(0 == psResult->uiIterations || ullTicks < psResult->ullMinTicks) {
+        psResult->ullMinTicks = ullTicks;
+    }
+    psResult->ullTotalTicks += ullTicks;
+    psResult->uiIterations++;
+}
+
+TKey_VOID TKey_Bench_PrintHeader(TKey_BenchPrint_t pfnPrint)
+{
+    TKey_CHAR acLine[TKEY_BENCH_LINE_SIZE];
+
+    snprintf(acLine, sizeof(acLine),
+             "%s,suite,name,bytes,iterations,unit,avg,min,ops_per_s,"
+             "kib_per_s,status\r\n", TKEY_BENCH_LINE_TAG);
+    pfnPrint(acLine);
+}
+
+TKey_VOID TKey_Bench_PrintResults(TKey_BenchPrint_t pfnPrint,
+                                  const TKey_BenchResult_t *psResults,
+                                  TKey_UINT32 uiCount)
+{
+    TKey_CHAR acLine[TKEY_BENCH_LINE_SIZE];
+    TKey_UINT64 ullHz = TKey_Bench_TicksPerSecond();
+    TKey_UINT64 ullAvg;
+    TKey_UINT64 ullOps;
+    TKey_UINT64 ullKibs;
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < uiCount; uiIndex++) {
+        const TKey_BenchResult_t *psRes = &psResults[uiIndex];
+
+        ullAvg = 0;
+        ullOps = 0;
+        ullKibs = 0;
+        if(0 != psRes->uiIterations) {
+            ullAvg = psRes->ullTotalTicks / psRes->uiIterations;
+        }
+        if(0 != ullAvg) {
+            ullOps = ullHz / ullAvg;
+            ullKibs = ((TKey_UINT64)psRes->uiBytes * ullHz) / (ullAvg * 1024);
+        }
+        /* Integer formatting only: newlib-nano has no float printf */
+        snprintf(acLine, sizeof(acLine),
+                 "%s,%s,%s,%u,%u,%s,%lu,%lu,%lu,%lu,%d\r\n",
+                 TKEY_BENCH_LINE_TAG, psRes->pcSuite, psRes->pcName,
+                 (unsigned)psRes->uiBytes, (unsigned)psRes->uiIterations,
+                 TKey_Bench_TickUnit(), (unsigned long)ullAvg,
+                 (unsigned long)psRes->ullMinTicks, (unsigned long)ullOps,
+                 (unsigned long)ullKibs, (int)psRes->iStatus);
+        pfnPrint(acLine);
+    }
+}
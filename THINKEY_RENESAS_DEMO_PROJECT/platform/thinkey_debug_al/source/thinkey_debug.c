@@ -14,21 +14,38 @@
 #include "thinkey_tab_app.h"
 #include "thinkey_osal.h"
 #include "thinkey_debug.h"
+#include "thinkey_sysmon.h"
+#include "thinkey_rtt.h"
+#include "thinkey_status_log.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 
-#define TAB_APP_MSG_SIZE  64
+#define TAB_APP_MSG_SIZE  (TKEY_STATUS_LOG_TEXT_MAX + 1)
+/* Texts the tab app may still be reading: the messages waiting on its
+ * queue and the one it handles. The queue length is not known here, so a
+ * message that would reuse a buffer still referenced is not posted; the
+ * status history keeps it. */
 #define TAB_APP_MSG_BUFFER_COUNT 5
 
+/* The tab app gets a pointer to the text and the sequence number, so the
+ * message must have room for both */
+_Static_assert(sizeof(((sTabAppMessageType *)0)->aiData) >= 2 * sizeof(TKey_INT32),
+               "the tab app message carries the text and its sequence number");
+
 static TKey_UINT32 guiMsgBufferIndex = 0;
 TKey_CHAR gcMsgBuffer[TAB_APP_MSG_BUFFER_COUNT][TAB_APP_MSG_SIZE];
 
 /* Initialisation method for debug prints */
 THINKey_eStatusType THINKey_DEBUGInit(THINKey_VOID)
 {
-    //task_debug_init();
+    TKey_Rtt_Init();
+    task_debug_init();
+#if (TKEY_SYSMON_PERIOD_MS != 0)
+    return TKey_SysMon_Start(TKEY_SYSMON_PERIOD_MS, THINKey_NULL);
+#else
     return E_THINKEY_SUCCESS;
+#endif
 }
 
 TKey_VOID TKey_Debug_Tab_App_Send_Status_Message(TKey_CHAR* pcStringPtr, ...)
@@ -36,15 +53,32 @@ TKey_VOID TKey_Debug_Tab_App_Send_Status_Message(TKey_CHAR* pcStringPtr, ...)
     sTabAppMessageType sTabAppMessage;
     sTabAppMessage.eEvent = E_TAB_APP_SEND_STATUS_MSG;
     THINKey_eStatusType eResult;
-    
-    
+    THINKey_OSAL_QueueStats_t sQueueStats;
+    TKey_CHAR acText[TAB_APP_MSG_SIZE];
+    TKey_CHAR *pcMessage = gcMsgBuffer[guiMsgBufferIndex];
+    TKey_UINT32 uiSeq;
+
     va_list args;
     va_start(args, pcStringPtr);
-    memset(gcMsgBuffer[guiMsgBufferIndex], 0, TAB_APP_MSG_SIZE);
-    vsnprintf(gcMsgBuffer[guiMsgBufferIndex], TAB_APP_MSG_SIZE, pcStringPtr, args);
+    memset(acText, 0, TAB_APP_MSG_SIZE);
+    vsnprintf(acText, TAB_APP_MSG_SIZE, pcStringPtr, args);
     va_end(args);
-    sTabAppMessage.aiData[0] = (TKey_INT32)&gcMsgBuffer[guiMsgBufferIndex];
+
+    /* The history keeps the message whether or not the tab app gets it */
+    uiSeq = TKey_StatusLog_Write(acText, strlen(acText));
+    TKEY_TRACE(TKEY_TRACE_STATUS_MESSAGE, uiSeq);
     THINKey_sTabAppParamType *psTabTaskParams = hGetTabAppHandle();
+    THINKey_OSAL_vQueueGetStats(psTabTaskParams->vTabAppQueue, &sQueueStats);
+    if(sQueueStats.uiDepth + 1 >= TAB_APP_MSG_BUFFER_COUNT)
+    {
+        /* The next buffer may still be queued: leave it intact */
+        THINKEY_DEBUG_INFO ("print on tab skipped, %lu queued\r\n",
+                            (unsigned long)sQueueStats.uiDepth);
+        return;
+    }
+    memcpy(pcMessage, acText, TAB_APP_MSG_SIZE);
+    sTabAppMessage.aiData[0] = (TKey_INT32)pcMessage;
+    sTabAppMessage.aiData[1] = (TKey_INT32)uiSeq;
     eResult = THINKey_OSAL_eQueueSend
                       (psTabTaskParams->vTabAppQueue, &sTabAppMessage);
     if(E_THINKEY_SUCCESS == eResult)
@@ -0,0 +1,67 @@
+/*
+ * \file thinkey_debug_level.c
+ *
+ * \brief Run time levels of the debug prints
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_debug.h"
+#include <stdio.h>
+
+/* Everything the compile time levels leave in is printed until changed */
+TKey_BYTE gaucTKeyDebugLevel[THINKEY_DEBUG_MODULE_COUNT] = {
+    THINKEY_DEBUG_LEVEL_DEBUG, THINKEY_DEBUG_LEVEL_DEBUG,
+    THINKEY_DEBUG_LEVEL_DEBUG, THINKEY_DEBUG_LEVEL_DEBUG,
+    THINKEY_DEBUG_LEVEL_DEBUG, THINKEY_DEBUG_LEVEL_DEBUG,
+    THINKEY_DEBUG_LEVEL_DEBUG, THINKEY_DEBUG_LEVEL_DEBUG,
+};
+
+static const TKey_CHAR *const gapcTKeyDebugModules[THINKEY_DEBUG_MODULE_COUNT] = {
+    "app", "osal", "storage", "ble", "nal", "ptx", "security", "ranging",
+};
+
+THINKey_eStatusType TKey_Debug_SetLevel(TKey_UINT32 uiModule, TKey_UINT32 uiLevel)
+{
+    TKey_UINT32 uiIndex;
+
+    if((uiModule > THINKEY_DEBUG_MODULE_COUNT) || (uiLevel > THINKEY_DEBUG_LEVEL_DEBUG)) {
+        return E_THINKEY_FAILURE;
+    }
+    for(uiIndex = 0; uiIndex < THINKEY_DEBUG_MODULE_COUNT; uiIndex++) {
+        if((uiModule == THINKEY_DEBUG_MODULE_COUNT) || (uiModule == uiIndex)) {
+            gaucTKeyDebugLevel[uiIndex] = (TKey_BYTE)uiLevel;
+        }
+    }
+    return E_THINKEY_SUCCESS;
+}
+
+TKey_UINT32 TKey_Debug_GetLevel(TKey_UINT32 uiModule)
+{
+    if(uiModule >= THINKEY_DEBUG_MODULE_COUNT) {
+        return THINKEY_DEBUG_LEVEL_NONE;
+    }
+    return gaucTKeyDebugLevel[uiModule];
+}
+
+const TKey_CHAR* TKey_Debug_ModuleName(TKey_UINT32 uiModule)
+{
+    if(uiModule >= THINKEY_DEBUG_MODULE_COUNT) {
+        return TKey_NULL;
+    }
+    return gapcTKeyDebugModules[uiModule];
+}
+
+TKey_VOID TKey_Debug_PrintBuf(const TKey_CHAR *pcLabel, const TKey_VOID *pvData,
+                              TKey_UINT32 uiLength)
+{
+    const TKey_BYTE *pbData = (const TKey_BYTE *)pvData;
+    TKey_UINT32 uiIndex;
+
+    printf("%s [%lu]", pcLabel, (unsigned long)uiLength);
+    for(uiIndex = 0; (pbData != TKey_NULL) && (uiIndex < uiLength); uiIndex++) {
+        printf(" %02x", pbData[uiIndex]);
+    }
+    printf("\r\n");
+}
@@ -0,0 +1,210 @@
+/*
+ * \file thinkey_debug_level_check.c
+ *
+ * \brief Debug level check
+ *
+ * On the target call TKey_DebugLevelCheck_Report() from a task with the
+ * deferred log drain not started; on a Linux host build with
+ * THINKEY_HOST_BUILD and THINKEY_DEBUG_LEVEL_CHECK_MAIN, linked with the
+ * host OSAL, to get a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+/* The prints of this file go to the deferred log, whose format section is
+ * searched, and the module keeps errors and warnings only */
+#define DEBUG_ENABLE (1)
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_RANGING
+#define THINKEY_DEBUG_MAX_LEVEL_RANGING THINKEY_DEBUG_LEVEL_WARNING
+#if defined(THINKEY_HOST_BUILD)
+#define _GNU_SOURCE                         /* memmem */
+#endif
+
+#include "thinkey_debug_level_check.h"
+#include "thinkey_debug.h"
+#include "thinkey_dlog.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(THINKEY_HOST_BUILD)
+#include <stdlib.h>
+#endif
+
+/* Format strings start with this, then the level */
+#define TKEY_DEBUG_LEVEL_CHECK_TAG "level check"
+
+static const TKey_CHAR *const gapcCheckKept[] = { "error", "warning" };
+static const TKey_CHAR *const gapcCheckStripped[] = { "info", "debug", "dump" };
+
+static TKey_UINT32 guiCheckEvaluated;
+static TKey_UINT32 gauiCheckRecord[TKEY_DLOG_RECORD_MAX_WORDS];
+/* Only used by the dump, which the module level strips */
+static TKey_BYTE gabCheckData[8] __attribute__((unused));
+
+static TKey_UINT32 tkey_debug_level_check_arg(TKey_VOID)
+{
+    return ++guiCheckEvaluated;
+}
+
+/* One print per level */
+static TKey_VOID tkey_debug_level_check_print(TKey_VOID)
+{
+    THINKEY_DEBUG_ERROR("level check error %u", tkey_debug_level_check_arg());
+    THINKEY_DEBUG_WARNING("level check warning %u", tkey_debug_level_check_arg());
+    THINKEY_DEBUG_INFO("level check info %u", tkey_debug_level_check_arg());
+    THINKEY_DEBUG_DEBUG("level check debug %u", tkey_debug_level_check_arg());
+    THINKEY_DEBUG_DUMP("level check dump", gabCheckData, tkey_debug_level_check_arg());
+}
+
+/* Reads the records logged, returns how many there were and puts their
+ * levels in puiLevels, one bit each */
+static TKey_UINT32 tkey_debug_level_check_read(TKey_UINT32 *puiLevels)
+{
+    const TKey_CHAR *pcFormat;
+    TKey_UINT32 uiCount = 0;
+
+    *puiLevels = 0;
+    while(0 != TKey_DLog_Read(gauiCheckRecord)) {
+        pcFormat = TKey_DLog_GetFormat(gauiCheckRecord[1]);
+        if((pcFormat != TKey_NULL) &&
+           (0 == strncmp(pcFormat, TKEY_DEBUG_LEVEL_CHECK_TAG,
+                         sizeof(TKEY_DEBUG_LEVEL_CHECK_TAG) - 1))) {
+            *puiLevels |= 1u << TKEY_DLOG_LEVEL(gauiCheckRecord[0]);
+            uiCount++;
+        }
+    }
+    return uiCount;
+}
+
+/* Looks for the text of a format in the format section, and on the host in
+ * the program file. The text is put together here so that it is only in the
+ * image if the format is. */
+static TKey_BOOL tkey_debug_level_check_find(const TKey_CHAR *pcLevel)
+{
+    TKey_CHAR acText[32];
+    const TKey_CHAR *pcFormat;
+    TKey_UINT32 uiId = 0;
+    TKey_BOOL bFound = TKey_FALSE;
+
+    snprintf(acText, sizeof(acText), "%s %s", TKEY_DEBUG_LEVEL_CHECK_TAG, pcLevel);
+    while((!bFound) && (TKey_NULL != (pcFormat = TKey_DLog_GetFormat(uiId)))) {
+        bFound = (TKey_NULL != strstr(pcFormat, acText));
+        uiId += (TKey_UINT32)strlen(pcFormat) + 1;
+    }
+
+#if defined(THINKEY_HOST_BUILD)
+    {
+        FILE *psFile = fopen("/proc/self/exe", "rb");
+        TKey_CHAR *pcImage;
+        long lSize;
+
+        if(psFile == TKey_NULL) {
+            return TKey_TRUE;
+        }
+        fseek(psFile, 0, SEEK_END);
+        lSize = ftell(psFile);
+        fseek(psFile, 0, SEEK_SET);
+        pcImage = malloc((size_t)lSize);
+        if((pcImage == TKey_NULL) || (fread(pcImage, 1, (size_t)lSize, psFile) != (size_t)lSize)) {
+            bFound = TKey_TRUE;
+        } else if(TKey_NULL != memmem(pcImage, (size_t)lSize, acText, strlen(acText))) {
+            bFound = TKey_TRUE;
+        }
+        free(pcImage);
+        fclose(psFile);
+    }
+#endif
+    return bFound;
+}
+
+static TKey_VOID tkey_debug_level_check_result(TKey_BenchPrint_t pfnPrint,
+                                               const TKey_CHAR *pcCheck,
+                                               TKey_BOOL bPassed, TKey_UINT32 *puiFailed)
+{
+    TKey_CHAR acLine[64];
+
+    snprintf(acLine, sizeof(acLine), "%-24s %s\r\n", pcCheck,
+             bPassed ? "pass" : "FAIL");
+    pfnPrint(acLine);
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+TKey_INT32 TKey_DebugLevelCheck_Report(TKey_BenchPrint_t pfnPrint)
+{
+    TKey_UINT32 uiFailed = 0;
+    TKey_UINT32 uiLevels;
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_BOOL bPassed;
+
+    (void)tkey_debug_level_check_read(&uiLevels);
+
+    /* Compile time level */
+    guiCheckEvaluated = 0;
+    tkey_debug_level_check_print();
+    uiCount = tkey_debug_level_check_read(&uiLevels);
+    tkey_debug_level_check_result(pfnPrint, "kept levels logged",
+                                  (uiCount == 2) &&
+                                  (uiLevels == ((1u << THINKEY_DEBUG_LEVEL_ERROR) |
+                                                (1u << THINKEY_DEBUG_LEVEL_WARNING))),
+                                  &uiFailed);
+    tkey_debug_level_check_result(pfnPrint, "stripped args unused",
+                                  guiCheckEvaluated == 2, &uiFailed);
+
+    bPassed = TKey_TRUE;
+    for(uiIndex = 0; uiIndex < sizeof(gapcCheckKept) / sizeof(gapcCheckKept[0]); uiIndex++) {
+        bPassed = bPassed && tkey_debug_level_check_find(gapcCheckKept[uiIndex]);
+    }
+    tkey_debug_level_check_result(pfnPrint, "kept formats found", bPassed, &uiFailed);
+    bPassed = TKey_TRUE;
+    for(uiIndex = 0; uiIndex < sizeof(gapcCheckStripped) / sizeof(gapcCheckStripped[0]);
+        uiIndex++) {
+        bPassed = bPassed && !tkey_debug_level_check_find(gapcCheckStripped[uiIndex]);
+    }
+    tkey_debug_level_check_result(pfnPrint, "stripped formats gone", bPassed, &uiFailed);
+
+    /* Run time level */
+    bPassed = (E_THINKEY_SUCCESS == TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_RANGING,
+                                                        THINKEY_DEBUG_LEVEL_ERROR));
+    guiCheckEvaluated = 0;
+    tkey_debug_level_check_print();
+    uiCount = tkey_debug_level_check_read(&uiLevels);
+    bPassed = bPassed && (uiCount == 1) && (uiLevels == (1u << THINKEY_DEBUG_LEVEL_ERROR)) &&
+              (guiCheckEvaluated == 1) &&
+              (TKey_Debug_GetLevel(THINKEY_DEBUG_MODULE_APP) == THINKEY_DEBUG_LEVEL_DEBUG);
+    (void)TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_RANGING, THINKEY_DEBUG_LEVEL_NONE);
+    tkey_debug_level_check_print();
+    bPassed = bPassed && (0 == tkey_debug_level_check_read(&uiLevels));
+    tkey_debug_level_check_result(pfnPrint, "run time level", bPassed, &uiFailed);
+
+    bPassed = (E_THINKEY_FAILURE == TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_COUNT + 1,
+                                                        THINKEY_DEBUG_LEVEL_INFO)) &&
+              (E_THINKEY_FAILURE == TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_APP,
+                                                        THINKEY_DEBUG_LEVEL_DEBUG + 1)) &&
+              (E_THINKEY_SUCCESS == TKey_Debug_SetLevel(THINKEY_DEBUG_MODULE_COUNT,
+                                                        THINKEY_DEBUG_LEVEL_DEBUG));
+    for(uiIndex = 0; uiIndex < THINKEY_DEBUG_MODULE_COUNT; uiIndex++) {
+        bPassed = bPassed && (TKey_Debug_GetLevel(uiIndex) == THINKEY_DEBUG_LEVEL_DEBUG) &&
+                  (TKey_Debug_ModuleName(uiIndex) != TKey_NULL);
+    }
+    tkey_debug_level_check_result(pfnPrint, "set level", bPassed, &uiFailed);
+
+    return (TKey_INT32)uiFailed;
+}
+
+#if defined(THINKEY_DEBUG_LEVEL_CHECK_MAIN)
+static TKey_VOID tkey_debug_level_check_output(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    return (0 == TKey_DebugLevelCheck_Report(tkey_debug_level_check_output)) ? 0 : 1;
+}
+#endif /* THINKEY_DEBUG_LEVEL_CHECK_MAIN */
@@ -0,0 +1,457 @@
+/*
+ * \file thinkey_dlog.c
+ *
+ * \brief Deferred binary log
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_dlog.h"
+#include "thinkey_osal.h"
+#include "thinkey_rtt.h"
+#include <stdio.h>
+#include <string.h>
+
+#if (TKEY_DLOG_RING_WORDS & (TKEY_DLOG_RING_WORDS - 1)) != 0
+#error "TKEY_DLOG_RING_WORDS must be a power of two"
+#endif
+
+#define TKEY_DLOG_STACK_WORDS 512
+#define TKEY_DLOG_PRIORITY 1
+#define TKEY_DLOG_SPEC_SIZE 16
+
+/* The ring of one core. The head counts the words reserved by writers,
+ * the tail the words taken by the reader; both only grow. */
+typedef struct
+{
+    TKey_UINT32 uiHead;
+    TKey_UINT32 uiTail;
+    TKey_UINT32 uiWritten;
+    TKey_UINT32 uiDropped;
+    TKey_UINT32 auiWords[TKEY_DLOG_RING_WORDS];
+} TKey_DLogRing_t;
+
+static TKey_DLogRing_t gsDLogRing;
+
+/* Bounds of the tkey_dlog_fmt section, from the linker */
+extern const TKey_CHAR __start_tkey_dlog_fmt[] __attribute__((weak));
+extern const TKey_CHAR __stop_tkey_dlog_fmt[] __attribute__((weak));
+
+/* Drain */
+THINKEY_OSAL_TASK_STORAGE(debug, gsDLogTask, TKEY_DLOG_STACK_WORDS);
+static TKey_UINT32 gauiDLogRecord[TKEY_DLOG_RECORD_MAX_WORDS];
+static TKey_CHAR gacDLogLine[TKEY_DLOG_LINE_SIZE];
+static TKey_DLogWrite_t gpfnDLogWrite;
+static TKey_BOOL gbDLogText;
+static TKey_BOOL gbDLogStarted = TKey_FALSE;
+static volatile TKey_UINT32 guiSinkDropped;
+
+static const TKey_CHAR gacDLogLevels[] = "?EWID";
+
+/* Reserves uiWords words, returns TKey_FALSE when they do not fit */
+static TKey_BOOL tkey_dlog_reserve(TKey_DLogRing_t *psRing, TKey_UINT32 uiWords,
+                                   TKey_UINT32 *puiAt)
+{
+    TKey_UINT32 uiHead = __atomic_load_n(&psRing->uiHead, __ATOMIC_RELAXED);
+
+    do {
+        if((uiHead - __atomic_load_n(&psRing->uiTail, __ATOMIC_ACQUIRE) + uiWords) >
+           TKEY_DLOG_RING_WORDS) {
+            __atomic_fetch_add(&psRing->uiDropped, 1, __ATOMIC_RELAXED);
+            return TKey_FALSE;
+        }
+    } while(!__atomic_compare_exchange_n(&psRing->uiHead, &uiHead, uiHead + uiWords,
+                                         TKey_TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    *puiAt = uiHead;
+    return TKey_TRUE;
+}
+
+/* Writes the header last: the reader takes a record once it is nonzero */
+static TKey_VOID tkey_dlog_commit(TKey_DLogRing_t *psRing, TKey_UINT32 uiAt,
+                                  TKey_UINT32 uiHeader)
+{
+    __atomic_store_n(&psRing->auiWords[uiAt & (TKEY_DLOG_RING_WORDS - 1)], uiHeader,
+                     __ATOMIC_RELEASE);
+    __atomic_fetch_add(&psRing->uiWritten, 1, __ATOMIC_RELAXED);
+}
+
+static TKey_UINT32 tkey_dlog_id(const TKey_CHAR *pcFormat)
+{
+    return (TKey_UINT32)(pcFormat - __start_tkey_dlog_fmt);
+}
+
+TKey_VOID TKey_DLog_Write(TKey_UINT32 uiLevel, const TKey_CHAR *pcFormat,
+                          const TKey_UINT32 *puiArgs, TKey_UINT32 uiArgs)
+{
+    TKey_DLogRing_t *psRing = &gsDLogRing;
+    TKey_UINT32 uiWords;
+    TKey_UINT32 uiAt;
+    TKey_UINT32 i;
+
+    if(uiArgs > TKEY_DLOG_MAX_ARGS) {
+        uiArgs = TKEY_DLOG_MAX_ARGS;
+    }
+    uiWords = TKEY_DLOG_HEADER_WORDS + uiArgs;
+    if(!tkey_dlog_reserve(psRing, uiWords, &uiAt)) {
+        return;
+    }
+    psRing->auiWords[(uiAt + 1) & (TKEY_DLOG_RING_WORDS - 1)] = tkey_dlog_id(pcFormat);
+    psRing->auiWords[(uiAt + 2) & (TKEY_DLOG_RING_WORDS - 1)] =
+        THINKey_OSAL_uiRunTimeCounter();
+    for(i = 0; i < uiArgs; i++) {
+        psRing->auiWords[(uiAt + TKEY_DLOG_HEADER_WORDS + i) & (TKEY_DLOG_RING_WORDS - 1)] =
+            puiArgs[i];
+    }
+    tkey_dlog_commit(psRing, uiAt, (TKEY_DLOG_MAGIC << 24) | ((uiLevel & 0xFu) << 16) |
+                     (uiArgs << 8) | uiWords);
+}
+
+TKey_VOID TKey_DLog_WriteBuf(TKey_UINT32 uiLevel, const TKey_CHAR *pcFormat,
+                             const TKey_VOID *pvData, TKey_UINT32 uiLength)
+{
+    TKey_DLogRing_t *psRing = &gsDLogRing;
+    const TKey_BYTE *pbData = (const TKey_BYTE *)pvData;
+    TKey_UINT32 uiKept = (uiLength > TKEY_DLOG_MAX_BUF) ? TKEY_DLOG_MAX_BUF : uiLength;
+    TKey_UINT32 uiWord;
+    TKey_UINT32 uiWords;
+    TKey_UINT32 uiAt;
+    TKey_UINT32 i;
+
+    if(pbData == TKey_NULL) {
+        uiKept = 0;
+    }
+    uiWords = TKEY_DLOG_HEADER_WORDS + 1 + (uiKept + 3) / 4;
+    if(!tkey_dlog_reserve(psRing, uiWords, &uiAt)) {
+        return;
+    }
+    psRing->auiWords[(uiAt + 1) & (TKEY_DLOG_RING_WORDS - 1)] = tkey_dlog_id(pcFormat);
+    psRing->auiWords[(uiAt + 2) & (TKEY_DLOG_RING_WORDS - 1)] =
+        THINKey_OSAL_uiRunTimeCounter();
+    psRing->auiWords[(uiAt + 3) & (TKEY_DLOG_RING_WORDS - 1)] = uiLength;
+    for(i = 0; i < uiKept; i += 4) {
+        uiWord = pbData[i];
+        if(i + 1 < uiKept) {
+            uiWord |= (TKey_UINT32)pbData[i + 1] << 8;
+        }
+        if(i + 2 < uiKept) {
+            uiWord |= (TKey_UINT32)pbData[i + 2] << 16;
+        }
+        if(i + 3 < uiKept) {
+            uiWord |= (TKey_UINT32)pbData[i + 3] << 24;
+        }
+        psRing->auiWords[(uiAt + 4 + i / 4) & (TKEY_DLOG_RING_WORDS - 1)] = uiWord;
+    }
+    tkey_dlog_commit(psRing, uiAt, (TKEY_DLOG_MAGIC << 24) | TKEY_DLOG_FLAG_BUF |
+                     ((uiLevel & 0xFu) << 16) | uiWords);
+}
+
+TKey_UINT32 TKey_DLog_Read(TKey_UINT32 *puiRecord)
+{
+    TKey_DLogRing_t *psRing = &gsDLogRing;
+    TKey_UINT32 uiTail = psRing->uiTail;
+    TKey_UINT32 uiHeader;
+    TKey_UINT32 uiWords;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 i;
+
+    if(puiRecord == TKey_NULL) {
+        return 0;
+    }
+    uiHeader = __atomic_load_n(&psRing->auiWords[uiTail & (TKEY_DLOG_RING_WORDS - 1)],
+                               __ATOMIC_ACQUIRE);
+    if(uiHeader == 0) {
+        return 0;
+    }
+    uiWords = TKEY_DLOG_WORDS(uiHeader);
+
+    /* Words are zeroed as taken, so that only a committed header reads as
+     * nonzero when a later record starts there */
+    for(i = 0; i < uiWords; i++) {
+        uiIndex = (uiTail + i) & (TKEY_DLOG_RING_WORDS - 1);
+        if(i < TKEY_DLOG_RECORD_MAX_WORDS) {
+            puiRecord[i] = psRing->auiWords[uiIndex];
+        }
+        psRing->auiWords[uiIndex] = 0;
+    }
+    __atomic_store_n(&psRing->uiTail, uiTail + uiWords, __ATOMIC_RELEASE);
+
+    return (uiWords > TKEY_DLOG_RECORD_MAX_WORDS) ? TKEY_DLOG_RECORD_MAX_WORDS : uiWords;
+}
+
+const TKey_CHAR* TKey_DLog_GetFormat(TKey_UINT32 uiId)
+{
+    if((__start_tkey_dlog_fmt == TKey_NULL) ||
+       (uiId >= (TKey_UINT32)(__stop_tkey_dlog_fmt - __start_tkey_dlog_fmt))) {
+        return TKey_NULL;
+    }
+    return __start_tkey_dlog_fmt + uiId;
+}
+
+/* Formats one conversion of pcSpec, a '%' up to its conversion character,
+ * with a 32-bit argument */
+static TKey_INT32 tkey_dlog_convert(TKey_CHAR *pcOut, TKey_UINT32 uiMax,
+                                    const TKey_CHAR *pcSpec, TKey_UINT32 uiSpec,
+                                    TKey_UINT32 uiArg)
+{
+    TKey_CHAR acSpec[TKEY_DLOG_SPEC_SIZE];
+    TKey_CHAR cConversion = pcSpec[uiSpec - 1];
+    TKey_UINT32 uiLength = 0;
+    TKey_UINT32 i;
+
+    /* The arguments are words: drop the length modifiers */
+    for(i = 0; (i < uiSpec - 1) && (uiLength < sizeof(acSpec) - 2); i++) {
+        if(NULL == strchr("hljztL", pcSpec[i])) {
+            acSpec[uiLength++] = pcSpec[i];
+        }
+    }
+    acSpec[uiLength++] = cConversion;
+    acSpec[uiLength] = '\0';
+
+    switch(cConversion) {
+    case 'd':
+    case 'i':
+    case 'c':
+        return snprintf(pcOut, uiMax, acSpec, (int)uiArg);
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        return snprintf(pcOut, uiMax, acSpec, (unsigned int)uiArg);
+    case 's':
+#if defined(THINKEY_HOST_BUILD)
+        /* Host pointers do not fit the word */
+        return snprintf(pcOut, uiMax, "<0x%08x>", (unsigned int)uiArg);
+#else
+        return snprintf(pcOut, uiMax, acSpec, (const char *)(uintptr_t)uiArg);
+#endif
+    case 'p':
+        return snprintf(pcOut, uiMax, "0x%08x", (unsigned int)uiArg);
+    default:
+        return snprintf(pcOut, uiMax, "%.*s", (int)uiSpec, pcSpec);
+    }
+}
+
+/* Formats pcFormat with the words of puiArgs */
+static TKey_UINT32 tkey_dlog_format_args(TKey_CHAR *pcOut, TKey_UINT32 uiMax,
+                                         const TKey_CHAR *pcFormat,
+                                         const TKey_UINT32 *puiArgs, TKey_UINT32 uiArgs)
+{
+    TKey_UINT32 uiUsed = 0;
+    TKey_UINT32 uiArg = 0;
+    TKey_UINT32 uiSpec;
+    TKey_INT32 iLength;
+
+    while((*pcFormat != '\0') && (uiUsed + 1 < uiMax)) {
+        if(*pcFormat != '%') {
+            pcOut[uiUsed++] = *pcFormat++;
+            continue;
+        }
+        if(pcFormat[1] == '%') {
+            pcOut[uiUsed++] = '%';
+            pcFormat += 2;
+            continue;
+        }
+        uiSpec = 1;
+        while((pcFormat[uiSpec] != '\0') &&
+              (NULL == strchr("diucxXopsfeEgGaAn", pcFormat[uiSpec]))) {
+            uiSpec++;
+        }
+        if(pcFormat[uiSpec] == '\0') {
+            break;
+        }
+        uiSpec++;
+        iLength = tkey_dlog_convert(&pcOut[uiUsed], uiMax - uiUsed, pcFormat, uiSpec,
+                                    (uiArg < uiArgs) ? puiArgs[uiArg] : 0);
+        uiArg++;
+        if(iLength > 0) {
+            uiUsed += ((TKey_UINT32)iLength < uiMax - uiUsed) ?
+                      (TKey_UINT32)iLength : (uiMax - uiUsed - 1);
+        }
+        pcFormat += uiSpec;
+    }
+    pcOut[uiUsed] = '\0';
+
+    return uiUsed;
+}
+
+TKey_UINT32 TKey_DLog_Format(const TKey_UINT32 *puiRecord, TKey_CHAR *pcOut,
+                             TKey_UINT32 uiMax)
+{
+    const TKey_CHAR *pcFormat;
+    const TKey_BYTE *pbData;
+    TKey_UINT32 uiHeader;
+    TKey_UINT32 uiLevel;
+    TKey_UINT32 uiHz = THINKey_OSAL_uiRunTimeCounterHz();
+    TKey_UINT64 ullUs;
+    TKey_UINT32 uiKept;
+    TKey_UINT32 uiUsed;
+    TKey_UINT32 i;
+    TKey_INT32 iLength;
+
+    if((puiRecord == TKey_NULL) || (pcOut == TKey_NULL) || (uiMax < 8)) {
+        return 0;
+    }
+    uiHeader = puiRecord[0];
+    uiLevel = TKEY_DLOG_LEVEL(uiHeader);
+    ullUs = (uiHz == 0) ? puiRecord[2] : ((TKey_UINT64)puiRecord[2] * 1000000u) / uiHz;
+
+    /* Two bytes are kept for the line end */
+    uiMax -= 2;
+    iLength = snprintf(pcOut, uiMax, "%c %lu.%06lu ",
+                       gacDLogLevels[(uiLevel < sizeof(gacDLogLevels) - 1) ? uiLevel : 0],
+                       (unsigned long)(ullUs / 1000000u), (unsigned long)(ullUs % 1000000u));
+    uiUsed = (iLength > 0) ? (TKey_UINT32)iLength : 0;
+    if(uiUsed >= uiMax) {
+        uiUsed = uiMax - 1;
+    }
+
+    pcFormat = TKey_DLog_GetFormat(puiRecord[1]);
+    if(pcFormat == TKey_NULL) {
+        iLength = snprintf(&pcOut[uiUsed], uiMax - uiUsed, "<format 0x%lx>",
+                           (unsigned long)puiRecord[1]);
+        uiUsed += (iLength > 0) ? (TKey_UINT32)iLength : 0;
+    } else if(0 != (uiHeader & TKEY_DLOG_FLAG_BUF)) {
+        uiUsed += tkey_dlog_format_args(&pcOut[uiUsed], uiMax - uiUsed, pcFormat,
+                                        TKey_NULL, 0);
+        pbData = (const TKey_BYTE *)&puiRecord[TKEY_DLOG_HEADER_WORDS + 1];
+        uiKept = (TKEY_DLOG_WORDS(uiHeader) - TKEY_DLOG_HEADER_WORDS - 1) * 4;
+        if(uiKept > puiRecord[TKEY_DLOG_HEADER_WORDS]) {
+            uiKept = puiRecord[TKEY_DLOG_HEADER_WORDS];
+        }
+        iLength = snprintf(&pcOut[uiUsed], uiMax - uiUsed, " [%lu]",
+                           (unsigned long)puiRecord[TKEY_DLOG_HEADER_WORDS]);
+        uiUsed += (iLength > 0) ? (TKey_UINT32)iLength : 0;
+        for(i = 0; (i < uiKept) && (uiUsed + 3 < uiMax); i++) {
+            uiUsed += (TKey_UINT32)snprintf(&pcOut[uiUsed], uiMax - uiUsed, " %02x",
+                                            pbData[i]);
+        }
+    } else {
+        uiUsed += tkey_dlog_format_args(&pcOut[uiUsed], uiMax - uiUsed, pcFormat,
+                                        &puiRecord[TKEY_DLOG_HEADER_WORDS],
+                                        TKEY_DLOG_ARG_COUNT(uiHeader));
+    }
+    if(uiUsed >= uiMax) {
+        uiUsed = uiMax - 1;
+    }
+
+    /* The formats of the debug macros may end in their own line break */
+    while((uiUsed > 0) && ((pcOut[uiUsed - 1] == '\n') || (pcOut[uiUsed - 1] == '\r'))) {
+        uiUsed--;
+    }
+    pcOut[uiUsed++] = '\r';
+    pcOut[uiUsed++] = '\n';
+    pcOut[uiUsed] = '\0';
+
+    return uiUsed;
+}
+
+TKey_VOID TKey_DLog_GetCounts(TKey_DLogCounts_t *psCounts)
+{
+    if(psCounts == TKey_NULL) {
+        return;
+    }
+    psCounts->uiWritten = __atomic_load_n(&gsDLogRing.uiWritten, __ATOMIC_RELAXED);
+    psCounts->uiDropped = __atomic_load_n(&gsDLogRing.uiDropped, __ATOMIC_RELAXED);
+    psCounts->uiSinkDropped = guiSinkDropped;
+}
+
+/* Drain */
+
+static TKey_UINT32 tkey_dlog_rtt_write(const TKey_BYTE *pbData, TKey_UINT32 uiLength)
+{
+    return TKey_Rtt_Write(TKEY_RTT_CHANNEL_LOG, pbData, uiLength);
+}
+
+static TKey_UINT32 tkey_dlog_rtt_print(const TKey_BYTE *pbData, TKey_UINT32 uiLength)
+{
+    return TKey_Rtt_Write(TKEY_RTT_CHANNEL_TERMINAL, pbData, uiLength);
+}
+
+static TKey_VOID tkey_dlog_send(const TKey_BYTE *pbData, TKey_UINT32 uiLength)
+{
+    if(gpfnDLogWrite(pbData, uiLength) != uiLength) {
+        guiSinkDropped++;
+    }
+}
+
+/* Sends the counter rate and the drop counts */
+static TKey_VOID tkey_dlog_send_info(const TKey_DLogCounts_t *psCounts)
+{
+    TKey_UINT32 auiInfo[TKEY_DLOG_HEADER_WORDS + 3];
+    TKey_INT32 iLength;
+
+    if(gbDLogText) {
+        iLength = snprintf(gacDLogLine, sizeof(gacDLogLine),
+                           "dlog: %lu dropped, %lu lost by the sink\r\n",
+                           (unsigned long)psCounts->uiDropped,
+                           (unsigned long)psCounts->uiSinkDropped);
+        if(iLength > 0) {
+            tkey_dlog_send((const TKey_BYTE *)gacDLogLine, (TKey_UINT32)iLength);
+        }
+        return;
+    }
+    auiInfo[0] = (TKEY_DLOG_MAGIC << 24) | (3u << 8) | (TKEY_DLOG_HEADER_WORDS + 3);
+    auiInfo[1] = TKEY_DLOG_ID_INFO;
+    auiInfo[2] = THINKey_OSAL_uiRunTimeCounter();
+    auiInfo[3] = THINKey_OSAL_uiRunTimeCounterHz();
+    auiInfo[4] = psCounts->uiDropped;
+    auiInfo[5] = psCounts->uiSinkDropped;
+    tkey_dlog_send((const TKey_BYTE *)auiInfo, sizeof(auiInfo));
+}
+
+static TKey_VOID tkey_dlog_task(TKey_VOID *pvParams)
+{
+    TKey_DLogCounts_t sCounts;
+    TKey_UINT32 uiDropped = 0;
+    TKey_UINT32 uiSinkDropped = 0;
+    TKey_UINT32 uiWords;
+    TKey_UINT32 uiLength;
+    TKey_BOOL bInfo = !gbDLogText;
+    (void)pvParams;
+
+    for(;;) {
+        TKey_DLog_GetCounts(&sCounts);
+        if(bInfo || (sCounts.uiDropped != uiDropped) ||
+           (sCounts.uiSinkDropped != uiSinkDropped)) {
+            tkey_dlog_send_info(&sCounts);
+            TKey_DLog_GetCounts(&sCounts);
+            uiDropped = sCounts.uiDropped;
+            uiSinkDropped = sCounts.uiSinkDropped;
+            bInfo = TKey_FALSE;
+        }
+
+        while(0 != (uiWords = TKey_DLog_Read(gauiDLogRecord))) {
+            if(gbDLogText) {
+                uiLength = TKey_DLog_Format(gauiDLogRecord, gacDLogLine,
+                                            sizeof(gacDLogLine));
+                tkey_dlog_send((const TKey_BYTE *)gacDLogLine, uiLength);
+            } else {
+                tkey_dlog_send((const TKey_BYTE *)gauiDLogRecord, uiWords * 4);
+            }
+        }
+
+        THINKey_OSAL_Delay(TKEY_DLOG_DRAIN_MS);
+    }
+}
+
+THINKey_eStatusType TKey_DLog_Start(TKey_DLogWrite_t pfnWrite, TKey_BOOL bText)
+{
+    if(gbDLogStarted) {
+        return E_THINKEY_FAILURE;
+    }
+
+    if(pfnWrite == TKey_NULL) {
+        pfnWrite = bText ? tkey_dlog_rtt_print : tkey_dlog_rtt_write;
+    }
+    gpfnDLogWrite = pfnWrite;
+    gbDLogText = bText;
+
+    if(E_THINKEY_SUCCESS != THINKEY_OSAL_CREATE_STATIC_TASK(gsDLogTask,
+            "DLog", tkey_dlog_task, TKey_NULL, TKEY_DLOG_PRIORITY, TKey_NULL)) {
+        return E_THINKEY_FAILURE;
+    }
+    gbDLogStarted = TKey_TRUE;
+
+    return E_THINKEY_SUCCESS;
+}
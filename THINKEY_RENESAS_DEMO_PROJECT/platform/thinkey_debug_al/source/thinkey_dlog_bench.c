@@ -0,0 +1,468 @@
+/*
+ * \file thinkey_dlog_bench.c
+ *
+ * \brief Deferred log micro-benchmark
+ *
+ * On the target call TKey_DLogBench_Report() from a task with the drain
+ * not started; on a Linux host build with THINKEY_HOST_BUILD and
+ * THINKEY_DLOG_BENCH_MAIN, linked with the host OSAL, to get a standalone
+ * program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_dlog_bench.h"
+#include "thinkey_dlog.h"
+#include "thinkey_osal.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(THINKEY_HOST_BUILD)
+#include <stdlib.h>
+#include "thinkey_osal_posix.h"
+#define TKEY_DLOG_BENCH_MALLOC malloc
+#define TKEY_DLOG_BENCH_FREE free
+#else
+#include "FreeRTOS.h"
+#define TKEY_DLOG_BENCH_MALLOC pvPortMalloc
+#define TKEY_DLOG_BENCH_FREE vPortFree
+#endif
+
+/* As in uart_debug.c */
+#define TKEY_DLOG_BENCH_LEGACY_DEPTH 16
+#define TKEY_DLOG_BENCH_LEGACY_LEN 100
+
+#define TKEY_DLOG_BENCH_BUF_BYTES 32
+#define TKEY_DLOG_BENCH_WRITERS 3
+#define TKEY_DLOG_BENCH_ISR_WRITER TKEY_DLOG_BENCH_WRITERS
+#define TKEY_DLOG_BENCH_ISR_EVERY 8
+#define TKEY_DLOG_BENCH_STACK 512
+#define TKEY_DLOG_BENCH_PRIORITY 2
+
+typedef enum
+{
+    E_TKEY_DLOG_BENCH_LEGACY = 0,
+    E_TKEY_DLOG_BENCH_VSNPRINTF,
+    E_TKEY_DLOG_BENCH_DLOG0,
+    E_TKEY_DLOG_BENCH_DLOG3,
+    E_TKEY_DLOG_BENCH_DLOG_BUF,
+    E_TKEY_DLOG_BENCH_FORMAT
+} TKey_DLogBenchCase_t;
+
+static const TKey_CHAR *const gapcDLogBenchNames[] = {
+    "legacy_malloc_queue_3arg",
+    "vsnprintf_3arg",
+    "dlog_0arg",
+    "dlog_3arg",
+    "dlog_buf32",
+    "dlog_read_format_3arg",
+};
+
+typedef struct
+{
+    const TKey_CHAR *pcString;
+    TKey_UINT32 uiType;
+} TKey_DLogBenchLegacyMsg_t;
+
+static THINKey_HANDLE ghLegacyQueue;
+static TKey_CHAR gacBenchLine[TKEY_DLOG_LINE_SIZE];
+static TKey_UINT32 gauiBenchRecord[TKEY_DLOG_RECORD_MAX_WORDS];
+static TKey_BYTE gabBenchBuf[TKEY_DLOG_BENCH_BUF_BYTES];
+static volatile TKey_UINT32 guiBenchSink;
+
+/* task_debug_printf() of uart_debug.c, on the OSAL */
+static __attribute__((noinline))
+TKey_VOID tkey_dlog_bench_legacy(TKey_UINT32 uiType, const TKey_CHAR *pcFormat, ...)
+{
+    TKey_DLogBenchLegacyMsg_t sMessage;
+    TKey_CHAR *pcBuffer;
+    TKey_UINT32 uiLength = 0;
+    va_list args;
+
+    pcBuffer = TKEY_DLOG_BENCH_MALLOC(TKEY_DLOG_BENCH_LEGACY_LEN);
+    if(pcBuffer == TKey_NULL) {
+        return;
+    }
+    va_start(args, pcFormat);
+    uiLength = (TKey_UINT32)snprintf(pcBuffer, TKEY_DLOG_BENCH_LEGACY_LEN, "%-16s : ",
+                                     "DLog bench");
+    vsnprintf(pcBuffer + uiLength, TKEY_DLOG_BENCH_LEGACY_LEN - uiLength, pcFormat, args);
+    va_end(args);
+
+    sMessage.pcString = pcBuffer;
+    sMessage.uiType = uiType;
+    if(E_THINKEY_SUCCESS != THINKey_OSAL_eQueueSendTimed(ghLegacyQueue, &sMessage,
+                                THINKEY_OSAL_ZERO, E_THINKEY_OSAL_QUEUE_BACK)) {
+        TKEY_DLOG_BENCH_FREE(pcBuffer);
+    }
+}
+
+static __attribute__((noinline))
+TKey_VOID tkey_dlog_bench_vsnprintf(const TKey_CHAR *pcFormat, ...)
+{
+    va_list args;
+
+    va_start(args, pcFormat);
+    vsnprintf(gacBenchLine, sizeof(gacBenchLine), pcFormat, args);
+    va_end(args);
+}
+
+/* What the debug task did with each message */
+static TKey_UINT32 tkey_dlog_bench_legacy_drain(TKey_VOID)
+{
+    TKey_DLogBenchLegacyMsg_t sMessage;
+    TKey_UINT32 uiCount = 0;
+
+    while(E_THINKEY_SUCCESS == THINKey_OSAL_eTimedQueueReceive(ghLegacyQueue,
+                                   &sMessage, THINKEY_OSAL_ZERO)) {
+        guiBenchSink += (TKey_UINT32)sMessage.pcString[0];
+        TKEY_DLOG_BENCH_FREE((TKey_VOID *)sMessage.pcString);
+        uiCount++;
+    }
+    return uiCount;
+}
+
+static TKey_VOID tkey_dlog_bench_call(TKey_DLogBenchCase_t eCase, TKey_UINT32 uiCall)
+{
+    switch(eCase) {
+    case E_TKEY_DLOG_BENCH_LEGACY:
+        tkey_dlog_bench_legacy(1, "bench %u %u %x", uiCall, uiCall * 3, 0xA5A5u);
+        break;
+    case E_TKEY_DLOG_BENCH_VSNPRINTF:
+        tkey_dlog_bench_vsnprintf("bench %u %u %x", uiCall, uiCall * 3, 0xA5A5u);
+        break;
+    case E_TKEY_DLOG_BENCH_DLOG0:
+        TKEY_DLOG(TKEY_DLOG_LEVEL_INFO, "bench");
+        break;
+    case E_TKEY_DLOG_BENCH_DLOG3:
+    case E_TKEY_DLOG_BENCH_FORMAT:
+        TKEY_DLOG(TKEY_DLOG_LEVEL_INFO, "bench %u %u %x", uiCall, uiCall * 3, 0xA5A5u);
+        break;
+    case E_TKEY_DLOG_BENCH_DLOG_BUF:
+        gabBenchBuf[0] = (TKey_BYTE)uiCall;
+        TKEY_DLOG_BUF(TKEY_DLOG_LEVEL_DEBUG, "bench buf", gabBenchBuf, sizeof(gabBenchBuf));
+        break;
+    }
+}
+
+/* Reads back the records of one batch and checks them */
+static TKey_INT32 tkey_dlog_bench_check(TKey_DLogBenchCase_t eCase)
+{
+    TKey_CHAR acExpected[48];
+    const TKey_CHAR *pcText;
+    TKey_UINT32 uiHeader;
+    TKey_UINT32 uiCall;
+    TKey_INT32 iStatus = 0;
+
+    if(eCase == E_TKEY_DLOG_BENCH_LEGACY) {
+        return (TKEY_DLOG_BENCH_BATCH == tkey_dlog_bench_legacy_drain()) ? 0 : 1;
+    }
+    if(eCase == E_TKEY_DLOG_BENCH_VSNPRINTF) {
+        return (0 == strcmp(gacBenchLine, "bench 7 21 a5a5")) ? 0 : 1;
+    }
+
+    for(uiCall = 0; uiCall < TKEY_DLOG_BENCH_BATCH; uiCall++) {
+        if(0 == TKey_DLog_Read(gauiBenchRecord)) {
+            return 1;
+        }
+        uiHeader = gauiBenchRecord[0];
+        switch(eCase) {
+        case E_TKEY_DLOG_BENCH_DLOG0:
+            iStatus |= (TKEY_DLOG_ARG_COUNT(uiHeader) != 0);
+            break;
+        case E_TKEY_DLOG_BENCH_DLOG3:
+            iStatus |= (TKEY_DLOG_ARG_COUNT(uiHeader) != 3) ||
+                       (gauiBenchRecord[3] != uiCall) || (gauiBenchRecord[4] != uiCall * 3) ||
+                       (gauiBenchRecord[5] != 0xA5A5u);
+            break;
+        case E_TKEY_DLOG_BENCH_DLOG_BUF:
+            iStatus |= (0 == (uiHeader & TKEY_DLOG_FLAG_BUF)) ||
+                       (gauiBenchRecord[3] != TKEY_DLOG_BENCH_BUF_BYTES) ||
+                       ((gauiBenchRecord[4] & 0xFF) != uiCall);
+            break;
+        default:
+            break;
+        }
+        /* The text after the level and the time */
+        (void)TKey_DLog_Format(gauiBenchRecord, gacBenchLine, sizeof(gacBenchLine));
+        pcText = strchr(&gacBenchLine[2], ' ');
+        if((eCase == E_TKEY_DLOG_BENCH_DLOG3) && (pcText != TKey_NULL)) {
+            snprintf(acExpected, sizeof(acExpected), " bench %u %u a5a5\r\n",
+                     (unsigned int)uiCall, (unsigned int)(uiCall * 3));
+            iStatus |= (0 != strcmp(pcText, acExpected));
+        }
+        iStatus |= (pcText == TKey_NULL) || (gacBenchLine[0] != "?EWID"[TKEY_DLOG_LEVEL(uiHeader)]);
+    }
+    return iStatus | (0 != TKey_DLog_Read(gauiBenchRecord));
+}
+
+#if defined(THINKEY_HOST_BUILD)
+typedef struct
+{
+    THINKey_HANDLE ahStart[TKEY_DLOG_BENCH_WRITERS];
+    TKey_UINT32 uiFinished;
+    TKey_BOOL bStarted;
+} TKey_DLogBenchConcurrent_t;
+
+static TKey_DLogBenchConcurrent_t gsConcurrent;
+static TKey_UINT32 gauiIsrSeq;
+
+static TKey_VOID tkey_dlog_bench_isr(TKey_VOID *pvArg)
+{
+    (void)pvArg;
+    TKEY_DLOG(TKEY_DLOG_LEVEL_INFO, "writer %u seq %u", TKEY_DLOG_BENCH_ISR_WRITER,
+              gauiIsrSeq++);
+}
+
+static TKey_VOID tkey_dlog_bench_writer(TKey_VOID *pvParams)
+{
+    TKey_UINT32 uiWriter = (TKey_UINT32)(uintptr_t)pvParams;
+    TKey_UINT32 uiStart;
+    TKey_UINT32 uiSeq;
+
+    for(;;) {
+        (void)THINKey_OSAL_eQueueReceive(gsConcurrent.ahStart[uiWriter], &uiStart);
+        for(uiSeq = 0; uiSeq < TKEY_DLOG_BENCH_CONCURRENT_RECORDS; uiSeq++) {
+            TKEY_DLOG(TKEY_DLOG_LEVEL_INFO, "writer %u seq %u", uiWriter, uiSeq);
+            if((uiWriter == 0) && ((uiSeq % TKEY_DLOG_BENCH_ISR_EVERY) == 0)) {
+                TKey_OsalPosix_RunIsr(tkey_dlog_bench_isr, TKey_NULL);
+            }
+            /* In bursts, so that the reader keeps up with most of them */
+            if((uiSeq % TKEY_DLOG_BENCH_BATCH) == (TKEY_DLOG_BENCH_BATCH - 1)) {
+                THINKey_OSAL_Delay(0);
+            }
+        }
+        __atomic_fetch_add(&gsConcurrent.uiFinished, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* Reads while the writers log; returns the failures and the records read */
+static TKey_INT32 tkey_dlog_bench_concurrent(TKey_UINT32 *puiRead)
+{
+    TKey_UINT32 auiNext[TKEY_DLOG_BENCH_WRITERS + 1] = { 0 };
+    TKey_DLogCounts_t sBefore;
+    TKey_DLogCounts_t sAfter;
+    const TKey_CHAR *pcFormat;
+    TKey_UINT32 uiAttempts;
+    TKey_UINT32 uiWriter;
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiRead = 0;
+    TKey_BOOL bDone = TKey_FALSE;
+    TKey_INT32 iStatus = 0;
+
+    if(!gsConcurrent.bStarted) {
+        for(uiWriter = 0; uiWriter < TKEY_DLOG_BENCH_WRITERS; uiWriter++) {
+            gsConcurrent.ahStart[uiWriter] = THINKey_OSAL_hCreateQueue(1, sizeof(TKey_UINT32));
+            if((gsConcurrent.ahStart[uiWriter] == THINKey_NULL) ||
+               (E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("DLog writer",
+                    tkey_dlog_bench_writer, (TKey_VOID *)(uintptr_t)uiWriter,
+                    TKEY_DLOG_BENCH_PRIORITY, TKEY_DLOG_BENCH_STACK, TKey_NULL))) {
+                return 1;
+            }
+        }
+        gsConcurrent.bStarted = TKey_TRUE;
+    }
+
+    TKey_DLog_GetCounts(&sBefore);
+    gauiIsrSeq = 0;
+    __atomic_store_n(&gsConcurrent.uiFinished, 0, __ATOMIC_RELAXED);
+    for(uiWriter = 0; uiWriter < TKEY_DLOG_BENCH_WRITERS; uiWriter++) {
+        (void)THINKey_OSAL_eQueueSend(gsConcurrent.ahStart[uiWriter], &uiWriter);
+    }
+
+    /* Reads flat out, the writers run in parallel on the host */
+    while(!bDone) {
+        /* Seen finished before the last read, so nothing is left after it */
+        bDone = (TKEY_DLOG_BENCH_WRITERS ==
+                 __atomic_load_n(&gsConcurrent.uiFinished, __ATOMIC_ACQUIRE));
+        while(0 != TKey_DLog_Read(gauiBenchRecord)) {
+            uiRead++;
+            uiWriter = gauiBenchRecord[3];
+            uiSeq = gauiBenchRecord[4];
+            pcFormat = TKey_DLog_GetFormat(gauiBenchRecord[1]);
+            if((TKEY_DLOG_WORDS(gauiBenchRecord[0]) != TKEY_DLOG_HEADER_WORDS + 2) ||
+               (TKEY_DLOG_ARG_COUNT(gauiBenchRecord[0]) != 2) ||
+               (pcFormat == TKey_NULL) || (0 != strcmp(pcFormat, "writer %u seq %u")) ||
+               (uiWriter > TKEY_DLOG_BENCH_ISR_WRITER) ||
+               (uiSeq < auiNext[uiWriter])) {
+                iStatus |= 2;
+                continue;
+            }
+            auiNext[uiWriter] = uiSeq + 1;
+        }
+    }
+
+    TKey_DLog_GetCounts(&sAfter);
+    uiAttempts = TKEY_DLOG_BENCH_WRITERS * TKEY_DLOG_BENCH_CONCURRENT_RECORDS + gauiIsrSeq;
+    if(((sAfter.uiWritten - sBefore.uiWritten) != uiRead) ||
+       ((sAfter.uiWritten - sBefore.uiWritten) + (sAfter.uiDropped - sBefore.uiDropped) !=
+        uiAttempts)) {
+        iStatus |= 4;
+    }
+    *puiRead = uiRead;
+
+    return iStatus;
+}
+#endif /* THINKEY_HOST_BUILD */
+
+TKey_UINT32 TKey_DLogBench_Run(TKey_BenchResult_t *psResults,
+                               TKey_UINT32 uiMaxResults,
+                               TKey_UINT32 uiIterations)
+{
+    TKey_BenchResult_t *psRes;
+    TKey_UINT64 ullStart;
+    TKey_UINT32 uiCount = 0;
+    TKey_UINT32 uiCase;
+    TKey_UINT32 uiIter;
+    TKey_UINT32 uiCall;
+    TKey_INT32 iStatus;
+
+    if(0 == uiIterations) {
+        uiIterations = TKEY_DLOG_BENCH_ITERATIONS;
+    }
+    TKey_Bench_TimerInit();
+    if(ghLegacyQueue == THINKey_NULL) {
+        ghLegacyQueue = THINKey_OSAL_hCreateQueue(TKEY_DLOG_BENCH_LEGACY_DEPTH,
+                                                  sizeof(TKey_DLogBenchLegacyMsg_t));
+    }
+    while(0 != TKey_DLog_Read(gauiBenchRecord)) {
+    }
+
+    for(uiCase = E_TKEY_DLOG_BENCH_LEGACY; uiCase <= E_TKEY_DLOG_BENCH_FORMAT; uiCase++) {
+        if(uiCount >= uiMaxResults) {
+            return uiCount;
+        }
+        psRes = &psResults[uiCount++];
+        memset(psRes, 0, sizeof(TKey_BenchResult_t));
+        psRes->pcSuite = "dlog";
+        psRes->pcName = gapcDLogBenchNames[uiCase];
+        iStatus = (ghLegacyQueue == THINKey_NULL) ? 1 : 0;
+
+        for(uiIter = 0; (uiIter < uiIterations) && (0 == iStatus); uiIter++) {
+            if(uiCase == E_TKEY_DLOG_BENCH_FORMAT) {
+                /* The drain side: log outside the timing, read and format */
+                for(uiCall = 0; uiCall < TKEY_DLOG_BENCH_BATCH; uiCall++) {
+                    tkey_dlog_bench_call((TKey_DLogBenchCase_t)uiCase, uiCall);
+                }
+                ullStart = TKey_Bench_Now();
+                for(uiCall = 0; uiCall < TKEY_DLOG_BENCH_BATCH; uiCall++) {
+                    iStatus |= (0 == TKey_DLog_Read(gauiBenchRecord));
+                    guiBenchSink += TKey_DLog_Format(gauiBenchRecord, gacBenchLine,
+                                                     sizeof(gacBenchLine));
+                }
+                TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+                continue;
+            }
+            ullStart = TKey_Bench_Now();
+            for(uiCall = 0; uiCall < TKEY_DLOG_BENCH_BATCH; uiCall++) {
+                tkey_dlog_bench_call((TKey_DLogBenchCase_t)uiCase, uiCall);
+            }
+            TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+            iStatus |= tkey_dlog_bench_check((TKey_DLogBenchCase_t)uiCase);
+        }
+        psRes->iStatus = iStatus;
+    }
+
+#if defined(THINKEY_HOST_BUILD)
+    if(uiCount < uiMaxResults) {
+        psRes = &psResults[uiCount++];
+        memset(psRes, 0, sizeof(TKey_BenchResult_t));
+        psRes->pcSuite = "dlog";
+        psRes->pcName = "dlog_concurrent_3task_isr";
+        ullStart = TKey_Bench_Now();
+        psRes->iStatus = tkey_dlog_bench_concurrent(&uiCall);
+        TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+        /* Per record read */
+        if(0 != uiCall) {
+            psRes->uiIterations = uiCall;
+            psRes->ullMinTicks = psRes->ullTotalTicks / uiCall;
+        }
+    }
+#endif
+    return uiCount;
+}
+
+TKey_INT32 TKey_DLogBench_Report(TKey_BenchPrint_t pfnPrint,
+                                 TKey_UINT32 uiIterations)
+{
+    static TKey_BenchResult_t sasResults[TKEY_DLOG_BENCH_MAX_RESULTS];
+    TKey_DLogCounts_t sCounts;
+    TKey_CHAR acLine[TKEY_BENCH_LINE_SIZE];
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_INT32 iFailed = 0;
+
+    uiCount = TKey_DLogBench_Run(sasResults, TKEY_DLOG_BENCH_MAX_RESULTS, uiIterations);
+    TKey_Bench_PrintHeader(pfnPrint);
+    TKey_Bench_PrintResults(pfnPrint, sasResults, uiCount);
+    for(uiIndex = 0; uiIndex < uiCount; uiIndex++) {
+        if(0 != sasResults[uiIndex].iStatus) {
+            iFailed++;
+        }
+    }
+    TKey_DLog_GetCounts(&sCounts);
+    snprintf(acLine, sizeof(acLine), "%s,dlog,written %lu,dropped %lu\r\n",
+             TKEY_BENCH_LINE_TAG, (unsigned long)sCounts.uiWritten,
+             (unsigned long)sCounts.uiDropped);
+    pfnPrint(acLine);
+    return iFailed;
+}
+
+#if defined(THINKEY_DLOG_BENCH_MAIN)
+static FILE *gpsCapture;
+
+static TKey_VOID tkey_dlog_bench_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+static TKey_UINT32 tkey_dlog_bench_capture(const TKey_BYTE *pbData, TKey_UINT32 uiLength)
+{
+    return (TKey_UINT32)fwrite(pbData, 1, uiLength, gpsCapture);
+}
+
+/* Drains a few records of each kind into a file, for script/dlog_decode.py */
+static TKey_INT32 tkey_dlog_bench_write_capture(const TKey_CHAR *pcPath)
+{
+    static const TKey_CHAR acName[] = "capture";
+    TKey_BYTE abData[TKEY_DLOG_MAX_BUF + 36];
+    TKey_UINT32 uiIndex;
+
+    gpsCapture = fopen(pcPath, "wb");
+    if((gpsCapture == TKey_NULL) ||
+       (E_THINKEY_SUCCESS != TKey_DLog_Start(tkey_dlog_bench_capture, TKey_FALSE))) {
+        return 1;
+    }
+    TKEY_DLOG(TKEY_DLOG_LEVEL_INFO, "dlog %s started", acName);
+    for(uiIndex = 0; uiIndex < sizeof(abData); uiIndex++) {
+        abData[uiIndex] = (TKey_BYTE)(0xA0 + uiIndex);
+    }
+    for(uiIndex = 0; uiIndex < 4; uiIndex++) {
+        TKEY_DLOG(TKEY_DLOG_LEVEL_DEBUG, "record %u of %d: 0x%08lx %c", uiIndex, 4,
+                  0xC0DE0000u + uiIndex, 'a' + uiIndex);
+    }
+    TKEY_DLOG(TKEY_DLOG_LEVEL_WARNING, "negative %d, 100%% %5u|%-4x|", -12, 42u, 0xbu);
+    TKEY_DLOG_BUF(TKEY_DLOG_LEVEL_ERROR, "SPI rx", abData, 6);
+    TKEY_DLOG_BUF(TKEY_DLOG_LEVEL_DEBUG, "long", abData, sizeof(abData));
+    THINKey_OSAL_Delay(TKEY_DLOG_DRAIN_MS * 5);
+    fclose(gpsCapture);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiIterations = 0;
+    TKey_INT32 iFailed;
+
+    if(argc > 1) {
+        uiIterations = (TKey_UINT32)strtoul(argv[1], TKey_NULL, 0);
+    }
+    iFailed = TKey_DLogBench_Report(tkey_dlog_bench_print, uiIterations);
+    if(argc > 2) {
+        iFailed += tkey_dlog_bench_write_capture(argv[2]);
+    }
+    return (0 == iFailed) ? 0 : 1;
+}
+#endif /* THINKEY_DLOG_BENCH_MAIN */
@@ -0,0 +1,222 @@
+/*
+ * \file thinkey_rtt.c
+ *
+ * \brief RTT up channels
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_rtt.h"
+#include "thinkey_osal.h"
+#include <string.h>
+
+#if !defined(THINKEY_HOST_BUILD)
+#include "SEGGER_RTT/SEGGER_RTT.h"
+
+#if (SEGGER_RTT_MAX_NUM_UP_BUFFERS < TKEY_RTT_CHANNEL_COUNT)
+#error "SEGGER_RTT_MAX_NUM_UP_BUFFERS is too small for the THINKey channels"
+#endif
+#endif
+
+typedef struct
+{
+    const TKey_CHAR *pcName;
+    TKey_BYTE *pbBuffer;            /* THINKey_NULL: configured by SEGGER_RTT */
+    TKey_UINT32 uiSize;
+    TKey_UINT32 uiPolicy;
+} TKey_RttChannel_t;
+
+#if !defined(THINKEY_HOST_BUILD)
+static TKey_BYTE gabRttSysMon[TKEY_RTT_SYSMON_BUFFER_SIZE];
+static TKey_BYTE gabRttLog[TKEY_RTT_LOG_BUFFER_SIZE];
+static TKey_BYTE gabRttReport[TKEY_RTT_REPORT_BUFFER_SIZE];
+static TKey_BYTE gabRttTrace[TKEY_RTT_TRACE_BUFFER_SIZE];
+#define TKEY_RTT_BUFFER(abBuffer) abBuffer, sizeof(abBuffer)
+#else
+#define TKEY_RTT_BUFFER(abBuffer) TKey_NULL, 0
+#endif
+
+/* Text may be cut, a binary record is whole or nothing */
+static const TKey_RttChannel_t gasRttChannels[TKEY_RTT_CHANNEL_COUNT] = {
+    { "Terminal", TKey_NULL, 0, TKEY_RTT_POLICY_TRIM },
+    { "TKeySysMon", TKEY_RTT_BUFFER(gabRttSysMon), TKEY_RTT_POLICY_SKIP },
+    { "TKeyLog", TKEY_RTT_BUFFER(gabRttLog), TKEY_RTT_POLICY_SKIP },
+    { "TKeyReport", TKEY_RTT_BUFFER(gabRttReport), TKEY_RTT_POLICY_SKIP },
+    { "TKeyTrace", TKEY_RTT_BUFFER(gabRttTrace), TKEY_RTT_POLICY_SKIP },
+};
+
+static TKey_RttCounts_t gasRttCounts[TKEY_RTT_CHANNEL_COUNT];
+static TKey_RttWrite_t gpfnRttMux;
+static volatile TKey_BOOL gbRttInit = TKey_FALSE;
+
+/* Sends a write as mux frames, returns the bytes of it sent */
+static TKey_UINT32 tkey_rtt_mux(TKey_RttWrite_t pfnMux, TKey_UINT32 uiChannel,
+                                const TKey_BYTE *pbData, TKey_UINT32 uiLength)
+{
+    TKey_BYTE abFrame[TKEY_RTT_MUX_FRAME_MAX];
+    TKey_UINT32 uiSent = 0;
+    TKey_UINT32 uiChunk;
+    TKey_UINT32 uiIndex;
+    TKey_BYTE bSum;
+
+    while(uiSent < uiLength) {
+        uiChunk = uiLength - uiSent;
+        if(uiChunk > TKEY_RTT_MUX_PAYLOAD) {
+            uiChunk = TKEY_RTT_MUX_PAYLOAD;
+        }
+        abFrame[0] = TKEY_RTT_MUX_SYNC;
+        abFrame[1] = (TKey_BYTE)uiChannel;
+        abFrame[2] = (TKey_BYTE)uiChunk;
+        abFrame[3] = (TKey_BYTE)(uiChunk >> 8);
+        memcpy(&abFrame[4], &pbData[uiSent], uiChunk);
+        bSum = 0;
+        for(uiIndex = 1; uiIndex < uiChunk + 4; uiIndex++) {
+            bSum = (TKey_BYTE)(bSum + abFrame[uiIndex]);
+        }
+        abFrame[uiChunk + 4] = (TKey_BYTE)(0u - bSum);
+
+        if(pfnMux(abFrame, uiChunk + 5) != uiChunk + 5) {
+            break;
+        }
+        uiSent += uiChunk;
+    }
+    return uiSent;
+}
+
+TKey_VOID TKey_Rtt_Init(TKey_VOID)
+{
+#if !defined(THINKEY_HOST_BUILD)
+    const TKey_RttChannel_t *psChannel;
+    TKey_UINT32 uiChannel;
+    unsigned uFlags;
+#endif
+
+    if(gbRttInit) {
+        return;
+    }
+#if !defined(THINKEY_HOST_BUILD)
+    for(uiChannel = 0; uiChannel < TKEY_RTT_CHANNEL_COUNT; uiChannel++) {
+        psChannel = &gasRttChannels[uiChannel];
+        uFlags = (psChannel->uiPolicy == TKEY_RTT_POLICY_TRIM) ?
+                 SEGGER_RTT_MODE_NO_BLOCK_TRIM : SEGGER_RTT_MODE_NO_BLOCK_SKIP;
+        if(psChannel->pbBuffer == TKey_NULL) {
+            SEGGER_RTT_SetFlagsUpBuffer(uiChannel, uFlags);
+        } else {
+            SEGGER_RTT_ConfigUpBuffer(uiChannel, psChannel->pcName, psChannel->pbBuffer,
+                                      psChannel->uiSize, uFlags);
+        }
+    }
+#endif
+    gbRttInit = TKey_TRUE;
+
+    TKEY_TRACE(TKEY_TRACE_CLOCK, THINKey_OSAL_uiRunTimeCounterHz());
+}
+
+TKey_VOID TKey_Rtt_SetMux(TKey_RttWrite_t pfnWrite)
+{
+    __atomic_store_n(&gpfnRttMux, pfnWrite, __ATOMIC_RELEASE);
+}
+
+TKey_UINT32 TKey_Rtt_Write(TKey_UINT32 uiChannel, const TKey_VOID *pvData,
+                           TKey_UINT32 uiLength)
+{
+    TKey_RttWrite_t pfnMux = __atomic_load_n(&gpfnRttMux, __ATOMIC_ACQUIRE);
+    TKey_RttCounts_t *psCounts;
+    TKey_UINT32 uiWritten = 0;
+
+    if(uiChannel >= TKEY_RTT_CHANNEL_COUNT) {
+        return 0;
+    }
+    psCounts = &gasRttCounts[uiChannel];
+
+    if(pfnMux != TKey_NULL) {
+        uiWritten = tkey_rtt_mux(pfnMux, uiChannel, (const TKey_BYTE *)pvData, uiLength);
+    } else if(gbRttInit) {
+#if !defined(THINKEY_HOST_BUILD)
+        uiWritten = SEGGER_RTT_Write(uiChannel, pvData, uiLength);
+#endif
+    }
+
+    if(uiWritten == uiLength) {
+        __atomic_fetch_add(&psCounts->uiWrites, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&psCounts->uiDropped, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&psCounts->uiDroppedBytes, uiLength - uiWritten,
+                           __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&psCounts->uiBytes, uiWritten, __ATOMIC_RELAXED);
+
+    return uiWritten;
+}
+
+TKey_UINT32 TKey_Rtt_Read(TKey_UINT32 uiChannel, TKey_VOID *pvData,
+                          TKey_UINT32 uiMaxLength)
+{
+#if !defined(THINKEY_HOST_BUILD)
+    if(gbRttInit && (uiChannel < SEGGER_RTT_MAX_NUM_DOWN_BUFFERS)) {
+        return SEGGER_RTT_Read(uiChannel, pvData, uiMaxLength);
+    }
+#else
+    (void)uiChannel;
+    (void)pvData;
+    (void)uiMaxLength;
+#endif
+    return 0;
+}
+
+THINKey_eStatusType TKey_Rtt_Report(TKey_UINT32 uiType, const TKey_VOID *pvPayload,
+                                    TKey_UINT32 uiLength)
+{
+    TKey_BYTE abRecord[TKEY_RTT_REPORT_MAX + 2];
+
+    if((uiLength > TKEY_RTT_REPORT_MAX) || ((pvPayload == TKey_NULL) && (uiLength != 0))) {
+        return E_THINKEY_FAILURE;
+    }
+    abRecord[0] = (TKey_BYTE)uiType;
+    abRecord[1] = (TKey_BYTE)uiLength;
+    if(uiLength != 0) {
+        memcpy(&abRecord[2], pvPayload, uiLength);
+    }
+
+    if(TKey_Rtt_Write(TKEY_RTT_CHANNEL_REPORT, abRecord, uiLength + 2) != uiLength + 2) {
+        return E_THINKEY_FAILURE;
+    }
+    return E_THINKEY_SUCCESS;
+}
+
+TKey_VOID TKey_Rtt_Trace(TKey_UINT32 uiEvent, TKey_UINT32 uiArg)
+{
+    TKey_UINT32 auiRecord[3];
+
+    auiRecord[0] = THINKey_OSAL_uiRunTimeCounter();
+    auiRecord[1] = uiEvent;
+    auiRecord[2] = uiArg;
+    (void)TKey_Rtt_Write(TKEY_RTT_CHANNEL_TRACE, auiRecord, sizeof(auiRecord));
+}
+
+TKey_VOID TKey_Rtt_GetCounts(TKey_UINT32 uiChannel, TKey_RttCounts_t *psCounts)
+{
+    TKey_RttCounts_t *psFrom;
+
+    if(psCounts == TKey_NULL) {
+        return;
+    }
+    if(uiChannel >= TKEY_RTT_CHANNEL_COUNT) {
+        memset(psCounts, 0, sizeof(*psCounts));
+        return;
+    }
+    psFrom = &gasRttCounts[uiChannel];
+    psCounts->uiWrites = __atomic_load_n(&psFrom->uiWrites, __ATOMIC_RELAXED);
+    psCounts->uiBytes = __atomic_load_n(&psFrom->uiBytes, __ATOMIC_RELAXED);
+    psCounts->uiDropped = __atomic_load_n(&psFrom->uiDropped, __ATOMIC_RELAXED);
+    psCounts->uiDroppedBytes = __atomic_load_n(&psFrom->uiDroppedBytes, __ATOMIC_RELAXED);
+}
+
+const TKey_CHAR* TKey_Rtt_ChannelName(TKey_UINT32 uiChannel)
+{
+    if(uiChannel >= TKEY_RTT_CHANNEL_COUNT) {
+        return TKey_NULL;
+    }
+    return gasRttChannels[uiChannel].pcName;
+}
@@ -0,0 +1,408 @@
+/*
+ * \file thinkey_rtt_check.c
+ *
+ * \brief RTT channel check
+ *
+ * On the target call TKey_RttCheck_Report() from a task, with nothing
+ * else writing to the channels; on a Linux host build with
+ * THINKEY_HOST_BUILD and THINKEY_RTT_CHECK_MAIN, linked with the host
+ * OSAL, to get a standalone program. The program writes the mux capture to
+ * the file named by its argument, if any, for script/rtt_demux.py.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_rtt_check.h"
+#include "thinkey_rtt.h"
+#include "thinkey_dlog.h"
+#include "thinkey_osal.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(THINKEY_HOST_BUILD)
+#include "thinkey_osal_posix.h"
+#endif
+
+#define TKEY_RTT_CHECK_CAPTURE_SIZE 32768
+#define TKEY_RTT_CHECK_STREAM_SIZE 16384
+#define TKEY_RTT_CHECK_STACK 1024
+#define TKEY_RTT_CHECK_PRIORITY 2
+#define TKEY_RTT_CHECK_WRITERS 3
+#define TKEY_RTT_CHECK_ISR_EVERY 4
+#define TKEY_RTT_CHECK_WAIT_MS 5000
+#define TKEY_RTT_CHECK_BAD 0xFFFFFFFFu
+
+/* The channel each writer task writes to; the interrupt traces */
+static const TKey_UINT32 gauiCheckChannels[TKEY_RTT_CHECK_WRITERS] = {
+    TKEY_RTT_CHANNEL_SYSMON, TKEY_RTT_CHANNEL_LOG, TKEY_RTT_CHANNEL_REPORT,
+};
+
+static TKey_BYTE gabCapture[TKEY_RTT_CHECK_CAPTURE_SIZE];
+static TKey_UINT32 guiCaptured;
+static TKey_UINT32 guiCaptureLimit = TKEY_RTT_CHECK_CAPTURE_SIZE;
+static TKey_BYTE gabStream[TKEY_RTT_CHECK_STREAM_SIZE];
+static TKey_BYTE gabLong[TKEY_RTT_MUX_PAYLOAD * 2 + 40];
+static TKey_UINT32 guiFinished;
+static TKey_UINT32 guiIsrSeq;
+
+/* The mux: keeps whole frames while they fit */
+static TKey_UINT32 tkey_rtt_check_write(const TKey_BYTE *pbData, TKey_UINT32 uiLength)
+{
+    TKey_UINT32 uiWritten = 0;
+
+    THINKey_OSAL_vEnterCritical();
+    if(guiCaptured + uiLength <= guiCaptureLimit) {
+        memcpy(&gabCapture[guiCaptured], pbData, uiLength);
+        guiCaptured += uiLength;
+        uiWritten = uiLength;
+    }
+    THINKey_OSAL_vExitCritical();
+
+    return uiWritten;
+}
+
+static TKey_UINT32 tkey_rtt_check_captured(TKey_VOID)
+{
+    TKey_UINT32 uiCaptured;
+
+    THINKey_OSAL_vEnterCritical();
+    uiCaptured = guiCaptured;
+    THINKey_OSAL_vExitCritical();
+
+    return uiCaptured;
+}
+
+static TKey_UINT32 tkey_rtt_check_get32(const TKey_BYTE *pb)
+{
+    return (TKey_UINT32)pb[0] | ((TKey_UINT32)pb[1] << 8) |
+           ((TKey_UINT32)pb[2] << 16) | ((TKey_UINT32)pb[3] << 24);
+}
+
+/* Joins the payloads of the frames of a channel captured from uiFrom on
+ * into gabStream. Returns their length, or TKEY_RTT_CHECK_BAD if a frame
+ * is broken. */
+static TKey_UINT32 tkey_rtt_check_demux(TKey_UINT32 uiChannel, TKey_UINT32 uiFrom)
+{
+    TKey_UINT32 uiCaptured = tkey_rtt_check_captured();
+    TKey_UINT32 uiLength = 0;
+    TKey_UINT32 uiPayload;
+    TKey_UINT32 uiIndex;
+    TKey_BYTE bSum;
+
+    while(uiFrom < uiCaptured) {
+        if((uiFrom + 5 > uiCaptured) || (gabCapture[uiFrom] != TKEY_RTT_MUX_SYNC)) {
+            return TKEY_RTT_CHECK_BAD;
+        }
+        uiPayload = (TKey_UINT32)gabCapture[uiFrom + 2] |
+                    ((TKey_UINT32)gabCapture[uiFrom + 3] << 8);
+        if((uiPayload > TKEY_RTT_MUX_PAYLOAD) || (uiFrom + uiPayload + 5 > uiCaptured)) {
+            return TKEY_RTT_CHECK_BAD;
+        }
+        bSum = 0;
+        for(uiIndex = 1; uiIndex < uiPayload + 5; uiIndex++) {
+            bSum = (TKey_BYTE)(bSum + gabCapture[uiFrom + uiIndex]);
+        }
+        if((bSum != 0) || (gabCapture[uiFrom + 1] >= TKEY_RTT_CHANNEL_COUNT)) {
+            return TKEY_RTT_CHECK_BAD;
+        }
+        if(gabCapture[uiFrom + 1] == uiChannel) {
+            if(uiLength + uiPayload > sizeof(gabStream)) {
+                return TKEY_RTT_CHECK_BAD;
+            }
+            memcpy(&gabStream[uiLength], &gabCapture[uiFrom + 4], uiPayload);
+            uiLength += uiPayload;
+        }
+        uiFrom += uiPayload + 5;
+    }
+    return uiLength;
+}
+
+#if defined(THINKEY_HOST_BUILD)
+static TKey_VOID tkey_rtt_check_isr(TKey_VOID *pvArg)
+{
+    (void)pvArg;
+    TKey_Rtt_Trace(TKEY_TRACE_USER, guiIsrSeq++);
+}
+#endif
+
+static TKey_VOID tkey_rtt_check_writer(TKey_VOID *pvParams)
+{
+    TKey_UINT32 uiWriter = (TKey_UINT32)(uintptr_t)pvParams;
+    TKey_UINT32 auiRecord[2];
+    TKey_UINT32 uiSeq;
+
+    auiRecord[0] = uiWriter;
+    for(uiSeq = 0; uiSeq < TKEY_RTT_CHECK_RECORDS; uiSeq++) {
+        auiRecord[1] = uiSeq;
+        (void)TKey_Rtt_Write(gauiCheckChannels[uiWriter], auiRecord, sizeof(auiRecord));
+#if defined(THINKEY_HOST_BUILD)
+        if((uiWriter == 0) && ((uiSeq % TKEY_RTT_CHECK_ISR_EVERY) == 0)) {
+            TKey_OsalPosix_RunIsr(tkey_rtt_check_isr, TKey_NULL);
+        }
+#endif
+        if((uiSeq % 16) == 15) {
+            THINKey_OSAL_Delay(0);
+        }
+    }
+    __atomic_fetch_add(&guiFinished, 1, __ATOMIC_RELEASE);
+    for(;;) {
+        THINKey_OSAL_Delay(1000);
+    }
+}
+
+/* Checks the writes of the writer tasks and the interrupt, captured from
+ * uiFrom on */
+static TKey_BOOL tkey_rtt_check_concurrent(TKey_UINT32 uiFrom)
+{
+    TKey_RttCounts_t asBefore[TKEY_RTT_CHANNEL_COUNT];
+    TKey_RttCounts_t sAfter;
+    TKey_UINT32 uiWriter;
+    TKey_UINT32 uiLength;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiWaited = 0;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    for(uiIndex = 0; uiIndex < TKEY_RTT_CHANNEL_COUNT; uiIndex++) {
+        TKey_Rtt_GetCounts(uiIndex, &asBefore[uiIndex]);
+    }
+    guiIsrSeq = 0;
+    for(uiWriter = 0; uiWriter < TKEY_RTT_CHECK_WRITERS; uiWriter++) {
+        if(E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("RTT writer",
+                tkey_rtt_check_writer, (TKey_VOID *)(uintptr_t)uiWriter,
+                TKEY_RTT_CHECK_PRIORITY, TKEY_RTT_CHECK_STACK, TKey_NULL)) {
+            return TKey_FALSE;
+        }
+    }
+    while((TKEY_RTT_CHECK_WRITERS != __atomic_load_n(&guiFinished, __ATOMIC_ACQUIRE)) &&
+          (uiWaited < TKEY_RTT_CHECK_WAIT_MS)) {
+        THINKey_OSAL_Delay(10);
+        uiWaited += 10;
+    }
+    if(uiWaited >= TKEY_RTT_CHECK_WAIT_MS) {
+        return TKey_FALSE;
+    }
+
+    /* Each channel has the records of its writer whole and in order */
+    for(uiWriter = 0; bPassed && (uiWriter < TKEY_RTT_CHECK_WRITERS); uiWriter++) {
+        uiLength = tkey_rtt_check_demux(gauiCheckChannels[uiWriter], uiFrom);
+        bPassed = (uiLength == TKEY_RTT_CHECK_RECORDS * 8);
+        for(uiIndex = 0; bPassed && (uiIndex < TKEY_RTT_CHECK_RECORDS); uiIndex++) {
+            bPassed = (tkey_rtt_check_get32(&gabStream[uiIndex * 8]) == uiWriter) &&
+                      (tkey_rtt_check_get32(&gabStream[uiIndex * 8 + 4]) == uiIndex);
+        }
+        TKey_Rtt_GetCounts(gauiCheckChannels[uiWriter], &sAfter);
+        bPassed = bPassed &&
+                  (sAfter.uiWrites - asBefore[gauiCheckChannels[uiWriter]].uiWrites ==
+                   TKEY_RTT_CHECK_RECORDS) &&
+                  (sAfter.uiDropped == asBefore[gauiCheckChannels[uiWriter]].uiDropped);
+    }
+
+    /* And the trace channel those of the interrupt */
+    uiLength = tkey_rtt_check_demux(TKEY_RTT_CHANNEL_TRACE, uiFrom);
+    bPassed = bPassed && (uiLength == guiIsrSeq * 12);
+    for(uiIndex = 0; bPassed && (uiIndex < guiIsrSeq); uiIndex++) {
+        bPassed = (tkey_rtt_check_get32(&gabStream[uiIndex * 12 + 4]) == TKEY_TRACE_USER) &&
+                  (tkey_rtt_check_get32(&gabStream[uiIndex * 12 + 8]) == uiIndex);
+    }
+    TKey_Rtt_GetCounts(TKEY_RTT_CHANNEL_TRACE, &sAfter);
+    bPassed = bPassed &&
+              (sAfter.uiWrites - asBefore[TKEY_RTT_CHANNEL_TRACE].uiWrites == guiIsrSeq);
+
+    return bPassed;
+}
+
+/* Looks for a record of the deferred log with the format pcFormat in the
+ * log channel, captured from uiFrom on */
+static TKey_BOOL tkey_rtt_check_dlog(TKey_UINT32 uiFrom, const TKey_CHAR *pcFormat)
+{
+    TKey_UINT32 uiLength = tkey_rtt_check_demux(TKEY_RTT_CHANNEL_LOG, uiFrom);
+    const TKey_CHAR *pcRecord;
+    TKey_UINT32 uiHeader;
+    TKey_UINT32 uiOffset = 0;
+
+    if(uiLength == TKEY_RTT_CHECK_BAD) {
+        return TKey_FALSE;
+    }
+    while(uiOffset + TKEY_DLOG_HEADER_WORDS * 4 <= uiLength) {
+        uiHeader = tkey_rtt_check_get32(&gabStream[uiOffset]);
+        if(((uiHeader >> 24) != TKEY_DLOG_MAGIC) || (TKEY_DLOG_WORDS(uiHeader) == 0)) {
+            return TKey_FALSE;
+        }
+        pcRecord = TKey_DLog_GetFormat(tkey_rtt_check_get32(&gabStream[uiOffset + 4]));
+        if((pcRecord != TKey_NULL) && (0 == strcmp(pcRecord, pcFormat))) {
+            return TKey_TRUE;
+        }
+        uiOffset += TKEY_DLOG_WORDS(uiHeader) * 4;
+    }
+    return TKey_FALSE;
+}
+
+static TKey_VOID tkey_rtt_check_result(TKey_BenchPrint_t pfnPrint,
+                                       const TKey_CHAR *pcCheck,
+                                       TKey_BOOL bPassed, TKey_UINT32 *puiFailed)
+{
+    TKey_CHAR acLine[64];
+
+    snprintf(acLine, sizeof(acLine), "%-24s %s\r\n", pcCheck,
+             bPassed ? "pass" : "FAIL");
+    pfnPrint(acLine);
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+TKey_INT32 TKey_RttCheck_Report(TKey_BenchPrint_t pfnPrint)
+{
+    static const TKey_BYTE abText[] = "terminal line\r\n";
+    TKey_BYTE abPayload[TKEY_RTT_REPORT_MAX + 1];
+    TKey_RttCounts_t sBefore;
+    TKey_RttCounts_t sAfter;
+    TKey_UINT32 uiFailed = 0;
+    TKey_UINT32 uiLength;
+    TKey_UINT32 uiFrom;
+    TKey_UINT32 uiIndex;
+    TKey_BOOL bPassed;
+
+    for(uiIndex = 0; uiIndex < sizeof(gabLong); uiIndex++) {
+        gabLong[uiIndex] = (TKey_BYTE)(uiIndex * 7);
+    }
+    for(uiIndex = 0; uiIndex < sizeof(abPayload); uiIndex++) {
+        abPayload[uiIndex] = (TKey_BYTE)uiIndex;
+    }
+
+    /* Nowhere to go yet: dropped and counted */
+    TKey_Rtt_GetCounts(TKEY_RTT_CHANNEL_REPORT, &sBefore);
+    bPassed = (0 == TKey_Rtt_Write(TKEY_RTT_CHANNEL_REPORT, abPayload, 10));
+    TKey_Rtt_GetCounts(TKEY_RTT_CHANNEL_REPORT, &sAfter);
+    bPassed = bPassed && (sAfter.uiDropped == sBefore.uiDropped + 1) &&
+              (sAfter.uiDroppedBytes == sBefore.uiDroppedBytes + 10) &&
+              (sAfter.uiWrites == sBefore.uiWrites) &&
+              (0 == TKey_Rtt_Write(TKEY_RTT_CHANNEL_COUNT, abPayload, 10));
+    tkey_rtt_check_result(pfnPrint, "no sink dropped", bPassed, &uiFailed);
+
+    /* The first frame is the counter rate on the trace channel */
+    TKey_Rtt_SetMux(tkey_rtt_check_write);
+    TKey_Rtt_Init();
+    uiLength = tkey_rtt_check_demux(TKEY_RTT_CHANNEL_TRACE, 0);
+    bPassed = (uiLength == 12) &&
+              (tkey_rtt_check_get32(&gabStream[4]) == TKEY_TRACE_CLOCK) &&
+              (tkey_rtt_check_get32(&gabStream[8]) == THINKey_OSAL_uiRunTimeCounterHz());
+    tkey_rtt_check_result(pfnPrint, "init clock trace", bPassed, &uiFailed);
+
+    /* One frame per write on its own channel, none for an empty one */
+    uiFrom = tkey_rtt_check_captured();
+    bPassed = (sizeof(abText) - 1 == TKey_Rtt_Write(TKEY_RTT_CHANNEL_TERMINAL, abText,
+                                                    sizeof(abText) - 1)) &&
+              (3 == TKey_Rtt_Write(TKEY_RTT_CHANNEL_SYSMON, gabLong, 3)) &&
+              (0 == TKey_Rtt_Write(TKEY_RTT_CHANNEL_LOG, gabLong, 0)) &&
+              (tkey_rtt_check_captured() == uiFrom + (sizeof(abText) - 1) + 3 + 2 * 5);
+    uiLength = tkey_rtt_check_demux(TKEY_RTT_CHANNEL_TERMINAL, uiFrom);
+    bPassed = bPassed && (uiLength == sizeof(abText) - 1) &&
+              (0 == memcmp(gabStream, abText, uiLength));
+    uiLength = tkey_rtt_check_demux(TKEY_RTT_CHANNEL_SYSMON, uiFrom);
+    bPassed = bPassed && (uiLength == 3) && (0 == memcmp(gabStream, gabLong, 3));
+    tkey_rtt_check_result(pfnPrint, "mux frames", bPassed, &uiFailed);
+
+    /* A long write takes several frames */
+    uiFrom = tkey_rtt_check_captured();
+    bPassed = (sizeof(gabLong) == TKey_Rtt_Write(TKEY_RTT_CHANNEL_LOG, gabLong,
+                                                 sizeof(gabLong))) &&
+              (tkey_rtt_check_captured() == uiFrom + sizeof(gabLong) + 3 * 5);
+    uiLength = tkey_rtt_check_demux(TKEY_RTT_CHANNEL_LOG, uiFrom);
+    bPassed = bPassed && (uiLength == sizeof(gabLong)) &&
+              (0 == memcmp(gabStream, gabLong, uiLength));
+    tkey_rtt_check_result(pfnPrint, "long write split", bPassed, &uiFailed);
+
+    /* Full: a record is dropped whole and counted on its channel only,
+     * a long write keeps the frames that fitted */
+    THINKey_OSAL_vEnterCritical();
+    guiCaptureLimit = guiCaptured + 40;
+    THINKey_OSAL_vExitCritical();
+    uiFrom = tkey_rtt_check_captured();
+    TKey_Rtt_GetCounts(TKEY_RTT_CHANNEL_REPORT, &sBefore);
+    bPassed = (0 == TKey_Rtt_Write(TKEY_RTT_CHANNEL_REPORT, gabLong, 50)) &&
+              (tkey_rtt_check_captured() == uiFrom) &&
+              (30 == TKey_Rtt_Write(TKEY_RTT_CHANNEL_SYSMON, gabLong, 30));
+    TKey_Rtt_GetCounts(TKEY_RTT_CHANNEL_REPORT, &sAfter);
+    bPassed = bPassed && (sAfter.uiDropped == sBefore.uiDropped + 1) &&
+              (sAfter.uiDroppedBytes == sBefore.uiDroppedBytes + 50) &&
+              (sAfter.uiWrites == sBefore.uiWrites) && (sAfter.uiBytes == sBefore.uiBytes);
+    THINKey_OSAL_vEnterCritical();
+    guiCaptureLimit = guiCaptured + TKEY_RTT_MUX_FRAME_MAX + 10;
+    THINKey_OSAL_vExitCritical();
+    TKey_Rtt_GetCounts(TKEY_RTT_CHANNEL_LOG, &sBefore);
+    bPassed = bPassed && (TKEY_RTT_MUX_PAYLOAD == TKey_Rtt_Write(TKEY_RTT_CHANNEL_LOG, gabLong,
+                                                                 sizeof(gabLong)));
+    TKey_Rtt_GetCounts(TKEY_RTT_CHANNEL_LOG, &sAfter);
+    bPassed = bPassed && (sAfter.uiDropped == sBefore.uiDropped + 1) &&
+              (sAfter.uiDroppedBytes ==
+               sBefore.uiDroppedBytes + sizeof(gabLong) - TKEY_RTT_MUX_PAYLOAD) &&
+              (sAfter.uiBytes == sBefore.uiBytes + TKEY_RTT_MUX_PAYLOAD);
+    THINKey_OSAL_vEnterCritical();
+    guiCaptureLimit = TKEY_RTT_CHECK_CAPTURE_SIZE;
+    THINKey_OSAL_vExitCritical();
+    bPassed = bPassed && (TKEY_RTT_CHECK_BAD != tkey_rtt_check_demux(TKEY_RTT_CHANNEL_LOG,
+                                                                       uiFrom));
+    tkey_rtt_check_result(pfnPrint, "overflow drops", bPassed, &uiFailed);
+
+    /* Report records */
+    uiFrom = tkey_rtt_check_captured();
+    bPassed = (E_THINKEY_SUCCESS == TKey_Rtt_Report(TKEY_RTT_REPORT_TWR, abPayload,
+                                                    TKEY_RTT_REPORT_TWR_SIZE)) &&
+              (E_THINKEY_FAILURE == TKey_Rtt_Report(TKEY_RTT_REPORT_TWR, abPayload,
+                                                    TKEY_RTT_REPORT_MAX + 1));
+    uiLength = tkey_rtt_check_demux(TKEY_RTT_CHANNEL_REPORT, uiFrom);
+    bPassed = bPassed && (uiLength == TKEY_RTT_REPORT_TWR_SIZE + 2) &&
+              (gabStream[0] == TKEY_RTT_REPORT_TWR) &&
+              (gabStream[1] == TKEY_RTT_REPORT_TWR_SIZE) &&
+              (0 == memcmp(&gabStream[2], abPayload, TKEY_RTT_REPORT_TWR_SIZE));
+    tkey_rtt_check_result(pfnPrint, "report record", bPassed, &uiFailed);
+
+    uiFrom = tkey_rtt_check_captured();
+    tkey_rtt_check_result(pfnPrint, "concurrent writers",
+                          tkey_rtt_check_concurrent(uiFrom), &uiFailed);
+
+    /* The deferred log drained to its channel */
+    uiFrom = tkey_rtt_check_captured();
+    bPassed = (E_THINKEY_SUCCESS == TKey_DLog_Start(TKey_NULL, TKey_FALSE));
+    TKEY_DLOG(TKEY_DLOG_LEVEL_INFO, "rtt check %u", 49u);
+    THINKey_OSAL_Delay(TKEY_DLOG_DRAIN_MS * 5);
+    bPassed = bPassed && tkey_rtt_check_dlog(uiFrom, "rtt check %u");
+    tkey_rtt_check_result(pfnPrint, "dlog on log channel", bPassed, &uiFailed);
+
+    bPassed = (TKey_Rtt_ChannelName(TKEY_RTT_CHANNEL_COUNT) == TKey_NULL);
+    for(uiIndex = 0; uiIndex < TKEY_RTT_CHANNEL_COUNT; uiIndex++) {
+        bPassed = bPassed && (TKey_Rtt_ChannelName(uiIndex) != TKey_NULL);
+    }
+    tkey_rtt_check_result(pfnPrint, "channel names", bPassed, &uiFailed);
+
+    return (TKey_INT32)uiFailed;
+}
+
+#if defined(THINKEY_RTT_CHECK_MAIN)
+static TKey_VOID tkey_rtt_check_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char **argv)
+{
+    TKey_INT32 iFailed = TKey_RttCheck_Report(tkey_rtt_check_print);
+    FILE *psFile;
+
+    if(argc > 1) {
+        psFile = fopen(argv[1], "wb");
+        if(psFile == TKey_NULL) {
+            return 1;
+        }
+        THINKey_OSAL_vEnterCritical();
+        (void)fwrite(gabCapture, 1, guiCaptured, psFile);
+        THINKey_OSAL_vExitCritical();
+        fclose(psFile);
+    }
+
+    return (0 == iFailed) ? 0 : 1;
+}
+#endif /* THINKEY_RTT_CHECK_MAIN */
@@ -0,0 +1,263 @@
+/*
+ * \file thinkey_status_log.c
+ *
+ * \brief Status message history
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_status_log.h"
+#include "thinkey_osal.h"
+#include <string.h>
+
+/* Text length, sequence number, timestamp */
+#define TKEY_STATUS_LOG_HEADER 12
+#define TKEY_STATUS_LOG_RECORD(uiLength) \
+    (TKEY_STATUS_LOG_HEADER + (((uiLength) + 3u) & ~3u))
+
+/* Copies of TKey_StatusLog_GetLast() before giving up to writers */
+#define TKEY_STATUS_LOG_GETLAST_TRIES 4
+
+#if (TKEY_STATUS_LOG_SIZE & (TKEY_STATUS_LOG_SIZE - 1)) != 0
+#error "TKEY_STATUS_LOG_SIZE must be a power of two"
+#endif
+#if (TKEY_STATUS_LOG_SIZE < TKEY_STATUS_LOG_RECORD(TKEY_STATUS_LOG_TEXT_MAX))
+#error "TKEY_STATUS_LOG_SIZE must hold a record of the longest text"
+#endif
+
+/* The byte offsets only grow and are taken modulo the size. The records
+ * from uiTail to uiHead are numbered from uiOldest to uiNextSeq - 1. */
+typedef struct
+{
+    TKey_UINT32 uiHead;
+    TKey_UINT32 uiTail;
+    TKey_UINT32 uiOldest;
+    TKey_UINT32 uiNextSeq;
+    TKey_UINT32 uiOverwritten;
+    TKey_BYTE abRing[TKEY_STATUS_LOG_SIZE];
+} TKey_StatusLog_t;
+
+static TKey_StatusLog_t gsStatusLog;
+
+static TKey_VOID tkey_status_log_put(TKey_UINT32 uiAt, const TKey_VOID *pvData,
+                                     TKey_UINT32 uiLength)
+{
+    const TKey_BYTE *pbData = (const TKey_BYTE *)pvData;
+    TKey_UINT32 uiOffset = uiAt % TKEY_STATUS_LOG_SIZE;
+    TKey_UINT32 uiFirst = TKEY_STATUS_LOG_SIZE - uiOffset;
+
+    if(uiFirst > uiLength) {
+        uiFirst = uiLength;
+    }
+    memcpy(&gsStatusLog.abRing[uiOffset], pbData, uiFirst);
+    memcpy(gsStatusLog.abRing, &pbData[uiFirst], uiLength - uiFirst);
+}
+
+static TKey_VOID tkey_status_log_get(TKey_UINT32 uiAt, TKey_VOID *pvData,
+                                     TKey_UINT32 uiLength)
+{
+    TKey_BYTE *pbData = (TKey_BYTE *)pvData;
+    TKey_UINT32 uiOffset = uiAt % TKEY_STATUS_LOG_SIZE;
+    TKey_UINT32 uiFirst = TKEY_STATUS_LOG_SIZE - uiOffset;
+
+    if(uiFirst > uiLength) {
+        uiFirst = uiLength;
+    }
+    memcpy(pbData, &gsStatusLog.abRing[uiOffset], uiFirst);
+    memcpy(&pbData[uiFirst], gsStatusLog.abRing, uiLength - uiFirst);
+}
+
+/* Returns the size of the record at uiAt and copies it to psRecord if any */
+static TKey_UINT32 tkey_status_log_record(TKey_UINT32 uiAt, TKey_StatusRecord_t *psRecord)
+{
+    TKey_UINT32 auiHeader[3];
+
+    tkey_status_log_get(uiAt, auiHeader, sizeof(auiHeader));
+    if(psRecord != TKey_NULL) {
+        psRecord->uiLength = auiHeader[0];
+        psRecord->uiSeq = auiHeader[1];
+        psRecord->uiTime = auiHeader[2];
+        tkey_status_log_get(uiAt + TKEY_STATUS_LOG_HEADER, psRecord->acText,
+                            auiHeader[0]);
+        psRecord->acText[auiHeader[0]] = '\0';
+    }
+    return TKEY_STATUS_LOG_RECORD(auiHeader[0]);
+}
+
+/* Reads the record at uiAt without the lock, as TKey_StatusLog_GetLast()
+ * does. Returns its size, or 0 when it is not the record uiSeq any more,
+ * having been overwritten. The text copied is only good if the record is
+ * still kept after the copy. */
+static TKey_UINT32 tkey_status_log_peek(TKey_UINT32 uiAt, TKey_UINT32 uiSeq,
+                                        TKey_StatusRecord_t *psRecord)
+{
+    TKey_UINT32 auiHeader[3];
+
+    tkey_status_log_get(uiAt, auiHeader, sizeof(auiHeader));
+    if((auiHeader[1] != uiSeq) || (auiHeader[0] > TKEY_STATUS_LOG_TEXT_MAX)) {
+        return 0;
+    }
+    if(psRecord != TKey_NULL) {
+        psRecord->uiLength = auiHeader[0];
+        psRecord->uiSeq = auiHeader[1];
+        psRecord->uiTime = auiHeader[2];
+        tkey_status_log_get(uiAt + TKEY_STATUS_LOG_HEADER, psRecord->acText,
+                            auiHeader[0]);
+        psRecord->acText[auiHeader[0]] = '\0';
+    }
+    return TKEY_STATUS_LOG_RECORD(auiHeader[0]);
+}
+
+/* Copies the last uiCount records, or fewer if not as many are kept,
+ * without the lock. Returns how many, or 0 when a record was overwritten
+ * on the way. */
+static TKey_UINT32 tkey_status_log_copy_last(TKey_StatusRecord_t *pasRecords,
+                                             TKey_UINT32 uiCount)
+{
+    TKey_UINT32 uiAt;
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiFirst;
+    TKey_UINT32 uiNextSeq;
+    TKey_UINT32 uiSize;
+    TKey_UINT32 i;
+
+    THINKey_OSAL_vEnterCritical();
+    uiAt = gsStatusLog.uiTail;
+    uiSeq = gsStatusLog.uiOldest;
+    uiNextSeq = gsStatusLog.uiNextSeq;
+    THINKey_OSAL_vExitCritical();
+
+    if(uiCount > uiNextSeq - uiSeq) {
+        uiCount = uiNextSeq - uiSeq;
+    }
+    uiFirst = uiNextSeq - uiCount;
+    /* Walk the headers to the first record wanted */
+    for(; uiSeq != uiFirst; uiSeq++) {
+        uiSize = tkey_status_log_peek(uiAt, uiSeq, TKey_NULL);
+        if(uiSize == 0) {
+            return 0;
+        }
+        uiAt += uiSize;
+    }
+    for(i = 0; i < uiCount; i++) {
+        uiSize = tkey_status_log_peek(uiAt, uiSeq + i, &pasRecords[i]);
+        if(uiSize == 0) {
+            return 0;
+        }
+        uiAt += uiSize;
+    }
+
+    /* A record overwritten while being copied may be torn. The oldest go
+     * first, so all are good if the first one is still kept. */
+    THINKey_OSAL_vEnterCritical();
+    uiSeq = gsStatusLog.uiOldest;
+    THINKey_OSAL_vExitCritical();
+    if((TKey_INT32)(uiSeq - uiFirst) > 0) {
+        return 0;
+    }
+    return uiCount;
+}
+
+TKey_UINT32 TKey_StatusLog_Write(const TKey_CHAR *pcText, TKey_UINT32 uiLength)
+{
+    TKey_UINT32 auiHeader[3];
+    TKey_UINT32 uiSize;
+
+    if(pcText == TKey_NULL) {
+        uiLength = 0;
+    }
+    if(uiLength > TKEY_STATUS_LOG_TEXT_MAX) {
+        uiLength = TKEY_STATUS_LOG_TEXT_MAX;
+    }
+    uiSize = TKEY_STATUS_LOG_RECORD(uiLength);
+
+    THINKey_OSAL_vEnterCritical();
+    /* Overwrite the oldest records until the new one fits */
+    while((gsStatusLog.uiHead - gsStatusLog.uiTail + uiSize) > TKEY_STATUS_LOG_SIZE) {
+        gsStatusLog.uiTail += tkey_status_log_record(gsStatusLog.uiTail, TKey_NULL);
+        gsStatusLog.uiOldest++;
+        gsStatusLog.uiOverwritten++;
+    }
+    auiHeader[0] = uiLength;
+    auiHeader[1] = gsStatusLog.uiNextSeq++;
+    auiHeader[2] = THINKey_OSAL_uiRunTimeCounter();
+    tkey_status_log_put(gsStatusLog.uiHead, auiHeader, sizeof(auiHeader));
+    tkey_status_log_put(gsStatusLog.uiHead + TKEY_STATUS_LOG_HEADER, pcText, uiLength);
+    gsStatusLog.uiHead += uiSize;
+    THINKey_OSAL_vExitCritical();
+
+    return auiHeader[1];
+}
+
+TKey_VOID TKey_StatusLog_ReaderInit(TKey_StatusReader_t *psReader, TKey_BOOL bFromOldest)
+{
+    if(psReader == TKey_NULL) {
+        return;
+    }
+    THINKey_OSAL_vEnterCritical();
+    if(bFromOldest) {
+        psReader->uiNext = gsStatusLog.uiOldest;
+        psReader->uiAt = gsStatusLog.uiTail;
+    } else {
+        psReader->uiNext = gsStatusLog.uiNextSeq;
+        psReader->uiAt = gsStatusLog.uiHead;
+    }
+    THINKey_OSAL_vExitCritical();
+    psReader->uiLost = 0;
+}
+
+THINKey_eStatusType TKey_StatusLog_Read(TKey_StatusReader_t *psReader,
+                                        TKey_StatusRecord_t *psRecord)
+{
+    THINKey_eStatusType eStatus = E_THINKEY_FAILURE;
+
+    if((psReader == TKey_NULL) || (psRecord == TKey_NULL)) {
+        return E_THINKEY_FAILURE;
+    }
+
+    THINKey_OSAL_vEnterCritical();
+    /* Behind the oldest kept: the records in between were overwritten */
+    if((TKey_INT32)(psReader->uiNext - gsStatusLog.uiOldest) < 0) {
+        psReader->uiLost += gsStatusLog.uiOldest - psReader->uiNext;
+        psReader->uiNext = gsStatusLog.uiOldest;
+        psReader->uiAt = gsStatusLog.uiTail;
+    }
+    if(psReader->uiNext != gsStatusLog.uiNextSeq) {
+        psReader->uiAt += tkey_status_log_record(psReader->uiAt, psRecord);
+        psReader->uiNext++;
+        eStatus = E_THINKEY_SUCCESS;
+    }
+    THINKey_OSAL_vExitCritical();
+
+    return eStatus;
+}
+
+TKey_UINT32 TKey_StatusLog_GetLast(TKey_StatusRecord_t *pasRecords, TKey_UINT32 uiCount)
+{
+    TKey_UINT32 uiCopied = 0;
+    TKey_UINT32 uiTry;
+
+    if((pasRecords == TKey_NULL) || (uiCount == 0)) {
+        return 0;
+    }
+
+    /* The copy runs without the lock, so interrupts stay on; it starts
+     * again when writers overwrote a record it was reading */
+    for(uiTry = 0; (uiCopied == 0) && (uiTry < TKEY_STATUS_LOG_GETLAST_TRIES); uiTry++) {
+        uiCopied = tkey_status_log_copy_last(pasRecords, uiCount);
+    }
+    return uiCopied;
+}
+
+TKey_VOID TKey_StatusLog_GetCounts(TKey_UINT32 *puiWritten, TKey_UINT32 *puiOverwritten)
+{
+    THINKey_OSAL_vEnterCritical();
+    if(puiWritten != TKey_NULL) {
+        *puiWritten = gsStatusLog.uiNextSeq;
+    }
+    if(puiOverwritten != TKey_NULL) {
+        *puiOverwritten = gsStatusLog.uiOverwritten;
+    }
+    THINKey_OSAL_vExitCritical();
+}
@@ -0,0 +1,294 @@
+/*
+ * \file thinkey_status_log_check.c
+ *
+ * \brief Status message history check
+ *
+ * On the target call TKey_StatusLogCheck_Report() from a task, with no
+ * status messages sent meanwhile; on a Linux host build with
+ * THINKEY_HOST_BUILD and THINKEY_STATUS_LOG_CHECK_MAIN, linked with the
+ * host OSAL, to get a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_status_log_check.h"
+#include "thinkey_status_log.h"
+#include "thinkey_osal.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_STATUS_LOG_CHECK_STACK 1024
+#define TKEY_STATUS_LOG_CHECK_PRIORITY 2
+#define TKEY_STATUS_LOG_CHECK_WRITERS 2
+#define TKEY_STATUS_LOG_CHECK_FLOOD 200
+#define TKEY_STATUS_LOG_CHECK_LAST 5
+#define TKEY_STATUS_LOG_CHECK_WAIT_MS 10000
+
+static TKey_StatusRecord_t gsCheckRecord;
+static TKey_StatusRecord_t gasCheckLast[TKEY_STATUS_LOG_SIZE / 12];
+static TKey_UINT32 guiCheckFinished;
+
+/* Writes "<tag> <number>" and returns its sequence number */
+static TKey_UINT32 tkey_status_log_check_write(const TKey_CHAR *pcTag, TKey_UINT32 uiNumber)
+{
+    TKey_CHAR acText[32];
+    TKey_INT32 iLength;
+
+    iLength = snprintf(acText, sizeof(acText), "%s %lu", pcTag, (unsigned long)uiNumber);
+    return TKey_StatusLog_Write(acText, (TKey_UINT32)iLength);
+}
+
+/* Checks that a record is "<tag> <number>" */
+static TKey_BOOL tkey_status_log_check_is(const TKey_StatusRecord_t *psRecord,
+                                          const TKey_CHAR *pcTag, TKey_UINT32 uiNumber)
+{
+    TKey_CHAR acText[32];
+    TKey_INT32 iLength;
+
+    iLength = snprintf(acText, sizeof(acText), "%s %lu", pcTag, (unsigned long)uiNumber);
+    return (psRecord->uiLength == (TKey_UINT32)iLength) &&
+           (0 == strcmp(psRecord->acText, acText));
+}
+
+static TKey_VOID tkey_status_log_check_writer(TKey_VOID *pvParams)
+{
+    TKey_UINT32 uiWriter = (TKey_UINT32)(uintptr_t)pvParams;
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < TKEY_STATUS_LOG_CHECK_MESSAGES; uiIndex++) {
+        (void)tkey_status_log_check_write((uiWriter == 0) ? "w0" : "w1", uiIndex);
+        if((uiIndex % 32) == 31) {
+            THINKey_OSAL_Delay(0);
+        }
+    }
+    __atomic_fetch_add(&guiCheckFinished, 1, __ATOMIC_RELEASE);
+    for(;;) {
+        THINKey_OSAL_Delay(1000);
+    }
+}
+
+/* Checks that the last messages, taken while the writers run, follow each
+ * other and that those from uiFirstSeq on are whole writer messages */
+static TKey_BOOL tkey_status_log_check_last_whole(TKey_UINT32 uiFirstSeq)
+{
+    TKey_UINT32 uiCount;
+    TKey_UINT32 i;
+    unsigned long ulWriter;
+    unsigned long ulNumber;
+    TKey_CHAR acText[32];
+
+    uiCount = TKey_StatusLog_GetLast(gasCheckLast, TKEY_STATUS_LOG_CHECK_LAST);
+    for(i = 0; i < uiCount; i++) {
+        if((i > 0) && (gasCheckLast[i].uiSeq != gasCheckLast[i - 1].uiSeq + 1)) {
+            return TKey_FALSE;
+        }
+        if((TKey_INT32)(gasCheckLast[i].uiSeq - uiFirstSeq) < 0) {
+            continue;
+        }
+        if(2 != sscanf(gasCheckLast[i].acText, "w%lu %lu", &ulWriter, &ulNumber)) {
+            return TKey_FALSE;
+        }
+        snprintf(acText, sizeof(acText), "w%lu %lu", ulWriter, ulNumber);
+        if(0 != strcmp(acText, gasCheckLast[i].acText)) {
+            return TKey_FALSE;
+        }
+    }
+    return TKey_TRUE;
+}
+
+/* Reads while two tasks write. Every message is read once or counted as
+ * lost, in the order written, up to the last one, and the last messages
+ * can be taken meanwhile. */
+static TKey_BOOL tkey_status_log_check_concurrent(TKey_VOID)
+{
+    TKey_StatusReader_t sReader;
+    TKey_UINT32 auiNext[TKEY_STATUS_LOG_CHECK_WRITERS] = { 0 };
+    TKey_UINT32 uiWrittenBefore;
+    TKey_UINT32 uiWrittenAfter;
+    TKey_UINT32 uiExpectSeq;
+    TKey_UINT32 uiWriter;
+    TKey_UINT32 uiLost;
+    TKey_UINT32 uiRead = 0;
+    unsigned long ulWriter;
+    unsigned long ulNumber;
+    TKey_UINT32 uiWaited = 0;
+    TKey_BOOL bDone = TKey_FALSE;
+    TKey_BOOL bPassed = TKey_TRUE;
+
+    TKey_StatusLog_ReaderInit(&sReader, TKey_FALSE);
+    TKey_StatusLog_GetCounts(&uiWrittenBefore, TKey_NULL);
+    uiExpectSeq = sReader.uiNext;
+    for(uiWriter = 0; uiWriter < TKEY_STATUS_LOG_CHECK_WRITERS; uiWriter++) {
+        if(E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("Status writer",
+                tkey_status_log_check_writer, (TKey_VOID *)(uintptr_t)uiWriter,
+                TKEY_STATUS_LOG_CHECK_PRIORITY, TKEY_STATUS_LOG_CHECK_STACK, TKey_NULL)) {
+            return TKey_FALSE;
+        }
+    }
+
+    while(!bDone && (uiWaited < TKEY_STATUS_LOG_CHECK_WAIT_MS)) {
+        /* Seen finished before the last read, so nothing is left after it */
+        bDone = (TKEY_STATUS_LOG_CHECK_WRITERS ==
+                 __atomic_load_n(&guiCheckFinished, __ATOMIC_ACQUIRE));
+        uiLost = sReader.uiLost;
+        while(E_THINKEY_SUCCESS == TKey_StatusLog_Read(&sReader, &gsCheckRecord)) {
+            uiRead++;
+            /* In sequence, past the ones counted as lost */
+            bPassed = bPassed && (gsCheckRecord.uiSeq == uiExpectSeq + sReader.uiLost - uiLost);
+            uiExpectSeq = gsCheckRecord.uiSeq + 1;
+            uiLost = sReader.uiLost;
+            /* In the order of each writer */
+            if((2 != sscanf(gsCheckRecord.acText, "w%lu %lu", &ulWriter, &ulNumber)) ||
+               (ulWriter >= TKEY_STATUS_LOG_CHECK_WRITERS) ||
+               (ulNumber < auiNext[ulWriter])) {
+                bPassed = TKey_FALSE;
+            } else {
+                auiNext[ulWriter] = (TKey_UINT32)ulNumber + 1;
+            }
+        }
+        bPassed = bPassed && tkey_status_log_check_last_whole(uiWrittenBefore);
+        if(!bDone) {
+            THINKey_OSAL_Delay(1);
+            uiWaited++;
+        }
+    }
+
+    TKey_StatusLog_GetCounts(&uiWrittenAfter, TKey_NULL);
+    return bPassed && bDone &&
+           ((uiWrittenAfter - uiWrittenBefore) ==
+            TKEY_STATUS_LOG_CHECK_WRITERS * TKEY_STATUS_LOG_CHECK_MESSAGES) &&
+           (uiRead + sReader.uiLost == uiWrittenAfter - uiWrittenBefore) &&
+           (uiExpectSeq == uiWrittenAfter);
+}
+
+static TKey_VOID tkey_status_log_check_result(TKey_BenchPrint_t pfnPrint,
+                                              const TKey_CHAR *pcCheck,
+                                              TKey_BOOL bPassed, TKey_UINT32 *puiFailed)
+{
+    TKey_CHAR acLine[64];
+
+    snprintf(acLine, sizeof(acLine), "%-24s %s\r\n", pcCheck,
+             bPassed ? "pass" : "FAIL");
+    pfnPrint(acLine);
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+TKey_INT32 TKey_StatusLogCheck_Report(TKey_BenchPrint_t pfnPrint)
+{
+    TKey_StatusReader_t sFirst;
+    TKey_StatusReader_t sSecond;
+    TKey_StatusReader_t sBehind;
+    TKey_CHAR acLong[100];
+    TKey_UINT32 uiFailed = 0;
+    TKey_UINT32 uiTime = 0;
+    TKey_UINT32 uiWritten;
+    TKey_UINT32 uiOverwritten;
+    TKey_UINT32 uiOldest;
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_BOOL bPassed;
+
+    /* Nothing written yet */
+    TKey_StatusLog_ReaderInit(&sFirst, TKey_TRUE);
+    bPassed = (E_THINKEY_FAILURE == TKey_StatusLog_Read(&sFirst, &gsCheckRecord)) &&
+              (0 == TKey_StatusLog_GetLast(gasCheckLast, TKEY_STATUS_LOG_CHECK_LAST));
+    tkey_status_log_check_result(pfnPrint, "empty", bPassed, &uiFailed);
+
+    /* Read back in order */
+    bPassed = TKey_TRUE;
+    for(uiIndex = 0; uiIndex < 3; uiIndex++) {
+        bPassed = bPassed && (uiIndex == tkey_status_log_check_write("status", uiIndex));
+    }
+    for(uiIndex = 0; bPassed && (uiIndex < 3); uiIndex++) {
+        bPassed = (E_THINKEY_SUCCESS == TKey_StatusLog_Read(&sFirst, &gsCheckRecord)) &&
+                  (gsCheckRecord.uiSeq == uiIndex) &&
+                  tkey_status_log_check_is(&gsCheckRecord, "status", uiIndex) &&
+                  ((TKey_INT32)(gsCheckRecord.uiTime - uiTime) >= 0);
+        uiTime = gsCheckRecord.uiTime;
+    }
+    bPassed = bPassed && (E_THINKEY_FAILURE == TKey_StatusLog_Read(&sFirst, &gsCheckRecord)) &&
+              (sFirst.uiLost == 0);
+    tkey_status_log_check_result(pfnPrint, "write and read", bPassed, &uiFailed);
+
+    /* Cut to the longest text */
+    memset(acLong, 'x', sizeof(acLong));
+    (void)TKey_StatusLog_Write(acLong, sizeof(acLong));
+    bPassed = (E_THINKEY_SUCCESS == TKey_StatusLog_Read(&sFirst, &gsCheckRecord)) &&
+              (gsCheckRecord.uiLength == TKEY_STATUS_LOG_TEXT_MAX) &&
+              (strlen(gsCheckRecord.acText) == TKEY_STATUS_LOG_TEXT_MAX) &&
+              (0 == memcmp(gsCheckRecord.acText, acLong, TKEY_STATUS_LOG_TEXT_MAX));
+    tkey_status_log_check_result(pfnPrint, "long message cut", bPassed, &uiFailed);
+
+    /* Two readers, each at its own place; the second starts at the end */
+    TKey_StatusLog_ReaderInit(&sSecond, TKey_FALSE);
+    (void)tkey_status_log_check_write("pair", 0);
+    (void)tkey_status_log_check_write("pair", 1);
+    bPassed = (E_THINKEY_SUCCESS == TKey_StatusLog_Read(&sSecond, &gsCheckRecord)) &&
+              tkey_status_log_check_is(&gsCheckRecord, "pair", 0);
+    for(uiIndex = 0; bPassed && (uiIndex < 2); uiIndex++) {
+        bPassed = (E_THINKEY_SUCCESS == TKey_StatusLog_Read(&sFirst, &gsCheckRecord)) &&
+                  tkey_status_log_check_is(&gsCheckRecord, "pair", uiIndex);
+    }
+    bPassed = bPassed && (E_THINKEY_SUCCESS == TKey_StatusLog_Read(&sSecond, &gsCheckRecord)) &&
+              tkey_status_log_check_is(&gsCheckRecord, "pair", 1) &&
+              (E_THINKEY_FAILURE == TKey_StatusLog_Read(&sFirst, &gsCheckRecord)) &&
+              (E_THINKEY_FAILURE == TKey_StatusLog_Read(&sSecond, &gsCheckRecord));
+    tkey_status_log_check_result(pfnPrint, "two readers", bPassed, &uiFailed);
+
+    /* More than the ring holds: the oldest go, a reader left behind counts
+     * them and goes on from the oldest kept */
+    TKey_StatusLog_ReaderInit(&sBehind, TKey_TRUE);
+    uiOldest = sBehind.uiNext;
+    for(uiIndex = 0; uiIndex < TKEY_STATUS_LOG_CHECK_FLOOD; uiIndex++) {
+        (void)tkey_status_log_check_write("flood", uiIndex);
+    }
+    TKey_StatusLog_GetCounts(&uiWritten, &uiOverwritten);
+    bPassed = (uiOverwritten > 0) &&
+              (E_THINKEY_SUCCESS == TKey_StatusLog_Read(&sBehind, &gsCheckRecord)) &&
+              (sBehind.uiLost > 0) && (sBehind.uiLost <= uiOverwritten) &&
+              (gsCheckRecord.uiSeq == uiOldest + sBehind.uiLost);
+    uiCount = 1;
+    while(bPassed && (E_THINKEY_SUCCESS == TKey_StatusLog_Read(&sBehind, &gsCheckRecord))) {
+        uiCount++;
+    }
+    bPassed = bPassed && (uiCount + sBehind.uiLost == uiWritten - uiOldest) &&
+              tkey_status_log_check_is(&gsCheckRecord, "flood", TKEY_STATUS_LOG_CHECK_FLOOD - 1);
+    tkey_status_log_check_result(pfnPrint, "overwrite oldest", bPassed, &uiFailed);
+
+    /* Last N, oldest first */
+    uiCount = TKey_StatusLog_GetLast(gasCheckLast, TKEY_STATUS_LOG_CHECK_LAST);
+    bPassed = (uiCount == TKEY_STATUS_LOG_CHECK_LAST);
+    for(uiIndex = 0; bPassed && (uiIndex < uiCount); uiIndex++) {
+        bPassed = (gasCheckLast[uiIndex].uiSeq == uiWritten - uiCount + uiIndex) &&
+                  tkey_status_log_check_is(&gasCheckLast[uiIndex], "flood",
+                                           TKEY_STATUS_LOG_CHECK_FLOOD - uiCount + uiIndex);
+    }
+    uiCount = TKey_StatusLog_GetLast(gasCheckLast,
+                                     sizeof(gasCheckLast) / sizeof(gasCheckLast[0]));
+    bPassed = bPassed && (uiCount == uiWritten - uiOldest - sBehind.uiLost) &&
+              (gasCheckLast[uiCount - 1].uiSeq == uiWritten - 1);
+    tkey_status_log_check_result(pfnPrint, "last n", bPassed, &uiFailed);
+
+    tkey_status_log_check_result(pfnPrint, "concurrent writers",
+                                 tkey_status_log_check_concurrent(), &uiFailed);
+
+    return (TKey_INT32)uiFailed;
+}
+
+#if defined(THINKEY_STATUS_LOG_CHECK_MAIN)
+static TKey_VOID tkey_status_log_check_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    return (0 == TKey_StatusLogCheck_Report(tkey_status_log_check_print)) ? 0 : 1;
+}
+#endif /* THINKEY_STATUS_LOG_CHECK_MAIN */
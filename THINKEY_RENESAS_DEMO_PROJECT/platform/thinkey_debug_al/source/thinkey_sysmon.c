@@ -0,0 +1,409 @@
+/*
+ * \file thinkey_sysmon.c
+ *
+ * \brief Task, stack and queue monitor
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_sysmon.h"
+#include "thinkey_osal.h"
+#include "thinkey_rtt.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_SYSMON_LINE_SIZE 80
+#define TKEY_SYSMON_STACK_WORDS 384
+#define TKEY_SYSMON_PRIORITY 1
+#define TKEY_SYSMON_INPUT_SIZE 16
+
+/* Run time of each task at the previous sample */
+typedef struct
+{
+    TKey_UINT32 uiTaskNumber;
+    TKey_UINT32 uiRunTime;
+} TKey_SysMonLast_t;
+
+static TKey_SysMonLast_t gasLast[TKEY_SYSMON_MAX_TASKS];
+static TKey_UINT32 guiLastTasks;
+static TKey_UINT32 guiLastRunTime;
+static TKey_UINT32 guiSeq;
+
+static TKey_SysMonSnapshot_t gsReportSnap;
+
+/* Debug command line being typed; overlong lines are dropped whole */
+static TKey_CHAR gacInput[TKEY_SYSMON_INPUT_SIZE];
+static TKey_UINT32 guiInputLength;
+static TKey_BOOL gbInputOverflow;
+
+/* Periodic report */
+THINKEY_OSAL_TASK_STORAGE(debug, gsSysMonTask, TKEY_SYSMON_STACK_WORDS);
+static TKey_SysMonSnapshot_t gsPeriodicSnap;
+static TKey_BYTE gabFrame[TKEY_SYSMON_FRAME_MAX];
+static TKey_CHAR gacTerminal[TKEY_SYSMON_INPUT_SIZE];
+static TKey_SysMonWrite_t gpfnWrite;
+static TKey_UINT32 guiPeriodMs;
+static TKey_UINT32 guiSent;
+static TKey_UINT32 guiDropped;
+static TKey_BOOL gbStarted = TKey_FALSE;
+
+TKey_VOID TKey_SysMon_Sample(TKey_SysMonSnapshot_t *psSnap)
+{
+    TKey_SysMonLast_t asLast[TKEY_SYSMON_MAX_TASKS];
+    TKey_UINT32 uiLastTasks;
+    TKey_UINT32 uiRunTime = 0;
+    TKey_UINT32 uiWindow;
+    TKey_UINT32 uiPrev;
+    TKey_UINT32 uiHz;
+    TKey_UINT32 i;
+    TKey_UINT32 j;
+    TKey_UINT64 ullCpu;
+
+    if(psSnap == TKey_NULL) {
+        return;
+    }
+
+    psSnap->uiTasks = THINKey_OSAL_uiTaskGetStats(psSnap->asTasks,
+                                                  TKEY_SYSMON_MAX_TASKS, &uiRunTime);
+
+    /* Swap in this sample as the previous one */
+    THINKey_OSAL_vEnterCritical();
+    memcpy(asLast, gasLast, sizeof(asLast));
+    uiLastTasks = guiLastTasks;
+    uiWindow = uiRunTime - guiLastRunTime;
+    for(i = 0; i < psSnap->uiTasks; i++) {
+        gasLast[i].uiTaskNumber = psSnap->asTasks[i].uiTaskNumber;
+        gasLast[i].uiRunTime = psSnap->asTasks[i].uiRunTime;
+    }
+    guiLastTasks = psSnap->uiTasks;
+    guiLastRunTime = uiRunTime;
+    psSnap->uiSeq = guiSeq++;
+    THINKey_OSAL_vExitCritical();
+
+    /* A task new in this window ran only in it */
+    for(i = 0; i < psSnap->uiTasks; i++) {
+        uiPrev = 0;
+        for(j = 0; j < uiLastTasks; j++) {
+            if(asLast[j].uiTaskNumber == psSnap->asTasks[i].uiTaskNumber) {
+                uiPrev = asLast[j].uiRunTime;
+                break;
+            }
+        }
+        ullCpu = 0;
+        if(uiWindow != 0) {
+            ullCpu = ((TKey_UINT64)(psSnap->asTasks[i].uiRunTime - uiPrev) *
+                      TKEY_SYSMON_CPU_FULL) / uiWindow;
+        }
+        psSnap->auiCpu[i] = (ullCpu > TKEY_SYSMON_CPU_FULL) ?
+                            TKEY_SYSMON_CPU_FULL : (TKey_UINT32)ullCpu;
+    }
+
+    uiHz = THINKey_OSAL_uiRunTimeCounterHz();
+    psSnap->uiWindowUs = (uiHz == 0) ? 0 :
+                         (TKey_UINT32)(((TKey_UINT64)uiWindow * 1000000u) / uiHz);
+
+    psSnap->uiQueues = THINKey_OSAL_uiQueueList(psSnap->ahQueues,
+                                                TKEY_SYSMON_MAX_QUEUES);
+    if(psSnap->uiQueues > TKEY_SYSMON_MAX_QUEUES) {
+        psSnap->uiQueues = TKEY_SYSMON_MAX_QUEUES;
+    }
+    for(i = 0; i < psSnap->uiQueues; i++) {
+        THINKey_OSAL_vQueueGetStats(psSnap->ahQueues[i], &psSnap->asQueues[i]);
+    }
+}
+
+TKey_VOID TKey_SysMon_Print(const TKey_SysMonSnapshot_t *psSnap,
+                            TKey_SysMonPrint_t pfnPrint)
+{
+    TKey_CHAR acLine[TKEY_SYSMON_LINE_SIZE];
+    const TKey_CHAR *pcName;
+    TKey_UINT32 i;
+
+    if((psSnap == TKey_NULL) || (pfnPrint == TKey_NULL)) {
+        return;
+    }
+
+    snprintf(acLine, sizeof(acLine), "%-16s %4s %4s %7s %10s\r\n",
+             "Task", "Num", "Pri", "CPU%", "StackFree");
+    pfnPrint(acLine);
+    for(i = 0; i < psSnap->uiTasks; i++) {
+        snprintf(acLine, sizeof(acLine), "%-16.16s %4lu %4lu %4lu.%02lu %10lu\r\n",
+                 psSnap->asTasks[i].strName,
+                 (unsigned long)psSnap->asTasks[i].uiTaskNumber,
+                 (unsigned long)psSnap->asTasks[i].uiPriority,
+                 (unsigned long)(psSnap->auiCpu[i] / 100),
+                 (unsigned long)(psSnap->auiCpu[i] % 100),
+                 (unsigned long)psSnap->asTasks[i].uiStackFreeMin);
+        pfnPrint(acLine);
+    }
+
+    snprintf(acLine, sizeof(acLine), "%-16s %6s %6s %10s %8s\r\n",
+             "Queue", "Depth", "Peak", "Sent", "Dropped");
+    pfnPrint(acLine);
+    for(i = 0; i < psSnap->uiQueues; i++) {
+        pcName = THINKey_OSAL_strQueueGetName(psSnap->ahQueues[i]);
+        snprintf(acLine, sizeof(acLine), "%-16.16s %6lu %6lu %10lu %8lu\r\n",
+                 (pcName != TKey_NULL) ? pcName : "-",
+                 (unsigned long)psSnap->asQueues[i].uiDepth,
+                 (unsigned long)psSnap->asQueues[i].uiMaxDepth,
+                 (unsigned long)psSnap->asQueues[i].uiSent,
+                 (unsigned long)psSnap->asQueues[i].uiDropped);
+        pfnPrint(acLine);
+    }
+
+    snprintf(acLine, sizeof(acLine), "Window %lu us, reports %lu sent %lu dropped\r\n",
+             (unsigned long)psSnap->uiWindowUs, (unsigned long)guiSent,
+             (unsigned long)guiDropped);
+    pfnPrint(acLine);
+}
+
+TKey_VOID TKey_SysMon_Report(TKey_SysMonPrint_t pfnPrint)
+{
+    TKey_SysMon_Sample(&gsReportSnap);
+    TKey_SysMon_Print(&gsReportSnap, pfnPrint);
+}
+
+/* Debug command */
+
+static TKey_BOOL tkey_sysmon_command(const TKey_CHAR *pcLine, TKey_UINT32 uiLength)
+{
+    const TKey_CHAR *pcCommand = TKEY_SYSMON_COMMAND;
+    TKey_UINT32 i;
+
+    while((uiLength != 0) && ((pcLine[uiLength - 1] == ' ') ||
+                              (pcLine[uiLength - 1] == '\t'))) {
+        uiLength--;
+    }
+    while((uiLength != 0) && ((*pcLine == ' ') || (*pcLine == '\t'))) {
+        pcLine++;
+        uiLength--;
+    }
+    if(uiLength != strlen(pcCommand)) {
+        return TKey_FALSE;
+    }
+    for(i = 0; i < uiLength; i++) {
+        if(toupper((unsigned char)pcLine[i]) != pcCommand[i]) {
+            return TKey_FALSE;
+        }
+    }
+    return TKey_TRUE;
+}
+
+TKey_UINT32 TKey_SysMon_Input(const TKey_CHAR *pcData, TKey_UINT32 uiLength,
+                              TKey_SysMonPrint_t pfnPrint)
+{
+    TKey_UINT32 uiRun = 0;
+    TKey_UINT32 i;
+
+    if((pcData == TKey_NULL) || (pfnPrint == TKey_NULL)) {
+        return 0;
+    }
+    for(i = 0; i < uiLength; i++) {
+        if((pcData[i] != '\r') && (pcData[i] != '\n')) {
+            if(guiInputLength < sizeof(gacInput)) {
+                gacInput[guiInputLength++] = pcData[i];
+            } else {
+                gbInputOverflow = TKey_TRUE;
+            }
+            continue;
+        }
+        if(!gbInputOverflow && tkey_sysmon_command(gacInput, guiInputLength)) {
+            TKey_SysMon_Report(pfnPrint);
+            uiRun++;
+        }
+        guiInputLength = 0;
+        gbInputOverflow = TKey_FALSE;
+    }
+    return uiRun;
+}
+
+/* Frame encoding */
+
+static TKey_BYTE *tkey_sysmon_put16(TKey_BYTE *pbOut, TKey_UINT32 uiValue)
+{
+    if(uiValue > 0xFFFF) {
+        uiValue = 0xFFFF;
+    }
+    pbOut[0] = (TKey_BYTE)uiValue;
+    pbOut[1] = (TKey_BYTE)(uiValue >> 8);
+    return pbOut + 2;
+}
+
+static TKey_BYTE *tkey_sysmon_put32(TKey_BYTE *pbOut, TKey_UINT32 uiValue)
+{
+    pbOut[0] = (TKey_BYTE)uiValue;
+    pbOut[1] = (TKey_BYTE)(uiValue >> 8);
+    pbOut[2] = (TKey_BYTE)(uiValue >> 16);
+    pbOut[3] = (TKey_BYTE)(uiValue >> 24);
+    return pbOut + 4;
+}
+
+static TKey_BYTE *tkey_sysmon_put_name(TKey_BYTE *pbOut, TKey_BYTE bKind,
+                                       TKey_UINT32 uiId, const TKey_CHAR *pcName)
+{
+    TKey_UINT32 uiLength = 0;
+
+    if(pcName != TKey_NULL) {
+        while((uiLength < TKEY_SYSMON_NAME_MAX) && (pcName[uiLength] != '\0')) {
+            uiLength++;
+        }
+    }
+    pbOut[0] = bKind;
+    pbOut[1] = (TKey_BYTE)uiId;
+    pbOut[2] = (TKey_BYTE)uiLength;
+    memcpy(&pbOut[3], pcName, uiLength);
+    return pbOut + 3 + uiLength;
+}
+
+/* Writes the header and checksum around the payload at pbFrame + 4 */
+static TKey_UINT32 tkey_sysmon_frame(TKey_BYTE *pbFrame, TKey_BYTE bType,
+                                     TKey_BYTE *pbEnd)
+{
+    TKey_UINT32 uiPayload = (TKey_UINT32)(pbEnd - pbFrame) - 4;
+    TKey_BYTE bSum = 0;
+    TKey_BYTE *pb;
+
+    pbFrame[0] = TKEY_SYSMON_FRAME_SYNC;
+    pbFrame[1] = bType;
+    (void)tkey_sysmon_put16(&pbFrame[2], uiPayload);
+    for(pb = &pbFrame[1]; pb < pbEnd; pb++) {
+        bSum += *pb;
+    }
+    *pbEnd = (TKey_BYTE)(0x100 - bSum);
+
+    return uiPayload + 5;
+}
+
+TKey_UINT32 TKey_SysMon_Encode(const TKey_SysMonSnapshot_t *psSnap,
+                               TKey_BOOL bNames, TKey_BYTE *pbOut,
+                               TKey_UINT32 uiMaxBytes)
+{
+    TKey_BYTE *pbFrame = pbOut;
+    TKey_BYTE *pb;
+    TKey_UINT32 uiLength = 0;
+    TKey_UINT32 i;
+
+    if((psSnap == TKey_NULL) || (pbOut == TKey_NULL) ||
+       (uiMaxBytes < TKEY_SYSMON_FRAME_MAX)) {
+        return 0;
+    }
+
+    if(bNames) {
+        pb = pbFrame + 4;
+        *pb++ = (TKey_BYTE)(psSnap->uiTasks + psSnap->uiQueues);
+        for(i = 0; i < psSnap->uiTasks; i++) {
+            pb = tkey_sysmon_put_name(pb, 0, psSnap->asTasks[i].uiTaskNumber,
+                                      psSnap->asTasks[i].strName);
+        }
+        for(i = 0; i < psSnap->uiQueues; i++) {
+            pb = tkey_sysmon_put_name(pb, 1, i,
+                                      THINKey_OSAL_strQueueGetName(psSnap->ahQueues[i]));
+        }
+        uiLength += tkey_sysmon_frame(pbFrame, TKEY_SYSMON_FRAME_NAMES, pb);
+        pbFrame = pbOut + uiLength;
+    }
+
+    pb = pbFrame + 4;
+    pb = tkey_sysmon_put16(pb, psSnap->uiSeq & 0xFFFF);
+    pb = tkey_sysmon_put32(pb, psSnap->uiWindowUs);
+    *pb++ = (TKey_BYTE)psSnap->uiTasks;
+    for(i = 0; i < psSnap->uiTasks; i++) {
+        *pb++ = (TKey_BYTE)psSnap->asTasks[i].uiTaskNumber;
+        *pb++ = (TKey_BYTE)psSnap->asTasks[i].uiPriority;
+        pb = tkey_sysmon_put16(pb, psSnap->auiCpu[i]);
+        pb = tkey_sysmon_put16(pb, psSnap->asTasks[i].uiStackFreeMin);
+    }
+    *pb++ = (TKey_BYTE)psSnap->uiQueues;
+    for(i = 0; i < psSnap->uiQueues; i++) {
+        *pb++ = (TKey_BYTE)i;
+        pb = tkey_sysmon_put16(pb, psSnap->asQueues[i].uiDepth);
+        pb = tkey_sysmon_put16(pb, psSnap->asQueues[i].uiMaxDepth);
+        pb = tkey_sysmon_put16(pb, psSnap->asQueues[i].uiDropped);
+    }
+    uiLength += tkey_sysmon_frame(pbFrame, TKEY_SYSMON_FRAME_STATS, pb);
+
+    return uiLength;
+}
+
+/* Periodic report */
+
+static TKey_UINT32 tkey_sysmon_rtt_write(const TKey_BYTE *pbData, TKey_UINT32 uiLength)
+{
+    return TKey_Rtt_Write(TKEY_RTT_CHANNEL_SYSMON, pbData, uiLength);
+}
+
+static TKey_VOID tkey_sysmon_terminal_print(const TKey_CHAR *pcLine)
+{
+    (void)TKey_Rtt_Write(TKEY_RTT_CHANNEL_TERMINAL, pcLine, strlen(pcLine));
+}
+
+static TKey_VOID tkey_sysmon_task(TKey_VOID *pvParams)
+{
+    TKey_UINT32 uiLastTasks = 0;
+    TKey_UINT32 uiLastQueues = 0;
+    TKey_UINT32 uiFrames = 0;
+    TKey_UINT32 uiLength;
+    TKey_BOOL bNames;
+    (void)pvParams;
+
+    for(;;) {
+        THINKey_OSAL_Delay(guiPeriodMs);
+
+        TKey_SysMon_Sample(&gsPeriodicSnap);
+        bNames = ((uiFrames % TKEY_SYSMON_NAMES_EVERY) == 0) ||
+                 (gsPeriodicSnap.uiTasks != uiLastTasks) ||
+                 (gsPeriodicSnap.uiQueues != uiLastQueues);
+        uiLastTasks = gsPeriodicSnap.uiTasks;
+        uiLastQueues = gsPeriodicSnap.uiQueues;
+        uiFrames++;
+
+        uiLength = TKey_SysMon_Encode(&gsPeriodicSnap, bNames, gabFrame,
+                                      sizeof(gabFrame));
+        if(gpfnWrite(gabFrame, uiLength) == uiLength) {
+            guiSent++;
+        } else {
+            /* Names again with the next report, which may be decoded alone */
+            guiDropped++;
+            uiFrames = 0;
+        }
+
+        uiLength = TKey_Rtt_Read(TKEY_RTT_CHANNEL_TERMINAL, gacTerminal,
+                                 sizeof(gacTerminal));
+        (void)TKey_SysMon_Input(gacTerminal, uiLength, tkey_sysmon_terminal_print);
+    }
+}
+
+THINKey_eStatusType TKey_SysMon_Start(TKey_UINT32 uiPeriodMs,
+                                      TKey_SysMonWrite_t pfnWrite)
+{
+    if(gbStarted || (uiPeriodMs == 0)) {
+        return E_THINKEY_FAILURE;
+    }
+
+    if(pfnWrite == TKey_NULL) {
+        pfnWrite = tkey_sysmon_rtt_write;
+    }
+    gpfnWrite = pfnWrite;
+    guiPeriodMs = uiPeriodMs;
+
+    if(E_THINKEY_SUCCESS != THINKEY_OSAL_CREATE_STATIC_TASK(gsSysMonTask,
+            "SysMon", tkey_sysmon_task, TKey_NULL, TKEY_SYSMON_PRIORITY,
+            TKey_NULL)) {
+        return E_THINKEY_FAILURE;
+    }
+    gbStarted = TKey_TRUE;
+
+    return E_THINKEY_SUCCESS;
+}
+
+TKey_VOID TKey_SysMon_GetCounts(TKey_UINT32 *puiSent, TKey_UINT32 *puiDropped)
+{
+    if(puiSent != TKey_NULL) {
+        *puiSent = guiSent;
+    }
+    if(puiDropped != TKey_NULL) {
+        *puiDropped = guiDropped;
+    }
+}
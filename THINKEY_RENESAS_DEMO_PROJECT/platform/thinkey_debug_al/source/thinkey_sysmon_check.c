@@ -0,0 +1,387 @@
+/*
+ * \file thinkey_sysmon_check.c
+ *
+ * \brief Task, stack and queue monitor check
+ *
+ * On the target call TKey_SysMonCheck_Report() from a task with the
+ * periodic report not started; on a Linux host build with
+ * THINKEY_HOST_BUILD and THINKEY_SYSMON_CHECK_MAIN, linked with the host
+ * OSAL, to get a standalone program. The program writes the frames of the
+ * periodic report to the file named by its argument, if any, for
+ * script/sysmon_decode.py.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_sysmon_check.h"
+#include "thinkey_sysmon.h"
+#include "thinkey_osal.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TKEY_SYSMON_CHECK_STACK 1024
+#define TKEY_SYSMON_CHECK_PRIORITY 2
+#define TKEY_SYSMON_CHECK_SPIN_MS 5         /* then sleeps as long */
+#define TKEY_SYSMON_CHECK_WINDOW_MS 500
+/* Stack the deep task uses beyond the others */
+#if defined(THINKEY_HOST_BUILD)
+#define TKEY_SYSMON_CHECK_DEEP_BYTES 32768
+#else
+#define TKEY_SYSMON_CHECK_DEEP_BYTES 1024
+#endif
+#define TKEY_SYSMON_CHECK_QUEUE_DEPTH 4
+#define TKEY_SYSMON_CHECK_PERIOD_MS 100
+#define TKEY_SYSMON_CHECK_CAPTURE_SIZE 8192
+
+typedef struct
+{
+    TKey_UINT32 uiSpin;
+    TKey_UINT32 uiIdle;
+    TKey_UINT32 uiDeep;
+} TKey_SysMonCheckTasks_t;
+
+static TKey_SysMonSnapshot_t gsCheckSnap;
+static TKey_BYTE gabCheckFrame[TKEY_SYSMON_FRAME_MAX];
+static TKey_BYTE gabCapture[TKEY_SYSMON_CHECK_CAPTURE_SIZE];
+static TKey_UINT32 guiCaptured;
+static TKey_UINT32 guiCommandLines;
+
+static TKey_VOID tkey_sysmon_check_spin(TKey_VOID *pvParams)
+{
+    TKey_UINT32 uiTicks = THINKey_OSAL_uiRunTimeCounterHz() / 1000 *
+                          TKEY_SYSMON_CHECK_SPIN_MS;
+    TKey_UINT32 uiStart;
+    (void)pvParams;
+
+    for(;;) {
+        uiStart = THINKey_OSAL_uiRunTimeCounter();
+        while((THINKey_OSAL_uiRunTimeCounter() - uiStart) < uiTicks) {
+        }
+        THINKey_OSAL_Delay(TKEY_SYSMON_CHECK_SPIN_MS);
+    }
+}
+
+static TKey_VOID tkey_sysmon_check_idle(TKey_VOID *pvParams)
+{
+    (void)pvParams;
+
+    for(;;) {
+        THINKey_OSAL_Delay(1000);
+    }
+}
+
+static TKey_VOID tkey_sysmon_check_deep(TKey_VOID *pvParams)
+{
+    volatile TKey_BYTE abDeep[TKEY_SYSMON_CHECK_DEEP_BYTES];
+    TKey_UINT32 i;
+    (void)pvParams;
+
+    for(i = 0; i < sizeof(abDeep); i++) {
+        abDeep[i] = (TKey_BYTE)i;
+    }
+    for(;;) {
+        THINKey_OSAL_Delay(1000);
+    }
+}
+
+/* Index of the task in the sample, or the task count */
+static TKey_UINT32 tkey_sysmon_check_find(const TKey_SysMonSnapshot_t *psSnap,
+                                          TKey_UINT32 uiTaskNumber)
+{
+    TKey_UINT32 i;
+
+    for(i = 0; i < psSnap->uiTasks; i++) {
+        if(psSnap->asTasks[i].uiTaskNumber == uiTaskNumber) {
+            break;
+        }
+    }
+    return i;
+}
+
+static TKey_UINT32 tkey_sysmon_check_get16(const TKey_BYTE *pb)
+{
+    return (TKey_UINT32)pb[0] | ((TKey_UINT32)pb[1] << 8);
+}
+
+static TKey_UINT32 tkey_sysmon_check_sat16(TKey_UINT32 uiValue)
+{
+    return (uiValue > 0xFFFF) ? 0xFFFF : uiValue;
+}
+
+/* Checks the frame at pbFrame and returns its size, or 0 */
+static TKey_UINT32 tkey_sysmon_check_frame(const TKey_BYTE *pbFrame,
+                                           TKey_UINT32 uiLength)
+{
+    TKey_UINT32 uiSize;
+    TKey_BYTE bSum = 0;
+    TKey_UINT32 i;
+
+    if((uiLength < 5) || (pbFrame[0] != TKEY_SYSMON_FRAME_SYNC)) {
+        return 0;
+    }
+    uiSize = tkey_sysmon_check_get16(&pbFrame[2]) + 5;
+    if(uiSize > uiLength) {
+        return 0;
+    }
+    for(i = 1; i < uiSize; i++) {
+        bSum += pbFrame[i];
+    }
+    return (bSum == 0) ? uiSize : 0;
+}
+
+/* Compares a stats frame payload with the sample */
+static TKey_BOOL tkey_sysmon_check_stats(const TKey_BYTE *pbPayload,
+                                         const TKey_SysMonSnapshot_t *psSnap)
+{
+    const TKey_BYTE *pb = pbPayload + 6;
+    TKey_UINT32 i;
+
+    if((tkey_sysmon_check_get16(pbPayload) != (psSnap->uiSeq & 0xFFFF)) ||
+       (*pb++ != psSnap->uiTasks)) {
+        return TKey_FALSE;
+    }
+    for(i = 0; i < psSnap->uiTasks; i++, pb += 6) {
+        if((pb[0] != psSnap->asTasks[i].uiTaskNumber) ||
+           (pb[1] != psSnap->asTasks[i].uiPriority) ||
+           (tkey_sysmon_check_get16(&pb[2]) != psSnap->auiCpu[i]) ||
+           (tkey_sysmon_check_get16(&pb[4]) !=
+            tkey_sysmon_check_sat16(psSnap->asTasks[i].uiStackFreeMin))) {
+            return TKey_FALSE;
+        }
+    }
+    if(*pb++ != psSnap->uiQueues) {
+        return TKey_FALSE;
+    }
+    for(i = 0; i < psSnap->uiQueues; i++, pb += 7) {
+        if((pb[0] != i) ||
+           (tkey_sysmon_check_get16(&pb[1]) !=
+            tkey_sysmon_check_sat16(psSnap->asQueues[i].uiDepth)) ||
+           (tkey_sysmon_check_get16(&pb[3]) !=
+            tkey_sysmon_check_sat16(psSnap->asQueues[i].uiMaxDepth)) ||
+           (tkey_sysmon_check_get16(&pb[5]) !=
+            tkey_sysmon_check_sat16(psSnap->asQueues[i].uiDropped))) {
+            return TKey_FALSE;
+        }
+    }
+    return TKey_TRUE;
+}
+
+/* Periodic report sink; a frame that does not fit is not taken */
+static TKey_UINT32 tkey_sysmon_check_write(const TKey_BYTE *pbData,
+                                           TKey_UINT32 uiLength)
+{
+    TKey_UINT32 uiTaken = 0;
+
+    THINKey_OSAL_vEnterCritical();
+    if((guiCaptured + uiLength) <= sizeof(gabCapture)) {
+        memcpy(&gabCapture[guiCaptured], pbData, uiLength);
+        guiCaptured += uiLength;
+        uiTaken = uiLength;
+    }
+    THINKey_OSAL_vExitCritical();
+
+    return uiTaken;
+}
+
+/* TASKSTAT sink: counts the table lines */
+static TKey_VOID tkey_sysmon_check_command_print(const TKey_CHAR *pcLine)
+{
+    (void)pcLine;
+    guiCommandLines++;
+}
+
+/* TASKSTAT split over several reads runs once and prints the table; other
+ * and overlong lines run nothing */
+static TKey_BOOL tkey_sysmon_check_command(TKey_VOID)
+{
+    static const TKey_CHAR *apcIgnored[] = {
+        "TASKSTATS\r\n", "STAT\n", "\r\n", "TASKSTAT TASKSTAT TASKSTAT\n"
+    };
+    TKey_UINT32 uiRun;
+    TKey_UINT32 i;
+
+    guiCommandLines = 0;
+    uiRun = TKey_SysMon_Input("tas", 3, tkey_sysmon_check_command_print);
+    uiRun += TKey_SysMon_Input("kStat \r", 7, tkey_sysmon_check_command_print);
+    if((uiRun != 1) || (guiCommandLines < 3)) {
+        return TKey_FALSE;
+    }
+    for(i = 0; i < sizeof(apcIgnored) / sizeof(apcIgnored[0]); i++) {
+        if(TKey_SysMon_Input(apcIgnored[i], strlen(apcIgnored[i]),
+                             tkey_sysmon_check_command_print) != 0) {
+            return TKey_FALSE;
+        }
+    }
+    return TKey_SysMon_Input("TASKSTAT\n", 9, tkey_sysmon_check_command_print) == 1;
+}
+
+static TKey_VOID tkey_sysmon_check_result(TKey_BenchPrint_t pfnPrint,
+                                          const TKey_CHAR *pcCheck,
+                                          TKey_BOOL bPassed, TKey_UINT32 *puiFailed)
+{
+    TKey_CHAR acLine[64];
+
+    snprintf(acLine, sizeof(acLine), "%-24s %s\r\n", pcCheck,
+             bPassed ? "pass" : "FAIL");
+    pfnPrint(acLine);
+    if(!bPassed) {
+        (*puiFailed)++;
+    }
+}
+
+TKey_INT32 TKey_SysMonCheck_Report(TKey_BenchPrint_t pfnPrint)
+{
+    TKey_SysMonSnapshot_t *psSnap = &gsCheckSnap;
+    TKey_SysMonCheckTasks_t sTasks;
+    THINKey_OSAL_QueueStats_t sStats;
+    THINKey_HANDLE hQueue;
+    TKey_UINT32 uiMessage = 0;
+    TKey_UINT32 uiFailed = 0;
+    TKey_UINT32 uiSpin;
+    TKey_UINT32 uiIdle;
+    TKey_UINT32 uiDeep;
+    TKey_UINT32 uiLength;
+    TKey_UINT32 uiSize;
+    TKey_UINT32 uiOffset;
+    TKey_UINT32 uiFrames;
+    TKey_UINT32 i;
+    TKey_BOOL bPassed;
+
+    if(pfnPrint == TKey_NULL) {
+        return -1;
+    }
+
+    /* Queue counters: two of six sends drop, one receive */
+    hQueue = THINKey_OSAL_hCreateQueue(TKEY_SYSMON_CHECK_QUEUE_DEPTH, sizeof(uiMessage));
+    if(hQueue == THINKey_NULL) {
+        return -1;
+    }
+    THINKey_OSAL_vQueueSetName(hQueue, "sysmon check");
+    for(i = 0; i < TKEY_SYSMON_CHECK_QUEUE_DEPTH + 2; i++) {
+        (void)THINKey_OSAL_eQueueSendTimed(hQueue, &i, THINKEY_OSAL_ZERO,
+                                           E_THINKEY_OSAL_QUEUE_BACK);
+    }
+    (void)THINKey_OSAL_eQueueReceive(hQueue, &uiMessage);
+    THINKey_OSAL_vQueueGetStats(hQueue, &sStats);
+    tkey_sysmon_check_result(pfnPrint, "queue stats",
+                             (sStats.uiDepth == TKEY_SYSMON_CHECK_QUEUE_DEPTH - 1) &&
+                             (sStats.uiMaxDepth == TKEY_SYSMON_CHECK_QUEUE_DEPTH) &&
+                             (sStats.uiDropped == 2) &&
+                             (0 == strcmp(THINKey_OSAL_strQueueGetName(hQueue),
+                                          "sysmon check")), &uiFailed);
+
+    if((E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("check spin",
+            tkey_sysmon_check_spin, TKey_NULL, TKEY_SYSMON_CHECK_PRIORITY,
+            TKEY_SYSMON_CHECK_STACK, &sTasks.uiSpin)) ||
+       (E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("check idle",
+            tkey_sysmon_check_idle, TKey_NULL, TKEY_SYSMON_CHECK_PRIORITY,
+            TKEY_SYSMON_CHECK_STACK, &sTasks.uiIdle)) ||
+       (E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("check deep",
+            tkey_sysmon_check_deep, TKey_NULL, TKEY_SYSMON_CHECK_PRIORITY,
+            TKEY_SYSMON_CHECK_STACK, &sTasks.uiDeep))) {
+        return -1;
+    }
+
+    /* CPU shares and stack marks over one window */
+    TKey_SysMon_Sample(psSnap);
+    THINKey_OSAL_Delay(TKEY_SYSMON_CHECK_WINDOW_MS);
+    TKey_SysMon_Sample(psSnap);
+    TKey_SysMon_Print(psSnap, pfnPrint);
+
+    uiSpin = tkey_sysmon_check_find(psSnap, sTasks.uiSpin);
+    uiIdle = tkey_sysmon_check_find(psSnap, sTasks.uiIdle);
+    uiDeep = tkey_sysmon_check_find(psSnap, sTasks.uiDeep);
+    bPassed = (uiSpin < psSnap->uiTasks) && (uiIdle < psSnap->uiTasks) &&
+              (uiDeep < psSnap->uiTasks);
+    tkey_sysmon_check_result(pfnPrint, "tasks listed", bPassed, &uiFailed);
+    if(!bPassed) {
+        return (TKey_INT32)uiFailed;
+    }
+    tkey_sysmon_check_result(pfnPrint, "spin cpu",
+                             (psSnap->auiCpu[uiSpin] >= TKEY_SYSMON_CPU_FULL / 5) &&
+                             (psSnap->auiCpu[uiSpin] <= TKEY_SYSMON_CPU_FULL * 4 / 5),
+                             &uiFailed);
+    tkey_sysmon_check_result(pfnPrint, "idle cpu",
+                             psSnap->auiCpu[uiIdle] < TKEY_SYSMON_CPU_FULL / 20,
+                             &uiFailed);
+    tkey_sysmon_check_result(pfnPrint, "deep stack",
+                             (psSnap->asTasks[uiIdle].uiStackFreeMin >=
+                              psSnap->asTasks[uiDeep].uiStackFreeMin +
+                              TKEY_SYSMON_CHECK_DEEP_BYTES / 4 / 2),
+                             &uiFailed);
+    tkey_sysmon_check_result(pfnPrint, "window",
+                             (psSnap->uiWindowUs >= TKEY_SYSMON_CHECK_WINDOW_MS * 1000) &&
+                             (psSnap->uiWindowUs < TKEY_SYSMON_CHECK_WINDOW_MS * 2000),
+                             &uiFailed);
+
+    /* Frames: the names, then the stats matching the sample */
+    uiLength = TKey_SysMon_Encode(psSnap, TKey_TRUE, gabCheckFrame,
+                                  sizeof(gabCheckFrame));
+    uiSize = tkey_sysmon_check_frame(gabCheckFrame, uiLength);
+    bPassed = (uiSize != 0) && (gabCheckFrame[1] == TKEY_SYSMON_FRAME_NAMES) &&
+              (gabCheckFrame[4] == psSnap->uiTasks + psSnap->uiQueues);
+    if(bPassed) {
+        uiOffset = uiSize;
+        uiSize = tkey_sysmon_check_frame(&gabCheckFrame[uiOffset], uiLength - uiOffset);
+        bPassed = (uiSize != 0) && (uiOffset + uiSize == uiLength) &&
+                  (gabCheckFrame[uiOffset + 1] == TKEY_SYSMON_FRAME_STATS) &&
+                  tkey_sysmon_check_stats(&gabCheckFrame[uiOffset + 4], psSnap);
+    }
+    tkey_sysmon_check_result(pfnPrint, "encode", bPassed, &uiFailed);
+    tkey_sysmon_check_result(pfnPrint, "encode too small",
+                             0 == TKey_SysMon_Encode(psSnap, TKey_TRUE, gabCheckFrame, 16),
+                             &uiFailed);
+
+    tkey_sysmon_check_result(pfnPrint, "taskstat command",
+                             tkey_sysmon_check_command(), &uiFailed);
+
+    /* Periodic report: whole frames, the names first */
+    bPassed = (E_THINKEY_SUCCESS == TKey_SysMon_Start(TKEY_SYSMON_CHECK_PERIOD_MS,
+                                                      tkey_sysmon_check_write)) &&
+              (E_THINKEY_SUCCESS != TKey_SysMon_Start(TKEY_SYSMON_CHECK_PERIOD_MS,
+                                                      tkey_sysmon_check_write));
+    THINKey_OSAL_Delay(TKEY_SYSMON_CHECK_PERIOD_MS * 5 + TKEY_SYSMON_CHECK_PERIOD_MS / 2);
+    THINKey_OSAL_vEnterCritical();
+    uiLength = guiCaptured;
+    THINKey_OSAL_vExitCritical();
+    uiFrames = 0;
+    for(uiOffset = 0; bPassed && (uiOffset < uiLength); uiOffset += uiSize) {
+        uiSize = tkey_sysmon_check_frame(&gabCapture[uiOffset], uiLength - uiOffset);
+        bPassed = (uiSize != 0) &&
+                  ((uiOffset != 0) || (gabCapture[1] == TKEY_SYSMON_FRAME_NAMES));
+        if(bPassed && (gabCapture[uiOffset + 1] == TKEY_SYSMON_FRAME_STATS)) {
+            uiFrames++;
+        }
+    }
+    tkey_sysmon_check_result(pfnPrint, "periodic report",
+                             bPassed && (uiFrames >= 3), &uiFailed);
+
+    return (TKey_INT32)uiFailed;
+}
+
+#if defined(THINKEY_SYSMON_CHECK_MAIN)
+static TKey_VOID tkey_sysmon_check_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char **argv)
+{
+    TKey_INT32 iFailed = TKey_SysMonCheck_Report(tkey_sysmon_check_print);
+    FILE *psFile;
+
+    if(argc > 1) {
+        psFile = fopen(argv[1], "wb");
+        if(psFile == TKey_NULL) {
+            return 1;
+        }
+        THINKey_OSAL_vEnterCritical();
+        (void)fwrite(gabCapture, 1, guiCaptured, psFile);
+        THINKey_OSAL_vExitCritical();
+        fclose(psFile);
+    }
+
+    return (0 == iFailed) ? 0 : 1;
+}
+#endif /* THINKEY_SYSMON_CHECK_MAIN */
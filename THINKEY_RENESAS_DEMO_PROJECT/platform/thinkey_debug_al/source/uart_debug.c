@@ -1,8 +1,8 @@
 /******************************************************************************
 * File Name: uart_debug.c
 *
-* Description: This file contains the task that is used for thread-safe UART
-*              based debug.
+* Description: This file starts the task that is used for thread-safe
+*              deferred debug.
 *
 * Related Document: See README.md
 *
@@ -41,174 +41,22 @@
 /*******************************************************************************
  * Include header files
  ******************************************************************************/
-#include <stdarg.h>
-#include "FreeRTOS.h"
-#include "task.h"
-#include "queue.h"
 #include "uart_debug.h"
 
-/*******************************************************************************
- * Macros
- ******************************************************************************/
-/* Queue length of message queue used for debug message printing */
-#define DEBUG_QUEUE_SIZE        (16u)
-
-/* Maximum allowed length of debug message */
-#define DEBUG_MESSAGE_MAX_LEN   (100u)
-
 #if (DEBUG_ENABLE)
 
-/* Queue handle for debug message Queue */
-QueueHandle_t debug_message_q;
-
-/* Structure for storing debug message data */
-typedef struct
-{
-    const char* str_ptr;
-    debug_message_type_t message_type;
-} debug_message_data_t;
-
-/*******************************************************************************
-* Function Name: task_debug
-********************************************************************************
-* Summary:
-*  Task that prints debug messages.
-*
-* Parameters:
-*  void *param : Task parameter defined during task creation (unused)
-*
-*******************************************************************************/
-void task_debug(void* param)
-{
-    debug_message_data_t message_data;
-
-    /* Variable used to store the return values of RTOS APIs */
-    BaseType_t rtos_api_result;
-
-    /* Remove warning for unused parameter */
-    (void) param;
-
-    printf("Started print!!!!\r\n");
-    /* Repeatedly running part of the task */
-    for(;;)
-    {
-        rtos_api_result = xQueueReceive(debug_message_q, &message_data,
-                                      portMAX_DELAY);
-
-        if(rtos_api_result == pdPASS)
-        {
-#if 0
-            switch(message_data.message_type)
-            {
-                case NONE:
-                {
-                    //printf("%s", (char *)message_data.str_ptr);
-                    break;
-                }
-                case INFO:
-                {
-                    printf("[Info]    : %s\r\n", (char *)message_data.str_ptr);
-                    break;
-                }
-                case WARNING:
-                {
-                    printf("[Warning] : %s\r\n", (char *)message_data.str_ptr);
-                    break;
-                }
-                case ERROR:
-                {
-                    printf("[Error]   : %s\r\n", (char *)message_data.str_ptr);
-                    break;
-                }
-                default:
-                {
-                    break;
-                }
-            }
-#endif
-
-            /* free the message buffer allocated by the message sender */
-            vPortFree((char*)message_data.str_ptr);
-        }
-        /* Task has timed out and received no commands during an interval of
-         * portMAXDELAY ticks
-         */
-        else
-        {
-        }
-    }
-}
-
-
-/*******************************************************************************
-* Function Name: task_debug_printf
-********************************************************************************
-* Summary:
-*  This function sends messages to the debug Queue.
-*
-*******************************************************************************/
-void task_debug_printf(debug_message_type_t message_type, char* str_ptr, ...)
-{
-    debug_message_data_t message_data;
-    char* message_buffer;
-    char* task_name;
-    uint32_t length = 0;
-    va_list args;
-
-#if 1
-    /* Allocate the message buffer */
-    message_buffer = pvPortMalloc(DEBUG_MESSAGE_MAX_LEN);
-
-#endif
-    if(message_buffer)
-    {
-        va_start(args, str_ptr);
-        if(message_type != NONE)
-        {
-            task_name = pcTaskGetName(xTaskGetCurrentTaskHandle());
-            length = snprintf(message_buffer, DEBUG_MESSAGE_MAX_LEN, "%-16s : ",
-                task_name);
-        }
-
-        vsnprintf((message_buffer + length), (DEBUG_MESSAGE_MAX_LEN - length),
-                str_ptr, args);
-
-        va_end(args);
-
-        message_data.message_type = message_type;
-        message_data.str_ptr = message_buffer;
-
-        /* The receiver task is responsible to free the memory from here on */
-        if(pdPASS != xQueueSendToBack(debug_message_q, &message_data, 0u))
-        {
-            /* Failed to send the message into the queue */
-            vPortFree(message_buffer);
-        }
-    }
-    else
-    {
-        /* pvPortMalloc failed. Handle error */
-        printf("Everything goes wrong!!!!\r\n");
-    }
-}
-
-
 /*******************************************************************************
 * Function Name: task_debug_init
 ********************************************************************************
 * Summary:
-*  Initializes the underlying Task and Queue used for printing debug
-*  messages.
+*  Starts the low priority task that drains the deferred log the task prints
+*  go to. The prints no longer allocate a message buffer each, they store
+*  their format and arguments in the lock free ring of thinkey_dlog.c.
 *
 *******************************************************************************/
 void task_debug_init(void)
 {
-    debug_message_q = xQueueCreate(DEBUG_QUEUE_SIZE,
-                                   sizeof(debug_message_data_t));
-
-    xTaskCreate(task_debug, "Debug Task", 4096,
-                NULL, (tskIDLE_PRIORITY + 1u), NULL);
-};
-
+    (void)TKey_DLog_Start(TKey_NULL, TKEY_DLOG_TEXT);
+}
 
 #endif /* DEBUG_ENABLE */
@@ -11,7 +11,10 @@
  *
  *             if application wants to re-write data in FCONFIG_ADDR, use save_bssConfig(*newRamParametersBlock);
  *
- *             NOTE: The code is very MCU dependent and save will work with nRF52840 only
+ *             Saved parameters are kept as object TKEY_OBJ_ID_UWB_CONFIG in the
+ *             THINKey object store, next to the digital keys: a versioned header
+ *             with a CRC32, then the param_block_t fields before free[]. The
+ *             store must be mounted (TKey_DkStore_Init) before load_bssConfig().
  *
  * @author     Decawave Software
  *
@@ -20,18 +23,49 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "deca_device_api.h"
-#include "version.h"
 
 #include "uwb_config.h"
-#include "nrf_nvmc.h"
+#include "thinkey_objstore.h"
+#include "thinkey_objstore_async.h"
 
 //------------------------------------------------------------------------------
 extern const param_block_t FConfig;
 extern const param_block_t defaultFConfig;
 
+/* Version of the saved parameters. Bump it when a field changes meaning and
+ * add a step to config_migrate[]. New fields are only appended to run_t, so
+ * the parameters saved by an older version are a prefix of the current
+ * ones: they are laid over the defaults and the appended fields keep their
+ * default values.
+ * */
+#define UWB_CONFIG_VERSION          1
+#define UWB_CONFIG_PAYLOAD_SIZE     offsetof(param_block_t, free)
+
+typedef struct
+{
+    uint16_t    version;
+    uint16_t    length;     /**< payload bytes */
+    uint32_t    crc;        /**< CRC32 of the payload */
+    uint8_t     payload[UWB_CONFIG_PAYLOAD_SIZE];
+}__attribute__((__packed__)) uwb_config_record_t;
+
+typedef char uwb_config_record_fits_object
+    [(sizeof(uwb_config_record_t) <= TKEY_OBJSTORE_MAX_OBJECT_SIZE) ? 1 : -1];
+
+/* Migration steps: config_migrate[v] upgrades parameters saved by version v
+ * to version v + 1, after they were laid over the defaults. NULL when
+ * nothing but appended fields changed. */
+typedef void (*config_migrate_fn)(param_block_t *pcfg);
+
+static const config_migrate_fn config_migrate[UWB_CONFIG_VERSION] =
+{
+    NULL    /* version 0 was never saved */
+};
+
 /* run-time parameters block.
  *
  * This is the RAM image of the FCONFIG_ADDR .
@@ -41,6 +75,14 @@ extern const param_block_t defaultFConfig;
  * */
 static param_block_t tmpConfig __attribute__((aligned(FCONFIG_SIZE)));
 
+/* Image of the saved object, with room for the fields a newer version
+ * appended; load and save are not called concurrently */
+static union
+{
+    uwb_config_record_t record;
+    uint8_t             object[TKEY_OBJSTORE_MAX_OBJECT_SIZE];
+} configImage;
+
 //------------------------------------------------------------------------------
 // Implementation
 
@@ -53,41 +95,91 @@ param_block_t *get_pbssConfig(void)
     return &tmpConfig;
 }
 
+/* @fn      load_saved_config
+ * @brief   lays the saved parameters over pcfg, migrating them from the
+ *          version they were saved by
+ * @return  _NO_ERR when saved parameters were applied
+ * */
+static error_e load_saved_config(param_block_t *pcfg)
+{
+    TKey_UINT32 len = 0;
+    uint16_t    version;
+    uint16_t    length;
+    const uint8_t *payload = &configImage.object[offsetof(uwb_config_record_t, payload)];
+
+    if(E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStoreAsync_Read(TKEY_OBJ_ID_UWB_CONFIG,
+                                       configImage.object,
+                                       sizeof(configImage.object), &len) ||
+       len < offsetof(uwb_config_record_t, payload))
+    {
+        return (_ERR);
+    }
+
+    version = configImage.record.version;
+    length = configImage.record.length;
+    if((0 == version) || (length != len - offsetof(uwb_config_record_t, payload)) ||
+       (configImage.record.crc != TKey_ObjStore_Crc32(0, payload, length)))
+    {
+        return (_ERR_Flash_Verify);
+    }
+
+    /* a newer version only appended fields we do not know */
+    if(length > UWB_CONFIG_PAYLOAD_SIZE)
+    {
+        length = UWB_CONFIG_PAYLOAD_SIZE;
+    }
+    memcpy(pcfg, payload, length);
+
+    for( ; version < UWB_CONFIG_VERSION; version++)
+    {
+        if(NULL != config_migrate[version])
+        {
+            config_migrate[version](pcfg);
+        }
+    }
+    return (_NO_ERR);
+}
 
 /* @fn      load_bssConfig
  * @brief   copy parameters from NVM to RAM structure.
  *
- *          assumes that memory model in the MCU of .text and .bss are the same
+ *          starts from the defaults and applies the saved parameters, if any
  * */
 void load_bssConfig(void)
 {
     memcpy(&tmpConfig, &FConfig, sizeof(tmpConfig));
+    (void)load_saved_config(&tmpConfig);
 }
 
 /* @fn      restore_bssConfig
- * @brief   copy parameters from default NVM section to RAM structure.
- *
- *          assumes that memory model in the MCU of .text and .bss are the same
+ * @brief   drops the saved parameters and reloads the defaults
  * */
 void restore_bssConfig(void)
 {
-#if 0 /* Disabling this flash write as we don't need it for digital key and it was causing issue when this
-        API is used with SoftDevice */
-    nrf_nvmc_page_erase((uint32_t)&FConfig);
-    nrf_nvmc_write_bytes((uint32_t)&FConfig,  (const uint8_t *)&defaultFConfig, FCONFIG_SIZE);
-#endif
+    (void)TKey_ObjStoreAsync_Delete(TKEY_OBJ_ID_UWB_CONFIG, NULL, NULL);
     load_bssConfig();
 }
 
 /* @brief    save pNewRamParametersBlock to FCONFIG_ADDR
+ *
+ *           the write is queued to the storage worker, so this can be
+ *           called from the command critical section
  * @return  _NO_ERR for success and error_e code otherwise
  * */
 error_e save_bssConfig(const param_block_t * pNewRamParametersBlock)
 {
-#if 0 /* Disabling this flash write as we don't need it for digital key and it was causing issue when this
-        API is used with SoftDevice */
-    nrf_nvmc_page_erase((uint32_t)&FConfig);
-    nrf_nvmc_write_bytes((uint32_t)&FConfig, (const uint8_t*)pNewRamParametersBlock, FCONFIG_SIZE);
-#endif
+    uwb_config_record_t *pRecord = &configImage.record;
+
+    pRecord->version = UWB_CONFIG_VERSION;
+    pRecord->length = UWB_CONFIG_PAYLOAD_SIZE;
+    memcpy(pRecord->payload, pNewRamParametersBlock, UWB_CONFIG_PAYLOAD_SIZE);
+    pRecord->crc = TKey_ObjStore_Crc32(0, pRecord->payload, UWB_CONFIG_PAYLOAD_SIZE);
+
+    if(E_TKEY_OBJSTORE_SUCCESS != TKey_ObjStoreAsync_Write(TKEY_OBJ_ID_UWB_CONFIG,
+                                       (const TKey_BYTE *)pRecord,
+                                       sizeof(*pRecord), NULL, NULL))
+    {
+        return (_ERR_Flash_Prog);
+    }
     return (_NO_ERR);
 }
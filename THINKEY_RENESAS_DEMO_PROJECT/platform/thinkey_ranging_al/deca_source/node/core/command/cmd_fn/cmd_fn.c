@@ -20,6 +20,7 @@
 #include "usb_uart_tx.h"
 #include "cmd.h"
 #include "deca_device_api.h"
+#include "thinkey_sysmon.h"
 
 #define CMD_COLUMN_WIDTH     10
 #define CMD_COLUMN_MAX       4
@@ -1262,6 +1263,24 @@ REG_FN(f_stat)
 }
 
 
+static void taskstat_line(const char *line)
+{
+    port_tx_msg((uint8_t*)line, strlen(line));
+}
+
+/**
+ * @brief show the CPU share and stack left of every task,
+ *           and the depth, peak and drops of every queue
+ *
+ * */
+REG_FN(f_taskstat)
+{
+    TKey_SysMon_Report(taskstat_line);
+
+    return (CMD_FN_RET_OK);
+}
+
+
 /**
  * @brief Show all available commands
  *
@@ -1514,6 +1533,7 @@ const char COMMENT_P2FDEL          []={"Time, \'us\',  when Tag shall transmit F
 
 const char COMMENT_STOP            []={"Stops running any top-level applications"};
 const char COMMENT_STAT            []={"Displays the Status information"};
+const char COMMENT_TASKSTAT        []={"Displays the CPU share and the stack left of each task since the last sample, and the depth, peak and drops of each queue"};
 const char COMMENT_SAVE            []={"Saves the configuration to the NVM"};
 const char COMMENT_DECAJUNIPER     []={"This command reports the running application and the version information"};
 const char COMMENT_HELP            []={"This command displays the help information. Usage: \"help\" or \"help <CMD>\", <CMD> is the command from the list, i.e. \"help tag\"."};
@@ -1583,6 +1603,7 @@ const struct command_s known_commands []= {
     {NULL,      mCmdGrp0 | mANY,   NULL ,                   COMMENT_ANYTIME_OPTIONS},
     {"STOP",    mCmdGrp1 | mANY,   f_stop,                  COMMENT_STOP },
     {"STAT",    mCmdGrp1 | mANY,   f_stat,                  COMMENT_STAT },
+    {"TASKSTAT",mCmdGrp1 | mANY,   f_taskstat,              COMMENT_TASKSTAT },
     {"SAVE",    mCmdGrp1 | mANY,   f_save,                  COMMENT_SAVE },
     {"DECA$",   mCmdGrp1 | mANY,   f_decaJuniper,           COMMENT_DECAJUNIPER },
     {"HELP",    mCmdGrp1 | mANY,   f_help_app,              COMMENT_HELP },
@@ -12,6 +12,7 @@
 #include "cmd_fn.h"
 #include "node.h"
 #include "usb_uart_tx.h"
+#include "thinkey_rtt.h"
 
 
 /*
@@ -140,11 +141,60 @@ error_e send_to_pc_listener_info(uint8_t *data, uint8_t size, uint8_t *ts, int16
  * used if any from below is true:
  * diag, acc,
  * */
+static uint8_t *put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_le32(uint8_t *p, uint32_t v)
+{
+    p = put_le16(p, (uint16_t)v);
+    return put_le16(p, (uint16_t)(v >> 16));
+}
+
+/*
+ * @brief binary TWR report record on the report RTT channel, see thinkey_rtt.h.
+ *        It is ~30 bytes against ~110 chars of the JSON object, and is
+ *        dropped rather than delaying the ranging when the channel is full.
+ * */
+static void send_to_pc_twr_record(result_t *pRes)
+{
+    uint8_t rec[TKEY_RTT_REPORT_TWR_SIZE];
+    uint8_t *p = rec;
+
+    p = put_le16(p, pRes->addr16);
+    p = put_le16(p, pRes->rangeNum);
+    p = put_le32(p, pRes->resTime_us);
+    p = put_le32(p, (uint32_t)(int32_t)pRes->dist_cm);
+    p = put_le32(p, (uint32_t)(int32_t)pRes->x_cm);
+    p = put_le32(p, (uint32_t)(int32_t)pRes->y_cm);
+    p = put_le16(p, (uint16_t)(int16_t)(pRes->pdoa_raw_deg * 100.0f));
+    p = put_le16(p, (uint16_t)(int16_t)(pRes->pdoa_raw_degP * 100.0f));
+    p = put_le16(p, (uint16_t)(int16_t)pRes->clockOffset_pphm);
+    p = put_le16(p, pRes->flag);
+    p = put_le16(p, (uint16_t)pRes->acc_x);
+    p = put_le16(p, (uint16_t)pRes->acc_y);
+    p = put_le16(p, (uint16_t)pRes->acc_z);
+
+    (void)TKey_Rtt_Report(TKEY_RTT_REPORT_TWR, rec, (uint32_t)(p - rec));
+    TKEY_TRACE(TKEY_TRACE_TWR_REPORT, pRes->rangeNum);
+}
+
 void send_to_pc_twr(result_t *pRes)
 {
-    char *str = CMD_MALLOC(MAX_STR_SIZE);
+    char *str;
     int  hlen;
 
+    if (app.pConfig->s.accEn ==1 || \
+        app.pConfig->s.diagEn ==1 || \
+        app.pConfig->s.reportLevel > 0)
+    {
+        send_to_pc_twr_record(pRes);
+    }
+
+    str = CMD_MALLOC(MAX_STR_SIZE);
     if(str)
     {
         if (app.pConfig->s.accEn ==1 || \
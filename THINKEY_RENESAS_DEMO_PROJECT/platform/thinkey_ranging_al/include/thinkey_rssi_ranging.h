@@ -0,0 +1,186 @@
+/*
+ * \file thinkey_rssi_ranging.h
+ *
+ * \brief BLE RSSI coarse ranging header file
+ *
+ * Turns the RSSI of the connection events of a key device, seen by one or
+ * more anchors (the vehicle's own radio and any BLE antennas reporting to
+ * it), into a coarse range and an approach confidence. It is meant to tell
+ * when a device is actually walking up to the vehicle, so UWB fine ranging
+ * is only started then.
+ *
+ * Each anchor filters its samples with a running median, against fades
+ * and body blocking, followed by an exponential average. The filtered RSSI
+ * is converted with the log-distance path loss model of the anchor,
+ *     range = 1 m * 10 ^ ((RSSI at 1 m - RSSI) / (10 * n)),
+ * and the anchors heard recently are fused with weights falling with the
+ * square of their range, as the model is far less precise at a distance.
+ * The trend of the fused range gives approach or departure.
+ *
+ * Results go to the callback given to TKey_RssiRanging_Init(), in the shape
+ * of the UWB ranging callback. All calls must come from one task.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_RSSI_RANGING_H
+#define THINKEY_RSSI_RANGING_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_types.h"
+
+/**
+ *  @brief Engine configuration
+ */
+#ifndef TKEY_RSSI_MAX_DEVICES
+#define TKEY_RSSI_MAX_DEVICES 4
+#endif
+#ifndef TKEY_RSSI_MAX_ANCHORS
+#define TKEY_RSSI_MAX_ANCHORS 4
+#endif
+#ifndef TKEY_RSSI_MEDIAN_WINDOW             /* samples, odd */
+#define TKEY_RSSI_MEDIAN_WINDOW 5
+#endif
+#ifndef TKEY_RSSI_EWMA_SHIFT                /* average weight 1 / 2^shift */
+#define TKEY_RSSI_EWMA_SHIFT 2
+#endif
+#ifndef TKEY_RSSI_STALE_MS                  /* anchor left out of the fusion */
+#define TKEY_RSSI_STALE_MS 2000
+#endif
+#ifndef TKEY_RSSI_TREND_MS                  /* range trend sampling period */
+#define TKEY_RSSI_TREND_MS 250
+#endif
+#ifndef TKEY_RSSI_REPORT_MS                 /* callback period without change */
+#define TKEY_RSSI_REPORT_MS 1000
+#endif
+#ifndef TKEY_RSSI_SPEED_MM_S                /* walking speed taken as a trend */
+#define TKEY_RSSI_SPEED_MM_S 300
+#endif
+#ifndef TKEY_RSSI_IMMEDIATE_MM
+#define TKEY_RSSI_IMMEDIATE_MM 1000
+#endif
+#ifndef TKEY_RSSI_NEAR_MM
+#define TKEY_RSSI_NEAR_MM 3000
+#endif
+#ifndef TKEY_RSSI_FAR_MM
+#define TKEY_RSSI_FAR_MM 8000
+#endif
+
+#if (TKEY_RSSI_MEDIAN_WINDOW & 1) == 0 || TKEY_RSSI_MEDIAN_WINDOW > 15
+#error "TKEY_RSSI_MEDIAN_WINDOW must be odd and at most 15"
+#endif
+#if TKEY_RSSI_IMMEDIATE_MM >= TKEY_RSSI_NEAR_MM || TKEY_RSSI_NEAR_MM >= TKEY_RSSI_FAR_MM
+#error "TKEY_RSSI_IMMEDIATE_MM < TKEY_RSSI_NEAR_MM < TKEY_RSSI_FAR_MM expected"
+#endif
+
+#define TKEY_RSSI_ANCHOR_LOCAL 0            /* the vehicle's own BLE radio */
+#define TKEY_RSSI_RANGE_MIN_MM 100
+#define TKEY_RSSI_RANGE_MAX_MM 100000
+
+/**
+ *  @brief RSSI ranging status codes
+ */
+typedef enum
+{
+    E_TKEY_RSSI_SUCCESS,
+    E_TKEY_RSSI_FAILURE,
+    E_TKEY_RSSI_INVALID_ARG,
+    E_TKEY_RSSI_NOT_FOUND,
+    E_TKEY_RSSI_FULL,
+    E_TKEY_RSSI_NO_ESTIMATE             /* not enough recent samples yet */
+} TKey_RssiStatus_t;
+
+/**
+ *  @brief Movement of a device relative to the vehicle
+ */
+typedef enum
+{
+    E_TKEY_RSSI_TREND_STEADY,
+    E_TKEY_RSSI_TREND_APPROACHING,
+    E_TKEY_RSSI_TREND_DEPARTING
+} TKey_RssiTrend_t;
+
+/**
+ *  @brief Path loss model of an anchor
+ */
+typedef struct
+{
+    TKey_INT16 sRssiAt1m;               /* dBm received from 1 m */
+    TKey_UINT16 usPathLossExp10;        /* exponent n, times 10 (20: free space) */
+    TKey_INT16 sOffset;                 /* dB added to each sample (antenna, cable) */
+} TKey_RssiCalib_t;
+
+#define TKEY_RSSI_CALIB_DEFAULT { -59, 20, 0 }
+
+/**
+ *  @brief Approach estimate of a device
+ */
+typedef struct
+{
+    TKey_DeviceApproachConfidence_t eConfidence;
+    TKey_RssiTrend_t eTrend;
+    TKey_INT32 iSpeedMmPerS;            /* range rate, negative approaching */
+    TKey_UINT32 uiRangeMm;              /* fused range */
+    TKey_UINT32 uiAnchorsUsed;
+} TKey_RssiApproach_t;
+
+/**
+ *  @brief Receives the estimate of a device: the range of each anchor
+ *         heard, the fused range and the approach confidence
+ */
+typedef TKey_VOID (*TKey_RssiRangingCB_t)(TKey_HANDLE hKeyHandle,
+        const TKey_AnchorRanges_t *psRanges, TKey_UINT32 uiRangeMm,
+        const TKey_RssiApproach_t *psApproach);
+
+/**
+ * \brief   Clears all devices and anchors and sets the result callback
+ */
+TKey_RssiStatus_t TKey_RssiRanging_Init(TKey_RssiRangingCB_t pfnRangingCB);
+
+/**
+ * \brief   Adds an anchor, or changes its path loss model
+ *
+ * \param   uiAnchorID      Anchor ID reported in TKey_RangeInfo_t
+ * \param   psCalib         Path loss model, TKey_NULL for the default
+ */
+TKey_RssiStatus_t TKey_RssiRanging_SetAnchor(TKey_UINT32 uiAnchorID,
+        const TKey_RssiCalib_t *psCalib);
+
+/**
+ * \brief   Derives the RSSI at 1 m of a path loss model from the average
+ *          RSSI measured at a known distance, keeping its exponent
+ */
+TKey_RssiStatus_t TKey_RssiRanging_Calibrate(TKey_RssiCalib_t *psCalib,
+        TKey_INT32 iRssiAvg, TKey_UINT32 uiDistanceMm);
+
+/**
+ * \brief   Starts ranging a device
+ *
+ * \param   hKeyHandle          Device, passed back to the callback
+ * \param   uiRangingGroupID    Reported in TKey_AnchorRanges_t
+ */
+TKey_RssiStatus_t TKey_RssiRanging_Start(TKey_HANDLE hKeyHandle,
+        TKey_UINT32 uiRangingGroupID);
+
+/**
+ * \brief   Stops ranging a device and forgets its samples
+ */
+TKey_RssiStatus_t TKey_RssiRanging_Stop(TKey_HANDLE hKeyHandle);
+
+/**
+ * \brief   Feeds one RSSI sample of a device seen by an anchor. May call
+ *          the result callback.
+ *
+ * \param   iRssi       dBm
+ * \param   uiNowMs     Time of the sample
+ */
+TKey_RssiStatus_t TKey_RssiRanging_AddSample(TKey_HANDLE hKeyHandle,
+        TKey_UINT32 uiAnchorID, TKey_INT32 iRssi, TKey_UINT32 uiNowMs);
+
+/**
+ * \brief   Returns the last estimate of a device
+ */
+TKey_RssiStatus_t TKey_RssiRanging_GetEstimate(TKey_HANDLE hKeyHandle,
+        TKey_RssiApproach_t *psApproach);
+
+#endif /* THINKEY_RSSI_RANGING_H */
@@ -4,9 +4,13 @@
  *  Created on: Nov 12, 2021
  *      Author: Adarsh
  */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_RANGING
+
 #include "thinkey_osal.h"
 #include "thinkey_debug.h"
 #include "thinkey_ral.h"
+#include "thinkey_rssi_ranging.h"
 
 
 
@@ -16,9 +20,28 @@ TKey_HANDLE ghRangingSSHandle;
 
 THINKey_BOOL bRangingInitDone = false;
 
+/* BLE RSSI estimate of a key device. UWB fine ranging is only worth
+ * starting once this says the device is coming close. */
+static TKey_VOID tkey_ral_rssi_ranging_cb(TKey_HANDLE hKeyHandle,
+        const TKey_AnchorRanges_t *psRanges, TKey_UINT32 uiRangeMm,
+        const TKey_RssiApproach_t *psApproach)
+{
+    (TKey_VOID)psRanges;
+    THINKEY_DEBUG_INFO("RSSI ranging %x: %d mm, %d mm/s, confidence %d",
+            (TKey_UINT32)hKeyHandle, uiRangeMm, psApproach->iSpeedMmPerS,
+            psApproach->eConfidence);
+//    if(E_TKEY_DEVICE_APPROACH_CONFIDENCE_HIGH == psApproach->eConfidence &&
+//       !bUwbRunning)
+//    {
+//        node_helper(NULL);
+//    }
+}
+
 THINKey_eStatusType THINKey_eRangingInit()
 {
     THINKey_UINT32 uiStatus = E_THINKEY_FAILURE;
+    TKey_RssiRanging_Init(tkey_ral_rssi_ranging_cb);
+    TKey_RssiRanging_SetAnchor(TKEY_RSSI_ANCHOR_LOCAL, TKey_NULL);
 //    THINKEY_DEBUG_INFO("THINKey_eRangingInit Entered\r\n");
 //    if(!bRangingInitDone)
 //    {
@@ -0,0 +1,474 @@
+/*
+ * \file thinkey_rssi_ranging.c
+ *
+ * \brief BLE RSSI coarse ranging
+ *
+ * Integer only. Filtered RSSI is kept in 1/16 dB. The path loss model is
+ * evaluated with a table of 10^(k/20), k = 0..20, interpolated linearly,
+ * which is within 0.3% of the exact range: far below the error of the
+ * model itself.
+ *
+ * The trend is the least squares slope of the fused log range over the
+ * last TKEY_RSSI_TREND_POINTS periods of TKEY_RSSI_TREND_MS. In the log
+ * domain the noise of a period does not grow with the range, so one slope
+ * threshold (TKEY_RSSI_TREND_MIN_SLOPE, relative) holds at any distance;
+ * the speed in mm/s must also exceed TKEY_RSSI_SPEED_MM_S.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_RANGING
+
+#include "thinkey_rssi_ranging.h"
+#include "thinkey_debug.h"
+#include <string.h>
+
+#define TKEY_RSSI_Q 16                      /* 1/16 dB */
+#define TKEY_RSSI_SAMPLE_MIN (-127)
+#define TKEY_RSSI_SAMPLE_MAX 20
+#define TKEY_RSSI_DECADE_MIN (-100)         /* hundredths of a decade: 0.1 m */
+#define TKEY_RSSI_DECADE_MAX 200            /* 100 m */
+#define TKEY_RSSI_TREND_POINTS 16           /* periods in the trend fit */
+#define TKEY_RSSI_TREND_MIN_SLOPE 60        /* milli-decades per second: 14 %/s */
+#define TKEY_RSSI_LN10_X100 230
+
+typedef struct
+{
+    TKey_INT16 asWindow[TKEY_RSSI_MEDIAN_WINDOW];
+    TKey_BYTE ucCount;
+    TKey_BYTE ucNext;
+    TKey_INT32 iFilteredQ;
+    TKey_UINT32 uiLastMs;
+    TKey_INT32 iDecade;                 /* log10 of the range, hundredths */
+    TKey_UINT32 uiRangeMm;
+} TKey_RssiAnchorTrack_t;
+
+typedef struct
+{
+    TKey_BOOL bUsed;
+    TKey_BOOL bEstimate;
+    TKey_HANDLE hKeyHandle;
+    TKey_UINT32 uiRangingGroupID;
+    TKey_RssiAnchorTrack_t asTrack[TKEY_RSSI_MAX_ANCHORS];
+    TKey_UINT32 uiPeriodStartMs;
+    TKey_INT32 iPeriodSum;
+    TKey_UINT32 uiPeriodCount;
+    TKey_INT32 aiTrend[TKEY_RSSI_TREND_POINTS]; /* period means of the fused log range */
+    TKey_UINT32 uiTrendCount;
+    TKey_UINT32 uiReportMs;
+    TKey_RssiApproach_t sApproach;
+    TKey_RangeInfo_t asRangeInfo[TKEY_RSSI_MAX_ANCHORS];
+} TKey_RssiDevice_t;
+
+typedef struct
+{
+    TKey_BOOL bUsed;
+    TKey_UINT32 uiAnchorID;
+    TKey_RssiCalib_t sCalib;
+} TKey_RssiAnchor_t;
+
+typedef struct
+{
+    TKey_RssiRangingCB_t pfnRangingCB;
+    TKey_RssiAnchor_t asAnchor[TKEY_RSSI_MAX_ANCHORS];
+    TKey_RssiDevice_t asDevice[TKEY_RSSI_MAX_DEVICES];
+} TKey_RssiRanging_t;
+
+static TKey_RssiRanging_t gsRssiRanging;
+
+/* 1000 * 10^(k/20) */
+static const TKey_UINT16 gausPow10[21] = {
+    1000, 1122, 1259, 1413, 1585, 1778, 1995, 2239, 2512, 2818, 3162,
+    3548, 3981, 4467, 5012, 5623, 6310, 7079, 7943, 8913, 10000
+};
+
+/* 1 m * 10^(iDecade / 100), in mm */
+static TKey_UINT32 tkey_rssi_pow10_mm(TKey_INT32 iDecade)
+{
+    TKey_INT32 iWhole;
+    TKey_INT32 iFrac;
+    TKey_UINT32 uiMant;
+
+    if(iDecade < TKEY_RSSI_DECADE_MIN) {
+        iDecade = TKEY_RSSI_DECADE_MIN;
+    } else if(iDecade > TKEY_RSSI_DECADE_MAX) {
+        iDecade = TKEY_RSSI_DECADE_MAX;
+    }
+    iWhole = (iDecade - TKEY_RSSI_DECADE_MIN) / 100 - 1;
+    iFrac = iDecade - iWhole * 100;
+    uiMant = gausPow10[iFrac / 5] +
+             (gausPow10[iFrac / 5 + 1] - gausPow10[iFrac / 5]) *
+             (TKey_UINT32)(iFrac % 5) / 5;
+    for(; iWhole > 0; iWhole--) {
+        uiMant *= 10;
+    }
+    return (iWhole < 0) ? (uiMant / 10) : uiMant;
+}
+
+/* log10 of the range in metres, in hundredths */
+static TKey_INT32 tkey_rssi_decade(const TKey_RssiCalib_t *psCalib,
+        TKey_INT32 iRssiQ)
+{
+    TKey_INT32 iLossQ = psCalib->sRssiAt1m * TKEY_RSSI_Q - iRssiQ;
+    TKey_INT32 iDen = TKEY_RSSI_Q * psCalib->usPathLossExp10;
+    TKey_INT32 iDecade;
+
+    /* (RSSI at 1 m - RSSI) / (10 n), rounded */
+    iDecade = (iLossQ * 100 + ((iLossQ < 0) ? -iDen / 2 : iDen / 2)) / iDen;
+    if(iDecade < TKEY_RSSI_DECADE_MIN) {
+        iDecade = TKEY_RSSI_DECADE_MIN;
+    } else if(iDecade > TKEY_RSSI_DECADE_MAX) {
+        iDecade = TKEY_RSSI_DECADE_MAX;
+    }
+    return iDecade;
+}
+
+static TKey_RssiAnchor_t* tkey_rssi_find_anchor(TKey_UINT32 uiAnchorID,
+        TKey_UINT32 *puiIndex)
+{
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < TKEY_RSSI_MAX_ANCHORS; uiIndex++) {
+        if(gsRssiRanging.asAnchor[uiIndex].bUsed &&
+           gsRssiRanging.asAnchor[uiIndex].uiAnchorID == uiAnchorID) {
+            *puiIndex = uiIndex;
+            return &gsRssiRanging.asAnchor[uiIndex];
+        }
+    }
+    return TKey_NULL;
+}
+
+static TKey_RssiDevice_t* tkey_rssi_find_device(TKey_HANDLE hKeyHandle)
+{
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < TKEY_RSSI_MAX_DEVICES; uiIndex++) {
+        if(gsRssiRanging.asDevice[uiIndex].bUsed &&
+           gsRssiRanging.asDevice[uiIndex].hKeyHandle == hKeyHandle) {
+            return &gsRssiRanging.asDevice[uiIndex];
+        }
+    }
+    return TKey_NULL;
+}
+
+static TKey_INT32 tkey_rssi_median(const TKey_RssiAnchorTrack_t *psTrack)
+{
+    TKey_INT16 asSorted[TKEY_RSSI_MEDIAN_WINDOW];
+    TKey_INT16 sValue;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiPos;
+
+    for(uiIndex = 0; uiIndex < psTrack->ucCount; uiIndex++) {
+        sValue = psTrack->asWindow[uiIndex];
+        for(uiPos = uiIndex; uiPos > 0 && asSorted[uiPos - 1] > sValue; uiPos--) {
+            asSorted[uiPos] = asSorted[uiPos - 1];
+        }
+        asSorted[uiPos] = sValue;
+    }
+    return asSorted[psTrack->ucCount / 2];
+}
+
+/* Weighted mean of the ranges heard within TKEY_RSSI_STALE_MS, and of
+   their logs in piDecade */
+static TKey_UINT32 tkey_rssi_fuse(TKey_RssiDevice_t *psDevice,
+        TKey_UINT32 uiNowMs, TKey_INT32 *piDecade)
+{
+    TKey_RssiAnchorTrack_t *psTrack;
+    TKey_UINT64 ullSum = 0;
+    TKey_UINT64 ullDecadeSum = 0;
+    TKey_UINT64 ullWeights = 0;
+    TKey_UINT64 ullWeight;
+    TKey_UINT32 uiRangeCm;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiUsed = 0;
+
+    for(uiIndex = 0; uiIndex < TKEY_RSSI_MAX_ANCHORS; uiIndex++) {
+        psTrack = &psDevice->asTrack[uiIndex];
+        if(!gsRssiRanging.asAnchor[uiIndex].bUsed || 0 == psTrack->ucCount ||
+           uiNowMs - psTrack->uiLastMs > TKEY_RSSI_STALE_MS) {
+            continue;
+        }
+        uiRangeCm = psTrack->uiRangeMm / 10;
+        ullWeight = (1ULL << 40) / ((TKey_UINT64)uiRangeCm * uiRangeCm);
+        ullSum += ullWeight * psTrack->uiRangeMm;
+        ullDecadeSum += ullWeight * (TKey_UINT32)(psTrack->iDecade - TKEY_RSSI_DECADE_MIN);
+        ullWeights += ullWeight;
+        psDevice->asRangeInfo[uiUsed].uiAnchorID =
+                gsRssiRanging.asAnchor[uiIndex].uiAnchorID;
+        psDevice->asRangeInfo[uiUsed].uiRange = psTrack->uiRangeMm;
+        psDevice->asRangeInfo[uiUsed].iAngleOfArrival = 0;
+        uiUsed++;
+    }
+    psDevice->sApproach.uiAnchorsUsed = uiUsed;
+    if(0 == uiUsed) {
+        return 0;
+    }
+    *piDecade = (TKey_INT32)(ullDecadeSum / ullWeights) + TKEY_RSSI_DECADE_MIN;
+    return (TKey_UINT32)(ullSum / ullWeights);
+}
+
+static TKey_VOID tkey_rssi_trend(TKey_RssiDevice_t *psDevice,
+        TKey_INT32 iDecade, TKey_UINT32 uiRangeMm, TKey_UINT32 uiNowMs)
+{
+    TKey_RssiApproach_t *psApproach = &psDevice->sApproach;
+    TKey_UINT32 uiElapsed = uiNowMs - psDevice->uiPeriodStartMs;
+    TKey_INT32 iSlope = 0;
+    TKey_INT32 iWeight;
+    TKey_UINT32 uiIndex;
+
+    psDevice->iPeriodSum += iDecade;
+    psDevice->uiPeriodCount++;
+    if(uiElapsed < TKEY_RSSI_TREND_MS) {
+        return;
+    }
+    memmove(&psDevice->aiTrend[0], &psDevice->aiTrend[1],
+            sizeof(psDevice->aiTrend) - sizeof(psDevice->aiTrend[0]));
+    /* In thousandths of a decade */
+    psDevice->aiTrend[TKEY_RSSI_TREND_POINTS - 1] =
+            psDevice->iPeriodSum * 10 / (TKey_INT32)psDevice->uiPeriodCount;
+    psDevice->uiPeriodStartMs = uiNowMs;
+    psDevice->iPeriodSum = 0;
+    psDevice->uiPeriodCount = 0;
+    if(psDevice->uiTrendCount < TKEY_RSSI_TREND_POINTS) {
+        psDevice->uiTrendCount++;
+        return;
+    }
+
+    /* Least squares slope over equally spaced periods, per second */
+    for(uiIndex = 0; uiIndex < TKEY_RSSI_TREND_POINTS; uiIndex++) {
+        iWeight = 2 * (TKey_INT32)uiIndex - (TKEY_RSSI_TREND_POINTS - 1);
+        iSlope += iWeight * psDevice->aiTrend[uiIndex];
+    }
+    iSlope = iSlope * 6 * 1000 / (TKEY_RSSI_TREND_POINTS *
+             (TKEY_RSSI_TREND_POINTS * TKEY_RSSI_TREND_POINTS - 1) * TKEY_RSSI_TREND_MS);
+    /* d(range)/dt = range * ln(10) * d(log10 range)/dt */
+    psApproach->iSpeedMmPerS = iSlope * (TKey_INT32)(uiRangeMm / 100) *
+                               TKEY_RSSI_LN10_X100 / 1000;
+
+    /* Half the thresholds to leave a trend, so it does not flicker */
+    if((E_TKEY_RSSI_TREND_APPROACHING == psApproach->eTrend &&
+        (iSlope > -TKEY_RSSI_TREND_MIN_SLOPE / 2 ||
+         psApproach->iSpeedMmPerS > -TKEY_RSSI_SPEED_MM_S / 2)) ||
+       (E_TKEY_RSSI_TREND_DEPARTING == psApproach->eTrend &&
+        (iSlope < TKEY_RSSI_TREND_MIN_SLOPE / 2 ||
+         psApproach->iSpeedMmPerS < TKEY_RSSI_SPEED_MM_S / 2))) {
+        psApproach->eTrend = E_TKEY_RSSI_TREND_STEADY;
+    }
+    if(iSlope <= -TKEY_RSSI_TREND_MIN_SLOPE &&
+       psApproach->iSpeedMmPerS <= -TKEY_RSSI_SPEED_MM_S) {
+        psApproach->eTrend = E_TKEY_RSSI_TREND_APPROACHING;
+    } else if(iSlope >= TKEY_RSSI_TREND_MIN_SLOPE &&
+              psApproach->iSpeedMmPerS >= TKEY_RSSI_SPEED_MM_S) {
+        psApproach->eTrend = E_TKEY_RSSI_TREND_DEPARTING;
+    }
+}
+
+/* A level is kept until the range is a quarter past its threshold */
+static TKey_DeviceApproachConfidence_t tkey_rssi_confidence(
+        const TKey_RssiApproach_t *psApproach)
+{
+    TKey_UINT32 uiRange = psApproach->uiRangeMm;
+    TKey_UINT32 uiNear = TKEY_RSSI_NEAR_MM;
+    TKey_UINT32 uiFar = TKEY_RSSI_FAR_MM;
+
+    if(E_TKEY_DEVICE_APPROACH_CONFIDENCE_HIGH == psApproach->eConfidence) {
+        uiNear += TKEY_RSSI_NEAR_MM / 4;
+    } else if(E_TKEY_DEVICE_APPROACH_CONFIDENCE_MEDIUM == psApproach->eConfidence) {
+        uiFar += TKEY_RSSI_FAR_MM / 4;
+    }
+    if(uiRange <= TKEY_RSSI_IMMEDIATE_MM ||
+       (uiRange <= uiNear && E_TKEY_RSSI_TREND_DEPARTING != psApproach->eTrend)) {
+        return E_TKEY_DEVICE_APPROACH_CONFIDENCE_HIGH;
+    }
+    if(uiRange <= uiNear ||
+       (uiRange <= uiFar && E_TKEY_RSSI_TREND_APPROACHING == psApproach->eTrend)) {
+        return E_TKEY_DEVICE_APPROACH_CONFIDENCE_MEDIUM;
+    }
+    return E_TKEY_DEVICE_APPROACH_CONFIDENCE_LOW;
+}
+
+TKey_RssiStatus_t TKey_RssiRanging_Init(TKey_RssiRangingCB_t pfnRangingCB)
+{
+    if(TKey_NULL == pfnRangingCB) {
+        return E_TKEY_RSSI_INVALID_ARG;
+    }
+    memset(&gsRssiRanging, 0, sizeof(gsRssiRanging));
+    gsRssiRanging.pfnRangingCB = pfnRangingCB;
+    return E_TKEY_RSSI_SUCCESS;
+}
+
+TKey_RssiStatus_t TKey_RssiRanging_SetAnchor(TKey_UINT32 uiAnchorID,
+        const TKey_RssiCalib_t *psCalib)
+{
+    const TKey_RssiCalib_t sDefault = TKEY_RSSI_CALIB_DEFAULT;
+    TKey_RssiAnchor_t *psAnchor;
+    TKey_UINT32 uiIndex;
+
+    if(TKey_NULL == psCalib) {
+        psCalib = &sDefault;
+    }
+    if(0 == psCalib->usPathLossExp10) {
+        return E_TKEY_RSSI_INVALID_ARG;
+    }
+    psAnchor = tkey_rssi_find_anchor(uiAnchorID, &uiIndex);
+    if(TKey_NULL == psAnchor) {
+        for(uiIndex = 0; uiIndex < TKEY_RSSI_MAX_ANCHORS; uiIndex++) {
+            if(!gsRssiRanging.asAnchor[uiIndex].bUsed) {
+                break;
+            }
+        }
+        if(TKEY_RSSI_MAX_ANCHORS == uiIndex) {
+            return E_TKEY_RSSI_FULL;
+        }
+        psAnchor = &gsRssiRanging.asAnchor[uiIndex];
+        psAnchor->bUsed = TKey_TRUE;
+        psAnchor->uiAnchorID = uiAnchorID;
+    }
+    psAnchor->sCalib = *psCalib;
+    return E_TKEY_RSSI_SUCCESS;
+}
+
+TKey_RssiStatus_t TKey_RssiRanging_Calibrate(TKey_RssiCalib_t *psCalib,
+        TKey_INT32 iRssiAvg, TKey_UINT32 uiDistanceMm)
+{
+    TKey_INT32 iDecade = TKEY_RSSI_DECADE_MIN;
+
+    if(TKey_NULL == psCalib || 0 == psCalib->usPathLossExp10 ||
+       uiDistanceMm < TKEY_RSSI_RANGE_MIN_MM || uiDistanceMm > TKEY_RSSI_RANGE_MAX_MM) {
+        return E_TKEY_RSSI_INVALID_ARG;
+    }
+    /* log10 of the distance in metres, from the table */
+    while(iDecade < TKEY_RSSI_DECADE_MAX &&
+          tkey_rssi_pow10_mm(iDecade + 1) <= uiDistanceMm) {
+        iDecade++;
+    }
+    /* RSSI at 1 m = RSSI + 10 n log10(d / 1 m) */
+    psCalib->sRssiAt1m = (TKey_INT16)(iRssiAvg - psCalib->sOffset +
+            (psCalib->usPathLossExp10 * iDecade + ((iDecade < 0) ? -50 : 50)) / 100);
+    return E_TKEY_RSSI_SUCCESS;
+}
+
+TKey_RssiStatus_t TKey_RssiRanging_Start(TKey_HANDLE hKeyHandle,
+        TKey_UINT32 uiRangingGroupID)
+{
+    TKey_RssiDevice_t *psDevice = tkey_rssi_find_device(hKeyHandle);
+    TKey_UINT32 uiIndex;
+
+    if(TKey_NULL == gsRssiRanging.pfnRangingCB) {
+        return E_TKEY_RSSI_FAILURE;
+    }
+    if(TKey_NULL == psDevice) {
+        for(uiIndex = 0; uiIndex < TKEY_RSSI_MAX_DEVICES; uiIndex++) {
+            if(!gsRssiRanging.asDevice[uiIndex].bUsed) {
+                psDevice = &gsRssiRanging.asDevice[uiIndex];
+                break;
+            }
+        }
+        if(TKey_NULL == psDevice) {
+            return E_TKEY_RSSI_FULL;
+        }
+    }
+    memset(psDevice, 0, sizeof(*psDevice));
+    psDevice->bUsed = TKey_TRUE;
+    psDevice->hKeyHandle = hKeyHandle;
+    psDevice->uiRangingGroupID = uiRangingGroupID;
+    psDevice->sApproach.eConfidence = E_TKEY_DEVICE_APPROACH_CONFIDENCE_LOW;
+    psDevice->sApproach.eTrend = E_TKEY_RSSI_TREND_STEADY;
+    return E_TKEY_RSSI_SUCCESS;
+}
+
+TKey_RssiStatus_t TKey_RssiRanging_Stop(TKey_HANDLE hKeyHandle)
+{
+    TKey_RssiDevice_t *psDevice = tkey_rssi_find_device(hKeyHandle);
+
+    if(TKey_NULL == psDevice) {
+        return E_TKEY_RSSI_NOT_FOUND;
+    }
+    psDevice->bUsed = TKey_FALSE;
+    return E_TKEY_RSSI_SUCCESS;
+}
+
+TKey_RssiStatus_t TKey_RssiRanging_AddSample(TKey_HANDLE hKeyHandle,
+        TKey_UINT32 uiAnchorID, TKey_INT32 iRssi, TKey_UINT32 uiNowMs)
+{
+    TKey_RssiDevice_t *psDevice = tkey_rssi_find_device(hKeyHandle);
+    TKey_RssiApproach_t *psApproach;
+    TKey_RssiAnchorTrack_t *psTrack;
+    TKey_RssiAnchor_t *psAnchor;
+    TKey_DeviceApproachConfidence_t eConfidence;
+    TKey_RssiTrend_t eTrend;
+    TKey_AnchorRanges_t sRanges;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiRange;
+    TKey_INT32 iDecade = 0;
+
+    if(TKey_NULL == psDevice) {
+        return E_TKEY_RSSI_NOT_FOUND;
+    }
+    psAnchor = tkey_rssi_find_anchor(uiAnchorID, &uiIndex);
+    if(TKey_NULL == psAnchor) {
+        return E_TKEY_RSSI_NOT_FOUND;
+    }
+    iRssi += psAnchor->sCalib.sOffset;
+    if(iRssi < TKEY_RSSI_SAMPLE_MIN) {
+        iRssi = TKEY_RSSI_SAMPLE_MIN;
+    } else if(iRssi > TKEY_RSSI_SAMPLE_MAX) {
+        iRssi = TKEY_RSSI_SAMPLE_MAX;
+    }
+
+    psTrack = &psDevice->asTrack[uiIndex];
+    psTrack->asWindow[psTrack->ucNext] = (TKey_INT16)iRssi;
+    psTrack->ucNext = (psTrack->ucNext + 1) % TKEY_RSSI_MEDIAN_WINDOW;
+    if(0 == psTrack->ucCount) {
+        psTrack->iFilteredQ = iRssi * TKEY_RSSI_Q;
+    }
+    if(psTrack->ucCount < TKEY_RSSI_MEDIAN_WINDOW) {
+        psTrack->ucCount++;
+    }
+    psTrack->iFilteredQ += (tkey_rssi_median(psTrack) * TKEY_RSSI_Q -
+                            psTrack->iFilteredQ) / (1 << TKEY_RSSI_EWMA_SHIFT);
+    psTrack->uiLastMs = uiNowMs;
+    psTrack->iDecade = tkey_rssi_decade(&psAnchor->sCalib, psTrack->iFilteredQ);
+    psTrack->uiRangeMm = tkey_rssi_pow10_mm(psTrack->iDecade);
+
+    uiRange = tkey_rssi_fuse(psDevice, uiNowMs, &iDecade);
+    psApproach = &psDevice->sApproach;
+    eConfidence = psApproach->eConfidence;
+    eTrend = psApproach->eTrend;
+    if(!psDevice->bEstimate) {
+        psDevice->bEstimate = TKey_TRUE;
+        psDevice->uiPeriodStartMs = uiNowMs;
+        psDevice->uiReportMs = uiNowMs - TKEY_RSSI_REPORT_MS;
+    }
+    tkey_rssi_trend(psDevice, iDecade, uiRange, uiNowMs);
+    psApproach->uiRangeMm = uiRange;
+    psApproach->eConfidence = tkey_rssi_confidence(psApproach);
+
+    /* Report changes at once, otherwise every TKEY_RSSI_REPORT_MS */
+    if(eConfidence == psApproach->eConfidence && eTrend == psApproach->eTrend &&
+       uiNowMs - psDevice->uiReportMs < TKEY_RSSI_REPORT_MS) {
+        return E_TKEY_RSSI_SUCCESS;
+    }
+    psDevice->uiReportMs = uiNowMs;
+    sRanges.uiNumAnchors = psApproach->uiAnchorsUsed;
+    sRanges.uiRangingGroupID = psDevice->uiRangingGroupID;
+    sRanges.psRangeInfo = psDevice->asRangeInfo;
+    gsRssiRanging.pfnRangingCB(hKeyHandle, &sRanges, uiRange, psApproach);
+    return E_TKEY_RSSI_SUCCESS;
+}
+
+TKey_RssiStatus_t TKey_RssiRanging_GetEstimate(TKey_HANDLE hKeyHandle,
+        TKey_RssiApproach_t *psApproach)
+{
+    TKey_RssiDevice_t *psDevice = tkey_rssi_find_device(hKeyHandle);
+
+    if(TKey_NULL == psDevice || TKey_NULL == psApproach) {
+        return (TKey_NULL == psDevice) ? E_TKEY_RSSI_NOT_FOUND : E_TKEY_RSSI_INVALID_ARG;
+    }
+    if(!psDevice->bEstimate) {
+        return E_TKEY_RSSI_NO_ESTIMATE;
+    }
+    *psApproach = psDevice->sApproach;
+    return E_TKEY_RSSI_SUCCESS;
+}
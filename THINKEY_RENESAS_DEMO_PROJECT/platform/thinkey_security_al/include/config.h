@@ -1363,7 +1363,21 @@
  * \warning This interface is experimental and may change or be removed
  * without notice.
  */
-//#define MBEDTLS_PSA_CRYPTO_DRIVERS
+#define MBEDTLS_PSA_CRYPTO_DRIVERS
+
+/** \def TKEY_PSA_CRYPTO_DRIVER
+ *
+ * Route PSA P-256 ECDSA operations through the THINKey crypto driver layer
+ * (thinkey_crypto_drv.h): registered accelerators for local keys, and the
+ * THINKey opaque driver for keys in the TKEY_PSA_CRYPTO_LOCATION location.
+ * With MBEDTLS_PSA_CRYPTO_EXTERNAL_RNG it also supplies
+ * mbedtls_psa_external_get_random() from TKey_Crypto_Random(), so the
+ * random source must be set with TKey_Crypto_SetRng() before
+ * psa_crypto_init().
+ *
+ * Requires: MBEDTLS_PSA_CRYPTO_DRIVERS
+ */
+#define TKEY_PSA_CRYPTO_DRIVER
 
 /** \def MBEDTLS_PSA_CRYPTO_EXTERNAL_RNG
  *
@@ -1401,7 +1415,7 @@
  *
  * \note This option is experimental and may be removed without notice.
  */
-//#define MBEDTLS_PSA_CRYPTO_EXTERNAL_RNG
+#define MBEDTLS_PSA_CRYPTO_EXTERNAL_RNG
 
 /**
  * \def MBEDTLS_PSA_CRYPTO_SPM
@@ -3190,7 +3204,7 @@
  *           or MBEDTLS_PSA_CRYPTO_EXTERNAL_RNG.
  *
  */
-//#define MBEDTLS_PSA_CRYPTO_C
+#define MBEDTLS_PSA_CRYPTO_C
 
 /**
  * \def MBEDTLS_PSA_CRYPTO_SE_C
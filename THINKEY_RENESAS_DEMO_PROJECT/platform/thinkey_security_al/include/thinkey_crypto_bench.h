@@ -0,0 +1,47 @@
+/*
+ * \file thinkey_crypto_bench.h
+ *
+ * \brief Header file for the crypto micro-benchmark suite
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_CRYPTO_BENCH_H
+#define THINKEY_CRYPTO_BENCH_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+/**
+ *  @brief Number of result rows produced by one benchmark run
+ */
+#define TKEY_CRYPTO_BENCH_MAX_RESULTS 20
+
+/**
+ *  @brief Default iteration count for symmetric cases. Public key cases
+ *         run TKEY_CRYPTO_BENCH_PK_DIVISOR times fewer iterations.
+ */
+#ifndef TKEY_CRYPTO_BENCH_ITERATIONS
+#define TKEY_CRYPTO_BENCH_ITERATIONS 200
+#endif
+#ifndef TKEY_CRYPTO_BENCH_PK_DIVISOR
+#define TKEY_CRYPTO_BENCH_PK_DIVISOR 20
+#endif
+
+/**
+ * \brief   Runs every crypto benchmark case through the TKey_Crypto API,
+ *          so registered accelerator drivers are measured as well.
+ *          Returns the number of results written to psResults.
+ */
+TKey_UINT32 TKey_CryptoBench_Run(TKey_BenchResult_t *psResults,
+                                 TKey_UINT32 uiMaxResults,
+                                 TKey_UINT32 uiIterations);
+
+/**
+ * \brief   Runs the suite and emits the CSV table through pfnPrint.
+ *          Returns 0 when every case succeeded.
+ */
+TKey_INT32 TKey_CryptoBench_Report(TKey_BenchPrint_t pfnPrint,
+                                   TKey_UINT32 uiIterations);
+
+#endif /* THINKEY_CRYPTO_BENCH_H */
@@ -0,0 +1,291 @@
+/*
+ * \file thinkey_crypto_drv.h
+ *
+ * \brief Header file for the THINKey crypto driver layer
+ *
+ * The crypto driver layer routes the THINKey transaction crypto
+ * (AES-CCM, CMAC, HKDF, ECDH, ECDSA) to pluggable drivers. Two driver
+ * kinds are supported, mirroring the PSA driver model:
+ *
+ *  - Transparent drivers operate on plain key material supplied by the
+ *    caller (e.g. a hardware AES/ECC engine). They are tried in
+ *    registration order and the software reference driver is always the
+ *    last fallback.
+ *  - Opaque drivers own their key material (e.g. a secure element or a
+ *    protected key store) and are addressed through a key reference.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_CRYPTO_DRV_H
+#define THINKEY_CRYPTO_DRV_H
+
+#include <stddef.h>
+#include "thinkey_platform_types.h"
+
+/**
+ *  @brief Crypto driver layer configuration
+ */
+#ifndef TKEY_CRYPTO_MAX_TRANSPARENT_DRIVERS
+#define TKEY_CRYPTO_MAX_TRANSPARENT_DRIVERS 2
+#endif
+#ifndef TKEY_CRYPTO_MAX_OPAQUE_DRIVERS
+#define TKEY_CRYPTO_MAX_OPAQUE_DRIVERS 2
+#endif
+#ifndef TKEY_CRYPTO_SW_KEY_SLOTS
+#define TKEY_CRYPTO_SW_KEY_SLOTS 8
+#endif
+
+/**
+ *  @brief Sizes used by the crypto driver API
+ */
+#define TKEY_CRYPTO_AES_BLOCK_SIZE      16
+#define TKEY_CRYPTO_AES128_KEY_SIZE     16
+#define TKEY_CRYPTO_AES256_KEY_SIZE     32
+#define TKEY_CRYPTO_CMAC_SIZE           16
+#define TKEY_CRYPTO_SHA256_SIZE         32
+#define TKEY_CRYPTO_P256_PRIV_KEY_SIZE  32
+#define TKEY_CRYPTO_P256_PUB_KEY_SIZE   65  /* 0x04 || X || Y */
+#define TKEY_CRYPTO_P256_SECRET_SIZE    32
+#define TKEY_CRYPTO_P256_SIG_SIZE       64  /* R || S */
+
+/**
+ *  @brief Driver identifiers. 0 is reserved for "no driver".
+ */
+#define TKEY_CRYPTO_DRIVER_ID_NONE      0
+#define TKEY_CRYPTO_DRIVER_ID_SW        1
+#define TKEY_CRYPTO_DRIVER_ID_SW_OPAQUE 2
+
+/**
+ *  @brief Crypto driver status codes
+ */
+typedef enum
+{
+    E_TKEY_CRYPTO_SUCCESS,
+    E_TKEY_CRYPTO_FAILURE,
+    E_TKEY_CRYPTO_NOT_SUPPORTED,
+    E_TKEY_CRYPTO_INVALID_ARG,
+    E_TKEY_CRYPTO_AUTH_FAILED,
+    E_TKEY_CRYPTO_NO_MEMORY
+} TKey_CryptoStatus_t;
+
+/**
+ *  @brief Location of the key material behind a key reference
+ */
+typedef enum
+{
+    E_TKEY_CRYPTO_KEY_LOCAL,
+    E_TKEY_CRYPTO_KEY_OPAQUE
+} TKey_CryptoKeyLocation_t;
+
+/**
+ *  @brief Key types understood by the crypto drivers
+ */
+typedef enum
+{
+    E_TKEY_CRYPTO_KEY_AES,
+    E_TKEY_CRYPTO_KEY_P256_PRIVATE
+} TKey_CryptoKeyType_t;
+
+/**
+ *  @brief Key reference passed to the keyed crypto operations.
+ *         Local keys carry plain key material in pucKey/uiKeyLen; opaque
+ *         keys are identified by the owning driver and its slot number.
+ */
+typedef struct
+{
+    TKey_CryptoKeyLocation_t eLocation;
+    TKey_CryptoKeyType_t eType;
+    TKey_UINT32 uiDriverId;
+    TKey_UINT32 uiSlot;
+    const TKey_BYTE *pucKey;
+    TKey_UINT32 uiKeyLen;
+} TKey_CryptoKey_t;
+
+/**
+ *  @brief Random number generator callback, mbedtls f_rng compatible
+ */
+typedef int (*TKey_CryptoRng_t)(TKey_VOID *pvCtx, unsigned char *pucOut,
+                                size_t uiLen);
+
+/**
+ *  @brief Transparent driver operations. Any entry may be NULL, or may
+ *         return E_TKEY_CRYPTO_NOT_SUPPORTED for parameters it cannot
+ *         handle, in which case the next driver is tried.
+ */
+typedef struct
+{
+    const TKey_CHAR *pcName;
+    TKey_UINT32 uiDriverId;
+
+    TKey_CryptoStatus_t (*eAesEcbEncrypt)(const TKey_BYTE *pucKey,
+            TKey_UINT32 uiKeyLen, const TKey_BYTE *pucIn, TKey_BYTE *pucOut);
+    TKey_CryptoStatus_t (*eAesCcmEncrypt)(const TKey_BYTE *pucKey,
+            TKey_UINT32 uiKeyLen, const TKey_BYTE *pucNonce,
+            TKey_UINT32 uiNonceLen, const TKey_BYTE *pucAad,
+            TKey_UINT32 uiAadLen, const TKey_BYTE *pucIn, TKey_UINT32 uiLen,
+            TKey_BYTE *pucOut, TKey_BYTE *pucTag, TKey_UINT32 uiTagLen);
+    TKey_CryptoStatus_t (*eAesCcmDecrypt)(const TKey_BYTE *pucKey,
+            TKey_UINT32 uiKeyLen, const TKey_BYTE *pucNonce,
+            TKey_UINT32 uiNonceLen, const TKey_BYTE *pucAad,
+            TKey_UINT32 uiAadLen, const TKey_BYTE *pucIn, TKey_UINT32 uiLen,
+            TKey_BYTE *pucOut, const TKey_BYTE *pucTag, TKey_UINT32 uiTagLen);
+    TKey_CryptoStatus_t (*eAesCmac)(const TKey_BYTE *pucKey,
+            TKey_UINT32 uiKeyLen, const TKey_BYTE *pucMsg, TKey_UINT32 uiLen,
+            TKey_BYTE *pucMac);
+    TKey_CryptoStatus_t (*eSha256)(const TKey_BYTE *pucMsg, TKey_UINT32 uiLen,
+            TKey_BYTE *pucDigest);
+    TKey_CryptoStatus_t (*eHkdfSha256)(const TKey_BYTE *pucSalt,
+            TKey_UINT32 uiSaltLen, const TKey_BYTE *pucIkm,
+            TKey_UINT32 uiIkmLen, const TKey_BYTE *pucInfo,
+            TKey_UINT32 uiInfoLen, TKey_BYTE *pucOkm, TKey_UINT32 uiOkmLen);
+    TKey_CryptoStatus_t (*eEcP256PublicKey)(const TKey_BYTE *pucPriv,
+            TKey_BYTE *pucPub);
+    TKey_CryptoStatus_t (*eEcdhP256)(const TKey_BYTE *pucPriv,
+            const TKey_BYTE *pucPeerPub, TKey_BYTE *pucSecret);
+    TKey_CryptoStatus_t (*eEcdsaP256Sign)(const TKey_BYTE *pucPriv,
+            const TKey_BYTE *pucHash, TKey_BYTE *pucSig);
+    TKey_CryptoStatus_t (*eEcdsaP256Verify)(const TKey_BYTE *pucPub,
+            const TKey_BYTE *pucHash, const TKey_BYTE *pucSig);
+} TKey_CryptoTransparentDrv_t;
+
+/**
+ *  @brief Opaque driver operations. Keys never leave the driver; the
+ *         driver hands back a slot number on import/generate.
+ */
+typedef struct
+{
+    const TKey_CHAR *pcName;
+    TKey_UINT32 uiDriverId;
+
+    TKey_CryptoStatus_t (*eImportKey)(TKey_CryptoKeyType_t eType,
+            const TKey_BYTE *pucKey, TKey_UINT32 uiKeyLen,
+            TKey_UINT32 *puiSlot);
+    TKey_CryptoStatus_t (*eGenerateKey)(TKey_CryptoKeyType_t eType,
+            TKey_UINT32 uiKeyLen, TKey_UINT32 *puiSlot);
+    TKey_CryptoStatus_t (*eDestroyKey)(TKey_UINT32 uiSlot);
+    TKey_CryptoStatus_t (*eExportPublicKey)(TKey_UINT32 uiSlot,
+            TKey_BYTE *pucPub);
+    TKey_CryptoStatus_t (*eAesCcmEncrypt)(TKey_UINT32 uiSlot,
+            const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+            const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+            const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+            TKey_BYTE *pucTag, TKey_UINT32 uiTagLen);
+    TKey_CryptoStatus_t (*eAesCcmDecrypt)(TKey_UINT32 uiSlot,
+            const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+            const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+            const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+            const TKey_BYTE *pucTag, TKey_UINT32 uiTagLen);
+    TKey_CryptoStatus_t (*eAesCmac)(TKey_UINT32 uiSlot,
+            const TKey_BYTE *pucMsg, TKey_UINT32 uiLen, TKey_BYTE *pucMac);
+    TKey_CryptoStatus_t (*eEcdhP256)(TKey_UINT32 uiSlot,
+            const TKey_BYTE *pucPeerPub, TKey_BYTE *pucSecret);
+    TKey_CryptoStatus_t (*eEcdsaP256Sign)(TKey_UINT32 uiSlot,
+            const TKey_BYTE *pucHash, TKey_BYTE *pucSig);
+} TKey_CryptoOpaqueDrv_t;
+
+/**
+ * \brief   Initialises the crypto driver layer and registers the software
+ *          reference drivers. Accelerator drivers are registered after
+ *          this call and before any crypto operation is issued.
+ */
+TKey_StatusType TKey_Crypto_Init(TKey_VOID);
+
+/**
+ * \brief   Registers a transparent (accelerator) driver. Registered
+ *          drivers are tried in order ahead of the software driver.
+ */
+TKey_CryptoStatus_t TKey_Crypto_RegisterTransparentDriver(
+        const TKey_CryptoTransparentDrv_t *psDriver);
+
+/**
+ * \brief   Registers an opaque driver, addressed by its uiDriverId.
+ */
+TKey_CryptoStatus_t TKey_Crypto_RegisterOpaqueDriver(
+        const TKey_CryptoOpaqueDrv_t *psDriver);
+
+/**
+ * \brief   Returns the transparent driver at uiIndex in dispatch order,
+ *          the software driver being last. Returns TKey_NULL past the end.
+ */
+const TKey_CryptoTransparentDrv_t* TKey_Crypto_GetTransparentDriver(
+        TKey_UINT32 uiIndex);
+
+/**
+ * \brief   Returns the opaque driver registered with uiDriverId.
+ */
+const TKey_CryptoOpaqueDrv_t* TKey_Crypto_GetOpaqueDriver(
+        TKey_UINT32 uiDriverId);
+
+/**
+ * \brief   Sets the random source used for key generation and signature
+ *          blinding where a driver needs one.
+ */
+TKey_VOID TKey_Crypto_SetRng(TKey_CryptoRng_t pfnRng, TKey_VOID *pvRngCtx);
+
+/**
+ * \brief   Fills pucOut with uiLen random bytes from the configured source.
+ */
+TKey_CryptoStatus_t TKey_Crypto_Random(TKey_BYTE *pucOut, TKey_UINT32 uiLen);
+
+/**
+ * \brief   Key reference helpers
+ */
+TKey_VOID TKey_Crypto_SetLocalKey(TKey_CryptoKey_t *psKey,
+        TKey_CryptoKeyType_t eType, const TKey_BYTE *pucKey,
+        TKey_UINT32 uiKeyLen);
+TKey_CryptoStatus_t TKey_Crypto_ImportKey(TKey_UINT32 uiDriverId,
+        TKey_CryptoKeyType_t eType, const TKey_BYTE *pucKey,
+        TKey_UINT32 uiKeyLen, TKey_CryptoKey_t *psKey);
+TKey_CryptoStatus_t TKey_Crypto_GenerateKey(TKey_UINT32 uiDriverId,
+        TKey_CryptoKeyType_t eType, TKey_UINT32 uiKeyLen,
+        TKey_CryptoKey_t *psKey);
+TKey_CryptoStatus_t TKey_Crypto_DestroyKey(TKey_CryptoKey_t *psKey);
+
+/**
+ * \brief   Crypto operations dispatched to the registered drivers
+ */
+TKey_CryptoStatus_t TKey_Crypto_AesEcbEncrypt(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucIn, TKey_BYTE *pucOut);
+TKey_CryptoStatus_t TKey_Crypto_AesCcmEncrypt(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        TKey_BYTE *pucTag, TKey_UINT32 uiTagLen);
+TKey_CryptoStatus_t TKey_Crypto_AesCcmDecrypt(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        const TKey_BYTE *pucTag, TKey_UINT32 uiTagLen);
+TKey_CryptoStatus_t TKey_Crypto_AesCmac(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucMsg, TKey_UINT32 uiLen, TKey_BYTE *pucMac);
+TKey_CryptoStatus_t TKey_Crypto_Sha256(const TKey_BYTE *pucMsg,
+        TKey_UINT32 uiLen, TKey_BYTE *pucDigest);
+TKey_CryptoStatus_t TKey_Crypto_HkdfSha256(const TKey_BYTE *pucSalt,
+        TKey_UINT32 uiSaltLen, const TKey_BYTE *pucIkm, TKey_UINT32 uiIkmLen,
+        const TKey_BYTE *pucInfo, TKey_UINT32 uiInfoLen, TKey_BYTE *pucOkm,
+        TKey_UINT32 uiOkmLen);
+TKey_CryptoStatus_t TKey_Crypto_EcP256PublicKey(const TKey_CryptoKey_t *psKey,
+        TKey_BYTE *pucPub);
+TKey_CryptoStatus_t TKey_Crypto_EcdhP256(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucPeerPub, TKey_BYTE *pucSecret);
+TKey_CryptoStatus_t TKey_Crypto_EcdsaP256Sign(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucHash, TKey_BYTE *pucSig);
+TKey_CryptoStatus_t TKey_Crypto_EcdsaP256Verify(const TKey_BYTE *pucPub,
+        const TKey_BYTE *pucHash, const TKey_BYTE *pucSig);
+
+/**
+ * \brief   Driver conformance self-test. Runs known-answer vectors through
+ *          every registered transparent driver individually, and through
+ *          every registered opaque driver, comparing against the reference
+ *          results. Returns 0 on success, non-zero otherwise.
+ */
+TKey_INT32 TKey_Crypto_SelfTest(TKey_INT32 iVerbose);
+
+/**
+ * \brief   Software reference drivers, registered by TKey_Crypto_Init()
+ */
+extern const TKey_CryptoTransparentDrv_t gsTKeyCryptoSwDriver;
+extern const TKey_CryptoOpaqueDrv_t gsTKeyCryptoSwOpaqueDriver;
+
+#endif /* THINKEY_CRYPTO_DRV_H */
@@ -0,0 +1,93 @@
+/*
+ * \file thinkey_crypto_psa_drv.h
+ *
+ * \brief Glue between the PSA driver wrappers and the THINKey crypto drivers
+ *
+ * Enabled with MBEDTLS_PSA_CRYPTO_DRIVERS and TKEY_PSA_CRYPTO_DRIVER in
+ * config.h. Transparent entry points offer P-256 ECDSA to the registered
+ * accelerator drivers and return PSA_ERROR_NOT_SUPPORTED when none takes
+ * the operation, so PSA falls back to its built-in implementation. Keys
+ * created with the TKEY_PSA_CRYPTO_LOCATION lifetime location are held by
+ * the opaque driver TKEY_PSA_CRYPTO_OPAQUE_DRIVER_ID. PSA random numbers
+ * come from TKey_Crypto_Random(), so TKey_Crypto_SetRng() is called before
+ * psa_crypto_init().
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_CRYPTO_PSA_DRV_H
+#define THINKEY_CRYPTO_PSA_DRV_H
+
+#include "psa/crypto.h"
+#include "thinkey_crypto_drv.h"
+
+/**
+ *  @brief PSA key location served by the THINKey opaque driver
+ */
+#define TKEY_PSA_CRYPTO_LOCATION \
+    ((psa_key_location_t)(PSA_KEY_LOCATION_VENDOR_FLAG | 0x000001))
+
+#ifndef TKEY_PSA_CRYPTO_OPAQUE_DRIVER_ID
+#define TKEY_PSA_CRYPTO_OPAQUE_DRIVER_ID TKEY_CRYPTO_DRIVER_ID_SW_OPAQUE
+#endif
+
+/**
+ *  @brief Key buffer contents of an opaque key. PSA keeps this in its key
+ *         slot; the key material itself stays in the driver. The PSA core
+ *         does not notify drivers when an opaque key is destroyed, so
+ *         callers release the driver slot with TKey_Crypto_DestroyKey().
+ */
+typedef struct
+{
+    TKey_UINT32 uiDriverId;
+    TKey_UINT32 uiSlot;
+} TKey_PsaOpaqueKey_t;
+
+/**
+ * \brief   Transparent driver entry points
+ */
+psa_status_t tkey_psa_transparent_sign_hash(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg, const uint8_t *hash, size_t hash_length,
+    uint8_t *signature, size_t signature_size, size_t *signature_length );
+
+psa_status_t tkey_psa_transparent_verify_hash(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg, const uint8_t *hash, size_t hash_length,
+    const uint8_t *signature, size_t signature_length );
+
+psa_status_t tkey_psa_transparent_export_public_key(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    uint8_t *data, size_t data_size, size_t *data_length );
+
+/**
+ * \brief   Opaque driver entry points
+ */
+psa_status_t tkey_psa_opaque_get_key_buffer_size(
+    const psa_key_attributes_t *attributes, size_t *key_buffer_size );
+
+psa_status_t tkey_psa_opaque_generate_key(
+    const psa_key_attributes_t *attributes,
+    uint8_t *key_buffer, size_t key_buffer_size, size_t *key_buffer_length );
+
+psa_status_t tkey_psa_opaque_sign_hash(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg, const uint8_t *hash, size_t hash_length,
+    uint8_t *signature, size_t signature_size, size_t *signature_length );
+
+psa_status_t tkey_psa_opaque_verify_hash(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg, const uint8_t *hash, size_t hash_length,
+    const uint8_t *signature, size_t signature_length );
+
+psa_status_t tkey_psa_opaque_export_public_key(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    uint8_t *data, size_t data_size, size_t *data_length );
+
+#endif /* THINKEY_CRYPTO_PSA_DRV_H */
@@ -0,0 +1,84 @@
+/*
+ * \file thinkey_crypto_session.h
+ *
+ * \brief Header file for the secure channel session crypto context
+ *
+ * A session context runs the HKDF key schedule once when the secure
+ * channel is established and keeps the AES round keys of the session
+ * encryption and MAC keys expanded, so the APDUs of a session do not pay
+ * for key derivation and key expansion on every call. The derived keys
+ * only live inside the mbedtls contexts and are wiped on close.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_CRYPTO_SESSION_H
+#define THINKEY_CRYPTO_SESSION_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_crypto_drv.h"
+#include "mbedtls/ccm.h"
+#include "mbedtls/cipher.h"
+
+/**
+ *  @brief Session key size; the HKDF output is Kenc || Kmac || Krmac
+ */
+#define TKEY_CRYPTO_SESSION_KEY_SIZE TKEY_CRYPTO_AES128_KEY_SIZE
+#define TKEY_CRYPTO_SESSION_OKM_SIZE (3 * TKEY_CRYPTO_SESSION_KEY_SIZE)
+
+/**
+ *  @brief MAC keys of a session: command MAC and response MAC
+ */
+typedef enum
+{
+    E_TKEY_CRYPTO_SESSION_MAC,
+    E_TKEY_CRYPTO_SESSION_RMAC
+} TKey_CryptoSessionMacKey_t;
+
+/**
+ *  @brief Session crypto context. Treat as opaque.
+ */
+typedef struct
+{
+    TKey_BOOL bOpen;
+    mbedtls_ccm_context sEnc;
+    mbedtls_cipher_context_t asMac[2];
+} TKey_CryptoSession_t;
+
+/**
+ * \brief   Derives the session keys with HKDF-SHA256 from the shared
+ *          secret and expands them into the session contexts
+ */
+TKey_CryptoStatus_t TKey_CryptoSession_Open(TKey_CryptoSession_t *psSession,
+        const TKey_BYTE *pucSalt, TKey_UINT32 uiSaltLen,
+        const TKey_BYTE *pucSecret, TKey_UINT32 uiSecretLen,
+        const TKey_BYTE *pucInfo, TKey_UINT32 uiInfoLen);
+
+/**
+ * \brief   AES-CCM with the session encryption key
+ */
+TKey_CryptoStatus_t TKey_CryptoSession_CcmEncrypt(
+        TKey_CryptoSession_t *psSession, const TKey_BYTE *pucNonce,
+        TKey_UINT32 uiNonceLen, const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        TKey_BYTE *pucTag, TKey_UINT32 uiTagLen);
+TKey_CryptoStatus_t TKey_CryptoSession_CcmDecrypt(
+        TKey_CryptoSession_t *psSession, const TKey_BYTE *pucNonce,
+        TKey_UINT32 uiNonceLen, const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        const TKey_BYTE *pucTag, TKey_UINT32 uiTagLen);
+
+/**
+ * \brief   AES-CMAC with one of the session MAC keys
+ */
+TKey_CryptoStatus_t TKey_CryptoSession_Cmac(TKey_CryptoSession_t *psSession,
+        TKey_CryptoSessionMacKey_t eKey, const TKey_BYTE *pucMsg,
+        TKey_UINT32 uiLen, TKey_BYTE *pucMac);
+
+/**
+ * \brief   Releases the session contexts and wipes the expanded keys.
+ *          Safe to call on a session that failed to open.
+ */
+TKey_VOID TKey_CryptoSession_Close(TKey_CryptoSession_t *psSession);
+
+#endif /* THINKEY_CRYPTO_SESSION_H */
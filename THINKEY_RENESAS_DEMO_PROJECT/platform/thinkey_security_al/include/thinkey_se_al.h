@@ -1,7 +1,245 @@
-/* Secure element abstraction header file */
+/*
+ * \file thinkey_se_al.h
+ *
+ * \brief Secure element abstraction header file
+ *
+ * The SE AL exchanges ISO 7816-4 APDUs with the secure element over a
+ * board specific bus (TKey_SeBusOps_t). Several commands can be queued in
+ * a batch and sent in one bus transaction wrapped in a THINKey envelope
+ * command; SEs without envelope support get the batch one APDU at a time.
+ * Batches can be executed synchronously or handed to the SE worker task,
+ * which owns the bus once started and reports completion by callback.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_SE_AL_H
+#define THINKEY_SE_AL_H
 
-/* Initialise secure element */
-TKey_VOID tkey_se_init();
+#include "thinkey_platform_types.h"
+#include "thinkey_crypto_drv.h"
 
-/* Dummy function to perform operations*/
-THINKey_INT32 tkey_se_transceive();
+/**
+ *  @brief SE AL configuration
+ */
+#ifndef TKEY_SE_MAX_APDU_SIZE
+#define TKEY_SE_MAX_APDU_SIZE 512     /* bus frame, envelope included */
+#endif
+#ifndef TKEY_SE_MAX_BATCH
+#define TKEY_SE_MAX_BATCH 8
+#endif
+#ifndef TKEY_SE_QUEUE_LENGTH
+#define TKEY_SE_QUEUE_LENGTH 4
+#endif
+#ifndef TKEY_SE_TASK_PRIORITY
+#define TKEY_SE_TASK_PRIORITY 3
+#endif
+#ifndef TKEY_SE_TASK_STACK_SIZE
+#define TKEY_SE_TASK_STACK_SIZE 1024
+#endif
+#ifndef TKEY_SE_NUM_KEY_SLOTS
+#define TKEY_SE_NUM_KEY_SLOTS 16
+#endif
+#ifndef TKEY_SE_FIRST_DYNAMIC_SLOT
+#define TKEY_SE_FIRST_DYNAMIC_SLOT 4  /* slots below are provisioned keys */
+#endif
+
+/**
+ *  @brief THINKey SE applet command set (proprietary class)
+ */
+#define TKEY_SE_CLA                 0x80
+#define TKEY_SE_INS_GENERATE_KEY    0x40  /* P1 slot, P2 key type */
+#define TKEY_SE_INS_IMPORT_KEY      0x42  /* P1 slot, P2 key type, data key */
+#define TKEY_SE_INS_DELETE_KEY      0x44  /* P1 slot */
+#define TKEY_SE_INS_GET_PUBLIC_KEY  0x46  /* P1 slot */
+#define TKEY_SE_INS_SIGN            0x48  /* P1 slot, data SHA-256 hash */
+#define TKEY_SE_INS_ECDH            0x4A  /* P1 slot, data peer key */
+#define TKEY_SE_INS_CCM_ENCRYPT     0x50  /* P1 slot, P2 tag length */
+#define TKEY_SE_INS_CCM_DECRYPT     0x52  /* P1 slot, P2 tag length */
+#define TKEY_SE_INS_CMAC            0x54  /* P1 slot, data message */
+#define TKEY_SE_INS_GET_RANDOM      0x84  /* Le bytes */
+#define TKEY_SE_INS_ENVELOPE        0xE0  /* batched commands */
+
+#define TKEY_SE_KEY_TYPE_AES        0x01
+#define TKEY_SE_KEY_TYPE_P256       0x02
+
+/**
+ *  @brief Status words
+ */
+#define TKEY_SE_SW_OK               0x9000
+#define TKEY_SE_SW_WRONG_LENGTH     0x6700
+#define TKEY_SE_SW_AUTH_FAILED      0x6982
+#define TKEY_SE_SW_WRONG_DATA       0x6A80
+#define TKEY_SE_SW_NO_MEMORY        0x6A84
+#define TKEY_SE_SW_NOT_FOUND        0x6A88
+#define TKEY_SE_SW_INS_NOT_SUPPORTED 0x6D00
+
+/**
+ *  @brief SE AL status codes
+ */
+typedef enum
+{
+    E_TKEY_SE_SUCCESS,
+    E_TKEY_SE_FAILURE,
+    E_TKEY_SE_INVALID_ARG,
+    E_TKEY_SE_BUS_ERROR,
+    E_TKEY_SE_BUFFER_TOO_SMALL,
+    E_TKEY_SE_BUSY,
+    E_TKEY_SE_QUEUE_FULL
+} TKey_SeStatus_t;
+
+/**
+ *  @brief Board bus operations. eTransceive sends one command frame and
+ *         returns the complete response frame (data followed by SW1 SW2).
+ */
+typedef struct
+{
+    const TKey_CHAR *pcName;
+    TKey_SeStatus_t (*eOpen)(TKey_VOID *pvCtx);
+    TKey_SeStatus_t (*eTransceive)(TKey_VOID *pvCtx, const TKey_BYTE *pucTx,
+            TKey_UINT32 uiTxLen, TKey_BYTE *pucRx, TKey_UINT32 uiRxSize,
+            TKey_UINT32 *puiRxLen);
+    TKey_VOID (*vClose)(TKey_VOID *pvCtx);
+} TKey_SeBusOps_t;
+
+/**
+ *  @brief Command APDU. uiLe of 0 means no response data is expected.
+ */
+typedef struct
+{
+    TKey_BYTE ucCla;
+    TKey_BYTE ucIns;
+    TKey_BYTE ucP1;
+    TKey_BYTE ucP2;
+    const TKey_BYTE *pucData;
+    TKey_UINT32 uiLc;
+    TKey_UINT32 uiLe;
+} TKey_SeApdu_t;
+
+/**
+ *  @brief Response APDU. The caller provides pucData/uiSize; the SE AL
+ *         fills uiLen and usSw.
+ */
+typedef struct
+{
+    TKey_BYTE *pucData;
+    TKey_UINT32 uiSize;
+    TKey_UINT32 uiLen;
+    TKey_UINT16 usSw;
+} TKey_SeResponse_t;
+
+struct TKey_SeBatch;
+
+/**
+ *  @brief Completion callback of an asynchronous batch, called from the
+ *         SE worker task
+ */
+typedef TKey_VOID (*TKey_SeBatchDone_t)(struct TKey_SeBatch *psBatch,
+                                        TKey_SeStatus_t eStatus,
+                                        TKey_VOID *pvCtx);
+
+/**
+ *  @brief Command batch. Commands and responses are referenced, not
+ *         copied, and must stay valid until the batch has completed.
+ */
+typedef struct TKey_SeBatch
+{
+    const TKey_SeApdu_t *apsApdu[TKEY_SE_MAX_BATCH];
+    TKey_SeResponse_t *apsResp[TKEY_SE_MAX_BATCH];
+    TKey_UINT32 uiCount;
+    TKey_SeBatchDone_t pfnDone;
+    TKey_VOID *pvCtx;
+} TKey_SeBatch_t;
+
+/**
+ *  @brief Channel statistics
+ */
+typedef struct
+{
+    TKey_UINT32 uiBusTransactions;
+    TKey_UINT32 uiApdus;
+    TKey_UINT32 uiEnvelopes;
+    TKey_UINT32 uiFallbacks;
+    TKey_UINT32 uiErrors;
+} TKey_SeStats_t;
+
+/**
+ * \brief   Initialises the SE channel on the given bus
+ */
+TKey_StatusType TKey_Se_Init(const TKey_SeBusOps_t *psBus, TKey_VOID *pvBusCtx);
+
+/**
+ * \brief   Closes the SE channel
+ */
+TKey_VOID TKey_Se_DeInit(TKey_VOID);
+
+/**
+ * \brief   Starts the SE worker task. From then on the worker owns the bus
+ *          and synchronous calls are only allowed from completion
+ *          callbacks; other tasks get E_TKEY_SE_BUSY.
+ */
+TKey_StatusType TKey_Se_StartWorker(TKey_VOID);
+
+/**
+ * \brief   Sends one APDU and waits for the response
+ */
+TKey_SeStatus_t TKey_Se_Transceive(const TKey_SeApdu_t *psApdu,
+                                   TKey_SeResponse_t *psResp);
+
+/**
+ * \brief   Batch helpers
+ */
+TKey_VOID TKey_SeBatch_Init(TKey_SeBatch_t *psBatch);
+TKey_SeStatus_t TKey_SeBatch_Add(TKey_SeBatch_t *psBatch,
+                                 const TKey_SeApdu_t *psApdu,
+                                 TKey_SeResponse_t *psResp);
+
+/**
+ * \brief   Executes all commands of the batch in as few bus transactions
+ *          as the frame size allows. Per-command results are in the
+ *          response status words.
+ */
+TKey_SeStatus_t TKey_Se_ExecuteBatch(TKey_SeBatch_t *psBatch);
+
+/**
+ * \brief   Queues the batch to the SE worker and returns immediately.
+ *          pfnDone is called from the worker task once it has executed.
+ */
+TKey_SeStatus_t TKey_Se_SubmitBatch(TKey_SeBatch_t *psBatch,
+                                    TKey_SeBatchDone_t pfnDone,
+                                    TKey_VOID *pvCtx);
+
+/**
+ * \brief   Returns the channel statistics
+ */
+TKey_VOID TKey_Se_GetStats(TKey_SeStats_t *psStats);
+
+/**
+ * \brief   Serialises an APDU (short or extended length) into pucOut.
+ *          Returns the encoded length, 0 if it does not fit.
+ */
+TKey_UINT32 TKey_Se_EncodeApdu(const TKey_SeApdu_t *psApdu, TKey_BYTE *pucOut,
+                               TKey_UINT32 uiOutSize);
+
+/**
+ * \brief   Parses a serialised APDU. Data is referenced in place.
+ */
+TKey_SeStatus_t TKey_Se_DecodeApdu(const TKey_BYTE *pucIn, TKey_UINT32 uiLen,
+                                   TKey_SeApdu_t *psApdu);
+
+/**
+ * \brief   Opaque crypto driver backed by the SE key slots. Registered by
+ *          TKey_SeCrypto_Register() after TKey_Se_Init().
+ */
+#define TKEY_CRYPTO_DRIVER_ID_SE 3
+extern const TKey_CryptoOpaqueDrv_t gsTKeySeCryptoDriver;
+TKey_CryptoStatus_t TKey_SeCrypto_Register(TKey_VOID);
+
+/**
+ * \brief   Initialises the SE on the board bus returned by
+ *          tkey_se_board_bus(), which boards with an SE override.
+ */
+TKey_VOID tkey_se_init(TKey_VOID);
+const TKey_SeBusOps_t* tkey_se_board_bus(TKey_VOID **ppvBusCtx);
+
+#endif /* THINKEY_SE_AL_H */
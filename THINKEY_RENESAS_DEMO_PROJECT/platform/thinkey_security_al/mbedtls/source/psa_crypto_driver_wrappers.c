@@ -36,6 +36,17 @@
 #include "test/drivers/test_driver.h"
 #endif /* PSA_CRYPTO_DRIVER_TEST */
 
+/* THINKey crypto driver layer */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+#ifndef PSA_CRYPTO_DRIVER_PRESENT
+#define PSA_CRYPTO_DRIVER_PRESENT
+#endif
+#ifndef PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT
+#define PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT
+#endif
+#include "thinkey_crypto_psa_drv.h"
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
+
 /* Repeat above block for each JSON-declared driver during autogeneration */
 
 /* Auto-generated values depending on which drivers are registered. ID 0 is
@@ -107,6 +118,19 @@ psa_status_t psa_driver_wrapper_sign_hash(
             if( status != PSA_ERROR_NOT_SUPPORTED )
                 return( status );
 #endif /* PSA_CRYPTO_DRIVER_TEST */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+            status = tkey_psa_transparent_sign_hash( attributes,
+                                                     key_buffer,
+                                                     key_buffer_size,
+                                                     alg,
+                                                     hash,
+                                                     hash_length,
+                                                     signature,
+                                                     signature_size,
+                                                     signature_length );
+            if( status != PSA_ERROR_NOT_SUPPORTED )
+                return( status );
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
 #endif /* PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT */
             /* Fell through, meaning no accelerator supports this operation */
             return( psa_sign_hash_internal( attributes,
@@ -133,6 +157,18 @@ psa_status_t psa_driver_wrapper_sign_hash(
                                                      signature_size,
                                                      signature_length ) );
 #endif /* PSA_CRYPTO_DRIVER_TEST */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+        case TKEY_PSA_CRYPTO_LOCATION:
+            return( tkey_psa_opaque_sign_hash( attributes,
+                                               key_buffer,
+                                               key_buffer_size,
+                                               alg,
+                                               hash,
+                                               hash_length,
+                                               signature,
+                                               signature_size,
+                                               signature_length ) );
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
 #endif /* PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT */
         default:
             /* Key is declared with a lifetime not known to us */
@@ -190,6 +226,18 @@ psa_status_t psa_driver_wrapper_verify_hash(
             if( status != PSA_ERROR_NOT_SUPPORTED )
                 return( status );
 #endif /* PSA_CRYPTO_DRIVER_TEST */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+            status = tkey_psa_transparent_verify_hash( attributes,
+                                                       key_buffer,
+                                                       key_buffer_size,
+                                                       alg,
+                                                       hash,
+                                                       hash_length,
+                                                       signature,
+                                                       signature_length );
+            if( status != PSA_ERROR_NOT_SUPPORTED )
+                return( status );
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
 #endif /* PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT */
 
             return( psa_verify_hash_internal( attributes,
@@ -214,6 +262,17 @@ psa_status_t psa_driver_wrapper_verify_hash(
                                                        signature,
                                                        signature_length ) );
 #endif /* PSA_CRYPTO_DRIVER_TEST */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+        case TKEY_PSA_CRYPTO_LOCATION:
+            return( tkey_psa_opaque_verify_hash( attributes,
+                                                 key_buffer,
+                                                 key_buffer_size,
+                                                 alg,
+                                                 hash,
+                                                 hash_length,
+                                                 signature,
+                                                 signature_length ) );
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
 #endif /* PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT */
         default:
             /* Key is declared with a lifetime not known to us */
@@ -282,6 +341,11 @@ psa_status_t psa_driver_wrapper_get_key_buffer_size(
             return( PSA_SUCCESS );
 #endif /* TEST_DRIVER_KEY_CONTEXT_SIZE_FUNCTION */
 #endif /* PSA_CRYPTO_DRIVER_TEST */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+        case TKEY_PSA_CRYPTO_LOCATION:
+            return( tkey_psa_opaque_get_key_buffer_size( attributes,
+                                                         key_buffer_size ) );
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
 
         default:
             (void)key_type;
@@ -351,6 +415,12 @@ psa_status_t psa_driver_wrapper_generate_key(
                 attributes, key_buffer, key_buffer_size, key_buffer_length );
             break;
 #endif /* PSA_CRYPTO_DRIVER_TEST */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+        case TKEY_PSA_CRYPTO_LOCATION:
+            status = tkey_psa_opaque_generate_key(
+                attributes, key_buffer, key_buffer_size, key_buffer_length );
+            break;
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
 #endif /* PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT */
 
         default:
@@ -540,6 +610,16 @@ psa_status_t psa_driver_wrapper_export_public_key(
             if( status != PSA_ERROR_NOT_SUPPORTED )
                 return( status );
 #endif /* PSA_CRYPTO_DRIVER_TEST */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+            status = tkey_psa_transparent_export_public_key( attributes,
+                                                             key_buffer,
+                                                             key_buffer_size,
+                                                             data,
+                                                             data_size,
+                                                             data_length );
+            if( status != PSA_ERROR_NOT_SUPPORTED )
+                return( status );
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
 #endif /* PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT */
             /* Fell through, meaning no accelerator supports this operation */
             return( psa_export_public_key_internal( attributes,
@@ -560,6 +640,15 @@ psa_status_t psa_driver_wrapper_export_public_key(
                                                    data_size,
                                                    data_length ) );
 #endif /* PSA_CRYPTO_DRIVER_TEST */
+#if defined(TKEY_PSA_CRYPTO_DRIVER)
+        case TKEY_PSA_CRYPTO_LOCATION:
+            return( tkey_psa_opaque_export_public_key( attributes,
+                                                       key_buffer,
+                                                       key_buffer_size,
+                                                       data,
+                                                       data_size,
+                                                       data_length ) );
+#endif /* TKEY_PSA_CRYPTO_DRIVER */
 #endif /* PSA_CRYPTO_ACCELERATOR_DRIVER_PRESENT */
         default:
             /* Key is declared with a lifetime not known to us */
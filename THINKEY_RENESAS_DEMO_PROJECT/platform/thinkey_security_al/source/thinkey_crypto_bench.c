@@ -0,0 +1,409 @@
+/*
+ * \file thinkey_crypto_bench.c
+ *
+ * \brief Crypto micro-benchmark suite
+ *
+ * Covers AES-128 ECB/CCM, CMAC, SHA-256, HKDF-SHA256, P-256 ECDH, ECDSA
+ * sign/verify and X.509 parsing with the project config.h, and compares
+ * the per-call secure channel path (key schedule and key expansion on
+ * every APDU) with a cached session context. On the target
+ * call TKey_CryptoBench_Report() from a task; on a Linux host build with
+ * THINKEY_HOST_BUILD and THINKEY_CRYPTO_BENCH_MAIN it is a standalone
+ * program, built and run by the host crypto_bench ctest.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_crypto_bench.h"
+#include "thinkey_crypto_drv.h"
+#include "thinkey_crypto_session.h"
+#include "mbedtls/x509_crt.h"
+#include <string.h>
+
+#if defined(THINKEY_CRYPTO_BENCH_MAIN)
+#include <stdio.h>
+#include <stdlib.h>
+#endif
+
+#define TKEY_CRYPTO_BENCH_SMALL_MSG 64
+#define TKEY_CRYPTO_BENCH_LARGE_MSG 1024
+
+/* Self-signed P-256/SHA-256 certificate, representative of the certificate
+ * chain elements parsed during key provisioning */
+static const TKey_BYTE gaucBenchCert[] = {
+    0x30, 0x82, 0x01, 0xad, 0x30, 0x82, 0x01, 0x53, 0xa0, 0x03, 0x02, 0x01,
+    0x02, 0x02, 0x14, 0x62, 0x9a, 0xe7, 0x31, 0x29, 0xcd, 0x5d, 0x24, 0xb9,
+    0xd9, 0x41, 0xb4, 0x71, 0xd7, 0xed, 0xb0, 0xd8, 0x36, 0xbc, 0xa5, 0x30,
+    0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
+    0x2c, 0x31, 0x12, 0x30, 0x10, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x09,
+    0x54, 0x68, 0x69, 0x6e, 0x6b, 0x53, 0x65, 0x65, 0x64, 0x31, 0x16, 0x30,
+    0x14, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x0d, 0x54, 0x48, 0x49, 0x4e,
+    0x4b, 0x65, 0x79, 0x20, 0x42, 0x65, 0x6e, 0x63, 0x68, 0x30, 0x1e, 0x17,
+    0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x39, 0x30, 0x37, 0x34, 0x36, 0x35,
+    0x38, 0x5a, 0x17, 0x0d, 0x33, 0x36, 0x31, 0x30, 0x31, 0x36, 0x30, 0x37,
+    0x34, 0x36, 0x35, 0x38, 0x5a, 0x30, 0x2c, 0x31, 0x12, 0x30, 0x10, 0x06,
+    0x03, 0x55, 0x04, 0x0a, 0x0c, 0x09, 0x54, 0x68, 0x69, 0x6e, 0x6b, 0x53,
+    0x65, 0x65, 0x64, 0x31, 0x16, 0x30, 0x14, 0x06, 0x03, 0x55, 0x04, 0x03,
+    0x0c, 0x0d, 0x54, 0x48, 0x49, 0x4e, 0x4b, 0x65, 0x79, 0x20, 0x42, 0x65,
+    0x6e, 0x63, 0x68, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48,
+    0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03,
+    0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0x3f, 0x39, 0xe5, 0x6e, 0xb3, 0xe4,
+    0x9a, 0x25, 0x99, 0x6b, 0x45, 0xf5, 0x1a, 0xac, 0x36, 0x2b, 0x15, 0xe2,
+    0x26, 0x10, 0xd6, 0x6a, 0x3b, 0x45, 0x5e, 0x64, 0xa6, 0xc2, 0xb2, 0x09,
+    0xc6, 0x4c, 0xe5, 0x57, 0xe7, 0xa8, 0xf4, 0x66, 0xe6, 0xc9, 0xe0, 0x88,
+    0xd6, 0x73, 0x2a, 0x4e, 0xbf, 0x06, 0xe3, 0x2a, 0x56, 0xec, 0xfa, 0xea,
+    0x08, 0x26, 0x83, 0x18, 0x8b, 0xdd, 0xdf, 0xbe, 0xea, 0x93, 0xa3, 0x53,
+    0x30, 0x51, 0x30, 0x1d, 0x06, 0x03, 0x55, 0x1d, 0x0e, 0x04, 0x16, 0x04,
+    0x14, 0xeb, 0xf4, 0x46, 0xdc, 0x02, 0x81, 0x7a, 0x4f, 0xbd, 0xfb, 0x4e,
+    0x8b, 0xd9, 0x73, 0x02, 0x81, 0xc5, 0xcf, 0x46, 0xd9, 0x30, 0x1f, 0x06,
+    0x03, 0x55, 0x1d, 0x23, 0x04, 0x18, 0x30, 0x16, 0x80, 0x14, 0xeb, 0xf4,
+    0x46, 0xdc, 0x02, 0x81, 0x7a, 0x4f, 0xbd, 0xfb, 0x4e, 0x8b, 0xd9, 0x73,
+    0x02, 0x81, 0xc5, 0xcf, 0x46, 0xd9, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x1d,
+    0x13, 0x01, 0x01, 0xff, 0x04, 0x05, 0x30, 0x03, 0x01, 0x01, 0xff, 0x30,
+    0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03,
+    0x48, 0x00, 0x30, 0x45, 0x02, 0x20, 0x71, 0x57, 0x9d, 0xa6, 0xc8, 0x63,
+    0xdd, 0xbe, 0xa7, 0x31, 0x0d, 0xb8, 0xe1, 0xda, 0x8f, 0xd8, 0x03, 0xad,
+    0x39, 0x61, 0xba, 0xb7, 0x61, 0xeb, 0x3d, 0xee, 0xfe, 0x69, 0xdd, 0xf2,
+    0x2e, 0x27, 0x02, 0x21, 0x00, 0xdd, 0xda, 0xda, 0x4b, 0xa2, 0xfd, 0x9b,
+    0x67, 0x59, 0xa6, 0xbe, 0xe9, 0xe9, 0x62, 0xd4, 0xfa, 0x5a, 0x51, 0xab,
+    0x8b, 0xc2, 0xb8, 0xcd, 0xe4, 0x7a, 0xbc, 0x92, 0x2b, 0x1a, 0x41, 0x14,
+    0xdf,
+};
+
+static const TKey_BYTE gaucBenchKey[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+static const TKey_BYTE gaucBenchNonce[13] = {
+    0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0,
+    0xa1, 0xa2, 0xa3, 0xa4, 0xa5 };
+static const TKey_BYTE gaucBenchPriv[32] = {
+    0xc9, 0xaf, 0xa9, 0xd8, 0x45, 0xba, 0x75, 0x16,
+    0x6b, 0x5c, 0x21, 0x57, 0x67, 0xb1, 0xd6, 0x93,
+    0x4e, 0x50, 0xc3, 0xdb, 0x36, 0xe8, 0x9b, 0x12,
+    0x7b, 0x8a, 0x62, 0x2b, 0x12, 0x0f, 0x67, 0x21 };
+
+static TKey_BYTE gaucBenchIn[TKEY_CRYPTO_BENCH_LARGE_MSG];
+static TKey_BYTE gaucBenchOut[TKEY_CRYPTO_BENCH_LARGE_MSG];
+
+/* Time uiIter evaluations of EXPR, which yields 0 on success */
+#define TKEY_CRYPTO_BENCH_CASE(psRes, uiIter, EXPR)                         \
+    do {                                                                    \
+        TKey_UINT32 uiN_;                                                   \
+        TKey_UINT64 ullStart_;                                              \
+        TKey_INT32 iRet_;                                                   \
+        for(uiN_ = 0; uiN_ < (uiIter); uiN_++) {                            \
+            ullStart_ = TKey_Bench_Now();                                   \
+            iRet_ = (TKey_INT32)(EXPR);                                     \
+            TKey_Bench_Record((psRes), ullStart_, TKey_Bench_Now());        \
+            if(0 != iRet_) {                                                \
+                (psRes)->iStatus = iRet_;                                   \
+                break;                                                      \
+            }                                                               \
+        }                                                                   \
+    } while(TKey_EXIT)
+
+static TKey_BenchResult_t* tkey_crypto_bench_new(TKey_BenchResult_t *psResults,
+        TKey_UINT32 uiMaxResults, TKey_UINT32 *puiCount,
+        const TKey_CHAR *pcName, TKey_UINT32 uiBytes)
+{
+    TKey_BenchResult_t *psRes;
+
+    if(*puiCount >= uiMaxResults) {
+        return TKey_NULL;
+    }
+    psRes = &psResults[(*puiCount)++];
+    memset(psRes, 0, sizeof(TKey_BenchResult_t));
+    psRes->pcSuite = "crypto";
+    psRes->pcName = pcName;
+    psRes->uiBytes = uiBytes;
+    return psRes;
+}
+
+static TKey_INT32 tkey_crypto_bench_x509(TKey_VOID)
+{
+    mbedtls_x509_crt sCrt;
+    TKey_INT32 iRet;
+
+    mbedtls_x509_crt_init(&sCrt);
+    iRet = mbedtls_x509_crt_parse_der(&sCrt, gaucBenchCert,
+                                      sizeof(gaucBenchCert));
+    mbedtls_x509_crt_free(&sCrt);
+    return iRet;
+}
+
+static TKey_INT32 tkey_crypto_bench_session_open(TKey_VOID)
+{
+    TKey_CryptoSession_t sSession;
+    TKey_CryptoStatus_t eStatus;
+
+    eStatus = TKey_CryptoSession_Open(&sSession, gaucBenchNonce,
+                    sizeof(gaucBenchNonce), gaucBenchPriv,
+                    sizeof(gaucBenchPriv), gaucBenchKey, sizeof(gaucBenchKey));
+    TKey_CryptoSession_Close(&sSession);
+    return (TKey_INT32)eStatus;
+}
+
+/* One secured APDU the way it was done without a session: derive the
+ * session keys, then encrypt and MAC with freshly expanded keys */
+static TKey_INT32 tkey_crypto_bench_apdu_percall(TKey_VOID)
+{
+    TKey_BYTE aucOkm[TKEY_CRYPTO_SESSION_OKM_SIZE];
+    TKey_BYTE aucTag[8];
+    TKey_BYTE aucMac[TKEY_CRYPTO_CMAC_SIZE];
+    TKey_CryptoKey_t sKey;
+    TKey_CryptoStatus_t eStatus;
+
+    do {
+        eStatus = TKey_Crypto_HkdfSha256(gaucBenchNonce, sizeof(gaucBenchNonce),
+                        gaucBenchPriv, sizeof(gaucBenchPriv), gaucBenchKey,
+                        sizeof(gaucBenchKey), aucOkm, sizeof(aucOkm));
+        if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+            break;
+        }
+        TKey_Crypto_SetLocalKey(&sKey, E_TKEY_CRYPTO_KEY_AES, aucOkm,
+                                TKEY_CRYPTO_SESSION_KEY_SIZE);
+        eStatus = TKey_Crypto_AesCcmEncrypt(&sKey, gaucBenchNonce,
+                        sizeof(gaucBenchNonce), TKey_NULL, 0, gaucBenchIn,
+                        TKEY_CRYPTO_BENCH_SMALL_MSG, gaucBenchOut, aucTag,
+                        sizeof(aucTag));
+        if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+            break;
+        }
+        TKey_Crypto_SetLocalKey(&sKey, E_TKEY_CRYPTO_KEY_AES,
+                                &aucOkm[TKEY_CRYPTO_SESSION_KEY_SIZE],
+                                TKEY_CRYPTO_SESSION_KEY_SIZE);
+        eStatus = TKey_Crypto_AesCmac(&sKey, gaucBenchOut,
+                        TKEY_CRYPTO_BENCH_SMALL_MSG, aucMac);
+    } while(TKey_EXIT);
+    return (TKey_INT32)eStatus;
+}
+
+static TKey_INT32 tkey_crypto_bench_apdu_session(TKey_CryptoSession_t *psSession)
+{
+    TKey_BYTE aucTag[8];
+    TKey_BYTE aucMac[TKEY_CRYPTO_CMAC_SIZE];
+    TKey_CryptoStatus_t eStatus;
+
+    eStatus = TKey_CryptoSession_CcmEncrypt(psSession, gaucBenchNonce,
+                    sizeof(gaucBenchNonce), TKey_NULL, 0, gaucBenchIn,
+                    TKEY_CRYPTO_BENCH_SMALL_MSG, gaucBenchOut, aucTag,
+                    sizeof(aucTag));
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        eStatus = TKey_CryptoSession_Cmac(psSession, E_TKEY_CRYPTO_SESSION_MAC,
+                        gaucBenchOut, TKEY_CRYPTO_BENCH_SMALL_MSG, aucMac);
+    }
+    return (TKey_INT32)eStatus;
+}
+
+TKey_UINT32 TKey_CryptoBench_Run(TKey_BenchResult_t *psResults,
+                                 TKey_UINT32 uiMaxResults,
+                                 TKey_UINT32 uiIterations)
+{
+    TKey_CryptoKey_t sAesKey;
+    TKey_CryptoKey_t sEcKey;
+    TKey_CryptoSession_t sSession;
+    TKey_BYTE aucTag[16];
+    TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    TKey_BYTE aucSig[TKEY_CRYPTO_P256_SIG_SIZE];
+    TKey_BYTE aucHash[TKEY_CRYPTO_SHA256_SIZE];
+    TKey_BenchResult_t *psRes;
+    TKey_UINT32 uiPkIterations;
+    TKey_UINT32 uiCount = 0;
+
+    if(0 == uiIterations) {
+        uiIterations = TKEY_CRYPTO_BENCH_ITERATIONS;
+    }
+    uiPkIterations = uiIterations / TKEY_CRYPTO_BENCH_PK_DIVISOR;
+    if(0 == uiPkIterations) {
+        uiPkIterations = 1;
+    }
+
+    TKey_Bench_TimerInit();
+    memset(gaucBenchIn, 0xa5, sizeof(gaucBenchIn));
+    TKey_Crypto_SetLocalKey(&sAesKey, E_TKEY_CRYPTO_KEY_AES, gaucBenchKey,
+                            sizeof(gaucBenchKey));
+    TKey_Crypto_SetLocalKey(&sEcKey, E_TKEY_CRYPTO_KEY_P256_PRIVATE,
+                            gaucBenchPriv, sizeof(gaucBenchPriv));
+
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "aes128_ecb", TKEY_CRYPTO_AES_BLOCK_SIZE);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            TKey_Crypto_AesEcbEncrypt(&sAesKey, gaucBenchIn, gaucBenchOut));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "aes128_ccm_enc_64", TKEY_CRYPTO_BENCH_SMALL_MSG);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            TKey_Crypto_AesCcmEncrypt(&sAesKey, gaucBenchNonce,
+                sizeof(gaucBenchNonce), TKey_NULL, 0, gaucBenchIn,
+                TKEY_CRYPTO_BENCH_SMALL_MSG, gaucBenchOut, aucTag, 8));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "aes128_ccm_dec_64", TKEY_CRYPTO_BENCH_SMALL_MSG);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            TKey_Crypto_AesCcmDecrypt(&sAesKey, gaucBenchNonce,
+                sizeof(gaucBenchNonce), TKey_NULL, 0, gaucBenchOut,
+                TKEY_CRYPTO_BENCH_SMALL_MSG, gaucBenchIn, aucTag, 8));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "aes128_ccm_enc_1k", TKEY_CRYPTO_BENCH_LARGE_MSG);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            TKey_Crypto_AesCcmEncrypt(&sAesKey, gaucBenchNonce,
+                sizeof(gaucBenchNonce), TKey_NULL, 0, gaucBenchIn,
+                TKEY_CRYPTO_BENCH_LARGE_MSG, gaucBenchOut, aucTag, 8));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "aes128_cmac_64", TKEY_CRYPTO_BENCH_SMALL_MSG);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            TKey_Crypto_AesCmac(&sAesKey, gaucBenchIn,
+                TKEY_CRYPTO_BENCH_SMALL_MSG, gaucBenchOut));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "sha256_64", TKEY_CRYPTO_BENCH_SMALL_MSG);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            TKey_Crypto_Sha256(gaucBenchIn, TKEY_CRYPTO_BENCH_SMALL_MSG,
+                aucHash));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "sha256_1k", TKEY_CRYPTO_BENCH_LARGE_MSG);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            TKey_Crypto_Sha256(gaucBenchIn, TKEY_CRYPTO_BENCH_LARGE_MSG,
+                aucHash));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "hkdf_sha256_32", 32);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            TKey_Crypto_HkdfSha256(gaucBenchNonce, sizeof(gaucBenchNonce),
+                gaucBenchIn, 32, gaucBenchKey, sizeof(gaucBenchKey),
+                gaucBenchOut, 32));
+    }
+
+    /* Secure channel: per-call path against a cached session context */
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "session_open", TKEY_CRYPTO_SESSION_OKM_SIZE);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            tkey_crypto_bench_session_open());
+    }
+    if(E_TKEY_CRYPTO_SUCCESS == TKey_CryptoSession_Open(&sSession,
+            gaucBenchNonce, sizeof(gaucBenchNonce), gaucBenchPriv,
+            sizeof(gaucBenchPriv), gaucBenchKey, sizeof(gaucBenchKey))) {
+        psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                      "session_ccm_enc_64",
+                                      TKEY_CRYPTO_BENCH_SMALL_MSG);
+        if(TKey_NULL != psRes) {
+            TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+                TKey_CryptoSession_CcmEncrypt(&sSession, gaucBenchNonce,
+                    sizeof(gaucBenchNonce), TKey_NULL, 0, gaucBenchIn,
+                    TKEY_CRYPTO_BENCH_SMALL_MSG, gaucBenchOut, aucTag, 8));
+        }
+        psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                      "session_cmac_64",
+                                      TKEY_CRYPTO_BENCH_SMALL_MSG);
+        if(TKey_NULL != psRes) {
+            TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+                TKey_CryptoSession_Cmac(&sSession, E_TKEY_CRYPTO_SESSION_MAC,
+                    gaucBenchIn, TKEY_CRYPTO_BENCH_SMALL_MSG, gaucBenchOut));
+        }
+        psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                      "apdu_session_64",
+                                      TKEY_CRYPTO_BENCH_SMALL_MSG);
+        if(TKey_NULL != psRes) {
+            TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+                tkey_crypto_bench_apdu_session(&sSession));
+        }
+        TKey_CryptoSession_Close(&sSession);
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "apdu_percall_64", TKEY_CRYPTO_BENCH_SMALL_MSG);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            tkey_crypto_bench_apdu_percall());
+    }
+
+    /* Public key cases: derive a peer key and a signature to work with */
+    TKey_Crypto_EcP256PublicKey(&sEcKey, aucPub);
+    TKey_Crypto_Sha256(gaucBenchIn, TKEY_CRYPTO_BENCH_SMALL_MSG, aucHash);
+    TKey_Crypto_EcdsaP256Sign(&sEcKey, aucHash, aucSig);
+
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "p256_pubkey", 0);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiPkIterations,
+            TKey_Crypto_EcP256PublicKey(&sEcKey, gaucBenchOut));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "p256_ecdh", 0);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiPkIterations,
+            TKey_Crypto_EcdhP256(&sEcKey, aucPub, gaucBenchOut));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "p256_ecdsa_sign", 0);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiPkIterations,
+            TKey_Crypto_EcdsaP256Sign(&sEcKey, aucHash, gaucBenchOut));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "p256_ecdsa_verify", 0);
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiPkIterations,
+            TKey_Crypto_EcdsaP256Verify(aucPub, aucHash, aucSig));
+    }
+    psRes = tkey_crypto_bench_new(psResults, uiMaxResults, &uiCount,
+                                  "x509_parse_p256", sizeof(gaucBenchCert));
+    if(TKey_NULL != psRes) {
+        TKEY_CRYPTO_BENCH_CASE(psRes, uiIterations,
+            tkey_crypto_bench_x509());
+    }
+    return uiCount;
+}
+
+TKey_INT32 TKey_CryptoBench_Report(TKey_BenchPrint_t pfnPrint,
+                                   TKey_UINT32 uiIterations)
+{
+    static TKey_BenchResult_t sasResults[TKEY_CRYPTO_BENCH_MAX_RESULTS];
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_INT32 iFailed = 0;
+
+    uiCount = TKey_CryptoBench_Run(sasResults, TKEY_CRYPTO_BENCH_MAX_RESULTS,
+                                   uiIterations);
+    TKey_Bench_PrintHeader(pfnPrint);
+    TKey_Bench_PrintResults(pfnPrint, sasResults, uiCount);
+    for(uiIndex = 0; uiIndex < uiCount; uiIndex++) {
+        if(0 != sasResults[uiIndex].iStatus) {
+            iFailed++;
+        }
+    }
+    return iFailed;
+}
+
+#if defined(THINKEY_CRYPTO_BENCH_MAIN)
+static TKey_VOID tkey_crypto_bench_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiIterations = 0;
+
+    if(argc > 1) {
+        uiIterations = (TKey_UINT32)strtoul(argv[1], TKey_NULL, 0);
+    }
+    if(E_TKEY_SUCCESS != TKey_Crypto_Init()) {
+        return 1;
+    }
+    return (0 == TKey_CryptoBench_Report(tkey_crypto_bench_print,
+                                         uiIterations)) ? 0 : 1;
+}
+#endif /* THINKEY_CRYPTO_BENCH_MAIN */
@@ -0,0 +1,725 @@
+/*
+ * \file thinkey_crypto_drv.c
+ *
+ * \brief Crypto driver registry, dispatch and driver conformance self-test
+ *
+ * Built with THINKEY_HOST_BUILD and THINKEY_CRYPTO_SELFTEST_MAIN on a Linux
+ * host, it is a standalone program running the self-test.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_crypto_drv.h"
+#include "mbedtls/platform.h"
+#include <string.h>
+
+static const TKey_CryptoTransparentDrv_t*
+    gpsTransparentDrivers[TKEY_CRYPTO_MAX_TRANSPARENT_DRIVERS];
+static TKey_UINT32 guiNumTransparentDrivers = 0;
+
+static const TKey_CryptoOpaqueDrv_t*
+    gpsOpaqueDrivers[TKEY_CRYPTO_MAX_OPAQUE_DRIVERS];
+static TKey_UINT32 guiNumOpaqueDrivers = 0;
+
+static TKey_CryptoRng_t gpfnRng = TKey_NULL;
+static TKey_VOID *gpvRngCtx = TKey_NULL;
+
+/* Try every transparent driver implementing OP, accelerators first and the
+ * software driver last, until one returns something other than
+ * E_TKEY_CRYPTO_NOT_SUPPORTED. */
+#define TKEY_CRYPTO_DISPATCH(eStatus, OP, ...)                              \
+    do {                                                                    \
+        const TKey_CryptoTransparentDrv_t *psDrv_;                          \
+        TKey_UINT32 uiIdx_ = 0;                                             \
+        (eStatus) = E_TKEY_CRYPTO_NOT_SUPPORTED;                            \
+        while(TKey_NULL != (psDrv_ = TKey_Crypto_GetTransparentDriver(uiIdx_++))) { \
+            if(TKey_NULL == psDrv_->OP) {                                   \
+                continue;                                                   \
+            }                                                               \
+            (eStatus) = psDrv_->OP(__VA_ARGS__);                            \
+            if(E_TKEY_CRYPTO_NOT_SUPPORTED != (eStatus)) {                  \
+                break;                                                      \
+            }                                                               \
+        }                                                                   \
+    } while(TKey_EXIT)
+
+/* Resolve the opaque driver behind a key reference and call OP on it */
+#define TKEY_CRYPTO_OPAQUE_CALL(eStatus, psKey, OP, ...)                    \
+    do {                                                                    \
+        const TKey_CryptoOpaqueDrv_t *psDrv_ =                              \
+            TKey_Crypto_GetOpaqueDriver((psKey)->uiDriverId);               \
+        if(TKey_NULL == psDrv_) {                                           \
+            (eStatus) = E_TKEY_CRYPTO_INVALID_ARG;                          \
+        } else if(TKey_NULL == psDrv_->OP) {                                \
+            (eStatus) = E_TKEY_CRYPTO_NOT_SUPPORTED;                        \
+        } else {                                                            \
+            (eStatus) = psDrv_->OP((psKey)->uiSlot, __VA_ARGS__);           \
+        }                                                                   \
+    } while(TKey_EXIT)
+
+/* Initialise the crypto driver layer */
+TKey_StatusType TKey_Crypto_Init(TKey_VOID)
+{
+    guiNumTransparentDrivers = 0;
+    guiNumOpaqueDrivers = 0;
+    if(E_TKEY_CRYPTO_SUCCESS !=
+       TKey_Crypto_RegisterOpaqueDriver(&gsTKeyCryptoSwOpaqueDriver)) {
+        return E_TKEY_FAILURE;
+    }
+    return E_TKEY_SUCCESS;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_RegisterTransparentDriver(
+        const TKey_CryptoTransparentDrv_t *psDriver)
+{
+    if(TKey_NULL == psDriver) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(guiNumTransparentDrivers >= TKEY_CRYPTO_MAX_TRANSPARENT_DRIVERS) {
+        return E_TKEY_CRYPTO_NO_MEMORY;
+    }
+    gpsTransparentDrivers[guiNumTransparentDrivers++] = psDriver;
+    return E_TKEY_CRYPTO_SUCCESS;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_RegisterOpaqueDriver(
+        const TKey_CryptoOpaqueDrv_t *psDriver)
+{
+    if(TKey_NULL == psDriver ||
+       TKEY_CRYPTO_DRIVER_ID_NONE == psDriver->uiDriverId ||
+       TKey_NULL != TKey_Crypto_GetOpaqueDriver(psDriver->uiDriverId)) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(guiNumOpaqueDrivers >= TKEY_CRYPTO_MAX_OPAQUE_DRIVERS) {
+        return E_TKEY_CRYPTO_NO_MEMORY;
+    }
+    gpsOpaqueDrivers[guiNumOpaqueDrivers++] = psDriver;
+    return E_TKEY_CRYPTO_SUCCESS;
+}
+
+const TKey_CryptoTransparentDrv_t* TKey_Crypto_GetTransparentDriver(
+        TKey_UINT32 uiIndex)
+{
+    if(uiIndex < guiNumTransparentDrivers) {
+        return gpsTransparentDrivers[uiIndex];
+    }
+    if(uiIndex == guiNumTransparentDrivers) {
+        return &gsTKeyCryptoSwDriver;
+    }
+    return TKey_NULL;
+}
+
+const TKey_CryptoOpaqueDrv_t* TKey_Crypto_GetOpaqueDriver(
+        TKey_UINT32 uiDriverId)
+{
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < guiNumOpaqueDrivers; uiIndex++) {
+        if(gpsOpaqueDrivers[uiIndex]->uiDriverId == uiDriverId) {
+            return gpsOpaqueDrivers[uiIndex];
+        }
+    }
+    return TKey_NULL;
+}
+
+TKey_VOID TKey_Crypto_SetRng(TKey_CryptoRng_t pfnRng, TKey_VOID *pvRngCtx)
+{
+    gpfnRng = pfnRng;
+    gpvRngCtx = pvRngCtx;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_Random(TKey_BYTE *pucOut, TKey_UINT32 uiLen)
+{
+    if(TKey_NULL == gpfnRng) {
+        return E_TKEY_CRYPTO_NOT_SUPPORTED;
+    }
+    if(0 != gpfnRng(gpvRngCtx, pucOut, uiLen)) {
+        return E_TKEY_CRYPTO_FAILURE;
+    }
+    return E_TKEY_CRYPTO_SUCCESS;
+}
+
+TKey_VOID TKey_Crypto_SetLocalKey(TKey_CryptoKey_t *psKey,
+        TKey_CryptoKeyType_t eType, const TKey_BYTE *pucKey,
+        TKey_UINT32 uiKeyLen)
+{
+    memset(psKey, 0, sizeof(TKey_CryptoKey_t));
+    psKey->eLocation = E_TKEY_CRYPTO_KEY_LOCAL;
+    psKey->eType = eType;
+    psKey->pucKey = pucKey;
+    psKey->uiKeyLen = uiKeyLen;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_ImportKey(TKey_UINT32 uiDriverId,
+        TKey_CryptoKeyType_t eType, const TKey_BYTE *pucKey,
+        TKey_UINT32 uiKeyLen, TKey_CryptoKey_t *psKey)
+{
+    const TKey_CryptoOpaqueDrv_t *psDrv = TKey_Crypto_GetOpaqueDriver(uiDriverId);
+    TKey_CryptoStatus_t eStatus;
+    TKey_UINT32 uiSlot = 0;
+
+    if(TKey_NULL == psDrv || TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(TKey_NULL == psDrv->eImportKey) {
+        return E_TKEY_CRYPTO_NOT_SUPPORTED;
+    }
+    eStatus = psDrv->eImportKey(eType, pucKey, uiKeyLen, &uiSlot);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        memset(psKey, 0, sizeof(TKey_CryptoKey_t));
+        psKey->eLocation = E_TKEY_CRYPTO_KEY_OPAQUE;
+        psKey->eType = eType;
+        psKey->uiDriverId = uiDriverId;
+        psKey->uiSlot = uiSlot;
+        psKey->uiKeyLen = uiKeyLen;
+    }
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_GenerateKey(TKey_UINT32 uiDriverId,
+        TKey_CryptoKeyType_t eType, TKey_UINT32 uiKeyLen,
+        TKey_CryptoKey_t *psKey)
+{
+    const TKey_CryptoOpaqueDrv_t *psDrv = TKey_Crypto_GetOpaqueDriver(uiDriverId);
+    TKey_CryptoStatus_t eStatus;
+    TKey_UINT32 uiSlot = 0;
+
+    if(TKey_NULL == psDrv || TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(TKey_NULL == psDrv->eGenerateKey) {
+        return E_TKEY_CRYPTO_NOT_SUPPORTED;
+    }
+    eStatus = psDrv->eGenerateKey(eType, uiKeyLen, &uiSlot);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        memset(psKey, 0, sizeof(TKey_CryptoKey_t));
+        psKey->eLocation = E_TKEY_CRYPTO_KEY_OPAQUE;
+        psKey->eType = eType;
+        psKey->uiDriverId = uiDriverId;
+        psKey->uiSlot = uiSlot;
+        psKey->uiKeyLen = uiKeyLen;
+    }
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_DestroyKey(TKey_CryptoKey_t *psKey)
+{
+    TKey_CryptoStatus_t eStatus = E_TKEY_CRYPTO_SUCCESS;
+
+    if(TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(E_TKEY_CRYPTO_KEY_OPAQUE == psKey->eLocation) {
+        const TKey_CryptoOpaqueDrv_t *psDrv =
+            TKey_Crypto_GetOpaqueDriver(psKey->uiDriverId);
+        if(TKey_NULL == psDrv || TKey_NULL == psDrv->eDestroyKey) {
+            return E_TKEY_CRYPTO_INVALID_ARG;
+        }
+        eStatus = psDrv->eDestroyKey(psKey->uiSlot);
+    }
+    memset(psKey, 0, sizeof(TKey_CryptoKey_t));
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_AesEcbEncrypt(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucIn, TKey_BYTE *pucOut)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(TKey_NULL == psKey || E_TKEY_CRYPTO_KEY_LOCAL != psKey->eLocation) {
+        /* Raw block encryption is not exposed by opaque drivers */
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    TKEY_CRYPTO_DISPATCH(eStatus, eAesEcbEncrypt, psKey->pucKey,
+                         psKey->uiKeyLen, pucIn, pucOut);
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_AesCcmEncrypt(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        TKey_BYTE *pucTag, TKey_UINT32 uiTagLen)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(E_TKEY_CRYPTO_KEY_OPAQUE == psKey->eLocation) {
+        TKEY_CRYPTO_OPAQUE_CALL(eStatus, psKey, eAesCcmEncrypt, pucNonce,
+                uiNonceLen, pucAad, uiAadLen, pucIn, uiLen, pucOut, pucTag,
+                uiTagLen);
+    } else {
+        TKEY_CRYPTO_DISPATCH(eStatus, eAesCcmEncrypt, psKey->pucKey,
+                psKey->uiKeyLen, pucNonce, uiNonceLen, pucAad, uiAadLen,
+                pucIn, uiLen, pucOut, pucTag, uiTagLen);
+    }
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_AesCcmDecrypt(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        const TKey_BYTE *pucTag, TKey_UINT32 uiTagLen)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(E_TKEY_CRYPTO_KEY_OPAQUE == psKey->eLocation) {
+        TKEY_CRYPTO_OPAQUE_CALL(eStatus, psKey, eAesCcmDecrypt, pucNonce,
+                uiNonceLen, pucAad, uiAadLen, pucIn, uiLen, pucOut, pucTag,
+                uiTagLen);
+    } else {
+        TKEY_CRYPTO_DISPATCH(eStatus, eAesCcmDecrypt, psKey->pucKey,
+                psKey->uiKeyLen, pucNonce, uiNonceLen, pucAad, uiAadLen,
+                pucIn, uiLen, pucOut, pucTag, uiTagLen);
+    }
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_AesCmac(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucMsg, TKey_UINT32 uiLen, TKey_BYTE *pucMac)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(E_TKEY_CRYPTO_KEY_OPAQUE == psKey->eLocation) {
+        TKEY_CRYPTO_OPAQUE_CALL(eStatus, psKey, eAesCmac, pucMsg, uiLen,
+                                pucMac);
+    } else {
+        TKEY_CRYPTO_DISPATCH(eStatus, eAesCmac, psKey->pucKey,
+                             psKey->uiKeyLen, pucMsg, uiLen, pucMac);
+    }
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_Sha256(const TKey_BYTE *pucMsg,
+        TKey_UINT32 uiLen, TKey_BYTE *pucDigest)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    TKEY_CRYPTO_DISPATCH(eStatus, eSha256, pucMsg, uiLen, pucDigest);
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_HkdfSha256(const TKey_BYTE *pucSalt,
+        TKey_UINT32 uiSaltLen, const TKey_BYTE *pucIkm, TKey_UINT32 uiIkmLen,
+        const TKey_BYTE *pucInfo, TKey_UINT32 uiInfoLen, TKey_BYTE *pucOkm,
+        TKey_UINT32 uiOkmLen)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    TKEY_CRYPTO_DISPATCH(eStatus, eHkdfSha256, pucSalt, uiSaltLen, pucIkm,
+                         uiIkmLen, pucInfo, uiInfoLen, pucOkm, uiOkmLen);
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_EcP256PublicKey(const TKey_CryptoKey_t *psKey,
+        TKey_BYTE *pucPub)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(E_TKEY_CRYPTO_KEY_OPAQUE == psKey->eLocation) {
+        TKEY_CRYPTO_OPAQUE_CALL(eStatus, psKey, eExportPublicKey, pucPub);
+    } else {
+        TKEY_CRYPTO_DISPATCH(eStatus, eEcP256PublicKey, psKey->pucKey, pucPub);
+    }
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_EcdhP256(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucPeerPub, TKey_BYTE *pucSecret)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(E_TKEY_CRYPTO_KEY_OPAQUE == psKey->eLocation) {
+        TKEY_CRYPTO_OPAQUE_CALL(eStatus, psKey, eEcdhP256, pucPeerPub,
+                                pucSecret);
+    } else {
+        TKEY_CRYPTO_DISPATCH(eStatus, eEcdhP256, psKey->pucKey, pucPeerPub,
+                             pucSecret);
+    }
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_EcdsaP256Sign(const TKey_CryptoKey_t *psKey,
+        const TKey_BYTE *pucHash, TKey_BYTE *pucSig)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(TKey_NULL == psKey) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(E_TKEY_CRYPTO_KEY_OPAQUE == psKey->eLocation) {
+        TKEY_CRYPTO_OPAQUE_CALL(eStatus, psKey, eEcdsaP256Sign, pucHash,
+                                pucSig);
+    } else {
+        TKEY_CRYPTO_DISPATCH(eStatus, eEcdsaP256Sign, psKey->pucKey, pucHash,
+                             pucSig);
+    }
+    return eStatus;
+}
+
+TKey_CryptoStatus_t TKey_Crypto_EcdsaP256Verify(const TKey_BYTE *pucPub,
+        const TKey_BYTE *pucHash, const TKey_BYTE *pucSig)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    TKEY_CRYPTO_DISPATCH(eStatus, eEcdsaP256Verify, pucPub, pucHash, pucSig);
+    return eStatus;
+}
+
+/*
+ * Driver conformance self-test
+ */
+
+/* FIPS-197 C.1 */
+static const TKey_BYTE gaucAesKey[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+static const TKey_BYTE gaucAesPt[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+    0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+static const TKey_BYTE gaucAesCt[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+
+/* RFC 3610 packet vector #1 */
+static const TKey_BYTE gaucCcmKey[16] = {
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+    0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf };
+static const TKey_BYTE gaucCcmNonce[13] = {
+    0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0,
+    0xa1, 0xa2, 0xa3, 0xa4, 0xa5 };
+static const TKey_BYTE gaucCcmAad[8] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+static const TKey_BYTE gaucCcmPt[23] = {
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e };
+static const TKey_BYTE gaucCcmCt[23] = {
+    0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+    0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+    0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84 };
+static const TKey_BYTE gaucCcmTag[8] = {
+    0x17, 0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0 };
+
+/* RFC 4493 example 2 */
+static const TKey_BYTE gaucCmacKey[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+static const TKey_BYTE gaucCmacMsg[16] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a };
+static const TKey_BYTE gaucCmacMac[16] = {
+    0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44,
+    0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c };
+
+/* FIPS 180-2 "abc" */
+static const TKey_BYTE gaucShaDigest[32] = {
+    0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+    0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+    0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+    0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad };
+
+/* RFC 5869 test case 1 */
+static const TKey_BYTE gaucHkdfSalt[13] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c };
+static const TKey_BYTE gaucHkdfInfo[10] = {
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9 };
+static const TKey_BYTE gaucHkdfOkm[42] = {
+    0x3c, 0xb2, 0x5f, 0x25, 0xfa, 0xac, 0xd5, 0x7a,
+    0x90, 0x43, 0x4f, 0x64, 0xd0, 0x36, 0x2f, 0x2a,
+    0x2d, 0x2d, 0x0a, 0x90, 0xcf, 0x1a, 0x5a, 0x4c,
+    0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf,
+    0x34, 0x00, 0x72, 0x08, 0xd5, 0xb8, 0x87, 0x18,
+    0x58, 0x65 };
+
+/* RFC 6979 A.2.5, P-256 with SHA-256, message "sample" */
+static const TKey_BYTE gaucEcPriv[32] = {
+    0xc9, 0xaf, 0xa9, 0xd8, 0x45, 0xba, 0x75, 0x16,
+    0x6b, 0x5c, 0x21, 0x57, 0x67, 0xb1, 0xd6, 0x93,
+    0x4e, 0x50, 0xc3, 0xdb, 0x36, 0xe8, 0x9b, 0x12,
+    0x7b, 0x8a, 0x62, 0x2b, 0x12, 0x0f, 0x67, 0x21 };
+static const TKey_BYTE gaucEcPub[65] = {
+    0x04,
+    0x60, 0xfe, 0xd4, 0xba, 0x25, 0x5a, 0x9d, 0x31,
+    0xc9, 0x61, 0xeb, 0x74, 0xc6, 0x35, 0x6d, 0x68,
+    0xc0, 0x49, 0xb8, 0x92, 0x3b, 0x61, 0xfa, 0x6c,
+    0xe6, 0x69, 0x62, 0x2e, 0x60, 0xf2, 0x9f, 0xb6,
+    0x79, 0x03, 0xfe, 0x10, 0x08, 0xb8, 0xbc, 0x99,
+    0xa4, 0x1a, 0xe9, 0xe9, 0x56, 0x28, 0xbc, 0x64,
+    0xf2, 0xf1, 0xb2, 0x0c, 0x2d, 0x7e, 0x9f, 0x51,
+    0x77, 0xa3, 0xc2, 0x94, 0xd4, 0x46, 0x22, 0x99 };
+static const TKey_BYTE gaucEcHash[32] = {
+    0xaf, 0x2b, 0xdb, 0xe1, 0xaa, 0x9b, 0x6e, 0xc1,
+    0xe2, 0xad, 0xe1, 0xd6, 0x94, 0xf4, 0x1f, 0xc7,
+    0x1a, 0x83, 0x1d, 0x02, 0x68, 0xe9, 0x89, 0x15,
+    0x62, 0x11, 0x3d, 0x8a, 0x62, 0xad, 0xd1, 0xbf };
+static const TKey_BYTE gaucEcSig[64] = {
+    0xef, 0xd4, 0x8b, 0x2a, 0xac, 0xb6, 0xa8, 0xfd,
+    0x11, 0x40, 0xdd, 0x9c, 0xd4, 0x5e, 0x81, 0xd6,
+    0x9d, 0x2c, 0x87, 0x7b, 0x56, 0xaa, 0xf9, 0x91,
+    0xc3, 0x4d, 0x0e, 0xa8, 0x4e, 0xaf, 0x37, 0x16,
+    0xf7, 0xcb, 0x1c, 0x94, 0x2d, 0x65, 0x7c, 0x41,
+    0xd4, 0x36, 0xc7, 0xa1, 0xb6, 0xe2, 0x9f, 0x65,
+    0xf3, 0xe9, 0x00, 0xdb, 0xb9, 0xaf, 0xf4, 0x06,
+    0x4d, 0xc4, 0xab, 0x2f, 0x84, 0x3a, 0xcd, 0xa8 };
+/* Second party for the ECDH agreement check */
+static const TKey_BYTE gaucEcPeerPriv[32] = {
+    0x3c, 0xb2, 0x5f, 0x25, 0xfa, 0xac, 0xd5, 0x7a,
+    0x90, 0x43, 0x4f, 0x64, 0xd0, 0x36, 0x2f, 0x2a,
+    0x2d, 0x2d, 0x0a, 0x90, 0xcf, 0x1a, 0x5a, 0x4c,
+    0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf };
+
+/* Record the result of one check. E_TKEY_CRYPTO_NOT_SUPPORTED from a driver
+ * is not a failure: the operation will fall through to the next driver. */
+static TKey_INT32 tkey_crypto_check(TKey_INT32 iVerbose, const TKey_CHAR *pcDrv,
+                                    const TKey_CHAR *pcTest,
+                                    TKey_CryptoStatus_t eStatus,
+                                    TKey_BOOL bMatch)
+{
+    if(E_TKEY_CRYPTO_NOT_SUPPORTED == eStatus) {
+        if(iVerbose) {
+            mbedtls_printf("  %s %s: skipped\n", pcDrv, pcTest);
+        }
+        return 0;
+    }
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus && bMatch) {
+        if(iVerbose) {
+            mbedtls_printf("  %s %s: passed\n", pcDrv, pcTest);
+        }
+        return 0;
+    }
+    if(iVerbose) {
+        mbedtls_printf("  %s %s: failed (%d)\n", pcDrv, pcTest, (int)eStatus);
+    }
+    return 1;
+}
+
+/* Run the known-answer vectors through one transparent driver */
+static TKey_INT32 tkey_crypto_selftest_transparent(
+        const TKey_CryptoTransparentDrv_t *psDrv, TKey_INT32 iVerbose)
+{
+    TKey_BYTE aucOut[64];
+    TKey_BYTE aucTag[16];
+    TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    TKey_BYTE aucSecretA[TKEY_CRYPTO_P256_SECRET_SIZE];
+    TKey_BYTE aucSecretB[TKEY_CRYPTO_P256_SECRET_SIZE];
+    TKey_CryptoStatus_t eStatus;
+    TKey_INT32 iFailed = 0;
+    const TKey_CHAR *pcName = psDrv->pcName;
+
+    if(TKey_NULL != psDrv->eAesEcbEncrypt) {
+        eStatus = psDrv->eAesEcbEncrypt(gaucAesKey, sizeof(gaucAesKey),
+                                        gaucAesPt, aucOut);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "AES-ECB", eStatus,
+                        0 == memcmp(aucOut, gaucAesCt, sizeof(gaucAesCt)));
+    }
+    if(TKey_NULL != psDrv->eAesCcmEncrypt) {
+        eStatus = psDrv->eAesCcmEncrypt(gaucCcmKey, sizeof(gaucCcmKey),
+                        gaucCcmNonce, sizeof(gaucCcmNonce), gaucCcmAad,
+                        sizeof(gaucCcmAad), gaucCcmPt, sizeof(gaucCcmPt),
+                        aucOut, aucTag, sizeof(gaucCcmTag));
+        iFailed += tkey_crypto_check(iVerbose, pcName, "AES-CCM enc", eStatus,
+                        0 == memcmp(aucOut, gaucCcmCt, sizeof(gaucCcmCt)) &&
+                        0 == memcmp(aucTag, gaucCcmTag, sizeof(gaucCcmTag)));
+    }
+    if(TKey_NULL != psDrv->eAesCcmDecrypt) {
+        eStatus = psDrv->eAesCcmDecrypt(gaucCcmKey, sizeof(gaucCcmKey),
+                        gaucCcmNonce, sizeof(gaucCcmNonce), gaucCcmAad,
+                        sizeof(gaucCcmAad), gaucCcmCt, sizeof(gaucCcmCt),
+                        aucOut, gaucCcmTag, sizeof(gaucCcmTag));
+        iFailed += tkey_crypto_check(iVerbose, pcName, "AES-CCM dec", eStatus,
+                        0 == memcmp(aucOut, gaucCcmPt, sizeof(gaucCcmPt)));
+        /* A corrupted tag must be rejected */
+        memcpy(aucTag, gaucCcmTag, sizeof(gaucCcmTag));
+        aucTag[0] ^= 0x01;
+        eStatus = psDrv->eAesCcmDecrypt(gaucCcmKey, sizeof(gaucCcmKey),
+                        gaucCcmNonce, sizeof(gaucCcmNonce), gaucCcmAad,
+                        sizeof(gaucCcmAad), gaucCcmCt, sizeof(gaucCcmCt),
+                        aucOut, aucTag, sizeof(gaucCcmTag));
+        iFailed += tkey_crypto_check(iVerbose, pcName, "AES-CCM bad tag",
+                        (E_TKEY_CRYPTO_AUTH_FAILED == eStatus) ?
+                        E_TKEY_CRYPTO_SUCCESS : eStatus, TKey_TRUE);
+    }
+    if(TKey_NULL != psDrv->eAesCmac) {
+        eStatus = psDrv->eAesCmac(gaucCmacKey, sizeof(gaucCmacKey),
+                                  gaucCmacMsg, sizeof(gaucCmacMsg), aucOut);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "AES-CMAC", eStatus,
+                        0 == memcmp(aucOut, gaucCmacMac, sizeof(gaucCmacMac)));
+    }
+    if(TKey_NULL != psDrv->eSha256) {
+        eStatus = psDrv->eSha256((const TKey_BYTE *)"abc", 3, aucOut);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "SHA-256", eStatus,
+                        0 == memcmp(aucOut, gaucShaDigest,
+                                    sizeof(gaucShaDigest)));
+    }
+    if(TKey_NULL != psDrv->eHkdfSha256) {
+        TKey_BYTE aucIkm[22];
+        memset(aucIkm, 0x0b, sizeof(aucIkm));
+        eStatus = psDrv->eHkdfSha256(gaucHkdfSalt, sizeof(gaucHkdfSalt),
+                        aucIkm, sizeof(aucIkm), gaucHkdfInfo,
+                        sizeof(gaucHkdfInfo), aucOut, sizeof(gaucHkdfOkm));
+        iFailed += tkey_crypto_check(iVerbose, pcName, "HKDF-SHA256", eStatus,
+                        0 == memcmp(aucOut, gaucHkdfOkm, sizeof(gaucHkdfOkm)));
+    }
+    if(TKey_NULL != psDrv->eEcP256PublicKey) {
+        eStatus = psDrv->eEcP256PublicKey(gaucEcPriv, aucPub);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "P-256 pubkey",
+                        eStatus, 0 == memcmp(aucPub, gaucEcPub,
+                                             sizeof(gaucEcPub)));
+    }
+    if(TKey_NULL != psDrv->eEcdsaP256Sign) {
+        eStatus = psDrv->eEcdsaP256Sign(gaucEcPriv, gaucEcHash, aucOut);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "ECDSA sign", eStatus,
+                        0 == memcmp(aucOut, gaucEcSig, sizeof(gaucEcSig)));
+    }
+    if(TKey_NULL != psDrv->eEcdsaP256Verify) {
+        eStatus = psDrv->eEcdsaP256Verify(gaucEcPub, gaucEcHash, gaucEcSig);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "ECDSA verify",
+                                     eStatus, TKey_TRUE);
+        memcpy(aucOut, gaucEcSig, sizeof(gaucEcSig));
+        aucOut[10] ^= 0x01;
+        eStatus = psDrv->eEcdsaP256Verify(gaucEcPub, gaucEcHash, aucOut);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "ECDSA bad sig",
+                        (E_TKEY_CRYPTO_AUTH_FAILED == eStatus) ?
+                        E_TKEY_CRYPTO_SUCCESS : eStatus, TKey_TRUE);
+    }
+    if(TKey_NULL != psDrv->eEcdhP256) {
+        /* Both sides must agree; peer public keys come from the software
+         * driver so an accelerator is checked against the reference */
+        TKey_BYTE aucPeerPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+        gsTKeyCryptoSwDriver.eEcP256PublicKey(gaucEcPeerPriv, aucPeerPub);
+        eStatus = psDrv->eEcdhP256(gaucEcPriv, aucPeerPub, aucSecretA);
+        if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+            gsTKeyCryptoSwDriver.eEcdhP256(gaucEcPeerPriv, gaucEcPub,
+                                           aucSecretB);
+        }
+        iFailed += tkey_crypto_check(iVerbose, pcName, "ECDH", eStatus,
+                        0 == memcmp(aucSecretA, aucSecretB,
+                                    sizeof(aucSecretA)));
+    }
+    return iFailed;
+}
+
+/* Import the known-answer keys into one opaque driver and run them */
+static TKey_INT32 tkey_crypto_selftest_opaque(
+        const TKey_CryptoOpaqueDrv_t *psDrv, TKey_INT32 iVerbose)
+{
+    TKey_CryptoKey_t sAesKey;
+    TKey_CryptoKey_t sCmacKey;
+    TKey_CryptoKey_t sEcKey;
+    TKey_BYTE aucOut[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    TKey_BYTE aucTag[16];
+    TKey_CryptoStatus_t eStatus;
+    TKey_INT32 iFailed = 0;
+    const TKey_CHAR *pcName = psDrv->pcName;
+
+    memset(&sAesKey, 0, sizeof(sAesKey));
+    memset(&sCmacKey, 0, sizeof(sCmacKey));
+    memset(&sEcKey, 0, sizeof(sEcKey));
+
+    eStatus = TKey_Crypto_ImportKey(psDrv->uiDriverId, E_TKEY_CRYPTO_KEY_AES,
+                                    gaucCcmKey, sizeof(gaucCcmKey), &sAesKey);
+    iFailed += tkey_crypto_check(iVerbose, pcName, "import AES", eStatus,
+                                 TKey_TRUE);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        eStatus = TKey_Crypto_AesCcmEncrypt(&sAesKey, gaucCcmNonce,
+                        sizeof(gaucCcmNonce), gaucCcmAad, sizeof(gaucCcmAad),
+                        gaucCcmPt, sizeof(gaucCcmPt), aucOut, aucTag,
+                        sizeof(gaucCcmTag));
+        iFailed += tkey_crypto_check(iVerbose, pcName, "AES-CCM enc", eStatus,
+                        0 == memcmp(aucOut, gaucCcmCt, sizeof(gaucCcmCt)) &&
+                        0 == memcmp(aucTag, gaucCcmTag, sizeof(gaucCcmTag)));
+        eStatus = TKey_Crypto_AesCcmDecrypt(&sAesKey, gaucCcmNonce,
+                        sizeof(gaucCcmNonce), gaucCcmAad, sizeof(gaucCcmAad),
+                        gaucCcmCt, sizeof(gaucCcmCt), aucOut, gaucCcmTag,
+                        sizeof(gaucCcmTag));
+        iFailed += tkey_crypto_check(iVerbose, pcName, "AES-CCM dec", eStatus,
+                        0 == memcmp(aucOut, gaucCcmPt, sizeof(gaucCcmPt)));
+        TKey_Crypto_DestroyKey(&sAesKey);
+    }
+
+    eStatus = TKey_Crypto_ImportKey(psDrv->uiDriverId, E_TKEY_CRYPTO_KEY_AES,
+                                    gaucCmacKey, sizeof(gaucCmacKey),
+                                    &sCmacKey);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        eStatus = TKey_Crypto_AesCmac(&sCmacKey, gaucCmacMsg,
+                                      sizeof(gaucCmacMsg), aucOut);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "AES-CMAC", eStatus,
+                        0 == memcmp(aucOut, gaucCmacMac, sizeof(gaucCmacMac)));
+        TKey_Crypto_DestroyKey(&sCmacKey);
+    }
+
+    eStatus = TKey_Crypto_ImportKey(psDrv->uiDriverId,
+                                    E_TKEY_CRYPTO_KEY_P256_PRIVATE,
+                                    gaucEcPriv, sizeof(gaucEcPriv), &sEcKey);
+    iFailed += tkey_crypto_check(iVerbose, pcName, "import P-256", eStatus,
+                                 TKey_TRUE);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        eStatus = TKey_Crypto_EcP256PublicKey(&sEcKey, aucOut);
+        iFailed += tkey_crypto_check(iVerbose, pcName, "export pubkey",
+                        eStatus, 0 == memcmp(aucOut, gaucEcPub,
+                                             sizeof(gaucEcPub)));
+        eStatus = TKey_Crypto_EcdsaP256Sign(&sEcKey, gaucEcHash, aucOut);
+        if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+            /* Opaque signers may randomise k, so check by verification */
+            eStatus = TKey_Crypto_EcdsaP256Verify(gaucEcPub, gaucEcHash,
+                                                  aucOut);
+        }
+        iFailed += tkey_crypto_check(iVerbose, pcName, "ECDSA sign", eStatus,
+                                     TKey_TRUE);
+        TKey_Crypto_DestroyKey(&sEcKey);
+    }
+    return iFailed;
+}
+
+TKey_INT32 TKey_Crypto_SelfTest(TKey_INT32 iVerbose)
+{
+    const TKey_CryptoTransparentDrv_t *psDrv;
+    TKey_UINT32 uiIndex = 0;
+    TKey_INT32 iFailed = 0;
+
+    if(iVerbose) {
+        mbedtls_printf("  THINKey crypto driver self-test\n");
+    }
+    while(TKey_NULL != (psDrv = TKey_Crypto_GetTransparentDriver(uiIndex++))) {
+        iFailed += tkey_crypto_selftest_transparent(psDrv, iVerbose);
+    }
+    for(uiIndex = 0; uiIndex < guiNumOpaqueDrivers; uiIndex++) {
+        iFailed += tkey_crypto_selftest_opaque(gpsOpaqueDrivers[uiIndex],
+                                               iVerbose);
+    }
+    if(iVerbose) {
+        mbedtls_printf("  THINKey crypto driver self-test: %s\n\n",
+                       (0 == iFailed) ? "passed" : "FAILED");
+    }
+    return iFailed;
+}
+
+#if defined(THINKEY_CRYPTO_SELFTEST_MAIN)
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    if(E_TKEY_SUCCESS != TKey_Crypto_Init()) {
+        return 1;
+    }
+    return (0 == TKey_Crypto_SelfTest(1)) ? 0 : 1;
+}
+#endif /* THINKEY_CRYPTO_SELFTEST_MAIN */
@@ -0,0 +1,615 @@
+/*
+ * \file thinkey_crypto_drv_sw.c
+ *
+ * \brief Software reference crypto drivers built on the mbedtls legacy APIs
+ *
+ * gsTKeyCryptoSwDriver is the transparent fallback used when no accelerator
+ * handles an operation. gsTKeyCryptoSwOpaqueDriver keeps keys in RAM slots
+ * and serves as the reference implementation of the opaque driver model.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_crypto_drv.h"
+#include "mbedtls/aes.h"
+#include "mbedtls/ccm.h"
+#include "mbedtls/cmac.h"
+#include "mbedtls/cipher.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/hkdf.h"
+#include "mbedtls/md.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/hmac_drbg.h"
+#include "mbedtls/platform_util.h"
+#include <string.h>
+
+/* Translate an mbedtls return code to a crypto driver status */
+static TKey_CryptoStatus_t tkey_crypto_sw_status(int iRet)
+{
+    TKey_CryptoStatus_t eStatus = E_TKEY_CRYPTO_FAILURE;
+
+    if(0 == iRet) {
+        eStatus = E_TKEY_CRYPTO_SUCCESS;
+    } else if(MBEDTLS_ERR_CCM_AUTH_FAILED == iRet ||
+              MBEDTLS_ERR_ECP_VERIFY_FAILED == iRet) {
+        eStatus = E_TKEY_CRYPTO_AUTH_FAILED;
+    } else if(MBEDTLS_ERR_CCM_BAD_INPUT == iRet ||
+              MBEDTLS_ERR_AES_INVALID_KEY_LENGTH == iRet ||
+              MBEDTLS_ERR_ECP_BAD_INPUT_DATA == iRet ||
+              MBEDTLS_ERR_ECP_INVALID_KEY == iRet ||
+              MBEDTLS_ERR_HKDF_BAD_INPUT_DATA == iRet) {
+        eStatus = E_TKEY_CRYPTO_INVALID_ARG;
+    } else if(MBEDTLS_ERR_ECP_ALLOC_FAILED == iRet ||
+              MBEDTLS_ERR_MPI_ALLOC_FAILED == iRet) {
+        eStatus = E_TKEY_CRYPTO_NO_MEMORY;
+    }
+    return eStatus;
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_aes_ecb_encrypt(
+        const TKey_BYTE *pucKey, TKey_UINT32 uiKeyLen,
+        const TKey_BYTE *pucIn, TKey_BYTE *pucOut)
+{
+    mbedtls_aes_context sAes;
+    int iRet;
+
+    mbedtls_aes_init(&sAes);
+    do {
+        iRet = mbedtls_aes_setkey_enc(&sAes, pucKey, uiKeyLen * 8);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_aes_crypt_ecb(&sAes, MBEDTLS_AES_ENCRYPT, pucIn, pucOut);
+    } while(TKey_EXIT);
+    mbedtls_aes_free(&sAes);
+    return tkey_crypto_sw_status(iRet);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_aes_ccm_encrypt(
+        const TKey_BYTE *pucKey, TKey_UINT32 uiKeyLen,
+        const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        TKey_BYTE *pucTag, TKey_UINT32 uiTagLen)
+{
+    mbedtls_ccm_context sCcm;
+    int iRet;
+
+    mbedtls_ccm_init(&sCcm);
+    do {
+        iRet = mbedtls_ccm_setkey(&sCcm, MBEDTLS_CIPHER_ID_AES, pucKey,
+                                  uiKeyLen * 8);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ccm_encrypt_and_tag(&sCcm, uiLen, pucNonce, uiNonceLen,
+                                           pucAad, uiAadLen, pucIn, pucOut,
+                                           pucTag, uiTagLen);
+    } while(TKey_EXIT);
+    mbedtls_ccm_free(&sCcm);
+    return tkey_crypto_sw_status(iRet);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_aes_ccm_decrypt(
+        const TKey_BYTE *pucKey, TKey_UINT32 uiKeyLen,
+        const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        const TKey_BYTE *pucTag, TKey_UINT32 uiTagLen)
+{
+    mbedtls_ccm_context sCcm;
+    int iRet;
+
+    mbedtls_ccm_init(&sCcm);
+    do {
+        iRet = mbedtls_ccm_setkey(&sCcm, MBEDTLS_CIPHER_ID_AES, pucKey,
+                                  uiKeyLen * 8);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ccm_auth_decrypt(&sCcm, uiLen, pucNonce, uiNonceLen,
+                                        pucAad, uiAadLen, pucIn, pucOut,
+                                        pucTag, uiTagLen);
+    } while(TKey_EXIT);
+    mbedtls_ccm_free(&sCcm);
+    return tkey_crypto_sw_status(iRet);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_aes_cmac(const TKey_BYTE *pucKey,
+        TKey_UINT32 uiKeyLen, const TKey_BYTE *pucMsg, TKey_UINT32 uiLen,
+        TKey_BYTE *pucMac)
+{
+    const mbedtls_cipher_info_t *psInfo;
+
+    if(TKEY_CRYPTO_AES128_KEY_SIZE == uiKeyLen) {
+        psInfo = mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_128_ECB);
+    } else if(TKEY_CRYPTO_AES256_KEY_SIZE == uiKeyLen) {
+        psInfo = mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_256_ECB);
+    } else {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_sw_status(mbedtls_cipher_cmac(psInfo, pucKey,
+                                 uiKeyLen * 8, pucMsg, uiLen, pucMac));
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_sha256(const TKey_BYTE *pucMsg,
+        TKey_UINT32 uiLen, TKey_BYTE *pucDigest)
+{
+    return tkey_crypto_sw_status(mbedtls_sha256_ret(pucMsg, uiLen,
+                                                    pucDigest, 0));
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_hkdf_sha256(
+        const TKey_BYTE *pucSalt, TKey_UINT32 uiSaltLen,
+        const TKey_BYTE *pucIkm, TKey_UINT32 uiIkmLen,
+        const TKey_BYTE *pucInfo, TKey_UINT32 uiInfoLen,
+        TKey_BYTE *pucOkm, TKey_UINT32 uiOkmLen)
+{
+    return tkey_crypto_sw_status(mbedtls_hkdf(
+                mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                pucSalt, uiSaltLen, pucIkm, uiIkmLen, pucInfo, uiInfoLen,
+                pucOkm, uiOkmLen));
+}
+
+/* Load the P-256 group and, when given, the private scalar */
+static int tkey_crypto_sw_load_priv(mbedtls_ecp_group *psGrp, mbedtls_mpi *psD,
+                                    const TKey_BYTE *pucPriv)
+{
+    int iRet;
+
+    do {
+        iRet = mbedtls_ecp_group_load(psGrp, MBEDTLS_ECP_DP_SECP256R1);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_mpi_read_binary(psD, pucPriv,
+                                       TKEY_CRYPTO_P256_PRIV_KEY_SIZE);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ecp_check_privkey(psGrp, psD);
+    } while(TKey_EXIT);
+    return iRet;
+}
+
+/* Seed a blinding DRBG from the private key and the operation input. The
+ * blinding values only protect against side channels, they do not affect
+ * the result, so a per-operation deterministic seed is sufficient and keeps
+ * the driver independent of an entropy source. */
+static int tkey_crypto_sw_blind_seed(mbedtls_hmac_drbg_context *psDrbg,
+                                     const TKey_BYTE *pucPriv,
+                                     const TKey_BYTE *pucData,
+                                     TKey_UINT32 uiDataLen)
+{
+    TKey_BYTE aucSeed[TKEY_CRYPTO_P256_PRIV_KEY_SIZE + TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    int iRet;
+
+    memcpy(aucSeed, pucPriv, TKEY_CRYPTO_P256_PRIV_KEY_SIZE);
+    memcpy(&aucSeed[TKEY_CRYPTO_P256_PRIV_KEY_SIZE], pucData, uiDataLen);
+    iRet = mbedtls_hmac_drbg_seed_buf(psDrbg,
+                mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), aucSeed,
+                TKEY_CRYPTO_P256_PRIV_KEY_SIZE + uiDataLen);
+    mbedtls_platform_zeroize(aucSeed, sizeof(aucSeed));
+    return iRet;
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_ec_p256_public_key(
+        const TKey_BYTE *pucPriv, TKey_BYTE *pucPub)
+{
+    mbedtls_ecp_group sGrp;
+    mbedtls_mpi sD;
+    mbedtls_ecp_point sQ;
+    size_t uiOutLen = 0;
+    int iRet;
+
+    mbedtls_ecp_group_init(&sGrp);
+    mbedtls_mpi_init(&sD);
+    mbedtls_ecp_point_init(&sQ);
+    do {
+        iRet = tkey_crypto_sw_load_priv(&sGrp, &sD, pucPriv);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ecp_mul(&sGrp, &sQ, &sD, &sGrp.G, NULL, NULL);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ecp_point_write_binary(&sGrp, &sQ,
+                    MBEDTLS_ECP_PF_UNCOMPRESSED, &uiOutLen, pucPub,
+                    TKEY_CRYPTO_P256_PUB_KEY_SIZE);
+    } while(TKey_EXIT);
+    mbedtls_ecp_point_free(&sQ);
+    mbedtls_mpi_free(&sD);
+    mbedtls_ecp_group_free(&sGrp);
+    return tkey_crypto_sw_status(iRet);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_ecdh_p256(const TKey_BYTE *pucPriv,
+        const TKey_BYTE *pucPeerPub, TKey_BYTE *pucSecret)
+{
+    mbedtls_ecp_group sGrp;
+    mbedtls_mpi sD;
+    mbedtls_mpi sZ;
+    mbedtls_ecp_point sQp;
+    mbedtls_hmac_drbg_context sDrbg;
+    int iRet;
+
+    mbedtls_ecp_group_init(&sGrp);
+    mbedtls_mpi_init(&sD);
+    mbedtls_mpi_init(&sZ);
+    mbedtls_ecp_point_init(&sQp);
+    mbedtls_hmac_drbg_init(&sDrbg);
+    do {
+        iRet = tkey_crypto_sw_load_priv(&sGrp, &sD, pucPriv);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ecp_point_read_binary(&sGrp, &sQp, pucPeerPub,
+                                             TKEY_CRYPTO_P256_PUB_KEY_SIZE);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ecp_check_pubkey(&sGrp, &sQp);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = tkey_crypto_sw_blind_seed(&sDrbg, pucPriv, pucPeerPub,
+                                         TKEY_CRYPTO_P256_PUB_KEY_SIZE);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ecdh_compute_shared(&sGrp, &sZ, &sQp, &sD,
+                                           mbedtls_hmac_drbg_random, &sDrbg);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_mpi_write_binary(&sZ, pucSecret,
+                                        TKEY_CRYPTO_P256_SECRET_SIZE);
+    } while(TKey_EXIT);
+    mbedtls_hmac_drbg_free(&sDrbg);
+    mbedtls_ecp_point_free(&sQp);
+    mbedtls_mpi_free(&sZ);
+    mbedtls_mpi_free(&sD);
+    mbedtls_ecp_group_free(&sGrp);
+    return tkey_crypto_sw_status(iRet);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_ecdsa_p256_sign(
+        const TKey_BYTE *pucPriv, const TKey_BYTE *pucHash, TKey_BYTE *pucSig)
+{
+    mbedtls_ecp_group sGrp;
+    mbedtls_mpi sD;
+    mbedtls_mpi sR;
+    mbedtls_mpi sS;
+    mbedtls_hmac_drbg_context sDrbg;
+    int iRet;
+
+    mbedtls_ecp_group_init(&sGrp);
+    mbedtls_mpi_init(&sD);
+    mbedtls_mpi_init(&sR);
+    mbedtls_mpi_init(&sS);
+    mbedtls_hmac_drbg_init(&sDrbg);
+    do {
+        iRet = tkey_crypto_sw_load_priv(&sGrp, &sD, pucPriv);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = tkey_crypto_sw_blind_seed(&sDrbg, pucPriv, pucHash,
+                                         TKEY_CRYPTO_SHA256_SIZE);
+        if(0 != iRet) {
+            break;
+        }
+        /* RFC 6979 deterministic signature, so results are reproducible
+         * across drivers and usable as known-answer vectors */
+        iRet = mbedtls_ecdsa_sign_det_ext(&sGrp, &sR, &sS, &sD, pucHash,
+                    TKEY_CRYPTO_SHA256_SIZE, MBEDTLS_MD_SHA256,
+                    mbedtls_hmac_drbg_random, &sDrbg);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_mpi_write_binary(&sR, pucSig,
+                                        TKEY_CRYPTO_P256_SIG_SIZE / 2);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_mpi_write_binary(&sS,
+                    &pucSig[TKEY_CRYPTO_P256_SIG_SIZE / 2],
+                    TKEY_CRYPTO_P256_SIG_SIZE / 2);
+    } while(TKey_EXIT);
+    mbedtls_hmac_drbg_free(&sDrbg);
+    mbedtls_mpi_free(&sS);
+    mbedtls_mpi_free(&sR);
+    mbedtls_mpi_free(&sD);
+    mbedtls_ecp_group_free(&sGrp);
+    return tkey_crypto_sw_status(iRet);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_ecdsa_p256_verify(
+        const TKey_BYTE *pucPub, const TKey_BYTE *pucHash,
+        const TKey_BYTE *pucSig)
+{
+    mbedtls_ecp_group sGrp;
+    mbedtls_ecp_point sQ;
+    mbedtls_mpi sR;
+    mbedtls_mpi sS;
+    int iRet;
+
+    mbedtls_ecp_group_init(&sGrp);
+    mbedtls_ecp_point_init(&sQ);
+    mbedtls_mpi_init(&sR);
+    mbedtls_mpi_init(&sS);
+    do {
+        iRet = mbedtls_ecp_group_load(&sGrp, MBEDTLS_ECP_DP_SECP256R1);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ecp_point_read_binary(&sGrp, &sQ, pucPub,
+                                             TKEY_CRYPTO_P256_PUB_KEY_SIZE);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_mpi_read_binary(&sR, pucSig,
+                                       TKEY_CRYPTO_P256_SIG_SIZE / 2);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_mpi_read_binary(&sS,
+                    &pucSig[TKEY_CRYPTO_P256_SIG_SIZE / 2],
+                    TKEY_CRYPTO_P256_SIG_SIZE / 2);
+        if(0 != iRet) {
+            break;
+        }
+        iRet = mbedtls_ecdsa_verify(&sGrp, pucHash, TKEY_CRYPTO_SHA256_SIZE,
+                                    &sQ, &sR, &sS);
+    } while(TKey_EXIT);
+    mbedtls_mpi_free(&sS);
+    mbedtls_mpi_free(&sR);
+    mbedtls_ecp_point_free(&sQ);
+    mbedtls_ecp_group_free(&sGrp);
+    return tkey_crypto_sw_status(iRet);
+}
+
+const TKey_CryptoTransparentDrv_t gsTKeyCryptoSwDriver =
+{
+    "sw",
+    TKEY_CRYPTO_DRIVER_ID_SW,
+    tkey_crypto_sw_aes_ecb_encrypt,
+    tkey_crypto_sw_aes_ccm_encrypt,
+    tkey_crypto_sw_aes_ccm_decrypt,
+    tkey_crypto_sw_aes_cmac,
+    tkey_crypto_sw_sha256,
+    tkey_crypto_sw_hkdf_sha256,
+    tkey_crypto_sw_ec_p256_public_key,
+    tkey_crypto_sw_ecdh_p256,
+    tkey_crypto_sw_ecdsa_p256_sign,
+    tkey_crypto_sw_ecdsa_p256_verify
+};
+
+/* Opaque reference driver: key material lives in RAM slots owned by the
+ * driver and is only ever used through the slot number. */
+typedef struct
+{
+    TKey_BOOL bInUse;
+    TKey_CryptoKeyType_t eType;
+    TKey_UINT32 uiKeyLen;
+    TKey_BYTE aucKey[TKEY_CRYPTO_AES256_KEY_SIZE];
+} TKey_CryptoSwKeySlot_t;
+
+static TKey_CryptoSwKeySlot_t gsSwKeySlots[TKEY_CRYPTO_SW_KEY_SLOTS];
+
+static TKey_CryptoSwKeySlot_t* tkey_crypto_sw_slot(TKey_UINT32 uiSlot,
+                                                   TKey_CryptoKeyType_t eType)
+{
+    if(uiSlot >= TKEY_CRYPTO_SW_KEY_SLOTS || !gsSwKeySlots[uiSlot].bInUse ||
+       gsSwKeySlots[uiSlot].eType != eType) {
+        return TKey_NULL;
+    }
+    return &gsSwKeySlots[uiSlot];
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_check_key(TKey_CryptoKeyType_t eType,
+                                                    TKey_UINT32 uiKeyLen)
+{
+    if(E_TKEY_CRYPTO_KEY_AES == eType) {
+        if(TKEY_CRYPTO_AES128_KEY_SIZE == uiKeyLen ||
+           TKEY_CRYPTO_AES256_KEY_SIZE == uiKeyLen) {
+            return E_TKEY_CRYPTO_SUCCESS;
+        }
+    } else if(E_TKEY_CRYPTO_KEY_P256_PRIVATE == eType) {
+        if(TKEY_CRYPTO_P256_PRIV_KEY_SIZE == uiKeyLen) {
+            return E_TKEY_CRYPTO_SUCCESS;
+        }
+    }
+    return E_TKEY_CRYPTO_NOT_SUPPORTED;
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_alloc_slot(TKey_UINT32 *puiSlot)
+{
+    TKey_UINT32 uiSlot;
+
+    for(uiSlot = 0; uiSlot < TKEY_CRYPTO_SW_KEY_SLOTS; uiSlot++) {
+        if(!gsSwKeySlots[uiSlot].bInUse) {
+            *puiSlot = uiSlot;
+            return E_TKEY_CRYPTO_SUCCESS;
+        }
+    }
+    return E_TKEY_CRYPTO_NO_MEMORY;
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_import_key(
+        TKey_CryptoKeyType_t eType, const TKey_BYTE *pucKey,
+        TKey_UINT32 uiKeyLen, TKey_UINT32 *puiSlot)
+{
+    TKey_CryptoStatus_t eStatus;
+    TKey_UINT32 uiSlot = 0;
+
+    do {
+        eStatus = tkey_crypto_sw_check_key(eType, uiKeyLen);
+        if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+            break;
+        }
+        if(E_TKEY_CRYPTO_KEY_P256_PRIVATE == eType) {
+            TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+            /* Reject scalars outside [1, n-1] at import time */
+            eStatus = tkey_crypto_sw_ec_p256_public_key(pucKey, aucPub);
+            if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+                break;
+            }
+        }
+        eStatus = tkey_crypto_sw_alloc_slot(&uiSlot);
+        if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+            break;
+        }
+        memcpy(gsSwKeySlots[uiSlot].aucKey, pucKey, uiKeyLen);
+        gsSwKeySlots[uiSlot].uiKeyLen = uiKeyLen;
+        gsSwKeySlots[uiSlot].eType = eType;
+        gsSwKeySlots[uiSlot].bInUse = TKey_TRUE;
+        *puiSlot = uiSlot;
+    } while(TKey_EXIT);
+    return eStatus;
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_generate_key(
+        TKey_CryptoKeyType_t eType, TKey_UINT32 uiKeyLen, TKey_UINT32 *puiSlot)
+{
+    TKey_BYTE aucKey[TKEY_CRYPTO_AES256_KEY_SIZE];
+    TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    TKey_CryptoStatus_t eStatus;
+    TKey_UINT32 uiTry;
+
+    do {
+        eStatus = tkey_crypto_sw_check_key(eType, uiKeyLen);
+        if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+            break;
+        }
+        /* Rejection sampling for P-256; one retry is already rare */
+        for(uiTry = 0; uiTry < 8; uiTry++) {
+            eStatus = TKey_Crypto_Random(aucKey, uiKeyLen);
+            if(E_TKEY_CRYPTO_SUCCESS != eStatus ||
+               E_TKEY_CRYPTO_KEY_AES == eType) {
+                break;
+            }
+            eStatus = tkey_crypto_sw_ec_p256_public_key(aucKey, aucPub);
+            if(E_TKEY_CRYPTO_INVALID_ARG != eStatus) {
+                break;
+            }
+        }
+        if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+            break;
+        }
+        eStatus = tkey_crypto_sw_import_key(eType, aucKey, uiKeyLen, puiSlot);
+    } while(TKey_EXIT);
+    mbedtls_platform_zeroize(aucKey, sizeof(aucKey));
+    return eStatus;
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_destroy_key(TKey_UINT32 uiSlot)
+{
+    if(uiSlot >= TKEY_CRYPTO_SW_KEY_SLOTS || !gsSwKeySlots[uiSlot].bInUse) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    mbedtls_platform_zeroize(&gsSwKeySlots[uiSlot],
+                             sizeof(gsSwKeySlots[uiSlot]));
+    return E_TKEY_CRYPTO_SUCCESS;
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_opaque_export_public(
+        TKey_UINT32 uiSlot, TKey_BYTE *pucPub)
+{
+    TKey_CryptoSwKeySlot_t *psSlot =
+        tkey_crypto_sw_slot(uiSlot, E_TKEY_CRYPTO_KEY_P256_PRIVATE);
+
+    if(TKey_NULL == psSlot) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_sw_ec_p256_public_key(psSlot->aucKey, pucPub);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_opaque_ccm_encrypt(
+        TKey_UINT32 uiSlot, const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        TKey_BYTE *pucTag, TKey_UINT32 uiTagLen)
+{
+    TKey_CryptoSwKeySlot_t *psSlot =
+        tkey_crypto_sw_slot(uiSlot, E_TKEY_CRYPTO_KEY_AES);
+
+    if(TKey_NULL == psSlot) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_sw_aes_ccm_encrypt(psSlot->aucKey, psSlot->uiKeyLen,
+                pucNonce, uiNonceLen, pucAad, uiAadLen, pucIn, uiLen, pucOut,
+                pucTag, uiTagLen);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_opaque_ccm_decrypt(
+        TKey_UINT32 uiSlot, const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        const TKey_BYTE *pucTag, TKey_UINT32 uiTagLen)
+{
+    TKey_CryptoSwKeySlot_t *psSlot =
+        tkey_crypto_sw_slot(uiSlot, E_TKEY_CRYPTO_KEY_AES);
+
+    if(TKey_NULL == psSlot) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_sw_aes_ccm_decrypt(psSlot->aucKey, psSlot->uiKeyLen,
+                pucNonce, uiNonceLen, pucAad, uiAadLen, pucIn, uiLen, pucOut,
+                pucTag, uiTagLen);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_opaque_cmac(TKey_UINT32 uiSlot,
+        const TKey_BYTE *pucMsg, TKey_UINT32 uiLen, TKey_BYTE *pucMac)
+{
+    TKey_CryptoSwKeySlot_t *psSlot =
+        tkey_crypto_sw_slot(uiSlot, E_TKEY_CRYPTO_KEY_AES);
+
+    if(TKey_NULL == psSlot) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_sw_aes_cmac(psSlot->aucKey, psSlot->uiKeyLen, pucMsg,
+                                   uiLen, pucMac);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_opaque_ecdh(TKey_UINT32 uiSlot,
+        const TKey_BYTE *pucPeerPub, TKey_BYTE *pucSecret)
+{
+    TKey_CryptoSwKeySlot_t *psSlot =
+        tkey_crypto_sw_slot(uiSlot, E_TKEY_CRYPTO_KEY_P256_PRIVATE);
+
+    if(TKey_NULL == psSlot) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_sw_ecdh_p256(psSlot->aucKey, pucPeerPub, pucSecret);
+}
+
+static TKey_CryptoStatus_t tkey_crypto_sw_opaque_sign(TKey_UINT32 uiSlot,
+        const TKey_BYTE *pucHash, TKey_BYTE *pucSig)
+{
+    TKey_CryptoSwKeySlot_t *psSlot =
+        tkey_crypto_sw_slot(uiSlot, E_TKEY_CRYPTO_KEY_P256_PRIVATE);
+
+    if(TKey_NULL == psSlot) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_sw_ecdsa_p256_sign(psSlot->aucKey, pucHash, pucSig);
+}
+
+const TKey_CryptoOpaqueDrv_t gsTKeyCryptoSwOpaqueDriver =
+{
+    "sw-opaque",
+    TKEY_CRYPTO_DRIVER_ID_SW_OPAQUE,
+    tkey_crypto_sw_import_key,
+    tkey_crypto_sw_generate_key,
+    tkey_crypto_sw_destroy_key,
+    tkey_crypto_sw_opaque_export_public,
+    tkey_crypto_sw_opaque_ccm_encrypt,
+    tkey_crypto_sw_opaque_ccm_decrypt,
+    tkey_crypto_sw_opaque_cmac,
+    tkey_crypto_sw_opaque_ecdh,
+    tkey_crypto_sw_opaque_sign
+};
@@ -0,0 +1,315 @@
+/*
+ * \file thinkey_crypto_psa_drv.c
+ *
+ * \brief PSA driver wrapper entry points backed by the THINKey crypto drivers
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_PSA_CRYPTO_DRIVERS) && defined(TKEY_PSA_CRYPTO_DRIVER)
+
+#include "thinkey_crypto_psa_drv.h"
+#include <string.h>
+
+static psa_status_t tkey_psa_status(TKey_CryptoStatus_t eStatus)
+{
+    switch(eStatus) {
+        case E_TKEY_CRYPTO_SUCCESS:
+            return PSA_SUCCESS;
+        case E_TKEY_CRYPTO_NOT_SUPPORTED:
+            return PSA_ERROR_NOT_SUPPORTED;
+        case E_TKEY_CRYPTO_INVALID_ARG:
+            return PSA_ERROR_INVALID_ARGUMENT;
+        case E_TKEY_CRYPTO_AUTH_FAILED:
+            return PSA_ERROR_INVALID_SIGNATURE;
+        case E_TKEY_CRYPTO_NO_MEMORY:
+            return PSA_ERROR_INSUFFICIENT_MEMORY;
+        default:
+            return PSA_ERROR_GENERIC_ERROR;
+    }
+}
+
+/* Only P-256 ECDSA over a SHA-256 hash is routed to THINKey drivers */
+static TKey_BOOL tkey_psa_is_p256(const psa_key_attributes_t *attributes)
+{
+    psa_key_type_t type = psa_get_key_type(attributes);
+
+    return (PSA_KEY_TYPE_ECC_GET_FAMILY(type) == PSA_ECC_FAMILY_SECP_R1 &&
+            psa_get_key_bits(attributes) == 256);
+}
+
+static TKey_BOOL tkey_psa_is_p256_ecdsa(const psa_key_attributes_t *attributes,
+                                        psa_algorithm_t alg,
+                                        size_t hash_length)
+{
+    return (tkey_psa_is_p256(attributes) && PSA_ALG_IS_ECDSA(alg) &&
+            PSA_ALG_SIGN_GET_HASH(alg) == PSA_ALG_SHA_256 &&
+            hash_length == TKEY_CRYPTO_SHA256_SIZE);
+}
+
+/* Call OP on each accelerator in turn; the software driver is skipped so
+ * that PSA's own implementation remains the fallback */
+#define TKEY_PSA_ACCEL_DISPATCH(eStatus, OP, ...)                           \
+    do {                                                                    \
+        const TKey_CryptoTransparentDrv_t *psDrv_;                          \
+        TKey_UINT32 uiIdx_ = 0;                                             \
+        (eStatus) = E_TKEY_CRYPTO_NOT_SUPPORTED;                            \
+        while(TKey_NULL != (psDrv_ = TKey_Crypto_GetTransparentDriver(uiIdx_++)) && \
+              psDrv_ != &gsTKeyCryptoSwDriver) {                            \
+            if(TKey_NULL == psDrv_->OP) {                                   \
+                continue;                                                   \
+            }                                                               \
+            (eStatus) = psDrv_->OP(__VA_ARGS__);                            \
+            if(E_TKEY_CRYPTO_NOT_SUPPORTED != (eStatus)) {                  \
+                break;                                                      \
+            }                                                               \
+        }                                                                   \
+    } while(TKey_EXIT)
+
+psa_status_t tkey_psa_transparent_sign_hash(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg, const uint8_t *hash, size_t hash_length,
+    uint8_t *signature, size_t signature_size, size_t *signature_length )
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(!tkey_psa_is_p256_ecdsa(attributes, alg, hash_length) ||
+       !PSA_KEY_TYPE_IS_ECC_KEY_PAIR(psa_get_key_type(attributes)) ||
+       key_buffer_size != TKEY_CRYPTO_P256_PRIV_KEY_SIZE) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    if(signature_size < TKEY_CRYPTO_P256_SIG_SIZE) {
+        return PSA_ERROR_BUFFER_TOO_SMALL;
+    }
+    TKEY_PSA_ACCEL_DISPATCH(eStatus, eEcdsaP256Sign, key_buffer, hash,
+                            signature);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        *signature_length = TKEY_CRYPTO_P256_SIG_SIZE;
+    }
+    return tkey_psa_status(eStatus);
+}
+
+psa_status_t tkey_psa_transparent_verify_hash(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg, const uint8_t *hash, size_t hash_length,
+    const uint8_t *signature, size_t signature_length )
+{
+    TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    const TKey_BYTE *pucPub = key_buffer;
+    TKey_CryptoStatus_t eStatus;
+
+    if(!tkey_psa_is_p256_ecdsa(attributes, alg, hash_length)) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    if(signature_length != TKEY_CRYPTO_P256_SIG_SIZE) {
+        return PSA_ERROR_INVALID_SIGNATURE;
+    }
+    if(PSA_KEY_TYPE_IS_ECC_KEY_PAIR(psa_get_key_type(attributes))) {
+        if(key_buffer_size != TKEY_CRYPTO_P256_PRIV_KEY_SIZE) {
+            return PSA_ERROR_NOT_SUPPORTED;
+        }
+        TKEY_PSA_ACCEL_DISPATCH(eStatus, eEcP256PublicKey, key_buffer, aucPub);
+        if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+            return tkey_psa_status(eStatus);
+        }
+        pucPub = aucPub;
+    } else if(key_buffer_size != TKEY_CRYPTO_P256_PUB_KEY_SIZE) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    TKEY_PSA_ACCEL_DISPATCH(eStatus, eEcdsaP256Verify, pucPub, hash,
+                            signature);
+    return tkey_psa_status(eStatus);
+}
+
+psa_status_t tkey_psa_transparent_export_public_key(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    uint8_t *data, size_t data_size, size_t *data_length )
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(!tkey_psa_is_p256(attributes) ||
+       !PSA_KEY_TYPE_IS_ECC_KEY_PAIR(psa_get_key_type(attributes)) ||
+       key_buffer_size != TKEY_CRYPTO_P256_PRIV_KEY_SIZE) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    if(data_size < TKEY_CRYPTO_P256_PUB_KEY_SIZE) {
+        return PSA_ERROR_BUFFER_TOO_SMALL;
+    }
+    TKEY_PSA_ACCEL_DISPATCH(eStatus, eEcP256PublicKey, key_buffer, data);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        *data_length = TKEY_CRYPTO_P256_PUB_KEY_SIZE;
+    }
+    return tkey_psa_status(eStatus);
+}
+
+/* Recover the opaque key reference stored in a PSA key buffer */
+static psa_status_t tkey_psa_opaque_key(const uint8_t *key_buffer,
+                                        size_t key_buffer_size,
+                                        TKey_CryptoKey_t *psKey)
+{
+    TKey_PsaOpaqueKey_t sRef;
+
+    if(key_buffer_size != sizeof(TKey_PsaOpaqueKey_t)) {
+        return PSA_ERROR_CORRUPTION_DETECTED;
+    }
+    memcpy(&sRef, key_buffer, sizeof(sRef));
+    memset(psKey, 0, sizeof(TKey_CryptoKey_t));
+    psKey->eLocation = E_TKEY_CRYPTO_KEY_OPAQUE;
+    psKey->eType = E_TKEY_CRYPTO_KEY_P256_PRIVATE;
+    psKey->uiDriverId = sRef.uiDriverId;
+    psKey->uiSlot = sRef.uiSlot;
+    psKey->uiKeyLen = TKEY_CRYPTO_P256_PRIV_KEY_SIZE;
+    return PSA_SUCCESS;
+}
+
+psa_status_t tkey_psa_opaque_get_key_buffer_size(
+    const psa_key_attributes_t *attributes, size_t *key_buffer_size )
+{
+    if(!tkey_psa_is_p256(attributes) ||
+       !PSA_KEY_TYPE_IS_ECC_KEY_PAIR(psa_get_key_type(attributes))) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    *key_buffer_size = sizeof(TKey_PsaOpaqueKey_t);
+    return PSA_SUCCESS;
+}
+
+psa_status_t tkey_psa_opaque_generate_key(
+    const psa_key_attributes_t *attributes,
+    uint8_t *key_buffer, size_t key_buffer_size, size_t *key_buffer_length )
+{
+    TKey_CryptoKey_t sKey;
+    TKey_PsaOpaqueKey_t sRef;
+    TKey_CryptoStatus_t eStatus;
+
+    if(!tkey_psa_is_p256(attributes) ||
+       !PSA_KEY_TYPE_IS_ECC_KEY_PAIR(psa_get_key_type(attributes))) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    if(key_buffer_size < sizeof(TKey_PsaOpaqueKey_t)) {
+        return PSA_ERROR_BUFFER_TOO_SMALL;
+    }
+    eStatus = TKey_Crypto_GenerateKey(TKEY_PSA_CRYPTO_OPAQUE_DRIVER_ID,
+                                      E_TKEY_CRYPTO_KEY_P256_PRIVATE,
+                                      TKEY_CRYPTO_P256_PRIV_KEY_SIZE, &sKey);
+    if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+        return tkey_psa_status(eStatus);
+    }
+    sRef.uiDriverId = sKey.uiDriverId;
+    sRef.uiSlot = sKey.uiSlot;
+    memcpy(key_buffer, &sRef, sizeof(sRef));
+    *key_buffer_length = sizeof(sRef);
+    return PSA_SUCCESS;
+}
+
+psa_status_t tkey_psa_opaque_sign_hash(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg, const uint8_t *hash, size_t hash_length,
+    uint8_t *signature, size_t signature_size, size_t *signature_length )
+{
+    TKey_CryptoKey_t sKey;
+    psa_status_t status;
+
+    if(!tkey_psa_is_p256_ecdsa(attributes, alg, hash_length)) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    if(signature_size < TKEY_CRYPTO_P256_SIG_SIZE) {
+        return PSA_ERROR_BUFFER_TOO_SMALL;
+    }
+    status = tkey_psa_opaque_key(key_buffer, key_buffer_size, &sKey);
+    if(PSA_SUCCESS != status) {
+        return status;
+    }
+    status = tkey_psa_status(TKey_Crypto_EcdsaP256Sign(&sKey, hash,
+                                                       signature));
+    if(PSA_SUCCESS == status) {
+        *signature_length = TKEY_CRYPTO_P256_SIG_SIZE;
+    }
+    return status;
+}
+
+psa_status_t tkey_psa_opaque_verify_hash(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg, const uint8_t *hash, size_t hash_length,
+    const uint8_t *signature, size_t signature_length )
+{
+    TKey_BYTE aucPub[TKEY_CRYPTO_P256_PUB_KEY_SIZE];
+    TKey_CryptoKey_t sKey;
+    psa_status_t status;
+
+    if(!tkey_psa_is_p256_ecdsa(attributes, alg, hash_length)) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    if(signature_length != TKEY_CRYPTO_P256_SIG_SIZE) {
+        return PSA_ERROR_INVALID_SIGNATURE;
+    }
+    status = tkey_psa_opaque_key(key_buffer, key_buffer_size, &sKey);
+    if(PSA_SUCCESS != status) {
+        return status;
+    }
+    /* Verification only needs the public half, which any driver can use */
+    status = tkey_psa_status(TKey_Crypto_EcP256PublicKey(&sKey, aucPub));
+    if(PSA_SUCCESS != status) {
+        return status;
+    }
+    return tkey_psa_status(TKey_Crypto_EcdsaP256Verify(aucPub, hash,
+                                                       signature));
+}
+
+psa_status_t tkey_psa_opaque_export_public_key(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    uint8_t *data, size_t data_size, size_t *data_length )
+{
+    TKey_CryptoKey_t sKey;
+    psa_status_t status;
+
+    if(!tkey_psa_is_p256(attributes)) {
+        return PSA_ERROR_NOT_SUPPORTED;
+    }
+    if(data_size < TKEY_CRYPTO_P256_PUB_KEY_SIZE) {
+        return PSA_ERROR_BUFFER_TOO_SMALL;
+    }
+    status = tkey_psa_opaque_key(key_buffer, key_buffer_size, &sKey);
+    if(PSA_SUCCESS != status) {
+        return status;
+    }
+    status = tkey_psa_status(TKey_Crypto_EcP256PublicKey(&sKey, data));
+    if(PSA_SUCCESS == status) {
+        *data_length = TKEY_CRYPTO_P256_PUB_KEY_SIZE;
+    }
+    return status;
+}
+
+#if defined(MBEDTLS_PSA_CRYPTO_EXTERNAL_RNG)
+/* PSA has no entropy source of its own on this target; it draws from the
+ * random source set with TKey_Crypto_SetRng() */
+psa_status_t mbedtls_psa_external_get_random(
+    mbedtls_psa_external_random_context_t *context,
+    uint8_t *output, size_t output_size, size_t *output_length )
+{
+    TKey_CryptoStatus_t eStatus;
+
+    (void)context;
+    eStatus = TKey_Crypto_Random(output, (TKey_UINT32)output_size);
+    if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+        return (E_TKEY_CRYPTO_NOT_SUPPORTED == eStatus) ?
+               PSA_ERROR_INSUFFICIENT_ENTROPY : tkey_psa_status(eStatus);
+    }
+    *output_length = output_size;
+    return PSA_SUCCESS;
+}
+#endif /* MBEDTLS_PSA_CRYPTO_EXTERNAL_RNG */
+
+#endif /* MBEDTLS_PSA_CRYPTO_DRIVERS && TKEY_PSA_CRYPTO_DRIVER */
@@ -0,0 +1,153 @@
+/*
+ * \file thinkey_crypto_session.c
+ *
+ * \brief Secure channel session crypto context
+ *
+ * The key schedule goes through the crypto driver layer (TKey_Crypto_
+ * HkdfSha256), so an accelerator serves it when registered. The per-APDU
+ * operations run on mbedtls contexts that keep the expanded round keys for
+ * the lifetime of the session; the CMAC contexts are reset rather than
+ * re-keyed between messages.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_crypto_session.h"
+#include "mbedtls/cmac.h"
+#include "mbedtls/platform_util.h"
+#include <string.h>
+
+static TKey_CryptoStatus_t tkey_crypto_session_status(int iRet)
+{
+    if(0 == iRet) {
+        return E_TKEY_CRYPTO_SUCCESS;
+    }
+    if(MBEDTLS_ERR_CCM_AUTH_FAILED == iRet) {
+        return E_TKEY_CRYPTO_AUTH_FAILED;
+    }
+    if(MBEDTLS_ERR_CCM_BAD_INPUT == iRet ||
+       MBEDTLS_ERR_CIPHER_BAD_INPUT_DATA == iRet) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    if(MBEDTLS_ERR_CIPHER_ALLOC_FAILED == iRet) {
+        return E_TKEY_CRYPTO_NO_MEMORY;
+    }
+    return E_TKEY_CRYPTO_FAILURE;
+}
+
+TKey_CryptoStatus_t TKey_CryptoSession_Open(TKey_CryptoSession_t *psSession,
+        const TKey_BYTE *pucSalt, TKey_UINT32 uiSaltLen,
+        const TKey_BYTE *pucSecret, TKey_UINT32 uiSecretLen,
+        const TKey_BYTE *pucInfo, TKey_UINT32 uiInfoLen)
+{
+    TKey_BYTE aucOkm[TKEY_CRYPTO_SESSION_OKM_SIZE];
+    const mbedtls_cipher_info_t *psInfo;
+    TKey_CryptoStatus_t eStatus;
+    TKey_UINT32 uiIndex;
+    int iRet = 0;
+
+    if(TKey_NULL == psSession || TKey_NULL == pucSecret) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    memset(psSession, 0, sizeof(TKey_CryptoSession_t));
+    mbedtls_ccm_init(&psSession->sEnc);
+    mbedtls_cipher_init(&psSession->asMac[0]);
+    mbedtls_cipher_init(&psSession->asMac[1]);
+
+    do {
+        eStatus = TKey_Crypto_HkdfSha256(pucSalt, uiSaltLen, pucSecret,
+                        uiSecretLen, pucInfo, uiInfoLen, aucOkm,
+                        sizeof(aucOkm));
+        if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+            break;
+        }
+        iRet = mbedtls_ccm_setkey(&psSession->sEnc, MBEDTLS_CIPHER_ID_AES,
+                                  aucOkm, TKEY_CRYPTO_SESSION_KEY_SIZE * 8);
+        if(0 != iRet) {
+            break;
+        }
+        psInfo = mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_128_ECB);
+        for(uiIndex = 0; uiIndex < 2 && 0 == iRet; uiIndex++) {
+            /* cmac_starts expands the key and allocates the CMAC state */
+            iRet = mbedtls_cipher_setup(&psSession->asMac[uiIndex], psInfo);
+            if(0 == iRet) {
+                iRet = mbedtls_cipher_cmac_starts(&psSession->asMac[uiIndex],
+                        &aucOkm[(uiIndex + 1) * TKEY_CRYPTO_SESSION_KEY_SIZE],
+                        TKEY_CRYPTO_SESSION_KEY_SIZE * 8);
+            }
+        }
+        eStatus = tkey_crypto_session_status(iRet);
+    } while(TKey_EXIT);
+
+    mbedtls_platform_zeroize(aucOkm, sizeof(aucOkm));
+    if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+        TKey_CryptoSession_Close(psSession);
+        return eStatus;
+    }
+    psSession->bOpen = TKey_TRUE;
+    return E_TKEY_CRYPTO_SUCCESS;
+}
+
+TKey_CryptoStatus_t TKey_CryptoSession_CcmEncrypt(
+        TKey_CryptoSession_t *psSession, const TKey_BYTE *pucNonce,
+        TKey_UINT32 uiNonceLen, const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        TKey_BYTE *pucTag, TKey_UINT32 uiTagLen)
+{
+    if(TKey_NULL == psSession || !psSession->bOpen) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_session_status(mbedtls_ccm_encrypt_and_tag(
+                &psSession->sEnc, uiLen, pucNonce, uiNonceLen, pucAad,
+                uiAadLen, pucIn, pucOut, pucTag, uiTagLen));
+}
+
+TKey_CryptoStatus_t TKey_CryptoSession_CcmDecrypt(
+        TKey_CryptoSession_t *psSession, const TKey_BYTE *pucNonce,
+        TKey_UINT32 uiNonceLen, const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, TKey_BYTE *pucOut,
+        const TKey_BYTE *pucTag, TKey_UINT32 uiTagLen)
+{
+    if(TKey_NULL == psSession || !psSession->bOpen) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    return tkey_crypto_session_status(mbedtls_ccm_auth_decrypt(
+                &psSession->sEnc, uiLen, pucNonce, uiNonceLen, pucAad,
+                uiAadLen, pucIn, pucOut, pucTag, uiTagLen));
+}
+
+TKey_CryptoStatus_t TKey_CryptoSession_Cmac(TKey_CryptoSession_t *psSession,
+        TKey_CryptoSessionMacKey_t eKey, const TKey_BYTE *pucMsg,
+        TKey_UINT32 uiLen, TKey_BYTE *pucMac)
+{
+    mbedtls_cipher_context_t *psMac;
+    int iRet;
+
+    if(TKey_NULL == psSession || !psSession->bOpen ||
+       eKey > E_TKEY_CRYPTO_SESSION_RMAC) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    psMac = &psSession->asMac[eKey];
+    /* Reset keeps the expanded key and only clears the chaining state */
+    iRet = mbedtls_cipher_cmac_reset(psMac);
+    if(0 == iRet) {
+        iRet = mbedtls_cipher_cmac_update(psMac, pucMsg, uiLen);
+    }
+    if(0 == iRet) {
+        iRet = mbedtls_cipher_cmac_finish(psMac, pucMac);
+    }
+    return tkey_crypto_session_status(iRet);
+}
+
+TKey_VOID TKey_CryptoSession_Close(TKey_CryptoSession_t *psSession)
+{
+    if(TKey_NULL == psSession) {
+        return;
+    }
+    /* The mbedtls free functions zeroize the round keys and CMAC state */
+    mbedtls_ccm_free(&psSession->sEnc);
+    mbedtls_cipher_free(&psSession->asMac[0]);
+    mbedtls_cipher_free(&psSession->asMac[1]);
+    mbedtls_platform_zeroize(psSession, sizeof(TKey_CryptoSession_t));
+}
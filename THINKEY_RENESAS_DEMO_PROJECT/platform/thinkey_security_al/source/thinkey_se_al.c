@@ -0,0 +1,532 @@
+/*
+ * \file thinkey_se_al.c
+ *
+ * \brief Secure element APDU channel with command batching
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_SECURITY
+
+#include "thinkey_platform_types.h"
+#include "thinkey_se_al.h"
+#include "thinkey_osal.h"
+#include "thinkey_debug.h"
+#include <string.h>
+
+#define TKEY_SE_ENVELOPE_ENTRY_HDR 2    /* big-endian length prefix */
+#define TKEY_SE_SW_SIZE 2
+
+typedef struct
+{
+    const TKey_SeBusOps_t *psBus;
+    TKey_VOID *pvBusCtx;
+    TKey_BOOL bOpen;
+    TKey_BOOL bNoEnvelope;      /* SE rejected the envelope command */
+    volatile TKey_BOOL bWorkerRunning;
+    volatile TKey_BOOL bInWorker;
+    TKey_HANDLE hQueue;
+    TKey_SeStats_t sStats;
+} TKey_SeChannel_t;
+
+static TKey_SeChannel_t gsSeChannel;
+static TKey_BYTE gaucSeTx[TKEY_SE_MAX_APDU_SIZE];
+static TKey_BYTE gaucSeRx[TKEY_SE_MAX_APDU_SIZE + TKEY_SE_SW_SIZE];
+static TKey_BYTE gaucSeCmd[TKEY_SE_MAX_APDU_SIZE];
+
+TKey_UINT32 TKey_Se_EncodeApdu(const TKey_SeApdu_t *psApdu, TKey_BYTE *pucOut,
+                               TKey_UINT32 uiOutSize)
+{
+    TKey_BOOL bExtended = (psApdu->uiLc > 255 || psApdu->uiLe > 256);
+    TKey_UINT32 uiLen = 4;
+    TKey_UINT32 uiNeed = 4 + psApdu->uiLc;
+
+    if(0 != psApdu->uiLc) {
+        uiNeed += bExtended ? 3 : 1;
+    }
+    if(0 != psApdu->uiLe) {
+        uiNeed += bExtended ? ((0 != psApdu->uiLc) ? 2 : 3) : 1;
+    }
+    if(uiNeed > uiOutSize || psApdu->uiLc > 0xFFFF || psApdu->uiLe > 0x10000) {
+        return 0;
+    }
+
+    pucOut[0] = psApdu->ucCla;
+    pucOut[1] = psApdu->ucIns;
+    pucOut[2] = psApdu->ucP1;
+    pucOut[3] = psApdu->ucP2;
+    if(bExtended) {
+        pucOut[uiLen++] = 0x00;
+    }
+    if(0 != psApdu->uiLc) {
+        if(bExtended) {
+            pucOut[uiLen++] = (TKey_BYTE)(psApdu->uiLc >> 8);
+        }
+        pucOut[uiLen++] = (TKey_BYTE)psApdu->uiLc;
+        memcpy(&pucOut[uiLen], psApdu->pucData, psApdu->uiLc);
+        uiLen += psApdu->uiLc;
+    }
+    if(0 != psApdu->uiLe) {
+        /* 256 (short) and 65536 (extended) are encoded as zero */
+        if(bExtended) {
+            pucOut[uiLen++] = (TKey_BYTE)(psApdu->uiLe >> 8);
+        }
+        pucOut[uiLen++] = (TKey_BYTE)psApdu->uiLe;
+    }
+    return uiLen;
+}
+
+TKey_SeStatus_t TKey_Se_DecodeApdu(const TKey_BYTE *pucIn, TKey_UINT32 uiLen,
+                                   TKey_SeApdu_t *psApdu)
+{
+    TKey_UINT32 uiPos = 4;
+    TKey_UINT32 uiRest;
+
+    if(uiLen < 4) {
+        return E_TKEY_SE_INVALID_ARG;
+    }
+    memset(psApdu, 0, sizeof(TKey_SeApdu_t));
+    psApdu->ucCla = pucIn[0];
+    psApdu->ucIns = pucIn[1];
+    psApdu->ucP1 = pucIn[2];
+    psApdu->ucP2 = pucIn[3];
+    if(4 == uiLen) {
+        return E_TKEY_SE_SUCCESS;
+    }
+    if(5 == uiLen) {
+        psApdu->uiLe = (0 == pucIn[4]) ? 256 : pucIn[4];
+        return E_TKEY_SE_SUCCESS;
+    }
+    if(0 != pucIn[4]) {
+        /* Short form */
+        psApdu->uiLc = pucIn[uiPos++];
+        if(uiPos + psApdu->uiLc > uiLen) {
+            return E_TKEY_SE_INVALID_ARG;
+        }
+        psApdu->pucData = &pucIn[uiPos];
+        uiPos += psApdu->uiLc;
+        uiRest = uiLen - uiPos;
+        if(1 == uiRest) {
+            psApdu->uiLe = (0 == pucIn[uiPos]) ? 256 : pucIn[uiPos];
+        } else if(0 != uiRest) {
+            return E_TKEY_SE_INVALID_ARG;
+        }
+        return E_TKEY_SE_SUCCESS;
+    }
+    /* Extended form */
+    if(uiLen < 7) {
+        return E_TKEY_SE_INVALID_ARG;
+    }
+    uiPos = 5;
+    if(7 == uiLen) {
+        psApdu->uiLe = ((TKey_UINT32)pucIn[5] << 8) | pucIn[6];
+        if(0 == psApdu->uiLe) {
+            psApdu->uiLe = 0x10000;
+        }
+        return E_TKEY_SE_SUCCESS;
+    }
+    psApdu->uiLc = ((TKey_UINT32)pucIn[uiPos] << 8) | pucIn[uiPos + 1];
+    uiPos += 2;
+    if(uiPos + psApdu->uiLc > uiLen) {
+        return E_TKEY_SE_INVALID_ARG;
+    }
+    psApdu->pucData = &pucIn[uiPos];
+    uiPos += psApdu->uiLc;
+    uiRest = uiLen - uiPos;
+    if(2 == uiRest) {
+        psApdu->uiLe = ((TKey_UINT32)pucIn[uiPos] << 8) | pucIn[uiPos + 1];
+        if(0 == psApdu->uiLe) {
+            psApdu->uiLe = 0x10000;
+        }
+    } else if(0 != uiRest) {
+        return E_TKEY_SE_INVALID_ARG;
+    }
+    return E_TKEY_SE_SUCCESS;
+}
+
+TKey_StatusType TKey_Se_Init(const TKey_SeBusOps_t *psBus, TKey_VOID *pvBusCtx)
+{
+    if(TKey_NULL == psBus || TKey_NULL == psBus->eTransceive) {
+        return E_TKEY_FAILURE;
+    }
+    memset(&gsSeChannel, 0, sizeof(gsSeChannel));
+    gsSeChannel.psBus = psBus;
+    gsSeChannel.pvBusCtx = pvBusCtx;
+    if(TKey_NULL != psBus->eOpen &&
+       E_TKEY_SE_SUCCESS != psBus->eOpen(pvBusCtx)) {
+        THINKEY_DEBUG_ERROR("SEAL: %s bus open failed", psBus->pcName);
+        return E_TKEY_FAILURE;
+    }
+    gsSeChannel.bOpen = TKey_TRUE;
+    return E_TKEY_SUCCESS;
+}
+
+TKey_VOID TKey_Se_DeInit(TKey_VOID)
+{
+    if(gsSeChannel.bOpen && TKey_NULL != gsSeChannel.psBus->vClose) {
+        gsSeChannel.psBus->vClose(gsSeChannel.pvBusCtx);
+    }
+    gsSeChannel.bOpen = TKey_FALSE;
+}
+
+/* Synchronous use is allowed before the worker starts and from within the
+ * worker (completion callbacks); anything else would race for the bus */
+static TKey_SeStatus_t tkey_se_check_owner(TKey_VOID)
+{
+    if(!gsSeChannel.bOpen) {
+        return E_TKEY_SE_FAILURE;
+    }
+    if(gsSeChannel.bWorkerRunning && !gsSeChannel.bInWorker) {
+        return E_TKEY_SE_BUSY;
+    }
+    return E_TKEY_SE_SUCCESS;
+}
+
+/* One bus transaction: command frame out, response frame in */
+static TKey_SeStatus_t tkey_se_bus_exchange(TKey_UINT32 uiTxLen,
+                                            TKey_UINT32 *puiRxLen)
+{
+    TKey_SeStatus_t eStatus;
+
+    gsSeChannel.sStats.uiBusTransactions++;
+    eStatus = gsSeChannel.psBus->eTransceive(gsSeChannel.pvBusCtx, gaucSeTx,
+                    uiTxLen, gaucSeRx, sizeof(gaucSeRx), puiRxLen);
+    if(E_TKEY_SE_SUCCESS == eStatus && *puiRxLen < TKEY_SE_SW_SIZE) {
+        eStatus = E_TKEY_SE_BUS_ERROR;
+    }
+    if(E_TKEY_SE_SUCCESS != eStatus) {
+        gsSeChannel.sStats.uiErrors++;
+        THINKEY_DEBUG_ERROR("SEAL: bus transaction failed (%d)", (int)eStatus);
+    }
+    return eStatus;
+}
+
+/* Copy response data and status word into the caller's response */
+static TKey_SeStatus_t tkey_se_store_response(TKey_SeResponse_t *psResp,
+                                              const TKey_BYTE *pucFrame,
+                                              TKey_UINT32 uiFrameLen)
+{
+    TKey_UINT32 uiDataLen = uiFrameLen - TKEY_SE_SW_SIZE;
+    TKey_SeStatus_t eStatus = E_TKEY_SE_SUCCESS;
+
+    psResp->usSw = (TKey_UINT16)((pucFrame[uiDataLen] << 8) |
+                                 pucFrame[uiDataLen + 1]);
+    if(uiDataLen > psResp->uiSize) {
+        uiDataLen = psResp->uiSize;
+        eStatus = E_TKEY_SE_BUFFER_TOO_SMALL;
+    }
+    if(0 != uiDataLen) {
+        memcpy(psResp->pucData, pucFrame, uiDataLen);
+    }
+    psResp->uiLen = uiDataLen;
+    return eStatus;
+}
+
+static TKey_SeStatus_t tkey_se_transceive_one(const TKey_SeApdu_t *psApdu,
+                                              TKey_SeResponse_t *psResp)
+{
+    TKey_UINT32 uiTxLen;
+    TKey_UINT32 uiRxLen = 0;
+    TKey_SeStatus_t eStatus;
+
+    uiTxLen = TKey_Se_EncodeApdu(psApdu, gaucSeTx, sizeof(gaucSeTx));
+    if(0 == uiTxLen) {
+        return E_TKEY_SE_BUFFER_TOO_SMALL;
+    }
+    gsSeChannel.sStats.uiApdus++;
+    eStatus = tkey_se_bus_exchange(uiTxLen, &uiRxLen);
+    if(E_TKEY_SE_SUCCESS == eStatus) {
+        eStatus = tkey_se_store_response(psResp, gaucSeRx, uiRxLen);
+    }
+    return eStatus;
+}
+
+TKey_SeStatus_t TKey_Se_Transceive(const TKey_SeApdu_t *psApdu,
+                                   TKey_SeResponse_t *psResp)
+{
+    TKey_SeStatus_t eStatus;
+
+    if(TKey_NULL == psApdu || TKey_NULL == psResp) {
+        return E_TKEY_SE_INVALID_ARG;
+    }
+    eStatus = tkey_se_check_owner();
+    if(E_TKEY_SE_SUCCESS != eStatus) {
+        return eStatus;
+    }
+    return tkey_se_transceive_one(psApdu, psResp);
+}
+
+TKey_VOID TKey_SeBatch_Init(TKey_SeBatch_t *psBatch)
+{
+    memset(psBatch, 0, sizeof(TKey_SeBatch_t));
+}
+
+TKey_SeStatus_t TKey_SeBatch_Add(TKey_SeBatch_t *psBatch,
+                                 const TKey_SeApdu_t *psApdu,
+                                 TKey_SeResponse_t *psResp)
+{
+    if(TKey_NULL == psBatch || TKey_NULL == psApdu || TKey_NULL == psResp) {
+        return E_TKEY_SE_INVALID_ARG;
+    }
+    if(psBatch->uiCount >= TKEY_SE_MAX_BATCH) {
+        return E_TKEY_SE_QUEUE_FULL;
+    }
+    psBatch->apsApdu[psBatch->uiCount] = psApdu;
+    psBatch->apsResp[psBatch->uiCount] = psResp;
+    psBatch->uiCount++;
+    return E_TKEY_SE_SUCCESS;
+}
+
+/* Send commands [uiFirst, uiFirst + uiCount) in one envelope. The envelope
+ * data is a list of length-prefixed command APDUs, and its response data a
+ * list of length-prefixed response frames (data || SW1 SW2). */
+static TKey_SeStatus_t tkey_se_send_envelope(TKey_SeBatch_t *psBatch,
+                                             TKey_UINT32 uiFirst,
+                                             TKey_UINT32 uiCount)
+{
+    TKey_SeApdu_t sEnvelope;
+    TKey_SeResponse_t sEnvResp;
+    TKey_UINT32 uiPos = 0;
+    TKey_UINT32 uiRxLen = 0;
+    TKey_UINT32 uiTxLen;
+    TKey_UINT32 uiEntryLen;
+    TKey_UINT32 uiIndex;
+    TKey_SeStatus_t eStatus;
+    TKey_SeStatus_t eResult = E_TKEY_SE_SUCCESS;
+
+    for(uiIndex = uiFirst; uiIndex < uiFirst + uiCount; uiIndex++) {
+        uiEntryLen = TKey_Se_EncodeApdu(psBatch->apsApdu[uiIndex],
+                        &gaucSeCmd[uiPos + TKEY_SE_ENVELOPE_ENTRY_HDR],
+                        sizeof(gaucSeCmd) - uiPos - TKEY_SE_ENVELOPE_ENTRY_HDR);
+        if(0 == uiEntryLen) {
+            return E_TKEY_SE_BUFFER_TOO_SMALL;
+        }
+        gaucSeCmd[uiPos] = (TKey_BYTE)(uiEntryLen >> 8);
+        gaucSeCmd[uiPos + 1] = (TKey_BYTE)uiEntryLen;
+        uiPos += TKEY_SE_ENVELOPE_ENTRY_HDR + uiEntryLen;
+    }
+
+    memset(&sEnvelope, 0, sizeof(sEnvelope));
+    sEnvelope.ucCla = TKEY_SE_CLA;
+    sEnvelope.ucIns = TKEY_SE_INS_ENVELOPE;
+    sEnvelope.ucP1 = (TKey_BYTE)uiCount;
+    sEnvelope.pucData = gaucSeCmd;
+    sEnvelope.uiLc = uiPos;
+    sEnvelope.uiLe = TKEY_SE_MAX_APDU_SIZE;
+    uiTxLen = TKey_Se_EncodeApdu(&sEnvelope, gaucSeTx, sizeof(gaucSeTx));
+    if(0 == uiTxLen) {
+        return E_TKEY_SE_BUFFER_TOO_SMALL;
+    }
+
+    gsSeChannel.sStats.uiEnvelopes++;
+    gsSeChannel.sStats.uiApdus += uiCount;
+    eStatus = tkey_se_bus_exchange(uiTxLen, &uiRxLen);
+    if(E_TKEY_SE_SUCCESS != eStatus) {
+        return eStatus;
+    }
+    sEnvResp.usSw = (TKey_UINT16)((gaucSeRx[uiRxLen - 2] << 8) |
+                                  gaucSeRx[uiRxLen - 1]);
+    if(TKEY_SE_SW_INS_NOT_SUPPORTED == sEnvResp.usSw) {
+        /* Remember for the rest of the session and let the caller resend */
+        gsSeChannel.bNoEnvelope = TKey_TRUE;
+        gsSeChannel.sStats.uiFallbacks++;
+        return E_TKEY_SE_FAILURE;
+    }
+    if(TKEY_SE_SW_OK != sEnvResp.usSw) {
+        gsSeChannel.sStats.uiErrors++;
+        return E_TKEY_SE_BUS_ERROR;
+    }
+
+    /* Split the envelope response over the batch responses */
+    uiRxLen -= TKEY_SE_SW_SIZE;
+    uiPos = 0;
+    for(uiIndex = uiFirst; uiIndex < uiFirst + uiCount; uiIndex++) {
+        if(uiPos + TKEY_SE_ENVELOPE_ENTRY_HDR > uiRxLen) {
+            return E_TKEY_SE_BUS_ERROR;
+        }
+        uiEntryLen = ((TKey_UINT32)gaucSeRx[uiPos] << 8) | gaucSeRx[uiPos + 1];
+        uiPos += TKEY_SE_ENVELOPE_ENTRY_HDR;
+        if(uiEntryLen < TKEY_SE_SW_SIZE || uiPos + uiEntryLen > uiRxLen) {
+            return E_TKEY_SE_BUS_ERROR;
+        }
+        eStatus = tkey_se_store_response(psBatch->apsResp[uiIndex],
+                                         &gaucSeRx[uiPos], uiEntryLen);
+        if(E_TKEY_SE_SUCCESS != eStatus) {
+            eResult = eStatus;
+        }
+        uiPos += uiEntryLen;
+    }
+    return eResult;
+}
+
+/* Worst case size of one command inside an envelope, and of its response */
+static TKey_UINT32 tkey_se_entry_tx_size(const TKey_SeApdu_t *psApdu)
+{
+    return TKEY_SE_ENVELOPE_ENTRY_HDR + 4 + 3 + psApdu->uiLc + 2;
+}
+
+static TKey_UINT32 tkey_se_entry_rx_size(const TKey_SeApdu_t *psApdu)
+{
+    return TKEY_SE_ENVELOPE_ENTRY_HDR + psApdu->uiLe + TKEY_SE_SW_SIZE;
+}
+
+static TKey_SeStatus_t tkey_se_execute_batch(TKey_SeBatch_t *psBatch)
+{
+    /* Envelope header overhead: CLA INS P1 P2 00 Lc Lc Le Le */
+    const TKey_UINT32 uiBudget = TKEY_SE_MAX_APDU_SIZE - 9;
+    TKey_UINT32 uiFirst = 0;
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiTx;
+    TKey_UINT32 uiRx;
+    TKey_SeStatus_t eStatus;
+    TKey_SeStatus_t eResult = E_TKEY_SE_SUCCESS;
+
+    while(uiFirst < psBatch->uiCount) {
+        /* Take as many commands as fit in one frame both ways */
+        uiCount = 0;
+        uiTx = 0;
+        uiRx = 0;
+        while(!gsSeChannel.bNoEnvelope &&
+              uiFirst + uiCount < psBatch->uiCount) {
+            const TKey_SeApdu_t *psApdu = psBatch->apsApdu[uiFirst + uiCount];
+            if(uiTx + tkey_se_entry_tx_size(psApdu) > uiBudget ||
+               uiRx + tkey_se_entry_rx_size(psApdu) > uiBudget) {
+                break;
+            }
+            uiTx += tkey_se_entry_tx_size(psApdu);
+            uiRx += tkey_se_entry_rx_size(psApdu);
+            uiCount++;
+        }
+
+        if(uiCount > 1) {
+            eStatus = tkey_se_send_envelope(psBatch, uiFirst, uiCount);
+            if(E_TKEY_SE_FAILURE == eStatus && gsSeChannel.bNoEnvelope) {
+                continue;   /* resend this chunk one by one */
+            }
+        } else {
+            uiCount = 1;
+            eStatus = tkey_se_transceive_one(psBatch->apsApdu[uiFirst],
+                                             psBatch->apsResp[uiFirst]);
+        }
+        if(E_TKEY_SE_SUCCESS != eStatus) {
+            eResult = eStatus;
+            if(E_TKEY_SE_BUFFER_TOO_SMALL != eStatus) {
+                break;
+            }
+        }
+        uiFirst += uiCount;
+    }
+    return eResult;
+}
+
+TKey_SeStatus_t TKey_Se_ExecuteBatch(TKey_SeBatch_t *psBatch)
+{
+    TKey_SeStatus_t eStatus;
+
+    if(TKey_NULL == psBatch) {
+        return E_TKEY_SE_INVALID_ARG;
+    }
+    eStatus = tkey_se_check_owner();
+    if(E_TKEY_SE_SUCCESS != eStatus) {
+        return eStatus;
+    }
+    return tkey_se_execute_batch(psBatch);
+}
+
+static TKey_VOID tkey_se_worker_task(TKey_VOID *pvParams)
+{
+    TKey_SeBatch_t *psBatch;
+    TKey_SeStatus_t eStatus;
+
+    (TKey_VOID)pvParams;
+    while(TKey_FOREVER) {
+        if(E_THINKEY_SUCCESS !=
+           THINKey_OSAL_eQueueReceive(gsSeChannel.hQueue, &psBatch)) {
+            continue;
+        }
+        gsSeChannel.bInWorker = TKey_TRUE;
+        eStatus = tkey_se_execute_batch(psBatch);
+        if(TKey_NULL != psBatch->pfnDone) {
+            psBatch->pfnDone(psBatch, eStatus, psBatch->pvCtx);
+        }
+        gsSeChannel.bInWorker = TKey_FALSE;
+    }
+}
+
+THINKEY_OSAL_QUEUE_STORAGE(se, gsSeQueue, TKEY_SE_QUEUE_LENGTH,
+                           sizeof(TKey_SeBatch_t *));
+THINKEY_OSAL_TASK_STORAGE(se, gsSeTask, TKEY_SE_TASK_STACK_SIZE);
+
+TKey_StatusType TKey_Se_StartWorker(TKey_VOID)
+{
+    TKey_UINT32 uiTaskId;
+
+    if(!gsSeChannel.bOpen) {
+        return E_TKEY_FAILURE;
+    }
+    if(gsSeChannel.bWorkerRunning) {
+        return E_TKEY_SUCCESS;
+    }
+    gsSeChannel.hQueue = THINKEY_OSAL_CREATE_STATIC_QUEUE(gsSeQueue,
+                                TKEY_SE_QUEUE_LENGTH, sizeof(TKey_SeBatch_t *));
+    if(TKey_NULL == gsSeChannel.hQueue) {
+        return E_TKEY_FAILURE;
+    }
+    THINKey_OSAL_vQueueSetName(gsSeChannel.hQueue, "SE");
+    gsSeChannel.bWorkerRunning = TKey_TRUE;
+    if(E_THINKEY_SUCCESS != THINKEY_OSAL_CREATE_STATIC_TASK(gsSeTask, "SE Task",
+                                tkey_se_worker_task, TKey_NULL,
+                                TKEY_SE_TASK_PRIORITY, &uiTaskId)) {
+        gsSeChannel.bWorkerRunning = TKey_FALSE;
+        THINKEY_DEBUG_ERROR("SEAL: worker task creation failed");
+        return E_TKEY_FAILURE;
+    }
+    return E_TKEY_SUCCESS;
+}
+
+TKey_SeStatus_t TKey_Se_SubmitBatch(TKey_SeBatch_t *psBatch,
+                                    TKey_SeBatchDone_t pfnDone,
+                                    TKey_VOID *pvCtx)
+{
+    if(TKey_NULL == psBatch || 0 == psBatch->uiCount) {
+        return E_TKEY_SE_INVALID_ARG;
+    }
+    if(!gsSeChannel.bWorkerRunning) {
+        return E_TKEY_SE_FAILURE;
+    }
+    psBatch->pfnDone = pfnDone;
+    psBatch->pvCtx = pvCtx;
+    if(E_THINKEY_SUCCESS !=
+       THINKey_OSAL_eQueueSend(gsSeChannel.hQueue, &psBatch)) {
+        return E_TKEY_SE_QUEUE_FULL;
+    }
+    return E_TKEY_SE_SUCCESS;
+}
+
+TKey_VOID TKey_Se_GetStats(TKey_SeStats_t *psStats)
+{
+    *psStats = gsSeChannel.sStats;
+}
+
+/* Boards fitted with an SE provide the bus in their BSP */
+__attribute__((weak)) const TKey_SeBusOps_t* tkey_se_board_bus(
+        TKey_VOID **ppvBusCtx)
+{
+    *ppvBusCtx = TKey_NULL;
+    return TKey_NULL;
+}
+
+TKey_VOID tkey_se_init(TKey_VOID)
+{
+    TKey_VOID *pvBusCtx = TKey_NULL;
+    const TKey_SeBusOps_t *psBus = tkey_se_board_bus(&pvBusCtx);
+
+    if(TKey_NULL == psBus) {
+        THINKEY_DEBUG_INFO("SEAL: no secure element on this board");
+        return;
+    }
+    if(E_TKEY_SUCCESS == TKey_Se_Init(psBus, pvBusCtx)) {
+        TKey_SeCrypto_Register();
+    }
+}
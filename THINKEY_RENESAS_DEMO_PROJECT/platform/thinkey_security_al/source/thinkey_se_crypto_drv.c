@@ -0,0 +1,296 @@
+/*
+ * \file thinkey_se_crypto_drv.c
+ *
+ * \brief Opaque crypto driver backed by the secure element key slots
+ *
+ * Each operation is one APDU of the THINKey SE command set (see
+ * thinkey_se_al.h). CCM command data is
+ *     nonce_len(1) || nonce || aad_len(2) || aad || payload [|| tag]
+ * and the response is ciphertext || tag (encrypt) or plaintext (decrypt).
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_platform_types.h"
+#include "thinkey_crypto_drv.h"
+#include "thinkey_se_al.h"
+#include <string.h>
+
+#define TKEY_SE_CRYPTO_CCM_MAX_NONCE 13
+#define TKEY_SE_CRYPTO_CCM_MAX_TAG 16
+
+/* Dynamic slot allocation; slots below TKEY_SE_FIRST_DYNAMIC_SLOT hold
+ * keys provisioned at manufacturing and are addressed directly */
+static TKey_BYTE gaucSeSlotUsed[TKEY_SE_NUM_KEY_SLOTS];
+static TKey_BYTE gaucSeCmdBuf[TKEY_SE_MAX_APDU_SIZE];
+static TKey_BYTE gaucSeRespBuf[TKEY_SE_MAX_APDU_SIZE];
+
+static TKey_CryptoStatus_t tkey_se_crypto_status(TKey_SeStatus_t eStatus,
+                                                 TKey_UINT16 usSw)
+{
+    if(E_TKEY_SE_SUCCESS != eStatus) {
+        return (E_TKEY_SE_INVALID_ARG == eStatus ||
+                E_TKEY_SE_BUFFER_TOO_SMALL == eStatus) ?
+                E_TKEY_CRYPTO_INVALID_ARG : E_TKEY_CRYPTO_FAILURE;
+    }
+    switch(usSw) {
+        case TKEY_SE_SW_OK:
+            return E_TKEY_CRYPTO_SUCCESS;
+        case TKEY_SE_SW_AUTH_FAILED:
+            return E_TKEY_CRYPTO_AUTH_FAILED;
+        case TKEY_SE_SW_WRONG_LENGTH:
+        case TKEY_SE_SW_WRONG_DATA:
+        case TKEY_SE_SW_NOT_FOUND:
+            return E_TKEY_CRYPTO_INVALID_ARG;
+        case TKEY_SE_SW_NO_MEMORY:
+            return E_TKEY_CRYPTO_NO_MEMORY;
+        case TKEY_SE_SW_INS_NOT_SUPPORTED:
+            return E_TKEY_CRYPTO_NOT_SUPPORTED;
+        default:
+            return E_TKEY_CRYPTO_FAILURE;
+    }
+}
+
+/* Sends one command and checks the response length when one is expected */
+static TKey_CryptoStatus_t tkey_se_crypto_command(TKey_BYTE ucIns,
+        TKey_BYTE ucP1, TKey_BYTE ucP2, const TKey_BYTE *pucData,
+        TKey_UINT32 uiLc, TKey_BYTE *pucOut, TKey_UINT32 uiOutLen)
+{
+    TKey_SeApdu_t sApdu;
+    TKey_SeResponse_t sResp;
+    TKey_SeStatus_t eStatus;
+    TKey_CryptoStatus_t eResult;
+
+    sApdu.ucCla = TKEY_SE_CLA;
+    sApdu.ucIns = ucIns;
+    sApdu.ucP1 = ucP1;
+    sApdu.ucP2 = ucP2;
+    sApdu.pucData = pucData;
+    sApdu.uiLc = uiLc;
+    sApdu.uiLe = uiOutLen;
+    sResp.pucData = pucOut;
+    sResp.uiSize = uiOutLen;
+    sResp.uiLen = 0;
+    sResp.usSw = 0;
+
+    eStatus = TKey_Se_Transceive(&sApdu, &sResp);
+    eResult = tkey_se_crypto_status(eStatus, sResp.usSw);
+    if(E_TKEY_CRYPTO_SUCCESS == eResult && sResp.uiLen != uiOutLen) {
+        eResult = E_TKEY_CRYPTO_FAILURE;
+    }
+    return eResult;
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_alloc_slot(TKey_UINT32 *puiSlot)
+{
+    TKey_UINT32 uiSlot;
+
+    for(uiSlot = TKEY_SE_FIRST_DYNAMIC_SLOT; uiSlot < TKEY_SE_NUM_KEY_SLOTS;
+        uiSlot++) {
+        if(0 == gaucSeSlotUsed[uiSlot]) {
+            *puiSlot = uiSlot;
+            return E_TKEY_CRYPTO_SUCCESS;
+        }
+    }
+    return E_TKEY_CRYPTO_NO_MEMORY;
+}
+
+static TKey_BYTE tkey_se_crypto_key_type(TKey_CryptoKeyType_t eType)
+{
+    return (E_TKEY_CRYPTO_KEY_AES == eType) ? TKEY_SE_KEY_TYPE_AES :
+                                              TKEY_SE_KEY_TYPE_P256;
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_import_key(
+        TKey_CryptoKeyType_t eType, const TKey_BYTE *pucKey,
+        TKey_UINT32 uiKeyLen, TKey_UINT32 *puiSlot)
+{
+    TKey_CryptoStatus_t eStatus;
+    TKey_UINT32 uiSlot;
+
+    eStatus = tkey_se_crypto_alloc_slot(&uiSlot);
+    if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+        return eStatus;
+    }
+    eStatus = tkey_se_crypto_command(TKEY_SE_INS_IMPORT_KEY, (TKey_BYTE)uiSlot,
+                    tkey_se_crypto_key_type(eType), pucKey, uiKeyLen,
+                    TKey_NULL, 0);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        gaucSeSlotUsed[uiSlot] = 1;
+        *puiSlot = uiSlot;
+    }
+    return eStatus;
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_generate_key(
+        TKey_CryptoKeyType_t eType, TKey_UINT32 uiKeyLen, TKey_UINT32 *puiSlot)
+{
+    TKey_CryptoStatus_t eStatus;
+    TKey_BYTE ucKeyLen = (TKey_BYTE)uiKeyLen;
+    TKey_UINT32 uiSlot;
+
+    eStatus = tkey_se_crypto_alloc_slot(&uiSlot);
+    if(E_TKEY_CRYPTO_SUCCESS != eStatus) {
+        return eStatus;
+    }
+    eStatus = tkey_se_crypto_command(TKEY_SE_INS_GENERATE_KEY,
+                    (TKey_BYTE)uiSlot, tkey_se_crypto_key_type(eType),
+                    &ucKeyLen, 1, TKey_NULL, 0);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        gaucSeSlotUsed[uiSlot] = 1;
+        *puiSlot = uiSlot;
+    }
+    return eStatus;
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_destroy_key(TKey_UINT32 uiSlot)
+{
+    TKey_CryptoStatus_t eStatus;
+
+    if(uiSlot >= TKEY_SE_NUM_KEY_SLOTS) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    eStatus = tkey_se_crypto_command(TKEY_SE_INS_DELETE_KEY, (TKey_BYTE)uiSlot,
+                                     0, TKey_NULL, 0, TKey_NULL, 0);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        gaucSeSlotUsed[uiSlot] = 0;
+    }
+    return eStatus;
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_export_public_key(
+        TKey_UINT32 uiSlot, TKey_BYTE *pucPub)
+{
+    return tkey_se_crypto_command(TKEY_SE_INS_GET_PUBLIC_KEY, (TKey_BYTE)uiSlot,
+                    0, TKey_NULL, 0, pucPub, TKEY_CRYPTO_P256_PUB_KEY_SIZE);
+}
+
+/* Lays out the CCM command data; returns its length, 0 if too large */
+static TKey_UINT32 tkey_se_crypto_ccm_data(const TKey_BYTE *pucNonce,
+        TKey_UINT32 uiNonceLen, const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen,
+        const TKey_BYTE *pucIn, TKey_UINT32 uiLen, const TKey_BYTE *pucTag,
+        TKey_UINT32 uiTagLen)
+{
+    TKey_UINT32 uiPos = 0;
+
+    /* 9 bytes of APDU header with extended lengths, plus the response */
+    if(uiNonceLen > TKEY_SE_CRYPTO_CCM_MAX_NONCE ||
+       1 + uiNonceLen + 2 + uiAadLen + uiLen + uiTagLen + 9 >
+       sizeof(gaucSeCmdBuf)) {
+        return 0;
+    }
+    gaucSeCmdBuf[uiPos++] = (TKey_BYTE)uiNonceLen;
+    memcpy(&gaucSeCmdBuf[uiPos], pucNonce, uiNonceLen);
+    uiPos += uiNonceLen;
+    gaucSeCmdBuf[uiPos++] = (TKey_BYTE)(uiAadLen >> 8);
+    gaucSeCmdBuf[uiPos++] = (TKey_BYTE)uiAadLen;
+    if(0 != uiAadLen) {
+        memcpy(&gaucSeCmdBuf[uiPos], pucAad, uiAadLen);
+        uiPos += uiAadLen;
+    }
+    if(0 != uiLen) {
+        memcpy(&gaucSeCmdBuf[uiPos], pucIn, uiLen);
+        uiPos += uiLen;
+    }
+    if(TKey_NULL != pucTag) {
+        memcpy(&gaucSeCmdBuf[uiPos], pucTag, uiTagLen);
+        uiPos += uiTagLen;
+    }
+    return uiPos;
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_ccm_encrypt(TKey_UINT32 uiSlot,
+        const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen, const TKey_BYTE *pucIn,
+        TKey_UINT32 uiLen, TKey_BYTE *pucOut, TKey_BYTE *pucTag,
+        TKey_UINT32 uiTagLen)
+{
+    TKey_CryptoStatus_t eStatus;
+    TKey_UINT32 uiLc;
+
+    if(uiTagLen > TKEY_SE_CRYPTO_CCM_MAX_TAG) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    uiLc = tkey_se_crypto_ccm_data(pucNonce, uiNonceLen, pucAad, uiAadLen,
+                                   pucIn, uiLen, TKey_NULL, uiTagLen);
+    if(0 == uiLc) {
+        return E_TKEY_CRYPTO_NOT_SUPPORTED;
+    }
+    eStatus = tkey_se_crypto_command(TKEY_SE_INS_CCM_ENCRYPT, (TKey_BYTE)uiSlot,
+                    (TKey_BYTE)uiTagLen, gaucSeCmdBuf, uiLc, gaucSeRespBuf,
+                    uiLen + uiTagLen);
+    if(E_TKEY_CRYPTO_SUCCESS == eStatus) {
+        memcpy(pucOut, gaucSeRespBuf, uiLen);
+        memcpy(pucTag, &gaucSeRespBuf[uiLen], uiTagLen);
+    }
+    memset(gaucSeRespBuf, 0, uiLen + uiTagLen);
+    return eStatus;
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_ccm_decrypt(TKey_UINT32 uiSlot,
+        const TKey_BYTE *pucNonce, TKey_UINT32 uiNonceLen,
+        const TKey_BYTE *pucAad, TKey_UINT32 uiAadLen, const TKey_BYTE *pucIn,
+        TKey_UINT32 uiLen, TKey_BYTE *pucOut, const TKey_BYTE *pucTag,
+        TKey_UINT32 uiTagLen)
+{
+    TKey_UINT32 uiLc;
+
+    if(uiTagLen > TKEY_SE_CRYPTO_CCM_MAX_TAG) {
+        return E_TKEY_CRYPTO_INVALID_ARG;
+    }
+    uiLc = tkey_se_crypto_ccm_data(pucNonce, uiNonceLen, pucAad, uiAadLen,
+                                   pucIn, uiLen, pucTag, uiTagLen);
+    if(0 == uiLc) {
+        return E_TKEY_CRYPTO_NOT_SUPPORTED;
+    }
+    return tkey_se_crypto_command(TKEY_SE_INS_CCM_DECRYPT, (TKey_BYTE)uiSlot,
+                    (TKey_BYTE)uiTagLen, gaucSeCmdBuf, uiLc, pucOut, uiLen);
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_cmac(TKey_UINT32 uiSlot,
+        const TKey_BYTE *pucMsg, TKey_UINT32 uiLen, TKey_BYTE *pucMac)
+{
+    if(uiLen + TKEY_CRYPTO_CMAC_SIZE + 9 > TKEY_SE_MAX_APDU_SIZE) {
+        return E_TKEY_CRYPTO_NOT_SUPPORTED;
+    }
+    return tkey_se_crypto_command(TKEY_SE_INS_CMAC, (TKey_BYTE)uiSlot, 0,
+                    pucMsg, uiLen, pucMac, TKEY_CRYPTO_CMAC_SIZE);
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_ecdh(TKey_UINT32 uiSlot,
+        const TKey_BYTE *pucPeerPub, TKey_BYTE *pucSecret)
+{
+    return tkey_se_crypto_command(TKEY_SE_INS_ECDH, (TKey_BYTE)uiSlot, 0,
+                    pucPeerPub, TKEY_CRYPTO_P256_PUB_KEY_SIZE, pucSecret,
+                    TKEY_CRYPTO_P256_SECRET_SIZE);
+}
+
+static TKey_CryptoStatus_t tkey_se_crypto_sign(TKey_UINT32 uiSlot,
+        const TKey_BYTE *pucHash, TKey_BYTE *pucSig)
+{
+    return tkey_se_crypto_command(TKEY_SE_INS_SIGN, (TKey_BYTE)uiSlot, 0,
+                    pucHash, TKEY_CRYPTO_SHA256_SIZE, pucSig,
+                    TKEY_CRYPTO_P256_SIG_SIZE);
+}
+
+const TKey_CryptoOpaqueDrv_t gsTKeySeCryptoDriver =
+{
+    "se",
+    TKEY_CRYPTO_DRIVER_ID_SE,
+    tkey_se_crypto_import_key,
+    tkey_se_crypto_generate_key,
+    tkey_se_crypto_destroy_key,
+    tkey_se_crypto_export_public_key,
+    tkey_se_crypto_ccm_encrypt,
+    tkey_se_crypto_ccm_decrypt,
+    tkey_se_crypto_cmac,
+    tkey_se_crypto_ecdh,
+    tkey_se_crypto_sign
+};
+
+TKey_CryptoStatus_t TKey_SeCrypto_Register(TKey_VOID)
+{
+    memset(gaucSeSlotUsed, 0, sizeof(gaucSeSlotUsed));
+    return TKey_Crypto_RegisterOpaqueDriver(&gsTKeySeCryptoDriver);
+}
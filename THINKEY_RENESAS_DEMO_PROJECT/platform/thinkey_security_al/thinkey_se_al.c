@@ -1,14 +0,0 @@
-#include "thinkey_types.h"
-#include "thinkey_se_al.h"
-
-TKey_VOID tkey_se_init(){
-}
-
-
-
-THINKey_INT32 tkey_se_transceive() {
-    THINKey_INT32 retStatus;
-
-    return retStatus;
-}
-
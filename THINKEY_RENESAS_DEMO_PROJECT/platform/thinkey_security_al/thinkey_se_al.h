@@ -1,7 +0,0 @@
-/* Secure element abstraction header file */
-
-/* Initialise secure element */
-TKey_VOID tkey_se_init();
-
-/* Dummy function to perform operations*/
-THINKey_INT32 tkey_se_transceive();
@@ -0,0 +1,85 @@
+/*
+ * \file thinkey_dkstore.h
+ *
+ * \brief Digital key store header file
+ *
+ * Persists the digital key pair in the object store on the data flash.
+ * Updates are written behind by the storage worker task
+ * (thinkey_objstore_async.h); reads see them at once.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_DKSTORE_H
+#define THINKEY_DKSTORE_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_flash_al.h"
+#include "thinkey_objstore.h"
+#include "thinkey_objstore_async.h"
+
+/**
+ *  @brief Stored digital key objects
+ */
+typedef enum
+{
+    E_TKEY_STORE_PUBLIC_KEY,
+    E_TKEY_STORE_PRIVATE_KEY
+} TKey_DKObject_t;
+
+/**
+ * \brief   Mounts the key store on the RA data flash and starts the
+ *          storage worker
+ */
+TKey_StatusType TKey_DkStore_Init(TKey_VOID);
+
+/**
+ * \brief   Mounts the key store on the given flash device and loads the
+ *          multi-key store (thinkey_keystore.h) from it. Writes are
+ *          synchronous until TKey_ObjStoreAsync_StartWorker() is called.
+ */
+TKey_StatusType TKey_DkStore_InitOnDevice(const TKey_FlashDev_t *psDev);
+
+/**
+ * \brief   Queues a write of a key object: 65 bytes for the public key, 32
+ *          bytes for the private key. Returns without waiting for the
+ *          flash; the previous value stays in flash until the new one is
+ *          completely written.
+ */
+TKey_StatusType TKey_DkStore_Write(TKey_DKObject_t eObjType, TKey_BYTE* pucData,
+                                   TKey_UINT32 size);
+
+/**
+ * \brief   Same as TKey_DkStore_Write(), with pfnDone called from the
+ *          storage worker once the key is in flash
+ */
+TKey_StatusType TKey_DkStore_WriteAsync(TKey_DKObject_t eObjType,
+        TKey_BYTE* pucData, TKey_UINT32 size, TKey_ObjStoreDone_t pfnDone,
+        TKey_VOID *pvCtx);
+
+/**
+ * \brief   Reads a key object of size bytes, queued writes included
+ */
+TKey_StatusType TKey_DkStore_Read(TKey_DKObject_t eObjType, TKey_BYTE* pucData,
+                                  TKey_UINT32 size);
+
+/**
+ * \brief   Returns a view of a key object straight from the data flash,
+ *          without copying it. The public key is pinned, so it is also
+ *          served while the flash is being programmed or erased. A view
+ *          shows the value in flash, not a queued write. Check
+ *          TKey_DkStore_ViewValid() after using the data.
+ */
+TKey_StatusType TKey_DkStore_View(TKey_DKObject_t eObjType, TKey_ObjView_t *psView);
+
+/**
+ * \brief   Tells whether a view is still intact after use
+ */
+TKey_BOOL TKey_DkStore_ViewValid(const TKey_ObjView_t *psView);
+
+/**
+ * \brief   Erases both key objects
+ */
+TKey_StatusType TKey_DkStore_Erase(TKey_VOID);
+
+#endif /* THINKEY_DKSTORE_H */
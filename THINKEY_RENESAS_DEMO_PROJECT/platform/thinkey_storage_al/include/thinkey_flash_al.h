@@ -0,0 +1,53 @@
+/*
+ * \file thinkey_flash_al.h
+ *
+ * \brief Flash abstraction header file
+ *
+ * A flash device is a partition addressed by byte offset from its start,
+ * with an erase unit and a program unit. Erased bytes read as 0xFF unless
+ * the device provides eBlankCheck (the RA data flash reads back undefined
+ * values when erased and must be blank checked instead).
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_FLASH_AL_H
+#define THINKEY_FLASH_AL_H
+
+#include "thinkey_platform_types.h"
+
+/**
+ *  @brief Flash device description and operations
+ */
+typedef struct
+{
+    const TKey_CHAR *pcName;
+    TKey_UINT32 uiSize;         /* partition size in bytes */
+    TKey_UINT32 uiEraseSize;    /* erase unit in bytes */
+    TKey_UINT32 uiWriteSize;    /* program unit in bytes */
+    TKey_VOID *pvCtx;
+    /* Base of the partition in the address space when reads are memory
+     * mapped, TKey_NULL otherwise */
+    const TKey_BYTE *pucMapped;
+
+    TKey_StatusType (*eRead)(TKey_VOID *pvCtx, TKey_UINT32 uiOffset,
+            TKey_BYTE *pucBuf, TKey_UINT32 uiLen);
+    /* Offset and length are multiples of uiWriteSize; the area is blank */
+    TKey_StatusType (*eProgram)(TKey_VOID *pvCtx, TKey_UINT32 uiOffset,
+            const TKey_BYTE *pucBuf, TKey_UINT32 uiLen);
+    /* Offset and length are multiples of uiEraseSize */
+    TKey_StatusType (*eErase)(TKey_VOID *pvCtx, TKey_UINT32 uiOffset,
+            TKey_UINT32 uiLen);
+    /* Optional; TKey_NULL compares against 0xFF */
+    TKey_StatusType (*eBlankCheck)(TKey_VOID *pvCtx, TKey_UINT32 uiOffset,
+            TKey_UINT32 uiLen, TKey_BOOL *pbBlank);
+} TKey_FlashDev_t;
+
+/**
+ * \brief   Returns the RA6M5 data flash device, opening the flash driver
+ *          on first use. Returns TKey_NULL if the driver fails to open,
+ *          and on the host, which has no data flash.
+ */
+const TKey_FlashDev_t* TKey_FlashRa_GetDataFlash(TKey_VOID);
+
+#endif /* THINKEY_FLASH_AL_H */
@@ -0,0 +1,194 @@
+/*
+ * \file thinkey_keystore.h
+ *
+ * \brief Multi-key store header file
+ *
+ * Holds up to TKEY_KEYSTORE_MAX_KEYS digital key records (owner, friend and
+ * shared keys) for the vehicle. Each record is one object of the object
+ * store, written behind by the storage worker (thinkey_objstore_async.h),
+ * and is mirrored in RAM. Two RAM indexes are kept: an array of slots
+ * sorted by key identifier, searched in O(log n), and an open addressed
+ * hash table of the public keys, searched in O(1) on average.
+ *
+ * Lookups may come from any task once the store is loaded; the indexes
+ * are only touched inside short critical sections. Changes (add, suspend,
+ * revoke, update, delete) must come from one task, so that they reach the
+ * flash in the order they were made.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_KEYSTORE_H
+#define THINKEY_KEYSTORE_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_objstore.h"
+
+/**
+ *  @brief Key store configuration
+ */
+#ifndef TKEY_KEYSTORE_MAX_KEYS
+#define TKEY_KEYSTORE_MAX_KEYS 32
+#endif
+/* Public key hash table size, a power of two of at least twice the keys */
+#ifndef TKEY_KEYSTORE_HASH_SLOTS
+#define TKEY_KEYSTORE_HASH_SLOTS 64
+#endif
+/* How long a change waits for room in the write-behind queue */
+#ifndef TKEY_KEYSTORE_QUEUE_WAIT_MS
+#define TKEY_KEYSTORE_QUEUE_WAIT_MS 500
+#endif
+#define TKEY_KEYSTORE_PUBLIC_KEY_SIZE 65    /* uncompressed P-256 point */
+
+#if (TKEY_OBJ_ID_KEY_FIRST + TKEY_KEYSTORE_MAX_KEYS) > TKEY_OBJSTORE_MAX_OBJECTS
+#error "TKEY_KEYSTORE_MAX_KEYS does not fit TKEY_OBJSTORE_MAX_OBJECTS"
+#endif
+#if TKEY_KEYSTORE_MAX_KEYS > 256
+#error "TKEY_KEYSTORE_MAX_KEYS above 256 does not fit the record slot"
+#endif
+#if (TKEY_KEYSTORE_HASH_SLOTS & (TKEY_KEYSTORE_HASH_SLOTS - 1)) != 0 || \
+    TKEY_KEYSTORE_HASH_SLOTS < 2 * TKEY_KEYSTORE_MAX_KEYS
+#error "TKEY_KEYSTORE_HASH_SLOTS must be a power of two >= 2 * max keys"
+#endif
+
+/**
+ *  @brief Entitlements, a bit mask
+ */
+#define TKEY_KEY_ENT_UNLOCK         0x00000001
+#define TKEY_KEY_ENT_LOCK           0x00000002
+#define TKEY_KEY_ENT_ENGINE_START   0x00000004
+#define TKEY_KEY_ENT_TRUNK          0x00000008
+#define TKEY_KEY_ENT_SHARE          0x00000010  /* may share friend keys */
+#define TKEY_KEY_ENT_ALL            0xFFFFFFFF
+
+/**
+ *  @brief Validity window bounds meaning "no bound"
+ */
+#define TKEY_KEY_NOT_BEFORE_ANY     0x00000000
+#define TKEY_KEY_NOT_AFTER_ANY      0xFFFFFFFF
+
+/**
+ *  @brief Key store status codes
+ */
+typedef enum
+{
+    E_TKEY_KEYSTORE_SUCCESS,
+    E_TKEY_KEYSTORE_FAILURE,
+    E_TKEY_KEYSTORE_INVALID_ARG,
+    E_TKEY_KEYSTORE_NOT_FOUND,
+    E_TKEY_KEYSTORE_EXISTS,
+    E_TKEY_KEYSTORE_FULL,
+    E_TKEY_KEYSTORE_SUSPENDED,
+    E_TKEY_KEYSTORE_REVOKED,
+    E_TKEY_KEYSTORE_NOT_YET_VALID,
+    E_TKEY_KEYSTORE_EXPIRED,
+    E_TKEY_KEYSTORE_NOT_ENTITLED
+} TKey_KeyStoreStatus_t;
+
+/**
+ *  @brief Key roles
+ */
+typedef enum
+{
+    E_TKEY_KEY_ROLE_OWNER,
+    E_TKEY_KEY_ROLE_FRIEND,
+    E_TKEY_KEY_ROLE_SHARED
+} TKey_KeyRole_t;
+
+/**
+ *  @brief Key states. A revoked key is kept so that it is refused, until
+ *         it is deleted.
+ */
+typedef enum
+{
+    E_TKEY_KEY_STATE_ACTIVE,
+    E_TKEY_KEY_STATE_SUSPENDED,
+    E_TKEY_KEY_STATE_REVOKED
+} TKey_KeyState_t;
+
+/**
+ *  @brief Key record, stored as is in the object store
+ */
+typedef struct
+{
+    TKey_UINT32 uiKeyId;
+    TKey_UINT32 uiEntitlements;     /* TKEY_KEY_ENT_* */
+    TKey_UINT32 uiNotBefore;        /* seconds, inclusive */
+    TKey_UINT32 uiNotAfter;         /* seconds, inclusive */
+    TKey_BYTE ucVersion;            /* set by the store */
+    TKey_BYTE ucSlot;               /* set by the store */
+    TKey_BYTE ucRole;               /* TKey_KeyRole_t */
+    TKey_BYTE ucState;              /* TKey_KeyState_t */
+    TKey_BYTE aucPublicKey[TKEY_KEYSTORE_PUBLIC_KEY_SIZE];
+} TKey_KeyRecord_t;
+
+/**
+ * \brief   Loads all key records from the object store and builds the RAM
+ *          indexes. The object store must be mounted and
+ *          TKey_ObjStoreAsync_Init() called, as TKey_DkStore_Init() does.
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_Init(TKey_VOID);
+
+/**
+ * \brief   Adds a key. ucSlot and ucVersion of *psRecord are filled in; the
+ *          key ID and the public key must both be new.
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_Add(TKey_KeyRecord_t *psRecord);
+
+/**
+ * \brief   Copies the record of the key ID into *psRecord
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_FindById(TKey_UINT32 uiKeyId,
+        TKey_KeyRecord_t *psRecord);
+
+/**
+ * \brief   Copies the record holding the public key into *psRecord
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_FindByPublicKey(
+        const TKey_BYTE *pucPublicKey, TKey_KeyRecord_t *psRecord);
+
+/**
+ * \brief   Tells whether the key may be used at time uiNow (seconds) for
+ *          all of uiEntitlements. Returns E_TKEY_KEYSTORE_SUCCESS or the
+ *          reason it may not.
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_CheckAccess(TKey_UINT32 uiKeyId,
+        TKey_UINT32 uiNow, TKey_UINT32 uiEntitlements);
+
+/**
+ * \brief   Returns the number of keys held, revoked ones included
+ */
+TKey_UINT32 TKey_KeyStore_GetCount(TKey_VOID);
+
+/**
+ * \brief   Enumerates keys in key ID order: copies the uiIndex-th record,
+ *          0 to TKey_KeyStore_GetCount() - 1, into *psRecord
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_GetByIndex(TKey_UINT32 uiIndex,
+        TKey_KeyRecord_t *psRecord);
+
+/**
+ * \brief   Suspends an active key, or reactivates a suspended one with
+ *          bSuspend TKey_FALSE. A revoked key stays revoked.
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_Suspend(TKey_UINT32 uiKeyId,
+        TKey_BOOL bSuspend);
+
+/**
+ * \brief   Revokes a key for good
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_Revoke(TKey_UINT32 uiKeyId);
+
+/**
+ * \brief   Updates the entitlements and validity window of a key
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_Update(TKey_UINT32 uiKeyId,
+        TKey_UINT32 uiEntitlements, TKey_UINT32 uiNotBefore,
+        TKey_UINT32 uiNotAfter);
+
+/**
+ * \brief   Deletes a key and frees its slot
+ */
+TKey_KeyStoreStatus_t TKey_KeyStore_Delete(TKey_UINT32 uiKeyId);
+
+#endif /* THINKEY_KEYSTORE_H */
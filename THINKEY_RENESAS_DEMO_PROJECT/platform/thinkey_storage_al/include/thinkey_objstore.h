@@ -0,0 +1,271 @@
+/*
+ * \file thinkey_objstore.h
+ *
+ * \brief Log-structured object store header file
+ *
+ * Objects are appended to flash as records (header, data, CRC32) carrying
+ * a store-wide sequence number; the newest valid record of an object is
+ * its current value, so an update is atomic: until the new record is
+ * completely programmed the previous one stays current. A RAM index maps
+ * each object ID to its current record.
+ *
+ * The partition is split into pages of TKEY_OBJSTORE_PAGE_SIZE bytes. One
+ * page is active for appends and one erased page is always kept in
+ * reserve, so that compaction can move the live records of the page with
+ * the most garbage and erase it. New pages are taken least-worn first and
+ * background compaction also moves cold data off little-worn pages.
+ *
+ * A store instance is not reentrant; calls must come from one task.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_OBJSTORE_H
+#define THINKEY_OBJSTORE_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_flash_al.h"
+
+/**
+ *  @brief Object store configuration
+ */
+#ifndef TKEY_OBJSTORE_PAGE_SIZE
+#define TKEY_OBJSTORE_PAGE_SIZE 1024
+#endif
+#ifndef TKEY_OBJSTORE_MAX_PAGES
+#define TKEY_OBJSTORE_MAX_PAGES 16
+#endif
+#ifndef TKEY_OBJSTORE_MAX_OBJECTS
+#define TKEY_OBJSTORE_MAX_OBJECTS 64
+#endif
+#ifndef TKEY_OBJSTORE_MAX_OBJECT_SIZE
+#define TKEY_OBJSTORE_MAX_OBJECT_SIZE 576
+#endif
+/* A largest record (12 byte header, padding) must fit a page after its
+   16 byte header */
+#if TKEY_OBJSTORE_MAX_OBJECT_SIZE + 32 > TKEY_OBJSTORE_PAGE_SIZE
+#error "TKEY_OBJSTORE_MAX_OBJECT_SIZE does not fit TKEY_OBJSTORE_PAGE_SIZE"
+#endif
+/* Background compaction keeps this many erased pages */
+#ifndef TKEY_OBJSTORE_BG_FREE_PAGES
+#define TKEY_OBJSTORE_BG_FREE_PAGES 2
+#endif
+/* Erase count spread that makes background compaction move cold data */
+#ifndef TKEY_OBJSTORE_WEAR_THRESHOLD
+#define TKEY_OBJSTORE_WEAR_THRESHOLD 64
+#endif
+/* RAM shadows of pinned objects, served while the flash is busy */
+#ifndef TKEY_OBJSTORE_SHADOW_SLOTS
+#define TKEY_OBJSTORE_SHADOW_SLOTS 2
+#endif
+#ifndef TKEY_OBJSTORE_SHADOW_SIZE
+#define TKEY_OBJSTORE_SHADOW_SIZE 72
+#endif
+
+/**
+ *  @brief Object IDs, allocated here for all users of the store
+ */
+#define TKEY_OBJ_ID_DK_PUBLIC_KEY   0x01
+#define TKEY_OBJ_ID_DK_PRIVATE_KEY  0x02
+#define TKEY_OBJ_ID_UWB_CONFIG      0x03
+/* Key store records, one per slot (thinkey_keystore.h) */
+#define TKEY_OBJ_ID_KEY_FIRST       0x20
+
+/**
+ *  @brief Object store status codes
+ */
+typedef enum
+{
+    E_TKEY_OBJSTORE_SUCCESS,
+    E_TKEY_OBJSTORE_FAILURE,
+    E_TKEY_OBJSTORE_INVALID_ARG,
+    E_TKEY_OBJSTORE_NOT_FOUND,
+    E_TKEY_OBJSTORE_NO_SPACE,
+    E_TKEY_OBJSTORE_BUFFER_TOO_SMALL,
+    E_TKEY_OBJSTORE_BUSY,
+    E_TKEY_OBJSTORE_QUEUE_FULL,
+    E_TKEY_OBJSTORE_SUPERSEDED
+} TKey_ObjStoreStatus_t;
+
+/**
+ *  @brief Record header as stored in flash. usLen 0 marks a deletion.
+ */
+typedef struct
+{
+    TKey_UINT16 usId;
+    TKey_UINT16 usLen;
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiCrc;          /* CRC32 of usId, usLen, uiSeq and data */
+} TKey_ObjRecordHdr_t;
+
+/**
+ *  @brief RAM index entry
+ */
+typedef struct
+{
+    TKey_UINT32 uiOffset;       /* record offset, TKEY_OBJSTORE_NO_RECORD */
+    TKey_UINT32 uiSeq;
+    TKey_UINT16 usLen;
+} TKey_ObjIndex_t;
+
+#define TKEY_OBJSTORE_NO_RECORD 0xFFFFFFFF
+
+/**
+ *  @brief Per-page bookkeeping
+ */
+typedef struct
+{
+    TKey_UINT32 uiEraseCount;
+    TKey_UINT32 uiUsed;         /* append offset; page size once retired */
+    TKey_UINT32 uiLive;         /* bytes of current records */
+    TKey_BYTE ucState;
+} TKey_ObjPage_t;
+
+/**
+ *  @brief RAM copy of a pinned object
+ */
+typedef struct
+{
+    volatile TKey_UINT32 uiSeq; /* 0 while being updated */
+    TKey_UINT16 usId;           /* TKEY_OBJSTORE_NO_SHADOW when unused */
+    TKey_UINT16 usLen;
+    TKey_UINT32 auiData[(TKEY_OBJSTORE_SHADOW_SIZE + 3) / 4];
+} TKey_ObjShadow_t;
+
+#define TKEY_OBJSTORE_NO_SHADOW 0xFFFF
+
+/**
+ *  @brief Read-only view of an object's current value
+ */
+typedef struct
+{
+    const TKey_BYTE *pucData;
+    TKey_UINT32 uiLen;
+    TKey_UINT32 uiGeneration;   /* sequence number of the record */
+    TKey_UINT32 uiEpoch;        /* flash epoch the view was taken in */
+    const TKey_ObjShadow_t *psShadow;   /* set when served from RAM */
+} TKey_ObjView_t;
+
+/**
+ *  @brief Store statistics
+ */
+typedef struct
+{
+    TKey_UINT32 uiWrites;
+    TKey_UINT32 uiCompactions;
+    TKey_UINT32 uiRecordsMoved;
+    TKey_UINT32 uiErases;
+    TKey_UINT32 uiCorruptRecords;   /* found at mount or on verify */
+    TKey_UINT32 uiFreePages;
+    TKey_UINT32 uiMinEraseCount;
+    TKey_UINT32 uiMaxEraseCount;
+} TKey_ObjStoreStats_t;
+
+/**
+ *  @brief Store instance. Treat as opaque.
+ */
+typedef struct
+{
+    const TKey_FlashDev_t *psDev;
+    TKey_UINT32 uiPageCount;
+    TKey_UINT32 uiActive;
+    TKey_UINT32 uiNextSeq;
+    TKey_BOOL bMounted;
+    TKey_ObjIndex_t asIndex[TKEY_OBJSTORE_MAX_OBJECTS];
+    TKey_ObjPage_t asPage[TKEY_OBJSTORE_MAX_PAGES];
+    TKey_ObjStoreStats_t sStats;
+    volatile TKey_UINT32 uiFlashEpoch;  /* odd while programming/erasing */
+    TKey_ObjShadow_t asShadow[TKEY_OBJSTORE_SHADOW_SLOTS];
+    TKey_UINT32 auiRecord[(sizeof(TKey_ObjRecordHdr_t) +
+                           TKEY_OBJSTORE_MAX_OBJECT_SIZE + 3) / 4];
+} TKey_ObjStore_t;
+
+/**
+ * \brief   Mounts the store on the flash device: scans all pages, rebuilds
+ *          the RAM index and recovers from an interrupted write, erase or
+ *          compaction. Unformatted pages are formatted.
+ */
+TKey_ObjStoreStatus_t TKey_ObjStore_Mount(TKey_ObjStore_t *psStore,
+                                          const TKey_FlashDev_t *psDev);
+
+/**
+ * \brief   Erases every page, dropping all objects. Erase counts are kept
+ *          when the page headers are readable.
+ */
+TKey_ObjStoreStatus_t TKey_ObjStore_Format(TKey_ObjStore_t *psStore,
+                                           const TKey_FlashDev_t *psDev);
+
+/**
+ * \brief   Writes a new value of the object
+ */
+TKey_ObjStoreStatus_t TKey_ObjStore_Write(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, const TKey_BYTE *pucData, TKey_UINT32 uiLen);
+
+/**
+ * \brief   Reads the current value of the object. *puiLen receives its
+ *          length; pass uiSize 0 to query the length only.
+ */
+TKey_ObjStoreStatus_t TKey_ObjStore_Read(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, TKey_BYTE *pucBuf, TKey_UINT32 uiSize,
+        TKey_UINT32 *puiLen);
+
+/**
+ * \brief   Returns a view of the current value of the object without
+ *          copying it: a pointer into memory mapped flash, or into the RAM
+ *          shadow of a pinned object while a program or erase is in
+ *          progress. Records are CRC checked at mount and read back after
+ *          programming, so a view is not re-validated. Returns
+ *          E_TKEY_OBJSTORE_BUSY for an object that is not pinned while the
+ *          flash is busy or when the device is not memory mapped.
+ *
+ *          The data may move or be erased by any later write, delete or
+ *          compaction. Readers in other tasks use the data and then call
+ *          TKey_ObjStore_ViewValid(); on TKey_FALSE they take a new view.
+ */
+TKey_ObjStoreStatus_t TKey_ObjStore_View(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, TKey_ObjView_t *psView);
+
+/**
+ * \brief   Tells whether the data of the view was left untouched since it
+ *          was taken
+ */
+TKey_BOOL TKey_ObjStore_ViewValid(const TKey_ObjStore_t *psStore,
+                                  const TKey_ObjView_t *psView);
+
+/**
+ * \brief   Keeps a RAM shadow of the object, of at most
+ *          TKEY_OBJSTORE_SHADOW_SIZE bytes, so that views of it are served
+ *          while the flash is busy. Pins are dropped on mount.
+ */
+TKey_ObjStoreStatus_t TKey_ObjStore_Pin(TKey_ObjStore_t *psStore,
+                                        TKey_UINT16 usId);
+
+/**
+ * \brief   Deletes the object
+ */
+TKey_ObjStoreStatus_t TKey_ObjStore_Delete(TKey_ObjStore_t *psStore,
+                                           TKey_UINT16 usId);
+
+/**
+ * \brief   Runs one step of background compaction when fewer than
+ *          TKEY_OBJSTORE_BG_FREE_PAGES pages are free or the wear spread
+ *          is too large. Call from a low priority context while idle;
+ *          returns TKey_TRUE when a page was compacted.
+ */
+TKey_BOOL TKey_ObjStore_Compact(TKey_ObjStore_t *psStore);
+
+/**
+ * \brief   CRC32 (IEEE 802.3) as used for records, for users that protect
+ *          their own data. Pass 0 as uiCrc to start, the previous result to
+ *          continue.
+ */
+TKey_UINT32 TKey_ObjStore_Crc32(TKey_UINT32 uiCrc, const TKey_BYTE *pucData,
+                                TKey_UINT32 uiLen);
+
+/**
+ * \brief   Returns the store statistics
+ */
+TKey_VOID TKey_ObjStore_GetStats(TKey_ObjStore_t *psStore,
+                                 TKey_ObjStoreStats_t *psStats);
+
+#endif /* THINKEY_OBJSTORE_H */
@@ -0,0 +1,106 @@
+/*
+ * \file thinkey_objstore_async.h
+ *
+ * \brief Write-behind queue of the object store
+ *
+ * Writes and deletes are copied into a bounded set of pending slots and
+ * programmed by a storage worker task, so the caller does not wait for
+ * the flash. A write to an object whose previous write is still queued
+ * replaces it in its slot. Reads look at the pending slots first, so a
+ * read after a write returns the written value before it reaches the
+ * flash. When idle, the worker runs background compaction.
+ *
+ * Until the worker is started every call runs synchronously in the
+ * calling task. Once it runs, the worker is the only task touching the
+ * store: other tasks must go through this interface or use views.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_OBJSTORE_ASYNC_H
+#define THINKEY_OBJSTORE_ASYNC_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_objstore.h"
+
+/**
+ *  @brief Write-behind configuration
+ */
+#ifndef TKEY_OBJSTORE_ASYNC_SLOTS
+#define TKEY_OBJSTORE_ASYNC_SLOTS 4
+#endif
+#ifndef TKEY_OBJSTORE_ASYNC_TASK_PRIORITY
+#define TKEY_OBJSTORE_ASYNC_TASK_PRIORITY 1
+#endif
+#ifndef TKEY_OBJSTORE_ASYNC_TASK_STACK_SIZE
+#define TKEY_OBJSTORE_ASYNC_TASK_STACK_SIZE 512
+#endif
+/* Idle time after which the worker runs a compaction step */
+#ifndef TKEY_OBJSTORE_ASYNC_IDLE_MS
+#define TKEY_OBJSTORE_ASYNC_IDLE_MS 100
+#endif
+
+/**
+ * \brief   Completion callback, called from the worker task. A write that
+ *          a later write to the same object replaced while still queued
+ *          completes with E_TKEY_OBJSTORE_SUPERSEDED, from the task that
+ *          made the later write.
+ */
+typedef TKey_VOID (*TKey_ObjStoreDone_t)(TKey_UINT16 usId,
+        TKey_ObjStoreStatus_t eStatus, TKey_VOID *pvCtx);
+
+/**
+ *  @brief Write-behind statistics
+ */
+typedef struct
+{
+    TKey_UINT32 uiQueued;
+    TKey_UINT32 uiCoalesced;
+    TKey_UINT32 uiCompleted;
+    TKey_UINT32 uiFailed;
+    TKey_UINT32 uiQueueFull;
+    TKey_UINT32 uiMaxPending;
+} TKey_ObjStoreAsyncStats_t;
+
+/**
+ * \brief   Binds the write-behind queue to a mounted store
+ */
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Init(TKey_ObjStore_t *psStore);
+
+/**
+ * \brief   Starts the storage worker task
+ */
+TKey_StatusType TKey_ObjStoreAsync_StartWorker(TKey_VOID);
+
+/**
+ * \brief   Queues a write of the object. Returns E_TKEY_OBJSTORE_QUEUE_FULL
+ *          when all slots hold writes of other objects.
+ */
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Write(TKey_UINT16 usId,
+        const TKey_BYTE *pucData, TKey_UINT32 uiLen,
+        TKey_ObjStoreDone_t pfnDone, TKey_VOID *pvCtx);
+
+/**
+ * \brief   Queues a deletion of the object
+ */
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Delete(TKey_UINT16 usId,
+        TKey_ObjStoreDone_t pfnDone, TKey_VOID *pvCtx);
+
+/**
+ * \brief   Reads the newest value of the object, queued or stored. Same
+ *          arguments as TKey_ObjStore_Read().
+ */
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Read(TKey_UINT16 usId,
+        TKey_BYTE *pucBuf, TKey_UINT32 uiSize, TKey_UINT32 *puiLen);
+
+/**
+ * \brief   Waits up to uiTimeoutMs for all queued requests to complete
+ */
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Flush(TKey_UINT32 uiTimeoutMs);
+
+/**
+ * \brief   Returns the write-behind statistics
+ */
+TKey_VOID TKey_ObjStoreAsync_GetStats(TKey_ObjStoreAsyncStats_t *psStats);
+
+#endif /* THINKEY_OBJSTORE_ASYNC_H */
@@ -1,240 +1,135 @@
+/*
+ * \file thinkey_dkstore.c
+ *
+ * \brief Digital key store on the object store
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_STORAGE
 
 #include "thinkey_dkstore.h"
+#include "thinkey_objstore.h"
+#include "thinkey_objstore_async.h"
+#include "thinkey_keystore.h"
 #include "thinkey_platform_types.h"
 #include "thinkey_debug.h"
-//#include "nrf_fstorage.h"
-//#include "nrf_fstorage_sd.h"
-#include "FreeRTOS.h"
-#include "task.h"
-
-/* Start and end of section defined in linker script for dkstore */
-extern void* __dkstore_start__;
-extern void* __dkstore_end__;
-#define TKEY_STORAGE_START_ADDR &__dkstore_start__
-#define TKEY_STORAGE_END_ADDR &__dkstore_end__
-
-#define TKEY_PUB_KEY_STORAGE_SIZE 68
 
-#define TKEY_STORAGE_PUB_KEY_INIT_BYTE_ADDR TKEY_STORAGE_START_ADDR
-#define TKEY_STORAGE_PRIV_KEY_START_ADDR (TKEY_STORAGE_START_ADDR + TKEY_PUB_KEY_STORAGE_SIZE)
+static TKey_ObjStore_t gsDkObjStore;
 
-#define PRINT_FALSH_DATA 0
-
-TKey_BYTE aucData[TKEY_PUB_KEY_STORAGE_SIZE] = {0};
+static TKey_UINT16 tkey_dkstore_obj_id(TKey_DKObject_t eObjType)
+{
+    return (E_TKEY_STORE_PUBLIC_KEY == eObjType) ? TKEY_OBJ_ID_DK_PUBLIC_KEY :
+           TKEY_OBJ_ID_DK_PRIVATE_KEY;
+}
 
-volatile bool bWriteComplete = false;
+TKey_StatusType TKey_DkStore_InitOnDevice(const TKey_FlashDev_t *psDev)
+{
+    TKey_ObjStoreStatus_t eStatus;
 
-/* This is to make the call synchronous */
-void checkWriteComplete() {
-    while(bWriteComplete != true) {
-        nrf_sdh_evts_poll();
-        vTaskDelay(100/portTICK_PERIOD_MS);
+    eStatus = TKey_ObjStore_Mount(&gsDkObjStore, psDev);
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+        THINKEY_DEBUG_ERROR("Storage Init Failed! %d", eStatus);
+        return E_TKEY_FAILURE;
     }
-    bWriteComplete = false;
+    /* The owner public key is checked on every transaction */
+    TKey_ObjStore_Pin(&gsDkObjStore, TKEY_OBJ_ID_DK_PUBLIC_KEY);
+    TKey_ObjStoreAsync_Init(&gsDkObjStore);
+    /* The vehicle's other keys live in the same store */
+    if(E_TKEY_KEYSTORE_SUCCESS != TKey_KeyStore_Init()) {
+        THINKEY_DEBUG_ERROR("Key store Init Failed!");
+        return E_TKEY_FAILURE;
+    }
+    THINKEY_DEBUG_INFO("Storage INIT SUCCESS!");
+    return E_TKEY_SUCCESS;
 }
 
-/* Just to switch context and wait for the event*/
-static void power_manage(void)
+TKey_StatusType TKey_DkStore_Init(TKey_VOID)
 {
-    (void) sd_app_evt_wait();
-}
-
-void wait_for_flash_ready(/*nrf_fstorage_t const * p_fstorage*/) {
-    /* While fstorage is busy, sleep and wait for an event. */
-//    while (nrf_fstorage_is_busy(p_fstorage))
-//    {
-//        power_manage();
-//    }
-}
+    const TKey_FlashDev_t *psDev = TKey_FlashRa_GetDataFlash();
 
-static void vStorageStatusCbcallback(/*nrf_fstorage_evt_t * p_evt*/);
-
-/*Define the storage Instance */
-//NRF_FSTORAGE_DEF(/*nrf_fstorage_t sKeyStoreInstance*/) =
-//{
-// .evt_handler = vStorageStatusCbcallback,
-// .start_addr = TKEY_STORAGE_START_ADDR,
-// .end_addr = TKEY_STORAGE_END_ADDR,
-//};
-
-#define NULL_CHECK(a) if(NULL==a){break;}
-
-TKey_StatusType TKey_DkStore_Init() {
-    TKey_StatusType eStatus = E_TKEY_FAILURE;
-//    ret_code_t retStatus = NRF_ERROR_INVALID_STATE;
-//
-//    do {
-//        retStatus = nrf_fstorage_init(&sKeyStoreInstance, &nrf_fstorage_sd, NULL);
-//        if(retStatus != NRF_SUCCESS) {
-//            THINKEY_DEBUG_ERROR("Storage Init Failed! %d", retStatus);
-//            break;
-//        }
-//        THINKEY_DEBUG_INFO("Storage INIT SUCCESS!");
-//        eStatus = E_TKEY_SUCCESS;
-//    } while(TKey_EXIT);
-//
-//    return eStatus;
+    if(TKey_NULL == psDev) {
+        THINKEY_DEBUG_ERROR("Storage Init Failed! No flash device");
+        return E_TKEY_FAILURE;
+    }
+    if(E_TKEY_SUCCESS != TKey_DkStore_InitOnDevice(psDev)) {
+        return E_TKEY_FAILURE;
+    }
+    return TKey_ObjStoreAsync_StartWorker();
 }
 
-/* Write data from pucData buffer to flash 
+/* Write data from pucData buffer to flash
    *size can be :
    65 bytes for publicKey
    32 bytes for privateKey
  */
 TKey_StatusType TKey_DkStore_Write(TKey_DKObject_t eObjType, TKey_BYTE*
         pucData, TKey_UINT32 size) {
-    TKey_StatusType eStatus = E_TKEY_FAILURE;
-//    ret_code_t retStatus = NRF_ERROR_INVALID_STATE;
-//
-//    /* Bits in flash can only be changed from 1's to 0's. So erase first and then write */
-//    TKey_DkStore_Erase();
-//
-//    switch(eObjType)
-//    {
-//    case E_TKEY_STORE_PUBLIC_KEY:
-//        {
-//            memcpy(aucData, pucData, size);
-//#if PRINT_FALSH_DATA
-//            THINKEY_DEBUG_INFO("Waiting for flash ready");
-//            for(int i=0; i < size - 4; i++) {
-//                THINKEY_DEBUG_INFO("%.2x", aucData[i]);
-//            }
-//#endif
-//            wait_for_flash_ready(&sKeyStoreInstance);
-//            /* The flash is program unit sensitive.
-//            * We can store only in the multiple of 4. As Pub key is 65 bytes,
-//            we whould write the next 4 byte allingned size */
-//            retStatus = nrf_fstorage_write(&sKeyStoreInstance,
-//                    TKEY_STORAGE_PUB_KEY_INIT_BYTE_ADDR,
-//                    aucData, TKEY_PUB_KEY_STORAGE_SIZE, NULL);
-//            if(retStatus != NRF_SUCCESS) {
-//                THINKEY_DEBUG_ERROR("Storage Write Failed! %d", retStatus);
-//                break;
-//            }
-//            THINKEY_DEBUG_INFO("Waiting for flash write done");
-//            /* Currently we have configured polling method to get events.
-//             * The BLE task does polling but the callback of write complete
-//             * was not getting called. Hence doing manual polling here */
-//            checkWriteComplete();
-//            THINKEY_DEBUG_INFO("Flash write done");
-//            eStatus = E_TKEY_SUCCESS;
-//        }
-//        break;
-//    case E_TKEY_STORE_PRIVATE_KEY:
-//        {
-//
-//        }
-//        break;
-//    default:
-//        break;
-//    }
-    return eStatus;
+    return TKey_DkStore_WriteAsync(eObjType, pucData, size, TKey_NULL,
+                                   TKey_NULL);
+}
+
+TKey_StatusType TKey_DkStore_WriteAsync(TKey_DKObject_t eObjType,
+        TKey_BYTE* pucData, TKey_UINT32 size, TKey_ObjStoreDone_t pfnDone,
+        TKey_VOID *pvCtx) {
+    TKey_ObjStoreStatus_t eStatus;
+
+    eStatus = TKey_ObjStoreAsync_Write(tkey_dkstore_obj_id(eObjType),
+                                       pucData, size, pfnDone, pvCtx);
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+        THINKEY_DEBUG_ERROR("Storage Write Failed! %d", eStatus);
+        return E_TKEY_FAILURE;
+    }
+    return E_TKEY_SUCCESS;
 }
 
 /* Read data from flash to pucData buffer
-   *size can be :  
+   *size can be :
    65 bytes for publicKey
    32 bytes for privateKey
  */
 TKey_StatusType TKey_DkStore_Read(TKey_DKObject_t eObjType, TKey_BYTE*
         pucData, TKey_UINT32 size) {
-    TKey_StatusType eStatus = E_TKEY_FAILURE;
-//    ret_code_t retStatus = NRF_ERROR_INVALID_STATE;
-//
-//    switch (eObjType)
-//    {
-//    case E_TKEY_STORE_PUBLIC_KEY:
-//        {
-//            /* The flash is program byte alignment sensitive.
-//            * We can store only in the multiple of 4. As Pub key is 65 bytes,
-//            * ignoring the first byte which is 04 and storing the x and y
-//            * component */
-//            THINKEY_DEBUG_INFO("Waiting for flash ready");
-//            wait_for_flash_ready(&sKeyStoreInstance);
-//            retStatus = nrf_fstorage_read(&sKeyStoreInstance,
-//                    TKEY_STORAGE_PUB_KEY_INIT_BYTE_ADDR, aucData,
-//                    TKEY_PUB_KEY_STORAGE_SIZE);
-//            if(retStatus != NRF_SUCCESS) {
-//                THINKEY_DEBUG_ERROR("Storage Read Failed! %d", retStatus);
-//                break;
-//            }
-//            memcpy(pucData, aucData, size);
-//            THINKEY_DEBUG_INFO("Storage Read SUCCESS!");
-//            eStatus = E_TKEY_SUCCESS;
-//        }
-//        break;
-//    case E_TKEY_STORE_PRIVATE_KEY:
-//        {
-//
-//        }
-//        break;
-//    default:
-//        break;
-//    }
-    return eStatus;
-} 
-
-TKey_StatusType TKey_DkStore_Erase(){
-    TKey_StatusType eStatus = E_TKEY_FAILURE;
-//    ret_code_t retStatus = NRF_ERROR_INVALID_STATE;
-//
-//    do {
-//        retStatus = nrf_fstorage_erase(&sKeyStoreInstance,
-//                TKEY_STORAGE_START_ADDR, 1, NULL);
-//        if(retStatus != NRF_SUCCESS) {
-//            THINKEY_DEBUG_ERROR("Storage Erase Failed! %d ", retStatus);
-//            break;
-//        }
-//        checkWriteComplete();
-//        THINKEY_DEBUG_INFO("Storage Erase SUCCESS!");
-//        eStatus = E_TKEY_SUCCESS;
-//    } while(TKey_EXIT);
-//    eStatus = E_TKEY_SUCCESS;
-    return eStatus;
+    TKey_ObjStoreStatus_t eStatus;
+    TKey_UINT32 uiLen = 0;
+
+    eStatus = TKey_ObjStoreAsync_Read(tkey_dkstore_obj_id(eObjType),
+                                      pucData, size, &uiLen);
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus || uiLen != size) {
+        THINKEY_DEBUG_ERROR("Storage Read Failed! %d", eStatus);
+        return E_TKEY_FAILURE;
+    }
+    return E_TKEY_SUCCESS;
 }
 
+TKey_StatusType TKey_DkStore_View(TKey_DKObject_t eObjType, TKey_ObjView_t *psView)
+{
+    TKey_ObjStoreStatus_t eStatus;
 
-static void vStorageStatusCbcallback(/*nrf_fstorage_evt_t * p_evt*/) {
-//    THINKEY_DEBUG_INFO("##########Event Received! ID: %d, Result %d", p_evt->id, p_evt->result);
-//    bWriteComplete = true;
+    eStatus = TKey_ObjStore_View(&gsDkObjStore, tkey_dkstore_obj_id(eObjType),
+                                 psView);
+    return (E_TKEY_OBJSTORE_SUCCESS == eStatus) ? E_TKEY_SUCCESS :
+           E_TKEY_FAILURE;
 }
 
+TKey_BOOL TKey_DkStore_ViewValid(const TKey_ObjView_t *psView)
+{
+    return TKey_ObjStore_ViewValid(&gsDkObjStore, psView);
+}
 
+TKey_StatusType TKey_DkStore_Erase(TKey_VOID) {
+    TKey_ObjStoreStatus_t eStatus;
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+    eStatus = TKey_ObjStoreAsync_Delete(TKEY_OBJ_ID_DK_PUBLIC_KEY, TKey_NULL,
+                                        TKey_NULL);
+    if(E_TKEY_OBJSTORE_SUCCESS == eStatus) {
+        eStatus = TKey_ObjStoreAsync_Delete(TKEY_OBJ_ID_DK_PRIVATE_KEY,
+                                            TKey_NULL, TKey_NULL);
+    }
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+        THINKEY_DEBUG_ERROR("Storage Erase Failed! %d", eStatus);
+        return E_TKEY_FAILURE;
+    }
+    return E_TKEY_SUCCESS;
+}
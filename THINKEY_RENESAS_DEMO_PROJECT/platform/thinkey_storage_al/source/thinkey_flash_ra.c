@@ -0,0 +1,126 @@
+/*
+ * \file thinkey_flash_ra.c
+ *
+ * \brief RA6M5 data flash backend of the flash abstraction
+ *
+ * Uses the g_flash0 "Flash (r_flash_hp)" stack of configuration.xml in
+ * blocking mode: data flash programming enabled, background operation
+ * disabled. The host build has no data flash and runs the stores on the
+ * flash simulator instead.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_STORAGE
+
+#include "thinkey_flash_al.h"
+#include "thinkey_debug.h"
+
+#if !defined(THINKEY_HOST_BUILD)
+
+#include "hal_data.h"
+#include <string.h>
+
+#ifndef TKEY_FLASH_RA_DF_SIZE
+#define TKEY_FLASH_RA_DF_SIZE 0x2000    /* DATA_FLASH_LENGTH */
+#endif
+
+#define TKEY_FLASH_RA_DF_BASE BSP_FEATURE_FLASH_DATA_FLASH_START
+
+static TKey_BOOL gbFlashRaOpen = TKey_FALSE;
+
+static TKey_StatusType tkey_flash_ra_read(TKey_VOID *pvCtx, TKey_UINT32 uiOffset,
+                                          TKey_BYTE *pucBuf, TKey_UINT32 uiLen)
+{
+    (TKey_VOID)pvCtx;
+    /* The data flash is memory mapped for reads */
+    memcpy(pucBuf, (const TKey_BYTE *)(TKEY_FLASH_RA_DF_BASE + uiOffset), uiLen);
+    return E_TKEY_SUCCESS;
+}
+
+static TKey_StatusType tkey_flash_ra_program(TKey_VOID *pvCtx,
+        TKey_UINT32 uiOffset, const TKey_BYTE *pucBuf, TKey_UINT32 uiLen)
+{
+    fsp_err_t eErr;
+
+    (TKey_VOID)pvCtx;
+    eErr = R_FLASH_HP_Write(&g_flash0_ctrl, (uint32_t)pucBuf,
+                            TKEY_FLASH_RA_DF_BASE + uiOffset, uiLen);
+    if(FSP_SUCCESS != eErr) {
+        THINKEY_DEBUG_ERROR("Flash write failed at 0x%x (%d)", uiOffset, eErr);
+        return E_TKEY_FAILURE;
+    }
+    return E_TKEY_SUCCESS;
+}
+
+static TKey_StatusType tkey_flash_ra_erase(TKey_VOID *pvCtx,
+        TKey_UINT32 uiOffset, TKey_UINT32 uiLen)
+{
+    fsp_err_t eErr;
+
+    (TKey_VOID)pvCtx;
+    eErr = R_FLASH_HP_Erase(&g_flash0_ctrl, TKEY_FLASH_RA_DF_BASE + uiOffset,
+                            uiLen / BSP_FEATURE_FLASH_HP_DF_BLOCK_SIZE);
+    if(FSP_SUCCESS != eErr) {
+        THINKEY_DEBUG_ERROR("Flash erase failed at 0x%x (%d)", uiOffset, eErr);
+        return E_TKEY_FAILURE;
+    }
+    return E_TKEY_SUCCESS;
+}
+
+static TKey_StatusType tkey_flash_ra_blank_check(TKey_VOID *pvCtx,
+        TKey_UINT32 uiOffset, TKey_UINT32 uiLen, TKey_BOOL *pbBlank)
+{
+    flash_result_t eResult = FLASH_RESULT_NOT_BLANK;
+    fsp_err_t eErr;
+
+    (TKey_VOID)pvCtx;
+    eErr = R_FLASH_HP_BlankCheck(&g_flash0_ctrl,
+                                 TKEY_FLASH_RA_DF_BASE + uiOffset, uiLen,
+                                 &eResult);
+    if(FSP_SUCCESS != eErr) {
+        return E_TKEY_FAILURE;
+    }
+    *pbBlank = (FLASH_RESULT_BLANK == eResult);
+    return E_TKEY_SUCCESS;
+}
+
+static const TKey_FlashDev_t gsFlashRaDataFlash =
+{
+    "ra-dataflash",
+    TKEY_FLASH_RA_DF_SIZE,
+    BSP_FEATURE_FLASH_HP_DF_BLOCK_SIZE,
+    BSP_FEATURE_FLASH_HP_DF_WRITE_SIZE,
+    TKey_NULL,
+    (const TKey_BYTE *)TKEY_FLASH_RA_DF_BASE,
+    tkey_flash_ra_read,
+    tkey_flash_ra_program,
+    tkey_flash_ra_erase,
+    tkey_flash_ra_blank_check
+};
+
+const TKey_FlashDev_t* TKey_FlashRa_GetDataFlash(TKey_VOID)
+{
+    fsp_err_t eErr;
+
+    if(!gbFlashRaOpen) {
+        eErr = R_FLASH_HP_Open(&g_flash0_ctrl, &g_flash0_cfg);
+        if(FSP_SUCCESS != eErr) {
+            THINKEY_DEBUG_ERROR("Flash open failed (%d)", eErr);
+            return TKey_NULL;
+        }
+        gbFlashRaOpen = TKey_TRUE;
+    }
+    return &gsFlashRaDataFlash;
+}
+
+#else
+
+const TKey_FlashDev_t* TKey_FlashRa_GetDataFlash(TKey_VOID)
+{
+    THINKEY_DEBUG_WARNING("No data flash on the host");
+    return TKey_NULL;
+}
+
+#endif /* THINKEY_HOST_BUILD */
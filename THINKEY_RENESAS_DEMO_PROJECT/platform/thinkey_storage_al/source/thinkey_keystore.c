@@ -0,0 +1,435 @@
+/*
+ * \file thinkey_keystore.c
+ *
+ * \brief Multi-key store
+ *
+ * Record slot N is object TKEY_OBJ_ID_KEY_FIRST + N; a free slot has
+ * ucVersion 0 in RAM. ausById holds the used slots sorted by key ID.
+ * ausByKey is a linear probing hash table of slot + 1 (0 when empty)
+ * keyed by the FNV-1a hash of the public key; it is rebuilt when a key is
+ * deleted, which is rare, instead of keeping tombstones.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_STORAGE
+
+#include "thinkey_keystore.h"
+#include "thinkey_objstore_async.h"
+#include "thinkey_osal.h"
+#include "thinkey_debug.h"
+#include <string.h>
+
+#define TKEY_KEYSTORE_VERSION 1
+#define TKEY_KEYSTORE_NO_SLOT 0xFFFF
+
+typedef struct
+{
+    TKey_BOOL bLoaded;
+    TKey_UINT32 uiCount;
+    TKey_UINT16 ausById[TKEY_KEYSTORE_MAX_KEYS];
+    TKey_UINT16 ausByKey[TKEY_KEYSTORE_HASH_SLOTS];
+    TKey_UINT32 auiKeyHash[TKEY_KEYSTORE_MAX_KEYS];
+    TKey_KeyRecord_t asRecord[TKEY_KEYSTORE_MAX_KEYS];
+} TKey_KeyStore_t;
+
+static TKey_KeyStore_t gsKeyStore;
+
+static TKey_UINT32 tkey_keystore_hash(const TKey_BYTE *pucKey)
+{
+    TKey_UINT32 uiHash = 0x811C9DC5;
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < TKEY_KEYSTORE_PUBLIC_KEY_SIZE; uiIndex++) {
+        uiHash = (uiHash ^ pucKey[uiIndex]) * 0x01000193;
+    }
+    return uiHash;
+}
+
+/* Position of the first ausById entry with a key ID not below uiKeyId */
+static TKey_UINT32 tkey_keystore_lower_bound(TKey_UINT32 uiKeyId)
+{
+    TKey_UINT32 uiLow = 0;
+    TKey_UINT32 uiHigh = gsKeyStore.uiCount;
+    TKey_UINT32 uiMid;
+
+    while(uiLow < uiHigh) {
+        uiMid = uiLow + (uiHigh - uiLow) / 2;
+        if(gsKeyStore.asRecord[gsKeyStore.ausById[uiMid]].uiKeyId < uiKeyId) {
+            uiLow = uiMid + 1;
+        } else {
+            uiHigh = uiMid;
+        }
+    }
+    return uiLow;
+}
+
+static TKey_UINT16 tkey_keystore_find_id(TKey_UINT32 uiKeyId)
+{
+    TKey_UINT32 uiPos = tkey_keystore_lower_bound(uiKeyId);
+
+    if(uiPos < gsKeyStore.uiCount &&
+       gsKeyStore.asRecord[gsKeyStore.ausById[uiPos]].uiKeyId == uiKeyId) {
+        return gsKeyStore.ausById[uiPos];
+    }
+    return TKEY_KEYSTORE_NO_SLOT;
+}
+
+static TKey_UINT16 tkey_keystore_find_key(const TKey_BYTE *pucKey,
+                                          TKey_UINT32 uiHash)
+{
+    TKey_UINT32 uiBucket = uiHash & (TKEY_KEYSTORE_HASH_SLOTS - 1);
+    TKey_UINT16 usSlot;
+
+    while(0 != gsKeyStore.ausByKey[uiBucket]) {
+        usSlot = gsKeyStore.ausByKey[uiBucket] - 1;
+        if(gsKeyStore.auiKeyHash[usSlot] == uiHash &&
+           0 == memcmp(gsKeyStore.asRecord[usSlot].aucPublicKey, pucKey,
+                       TKEY_KEYSTORE_PUBLIC_KEY_SIZE)) {
+            return usSlot;
+        }
+        uiBucket = (uiBucket + 1) & (TKEY_KEYSTORE_HASH_SLOTS - 1);
+    }
+    return TKEY_KEYSTORE_NO_SLOT;
+}
+
+static TKey_VOID tkey_keystore_hash_insert(TKey_UINT16 usSlot)
+{
+    TKey_UINT32 uiBucket = gsKeyStore.auiKeyHash[usSlot] &
+                           (TKEY_KEYSTORE_HASH_SLOTS - 1);
+
+    while(0 != gsKeyStore.ausByKey[uiBucket]) {
+        uiBucket = (uiBucket + 1) & (TKEY_KEYSTORE_HASH_SLOTS - 1);
+    }
+    gsKeyStore.ausByKey[uiBucket] = usSlot + 1;
+}
+
+/* Enters a loaded or new record in both indexes; the caller checked it */
+static TKey_VOID tkey_keystore_index(TKey_UINT16 usSlot)
+{
+    TKey_UINT32 uiPos;
+
+    uiPos = tkey_keystore_lower_bound(gsKeyStore.asRecord[usSlot].uiKeyId);
+    memmove(&gsKeyStore.ausById[uiPos + 1], &gsKeyStore.ausById[uiPos],
+            (gsKeyStore.uiCount - uiPos) * sizeof(gsKeyStore.ausById[0]));
+    gsKeyStore.ausById[uiPos] = usSlot;
+    gsKeyStore.uiCount++;
+    gsKeyStore.auiKeyHash[usSlot] =
+        tkey_keystore_hash(gsKeyStore.asRecord[usSlot].aucPublicKey);
+    tkey_keystore_hash_insert(usSlot);
+}
+
+static TKey_VOID tkey_keystore_unindex(TKey_UINT16 usSlot)
+{
+    TKey_UINT32 uiPos;
+    TKey_UINT32 uiIndex;
+
+    uiPos = tkey_keystore_lower_bound(gsKeyStore.asRecord[usSlot].uiKeyId);
+    gsKeyStore.uiCount--;
+    memmove(&gsKeyStore.ausById[uiPos], &gsKeyStore.ausById[uiPos + 1],
+            (gsKeyStore.uiCount - uiPos) * sizeof(gsKeyStore.ausById[0]));
+    gsKeyStore.asRecord[usSlot].ucVersion = 0;
+    memset(gsKeyStore.ausByKey, 0, sizeof(gsKeyStore.ausByKey));
+    for(uiIndex = 0; uiIndex < gsKeyStore.uiCount; uiIndex++) {
+        tkey_keystore_hash_insert(gsKeyStore.ausById[uiIndex]);
+    }
+}
+
+/* Queues the record of the slot, or its deletion, waiting for room */
+static TKey_KeyStoreStatus_t tkey_keystore_persist(TKey_UINT16 usSlot,
+        const TKey_KeyRecord_t *psRecord)
+{
+    TKey_UINT16 usId = TKEY_OBJ_ID_KEY_FIRST + usSlot;
+    TKey_ObjStoreStatus_t eStatus;
+
+    do {
+        if(TKey_NULL != psRecord) {
+            eStatus = TKey_ObjStoreAsync_Write(usId, (const TKey_BYTE *)psRecord,
+                                               sizeof(*psRecord), TKey_NULL,
+                                               TKey_NULL);
+        } else {
+            eStatus = TKey_ObjStoreAsync_Delete(usId, TKey_NULL, TKey_NULL);
+        }
+        if(E_TKEY_OBJSTORE_QUEUE_FULL != eStatus) {
+            break;
+        }
+        eStatus = TKey_ObjStoreAsync_Flush(TKEY_KEYSTORE_QUEUE_WAIT_MS);
+    } while(E_TKEY_OBJSTORE_SUCCESS == eStatus);
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+        THINKEY_DEBUG_ERROR("Key store persist failed! %d", eStatus);
+        return E_TKEY_KEYSTORE_FAILURE;
+    }
+    return E_TKEY_KEYSTORE_SUCCESS;
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_Init(TKey_VOID)
+{
+    TKey_KeyRecord_t *psRecord;
+    TKey_ObjStoreStatus_t eStatus;
+    TKey_UINT32 uiLen;
+    TKey_UINT16 usSlot;
+
+    memset(&gsKeyStore, 0, sizeof(gsKeyStore));
+    for(usSlot = 0; usSlot < TKEY_KEYSTORE_MAX_KEYS; usSlot++) {
+        psRecord = &gsKeyStore.asRecord[usSlot];
+        uiLen = 0;
+        eStatus = TKey_ObjStoreAsync_Read(TKEY_OBJ_ID_KEY_FIRST + usSlot,
+                                          (TKey_BYTE *)psRecord,
+                                          sizeof(*psRecord), &uiLen);
+        if(E_TKEY_OBJSTORE_NOT_FOUND == eStatus) {
+            continue;
+        }
+        if(E_TKEY_OBJSTORE_SUCCESS != eStatus || sizeof(*psRecord) != uiLen ||
+           TKEY_KEYSTORE_VERSION != psRecord->ucVersion ||
+           usSlot != psRecord->ucSlot ||
+           TKEY_KEYSTORE_NO_SLOT != tkey_keystore_find_id(psRecord->uiKeyId) ||
+           TKEY_KEYSTORE_NO_SLOT != tkey_keystore_find_key(
+               psRecord->aucPublicKey,
+               tkey_keystore_hash(psRecord->aucPublicKey))) {
+            THINKEY_DEBUG_ERROR("Key store slot %d invalid! %d", usSlot,
+                                eStatus);
+            memset(psRecord, 0, sizeof(*psRecord));
+            continue;
+        }
+        tkey_keystore_index(usSlot);
+    }
+    gsKeyStore.bLoaded = TKey_TRUE;
+    THINKEY_DEBUG_INFO("Key store loaded %d keys", gsKeyStore.uiCount);
+    return E_TKEY_KEYSTORE_SUCCESS;
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_Add(TKey_KeyRecord_t *psRecord)
+{
+    TKey_KeyStoreStatus_t eStatus = E_TKEY_KEYSTORE_SUCCESS;
+    TKey_UINT16 usSlot;
+
+    if(!gsKeyStore.bLoaded || TKey_NULL == psRecord ||
+       psRecord->ucRole > E_TKEY_KEY_ROLE_SHARED ||
+       psRecord->ucState > E_TKEY_KEY_STATE_REVOKED ||
+       psRecord->uiNotBefore > psRecord->uiNotAfter) {
+        return E_TKEY_KEYSTORE_INVALID_ARG;
+    }
+    THINKey_OSAL_vEnterCritical();
+    do {
+        if(TKEY_KEYSTORE_NO_SLOT != tkey_keystore_find_id(psRecord->uiKeyId) ||
+           TKEY_KEYSTORE_NO_SLOT != tkey_keystore_find_key(
+               psRecord->aucPublicKey,
+               tkey_keystore_hash(psRecord->aucPublicKey))) {
+            eStatus = E_TKEY_KEYSTORE_EXISTS;
+            break;
+        }
+        for(usSlot = 0; usSlot < TKEY_KEYSTORE_MAX_KEYS; usSlot++) {
+            if(0 == gsKeyStore.asRecord[usSlot].ucVersion) {
+                break;
+            }
+        }
+        if(TKEY_KEYSTORE_MAX_KEYS == usSlot) {
+            eStatus = E_TKEY_KEYSTORE_FULL;
+            break;
+        }
+        psRecord->ucVersion = TKEY_KEYSTORE_VERSION;
+        psRecord->ucSlot = (TKey_BYTE)usSlot;
+        gsKeyStore.asRecord[usSlot] = *psRecord;
+        tkey_keystore_index(usSlot);
+    } while(TKey_EXIT);
+    THINKey_OSAL_vExitCritical();
+    if(E_TKEY_KEYSTORE_SUCCESS != eStatus) {
+        return eStatus;
+    }
+    eStatus = tkey_keystore_persist(usSlot, psRecord);
+    if(E_TKEY_KEYSTORE_SUCCESS != eStatus) {
+        THINKey_OSAL_vEnterCritical();
+        tkey_keystore_unindex(usSlot);
+        THINKey_OSAL_vExitCritical();
+    }
+    return eStatus;
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_FindById(TKey_UINT32 uiKeyId,
+        TKey_KeyRecord_t *psRecord)
+{
+    TKey_UINT16 usSlot;
+
+    if(TKey_NULL == psRecord) {
+        return E_TKEY_KEYSTORE_INVALID_ARG;
+    }
+    THINKey_OSAL_vEnterCritical();
+    usSlot = tkey_keystore_find_id(uiKeyId);
+    if(TKEY_KEYSTORE_NO_SLOT != usSlot) {
+        *psRecord = gsKeyStore.asRecord[usSlot];
+    }
+    THINKey_OSAL_vExitCritical();
+    return (TKEY_KEYSTORE_NO_SLOT != usSlot) ? E_TKEY_KEYSTORE_SUCCESS :
+           E_TKEY_KEYSTORE_NOT_FOUND;
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_FindByPublicKey(
+        const TKey_BYTE *pucPublicKey, TKey_KeyRecord_t *psRecord)
+{
+    TKey_UINT32 uiHash;
+    TKey_UINT16 usSlot;
+
+    if(TKey_NULL == pucPublicKey || TKey_NULL == psRecord) {
+        return E_TKEY_KEYSTORE_INVALID_ARG;
+    }
+    uiHash = tkey_keystore_hash(pucPublicKey);
+    THINKey_OSAL_vEnterCritical();
+    usSlot = tkey_keystore_find_key(pucPublicKey, uiHash);
+    if(TKEY_KEYSTORE_NO_SLOT != usSlot) {
+        *psRecord = gsKeyStore.asRecord[usSlot];
+    }
+    THINKey_OSAL_vExitCritical();
+    return (TKEY_KEYSTORE_NO_SLOT != usSlot) ? E_TKEY_KEYSTORE_SUCCESS :
+           E_TKEY_KEYSTORE_NOT_FOUND;
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_CheckAccess(TKey_UINT32 uiKeyId,
+        TKey_UINT32 uiNow, TKey_UINT32 uiEntitlements)
+{
+    TKey_KeyStoreStatus_t eStatus = E_TKEY_KEYSTORE_SUCCESS;
+    const TKey_KeyRecord_t *psRecord;
+    TKey_UINT16 usSlot;
+
+    THINKey_OSAL_vEnterCritical();
+    do {
+        usSlot = tkey_keystore_find_id(uiKeyId);
+        if(TKEY_KEYSTORE_NO_SLOT == usSlot) {
+            eStatus = E_TKEY_KEYSTORE_NOT_FOUND;
+            break;
+        }
+        psRecord = &gsKeyStore.asRecord[usSlot];
+        if(E_TKEY_KEY_STATE_REVOKED == psRecord->ucState) {
+            eStatus = E_TKEY_KEYSTORE_REVOKED;
+        } else if(E_TKEY_KEY_STATE_SUSPENDED == psRecord->ucState) {
+            eStatus = E_TKEY_KEYSTORE_SUSPENDED;
+        } else if(uiNow < psRecord->uiNotBefore) {
+            eStatus = E_TKEY_KEYSTORE_NOT_YET_VALID;
+        } else if(uiNow > psRecord->uiNotAfter) {
+            eStatus = E_TKEY_KEYSTORE_EXPIRED;
+        } else if(uiEntitlements != (psRecord->uiEntitlements & uiEntitlements)) {
+            eStatus = E_TKEY_KEYSTORE_NOT_ENTITLED;
+        }
+    } while(TKey_EXIT);
+    THINKey_OSAL_vExitCritical();
+    return eStatus;
+}
+
+TKey_UINT32 TKey_KeyStore_GetCount(TKey_VOID)
+{
+    return gsKeyStore.uiCount;
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_GetByIndex(TKey_UINT32 uiIndex,
+        TKey_KeyRecord_t *psRecord)
+{
+    TKey_KeyStoreStatus_t eStatus = E_TKEY_KEYSTORE_NOT_FOUND;
+
+    if(TKey_NULL == psRecord) {
+        return E_TKEY_KEYSTORE_INVALID_ARG;
+    }
+    THINKey_OSAL_vEnterCritical();
+    if(uiIndex < gsKeyStore.uiCount) {
+        *psRecord = gsKeyStore.asRecord[gsKeyStore.ausById[uiIndex]];
+        eStatus = E_TKEY_KEYSTORE_SUCCESS;
+    }
+    THINKey_OSAL_vExitCritical();
+    return eStatus;
+}
+
+/* Applies a change to the record of a key in RAM and queues it to flash;
+   the change is undone when it cannot be queued */
+static TKey_KeyStoreStatus_t tkey_keystore_modify(TKey_UINT32 uiKeyId,
+        const TKey_KeyRecord_t *psChange, TKey_BYTE ucState)
+{
+    TKey_KeyStoreStatus_t eStatus = E_TKEY_KEYSTORE_SUCCESS;
+    TKey_KeyRecord_t sOld;
+    TKey_KeyRecord_t sNew;
+    TKey_UINT16 usSlot;
+
+    THINKey_OSAL_vEnterCritical();
+    do {
+        usSlot = tkey_keystore_find_id(uiKeyId);
+        if(TKEY_KEYSTORE_NO_SLOT == usSlot) {
+            eStatus = E_TKEY_KEYSTORE_NOT_FOUND;
+            break;
+        }
+        sOld = gsKeyStore.asRecord[usSlot];
+        if(E_TKEY_KEY_STATE_REVOKED == sOld.ucState) {
+            eStatus = E_TKEY_KEYSTORE_REVOKED;
+            break;
+        }
+        sNew = sOld;
+        sNew.ucState = ucState;
+        if(TKey_NULL != psChange) {
+            sNew.uiEntitlements = psChange->uiEntitlements;
+            sNew.uiNotBefore = psChange->uiNotBefore;
+            sNew.uiNotAfter = psChange->uiNotAfter;
+        }
+        gsKeyStore.asRecord[usSlot] = sNew;
+    } while(TKey_EXIT);
+    THINKey_OSAL_vExitCritical();
+    if(E_TKEY_KEYSTORE_SUCCESS != eStatus) {
+        return eStatus;
+    }
+    eStatus = tkey_keystore_persist(usSlot, &sNew);
+    if(E_TKEY_KEYSTORE_SUCCESS != eStatus) {
+        THINKey_OSAL_vEnterCritical();
+        gsKeyStore.asRecord[usSlot] = sOld;
+        THINKey_OSAL_vExitCritical();
+    }
+    return eStatus;
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_Suspend(TKey_UINT32 uiKeyId,
+        TKey_BOOL bSuspend)
+{
+    return tkey_keystore_modify(uiKeyId, TKey_NULL, bSuspend ?
+                                E_TKEY_KEY_STATE_SUSPENDED :
+                                E_TKEY_KEY_STATE_ACTIVE);
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_Revoke(TKey_UINT32 uiKeyId)
+{
+    return tkey_keystore_modify(uiKeyId, TKey_NULL, E_TKEY_KEY_STATE_REVOKED);
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_Update(TKey_UINT32 uiKeyId,
+        TKey_UINT32 uiEntitlements, TKey_UINT32 uiNotBefore,
+        TKey_UINT32 uiNotAfter)
+{
+    TKey_KeyRecord_t sChange;
+    TKey_KeyRecord_t sCurrent;
+
+    if(uiNotBefore > uiNotAfter) {
+        return E_TKEY_KEYSTORE_INVALID_ARG;
+    }
+    if(E_TKEY_KEYSTORE_SUCCESS != TKey_KeyStore_FindById(uiKeyId, &sCurrent)) {
+        return E_TKEY_KEYSTORE_NOT_FOUND;
+    }
+    sChange.uiEntitlements = uiEntitlements;
+    sChange.uiNotBefore = uiNotBefore;
+    sChange.uiNotAfter = uiNotAfter;
+    return tkey_keystore_modify(uiKeyId, &sChange, sCurrent.ucState);
+}
+
+TKey_KeyStoreStatus_t TKey_KeyStore_Delete(TKey_UINT32 uiKeyId)
+{
+    TKey_KeyStoreStatus_t eStatus;
+    TKey_UINT16 usSlot;
+
+    THINKey_OSAL_vEnterCritical();
+    usSlot = tkey_keystore_find_id(uiKeyId);
+    THINKey_OSAL_vExitCritical();
+    if(TKEY_KEYSTORE_NO_SLOT == usSlot) {
+        return E_TKEY_KEYSTORE_NOT_FOUND;
+    }
+    /* Gone from flash first, so that a failure leaves the key as it was */
+    eStatus = tkey_keystore_persist(usSlot, TKey_NULL);
+    if(E_TKEY_KEYSTORE_SUCCESS == eStatus) {
+        THINKey_OSAL_vEnterCritical();
+        tkey_keystore_unindex(usSlot);
+        THINKey_OSAL_vExitCritical();
+    }
+    return eStatus;
+}
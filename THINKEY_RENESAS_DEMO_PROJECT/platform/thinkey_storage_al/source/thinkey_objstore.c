@@ -0,0 +1,897 @@
+/*
+ * \file thinkey_objstore.c
+ *
+ * \brief Log-structured object store on a flash device
+ *
+ * Page layout: a page header (magic, erase count, version, CRC) followed
+ * by records, each a TKey_ObjRecordHdr_t and the object data padded to the
+ * program unit. A record is only trusted when its CRC matches, so a write
+ * torn by power loss is ignored and the previous value of the object
+ * remains current. Pages holding a torn or unreadable record are never
+ * appended to again; compaction reclaims them.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_STORAGE
+
+#include "thinkey_objstore.h"
+#include "thinkey_debug.h"
+#include <string.h>
+
+#define TKEY_OBJSTORE_MAGIC 0x534F4B54      /* "TKOS" */
+#define TKEY_OBJSTORE_VERSION 1
+#define TKEY_OBJSTORE_NO_PAGE 0xFFFFFFFF
+#define TKEY_OBJSTORE_CHUNK_SIZE 32
+#define TKEY_OBJSTORE_WRITE_RETRIES 3
+
+/* Page states */
+#define TKEY_OBJSTORE_PAGE_FREE 0
+#define TKEY_OBJSTORE_PAGE_ACTIVE 1
+#define TKEY_OBJSTORE_PAGE_USED 2
+#define TKEY_OBJSTORE_PAGE_BAD 3
+
+typedef struct
+{
+    TKey_UINT32 uiMagic;
+    TKey_UINT32 uiEraseCount;
+    TKey_UINT32 uiVersion;
+    TKey_UINT32 uiCrc;
+} TKey_ObjPageHdr_t;
+
+TKey_UINT32 TKey_ObjStore_Crc32(TKey_UINT32 uiCrc, const TKey_BYTE *pucData,
+                                TKey_UINT32 uiLen)
+{
+    TKey_UINT32 uiBit;
+
+    uiCrc = ~uiCrc;
+    while(uiLen--) {
+        uiCrc ^= *pucData++;
+        for(uiBit = 0; uiBit < 8; uiBit++) {
+            uiCrc = (uiCrc >> 1) ^ (0xEDB88320 & (0 - (uiCrc & 1)));
+        }
+    }
+    return ~uiCrc;
+}
+
+static TKey_UINT32 tkey_objstore_align(const TKey_ObjStore_t *psStore,
+                                       TKey_UINT32 uiLen)
+{
+    TKey_UINT32 uiUnit = psStore->psDev->uiWriteSize;
+
+    if(uiUnit < 4) {
+        uiUnit = 4;
+    }
+    return ((uiLen + uiUnit - 1) / uiUnit) * uiUnit;
+}
+
+static TKey_UINT32 tkey_objstore_page_hdr_size(const TKey_ObjStore_t *psStore)
+{
+    return tkey_objstore_align(psStore, sizeof(TKey_ObjPageHdr_t));
+}
+
+static TKey_UINT32 tkey_objstore_rec_size(const TKey_ObjStore_t *psStore,
+                                          TKey_UINT32 uiLen)
+{
+    return tkey_objstore_align(psStore, sizeof(TKey_ObjRecordHdr_t) + uiLen);
+}
+
+static TKey_UINT32 tkey_objstore_rec_crc(const TKey_ObjRecordHdr_t *psHdr,
+                                         const TKey_BYTE *pucData)
+{
+    TKey_UINT32 uiCrc;
+
+    uiCrc = TKey_ObjStore_Crc32(0, (const TKey_BYTE *)psHdr,
+                                sizeof(TKey_ObjRecordHdr_t) - sizeof(TKey_UINT32));
+    return TKey_ObjStore_Crc32(uiCrc, pucData, psHdr->usLen);
+}
+
+static TKey_BYTE* tkey_objstore_rec_buf(TKey_ObjStore_t *psStore)
+{
+    return (TKey_BYTE *)psStore->auiRecord;
+}
+
+static TKey_UINT32 tkey_objstore_page_garbage(const TKey_ObjStore_t *psStore,
+                                              TKey_UINT32 uiPage)
+{
+    const TKey_ObjPage_t *psPage = &psStore->asPage[uiPage];
+
+    return psPage->uiUsed - tkey_objstore_page_hdr_size(psStore) -
+           psPage->uiLive;
+}
+
+static TKey_StatusType tkey_objstore_is_blank(TKey_ObjStore_t *psStore,
+        TKey_UINT32 uiOffset, TKey_UINT32 uiLen, TKey_BOOL *pbBlank)
+{
+    const TKey_FlashDev_t *psDev = psStore->psDev;
+    TKey_BYTE aucChunk[TKEY_OBJSTORE_CHUNK_SIZE];
+    TKey_UINT32 uiChunk;
+    TKey_UINT32 uiIndex;
+
+    if(TKey_NULL != psDev->eBlankCheck) {
+        return psDev->eBlankCheck(psDev->pvCtx, uiOffset, uiLen, pbBlank);
+    }
+    *pbBlank = TKey_TRUE;
+    while(0 != uiLen) {
+        uiChunk = (uiLen > sizeof(aucChunk)) ? sizeof(aucChunk) : uiLen;
+        if(E_TKEY_SUCCESS != psDev->eRead(psDev->pvCtx, uiOffset, aucChunk,
+                                          uiChunk)) {
+            return E_TKEY_FAILURE;
+        }
+        for(uiIndex = 0; uiIndex < uiChunk; uiIndex++) {
+            if(0xFF != aucChunk[uiIndex]) {
+                *pbBlank = TKey_FALSE;
+                return E_TKEY_SUCCESS;
+            }
+        }
+        uiOffset += uiChunk;
+        uiLen -= uiChunk;
+    }
+    return E_TKEY_SUCCESS;
+}
+
+/* Program and read back, so a failed or torn program is never trusted */
+static TKey_StatusType tkey_objstore_program(TKey_ObjStore_t *psStore,
+        TKey_UINT32 uiOffset, const TKey_BYTE *pucData, TKey_UINT32 uiLen)
+{
+    const TKey_FlashDev_t *psDev = psStore->psDev;
+    TKey_BYTE aucChunk[TKEY_OBJSTORE_CHUNK_SIZE];
+    TKey_UINT32 uiChunk;
+
+    if(E_TKEY_SUCCESS != psDev->eProgram(psDev->pvCtx, uiOffset, pucData,
+                                         uiLen)) {
+        return E_TKEY_FAILURE;
+    }
+    while(0 != uiLen) {
+        uiChunk = (uiLen > sizeof(aucChunk)) ? sizeof(aucChunk) : uiLen;
+        if(E_TKEY_SUCCESS != psDev->eRead(psDev->pvCtx, uiOffset, aucChunk,
+                                          uiChunk) ||
+           0 != memcmp(aucChunk, pucData, uiChunk)) {
+            return E_TKEY_FAILURE;
+        }
+        uiOffset += uiChunk;
+        pucData += uiChunk;
+        uiLen -= uiChunk;
+    }
+    return E_TKEY_SUCCESS;
+}
+
+static TKey_BOOL tkey_objstore_read_page_hdr(TKey_ObjStore_t *psStore,
+        TKey_UINT32 uiPage, TKey_ObjPageHdr_t *psHdr)
+{
+    const TKey_FlashDev_t *psDev = psStore->psDev;
+    TKey_BOOL bBlank = TKey_TRUE;
+
+    /* Blank check first: an erased RA data flash reads back garbage */
+    if(E_TKEY_SUCCESS != tkey_objstore_is_blank(psStore,
+                            uiPage * TKEY_OBJSTORE_PAGE_SIZE,
+                            sizeof(TKey_ObjPageHdr_t), &bBlank) || bBlank) {
+        return TKey_FALSE;
+    }
+    if(E_TKEY_SUCCESS != psDev->eRead(psDev->pvCtx,
+                            uiPage * TKEY_OBJSTORE_PAGE_SIZE,
+                            (TKey_BYTE *)psHdr, sizeof(TKey_ObjPageHdr_t))) {
+        return TKey_FALSE;
+    }
+    return (TKEY_OBJSTORE_MAGIC == psHdr->uiMagic &&
+            TKEY_OBJSTORE_VERSION == psHdr->uiVersion &&
+            psHdr->uiCrc == TKey_ObjStore_Crc32(0, (const TKey_BYTE *)psHdr,
+                            sizeof(TKey_ObjPageHdr_t) - sizeof(TKey_UINT32)));
+}
+
+static TKey_StatusType tkey_objstore_erase_page(TKey_ObjStore_t *psStore,
+        TKey_UINT32 uiPage, TKey_UINT32 uiEraseCount)
+{
+    const TKey_FlashDev_t *psDev = psStore->psDev;
+    TKey_ObjPage_t *psPage = &psStore->asPage[uiPage];
+    TKey_BYTE *pucHdr = tkey_objstore_rec_buf(psStore);
+    TKey_ObjPageHdr_t sHdr;
+    TKey_UINT32 uiHdrSize = tkey_objstore_page_hdr_size(psStore);
+
+    psStore->sStats.uiErases++;
+    psPage->ucState = TKEY_OBJSTORE_PAGE_BAD;
+    psPage->uiEraseCount = uiEraseCount;
+    psPage->uiLive = 0;
+    psPage->uiUsed = TKEY_OBJSTORE_PAGE_SIZE;
+    if(E_TKEY_SUCCESS != psDev->eErase(psDev->pvCtx,
+                            uiPage * TKEY_OBJSTORE_PAGE_SIZE,
+                            TKEY_OBJSTORE_PAGE_SIZE)) {
+        THINKEY_DEBUG_ERROR("OBJSTORE: erase of page %u failed",
+                            (unsigned)uiPage);
+        return E_TKEY_FAILURE;
+    }
+    sHdr.uiMagic = TKEY_OBJSTORE_MAGIC;
+    sHdr.uiEraseCount = uiEraseCount;
+    sHdr.uiVersion = TKEY_OBJSTORE_VERSION;
+    sHdr.uiCrc = TKey_ObjStore_Crc32(0, (const TKey_BYTE *)&sHdr,
+                            sizeof(sHdr) - sizeof(TKey_UINT32));
+    memset(pucHdr, 0xFF, uiHdrSize);
+    memcpy(pucHdr, &sHdr, sizeof(sHdr));
+    if(E_TKEY_SUCCESS != tkey_objstore_program(psStore,
+                            uiPage * TKEY_OBJSTORE_PAGE_SIZE, pucHdr,
+                            uiHdrSize)) {
+        THINKEY_DEBUG_ERROR("OBJSTORE: header of page %u failed",
+                            (unsigned)uiPage);
+        return E_TKEY_FAILURE;
+    }
+    psPage->ucState = TKEY_OBJSTORE_PAGE_FREE;
+    psPage->uiUsed = uiHdrSize;
+    return E_TKEY_SUCCESS;
+}
+
+/* Erases the page and writes its header; the page becomes free */
+static TKey_StatusType tkey_objstore_format_page(TKey_ObjStore_t *psStore,
+        TKey_UINT32 uiPage, TKey_UINT32 uiEraseCount)
+{
+    TKey_StatusType eStatus;
+
+    psStore->uiFlashEpoch++;
+    eStatus = tkey_objstore_erase_page(psStore, uiPage, uiEraseCount);
+    psStore->uiFlashEpoch++;
+    return eStatus;
+}
+
+static TKey_UINT32 tkey_objstore_free_pages(const TKey_ObjStore_t *psStore)
+{
+    TKey_UINT32 uiPage;
+    TKey_UINT32 uiCount = 0;
+
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        if(TKEY_OBJSTORE_PAGE_FREE == psStore->asPage[uiPage].ucState) {
+            uiCount++;
+        }
+    }
+    return uiCount;
+}
+
+/* Retires the active page and appends to the least worn free page */
+static TKey_StatusType tkey_objstore_activate(TKey_ObjStore_t *psStore)
+{
+    TKey_UINT32 uiPage;
+    TKey_UINT32 uiBest = TKEY_OBJSTORE_NO_PAGE;
+
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        if(TKEY_OBJSTORE_PAGE_FREE == psStore->asPage[uiPage].ucState &&
+           (TKEY_OBJSTORE_NO_PAGE == uiBest ||
+            psStore->asPage[uiPage].uiEraseCount <
+            psStore->asPage[uiBest].uiEraseCount)) {
+            uiBest = uiPage;
+        }
+    }
+    if(TKEY_OBJSTORE_NO_PAGE == uiBest) {
+        return E_TKEY_FAILURE;
+    }
+    if(TKEY_OBJSTORE_NO_PAGE != psStore->uiActive) {
+        psStore->asPage[psStore->uiActive].ucState = TKEY_OBJSTORE_PAGE_USED;
+        psStore->asPage[psStore->uiActive].uiUsed = TKEY_OBJSTORE_PAGE_SIZE;
+    }
+    psStore->asPage[uiBest].ucState = TKEY_OBJSTORE_PAGE_ACTIVE;
+    psStore->uiActive = uiBest;
+    return E_TKEY_SUCCESS;
+}
+
+static TKey_UINT32 tkey_objstore_active_room(const TKey_ObjStore_t *psStore)
+{
+    if(TKEY_OBJSTORE_NO_PAGE == psStore->uiActive) {
+        return 0;
+    }
+    return TKEY_OBJSTORE_PAGE_SIZE - psStore->asPage[psStore->uiActive].uiUsed;
+}
+
+/* Makes the record at uiOffset the current one of its object */
+static TKey_VOID tkey_objstore_index_set(TKey_ObjStore_t *psStore,
+        const TKey_ObjRecordHdr_t *psHdr, TKey_UINT32 uiOffset)
+{
+    TKey_ObjIndex_t *psEntry = &psStore->asIndex[psHdr->usId];
+
+    if(TKEY_OBJSTORE_NO_RECORD != psEntry->uiOffset) {
+        psStore->asPage[psEntry->uiOffset / TKEY_OBJSTORE_PAGE_SIZE].uiLive -=
+                tkey_objstore_rec_size(psStore, psEntry->usLen);
+    }
+    psEntry->uiOffset = uiOffset;
+    psEntry->uiSeq = psHdr->uiSeq;
+    psEntry->usLen = psHdr->usLen;
+    psStore->asPage[uiOffset / TKEY_OBJSTORE_PAGE_SIZE].uiLive +=
+            tkey_objstore_rec_size(psStore, psHdr->usLen);
+}
+
+/* Refreshes the shadow of a pinned object; readers see uiSeq 0 meanwhile */
+static TKey_VOID tkey_objstore_shadow_set(TKey_ObjStore_t *psStore,
+        const TKey_ObjRecordHdr_t *psHdr, const TKey_BYTE *pucData)
+{
+    TKey_ObjShadow_t *psShadow;
+    TKey_UINT32 uiSlot;
+
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_SHADOW_SLOTS; uiSlot++) {
+        psShadow = &psStore->asShadow[uiSlot];
+        if(psHdr->usId != psShadow->usId) {
+            continue;
+        }
+        psShadow->uiSeq = 0;
+        if(psHdr->usLen <= TKEY_OBJSTORE_SHADOW_SIZE) {
+            psShadow->usLen = psHdr->usLen;
+            memcpy(psShadow->auiData, pucData, psHdr->usLen);
+            psShadow->uiSeq = psHdr->uiSeq;
+        }
+    }
+}
+
+static TKey_StatusType tkey_objstore_write_record(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, const TKey_BYTE *pucData, TKey_UINT32 uiLen)
+{
+    TKey_ObjPage_t *psPage = &psStore->asPage[psStore->uiActive];
+    TKey_BYTE *pucRec = tkey_objstore_rec_buf(psStore);
+    TKey_UINT32 uiRecSize = tkey_objstore_rec_size(psStore, uiLen);
+    TKey_UINT32 uiOffset = psStore->uiActive * TKEY_OBJSTORE_PAGE_SIZE +
+                           psPage->uiUsed;
+    TKey_ObjRecordHdr_t sHdr;
+    TKey_BOOL bBlank = TKey_FALSE;
+
+    /* Never program over something a torn write may have left behind */
+    if(E_TKEY_SUCCESS != tkey_objstore_is_blank(psStore, uiOffset, uiRecSize,
+                                                &bBlank) || !bBlank) {
+        psPage->uiUsed = TKEY_OBJSTORE_PAGE_SIZE;
+        return E_TKEY_FAILURE;
+    }
+
+    sHdr.usId = usId;
+    sHdr.usLen = (TKey_UINT16)uiLen;
+    sHdr.uiSeq = psStore->uiNextSeq++;
+    if(0 != uiLen) {
+        memmove(&pucRec[sizeof(sHdr)], pucData, uiLen);
+    }
+    sHdr.uiCrc = tkey_objstore_rec_crc(&sHdr, &pucRec[sizeof(sHdr)]);
+    memcpy(pucRec, &sHdr, sizeof(sHdr));
+    memset(&pucRec[sizeof(sHdr) + uiLen], 0xFF,
+           uiRecSize - sizeof(sHdr) - uiLen);
+
+    if(E_TKEY_SUCCESS != tkey_objstore_program(psStore, uiOffset, pucRec,
+                                               uiRecSize)) {
+        THINKEY_DEBUG_ERROR("OBJSTORE: record program failed at 0x%x",
+                            (unsigned)uiOffset);
+        psStore->sStats.uiCorruptRecords++;
+        psPage->uiUsed = TKEY_OBJSTORE_PAGE_SIZE;
+        return E_TKEY_FAILURE;
+    }
+    psPage->uiUsed += uiRecSize;
+    tkey_objstore_index_set(psStore, &sHdr, uiOffset);
+    tkey_objstore_shadow_set(psStore, &sHdr, &pucRec[sizeof(sHdr)]);
+    return E_TKEY_SUCCESS;
+}
+
+/* Appends one record to the active page, which must have room for it.
+ * pucData may point into the record buffer (compaction). The flash epoch
+ * is odd until the index and shadows point at the new record. */
+static TKey_StatusType tkey_objstore_append(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, const TKey_BYTE *pucData, TKey_UINT32 uiLen)
+{
+    TKey_StatusType eStatus;
+
+    psStore->uiFlashEpoch++;
+    eStatus = tkey_objstore_write_record(psStore, usId, pucData, uiLen);
+    psStore->uiFlashEpoch++;
+    return eStatus;
+}
+
+/* Moves the current records of uiVictim to the active page and erases it */
+static TKey_ObjStoreStatus_t tkey_objstore_relocate(TKey_ObjStore_t *psStore,
+                                                    TKey_UINT32 uiVictim)
+{
+    const TKey_FlashDev_t *psDev = psStore->psDev;
+    TKey_BYTE *pucRec = tkey_objstore_rec_buf(psStore);
+    TKey_ObjIndex_t *psEntry;
+    TKey_UINT32 uiRecSize;
+    TKey_UINT32 uiId;
+    TKey_UINT32 uiTry;
+    TKey_StatusType eStatus;
+
+    for(uiId = 0; uiId < TKEY_OBJSTORE_MAX_OBJECTS; uiId++) {
+        psEntry = &psStore->asIndex[uiId];
+        if(TKEY_OBJSTORE_NO_RECORD == psEntry->uiOffset ||
+           uiVictim != psEntry->uiOffset / TKEY_OBJSTORE_PAGE_SIZE) {
+            continue;
+        }
+        uiRecSize = tkey_objstore_rec_size(psStore, psEntry->usLen);
+        eStatus = E_TKEY_FAILURE;
+        for(uiTry = 0; uiTry < TKEY_OBJSTORE_WRITE_RETRIES &&
+            E_TKEY_SUCCESS != eStatus; uiTry++) {
+            if(tkey_objstore_active_room(psStore) < uiRecSize &&
+               E_TKEY_SUCCESS != tkey_objstore_activate(psStore)) {
+                return E_TKEY_OBJSTORE_NO_SPACE;
+            }
+            /* Read back into the record buffer each time: a failed append
+             * leaves its own record there */
+            if(E_TKEY_SUCCESS != psDev->eRead(psDev->pvCtx,
+                                    psEntry->uiOffset, pucRec,
+                                    sizeof(TKey_ObjRecordHdr_t) +
+                                    psEntry->usLen)) {
+                return E_TKEY_OBJSTORE_FAILURE;
+            }
+            /* The copy gets a new sequence number so it wins over the
+             * original should the erase below not happen */
+            eStatus = tkey_objstore_append(psStore, (TKey_UINT16)uiId,
+                            &pucRec[sizeof(TKey_ObjRecordHdr_t)],
+                            psEntry->usLen);
+        }
+        if(E_TKEY_SUCCESS != eStatus) {
+            return E_TKEY_OBJSTORE_FAILURE;
+        }
+        psStore->sStats.uiRecordsMoved++;
+    }
+
+    psStore->sStats.uiCompactions++;
+    if(E_TKEY_SUCCESS != tkey_objstore_format_page(psStore, uiVictim,
+                            psStore->asPage[uiVictim].uiEraseCount + 1)) {
+        return E_TKEY_OBJSTORE_FAILURE;
+    }
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+static TKey_UINT32 tkey_objstore_pick_victim(const TKey_ObjStore_t *psStore)
+{
+    TKey_UINT32 uiPage;
+    TKey_UINT32 uiBest = TKEY_OBJSTORE_NO_PAGE;
+    TKey_UINT32 uiGarbage;
+    TKey_UINT32 uiBestGarbage = 0;
+
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        if(TKEY_OBJSTORE_PAGE_USED != psStore->asPage[uiPage].ucState) {
+            continue;
+        }
+        uiGarbage = tkey_objstore_page_garbage(psStore, uiPage);
+        if(uiGarbage > uiBestGarbage ||
+           (uiGarbage == uiBestGarbage && TKEY_OBJSTORE_NO_PAGE != uiBest &&
+            psStore->asPage[uiPage].uiEraseCount <
+            psStore->asPage[uiBest].uiEraseCount)) {
+            uiBest = uiPage;
+            uiBestGarbage = uiGarbage;
+        }
+    }
+    return uiBest;
+}
+
+/* Makes room for uiRecSize bytes in the active page, compacting if the
+ * only free page left is the reserve */
+static TKey_ObjStoreStatus_t tkey_objstore_make_room(TKey_ObjStore_t *psStore,
+                                                     TKey_UINT32 uiRecSize)
+{
+    TKey_ObjStoreStatus_t eStatus;
+    TKey_UINT32 uiVictim;
+    TKey_UINT32 uiRound;
+
+    for(uiRound = 0; uiRound < 2 * psStore->uiPageCount; uiRound++) {
+        if(tkey_objstore_active_room(psStore) >= uiRecSize) {
+            return E_TKEY_OBJSTORE_SUCCESS;
+        }
+        if(tkey_objstore_free_pages(psStore) > 1) {
+            if(E_TKEY_SUCCESS != tkey_objstore_activate(psStore)) {
+                return E_TKEY_OBJSTORE_FAILURE;
+            }
+            continue;
+        }
+        uiVictim = tkey_objstore_pick_victim(psStore);
+        if(TKEY_OBJSTORE_NO_PAGE == uiVictim ||
+           tkey_objstore_page_garbage(psStore, uiVictim) < uiRecSize) {
+            return E_TKEY_OBJSTORE_NO_SPACE;
+        }
+        eStatus = tkey_objstore_relocate(psStore, uiVictim);
+        if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+            return eStatus;
+        }
+    }
+    return E_TKEY_OBJSTORE_NO_SPACE;
+}
+
+static TKey_ObjStoreStatus_t tkey_objstore_put(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, const TKey_BYTE *pucData, TKey_UINT32 uiLen)
+{
+    TKey_UINT32 uiRecSize = tkey_objstore_rec_size(psStore, uiLen);
+    TKey_ObjStoreStatus_t eStatus;
+    TKey_UINT32 uiTry;
+
+    for(uiTry = 0; uiTry < TKEY_OBJSTORE_WRITE_RETRIES; uiTry++) {
+        eStatus = tkey_objstore_make_room(psStore, uiRecSize);
+        if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+            return eStatus;
+        }
+        /* A failed append retires the page; retry on a fresh one */
+        if(E_TKEY_SUCCESS == tkey_objstore_append(psStore, usId, pucData,
+                                                  uiLen)) {
+            psStore->sStats.uiWrites++;
+            return E_TKEY_OBJSTORE_SUCCESS;
+        }
+    }
+    return E_TKEY_OBJSTORE_FAILURE;
+}
+
+/* Rebuilds page bookkeeping and the index from one page */
+static TKey_VOID tkey_objstore_scan_page(TKey_ObjStore_t *psStore,
+        TKey_UINT32 uiPage, TKey_UINT32 *puiMaxSeq, TKey_UINT32 *puiMaxPage)
+{
+    const TKey_FlashDev_t *psDev = psStore->psDev;
+    TKey_ObjPage_t *psPage = &psStore->asPage[uiPage];
+    TKey_BYTE *pucRec = tkey_objstore_rec_buf(psStore);
+    TKey_UINT32 uiBase = uiPage * TKEY_OBJSTORE_PAGE_SIZE;
+    TKey_UINT32 uiOff = tkey_objstore_page_hdr_size(psStore);
+    TKey_ObjRecordHdr_t sHdr;
+    TKey_UINT32 uiRecSize;
+    TKey_BOOL bBlank;
+    TKey_BOOL bDamaged = TKey_FALSE;
+
+    while(uiOff + sizeof(sHdr) <= TKEY_OBJSTORE_PAGE_SIZE) {
+        if(E_TKEY_SUCCESS != tkey_objstore_is_blank(psStore, uiBase + uiOff,
+                                sizeof(sHdr), &bBlank)) {
+            bDamaged = TKey_TRUE;
+            break;
+        }
+        if(bBlank) {
+            break;
+        }
+        if(E_TKEY_SUCCESS != psDev->eRead(psDev->pvCtx, uiBase + uiOff,
+                                          (TKey_BYTE *)&sHdr, sizeof(sHdr)) ||
+           sHdr.usId >= TKEY_OBJSTORE_MAX_OBJECTS ||
+           sHdr.usLen > TKEY_OBJSTORE_MAX_OBJECT_SIZE ||
+           uiOff + tkey_objstore_rec_size(psStore, sHdr.usLen) >
+           TKEY_OBJSTORE_PAGE_SIZE) {
+            /* The record length cannot be trusted: stop here */
+            psStore->sStats.uiCorruptRecords++;
+            bDamaged = TKey_TRUE;
+            break;
+        }
+        uiRecSize = tkey_objstore_rec_size(psStore, sHdr.usLen);
+        if(E_TKEY_SUCCESS != psDev->eRead(psDev->pvCtx,
+                                uiBase + uiOff + sizeof(sHdr), pucRec,
+                                sHdr.usLen) ||
+           sHdr.uiCrc != tkey_objstore_rec_crc(&sHdr, pucRec)) {
+            psStore->sStats.uiCorruptRecords++;
+            bDamaged = TKey_TRUE;
+        } else {
+            if(TKEY_OBJSTORE_NO_RECORD == psStore->asIndex[sHdr.usId].uiOffset ||
+               sHdr.uiSeq > psStore->asIndex[sHdr.usId].uiSeq) {
+                tkey_objstore_index_set(psStore, &sHdr, uiBase + uiOff);
+            }
+            /* Only trust the sequence number of a valid record */
+            if(sHdr.uiSeq >= *puiMaxSeq) {
+                *puiMaxSeq = sHdr.uiSeq;
+                *puiMaxPage = uiPage;
+            }
+        }
+        uiOff += uiRecSize;
+    }
+
+    if(bDamaged) {
+        psPage->ucState = TKEY_OBJSTORE_PAGE_USED;
+        psPage->uiUsed = TKEY_OBJSTORE_PAGE_SIZE;
+    } else {
+        psPage->ucState = (uiOff == tkey_objstore_page_hdr_size(psStore)) ?
+                          TKEY_OBJSTORE_PAGE_FREE : TKEY_OBJSTORE_PAGE_USED;
+        psPage->uiUsed = uiOff;
+    }
+}
+
+static TKey_ObjStoreStatus_t tkey_objstore_attach(TKey_ObjStore_t *psStore,
+                                                  const TKey_FlashDev_t *psDev)
+{
+    TKey_UINT32 uiSlot;
+
+    if(TKey_NULL == psStore || TKey_NULL == psDev ||
+       0 == psDev->uiEraseSize ||
+       0 != (TKEY_OBJSTORE_PAGE_SIZE % psDev->uiEraseSize)) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    memset(psStore, 0, sizeof(TKey_ObjStore_t));
+    memset(psStore->asIndex, 0xFF, sizeof(psStore->asIndex));
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_SHADOW_SLOTS; uiSlot++) {
+        psStore->asShadow[uiSlot].usId = TKEY_OBJSTORE_NO_SHADOW;
+    }
+    psStore->psDev = psDev;
+    psStore->uiPageCount = psDev->uiSize / TKEY_OBJSTORE_PAGE_SIZE;
+    if(psStore->uiPageCount > TKEY_OBJSTORE_MAX_PAGES) {
+        psStore->uiPageCount = TKEY_OBJSTORE_MAX_PAGES;
+    }
+    if(psStore->uiPageCount < 2) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    psStore->uiActive = TKEY_OBJSTORE_NO_PAGE;
+    psStore->uiNextSeq = 1;
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStore_Mount(TKey_ObjStore_t *psStore,
+                                          const TKey_FlashDev_t *psDev)
+{
+    TKey_ObjPageHdr_t sHdr;
+    TKey_BOOL abValid[TKEY_OBJSTORE_MAX_PAGES];
+    TKey_UINT32 uiMaxErase = 0;
+    TKey_UINT32 uiMaxSeq = 0;
+    TKey_UINT32 uiMaxPage = TKEY_OBJSTORE_NO_PAGE;
+    TKey_UINT32 uiPage;
+    TKey_ObjStoreStatus_t eStatus;
+
+    eStatus = tkey_objstore_attach(psStore, psDev);
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+        return eStatus;
+    }
+
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        abValid[uiPage] = tkey_objstore_read_page_hdr(psStore, uiPage, &sHdr);
+        if(!abValid[uiPage]) {
+            continue;
+        }
+        psStore->asPage[uiPage].uiEraseCount = sHdr.uiEraseCount;
+        if(sHdr.uiEraseCount > uiMaxErase) {
+            uiMaxErase = sHdr.uiEraseCount;
+        }
+        tkey_objstore_scan_page(psStore, uiPage, &uiMaxSeq, &uiMaxPage);
+    }
+
+    /* Pages never formatted, or whose erase or header write was cut */
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        if(!abValid[uiPage]) {
+            tkey_objstore_format_page(psStore, uiPage, uiMaxErase + 1);
+        }
+    }
+
+    /* Keep appending to the page of the newest record if it has room;
+     * every other page is closed for appends */
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        if(TKEY_OBJSTORE_PAGE_USED != psStore->asPage[uiPage].ucState) {
+            continue;
+        }
+        if(uiPage == uiMaxPage &&
+           psStore->asPage[uiPage].uiUsed < TKEY_OBJSTORE_PAGE_SIZE) {
+            psStore->asPage[uiPage].ucState = TKEY_OBJSTORE_PAGE_ACTIVE;
+            psStore->uiActive = uiPage;
+        } else {
+            psStore->asPage[uiPage].uiUsed = TKEY_OBJSTORE_PAGE_SIZE;
+        }
+    }
+    psStore->uiNextSeq = uiMaxSeq + 1;
+    psStore->bMounted = TKey_TRUE;
+    THINKEY_DEBUG_INFO("OBJSTORE: mounted %u pages on %s, %u free",
+                       (unsigned)psStore->uiPageCount, psDev->pcName,
+                       (unsigned)tkey_objstore_free_pages(psStore));
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStore_Format(TKey_ObjStore_t *psStore,
+                                           const TKey_FlashDev_t *psDev)
+{
+    TKey_ObjPageHdr_t sHdr;
+    TKey_UINT32 uiPage;
+    TKey_UINT32 uiEraseCount;
+    TKey_ObjStoreStatus_t eStatus;
+
+    eStatus = tkey_objstore_attach(psStore, psDev);
+    if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+        return eStatus;
+    }
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        uiEraseCount = 0;
+        if(tkey_objstore_read_page_hdr(psStore, uiPage, &sHdr)) {
+            uiEraseCount = sHdr.uiEraseCount;
+        }
+        tkey_objstore_format_page(psStore, uiPage, uiEraseCount + 1);
+    }
+    psStore->bMounted = TKey_TRUE;
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStore_Write(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, const TKey_BYTE *pucData, TKey_UINT32 uiLen)
+{
+    if(TKey_NULL == psStore || !psStore->bMounted || TKey_NULL == pucData ||
+       usId >= TKEY_OBJSTORE_MAX_OBJECTS || 0 == uiLen ||
+       uiLen > TKEY_OBJSTORE_MAX_OBJECT_SIZE) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    return tkey_objstore_put(psStore, usId, pucData, uiLen);
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStore_Read(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, TKey_BYTE *pucBuf, TKey_UINT32 uiSize,
+        TKey_UINT32 *puiLen)
+{
+    const TKey_ObjIndex_t *psEntry;
+
+    if(TKey_NULL == psStore || !psStore->bMounted || TKey_NULL == puiLen ||
+       usId >= TKEY_OBJSTORE_MAX_OBJECTS) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    psEntry = &psStore->asIndex[usId];
+    if(TKEY_OBJSTORE_NO_RECORD == psEntry->uiOffset || 0 == psEntry->usLen) {
+        return E_TKEY_OBJSTORE_NOT_FOUND;
+    }
+    *puiLen = psEntry->usLen;
+    if(0 == uiSize) {
+        return E_TKEY_OBJSTORE_SUCCESS;
+    }
+    if(uiSize < psEntry->usLen) {
+        return E_TKEY_OBJSTORE_BUFFER_TOO_SMALL;
+    }
+    if(E_TKEY_SUCCESS != psStore->psDev->eRead(psStore->psDev->pvCtx,
+                            psEntry->uiOffset + sizeof(TKey_ObjRecordHdr_t),
+                            pucBuf, psEntry->usLen)) {
+        return E_TKEY_OBJSTORE_FAILURE;
+    }
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStore_View(TKey_ObjStore_t *psStore,
+        TKey_UINT16 usId, TKey_ObjView_t *psView)
+{
+    const TKey_ObjIndex_t *psEntry;
+    const TKey_ObjShadow_t *psShadow;
+    TKey_UINT32 uiEpoch;
+    TKey_UINT32 uiSlot;
+
+    if(TKey_NULL == psStore || !psStore->bMounted || TKey_NULL == psView ||
+       usId >= TKEY_OBJSTORE_MAX_OBJECTS) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    uiEpoch = psStore->uiFlashEpoch;
+    psEntry = &psStore->asIndex[usId];
+    if(TKEY_OBJSTORE_NO_RECORD == psEntry->uiOffset || 0 == psEntry->usLen) {
+        return E_TKEY_OBJSTORE_NOT_FOUND;
+    }
+    psView->uiEpoch = uiEpoch;
+    if(0 == (uiEpoch & 1) && TKey_NULL != psStore->psDev->pucMapped) {
+        psView->pucData = psStore->psDev->pucMapped + psEntry->uiOffset +
+                          sizeof(TKey_ObjRecordHdr_t);
+        psView->uiLen = psEntry->usLen;
+        psView->uiGeneration = psEntry->uiSeq;
+        psView->psShadow = TKey_NULL;
+        return E_TKEY_OBJSTORE_SUCCESS;
+    }
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_SHADOW_SLOTS; uiSlot++) {
+        psShadow = &psStore->asShadow[uiSlot];
+        if(usId == psShadow->usId && psEntry->uiSeq == psShadow->uiSeq) {
+            psView->pucData = (const TKey_BYTE *)psShadow->auiData;
+            psView->uiLen = psShadow->usLen;
+            psView->uiGeneration = psShadow->uiSeq;
+            psView->psShadow = psShadow;
+            return E_TKEY_OBJSTORE_SUCCESS;
+        }
+    }
+    return E_TKEY_OBJSTORE_BUSY;
+}
+
+TKey_BOOL TKey_ObjStore_ViewValid(const TKey_ObjStore_t *psStore,
+                                  const TKey_ObjView_t *psView)
+{
+    if(TKey_NULL != psView->psShadow) {
+        return (psView->psShadow->uiSeq == psView->uiGeneration);
+    }
+    return (psStore->uiFlashEpoch == psView->uiEpoch);
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStore_Pin(TKey_ObjStore_t *psStore,
+                                        TKey_UINT16 usId)
+{
+    const TKey_ObjIndex_t *psEntry;
+    TKey_ObjShadow_t *psShadow = TKey_NULL;
+    TKey_UINT32 uiSlot;
+
+    if(TKey_NULL == psStore || !psStore->bMounted ||
+       usId >= TKEY_OBJSTORE_MAX_OBJECTS) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_SHADOW_SLOTS; uiSlot++) {
+        if(usId == psStore->asShadow[uiSlot].usId) {
+            return E_TKEY_OBJSTORE_SUCCESS;
+        }
+        if(TKey_NULL == psShadow &&
+           TKEY_OBJSTORE_NO_SHADOW == psStore->asShadow[uiSlot].usId) {
+            psShadow = &psStore->asShadow[uiSlot];
+        }
+    }
+    if(TKey_NULL == psShadow) {
+        return E_TKEY_OBJSTORE_NO_SPACE;
+    }
+    psShadow->uiSeq = 0;
+    psShadow->usId = usId;
+    psEntry = &psStore->asIndex[usId];
+    if(TKEY_OBJSTORE_NO_RECORD != psEntry->uiOffset &&
+       psEntry->usLen <= TKEY_OBJSTORE_SHADOW_SIZE) {
+        if(E_TKEY_SUCCESS != psStore->psDev->eRead(psStore->psDev->pvCtx,
+                                psEntry->uiOffset + sizeof(TKey_ObjRecordHdr_t),
+                                (TKey_BYTE *)psShadow->auiData,
+                                psEntry->usLen)) {
+            return E_TKEY_OBJSTORE_FAILURE;
+        }
+        psShadow->usLen = psEntry->usLen;
+        psShadow->uiSeq = psEntry->uiSeq;
+    }
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStore_Delete(TKey_ObjStore_t *psStore,
+                                           TKey_UINT16 usId)
+{
+    const TKey_ObjIndex_t *psEntry;
+
+    if(TKey_NULL == psStore || !psStore->bMounted ||
+       usId >= TKEY_OBJSTORE_MAX_OBJECTS) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    psEntry = &psStore->asIndex[usId];
+    if(TKEY_OBJSTORE_NO_RECORD == psEntry->uiOffset || 0 == psEntry->usLen) {
+        return E_TKEY_OBJSTORE_NOT_FOUND;
+    }
+    /* A zero length record shadows every older record of the object */
+    return tkey_objstore_put(psStore, usId, TKey_NULL, 0);
+}
+
+TKey_BOOL TKey_ObjStore_Compact(TKey_ObjStore_t *psStore)
+{
+    TKey_UINT32 uiPage;
+    TKey_UINT32 uiVictim;
+    TKey_UINT32 uiMinErase = 0xFFFFFFFF;
+    TKey_UINT32 uiMaxErase = 0;
+    TKey_UINT32 uiCold = TKEY_OBJSTORE_NO_PAGE;
+
+    if(TKey_NULL == psStore || !psStore->bMounted) {
+        return TKey_FALSE;
+    }
+
+    /* Reclaim garbage ahead of need, half a page at a time at least so
+     * that each step makes progress */
+    if(tkey_objstore_free_pages(psStore) < TKEY_OBJSTORE_BG_FREE_PAGES) {
+        uiVictim = tkey_objstore_pick_victim(psStore);
+        if(TKEY_OBJSTORE_NO_PAGE != uiVictim &&
+           tkey_objstore_page_garbage(psStore, uiVictim) >=
+           TKEY_OBJSTORE_PAGE_SIZE / 2) {
+            return (E_TKEY_OBJSTORE_SUCCESS ==
+                    tkey_objstore_relocate(psStore, uiVictim));
+        }
+    }
+
+    /* Static wear levelling: move cold data off the least worn page */
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        const TKey_ObjPage_t *psPage = &psStore->asPage[uiPage];
+
+        if(TKEY_OBJSTORE_PAGE_BAD == psPage->ucState) {
+            continue;
+        }
+        if(psPage->uiEraseCount > uiMaxErase) {
+            uiMaxErase = psPage->uiEraseCount;
+        }
+        if(TKEY_OBJSTORE_PAGE_USED == psPage->ucState &&
+           psPage->uiEraseCount < uiMinErase) {
+            uiMinErase = psPage->uiEraseCount;
+            uiCold = uiPage;
+        }
+    }
+    if(TKEY_OBJSTORE_NO_PAGE != uiCold &&
+       uiMaxErase - uiMinErase > TKEY_OBJSTORE_WEAR_THRESHOLD &&
+       tkey_objstore_free_pages(psStore) >= 1) {
+        return (E_TKEY_OBJSTORE_SUCCESS ==
+                tkey_objstore_relocate(psStore, uiCold));
+    }
+    return TKey_FALSE;
+}
+
+TKey_VOID TKey_ObjStore_GetStats(TKey_ObjStore_t *psStore,
+                                 TKey_ObjStoreStats_t *psStats)
+{
+    TKey_UINT32 uiPage;
+
+    psStore->sStats.uiFreePages = tkey_objstore_free_pages(psStore);
+    psStore->sStats.uiMinEraseCount = 0xFFFFFFFF;
+    psStore->sStats.uiMaxEraseCount = 0;
+    for(uiPage = 0; uiPage < psStore->uiPageCount; uiPage++) {
+        const TKey_ObjPage_t *psPage = &psStore->asPage[uiPage];
+
+        if(TKEY_OBJSTORE_PAGE_BAD == psPage->ucState) {
+            continue;
+        }
+        if(psPage->uiEraseCount < psStore->sStats.uiMinEraseCount) {
+            psStore->sStats.uiMinEraseCount = psPage->uiEraseCount;
+        }
+        if(psPage->uiEraseCount > psStore->sStats.uiMaxEraseCount) {
+            psStore->sStats.uiMaxEraseCount = psPage->uiEraseCount;
+        }
+    }
+    *psStats = psStore->sStats;
+}
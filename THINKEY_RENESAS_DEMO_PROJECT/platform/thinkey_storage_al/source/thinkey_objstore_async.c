@@ -0,0 +1,356 @@
+/*
+ * \file thinkey_objstore_async.c
+ *
+ * \brief Write-behind queue of the object store
+ *
+ * A slot is FREE, PENDING (queued, may still be replaced by a newer write
+ * of the same object) or WRITING (owned by the worker, data frozen). Slot
+ * state changes and data copies happen in short critical sections; the
+ * flash is only touched by the worker outside them.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_STORAGE
+
+#include "thinkey_objstore_async.h"
+#include "thinkey_osal.h"
+#include "thinkey_debug.h"
+#include <string.h>
+
+#define TKEY_OBJSTORE_ASYNC_FREE 0
+#define TKEY_OBJSTORE_ASYNC_PENDING 1
+#define TKEY_OBJSTORE_ASYNC_WRITING 2
+
+/* Attempts to get a consistent view while the worker moves records */
+#define TKEY_OBJSTORE_ASYNC_READ_RETRIES 8
+
+typedef struct
+{
+    TKey_BYTE ucState;
+    TKey_BOOL bDelete;
+    TKey_UINT16 usId;
+    TKey_UINT32 uiLen;
+    TKey_UINT32 uiTicket;           /* order of the request */
+    TKey_ObjStoreDone_t pfnDone;
+    TKey_VOID *pvCtx;
+    TKey_BYTE aucData[TKEY_OBJSTORE_MAX_OBJECT_SIZE];
+} TKey_ObjStoreSlot_t;
+
+typedef struct
+{
+    TKey_ObjStore_t *psStore;
+    volatile TKey_BOOL bWorkerRunning;
+    TKey_HANDLE hQueue;
+    TKey_UINT32 uiTicket;
+    volatile TKey_UINT32 uiPending;
+    TKey_ObjStoreSlot_t asSlot[TKEY_OBJSTORE_ASYNC_SLOTS];
+    TKey_ObjStoreAsyncStats_t sStats;
+} TKey_ObjStoreAsync_t;
+
+static TKey_ObjStoreAsync_t gsObjStoreAsync;
+
+static TKey_ObjStoreStatus_t tkey_objstore_async_execute(TKey_UINT16 usId,
+        TKey_BOOL bDelete, const TKey_BYTE *pucData, TKey_UINT32 uiLen)
+{
+    TKey_ObjStoreStatus_t eStatus;
+
+    if(bDelete) {
+        eStatus = TKey_ObjStore_Delete(gsObjStoreAsync.psStore, usId);
+        /* Deleting what is not there is done */
+        return (E_TKEY_OBJSTORE_NOT_FOUND == eStatus) ?
+               E_TKEY_OBJSTORE_SUCCESS : eStatus;
+    }
+    return TKey_ObjStore_Write(gsObjStoreAsync.psStore, usId, pucData, uiLen);
+}
+
+static TKey_VOID tkey_objstore_async_worker_task(TKey_VOID *pvParams)
+{
+    TKey_ObjStoreSlot_t *psSlot;
+    TKey_ObjStoreStatus_t eStatus;
+    TKey_ObjStoreDone_t pfnDone;
+    TKey_VOID *pvCtx;
+    TKey_UINT32 uiSlot;
+    TKey_UINT16 usId;
+
+    (TKey_VOID)pvParams;
+    while(TKey_FOREVER) {
+        if(E_THINKEY_SUCCESS !=
+           THINKey_OSAL_eTimedQueueReceive(gsObjStoreAsync.hQueue, &uiSlot,
+                                           TKEY_OBJSTORE_ASYNC_IDLE_MS)) {
+            TKey_ObjStore_Compact(gsObjStoreAsync.psStore);
+            continue;
+        }
+        psSlot = &gsObjStoreAsync.asSlot[uiSlot];
+
+        /* From here on a new write of the object takes another slot */
+        THINKey_OSAL_vEnterCritical();
+        psSlot->ucState = TKEY_OBJSTORE_ASYNC_WRITING;
+        THINKey_OSAL_vExitCritical();
+
+        usId = psSlot->usId;
+        eStatus = tkey_objstore_async_execute(usId, psSlot->bDelete,
+                                              psSlot->aucData, psSlot->uiLen);
+
+        THINKey_OSAL_vEnterCritical();
+        pfnDone = psSlot->pfnDone;
+        pvCtx = psSlot->pvCtx;
+        psSlot->ucState = TKEY_OBJSTORE_ASYNC_FREE;
+        gsObjStoreAsync.uiPending--;
+        if(E_TKEY_OBJSTORE_SUCCESS == eStatus) {
+            gsObjStoreAsync.sStats.uiCompleted++;
+        } else {
+            gsObjStoreAsync.sStats.uiFailed++;
+        }
+        THINKey_OSAL_vExitCritical();
+
+        if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+            THINKEY_DEBUG_ERROR("OBJSTORE: write-behind of object %u failed (%d)",
+                                (unsigned)usId, eStatus);
+        }
+        if(TKey_NULL != pfnDone) {
+            pfnDone(usId, eStatus, pvCtx);
+        }
+    }
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Init(TKey_ObjStore_t *psStore)
+{
+    if(TKey_NULL == psStore || !psStore->bMounted) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    if(gsObjStoreAsync.bWorkerRunning) {
+        /* The worker keeps its queue; only rebind the store */
+        gsObjStoreAsync.psStore = psStore;
+        return E_TKEY_OBJSTORE_SUCCESS;
+    }
+    memset(&gsObjStoreAsync, 0, sizeof(gsObjStoreAsync));
+    gsObjStoreAsync.psStore = psStore;
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+THINKEY_OSAL_QUEUE_STORAGE(storage, gsObjStoreQueue, TKEY_OBJSTORE_ASYNC_SLOTS,
+                           sizeof(TKey_UINT32));
+THINKEY_OSAL_TASK_STORAGE(storage, gsObjStoreTask, TKEY_OBJSTORE_ASYNC_TASK_STACK_SIZE);
+
+TKey_StatusType TKey_ObjStoreAsync_StartWorker(TKey_VOID)
+{
+    TKey_UINT32 uiTaskId;
+
+    if(TKey_NULL == gsObjStoreAsync.psStore) {
+        return E_TKEY_FAILURE;
+    }
+    if(gsObjStoreAsync.bWorkerRunning) {
+        return E_TKEY_SUCCESS;
+    }
+    gsObjStoreAsync.hQueue = THINKEY_OSAL_CREATE_STATIC_QUEUE(gsObjStoreQueue,
+                                TKEY_OBJSTORE_ASYNC_SLOTS, sizeof(TKey_UINT32));
+    if(TKey_NULL == gsObjStoreAsync.hQueue) {
+        return E_TKEY_FAILURE;
+    }
+    THINKey_OSAL_vQueueSetName(gsObjStoreAsync.hQueue, "Storage");
+    gsObjStoreAsync.bWorkerRunning = TKey_TRUE;
+    if(E_THINKEY_SUCCESS != THINKEY_OSAL_CREATE_STATIC_TASK(gsObjStoreTask,
+                                "Storage Task", tkey_objstore_async_worker_task,
+                                TKey_NULL, TKEY_OBJSTORE_ASYNC_TASK_PRIORITY,
+                                &uiTaskId)) {
+        gsObjStoreAsync.bWorkerRunning = TKey_FALSE;
+        THINKEY_DEBUG_ERROR("OBJSTORE: worker task creation failed");
+        return E_TKEY_FAILURE;
+    }
+    return E_TKEY_SUCCESS;
+}
+
+static TKey_ObjStoreStatus_t tkey_objstore_async_submit(TKey_UINT16 usId,
+        TKey_BOOL bDelete, const TKey_BYTE *pucData, TKey_UINT32 uiLen,
+        TKey_ObjStoreDone_t pfnDone, TKey_VOID *pvCtx)
+{
+    TKey_ObjStoreSlot_t *psSlot = TKey_NULL;
+    TKey_ObjStoreDone_t pfnSuperseded = TKey_NULL;
+    TKey_VOID *pvSupersededCtx = TKey_NULL;
+    TKey_ObjStoreStatus_t eStatus;
+    TKey_UINT32 uiSlot;
+    TKey_UINT32 uiFree = TKEY_OBJSTORE_ASYNC_SLOTS;
+
+    if(TKey_NULL == gsObjStoreAsync.psStore) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    if(!gsObjStoreAsync.bWorkerRunning) {
+        /* No worker yet: write through in the calling task */
+        eStatus = tkey_objstore_async_execute(usId, bDelete, pucData, uiLen);
+        if(TKey_NULL != pfnDone) {
+            pfnDone(usId, eStatus, pvCtx);
+        }
+        return eStatus;
+    }
+
+    THINKey_OSAL_vEnterCritical();
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_ASYNC_SLOTS; uiSlot++) {
+        if(TKEY_OBJSTORE_ASYNC_PENDING == gsObjStoreAsync.asSlot[uiSlot].ucState &&
+           usId == gsObjStoreAsync.asSlot[uiSlot].usId) {
+            psSlot = &gsObjStoreAsync.asSlot[uiSlot];
+            break;
+        }
+        if(TKEY_OBJSTORE_ASYNC_SLOTS == uiFree &&
+           TKEY_OBJSTORE_ASYNC_FREE == gsObjStoreAsync.asSlot[uiSlot].ucState) {
+            uiFree = uiSlot;
+        }
+    }
+    if(TKey_NULL != psSlot) {
+        /* Still queued: replace it in place, keeping its queue position */
+        pfnSuperseded = psSlot->pfnDone;
+        pvSupersededCtx = psSlot->pvCtx;
+        gsObjStoreAsync.sStats.uiCoalesced++;
+    } else if(TKEY_OBJSTORE_ASYNC_SLOTS != uiFree) {
+        psSlot = &gsObjStoreAsync.asSlot[uiFree];
+        psSlot->ucState = TKEY_OBJSTORE_ASYNC_PENDING;
+        psSlot->usId = usId;
+        gsObjStoreAsync.uiPending++;
+        if(gsObjStoreAsync.uiPending > gsObjStoreAsync.sStats.uiMaxPending) {
+            gsObjStoreAsync.sStats.uiMaxPending = gsObjStoreAsync.uiPending;
+        }
+    } else {
+        gsObjStoreAsync.sStats.uiQueueFull++;
+        THINKey_OSAL_vExitCritical();
+        return E_TKEY_OBJSTORE_QUEUE_FULL;
+    }
+    psSlot->bDelete = bDelete;
+    psSlot->uiLen = uiLen;
+    psSlot->uiTicket = ++gsObjStoreAsync.uiTicket;
+    psSlot->pfnDone = pfnDone;
+    psSlot->pvCtx = pvCtx;
+    if(!bDelete) {
+        memcpy(psSlot->aucData, pucData, uiLen);
+    }
+    gsObjStoreAsync.sStats.uiQueued++;
+    THINKey_OSAL_vExitCritical();
+
+    if(TKey_NULL != pfnSuperseded) {
+        pfnSuperseded(usId, E_TKEY_OBJSTORE_SUPERSEDED, pvSupersededCtx);
+        return E_TKEY_OBJSTORE_SUCCESS;
+    }
+    /* The queue holds as many entries as there are slots */
+    THINKey_OSAL_eQueueSend(gsObjStoreAsync.hQueue, &uiFree);
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Write(TKey_UINT16 usId,
+        const TKey_BYTE *pucData, TKey_UINT32 uiLen,
+        TKey_ObjStoreDone_t pfnDone, TKey_VOID *pvCtx)
+{
+    if(TKey_NULL == pucData || usId >= TKEY_OBJSTORE_MAX_OBJECTS ||
+       0 == uiLen || uiLen > TKEY_OBJSTORE_MAX_OBJECT_SIZE) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    return tkey_objstore_async_submit(usId, TKey_FALSE, pucData, uiLen,
+                                      pfnDone, pvCtx);
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Delete(TKey_UINT16 usId,
+        TKey_ObjStoreDone_t pfnDone, TKey_VOID *pvCtx)
+{
+    if(usId >= TKEY_OBJSTORE_MAX_OBJECTS) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    return tkey_objstore_async_submit(usId, TKey_TRUE, TKey_NULL, 0,
+                                      pfnDone, pvCtx);
+}
+
+/* Copies the newest queued value of the object; E_TKEY_OBJSTORE_BUSY when
+ * nothing is queued for it */
+static TKey_ObjStoreStatus_t tkey_objstore_async_read_pending(TKey_UINT16 usId,
+        TKey_BYTE *pucBuf, TKey_UINT32 uiSize, TKey_UINT32 *puiLen)
+{
+    const TKey_ObjStoreSlot_t *psSlot;
+    const TKey_ObjStoreSlot_t *psNewest = TKey_NULL;
+    TKey_ObjStoreStatus_t eStatus = E_TKEY_OBJSTORE_SUCCESS;
+    TKey_UINT32 uiSlot;
+
+    THINKey_OSAL_vEnterCritical();
+    for(uiSlot = 0; uiSlot < TKEY_OBJSTORE_ASYNC_SLOTS; uiSlot++) {
+        psSlot = &gsObjStoreAsync.asSlot[uiSlot];
+        if(TKEY_OBJSTORE_ASYNC_FREE != psSlot->ucState && usId == psSlot->usId &&
+           (TKey_NULL == psNewest ||
+            (TKey_INT32)(psSlot->uiTicket - psNewest->uiTicket) > 0)) {
+            psNewest = psSlot;
+        }
+    }
+    if(TKey_NULL == psNewest) {
+        eStatus = E_TKEY_OBJSTORE_BUSY;
+    } else if(psNewest->bDelete) {
+        eStatus = E_TKEY_OBJSTORE_NOT_FOUND;
+    } else {
+        *puiLen = psNewest->uiLen;
+        if(0 != uiSize && uiSize < psNewest->uiLen) {
+            eStatus = E_TKEY_OBJSTORE_BUFFER_TOO_SMALL;
+        } else if(0 != uiSize) {
+            memcpy(pucBuf, psNewest->aucData, psNewest->uiLen);
+        }
+    }
+    THINKey_OSAL_vExitCritical();
+    return eStatus;
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Read(TKey_UINT16 usId,
+        TKey_BYTE *pucBuf, TKey_UINT32 uiSize, TKey_UINT32 *puiLen)
+{
+    TKey_ObjStoreStatus_t eStatus;
+    TKey_ObjView_t sView;
+    TKey_UINT32 uiTry;
+
+    if(TKey_NULL == gsObjStoreAsync.psStore || TKey_NULL == puiLen ||
+       usId >= TKEY_OBJSTORE_MAX_OBJECTS) {
+        return E_TKEY_OBJSTORE_INVALID_ARG;
+    }
+    if(!gsObjStoreAsync.bWorkerRunning) {
+        return TKey_ObjStore_Read(gsObjStoreAsync.psStore, usId, pucBuf,
+                                  uiSize, puiLen);
+    }
+    eStatus = tkey_objstore_async_read_pending(usId, pucBuf, uiSize, puiLen);
+    if(E_TKEY_OBJSTORE_BUSY != eStatus) {
+        return eStatus;
+    }
+
+    /* Nothing queued: copy from a view, the worker may be moving records */
+    for(uiTry = 0; uiTry < TKEY_OBJSTORE_ASYNC_READ_RETRIES; uiTry++) {
+        eStatus = TKey_ObjStore_View(gsObjStoreAsync.psStore, usId, &sView);
+        if(E_TKEY_OBJSTORE_BUSY == eStatus) {
+            THINKey_OSAL_Delay(1);
+            continue;
+        }
+        if(E_TKEY_OBJSTORE_SUCCESS != eStatus) {
+            return eStatus;
+        }
+        *puiLen = sView.uiLen;
+        if(0 == uiSize) {
+            return E_TKEY_OBJSTORE_SUCCESS;
+        }
+        if(uiSize < sView.uiLen) {
+            return E_TKEY_OBJSTORE_BUFFER_TOO_SMALL;
+        }
+        memcpy(pucBuf, sView.pucData, sView.uiLen);
+        if(TKey_ObjStore_ViewValid(gsObjStoreAsync.psStore, &sView)) {
+            return E_TKEY_OBJSTORE_SUCCESS;
+        }
+    }
+    return E_TKEY_OBJSTORE_BUSY;
+}
+
+TKey_ObjStoreStatus_t TKey_ObjStoreAsync_Flush(TKey_UINT32 uiTimeoutMs)
+{
+    while(0 != gsObjStoreAsync.uiPending) {
+        if(0 == uiTimeoutMs--) {
+            return E_TKEY_OBJSTORE_BUSY;
+        }
+        THINKey_OSAL_Delay(1);
+    }
+    return E_TKEY_OBJSTORE_SUCCESS;
+}
+
+TKey_VOID TKey_ObjStoreAsync_GetStats(TKey_ObjStoreAsyncStats_t *psStats)
+{
+    THINKey_OSAL_vEnterCritical();
+    *psStats = gsObjStoreAsync.sStats;
+    THINKey_OSAL_vExitCritical();
+}
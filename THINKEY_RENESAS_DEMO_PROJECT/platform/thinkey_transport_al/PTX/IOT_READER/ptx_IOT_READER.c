@@ -23,6 +23,8 @@
  * ####################################################################################################################
  */
 
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_PTX
+
 #include "ptx_IOT_READER.h"
 #include "ptxNSC.h"
 #include "ptxNSC_System.h"
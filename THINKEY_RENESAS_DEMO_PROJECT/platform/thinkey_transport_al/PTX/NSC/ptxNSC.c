@@ -22,6 +22,8 @@
  * ####################################################################################################################
  */
 
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_PTX
+
 #include "ptxStatus.h"
 #include "ptxNSC.h"
 #include "ptxNSC_System.h"
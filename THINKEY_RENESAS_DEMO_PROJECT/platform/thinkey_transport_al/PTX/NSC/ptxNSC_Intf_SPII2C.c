@@ -21,6 +21,9 @@
  * INCLUDES
  * ####################################################################################################################
  */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_PTX
+
 #include "ptxNSC_Intf.h"
 #include "ptxNSC.h"
 #include "ptxNSC_Hal.h"
@@ -3,6 +3,17 @@
  *
  * \brief Header file for debug functions
  *
+ * The debug prints are filtered twice. At compile time, a print above the
+ * level of its module expands to nothing: its arguments are not evaluated
+ * and its format string is not in the image. At run time, the prints left
+ * are checked against a level per module, set with TKey_Debug_SetLevel().
+ *
+ * A source file picks its module before its first include:
+ *   #define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_NAL
+ * and the build sets THINKEY_DEBUG_MAX_LEVEL for all modules, or
+ * THINKEY_DEBUG_MAX_LEVEL_<MODULE> for one, e.g.
+ * -DTHINKEY_DEBUG_MAX_LEVEL=THINKEY_DEBUG_LEVEL_WARNING for a release.
+ *
  * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
  * All Rights Reserved.
  */
@@ -12,14 +23,163 @@
 #include "uart_debug.h"
 #include "thinkey_platform_types.h"
 
-#define THINKEY_DEBUG_ERROR task_print_error
-#define THINKEY_DEBUG_WARNING task_print_warning
-#define THINKEY_DEBUG_INFO task_print_info
+/* Levels, as those of the deferred log */
+#define THINKEY_DEBUG_LEVEL_NONE 0
+#define THINKEY_DEBUG_LEVEL_ERROR 1
+#define THINKEY_DEBUG_LEVEL_WARNING 2
+#define THINKEY_DEBUG_LEVEL_INFO 3
+#define THINKEY_DEBUG_LEVEL_DEBUG 4
+
+#define THINKEY_DEBUG_MODULE_APP 0
+#define THINKEY_DEBUG_MODULE_OSAL 1
+#define THINKEY_DEBUG_MODULE_STORAGE 2
+#define THINKEY_DEBUG_MODULE_BLE 3
+#define THINKEY_DEBUG_MODULE_NAL 4
+#define THINKEY_DEBUG_MODULE_PTX 5
+#define THINKEY_DEBUG_MODULE_SECURITY 6
+#define THINKEY_DEBUG_MODULE_RANGING 7
+#define THINKEY_DEBUG_MODULE_COUNT 8
+
+#ifndef THINKEY_DEBUG_MODULE
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_APP
+#endif
+
+/* Compile time levels */
+#ifndef THINKEY_DEBUG_MAX_LEVEL
+#define THINKEY_DEBUG_MAX_LEVEL THINKEY_DEBUG_LEVEL_INFO
+#endif
+#ifndef THINKEY_DEBUG_MAX_LEVEL_APP
+#define THINKEY_DEBUG_MAX_LEVEL_APP THINKEY_DEBUG_MAX_LEVEL
+#endif
+#ifndef THINKEY_DEBUG_MAX_LEVEL_OSAL
+#define THINKEY_DEBUG_MAX_LEVEL_OSAL THINKEY_DEBUG_MAX_LEVEL
+#endif
+#ifndef THINKEY_DEBUG_MAX_LEVEL_STORAGE
+#define THINKEY_DEBUG_MAX_LEVEL_STORAGE THINKEY_DEBUG_MAX_LEVEL
+#endif
+#ifndef THINKEY_DEBUG_MAX_LEVEL_BLE
+#define THINKEY_DEBUG_MAX_LEVEL_BLE THINKEY_DEBUG_MAX_LEVEL
+#endif
+#ifndef THINKEY_DEBUG_MAX_LEVEL_NAL
+#define THINKEY_DEBUG_MAX_LEVEL_NAL THINKEY_DEBUG_MAX_LEVEL
+#endif
+#ifndef THINKEY_DEBUG_MAX_LEVEL_PTX
+#define THINKEY_DEBUG_MAX_LEVEL_PTX THINKEY_DEBUG_MAX_LEVEL
+#endif
+#ifndef THINKEY_DEBUG_MAX_LEVEL_SECURITY
+#define THINKEY_DEBUG_MAX_LEVEL_SECURITY THINKEY_DEBUG_MAX_LEVEL
+#endif
+#ifndef THINKEY_DEBUG_MAX_LEVEL_RANGING
+#define THINKEY_DEBUG_MAX_LEVEL_RANGING THINKEY_DEBUG_MAX_LEVEL
+#endif
+
+#if (THINKEY_DEBUG_MODULE == THINKEY_DEBUG_MODULE_OSAL)
+#define THINKEY_DEBUG_MODULE_LEVEL THINKEY_DEBUG_MAX_LEVEL_OSAL
+#elif (THINKEY_DEBUG_MODULE == THINKEY_DEBUG_MODULE_STORAGE)
+#define THINKEY_DEBUG_MODULE_LEVEL THINKEY_DEBUG_MAX_LEVEL_STORAGE
+#elif (THINKEY_DEBUG_MODULE == THINKEY_DEBUG_MODULE_BLE)
+#define THINKEY_DEBUG_MODULE_LEVEL THINKEY_DEBUG_MAX_LEVEL_BLE
+#elif (THINKEY_DEBUG_MODULE == THINKEY_DEBUG_MODULE_NAL)
+#define THINKEY_DEBUG_MODULE_LEVEL THINKEY_DEBUG_MAX_LEVEL_NAL
+#elif (THINKEY_DEBUG_MODULE == THINKEY_DEBUG_MODULE_PTX)
+#define THINKEY_DEBUG_MODULE_LEVEL THINKEY_DEBUG_MAX_LEVEL_PTX
+#elif (THINKEY_DEBUG_MODULE == THINKEY_DEBUG_MODULE_SECURITY)
+#define THINKEY_DEBUG_MODULE_LEVEL THINKEY_DEBUG_MAX_LEVEL_SECURITY
+#elif (THINKEY_DEBUG_MODULE == THINKEY_DEBUG_MODULE_RANGING)
+#define THINKEY_DEBUG_MODULE_LEVEL THINKEY_DEBUG_MAX_LEVEL_RANGING
+#else
+#define THINKEY_DEBUG_MODULE_LEVEL THINKEY_DEBUG_MAX_LEVEL_APP
+#endif
+
+/* Run time levels, indexed by module */
+extern TKey_BYTE gaucTKeyDebugLevel[THINKEY_DEBUG_MODULE_COUNT];
+
+#define THINKEY_DEBUG_ON(level) \
+    ((level) <= gaucTKeyDebugLevel[THINKEY_DEBUG_MODULE])
+#define THINKEY_DEBUG_EMIT(level, print, ...) do { \
+        if(THINKEY_DEBUG_ON(level)) { \
+            print(__VA_ARGS__); \
+        } \
+    } while(0)
+
+#if (THINKEY_DEBUG_MODULE_LEVEL >= THINKEY_DEBUG_LEVEL_ERROR)
+#define THINKEY_DEBUG_ERROR(...) \
+    THINKEY_DEBUG_EMIT(THINKEY_DEBUG_LEVEL_ERROR, task_print_error, __VA_ARGS__)
+#else
+#define THINKEY_DEBUG_ERROR(...) do { } while(0)
+#endif
+#if (THINKEY_DEBUG_MODULE_LEVEL >= THINKEY_DEBUG_LEVEL_WARNING)
+#define THINKEY_DEBUG_WARNING(...) \
+    THINKEY_DEBUG_EMIT(THINKEY_DEBUG_LEVEL_WARNING, task_print_warning, __VA_ARGS__)
+#else
+#define THINKEY_DEBUG_WARNING(...) do { } while(0)
+#endif
+#if (THINKEY_DEBUG_MODULE_LEVEL >= THINKEY_DEBUG_LEVEL_INFO)
+#define THINKEY_DEBUG_INFO(...) \
+    THINKEY_DEBUG_EMIT(THINKEY_DEBUG_LEVEL_INFO, task_print_info, __VA_ARGS__)
+#else
+#define THINKEY_DEBUG_INFO(...) do { } while(0)
+#endif
+#if (THINKEY_DEBUG_MODULE_LEVEL >= THINKEY_DEBUG_LEVEL_DEBUG)
+#define THINKEY_DEBUG_DEBUG(...) \
+    THINKEY_DEBUG_EMIT(THINKEY_DEBUG_LEVEL_DEBUG, task_print, __VA_ARGS__)
+/* Hex dump of a buffer after a literal label, at the debug level */
+#if (DEBUG_ENABLE)
+#define THINKEY_DEBUG_DUMP(label, pvData, uiLength) do { \
+        if(THINKEY_DEBUG_ON(THINKEY_DEBUG_LEVEL_DEBUG)) { \
+            TKEY_DLOG_BUF(TKEY_DLOG_LEVEL_DEBUG, label, (pvData), (uiLength)); \
+        } \
+    } while(0)
+#else
+#define THINKEY_DEBUG_DUMP(label, pvData, uiLength) do { \
+        if(THINKEY_DEBUG_ON(THINKEY_DEBUG_LEVEL_DEBUG)) { \
+            TKey_Debug_PrintBuf(label, (pvData), (uiLength)); \
+        } \
+    } while(0)
+#endif
+#else
+#define THINKEY_DEBUG_DEBUG(...) do { } while(0)
+#define THINKEY_DEBUG_DUMP(label, pvData, uiLength) do { } while(0)
+#endif
+
 #define THINKEY_DEBUG_PRINT_STATUS_MESSAGE(...) do{TKey_Debug_Tab_App_Send_Status_Message(__VA_ARGS__);}while(0)
 /**
- * \brief Initialisation method for debug prints 
- */ 
+ * \brief Initialisation method for debug prints
+ */
 THINKey_eStatusType THINKey_DEBUGInit(THINKey_VOID);
+
+/**
+ * \brief   Formats a status message into the history of thinkey_status_log.h
+ *          and posts it to the tab app: aiData[0] points to the text, which
+ *          is reused after five more messages, and aiData[1] is its
+ *          sequence number in the history. A tab app falling behind reads
+ *          the messages from the history with TKey_StatusLog_Read() on a
+ *          reader of its own instead.
+ */
 void TKey_Debug_Tab_App_Send_Status_Message(char* stringPtr, ...);
 
+/**
+ * \brief   Sets the run time level of a module, or of all modules with
+ *          THINKEY_DEBUG_MODULE_COUNT. Prints above the compile time level
+ *          stay out whatever the run time level.
+ */
+THINKey_eStatusType TKey_Debug_SetLevel(TKey_UINT32 uiModule, TKey_UINT32 uiLevel);
+
+/**
+ * \brief   Returns the run time level of a module
+ */
+TKey_UINT32 TKey_Debug_GetLevel(TKey_UINT32 uiModule);
+
+/**
+ * \brief   Returns the name of a module, THINKey_NULL if unknown
+ */
+const TKey_CHAR* TKey_Debug_ModuleName(TKey_UINT32 uiModule);
+
+/**
+ * \brief   Prints a label and the bytes of a buffer in hex with printf.
+ *          Use THINKEY_DEBUG_DUMP(), which filters it.
+ */
+TKey_VOID TKey_Debug_PrintBuf(const TKey_CHAR *pcLabel, const TKey_VOID *pvData,
+                              TKey_UINT32 uiLength);
+
 #endif /* THINKEY_DEBUG_H */
@@ -22,6 +22,8 @@
  * ####################################################################################################################
  */
 
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_PTX
+
 #include "ptxPLAT.h"
 #include "ptxPLAT_EXT.h"
 #include <string.h>
@@ -25,6 +25,9 @@
  * INCLUDES
  * ####################################################################################################################
  */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_PTX
+
 #include "ptxPLAT_SPI.h"
 #include "r_spi.h"
 #include "r_spi_cfg.h"
@@ -76,15 +79,6 @@
  */
 ptxPLAT_Spi_t spi_ctx;
 
-void printbuf(uint8_t *buf, unsigned int len) {
-	//printf("\r\n size: %d\r\n", len);
-	for(int i=0; i < (int)len; i++)
-		//printf("0x%x ", buf[i]);
-	    SEGGER_RTT_printf(0, "0x%x", buf[i]);
-	//printf("\r\n\n");
-	SEGGER_RTT_printf(0,"\r\n\n");
-}
-
 //void ptx_irq_handler(nrf_drv_gpiote_pin_t irqPin, nrf_gpiote_polarity_t irq_action)
 //{
 //
@@ -155,7 +149,7 @@ ptxStatus_t ptxPLAT_SPI_GetInitialized(ptxPLAT_Spi_t **spi, ptxPLAT_SpiConfigPar
             result = R_SPI_Open(&g_spi0_ctrl, &g_spi0_cfg);
 
 
-             SEGGER_RTT_printf(0,"sem init %d \n",uxSemaphoreGetCount( bin_sem ));
+             THINKEY_DEBUG_DEBUG("sem init %d", (int)uxSemaphoreGetCount( bin_sem ));
             //THINKEY_DEBUG_INFO("SPI Init %d", result);
             if(result != FSP_SUCCESS) {
                 THINKEY_DEBUG_INFO("SPI Init failed %lu", result);
@@ -254,7 +248,7 @@ ptxStatus_t ptxPLAT_SPI_TRx(ptxPLAT_Spi_t *spi, uint8_t *txBuf[], size_t txLen[]
             result = R_SPI_WriteRead(&g_spi0_ctrl, tempWriteBuf, tempReadBuf, tempRxLen + tempTxLen, SPI_BIT_WIDTH_8_BITS);
 
             xSemaphoreTake(bin_sem,portMAX_DELAY);
-            SEGGER_RTT_printf(0,"sem val after take %d",(int)uxSemaphoreGetCount( bin_sem ));
+            THINKEY_DEBUG_DEBUG("sem val after take %d", (int)uxSemaphoreGetCount( bin_sem ));
           //  result = R_IOPORT_PinWrite(&g_ioport_ctrl, SPI_SS, BSP_IO_LEVEL_HIGH);
 
             if(result == FSP_SUCCESS) {
@@ -262,11 +256,9 @@ ptxStatus_t ptxPLAT_SPI_TRx(ptxPLAT_Spi_t *spi, uint8_t *txBuf[], size_t txLen[]
                // THINKEY_DEBUG_INFO("SPI Write-Read Success");
     #if PRINT_DATA
                 //THINKEY_DEBUG_INFO("Write data:");
-                SEGGER_RTT_printf(0,"write data\n");
-                printbuf(tempWriteBuf, tempTxLen);
+                THINKEY_DEBUG_DUMP("write data", tempWriteBuf, tempTxLen);
                 //THINKEY_DEBUG_INFO("Read data:");
-                SEGGER_RTT_printf(0,"Read data\n");
-                printbuf(&tempReadBuf[len], tempRxLen);
+                THINKEY_DEBUG_DUMP("Read data", &tempReadBuf[len], tempRxLen);
     #endif
                 for(i = 0; i < (int)numRxBuffers; i++) {
                     memcpy(rxBuf[i], &tempReadBuf[len], *rxLen[i]);
@@ -279,15 +271,14 @@ ptxStatus_t ptxPLAT_SPI_TRx(ptxPLAT_Spi_t *spi, uint8_t *txBuf[], size_t txLen[]
             for(i = 0; i < (int)numTxBuffers; i++){
     #if PRINT_DATA
                 //THINKEY_DEBUG_INFO("Going to write");
-                SEGGER_RTT_printf(0,"Going to write data\n");
-                printbuf(txBuf[i], txLen[i]);
+                THINKEY_DEBUG_DUMP("Going to write data", txBuf[i], txLen[i]);
     #endif
                // result  = nrf_drv_spi_transfer(&spi_t, txBuf[i], txLen[i], NULL, 0);
 
                 result = R_SPI_Write(&g_spi0_ctrl, txBuf[i], txLen[i], SPI_BIT_WIDTH_8_BITS);
-                SEGGER_RTT_printf(0,"sem val before take %d",(int)uxSemaphoreGetCount( bin_sem ));
+                THINKEY_DEBUG_DEBUG("sem val before take %d", (int)uxSemaphoreGetCount( bin_sem ));
                 xSemaphoreTake(bin_sem,portMAX_DELAY);
-                SEGGER_RTT_printf(0,"sem val after take %d",(int)uxSemaphoreGetCount( bin_sem ));
+                THINKEY_DEBUG_DEBUG("sem val after take %d", (int)uxSemaphoreGetCount( bin_sem ));
 
                 if(result == FSP_SUCCESS) {
                     //THINKEY_DEBUG_INFO("SPI write success");
@@ -370,7 +361,7 @@ ptxStatus_t ptxPLAT_SPI_TriggerRx(ptxPLAT_Spi_t *spi)
         //read_val = nrf_drv_gpiote_in_is_set(THINKEY_GPIO_INTR_PIN);
       //  read_val = R_BSP_PinRead(GPIO_INTR_PIN);
         read_val = R_BSP_PinRead (INTRQ);
-        SEGGER_RTT_printf(0, "\nValue of intr read val %d\n", read_val);
+        THINKEY_DEBUG_DEBUG("Value of intr read val %lu", read_val);
 
         if(1u == read_val){
            // THINKEY_DEBUG_INFO("There is something to read!");
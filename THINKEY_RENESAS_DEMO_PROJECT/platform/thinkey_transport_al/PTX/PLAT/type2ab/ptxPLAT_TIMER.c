@@ -45,6 +45,12 @@
  */
 ptxPlatTimer_t timer_ctx;
 
+/**
+ * The OS timer is created once and kept across Deinit, as its storage is static.
+ */
+THINKEY_OSAL_TIMER_STORAGE(ptx, gsPtxTimer);
+static THINKey_HANDLE hPtxTimer;
+
 /*
  * ####################################################################################################################
  * API FUNCTIONS
@@ -71,8 +77,11 @@ ptxStatus_t ptxPLAT_TIMER_GetInitializedTimer(ptxPlatTimer_t **timer)
          */
     	memset(&timer_ctx, 0, sizeof(ptxPlatTimer_t));
 
-        timer_ctx.TimerInstance = THINKey_OSAL_hCreateOneShotTimer(
-                Thinkey_Timer_Callback, NULL);
+        if(NULL == hPtxTimer) {
+            hPtxTimer = THINKey_OSAL_hCreateStaticOneShotTimer(
+                    Thinkey_Timer_Callback, NULL, &gsPtxTimer_sCb);
+        }
+        timer_ctx.TimerInstance = hPtxTimer;
 
         if(NULL == timer_ctx.TimerInstance) {
             status = PTX_STATUS(ptxStatus_Comp_PLAT, ptxStatus_InternalError);
@@ -157,7 +166,7 @@ ptxStatus_t ptxPLAT_TIMER_Deinit(ptxPlatTimer_t *timer)
 
     if (NULL != timer)
     {
-        THINKey_OSAL_eDestroyTimer(timer->TimerInstance);
+        THINKey_OSAL_eStopTimer(timer->TimerInstance);
 		memset(&timer_ctx, 0, sizeof(ptxPlatTimer_t));
     }
     else
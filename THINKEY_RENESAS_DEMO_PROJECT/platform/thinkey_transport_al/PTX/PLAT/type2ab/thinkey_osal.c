@@ -1,16 +1,24 @@
 
 
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_OSAL
+
 #include "thinkey_osal.h"
 #include "thinkey_debug.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
-#include "timers.h"
 #include "thinkey_platform_types.h"
+#include "thinkey_osal_timer.h"
+#include "hal_data.h"
 
 static THINKey_DEBUG_TAG TAG = "OSAL";
-#define PERIODIC_TIMER_NAME "Periodic Timer"
-#define ONE_SHOT_TIMER_NAME "One Shot Timer"
+
+#ifndef THINKEY_OSAL_TIMER_STACK_WORDS
+#define THINKEY_OSAL_TIMER_STACK_WORDS 512
+#endif
+#ifndef THINKEY_OSAL_MAX_TASK_STATS
+#define THINKEY_OSAL_MAX_TASK_STATS 16
+#endif
 
 /* OSAL Implementations */
 THINKey_eStatusType
@@ -34,17 +42,56 @@ THINKey_UINT32 uiStackSize,THINKey_UINT32* puiTaskID)
 	return eStatus;
 }
 
+#if !configSUPPORT_STATIC_ALLOCATION
+#error "the OSAL queues need configSUPPORT_STATIC_ALLOCATION"
+#endif
+
+/* Queues are created in a THINKey_OSAL_QueueCb_t, whose kernel part comes
+ * first: the handle is the address of both */
+#define TKEY_OSAL_QUEUE_STATS(hQHandle) \
+	(&((THINKey_OSAL_QueueCb_t *)(hQHandle))->sStats)
+
+/* Every queue, in creation order, linked through the control blocks */
+static THINKey_OSAL_QueueCb_t *gpsQueueFirst;
+static THINKey_OSAL_QueueCb_t *gpsQueueLast;
+
 THINKey_HANDLE THINKey_OSAL_hCreateQueue
 (THINKey_UINT32 uiNumQElements, THINKey_UINT32 uiQElementSize)
 {
-	THINKey_HANDLE hQHandle = THINKey_NULL;
+	THINKey_OSAL_QueueCb_t *psQueueCb;
+	THINKey_UINT32 uiStorageSize = uiNumQElements * uiQElementSize;
+	THINKey_HANDLE hQueue;
+
+	/* Control block and items in one allocation */
+	psQueueCb = pvPortMalloc(sizeof(THINKey_OSAL_QueueCb_t) + uiStorageSize);
+	if(psQueueCb == NULL)
+		return THINKey_NULL;
 
-	hQHandle = (THINKey_HANDLE)	xQueueCreate((size_t)uiNumQElements,
-			(size_t) uiQElementSize);
+	hQueue = THINKey_OSAL_hCreateStaticQueue(uiNumQElements, uiQElementSize,
+			(THINKey_BYTE *)(psQueueCb + 1), uiStorageSize, psQueueCb);
+	if(hQueue == THINKey_NULL)
+		vPortFree(psQueueCb);
 
-	return hQHandle;
+	return hQueue;
 }
 
+/* Counts a send; called in a critical section */
+static THINKey_eStatusType tkey_osal_queue_count
+(THINKey_HANDLE hQHandle, BaseType_t uiResult, UBaseType_t uxDepth)
+{
+	THINKey_OSAL_QueueStats_t *psStats = TKEY_OSAL_QUEUE_STATS(hQHandle);
+
+	if(uiResult != pdTRUE)
+	{
+		psStats->uiDropped++;
+		return E_THINKEY_FAILURE;
+	}
+	psStats->uiSent++;
+	if(uxDepth > psStats->uiMaxDepth)
+		psStats->uiMaxDepth = uxDepth;
+
+	return E_THINKEY_SUCCESS;
+}
 
 THINKey_eStatusType	THINKey_OSAL_eQueueReceive
 (THINKey_HANDLE hQHandle,THINKey_VOID* pvMessage)
@@ -84,16 +131,31 @@ THINKey_eStatusType	THINKey_OSAL_eTimedQueueReceive
 THINKey_eStatusType THINKey_OSAL_eQueueSend
 (THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage)
 {
-	THINKey_eStatusType eStatus = E_THINKEY_FAILURE;
+	/* Do not wait if no space is available in the queue.*/
+	return THINKey_OSAL_eQueueSendTimed(hQHandle, pvMessage,
+			THINKEY_OSAL_ZERO, E_THINKEY_OSAL_QUEUE_BACK);
+}
 
+THINKey_eStatusType THINKey_OSAL_eQueueSendTimed
+(THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
+THINKey_UINT32 uiTimeoutMs, THINKey_OSAL_eQueuePosType ePos)
+{
+	THINKey_eStatusType eStatus;
+	TickType_t xTicks = portMAX_DELAY;
 	BaseType_t uiResult;
 
-	/* Do not wait if no space is available in the queue.*/
-	uiResult = xQueueSend(hQHandle, (const void*) pvMessage,
-			THINKEY_OSAL_ZERO);
+	if(uiTimeoutMs != THINKEY_OSAL_FOREVER)
+		xTicks = pdMS_TO_TICKS(uiTimeoutMs);
 
-	if(uiResult == pdTRUE)
-		eStatus = E_THINKEY_SUCCESS;
+	uiResult = xQueueGenericSend((QueueHandle_t)hQHandle,
+			(const void*) pvMessage, xTicks,
+			(ePos == E_THINKEY_OSAL_QUEUE_FRONT) ? queueSEND_TO_FRONT :
+					queueSEND_TO_BACK);
+
+	taskENTER_CRITICAL();
+	eStatus = tkey_osal_queue_count(hQHandle, uiResult,
+			uxQueueMessagesWaiting((QueueHandle_t)hQHandle));
+	taskEXIT_CRITICAL();
 
 	return eStatus;
 }
@@ -103,50 +165,84 @@ THINKey_eStatusType THINKey_OSAL_eQueueSendToFromISR(
         THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
         THINKey_HANDLE hHigherPriorityTaskWoken)
 {
-	THINKey_eStatusType eStatus = E_THINKEY_SUCCESS;
+	/* To the back, not to overtake the messages of the tasks */
+	return THINKey_OSAL_eQueueSendFromISR(hQHandle, pvMessage,
+			E_THINKEY_OSAL_QUEUE_BACK, hHigherPriorityTaskWoken);
+}
 
-        xQueueSendToFrontFromISR(hQHandle, pvMessage,
-	            (BaseType_t*)hHigherPriorityTaskWoken);
-        return eStatus;
+THINKey_eStatusType THINKey_OSAL_eQueueSendFromISR(
+        THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
+        THINKey_OSAL_eQueuePosType ePos,
+        THINKey_HANDLE hHigherPriorityTaskWoken)
+{
+	THINKey_eStatusType eStatus;
+	UBaseType_t uxSavedMask;
+	BaseType_t uiResult;
+
+	uiResult = xQueueGenericSendFromISR((QueueHandle_t)hQHandle,
+			(const void*) pvMessage,
+			(BaseType_t*)hHigherPriorityTaskWoken,
+			(ePos == E_THINKEY_OSAL_QUEUE_FRONT) ? queueSEND_TO_FRONT :
+					queueSEND_TO_BACK);
+
+	uxSavedMask = taskENTER_CRITICAL_FROM_ISR();
+	eStatus = tkey_osal_queue_count(hQHandle, uiResult,
+			uxQueueMessagesWaitingFromISR((QueueHandle_t)hQHandle));
+	taskEXIT_CRITICAL_FROM_ISR(uxSavedMask);
+
+	return eStatus;
 }
 
-THINKey_eStatusType THINKey_OSAL_eMemCpy
-(THINKey_BYTE* pbTarget, const THINKey_BYTE* pbSource, THINKey_UINT32 uiSize)
+THINKey_VOID THINKey_OSAL_vQueueGetStats
+(THINKey_HANDLE hQHandle, THINKey_OSAL_QueueStats_t* psStats)
 {
-	TKey_UINT32 uiIndex;
-	/* This can be later replaced by MemCpy utility */
+	if((hQHandle == THINKey_NULL) || (psStats == NULL))
+		return;
 
-	if((pbTarget != NULL) && (pbSource != NULL))
-	{
-		for(uiIndex = 0; uiIndex < uiSize; uiIndex++)
-		{
-			pbTarget[uiIndex]= pbSource[uiIndex];
-		}
-	}
+	taskENTER_CRITICAL();
+	*psStats = *TKEY_OSAL_QUEUE_STATS(hQHandle);
+	psStats->uiDepth = uxQueueMessagesWaiting((QueueHandle_t)hQHandle);
+	taskEXIT_CRITICAL();
+}
 
-	return E_THINKEY_SUCCESS;
+THINKey_VOID THINKey_OSAL_vQueueSetName
+(THINKey_HANDLE hQHandle, THINKey_CONST_STRING strName)
+{
+	if(hQHandle == THINKey_NULL)
+		return;
+
+	((THINKey_OSAL_QueueCb_t *)hQHandle)->strName = strName;
+#if configQUEUE_REGISTRY_SIZE > 0
+	vQueueAddToRegistry((QueueHandle_t)hQHandle, strName);
+#endif
 }
 
-THINKey_BOOL THINKey_OSAL_eMemCmp
-(const THINKey_BYTE* pbMem1, const THINKey_BYTE* pbMem2, THINKey_UINT32 uiSize)
+THINKey_CONST_STRING THINKey_OSAL_strQueueGetName
+(THINKey_HANDLE hQHandle)
 {
-	THINKey_BOOL boReturn = THINKey_TRUE;
-	TKey_UINT32 uiIndex;
+	if(hQHandle == THINKey_NULL)
+		return THINKey_NULL;
 
-	if((pbMem1 != NULL) && (pbMem2 != NULL))
+	return ((THINKey_OSAL_QueueCb_t *)hQHandle)->strName;
+}
+
+THINKey_UINT32 THINKey_OSAL_uiQueueList
+(THINKey_HANDLE* phQueues, THINKey_UINT32 uiMaxQueues)
+{
+	THINKey_OSAL_QueueCb_t *psQueueCb;
+	THINKey_UINT32 uiCount = 0;
+
+	taskENTER_CRITICAL();
+	for(psQueueCb = gpsQueueFirst; psQueueCb != NULL;
+			psQueueCb = (THINKey_OSAL_QueueCb_t *)psQueueCb->pvNext)
 	{
-		/* This can be later replaced by MemCmp utility */
-		for(uiIndex = 0; uiIndex < uiSize; uiIndex++)
-		{
-			if(	pbMem1[uiIndex] != pbMem2[uiIndex] )
-			{
-				boReturn = THINKey_FALSE;
-				break;
-			}
-		}
+		if((phQueues != NULL) && (uiCount < uiMaxQueues))
+			phQueues[uiCount] = (THINKey_HANDLE)psQueueCb;
+		uiCount++;
 	}
+	taskEXIT_CRITICAL();
 
-	return boReturn;
+	return uiCount;
 }
 
 THINKey_VOID THINKey_OSAL_vOSStart(THINKey_VOID)
@@ -155,72 +251,200 @@ THINKey_VOID THINKey_OSAL_vOSStart(THINKey_VOID)
 	return;
 }
 
-THINKey_HANDLE THINKey_OSAL_hCreatePeriodicTimer
-(THINKey_pfnTimerCallback pfnTimerCallback, THINKey_HANDLE hCallerHandle)
+#if configSUPPORT_STATIC_ALLOCATION
+_Static_assert(sizeof(StaticTask_t) <= sizeof(THINKey_OSAL_TaskCb_t),
+		"THINKEY_OSAL_TASK_CB_WORDS too small");
+_Static_assert(sizeof(StaticQueue_t) <= sizeof(((THINKey_OSAL_QueueCb_t *)0)->apvCb),
+		"THINKEY_OSAL_QUEUE_CB_WORDS too small");
+_Static_assert(sizeof(StackType_t) == sizeof(THINKey_UINT32),
+		"task stacks are THINKey_UINT32 words");
+
+/* Kernel tasks, required by the static allocation support */
+THINKEY_OSAL_TASK_STORAGE(kernel, gsIdleTask, configMINIMAL_STACK_SIZE);
+THINKEY_OSAL_TASK_STORAGE(kernel, gsTimerTask, configTIMER_TASK_STACK_DEPTH);
+
+THINKey_eStatusType
+THINKey_OSAL_eCreateStaticTask
+(THINKey_CONST_STRING strTaskName, THINKey_pfnTaskFunction pfnTaskFunction,
+THINKey_VOID* pvTaskParams, THINKey_UINT32 uiTaskPriority,
+THINKey_UINT32 uiStackSize, THINKey_UINT32* puiStack,
+THINKey_OSAL_TaskCb_t* psTaskCb, THINKey_UINT32* puiTaskID)
 {
-	THINKey_HANDLE hTimerHandle;
-	THINKey_VOID   *pvTimerId = NULL;
-	(void)hCallerHandle;
+	TaskHandle_t hTask;
+
+	if((puiStack == NULL) || (psTaskCb == NULL))
+		return E_THINKEY_FAILURE;
+
+	hTask = xTaskCreateStatic(pfnTaskFunction,
+	                      strTaskName,
+						  uiStackSize,
+						  pvTaskParams,
+	                      uiTaskPriority,
+						  (StackType_t *)puiStack,
+						  (StaticTask_t *)psTaskCb);
+	if(hTask == NULL)
+		return E_THINKEY_FAILURE;
 
-	hTimerHandle = (THINKey_HANDLE) xTimerCreate(PERIODIC_TIMER_NAME,
-			pdMS_TO_TICKS(500), pdTRUE, pvTimerId,
-			(TimerCallbackFunction_t)pfnTimerCallback);
+	if(puiTaskID != NULL)
+		*(TaskHandle_t *)puiTaskID = hTask;
 
-	return ((THINKey_HANDLE)hTimerHandle);
+	return E_THINKEY_SUCCESS;
 }
 
-THINKey_HANDLE THINKey_OSAL_hCreateOneShotTimer
-(THINKey_pfnTimerCallback pfnTimerCallback, THINKey_HANDLE hCallerHandle)
+THINKey_HANDLE THINKey_OSAL_hCreateStaticQueue
+(THINKey_UINT32 uiNumQElements, THINKey_UINT32 uiQElementSize,
+THINKey_BYTE* pbStorage, THINKey_UINT32 uiStorageSize,
+THINKey_OSAL_QueueCb_t* psQueueCb)
 {
-	THINKey_HANDLE hTimerHandle;
-	THINKey_VOID   *pvTimerId = NULL;
-		(void)hCallerHandle;
+	if((pbStorage == NULL) || (psQueueCb == NULL) ||
+	   (uiNumQElements * uiQElementSize > uiStorageSize))
+		return THINKey_NULL;
+
+	psQueueCb->sStats.uiSent = 0;
+	psQueueCb->sStats.uiDropped = 0;
+	psQueueCb->sStats.uiMaxDepth = 0;
+	psQueueCb->sStats.uiDepth = 0;
+	psQueueCb->strName = THINKey_NULL;
+	psQueueCb->pvNext = NULL;
+	if(xQueueCreateStatic((UBaseType_t)uiNumQElements,
+			(UBaseType_t)uiQElementSize, (uint8_t *)pbStorage,
+			(StaticQueue_t *)psQueueCb) == NULL)
+		return THINKey_NULL;
+
+	taskENTER_CRITICAL();
+	if(gpsQueueLast != NULL)
+		gpsQueueLast->pvNext = psQueueCb;
+	else
+		gpsQueueFirst = psQueueCb;
+	gpsQueueLast = psQueueCb;
+	taskEXIT_CRITICAL();
+
+	return (THINKey_HANDLE)psQueueCb;
+}
 
-		hTimerHandle = (THINKey_HANDLE) xTimerCreate(PERIODIC_TIMER_NAME,
-				pdMS_TO_TICKS(500), pdFALSE, pvTimerId,
-				(TimerCallbackFunction_t)pfnTimerCallback);
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+		StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize)
+{
+	*ppxIdleTaskTCBBuffer = (StaticTask_t *)&gsIdleTask_sCb;
+	*ppxIdleTaskStackBuffer = (StackType_t *)gsIdleTask_auiStack;
+	*pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
 
-	return ((THINKey_HANDLE)hTimerHandle);
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+		StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize)
+{
+	*ppxTimerTaskTCBBuffer = (StaticTask_t *)&gsTimerTask_sCb;
+	*ppxTimerTaskStackBuffer = (StackType_t *)gsTimerTask_auiStack;
+	*pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
 }
+#endif /* configSUPPORT_STATIC_ALLOCATION */
+
+/* Timer service port, see thinkey_osal_timer.c */
+THINKEY_OSAL_TASK_STORAGE(osal, gsTimerService, THINKEY_OSAL_TIMER_STACK_WORDS);
+static TaskHandle_t ghTimerService;
 
-THINKey_eStatusType THINKey_OSAL_eStartTimer
-(THINKey_HANDLE hTimerHandle, THINKey_UINT32 uiTimeInMilliSeconds)
+static THINKey_VOID tkey_osal_timer_service(THINKey_VOID *pvParams)
 {
-	THINKey_eStatusType eStatus = E_THINKEY_SUCCESS;
-	BaseType_t uiResult;
+	THINKey_UINT32 uiWait;
+	(void)pvParams;
 
-	uiResult = xTimerChangePeriod(hTimerHandle, pdMS_TO_TICKS(uiTimeInMilliSeconds), pdMS_TO_TICKS(0));
+	for(;;)
+	{
+		uiWait = THINKey_OSAL_uiTimerService(THINKey_OSAL_uiTimerPortNow());
+		(void)ulTaskNotifyTake(pdTRUE, (uiWait == THINKEY_OSAL_FOREVER) ?
+				portMAX_DELAY : pdMS_TO_TICKS(uiWait));
+	}
+}
 
-	if(uiResult == pdPASS)
-		eStatus = E_THINKEY_SUCCESS;
+THINKey_UINT32 THINKey_OSAL_uiTimerPortNow(THINKey_VOID)
+{
+	return (THINKey_UINT32)xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
 
-	return eStatus;
+THINKey_eStatusType THINKey_OSAL_eTimerPortStart(THINKey_VOID)
+{
+	return THINKEY_OSAL_CREATE_STATIC_TASK(gsTimerService, "OSAL Timers",
+			tkey_osal_timer_service, THINKey_NULL, configTIMER_TASK_PRIORITY,
+			(THINKey_UINT32 *)&ghTimerService);
 }
 
-THINKey_eStatusType THINKey_OSAL_eStopTimer (THINKey_HANDLE hTimerHandle)
+THINKey_VOID THINKey_OSAL_vTimerPortWake(THINKey_VOID)
 {
-	THINKey_eStatusType eStatus = E_THINKEY_SUCCESS;
-	BaseType_t uiResult;
+	if(ghTimerService != NULL)
+		xTaskNotifyGive(ghTimerService);
+}
 
-	uiResult = xTimerStop(hTimerHandle, pdMS_TO_TICKS(0));
+/* Task statistics */
+#if (configUSE_TRACE_FACILITY != 1) || (configGENERATE_RUN_TIME_STATS != 1)
+#error "the OSAL task statistics need configUSE_TRACE_FACILITY and configGENERATE_RUN_TIME_STATS"
+#endif
 
-	if(uiResult == pdPASS)
-		eStatus = E_THINKEY_SUCCESS;
+static TaskStatus_t gasTaskStatus[THINKEY_OSAL_MAX_TASK_STATS];
 
-	return eStatus;
+THINKey_UINT32 THINKey_OSAL_uiTaskGetStats
+(THINKey_OSAL_TaskStats_t* pasStats, THINKey_UINT32 uiMaxTasks,
+		THINKey_UINT32* puiRunTime)
+{
+	configRUN_TIME_COUNTER_TYPE uiRunTime = 0;
+	UBaseType_t uxCount;
+	UBaseType_t uxIndex;
+
+	if(pasStats == NULL)
+		return 0;
+
+	/* Also keeps other callers out of gasTaskStatus */
+	vTaskSuspendAll();
+	uxCount = uxTaskGetSystemState(gasTaskStatus, THINKEY_OSAL_MAX_TASK_STATS,
+			&uiRunTime);
+	if(uxCount > uiMaxTasks)
+		uxCount = uiMaxTasks;
+	for(uxIndex = 0; uxIndex < uxCount; uxIndex++)
+	{
+		pasStats[uxIndex].strName = gasTaskStatus[uxIndex].pcTaskName;
+		pasStats[uxIndex].uiTaskNumber = gasTaskStatus[uxIndex].xTaskNumber;
+		pasStats[uxIndex].uiPriority = gasTaskStatus[uxIndex].uxCurrentPriority;
+		pasStats[uxIndex].uiRunTime = gasTaskStatus[uxIndex].ulRunTimeCounter;
+		pasStats[uxIndex].uiStackFreeMin = gasTaskStatus[uxIndex].usStackHighWaterMark;
+	}
+	(void)xTaskResumeAll();
+
+	if(puiRunTime != NULL)
+		*puiRunTime = uiRunTime;
+
+	return uxCount;
 }
 
-THINKey_eStatusType THINKey_OSAL_eDestroyTimer (THINKey_HANDLE hTimerHandle)
+static THINKey_UINT32 guiRunTimeHz;
+
+/* portCONFIGURE_TIMER_FOR_RUN_TIME_STATS, from vTaskStartScheduler(). The
+ * counter is g_run_time_counter of the configurator, GPT channel 1 free
+ * running over 32 bits at PCLKD with no interrupt. */
+THINKey_VOID THINKey_OSAL_vRunTimeCounterInit(THINKey_VOID)
 {
-	THINKey_eStatusType eStatus = E_THINKEY_SUCCESS;
-	BaseType_t uiResult;
+	timer_info_t sInfo;
 
-	uiResult = xTimerDelete(hTimerHandle, pdMS_TO_TICKS(0));
+	if(FSP_SUCCESS != R_GPT_Open(&g_run_time_counter_ctrl, &g_run_time_counter_cfg))
+	{
+		THINKEY_DEBUG_ERROR("\r\n %s run time counter not started", TAG);
+		return;
+	}
+	if(FSP_SUCCESS == R_GPT_InfoGet(&g_run_time_counter_ctrl, &sInfo))
+		guiRunTimeHz = sInfo.clock_frequency;
+	(void)R_GPT_Start(&g_run_time_counter_ctrl);
+}
 
-	if(uiResult == pdPASS)
-		eStatus = E_THINKEY_SUCCESS;
+/* portGET_RUN_TIME_COUNTER_VALUE, on every context switch */
+THINKey_UINT32 THINKey_OSAL_uiRunTimeCounter(THINKey_VOID)
+{
+	if(g_run_time_counter_ctrl.p_reg == NULL)
+		return 0;
 
-	return eStatus;
+	return g_run_time_counter_ctrl.p_reg->GTCNT;
+}
+
+THINKey_UINT32 THINKey_OSAL_uiRunTimeCounterHz(THINKey_VOID)
+{
+	return guiRunTimeHz;
 }
 
 TKey_VOID THINKey_OSAL_Delay(TKey_UINT32 uiDelayMs)
@@ -229,9 +453,21 @@ TKey_VOID THINKey_OSAL_Delay(TKey_UINT32 uiDelayMs)
 	vTaskDelay(xDelay);
 }
 
-__attribute__((weak)) void  vApplicationStackOverflowHook(void) {
+TKey_VOID THINKey_OSAL_vEnterCritical(TKey_VOID)
+{
+	taskENTER_CRITICAL();
+}
+
+TKey_VOID THINKey_OSAL_vExitCritical(TKey_VOID)
+{
+	taskEXIT_CRITICAL();
+}
+
+__attribute__((weak)) void  vApplicationStackOverflowHook(TaskHandle_t xTask,
+		char *pcTaskName) {
 /* Print something so that we know */
-	THINKEY_DEBUG_ERROR("\r\n %s Stack Overflow!!!", TAG);
+	(void)xTask;
+	THINKEY_DEBUG_ERROR("\r\n %s Stack Overflow in %s!!!", TAG, pcTaskName);
 }
 
 __attribute__((weak)) void vApplicationMallocFailedHook(void) {
@@ -0,0 +1,139 @@
+/*
+ * \file thinkey_osal_bufpool.c
+ *
+ * \brief OSAL fixed block buffer pools
+ *
+ * For the messages too large to be copied through a queue: only their
+ * THINKey_OSAL_BufDesc_t is. Free blocks are linked through their first
+ * word, so taking or freeing one is a couple of stores in a critical
+ * section. Built on the OSAL only, for the target and the host alike.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_osal.h"
+#include <stdint.h>
+
+THINKey_eStatusType THINKey_OSAL_eBufPoolInit
+(THINKey_OSAL_BufPool_t* psPool, THINKey_BYTE* pbStorage,
+THINKey_UINT32 uiStorageSize, THINKey_UINT32 uiBlockSize)
+{
+	THINKey_UINT32 uiBlocks;
+	THINKey_UINT32 uiIndex;
+
+	if((psPool == THINKey_NULL) || (pbStorage == THINKey_NULL) ||
+	   (((uintptr_t)pbStorage & 7u) != 0) || (uiBlockSize == 0))
+		return E_THINKEY_FAILURE;
+
+	uiBlockSize = (uiBlockSize + 7u) & ~7u;
+	uiBlocks = uiStorageSize / uiBlockSize;
+	if(uiBlocks == 0)
+		return E_THINKEY_FAILURE;
+
+	psPool->pbStorage = pbStorage;
+	psPool->uiStorageSize = uiBlocks * uiBlockSize;
+	psPool->uiBlockSize = uiBlockSize;
+	psPool->pvFreeList = THINKey_NULL;
+	/* Linked from the last block so the first one is taken first */
+	for(uiIndex = uiBlocks; uiIndex > 0; uiIndex--)
+	{
+		THINKey_VOID **ppvBlock =
+				(THINKey_VOID **)(THINKey_VOID *)(pbStorage + (uiIndex - 1) * uiBlockSize);
+		*ppvBlock = psPool->pvFreeList;
+		psPool->pvFreeList = ppvBlock;
+	}
+	psPool->sStats.uiBlocks = uiBlocks;
+	psPool->sStats.uiFree = uiBlocks;
+	psPool->sStats.uiMinFree = uiBlocks;
+	psPool->sStats.uiAllocFails = 0;
+
+	return E_THINKEY_SUCCESS;
+}
+
+THINKey_eStatusType THINKey_OSAL_eBufAlloc
+(THINKey_OSAL_BufPool_t* psPool, THINKey_OSAL_BufDesc_t* psDesc)
+{
+	THINKey_VOID **ppvBlock;
+
+	if((psPool == THINKey_NULL) || (psDesc == THINKey_NULL))
+		return E_THINKEY_FAILURE;
+
+	THINKey_OSAL_vEnterCritical();
+	ppvBlock = (THINKey_VOID **)psPool->pvFreeList;
+	if(ppvBlock != THINKey_NULL)
+	{
+		psPool->pvFreeList = *ppvBlock;
+		psPool->sStats.uiFree--;
+		if(psPool->sStats.uiFree < psPool->sStats.uiMinFree)
+			psPool->sStats.uiMinFree = psPool->sStats.uiFree;
+	}
+	else
+	{
+		psPool->sStats.uiAllocFails++;
+	}
+	THINKey_OSAL_vExitCritical();
+
+	if(ppvBlock == THINKey_NULL)
+		return E_THINKEY_FAILURE;
+
+	psDesc->pbData = (THINKey_BYTE *)ppvBlock;
+	psDesc->uiLength = 0;
+	psDesc->psPool = psPool;
+
+	return E_THINKEY_SUCCESS;
+}
+
+THINKey_VOID THINKey_OSAL_vBufFree(THINKey_OSAL_BufDesc_t* psDesc)
+{
+	THINKey_OSAL_BufPool_t *psPool;
+	THINKey_UINT32 uiOffset;
+
+	if((psDesc == THINKey_NULL) || (psDesc->psPool == THINKey_NULL))
+		return;
+
+	/* Only blocks of the pool go back to it */
+	psPool = psDesc->psPool;
+	uiOffset = (THINKey_UINT32)(psDesc->pbData - psPool->pbStorage);
+	if((psDesc->pbData < psPool->pbStorage) ||
+	   (uiOffset >= psPool->uiStorageSize) ||
+	   ((uiOffset % psPool->uiBlockSize) != 0))
+		return;
+
+	THINKey_OSAL_vEnterCritical();
+	*(THINKey_VOID **)(THINKey_VOID *)psDesc->pbData = psPool->pvFreeList;
+	psPool->pvFreeList = psDesc->pbData;
+	psPool->sStats.uiFree++;
+	THINKey_OSAL_vExitCritical();
+
+	psDesc->pbData = THINKey_NULL;
+	psDesc->psPool = THINKey_NULL;
+}
+
+THINKey_eStatusType THINKey_OSAL_eQueueSendBuf
+(THINKey_HANDLE hQHandle, THINKey_OSAL_BufDesc_t* psDesc,
+THINKey_UINT32 uiTimeoutMs)
+{
+	THINKey_eStatusType eStatus;
+
+	if(psDesc == THINKey_NULL)
+		return E_THINKEY_FAILURE;
+
+	eStatus = THINKey_OSAL_eQueueSendTimed(hQHandle, psDesc, uiTimeoutMs,
+			E_THINKEY_OSAL_QUEUE_BACK);
+	if(eStatus != E_THINKEY_SUCCESS)
+		THINKey_OSAL_vBufFree(psDesc);
+
+	return eStatus;
+}
+
+THINKey_VOID THINKey_OSAL_vBufPoolGetStats
+(THINKey_OSAL_BufPool_t* psPool, THINKey_OSAL_BufPoolStats_t* psStats)
+{
+	if((psPool == THINKey_NULL) || (psStats == THINKey_NULL))
+		return;
+
+	THINKey_OSAL_vEnterCritical();
+	*psStats = psPool->sStats;
+	THINKey_OSAL_vExitCritical();
+}
@@ -0,0 +1,115 @@
+/*
+ * \file thinkey_osal_mem.c
+ *
+ * \brief OSAL memory copy and compare
+ *
+ * Kept apart from thinkey_osal.c as it does not depend on the RTOS. The
+ * copy aligns the destination and then moves 32-bit words, reading the
+ * source through unaligned loads, which the Cortex-M33 (and the host) do
+ * in hardware; LDM/STM are never generated for them.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_osal.h"
+#include <stdint.h>
+
+typedef TKey_UINT32 __attribute__((may_alias)) tkey_osal_word_t;
+
+typedef struct __attribute__((packed, may_alias))
+{
+    TKey_UINT32 uiWord;
+} tkey_osal_uword_t;
+
+#define TKEY_OSAL_LOADU(pb) (((const tkey_osal_uword_t*)(const TKey_VOID*)(pb))->uiWord)
+
+THINKey_eStatusType THINKey_OSAL_eMemCpy
+(THINKey_BYTE* pbTarget, const THINKey_BYTE* pbSource, THINKey_UINT32 uiSize)
+{
+	tkey_osal_word_t *puiTarget;
+
+	if((pbTarget == THINKey_NULL) || (pbSource == THINKey_NULL))
+		return E_THINKEY_SUCCESS;
+
+	/* Short copies are not worth aligning */
+	if(uiSize >= 8)
+	{
+		while(((TKey_UINT32)(uintptr_t)pbTarget & 3u) != 0)
+		{
+			*pbTarget++ = *pbSource++;
+			uiSize--;
+		}
+		puiTarget = (tkey_osal_word_t*)(TKey_VOID*)pbTarget;
+		while(uiSize >= 16)
+		{
+			puiTarget[0] = TKEY_OSAL_LOADU(pbSource);
+			puiTarget[1] = TKEY_OSAL_LOADU(pbSource + 4);
+			puiTarget[2] = TKEY_OSAL_LOADU(pbSource + 8);
+			puiTarget[3] = TKEY_OSAL_LOADU(pbSource + 12);
+			puiTarget += 4;
+			pbSource += 16;
+			uiSize -= 16;
+		}
+		while(uiSize >= 4)
+		{
+			*puiTarget++ = TKEY_OSAL_LOADU(pbSource);
+			pbSource += 4;
+			uiSize -= 4;
+		}
+		pbTarget = (THINKey_BYTE*)puiTarget;
+	}
+	while(uiSize-- > 0)
+	{
+		*pbTarget++ = *pbSource++;
+	}
+
+	return E_THINKEY_SUCCESS;
+}
+
+THINKey_BOOL THINKey_OSAL_eMemCmp
+(const THINKey_BYTE* pbMem1, const THINKey_BYTE* pbMem2, THINKey_UINT32 uiSize)
+{
+	TKey_UINT32 uiIndex = 0;
+
+	if((pbMem1 == THINKey_NULL) || (pbMem2 == THINKey_NULL))
+		return THINKey_TRUE;
+
+	/* Stops at the first difference: only for data that is not secret */
+	for(; uiIndex + 4 <= uiSize; uiIndex += 4)
+	{
+		if(TKEY_OSAL_LOADU(pbMem1 + uiIndex) != TKEY_OSAL_LOADU(pbMem2 + uiIndex))
+			return THINKey_FALSE;
+	}
+	for(; uiIndex < uiSize; uiIndex++)
+	{
+		if(pbMem1[uiIndex] != pbMem2[uiIndex])
+			return THINKey_FALSE;
+	}
+
+	return THINKey_TRUE;
+}
+
+THINKey_BOOL THINKey_OSAL_bMemCmpConstTime
+(const THINKey_BYTE* pbMem1, const THINKey_BYTE* pbMem2, THINKey_UINT32 uiSize)
+{
+	TKey_UINT32 uiDiff = 0;
+	TKey_UINT32 uiIndex = 0;
+
+	if((pbMem1 == THINKey_NULL) || (pbMem2 == THINKey_NULL))
+		return THINKey_FALSE;
+
+	/* Every byte is looked at whatever the contents; the only branches
+	 * depend on the length */
+	for(; uiIndex + 4 <= uiSize; uiIndex += 4)
+	{
+		uiDiff |= TKEY_OSAL_LOADU(pbMem1 + uiIndex) ^ TKEY_OSAL_LOADU(pbMem2 + uiIndex);
+	}
+	for(; uiIndex < uiSize; uiIndex++)
+	{
+		uiDiff |= (TKey_UINT32)(pbMem1[uiIndex] ^ pbMem2[uiIndex]);
+	}
+
+	/* 1 when uiDiff is 0, without a data dependent branch */
+	return (THINKey_BOOL)(((uiDiff | (0u - uiDiff)) >> 31) ^ 1u);
+}
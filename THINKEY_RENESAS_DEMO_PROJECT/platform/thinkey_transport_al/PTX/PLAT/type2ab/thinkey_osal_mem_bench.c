@@ -0,0 +1,213 @@
+/*
+ * \file thinkey_osal_mem_bench.c
+ *
+ * \brief OSAL memory copy/compare micro-benchmark
+ *
+ * On the target call TKey_OsalMemBench_Report() from a task; on a Linux
+ * host build with THINKEY_HOST_BUILD and THINKEY_OSAL_MEM_BENCH_MAIN it is
+ * a standalone program, built and run by the host osal_mem_bench ctest.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_osal_mem_bench.h"
+#include "thinkey_osal.h"
+#include <string.h>
+
+#if defined(THINKEY_OSAL_MEM_BENCH_MAIN)
+#include <stdio.h>
+#include <stdlib.h>
+#endif
+
+#define TKEY_OSAL_MEM_BENCH_MAX_SIZE 1024
+
+#define TKEY_OSAL_MEM_BENCH_SIZES(X) X(1) X(4) X(16) X(64) X(256) X(1024)
+
+typedef struct
+{
+    TKey_UINT32 uiSize;
+    const TKey_CHAR *apcName[7];
+} TKey_OsalMemBenchSize_t;
+
+#define TKEY_OSAL_MEM_BENCH_NAMES(n) { n, { \
+    "copy_byte_" #n, "copy_word_" #n, "copy_word_unaligned_" #n, \
+    "cmp_equal_" #n, "cmp_diff0_" #n, "cmp_ct_equal_" #n, "cmp_ct_diff0_" #n } },
+
+static const TKey_OsalMemBenchSize_t gasBenchSizes[] = {
+    TKEY_OSAL_MEM_BENCH_SIZES(TKEY_OSAL_MEM_BENCH_NAMES)
+};
+
+/* One spare byte in front for the misaligned source */
+static TKey_UINT32 gauiBenchSrc[(TKEY_OSAL_MEM_BENCH_MAX_SIZE + 4) / 4];
+static TKey_UINT32 gauiBenchDst[(TKEY_OSAL_MEM_BENCH_MAX_SIZE + 4) / 4];
+static TKey_UINT32 gauiBenchCmp[(TKEY_OSAL_MEM_BENCH_MAX_SIZE + 4) / 4];
+static volatile TKey_UINT32 guiBenchSink;
+
+typedef enum
+{
+    E_TKEY_OSAL_MEM_BENCH_COPY_BYTE,
+    E_TKEY_OSAL_MEM_BENCH_COPY_WORD,
+    E_TKEY_OSAL_MEM_BENCH_COPY_UNALIGNED,
+    E_TKEY_OSAL_MEM_BENCH_CMP_EQUAL,
+    E_TKEY_OSAL_MEM_BENCH_CMP_DIFF0,
+    E_TKEY_OSAL_MEM_BENCH_CMP_CT_EQUAL,
+    E_TKEY_OSAL_MEM_BENCH_CMP_CT_DIFF0
+} TKey_OsalMemBenchCase_t;
+
+/* The copy loop THINKey_OSAL_eMemCpy used to have; kept out of line and
+ * away from the compiler turning it back into a memcpy call */
+static __attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+TKey_VOID tkey_osal_mem_bench_copy_bytes(TKey_BYTE *pbTarget,
+        const TKey_BYTE *pbSource, TKey_UINT32 uiSize)
+{
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < uiSize; uiIndex++) {
+        pbTarget[uiIndex] = pbSource[uiIndex];
+    }
+}
+
+static TKey_INT32 tkey_osal_mem_bench_call(TKey_OsalMemBenchCase_t eCase,
+        TKey_UINT32 uiSize)
+{
+    TKey_BYTE *pbSrc = (TKey_BYTE*)gauiBenchSrc;
+    TKey_BYTE *pbDst = (TKey_BYTE*)gauiBenchDst;
+    TKey_BYTE *pbCmp = (TKey_BYTE*)gauiBenchCmp;
+    TKey_BOOL bEqual;
+
+    switch(eCase) {
+    case E_TKEY_OSAL_MEM_BENCH_COPY_BYTE:
+        tkey_osal_mem_bench_copy_bytes(pbDst, pbSrc, uiSize);
+        return 0;
+    case E_TKEY_OSAL_MEM_BENCH_COPY_WORD:
+        return (E_THINKEY_SUCCESS == THINKey_OSAL_eMemCpy(pbDst, pbSrc, uiSize)) ? 0 : 1;
+    case E_TKEY_OSAL_MEM_BENCH_COPY_UNALIGNED:
+        return (E_THINKEY_SUCCESS == THINKey_OSAL_eMemCpy(pbDst, pbSrc + 1, uiSize)) ? 0 : 1;
+    case E_TKEY_OSAL_MEM_BENCH_CMP_EQUAL:
+        bEqual = THINKey_OSAL_eMemCmp(pbSrc, pbCmp, uiSize);
+        return bEqual ? 0 : 1;
+    case E_TKEY_OSAL_MEM_BENCH_CMP_DIFF0:
+        bEqual = THINKey_OSAL_eMemCmp(pbSrc, pbDst, uiSize);
+        return bEqual ? 1 : 0;
+    case E_TKEY_OSAL_MEM_BENCH_CMP_CT_EQUAL:
+        bEqual = THINKey_OSAL_bMemCmpConstTime(pbSrc, pbCmp, uiSize);
+        return bEqual ? 0 : 1;
+    default:
+        bEqual = THINKey_OSAL_bMemCmpConstTime(pbSrc, pbDst, uiSize);
+        return bEqual ? 1 : 0;
+    }
+}
+
+/* Checks the copy of the last case, when there is one */
+static TKey_INT32 tkey_osal_mem_bench_check(TKey_OsalMemBenchCase_t eCase,
+        TKey_UINT32 uiSize)
+{
+    const TKey_BYTE *pbSrc = (const TKey_BYTE*)gauiBenchSrc;
+
+    if(E_TKEY_OSAL_MEM_BENCH_COPY_UNALIGNED == eCase) {
+        pbSrc++;
+    } else if(E_TKEY_OSAL_MEM_BENCH_CMP_EQUAL <= eCase) {
+        return 0;
+    }
+    return (0 == memcmp(gauiBenchDst, pbSrc, uiSize)) ? 0 : 1;
+}
+
+TKey_UINT32 TKey_OsalMemBench_Run(TKey_BenchResult_t *psResults,
+                                  TKey_UINT32 uiMaxResults,
+                                  TKey_UINT32 uiIterations)
+{
+    TKey_BenchResult_t *psRes;
+    TKey_UINT64 ullStart;
+    TKey_UINT32 uiSize;
+    TKey_UINT32 uiCount = 0;
+    TKey_UINT32 uiSizeIndex;
+    TKey_UINT32 uiCase;
+    TKey_UINT32 uiIter;
+    TKey_UINT32 uiCall;
+    TKey_INT32 iStatus;
+
+    if(0 == uiIterations) {
+        uiIterations = TKEY_OSAL_MEM_BENCH_ITERATIONS;
+    }
+    TKey_Bench_TimerInit();
+    for(uiIter = 0; uiIter < sizeof(gauiBenchSrc); uiIter++) {
+        ((TKey_BYTE*)gauiBenchSrc)[uiIter] = (TKey_BYTE)(uiIter * 7 + 1);
+    }
+    memcpy(gauiBenchCmp, gauiBenchSrc, sizeof(gauiBenchCmp));
+
+    for(uiSizeIndex = 0;
+        uiSizeIndex < sizeof(gasBenchSizes) / sizeof(gasBenchSizes[0]);
+        uiSizeIndex++) {
+        uiSize = gasBenchSizes[uiSizeIndex].uiSize;
+        for(uiCase = E_TKEY_OSAL_MEM_BENCH_COPY_BYTE;
+            uiCase <= E_TKEY_OSAL_MEM_BENCH_CMP_CT_DIFF0; uiCase++) {
+            if(uiCount >= uiMaxResults) {
+                return uiCount;
+            }
+            psRes = &psResults[uiCount++];
+            memset(psRes, 0, sizeof(TKey_BenchResult_t));
+            psRes->pcSuite = "osal_mem";
+            psRes->pcName = gasBenchSizes[uiSizeIndex].apcName[uiCase];
+            psRes->uiBytes = uiSize * TKEY_OSAL_MEM_BENCH_BATCH;
+
+            /* The compare cases against gauiBenchDst differ in byte 0 */
+            memset(gauiBenchDst, 0, sizeof(gauiBenchDst));
+            iStatus = 0;
+            for(uiIter = 0; uiIter < uiIterations; uiIter++) {
+                ullStart = TKey_Bench_Now();
+                for(uiCall = 0; uiCall < TKEY_OSAL_MEM_BENCH_BATCH; uiCall++) {
+                    iStatus |= tkey_osal_mem_bench_call(
+                                   (TKey_OsalMemBenchCase_t)uiCase, uiSize);
+                }
+                TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+                if(E_TKEY_OSAL_MEM_BENCH_CMP_EQUAL > uiCase) {
+                    iStatus |= tkey_osal_mem_bench_check(
+                                   (TKey_OsalMemBenchCase_t)uiCase, uiSize);
+                    memset(gauiBenchDst, 0, sizeof(gauiBenchDst));
+                }
+            }
+            guiBenchSink += gauiBenchDst[0];
+            psRes->iStatus = iStatus;
+        }
+    }
+    return uiCount;
+}
+
+TKey_INT32 TKey_OsalMemBench_Report(TKey_BenchPrint_t pfnPrint,
+                                    TKey_UINT32 uiIterations)
+{
+    static TKey_BenchResult_t sasResults[TKEY_OSAL_MEM_BENCH_MAX_RESULTS];
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_INT32 iFailed = 0;
+
+    uiCount = TKey_OsalMemBench_Run(sasResults, TKEY_OSAL_MEM_BENCH_MAX_RESULTS,
+                                    uiIterations);
+    TKey_Bench_PrintHeader(pfnPrint);
+    TKey_Bench_PrintResults(pfnPrint, sasResults, uiCount);
+    for(uiIndex = 0; uiIndex < uiCount; uiIndex++) {
+        if(0 != sasResults[uiIndex].iStatus) {
+            iFailed++;
+        }
+    }
+    return iFailed;
+}
+
+#if defined(THINKEY_OSAL_MEM_BENCH_MAIN)
+static TKey_VOID tkey_osal_mem_bench_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiIterations = 0;
+
+    if(argc > 1) {
+        uiIterations = (TKey_UINT32)strtoul(argv[1], TKey_NULL, 0);
+    }
+    return (0 == TKey_OsalMemBench_Report(tkey_osal_mem_bench_print,
+                                          uiIterations)) ? 0 : 1;
+}
+#endif /* THINKEY_OSAL_MEM_BENCH_MAIN */
@@ -0,0 +1,49 @@
+/*
+ * \file thinkey_osal_mem_bench.h
+ *
+ * \brief Header file for the OSAL memory copy/compare micro-benchmark
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_OSAL_MEM_BENCH_H
+#define THINKEY_OSAL_MEM_BENCH_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+/**
+ *  @brief Number of result rows produced by one benchmark run: seven
+ *         cases for each of the six sizes from 1 to 1024 bytes
+ */
+#define TKEY_OSAL_MEM_BENCH_MAX_RESULTS 42
+
+/**
+ *  @brief Default iteration count. Each iteration times
+ *         TKEY_OSAL_MEM_BENCH_BATCH calls, as one short copy is below the
+ *         timer resolution on the host.
+ */
+#ifndef TKEY_OSAL_MEM_BENCH_ITERATIONS
+#define TKEY_OSAL_MEM_BENCH_ITERATIONS 200
+#endif
+#define TKEY_OSAL_MEM_BENCH_BATCH 32
+
+/**
+ * \brief   Times the byte loop the OSAL used to copy with against
+ *          THINKey_OSAL_eMemCpy, aligned and misaligned, and the early exit
+ *          compare against THINKey_OSAL_bMemCmpConstTime on equal buffers
+ *          and on buffers differing in the first byte. A case fails when
+ *          the result is wrong. Returns the number of results written.
+ */
+TKey_UINT32 TKey_OsalMemBench_Run(TKey_BenchResult_t *psResults,
+                                  TKey_UINT32 uiMaxResults,
+                                  TKey_UINT32 uiIterations);
+
+/**
+ * \brief   Runs the suite and emits the CSV table through pfnPrint.
+ *          Returns 0 when every case succeeded.
+ */
+TKey_INT32 TKey_OsalMemBench_Report(TKey_BenchPrint_t pfnPrint,
+                                    TKey_UINT32 uiIterations);
+
+#endif /* THINKEY_OSAL_MEM_BENCH_H */
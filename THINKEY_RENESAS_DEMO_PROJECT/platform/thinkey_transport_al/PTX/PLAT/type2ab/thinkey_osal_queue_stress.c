@@ -0,0 +1,499 @@
+/*
+ * \file thinkey_osal_queue_stress.c
+ *
+ * \brief OSAL queue producer burst stress test
+ *
+ * Producer tasks send numbered messages to one consumer task, which checks
+ * the order per producer. The tasks are created once and wait for each
+ * case on their start queues, as tasks must not return on the target.
+ *
+ * On the target call TKey_OsalQueueStress_Report() from a task; on a Linux
+ * host build with THINKEY_HOST_BUILD and THINKEY_OSAL_QUEUE_STRESS_MAIN,
+ * linked with the host OSAL, to get a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_osal_queue_stress.h"
+#include "thinkey_osal.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(THINKEY_OSAL_QUEUE_STRESS_MAIN)
+#include <stdlib.h>
+#endif
+
+#define TKEY_OSAL_QUEUE_STRESS_END 0xFFFFFFFFu
+#define TKEY_OSAL_QUEUE_STRESS_STACK 512
+#define TKEY_OSAL_QUEUE_STRESS_PRIORITY 2
+#define TKEY_OSAL_QUEUE_STRESS_BURST 32       /* producers sleep 1 ms after each */
+#define TKEY_OSAL_QUEUE_STRESS_SLOW_EVERY 16  /* consumer sleeps 1 ms each */
+
+/* Failure bits */
+#define TKEY_OSAL_QUEUE_STRESS_ORDER 0x01
+#define TKEY_OSAL_QUEUE_STRESS_COUNT 0x02
+#define TKEY_OSAL_QUEUE_STRESS_STATS 0x04
+#define TKEY_OSAL_QUEUE_STRESS_DATA 0x08
+#define TKEY_OSAL_QUEUE_STRESS_POOL 0x10
+#define TKEY_OSAL_QUEUE_STRESS_SETUP 0x20
+#define TKEY_OSAL_QUEUE_STRESS_HUNG 0x40
+
+typedef struct
+{
+    TKey_UINT32 uiProducer;
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiCheck;
+    TKey_UINT32 uiPad;
+} TKey_OsalQueueStressMsg_t;
+
+typedef struct
+{
+    const TKey_CHAR *pcName;
+    TKey_UINT32 uiTimeoutMs;            /* of the producer sends */
+    TKey_BOOL bFromIsr;                 /* producer 0 uses the ISR send */
+    TKey_BOOL bBuffers;                 /* pointer passing */
+    TKey_BOOL bSlowConsumer;
+} TKey_OsalQueueStressCase_t;
+
+static const TKey_OsalQueueStressCase_t gasStressCases[] = {
+    { "blocking",        THINKEY_OSAL_FOREVER, TKey_FALSE, TKey_FALSE, TKey_FALSE },
+    { "burst_nowait",    THINKEY_OSAL_ZERO,    TKey_FALSE, TKey_FALSE, TKey_TRUE },
+    { "burst_timed_2ms", 2,                    TKey_FALSE, TKey_FALSE, TKey_TRUE },
+#if defined(THINKEY_HOST_BUILD)
+    /* FromISR calls are only legal in an interrupt on the target */
+    { "isr_and_task",    THINKEY_OSAL_ZERO,    TKey_TRUE,  TKey_FALSE, TKey_TRUE },
+#endif
+    { "bufpool_nowait",  THINKEY_OSAL_ZERO,    TKey_FALSE, TKey_TRUE,  TKey_TRUE },
+};
+
+#define TKEY_OSAL_QUEUE_STRESS_CASES \
+    (sizeof(gasStressCases) / sizeof(gasStressCases[0]))
+
+/* What the producers and the consumer counted in a case */
+typedef struct
+{
+    TKey_UINT32 auiSent[TKEY_OSAL_QUEUE_STRESS_PRODUCERS];
+    TKey_UINT32 auiDropped[TKEY_OSAL_QUEUE_STRESS_PRODUCERS];
+    TKey_UINT32 auiAllocFails[TKEY_OSAL_QUEUE_STRESS_PRODUCERS];
+    TKey_UINT32 auiReceived[TKEY_OSAL_QUEUE_STRESS_PRODUCERS];
+    TKey_UINT32 uiFailed;               /* failure bits */
+    THINKey_OSAL_QueueStats_t sQueue;   /* counted by the queue in the case */
+} TKey_OsalQueueStressCount_t;
+
+typedef struct
+{
+    TKey_BOOL bStarted;
+    TKey_HANDLE hMsgQueue;
+    TKey_HANDLE hBufQueue;
+    TKey_HANDLE hDone;
+    TKey_HANDLE ahStart[TKEY_OSAL_QUEUE_STRESS_PRODUCERS + 1];
+    THINKey_OSAL_BufPool_t sPool;
+    const TKey_OsalQueueStressCase_t *psCase;
+    TKey_OsalQueueStressCount_t sCount;
+} TKey_OsalQueueStress_t;
+
+static TKey_OsalQueueStress_t gsStress;
+static TKey_OsalQueueStressCount_t gasStressCounts[TKEY_OSAL_QUEUE_STRESS_MAX_RESULTS];
+
+THINKEY_OSAL_BUFPOOL_STORAGE(stress, gsStressPool, TKEY_OSAL_QUEUE_STRESS_BLOCKS,
+                             TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE);
+
+static TKey_UINT32 tkey_osal_queue_stress_check(TKey_UINT32 uiProducer,
+        TKey_UINT32 uiSeq)
+{
+    return (uiProducer * 0x9E3779B9u) ^ (uiSeq * 0x85EBCA6Bu);
+}
+
+static TKey_VOID tkey_osal_queue_stress_fill(THINKey_OSAL_BufDesc_t *psDesc,
+        TKey_UINT32 uiProducer, TKey_UINT32 uiSeq)
+{
+    TKey_UINT32 uiIndex;
+
+    memcpy(psDesc->pbData, &uiProducer, 4);
+    memcpy(psDesc->pbData + 4, &uiSeq, 4);
+    for(uiIndex = 8; uiIndex < TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE; uiIndex++) {
+        psDesc->pbData[uiIndex] = (TKey_BYTE)(uiSeq + uiIndex + uiProducer);
+    }
+    psDesc->uiLength = TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE;
+}
+
+/* Sends one message of producer uiProducer in the current case */
+static THINKey_eStatusType tkey_osal_queue_stress_send(TKey_UINT32 uiProducer,
+        TKey_UINT32 uiSeq, TKey_UINT32 uiTimeoutMs)
+{
+    const TKey_OsalQueueStressCase_t *psCase = gsStress.psCase;
+    TKey_OsalQueueStressMsg_t sMsg;
+    THINKey_OSAL_BufDesc_t sDesc;
+    TKey_UINT32 uiWoken = 0;
+
+    if(psCase->bBuffers) {
+        if(TKEY_OSAL_QUEUE_STRESS_END == uiSeq) {
+            memset(&sDesc, 0, sizeof(sDesc));
+            return THINKey_OSAL_eQueueSendTimed(gsStress.hBufQueue, &sDesc,
+                    uiTimeoutMs, E_THINKEY_OSAL_QUEUE_BACK);
+        }
+        if(E_THINKEY_SUCCESS != THINKey_OSAL_eBufAlloc(&gsStress.sPool, &sDesc)) {
+            gsStress.sCount.auiAllocFails[uiProducer]++;
+            return E_THINKEY_FAILURE;
+        }
+        tkey_osal_queue_stress_fill(&sDesc, uiProducer, uiSeq);
+        return THINKey_OSAL_eQueueSendBuf(gsStress.hBufQueue, &sDesc, uiTimeoutMs);
+    }
+    sMsg.uiProducer = uiProducer;
+    sMsg.uiSeq = uiSeq;
+    sMsg.uiCheck = tkey_osal_queue_stress_check(uiProducer, uiSeq);
+    sMsg.uiPad = 0;
+    if(psCase->bFromIsr && 0 == uiProducer) {
+        return THINKey_OSAL_eQueueSendToFromISR(gsStress.hMsgQueue, &sMsg,
+                &uiWoken);
+    }
+    return THINKey_OSAL_eQueueSendTimed(gsStress.hMsgQueue, &sMsg, uiTimeoutMs,
+            E_THINKEY_OSAL_QUEUE_BACK);
+}
+
+static TKey_VOID tkey_osal_queue_stress_producer(TKey_VOID *pvParam)
+{
+    TKey_UINT32 uiProducer = (TKey_UINT32)(uintptr_t)pvParam;
+    TKey_UINT32 uiSeq;
+    TKey_UINT32 uiStart;
+
+    for(;;) {
+        (void)THINKey_OSAL_eQueueReceive(gsStress.ahStart[uiProducer], &uiStart);
+        for(uiSeq = 0; uiSeq < TKEY_OSAL_QUEUE_STRESS_MESSAGES; uiSeq++) {
+            if(E_THINKEY_SUCCESS == tkey_osal_queue_stress_send(uiProducer,
+                    uiSeq, gsStress.psCase->uiTimeoutMs)) {
+                gsStress.sCount.auiSent[uiProducer]++;
+            } else {
+                gsStress.sCount.auiDropped[uiProducer]++;
+            }
+            if(0 == (uiSeq + 1) % TKEY_OSAL_QUEUE_STRESS_BURST) {
+                THINKey_OSAL_Delay(1);
+            }
+        }
+        /* The end marker must get through; an ISR cannot wait for it */
+        while(E_THINKEY_SUCCESS != tkey_osal_queue_stress_send(uiProducer,
+                TKEY_OSAL_QUEUE_STRESS_END, THINKEY_OSAL_FOREVER)) {
+            THINKey_OSAL_Delay(1);
+        }
+    }
+}
+
+/* Checks a received message; returns its producer, or
+ * TKEY_OSAL_QUEUE_STRESS_PRODUCERS for an end marker */
+static TKey_UINT32 tkey_osal_queue_stress_take(TKey_UINT32 *puiNext)
+{
+    TKey_OsalQueueStressMsg_t sMsg;
+    THINKey_OSAL_BufDesc_t sDesc;
+    TKey_UINT32 uiIndex;
+
+    if(gsStress.psCase->bBuffers) {
+        (void)THINKey_OSAL_eQueueReceive(gsStress.hBufQueue, &sDesc);
+        if(THINKey_NULL == sDesc.pbData) {
+            return TKEY_OSAL_QUEUE_STRESS_PRODUCERS;
+        }
+        memcpy(&sMsg.uiProducer, sDesc.pbData, 4);
+        memcpy(&sMsg.uiSeq, sDesc.pbData + 4, 4);
+        sMsg.uiCheck = tkey_osal_queue_stress_check(sMsg.uiProducer, sMsg.uiSeq);
+        if(TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE != sDesc.uiLength ||
+           sDesc.psPool != &gsStress.sPool) {
+            gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_DATA;
+        }
+        for(uiIndex = 8; uiIndex < TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE; uiIndex++) {
+            if(sDesc.pbData[uiIndex] !=
+               (TKey_BYTE)(sMsg.uiSeq + uiIndex + sMsg.uiProducer)) {
+                gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_DATA;
+                break;
+            }
+        }
+        THINKey_OSAL_vBufFree(&sDesc);
+    } else {
+        (void)THINKey_OSAL_eQueueReceive(gsStress.hMsgQueue, &sMsg);
+        if(TKEY_OSAL_QUEUE_STRESS_END == sMsg.uiSeq) {
+            return TKEY_OSAL_QUEUE_STRESS_PRODUCERS;
+        }
+    }
+    if(sMsg.uiProducer >= TKEY_OSAL_QUEUE_STRESS_PRODUCERS ||
+       sMsg.uiCheck != tkey_osal_queue_stress_check(sMsg.uiProducer, sMsg.uiSeq)) {
+        gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_DATA;
+        return 0;
+    }
+    /* Drops leave gaps; anything else out of sequence is reordering */
+    if(sMsg.uiSeq < puiNext[sMsg.uiProducer]) {
+        gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_ORDER;
+    }
+    puiNext[sMsg.uiProducer] = sMsg.uiSeq + 1;
+    gsStress.sCount.auiReceived[sMsg.uiProducer]++;
+    return sMsg.uiProducer;
+}
+
+static TKey_VOID tkey_osal_queue_stress_consumer(TKey_VOID *pvParam)
+{
+    TKey_UINT32 auiNext[TKEY_OSAL_QUEUE_STRESS_PRODUCERS];
+    TKey_UINT32 uiEnds;
+    TKey_UINT32 uiTaken;
+    TKey_UINT32 uiStart;
+
+    (void)pvParam;
+    for(;;) {
+        (void)THINKey_OSAL_eQueueReceive(
+                gsStress.ahStart[TKEY_OSAL_QUEUE_STRESS_PRODUCERS], &uiStart);
+        memset(auiNext, 0, sizeof(auiNext));
+        uiEnds = 0;
+        uiTaken = 0;
+        while(uiEnds < TKEY_OSAL_QUEUE_STRESS_PRODUCERS) {
+            if(TKEY_OSAL_QUEUE_STRESS_PRODUCERS ==
+               tkey_osal_queue_stress_take(auiNext)) {
+                uiEnds++;
+            } else if(gsStress.psCase->bSlowConsumer &&
+                      0 == (++uiTaken % TKEY_OSAL_QUEUE_STRESS_SLOW_EVERY)) {
+                THINKey_OSAL_Delay(1);
+            }
+        }
+        (void)THINKey_OSAL_eQueueSend(gsStress.hDone, &uiEnds);
+    }
+}
+
+static TKey_UINT32 tkey_osal_queue_stress_start(TKey_VOID)
+{
+    TKey_UINT32 uiTask;
+
+    gsStress.hMsgQueue = THINKey_OSAL_hCreateQueue(TKEY_OSAL_QUEUE_STRESS_DEPTH,
+            sizeof(TKey_OsalQueueStressMsg_t));
+    gsStress.hBufQueue = THINKey_OSAL_hCreateQueue(TKEY_OSAL_QUEUE_STRESS_DEPTH,
+            sizeof(THINKey_OSAL_BufDesc_t));
+    gsStress.hDone = THINKey_OSAL_hCreateQueue(1, sizeof(TKey_UINT32));
+    if(THINKey_NULL == gsStress.hMsgQueue || THINKey_NULL == gsStress.hBufQueue ||
+       THINKey_NULL == gsStress.hDone) {
+        return TKEY_OSAL_QUEUE_STRESS_SETUP;
+    }
+    for(uiTask = 0; uiTask <= TKEY_OSAL_QUEUE_STRESS_PRODUCERS; uiTask++) {
+        gsStress.ahStart[uiTask] = THINKey_OSAL_hCreateQueue(1, sizeof(TKey_UINT32));
+        if(THINKey_NULL == gsStress.ahStart[uiTask]) {
+            return TKEY_OSAL_QUEUE_STRESS_SETUP;
+        }
+    }
+    if(E_THINKEY_SUCCESS != THINKEY_OSAL_INIT_STATIC_BUFPOOL(&gsStress.sPool,
+            gsStressPool, TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE)) {
+        return TKEY_OSAL_QUEUE_STRESS_SETUP;
+    }
+    for(uiTask = 0; uiTask < TKEY_OSAL_QUEUE_STRESS_PRODUCERS; uiTask++) {
+        if(E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("Q stress producer",
+                tkey_osal_queue_stress_producer, (TKey_VOID*)(uintptr_t)uiTask,
+                TKEY_OSAL_QUEUE_STRESS_PRIORITY, TKEY_OSAL_QUEUE_STRESS_STACK,
+                TKey_NULL)) {
+            return TKEY_OSAL_QUEUE_STRESS_SETUP;
+        }
+    }
+    if(E_THINKEY_SUCCESS != THINKey_OSAL_eCreateTask("Q stress consumer",
+            tkey_osal_queue_stress_consumer, TKey_NULL,
+            TKEY_OSAL_QUEUE_STRESS_PRIORITY, TKEY_OSAL_QUEUE_STRESS_STACK,
+            TKey_NULL)) {
+        return TKEY_OSAL_QUEUE_STRESS_SETUP;
+    }
+    gsStress.bStarted = TKey_TRUE;
+    return 0;
+}
+
+/* Back 1, back 2 and front 0 must come out as 0, 1, 2. The consumer is
+ * waiting for a case, so the message queue is ours. */
+static TKey_UINT32 tkey_osal_queue_stress_front(TKey_VOID)
+{
+    static const TKey_UINT32 auiSend[] = { 1, 2, 0 };
+    TKey_OsalQueueStressMsg_t sMsg;
+    TKey_UINT32 uiIndex;
+
+    memset(&sMsg, 0, sizeof(sMsg));
+    for(uiIndex = 0; uiIndex < 3; uiIndex++) {
+        sMsg.uiSeq = auiSend[uiIndex];
+        if(E_THINKEY_SUCCESS != THINKey_OSAL_eQueueSendTimed(gsStress.hMsgQueue,
+                &sMsg, THINKEY_OSAL_ZERO, (2 == uiIndex) ?
+                E_THINKEY_OSAL_QUEUE_FRONT : E_THINKEY_OSAL_QUEUE_BACK)) {
+            return TKEY_OSAL_QUEUE_STRESS_COUNT;
+        }
+    }
+    for(uiIndex = 0; uiIndex < 3; uiIndex++) {
+        if(E_THINKEY_SUCCESS != THINKey_OSAL_eTimedQueueReceive(gsStress.hMsgQueue,
+                &sMsg, THINKEY_OSAL_ZERO) || uiIndex != sMsg.uiSeq) {
+            return TKEY_OSAL_QUEUE_STRESS_ORDER;
+        }
+    }
+    return 0;
+}
+
+/* Runs one case; the counters are left in gsStress.sCount */
+static TKey_VOID tkey_osal_queue_stress_case(const TKey_OsalQueueStressCase_t *psCase)
+{
+    THINKey_OSAL_QueueStats_t sBefore;
+    THINKey_OSAL_QueueStats_t sAfter;
+    THINKey_OSAL_BufPoolStats_t sPool;
+    TKey_HANDLE hQueue = psCase->bBuffers ? gsStress.hBufQueue : gsStress.hMsgQueue;
+    TKey_UINT32 uiSent = 0;
+    TKey_UINT32 uiDropped = 0;
+    TKey_UINT32 uiAllocFails = 0;
+    TKey_UINT32 uiTask;
+    TKey_UINT32 uiDone;
+
+    memset(&gsStress.sCount, 0, sizeof(gsStress.sCount));
+    gsStress.psCase = psCase;
+    THINKey_OSAL_vQueueGetStats(hQueue, &sBefore);
+    for(uiTask = 0; uiTask <= TKEY_OSAL_QUEUE_STRESS_PRODUCERS; uiTask++) {
+        (void)THINKey_OSAL_eQueueSend(gsStress.ahStart[uiTask], &uiTask);
+    }
+    if(E_THINKEY_SUCCESS != THINKey_OSAL_eTimedQueueReceive(gsStress.hDone,
+            &uiDone, TKEY_OSAL_QUEUE_STRESS_TIMEOUT_MS)) {
+        gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_HUNG;
+        return;
+    }
+    THINKey_OSAL_vQueueGetStats(hQueue, &sAfter);
+
+    for(uiTask = 0; uiTask < TKEY_OSAL_QUEUE_STRESS_PRODUCERS; uiTask++) {
+        uiSent += gsStress.sCount.auiSent[uiTask];
+        uiDropped += gsStress.sCount.auiDropped[uiTask];
+        uiAllocFails += gsStress.sCount.auiAllocFails[uiTask];
+        if(gsStress.sCount.auiSent[uiTask] != gsStress.sCount.auiReceived[uiTask] ||
+           gsStress.sCount.auiSent[uiTask] + gsStress.sCount.auiDropped[uiTask] !=
+               TKEY_OSAL_QUEUE_STRESS_MESSAGES) {
+            gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_COUNT;
+        }
+    }
+    if(THINKEY_OSAL_FOREVER == psCase->uiTimeoutMs && 0 != uiDropped) {
+        gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_COUNT;
+    }
+    /* The end markers went through the queue too; failed allocations never
+       reached it */
+    gsStress.sCount.sQueue.uiSent = sAfter.uiSent - sBefore.uiSent;
+    gsStress.sCount.sQueue.uiDropped = sAfter.uiDropped - sBefore.uiDropped;
+    gsStress.sCount.sQueue.uiMaxDepth = sAfter.uiMaxDepth;
+    if(gsStress.sCount.sQueue.uiSent != uiSent + TKEY_OSAL_QUEUE_STRESS_PRODUCERS ||
+       gsStress.sCount.sQueue.uiDropped < uiDropped - uiAllocFails ||
+       sAfter.uiMaxDepth > TKEY_OSAL_QUEUE_STRESS_DEPTH) {
+        gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_STATS;
+    }
+    if(psCase->bBuffers) {
+        THINKey_OSAL_vBufPoolGetStats(&gsStress.sPool, &sPool);
+        if(sPool.uiFree != sPool.uiBlocks) {
+            gsStress.sCount.uiFailed |= TKEY_OSAL_QUEUE_STRESS_POOL;
+        }
+    }
+}
+
+TKey_UINT32 TKey_OsalQueueStress_Run(TKey_BenchResult_t *psResults,
+                                     TKey_UINT32 uiMaxResults)
+{
+    TKey_BenchResult_t *psRes;
+    TKey_UINT64 ullStart;
+    TKey_UINT32 uiCount = 0;
+    TKey_UINT32 uiCase;
+    TKey_UINT32 uiReceived;
+    TKey_UINT32 uiTask;
+    TKey_UINT32 uiFailed = 0;
+
+    TKey_Bench_TimerInit();
+    if(!gsStress.bStarted) {
+        uiFailed = tkey_osal_queue_stress_start();
+    }
+
+    if(uiCount < uiMaxResults) {
+        psRes = &psResults[uiCount];
+        memset(psRes, 0, sizeof(TKey_BenchResult_t));
+        memset(&gasStressCounts[uiCount], 0, sizeof(gasStressCounts[0]));
+        psRes->pcSuite = "osal_queue";
+        psRes->pcName = "front";
+        ullStart = TKey_Bench_Now();
+        if(0 == uiFailed) {
+            uiFailed = tkey_osal_queue_stress_front();
+        }
+        TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+        psRes->iStatus = (TKey_INT32)uiFailed;
+        gasStressCounts[uiCount].uiFailed = uiFailed;
+        uiCount++;
+    }
+    if(0 != (uiFailed & TKEY_OSAL_QUEUE_STRESS_SETUP)) {
+        return uiCount;
+    }
+
+    for(uiCase = 0; uiCase < TKEY_OSAL_QUEUE_STRESS_CASES && uiCount < uiMaxResults;
+        uiCase++) {
+        psRes = &psResults[uiCount];
+        memset(psRes, 0, sizeof(TKey_BenchResult_t));
+        psRes->pcSuite = "osal_queue";
+        psRes->pcName = gasStressCases[uiCase].pcName;
+        psRes->uiBytes = gasStressCases[uiCase].bBuffers ?
+                TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE : sizeof(TKey_OsalQueueStressMsg_t);
+
+        ullStart = TKey_Bench_Now();
+        tkey_osal_queue_stress_case(&gasStressCases[uiCase]);
+        TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+
+        /* Per message received */
+        uiReceived = 0;
+        for(uiTask = 0; uiTask < TKEY_OSAL_QUEUE_STRESS_PRODUCERS; uiTask++) {
+            uiReceived += gsStress.sCount.auiReceived[uiTask];
+        }
+        if(0 != uiReceived) {
+            psRes->uiIterations = uiReceived;
+            psRes->ullMinTicks = psRes->ullTotalTicks / uiReceived;
+        }
+        psRes->iStatus = (TKey_INT32)gsStress.sCount.uiFailed;
+        gasStressCounts[uiCount] = gsStress.sCount;
+        uiCount++;
+    }
+    return uiCount;
+}
+
+TKey_INT32 TKey_OsalQueueStress_Report(TKey_BenchPrint_t pfnPrint)
+{
+    static TKey_BenchResult_t sasResults[TKEY_OSAL_QUEUE_STRESS_MAX_RESULTS];
+    TKey_CHAR acLine[TKEY_BENCH_LINE_SIZE];
+    const TKey_OsalQueueStressCount_t *psCount;
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiTask;
+    TKey_UINT32 uiDropped;
+    TKey_UINT32 uiAllocFails;
+    TKey_UINT32 uiReceived;
+    TKey_INT32 iFailed = 0;
+
+    uiCount = TKey_OsalQueueStress_Run(sasResults, TKEY_OSAL_QUEUE_STRESS_MAX_RESULTS);
+    TKey_Bench_PrintHeader(pfnPrint);
+    TKey_Bench_PrintResults(pfnPrint, sasResults, uiCount);
+    for(uiIndex = 0; uiIndex < uiCount; uiIndex++) {
+        psCount = &gasStressCounts[uiIndex];
+        uiDropped = 0;
+        uiAllocFails = 0;
+        uiReceived = 0;
+        for(uiTask = 0; uiTask < TKEY_OSAL_QUEUE_STRESS_PRODUCERS; uiTask++) {
+            uiDropped += psCount->auiDropped[uiTask];
+            uiAllocFails += psCount->auiAllocFails[uiTask];
+            uiReceived += psCount->auiReceived[uiTask];
+        }
+        snprintf(acLine, sizeof(acLine),
+                 "TKQSTRESS,%s,received=%u,dropped=%u,alloc_fails=%u,"
+                 "queue_sent=%u,queue_dropped=%u,max_depth=%u,failed=0x%x\r\n",
+                 sasResults[uiIndex].pcName, (unsigned)uiReceived,
+                 (unsigned)uiDropped, (unsigned)uiAllocFails,
+                 (unsigned)psCount->sQueue.uiSent,
+                 (unsigned)psCount->sQueue.uiDropped,
+                 (unsigned)psCount->sQueue.uiMaxDepth,
+                 (unsigned)psCount->uiFailed);
+        pfnPrint(acLine);
+        if(0 != sasResults[uiIndex].iStatus) {
+            iFailed++;
+        }
+    }
+    return iFailed;
+}
+
+#if defined(THINKEY_OSAL_QUEUE_STRESS_MAIN)
+static TKey_VOID tkey_osal_queue_stress_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(TKey_VOID)
+{
+    return (0 == TKey_OsalQueueStress_Report(tkey_osal_queue_stress_print)) ? 0 : 1;
+}
+#endif /* THINKEY_OSAL_QUEUE_STRESS_MAIN */
@@ -0,0 +1,58 @@
+/*
+ * \file thinkey_osal_queue_stress.h
+ *
+ * \brief Header file for the OSAL queue producer burst stress test
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_OSAL_QUEUE_STRESS_H
+#define THINKEY_OSAL_QUEUE_STRESS_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+/**
+ *  @brief Test configuration. The queues are kept much shorter than a
+ *         burst so that the no-wait cases drop.
+ */
+#ifndef TKEY_OSAL_QUEUE_STRESS_PRODUCERS
+#define TKEY_OSAL_QUEUE_STRESS_PRODUCERS 4
+#endif
+#ifndef TKEY_OSAL_QUEUE_STRESS_MESSAGES     /* per producer and case */
+#define TKEY_OSAL_QUEUE_STRESS_MESSAGES 5000
+#endif
+#ifndef TKEY_OSAL_QUEUE_STRESS_DEPTH
+#define TKEY_OSAL_QUEUE_STRESS_DEPTH 8
+#endif
+#ifndef TKEY_OSAL_QUEUE_STRESS_BLOCKS
+#define TKEY_OSAL_QUEUE_STRESS_BLOCKS 12
+#endif
+#ifndef TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE
+#define TKEY_OSAL_QUEUE_STRESS_BLOCK_SIZE 256
+#endif
+#ifndef TKEY_OSAL_QUEUE_STRESS_TIMEOUT_MS   /* for one case to complete */
+#define TKEY_OSAL_QUEUE_STRESS_TIMEOUT_MS 60000
+#endif
+
+#define TKEY_OSAL_QUEUE_STRESS_MAX_RESULTS 6
+
+/**
+ * \brief   Runs the cases: blocking sends, no-wait bursts against a slow
+ *          consumer, front sends, ISR sends (host only) and pointer passing
+ *          through a buffer pool. Each case checks that every producer's
+ *          messages arrive in order, that the messages received and the
+ *          drops seen by the producers add up to the messages sent, and
+ *          that the queue and pool counters agree. Creates its tasks on
+ *          the first call. Returns the number of results written.
+ */
+TKey_UINT32 TKey_OsalQueueStress_Run(TKey_BenchResult_t *psResults,
+                                     TKey_UINT32 uiMaxResults);
+
+/**
+ * \brief   Runs the cases and emits the CSV table through pfnPrint, with
+ *          one line of counters per case. Returns 0 when every case passed.
+ */
+TKey_INT32 TKey_OsalQueueStress_Report(TKey_BenchPrint_t pfnPrint);
+
+#endif /* THINKEY_OSAL_QUEUE_STRESS_H */
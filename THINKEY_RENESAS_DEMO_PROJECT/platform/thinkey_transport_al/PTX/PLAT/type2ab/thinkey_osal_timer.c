@@ -0,0 +1,583 @@
+/*
+ * \file thinkey_osal_timer.c
+ *
+ * \brief OSAL timer service on a hierarchical timing wheel
+ *
+ * The wheel is changed in short critical sections: a start or a stop
+ * links or unlinks one timer, and the service processes one ms with work
+ * per critical section. Callbacks are made outside of them, from the list
+ * of timers found expired. The timers created without storage come from
+ * a pool of THINKEY_OSAL_TIMERS.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_osal.h"
+#include "thinkey_osal_timer.h"
+
+#ifndef THINKEY_OSAL_TIMERS             /* created without storage */
+#define THINKEY_OSAL_TIMERS 8
+#endif
+
+#define TKEY_OSAL_WHEEL_MASK (TKEY_OSAL_WHEEL_SLOTS - 1u)
+
+#define TKEY_OSAL_TIMER_PERIODIC 0x01
+#define TKEY_OSAL_TIMER_LISTED 0x02     /* on the callback list */
+#define TKEY_OSAL_TIMER_PENDING 0x04    /* callback to be made */
+#define TKEY_OSAL_TIMER_RELEASED 0x08   /* back to the pool once unlisted */
+
+#define PERIODIC_TIMER_NAME "Periodic Timer"
+#define ONE_SHOT_TIMER_NAME "One Shot Timer"
+
+_Static_assert(sizeof(THINKey_OSAL_Timer_t) <= sizeof(THINKey_OSAL_TimerCb_t),
+		"THINKEY_OSAL_TIMER_CB_WORDS too small");
+_Static_assert(TKEY_OSAL_WHEEL_SLOTS == 64, "a level is one 64 bit mask");
+
+static THINKey_OSAL_TimerWheel_t gsTimerWheel;
+static THINKey_OSAL_BufPool_t gsTimerPool;
+static THINKey_BOOL gbTimerWheelReady;
+static THINKey_BOOL gbTimerStarted;         /* service task started */
+
+THINKEY_OSAL_BUFPOOL_STORAGE(osal, gsTimers, THINKEY_OSAL_TIMERS,
+		sizeof(THINKey_OSAL_TimerCb_t));
+
+/* Wheel */
+
+static THINKey_VOID tkey_osal_wheel_link(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_OSAL_Timer_t *psTimer)
+{
+	THINKey_UINT32 uiWhen = psTimer->uiExpiry;
+	THINKey_UINT32 uiLevel = 0;
+	THINKey_UINT32 uiShift = 0;
+	THINKey_OSAL_Timer_t **ppsSlot;
+
+	/* The lowest level on which the timer is less than a round of slots
+	 * ahead, counted in slots of that level across the wrap of the ms;
+	 * beyond the last level it goes as far as it can, and is put back
+	 * when it gets there */
+	while((((uiWhen >> uiShift) - (psWheel->uiNow >> uiShift)) & (0xFFFFFFFFu >> uiShift)) >=
+			TKEY_OSAL_WHEEL_SLOTS)
+	{
+		if(uiLevel == TKEY_OSAL_WHEEL_LEVELS - 1)
+		{
+			uiWhen = ((psWheel->uiNow >> uiShift) + TKEY_OSAL_WHEEL_SLOTS - 1) << uiShift;
+			break;
+		}
+		uiLevel++;
+		uiShift += TKEY_OSAL_WHEEL_BITS;
+	}
+
+	psTimer->ucLevel = (THINKey_BYTE)uiLevel;
+	psTimer->ucSlot = (THINKey_BYTE)((uiWhen >> uiShift) & TKEY_OSAL_WHEEL_MASK);
+	ppsSlot = &psWheel->apsSlot[uiLevel][psTimer->ucSlot];
+	psTimer->psNext = *ppsSlot;
+	if(psTimer->psNext != THINKey_NULL)
+		psTimer->psNext->ppsPrev = &psTimer->psNext;
+	psTimer->ppsPrev = ppsSlot;
+	*ppsSlot = psTimer;
+	psWheel->aullUsed[uiLevel] |= 1ull << psTimer->ucSlot;
+}
+
+static THINKey_VOID tkey_osal_wheel_unlink(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_OSAL_Timer_t *psTimer)
+{
+	if(psTimer->ucLevel == TKEY_OSAL_WHEEL_NO_LEVEL)
+		return;
+
+	*psTimer->ppsPrev = psTimer->psNext;
+	if(psTimer->psNext != THINKey_NULL)
+		psTimer->psNext->ppsPrev = psTimer->ppsPrev;
+	if(psWheel->apsSlot[psTimer->ucLevel][psTimer->ucSlot] == THINKey_NULL)
+		psWheel->aullUsed[psTimer->ucLevel] &= ~(1ull << psTimer->ucSlot);
+	psTimer->ucLevel = TKEY_OSAL_WHEEL_NO_LEVEL;
+}
+
+/* When the wheel next has a slot to process: a level 0 slot is processed
+ * at its expiry, a higher one when it is cascaded. The current slot of a
+ * level is always empty, as its timers were moved down when it came up. */
+static THINKey_BOOL tkey_osal_wheel_next(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_UINT32 *puiAt)
+{
+	THINKey_BOOL bFound = THINKey_FALSE;
+	THINKey_UINT64 ullUsed;
+	THINKey_UINT32 uiLevel;
+	THINKey_UINT32 uiShift;
+	THINKey_UINT32 uiFrom;
+	THINKey_UINT32 uiStep;
+	THINKey_UINT32 uiAt;
+
+	for(uiLevel = 0; uiLevel < TKEY_OSAL_WHEEL_LEVELS; uiLevel++)
+	{
+		ullUsed = psWheel->aullUsed[uiLevel];
+		if(ullUsed == 0)
+			continue;
+		uiShift = TKEY_OSAL_WHEEL_BITS * uiLevel;
+		uiFrom = ((psWheel->uiNow >> uiShift) + 1) & TKEY_OSAL_WHEEL_MASK;
+		if(uiFrom != 0)
+			ullUsed = (ullUsed >> uiFrom) | (ullUsed << (64 - uiFrom));
+		uiStep = 1 + (THINKey_UINT32)__builtin_ctzll(ullUsed);
+		uiAt = ((psWheel->uiNow >> uiShift) + uiStep) << uiShift;
+		if(!bFound || (THINKey_INT32)(uiAt - *puiAt) < 0)
+		{
+			*puiAt = uiAt;
+			bFound = THINKey_TRUE;
+		}
+	}
+	return bFound;
+}
+
+/* Moves the timers of the current slot of a level down */
+static THINKey_VOID tkey_osal_wheel_cascade(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_UINT32 uiLevel)
+{
+	THINKey_UINT32 uiSlot = (psWheel->uiNow >> (TKEY_OSAL_WHEEL_BITS * uiLevel)) &
+			TKEY_OSAL_WHEEL_MASK;
+	THINKey_OSAL_Timer_t *psTimer = psWheel->apsSlot[uiLevel][uiSlot];
+	THINKey_OSAL_Timer_t *psNext;
+
+	psWheel->apsSlot[uiLevel][uiSlot] = THINKey_NULL;
+	psWheel->aullUsed[uiLevel] &= ~(1ull << uiSlot);
+	for(; psTimer != THINKey_NULL; psTimer = psNext)
+	{
+		psNext = psTimer->psNext;
+		tkey_osal_wheel_link(psWheel, psTimer);
+	}
+}
+
+/* Puts an expired timer on the callback list and rearms it if periodic */
+static THINKey_VOID tkey_osal_wheel_expire(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_OSAL_Timer_t *psTimer, THINKey_UINT32 uiNowMs)
+{
+	THINKey_UINT32 uiLate = uiNowMs - psTimer->uiExpiry;
+
+	psTimer->sStats.uiExpiries++;
+	if(uiLate > psTimer->sStats.uiMaxLateMs)
+		psTimer->sStats.uiMaxLateMs = uiLate;
+
+	if(psTimer->ucFlags & TKEY_OSAL_TIMER_PERIODIC)
+	{
+		/* Periods already gone are skipped, so a late service calls back
+		 * once, not in a burst */
+		psTimer->uiExpiry += psTimer->uiPeriod;
+		if((THINKey_INT32)(psTimer->uiExpiry - uiNowMs) <= 0)
+		{
+			psTimer->sStats.uiOverruns += (uiNowMs - psTimer->uiExpiry) /
+					psTimer->uiPeriod + 1;
+			psTimer->uiExpiry = uiNowMs + psTimer->uiPeriod;
+		}
+		tkey_osal_wheel_link(psWheel, psTimer);
+	}
+
+	if(psTimer->ucFlags & TKEY_OSAL_TIMER_LISTED)
+	{
+		/* Still waiting for its previous callback */
+		psTimer->sStats.uiOverruns++;
+	}
+	else
+	{
+		psTimer->psFireNext = THINKey_NULL;
+		*psWheel->ppsFireTail = psTimer;
+		psWheel->ppsFireTail = &psTimer->psFireNext;
+		psTimer->ucFlags |= TKEY_OSAL_TIMER_LISTED;
+	}
+	psTimer->ucFlags |= TKEY_OSAL_TIMER_PENDING;
+}
+
+/* Processes psWheel->uiNow, the next ms with work */
+static THINKey_VOID tkey_osal_wheel_tick(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_UINT32 uiNowMs)
+{
+	THINKey_UINT32 uiSlot = psWheel->uiNow & TKEY_OSAL_WHEEL_MASK;
+	THINKey_UINT32 uiLevel;
+	THINKey_OSAL_Timer_t *psTimer;
+
+	if(uiSlot == 0)
+	{
+		for(uiLevel = 1; uiLevel < TKEY_OSAL_WHEEL_LEVELS; uiLevel++)
+		{
+			tkey_osal_wheel_cascade(psWheel, uiLevel);
+			if(((psWheel->uiNow >> (TKEY_OSAL_WHEEL_BITS * uiLevel)) &
+					TKEY_OSAL_WHEEL_MASK) != 0)
+				break;
+		}
+	}
+
+	while((psTimer = psWheel->apsSlot[0][uiSlot]) != THINKey_NULL)
+	{
+		tkey_osal_wheel_unlink(psWheel, psTimer);
+		if((THINKey_INT32)(psTimer->uiExpiry - psWheel->uiNow) > 0)
+			tkey_osal_wheel_link(psWheel, psTimer);     /* beyond the range */
+		else
+			tkey_osal_wheel_expire(psWheel, psTimer, uiNowMs);
+	}
+}
+
+static THINKey_UINT32 tkey_osal_wheel_next_ms(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_UINT32 uiNowMs)
+{
+	THINKey_UINT32 uiAt;
+
+	if(!tkey_osal_wheel_next(psWheel, &uiAt))
+		return THINKEY_OSAL_FOREVER;
+	if((THINKey_INT32)(uiAt - uiNowMs) <= 0)
+		return 0;
+	return uiAt - uiNowMs;
+}
+
+THINKey_VOID THINKey_OSAL_vWheelInit(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_UINT32 uiNowMs)
+{
+	THINKey_UINT32 uiLevel;
+	THINKey_UINT32 uiSlot;
+
+	for(uiLevel = 0; uiLevel < TKEY_OSAL_WHEEL_LEVELS; uiLevel++)
+	{
+		for(uiSlot = 0; uiSlot < TKEY_OSAL_WHEEL_SLOTS; uiSlot++)
+			psWheel->apsSlot[uiLevel][uiSlot] = THINKey_NULL;
+		psWheel->aullUsed[uiLevel] = 0;
+	}
+	psWheel->uiNow = uiNowMs;
+	psWheel->uiWakeAt = uiNowMs;
+	psWheel->bWakeSet = THINKey_FALSE;
+	psWheel->psFireHead = THINKey_NULL;
+	psWheel->ppsFireTail = &psWheel->psFireHead;
+}
+
+THINKey_VOID THINKey_OSAL_vWheelTimerInit(THINKey_OSAL_Timer_t *psTimer,
+		THINKey_CONST_STRING strName, THINKey_pfnTimerCallback pfnTimerCallback,
+		THINKey_HANDLE hCallerHandle, THINKey_BOOL bPeriodic,
+		THINKey_OSAL_BufPool_t *psPool)
+{
+	psTimer->psNext = THINKey_NULL;
+	psTimer->ppsPrev = THINKey_NULL;
+	psTimer->psFireNext = THINKey_NULL;
+	psTimer->pfnCallback = pfnTimerCallback;
+	psTimer->strName = strName;
+	psTimer->hCaller = hCallerHandle;
+	psTimer->psPool = psPool;
+	psTimer->uiExpiry = 0;
+	psTimer->uiPeriod = 0;
+	psTimer->sStats.uiStarts = 0;
+	psTimer->sStats.uiStops = 0;
+	psTimer->sStats.uiExpiries = 0;
+	psTimer->sStats.uiOverruns = 0;
+	psTimer->sStats.uiMaxLateMs = 0;
+	psTimer->ucLevel = TKEY_OSAL_WHEEL_NO_LEVEL;
+	psTimer->ucSlot = 0;
+	psTimer->ucFlags = bPeriodic ? TKEY_OSAL_TIMER_PERIODIC : 0;
+}
+
+THINKey_BOOL THINKey_OSAL_bWheelStart(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_OSAL_Timer_t *psTimer, THINKey_UINT32 uiPeriodMs,
+		THINKey_UINT32 uiNowMs)
+{
+	THINKey_BOOL bWake = THINKey_FALSE;
+	THINKey_UINT32 uiLevel;
+
+	THINKey_OSAL_vEnterCritical();
+	tkey_osal_wheel_unlink(psWheel, psTimer);
+	psTimer->ucFlags &= (THINKey_BYTE)~TKEY_OSAL_TIMER_PENDING;
+
+	/* An empty wheel may be far behind, after the service slept */
+	for(uiLevel = 0; uiLevel < TKEY_OSAL_WHEEL_LEVELS; uiLevel++)
+	{
+		if(psWheel->aullUsed[uiLevel] != 0)
+			break;
+	}
+	if((uiLevel == TKEY_OSAL_WHEEL_LEVELS) &&
+	   ((THINKey_INT32)(uiNowMs - psWheel->uiNow) > 0))
+		psWheel->uiNow = uiNowMs;
+
+	psTimer->uiPeriod = (uiPeriodMs != 0) ? uiPeriodMs : 1;
+	psTimer->uiExpiry = uiNowMs + uiPeriodMs;
+	if((THINKey_INT32)(psTimer->uiExpiry - psWheel->uiNow) <= 0)
+		psTimer->uiExpiry = psWheel->uiNow + 1;
+	tkey_osal_wheel_link(psWheel, psTimer);
+	psTimer->sStats.uiStarts++;
+
+	if(!psWheel->bWakeSet ||
+	   (THINKey_INT32)(psTimer->uiExpiry - psWheel->uiWakeAt) < 0)
+	{
+		psWheel->uiWakeAt = psTimer->uiExpiry;
+		psWheel->bWakeSet = THINKey_TRUE;
+		bWake = THINKey_TRUE;
+	}
+	THINKey_OSAL_vExitCritical();
+
+	return bWake;
+}
+
+THINKey_VOID THINKey_OSAL_vWheelStop(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_OSAL_Timer_t *psTimer)
+{
+	THINKey_OSAL_vEnterCritical();
+	tkey_osal_wheel_unlink(psWheel, psTimer);
+	psTimer->ucFlags &= (THINKey_BYTE)~TKEY_OSAL_TIMER_PENDING;
+	psTimer->sStats.uiStops++;
+	THINKey_OSAL_vExitCritical();
+}
+
+THINKey_VOID THINKey_OSAL_vWheelRelease(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_OSAL_Timer_t *psTimer)
+{
+	THINKey_OSAL_BufDesc_t sDesc;
+	THINKey_BOOL bFree;
+
+	THINKey_OSAL_vEnterCritical();
+	tkey_osal_wheel_unlink(psWheel, psTimer);
+	psTimer->ucFlags &= (THINKey_BYTE)~TKEY_OSAL_TIMER_PENDING;
+	/* A listed timer is freed by the service when it unlists it */
+	psTimer->ucFlags |= TKEY_OSAL_TIMER_RELEASED;
+	bFree = (psTimer->psPool != THINKey_NULL) &&
+			!(psTimer->ucFlags & TKEY_OSAL_TIMER_LISTED);
+	THINKey_OSAL_vExitCritical();
+
+	if(bFree)
+	{
+		sDesc.pbData = (THINKey_BYTE *)psTimer;
+		sDesc.psPool = psTimer->psPool;
+		THINKey_OSAL_vBufFree(&sDesc);
+	}
+}
+
+THINKey_UINT32 THINKey_OSAL_uiWheelProcess(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_UINT32 uiNowMs)
+{
+	THINKey_pfnTimerCallback pfnCallback;
+	THINKey_OSAL_Timer_t *psTimer;
+	THINKey_OSAL_BufDesc_t sDesc;
+	THINKey_UINT32 uiAt;
+	THINKey_UINT32 uiWait;
+
+	/* Straight from one ms with work to the next */
+	for(;;)
+	{
+		THINKey_OSAL_vEnterCritical();
+		if(!tkey_osal_wheel_next(psWheel, &uiAt) ||
+		   (THINKey_INT32)(uiAt - uiNowMs) > 0)
+		{
+			if((THINKey_INT32)(uiNowMs - psWheel->uiNow) > 0)
+				psWheel->uiNow = uiNowMs;
+			THINKey_OSAL_vExitCritical();
+			break;
+		}
+		psWheel->uiNow = uiAt;
+		tkey_osal_wheel_tick(psWheel, uiNowMs);
+		THINKey_OSAL_vExitCritical();
+	}
+
+	for(;;)
+	{
+		pfnCallback = THINKey_NULL;
+		sDesc.psPool = THINKey_NULL;
+		THINKey_OSAL_vEnterCritical();
+		psTimer = psWheel->psFireHead;
+		if(psTimer == THINKey_NULL)
+		{
+			psWheel->ppsFireTail = &psWheel->psFireHead;
+			THINKey_OSAL_vExitCritical();
+			break;
+		}
+		psWheel->psFireHead = psTimer->psFireNext;
+		if(psWheel->psFireHead == THINKey_NULL)
+			psWheel->ppsFireTail = &psWheel->psFireHead;
+		psTimer->ucFlags &= (THINKey_BYTE)~TKEY_OSAL_TIMER_LISTED;
+		if(psTimer->ucFlags & TKEY_OSAL_TIMER_PENDING)
+		{
+			psTimer->ucFlags &= (THINKey_BYTE)~TKEY_OSAL_TIMER_PENDING;
+			pfnCallback = psTimer->pfnCallback;
+		}
+		else if(psTimer->ucFlags & TKEY_OSAL_TIMER_RELEASED)
+		{
+			sDesc.pbData = (THINKey_BYTE *)psTimer;
+			sDesc.psPool = psTimer->psPool;
+		}
+		THINKey_OSAL_vExitCritical();
+
+		if(pfnCallback != THINKey_NULL)
+			pfnCallback((THINKey_HANDLE)psTimer);
+		else if(sDesc.psPool != THINKey_NULL)
+			THINKey_OSAL_vBufFree(&sDesc);
+	}
+
+	THINKey_OSAL_vEnterCritical();
+	uiWait = tkey_osal_wheel_next_ms(psWheel, uiNowMs);
+	psWheel->bWakeSet = (uiWait != THINKEY_OSAL_FOREVER);
+	psWheel->uiWakeAt = uiNowMs + uiWait;
+	THINKey_OSAL_vExitCritical();
+
+	return uiWait;
+}
+
+THINKey_UINT32 THINKey_OSAL_uiWheelNextMs(THINKey_OSAL_TimerWheel_t *psWheel,
+		THINKey_UINT32 uiNowMs)
+{
+	THINKey_UINT32 uiWait;
+
+	THINKey_OSAL_vEnterCritical();
+	uiWait = tkey_osal_wheel_next_ms(psWheel, uiNowMs);
+	THINKey_OSAL_vExitCritical();
+
+	return uiWait;
+}
+
+/* OSAL timers */
+
+THINKey_UINT32 THINKey_OSAL_uiTimerService(THINKey_UINT32 uiNowMs)
+{
+	return THINKey_OSAL_uiWheelProcess(&gsTimerWheel, uiNowMs);
+}
+
+/* Sets the wheel up with the first timer and starts the service task. A
+ * service that failed to start is tried again with the next timer. */
+static THINKey_eStatusType tkey_osal_timer_start_service(THINKey_VOID)
+{
+	THINKey_BOOL bStart;
+
+	THINKey_OSAL_vEnterCritical();
+	if(!gbTimerWheelReady)
+	{
+		THINKey_OSAL_vWheelInit(&gsTimerWheel, THINKey_OSAL_uiTimerPortNow());
+		(void)THINKEY_OSAL_INIT_STATIC_BUFPOOL(&gsTimerPool, gsTimers,
+				sizeof(THINKey_OSAL_TimerCb_t));
+		gbTimerWheelReady = THINKey_TRUE;
+	}
+	bStart = !gbTimerStarted;
+	gbTimerStarted = THINKey_TRUE;
+	THINKey_OSAL_vExitCritical();
+
+	if(bStart && (THINKey_OSAL_eTimerPortStart() != E_THINKEY_SUCCESS))
+	{
+		THINKey_OSAL_vEnterCritical();
+		gbTimerStarted = THINKey_FALSE;
+		THINKey_OSAL_vExitCritical();
+		return E_THINKEY_FAILURE;
+	}
+
+	return E_THINKEY_SUCCESS;
+}
+
+THINKey_HANDLE THINKey_OSAL_hCreateStaticTimer
+(THINKey_CONST_STRING strName, THINKey_pfnTimerCallback pfnTimerCallback,
+THINKey_HANDLE hCallerHandle, THINKey_BOOL bPeriodic,
+THINKey_OSAL_TimerCb_t* psTimerCb)
+{
+	if((psTimerCb == THINKey_NULL) || (pfnTimerCallback == THINKey_NULL) ||
+	   (tkey_osal_timer_start_service() != E_THINKEY_SUCCESS))
+		return THINKey_NULL;
+
+	THINKey_OSAL_vWheelTimerInit((THINKey_OSAL_Timer_t *)psTimerCb, strName,
+			pfnTimerCallback, hCallerHandle, bPeriodic, THINKey_NULL);
+
+	return (THINKey_HANDLE)psTimerCb;
+}
+
+THINKey_HANDLE THINKey_OSAL_hCreateTimer
+(THINKey_CONST_STRING strName, THINKey_pfnTimerCallback pfnTimerCallback,
+THINKey_HANDLE hCallerHandle, THINKey_BOOL bPeriodic)
+{
+	THINKey_OSAL_BufDesc_t sDesc;
+
+	if((pfnTimerCallback == THINKey_NULL) ||
+	   (tkey_osal_timer_start_service() != E_THINKEY_SUCCESS) ||
+	   (THINKey_OSAL_eBufAlloc(&gsTimerPool, &sDesc) != E_THINKEY_SUCCESS))
+		return THINKey_NULL;
+
+	THINKey_OSAL_vWheelTimerInit((THINKey_OSAL_Timer_t *)sDesc.pbData, strName,
+			pfnTimerCallback, hCallerHandle, bPeriodic, &gsTimerPool);
+
+	return (THINKey_HANDLE)sDesc.pbData;
+}
+
+THINKey_HANDLE THINKey_OSAL_hCreatePeriodicTimer
+(THINKey_pfnTimerCallback pfnTimerCallback, THINKey_HANDLE hCallerHandle)
+{
+	return THINKey_OSAL_hCreateTimer(PERIODIC_TIMER_NAME, pfnTimerCallback,
+			hCallerHandle, THINKey_TRUE);
+}
+
+THINKey_HANDLE THINKey_OSAL_hCreateOneShotTimer
+(THINKey_pfnTimerCallback pfnTimerCallback, THINKey_HANDLE hCallerHandle)
+{
+	return THINKey_OSAL_hCreateTimer(ONE_SHOT_TIMER_NAME, pfnTimerCallback,
+			hCallerHandle, THINKey_FALSE);
+}
+
+THINKey_HANDLE THINKey_OSAL_hCreateStaticPeriodicTimer
+(THINKey_pfnTimerCallback pfnTimerCallback, THINKey_HANDLE hCallerHandle,
+THINKey_OSAL_TimerCb_t* psTimerCb)
+{
+	return THINKey_OSAL_hCreateStaticTimer(PERIODIC_TIMER_NAME,
+			pfnTimerCallback, hCallerHandle, THINKey_TRUE, psTimerCb);
+}
+
+THINKey_HANDLE THINKey_OSAL_hCreateStaticOneShotTimer
+(THINKey_pfnTimerCallback pfnTimerCallback, THINKey_HANDLE hCallerHandle,
+THINKey_OSAL_TimerCb_t* psTimerCb)
+{
+	return THINKey_OSAL_hCreateStaticTimer(ONE_SHOT_TIMER_NAME,
+			pfnTimerCallback, hCallerHandle, THINKey_FALSE, psTimerCb);
+}
+
+THINKey_eStatusType THINKey_OSAL_eStartTimer
+(THINKey_HANDLE hTimerHandle, THINKey_UINT32 uiTimeInMilliSeconds)
+{
+	if(hTimerHandle == THINKey_NULL)
+		return E_THINKEY_FAILURE;
+
+	if(THINKey_OSAL_bWheelStart(&gsTimerWheel, (THINKey_OSAL_Timer_t *)hTimerHandle,
+			uiTimeInMilliSeconds, THINKey_OSAL_uiTimerPortNow()))
+		THINKey_OSAL_vTimerPortWake();
+
+	return E_THINKEY_SUCCESS;
+}
+
+THINKey_eStatusType THINKey_OSAL_eStopTimer (THINKey_HANDLE hTimerHandle)
+{
+	if(hTimerHandle == THINKey_NULL)
+		return E_THINKEY_FAILURE;
+
+	THINKey_OSAL_vWheelStop(&gsTimerWheel, (THINKey_OSAL_Timer_t *)hTimerHandle);
+
+	return E_THINKEY_SUCCESS;
+}
+
+/* Static timers are only stopped */
+THINKey_eStatusType THINKey_OSAL_eDestroyTimer (THINKey_HANDLE hTimerHandle)
+{
+	if(hTimerHandle == THINKey_NULL)
+		return E_THINKEY_FAILURE;
+
+	THINKey_OSAL_vWheelRelease(&gsTimerWheel, (THINKey_OSAL_Timer_t *)hTimerHandle);
+
+	return E_THINKEY_SUCCESS;
+}
+
+THINKey_CONST_STRING THINKey_OSAL_strTimerGetName
+(THINKey_HANDLE hTimerHandle)
+{
+	if(hTimerHandle == THINKey_NULL)
+		return THINKey_NULL;
+
+	return ((THINKey_OSAL_Timer_t *)hTimerHandle)->strName;
+}
+
+THINKey_VOID THINKey_OSAL_vTimerGetStats
+(THINKey_HANDLE hTimerHandle, THINKey_OSAL_TimerStats_t* psStats)
+{
+	if((hTimerHandle == THINKey_NULL) || (psStats == THINKey_NULL))
+		return;
+
+	THINKey_OSAL_vEnterCritical();
+	*psStats = ((THINKey_OSAL_Timer_t *)hTimerHandle)->sStats;
+	THINKey_OSAL_vExitCritical();
+}
+
+THINKey_UINT32 THINKey_OSAL_uiTimerNextExpiryMs(THINKey_VOID)
+{
+	if(!gbTimerWheelReady)
+		return THINKEY_OSAL_FOREVER;
+
+	return THINKey_OSAL_uiWheelNextMs(&gsTimerWheel, THINKey_OSAL_uiTimerPortNow());
+}
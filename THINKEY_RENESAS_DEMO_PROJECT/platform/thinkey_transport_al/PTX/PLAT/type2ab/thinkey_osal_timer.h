@@ -0,0 +1,135 @@
+/*
+ * \file thinkey_osal_timer.h
+ *
+ * \brief OSAL timer wheel, internal header file
+ *
+ * Between thinkey_osal_timer.c, the OSAL ports running its service and
+ * the timer benchmark; the rest of the code uses the timer calls of
+ * thinkey_osal.h.
+ *
+ * The wheel has TKEY_OSAL_WHEEL_LEVELS levels of 64 slots. A level 0 slot
+ * is one ms, a level 1 slot 64 ms, and so on: a timer goes to the lowest
+ * level whose span covers its remaining time, and moves down a level each
+ * time its slot comes round (cascading). Each level keeps a bit per slot
+ * in use, so the next slot with work is found with one count of trailing
+ * zeros per level, and idle time is skipped instead of stepped through.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_OSAL_TIMER_H
+#define THINKEY_OSAL_TIMER_H
+
+#include "thinkey_osal.h"
+
+#define TKEY_OSAL_WHEEL_LEVELS 4
+#define TKEY_OSAL_WHEEL_BITS 6
+#define TKEY_OSAL_WHEEL_SLOTS (1u << TKEY_OSAL_WHEEL_BITS)
+
+/* Not on the wheel */
+#define TKEY_OSAL_WHEEL_NO_LEVEL 0xFF
+
+/**
+ *  @brief A timer, in a THINKey_OSAL_TimerCb_t
+ */
+typedef struct tkey_osal_timer_s
+{
+    struct tkey_osal_timer_s *psNext;
+    struct tkey_osal_timer_s **ppsPrev;     /* link pointing to this timer */
+    struct tkey_osal_timer_s *psFireNext;
+    THINKey_pfnTimerCallback pfnCallback;
+    THINKey_CONST_STRING strName;
+    THINKey_HANDLE hCaller;
+    THINKey_OSAL_BufPool_t *psPool;         /* TKey_NULL for static timers */
+    THINKey_UINT32 uiExpiry;                /* ms */
+    THINKey_UINT32 uiPeriod;
+    THINKey_OSAL_TimerStats_t sStats;
+    THINKey_BYTE ucLevel;
+    THINKey_BYTE ucSlot;
+    THINKey_BYTE ucFlags;
+} THINKey_OSAL_Timer_t;
+
+/**
+ *  @brief A wheel and the timers due to be called back
+ */
+typedef struct
+{
+    THINKey_OSAL_Timer_t *apsSlot[TKEY_OSAL_WHEEL_LEVELS][TKEY_OSAL_WHEEL_SLOTS];
+    THINKey_UINT64 aullUsed[TKEY_OSAL_WHEEL_LEVELS];
+    THINKey_UINT32 uiNow;                   /* last ms processed */
+    THINKey_UINT32 uiWakeAt;                /* when the service runs next */
+    THINKey_BOOL bWakeSet;                  /* TKey_FALSE: it waits to be woken */
+    THINKey_OSAL_Timer_t *psFireHead;
+    THINKey_OSAL_Timer_t **ppsFireTail;
+} THINKey_OSAL_TimerWheel_t;
+
+/**
+ * \brief   Empties a wheel, starting at uiNowMs
+ */
+THINKey_VOID THINKey_OSAL_vWheelInit(THINKey_OSAL_TimerWheel_t *psWheel,
+        THINKey_UINT32 uiNowMs);
+
+/**
+ * \brief   Sets up a stopped timer
+ */
+THINKey_VOID THINKey_OSAL_vWheelTimerInit(THINKey_OSAL_Timer_t *psTimer,
+        THINKey_CONST_STRING strName, THINKey_pfnTimerCallback pfnTimerCallback,
+        THINKey_HANDLE hCallerHandle, THINKey_BOOL bPeriodic,
+        THINKey_OSAL_BufPool_t *psPool);
+
+/**
+ * \brief   (Re)starts a timer to expire uiPeriodMs from uiNowMs, and every
+ *          uiPeriodMs after that if it is periodic. Returns TKey_TRUE when
+ *          this is earlier than the service was going to run.
+ */
+THINKey_BOOL THINKey_OSAL_bWheelStart(THINKey_OSAL_TimerWheel_t *psWheel,
+        THINKey_OSAL_Timer_t *psTimer, THINKey_UINT32 uiPeriodMs,
+        THINKey_UINT32 uiNowMs);
+
+/**
+ * \brief   Stops a timer; a callback not made yet is dropped
+ */
+THINKey_VOID THINKey_OSAL_vWheelStop(THINKey_OSAL_TimerWheel_t *psWheel,
+        THINKey_OSAL_Timer_t *psTimer);
+
+/**
+ * \brief   Stops a timer for good and returns a pool timer to its pool,
+ *          at once or, while a callback is pending, once it is dropped
+ */
+THINKey_VOID THINKey_OSAL_vWheelRelease(THINKey_OSAL_TimerWheel_t *psWheel,
+        THINKey_OSAL_Timer_t *psTimer);
+
+/**
+ * \brief   Expires the timers due by uiNowMs and calls them back, in
+ *          expiry order. Returns the ms from uiNowMs until the wheel has
+ *          work again, THINKEY_OSAL_FOREVER if it has none.
+ */
+THINKey_UINT32 THINKey_OSAL_uiWheelProcess(THINKey_OSAL_TimerWheel_t *psWheel,
+        THINKey_UINT32 uiNowMs);
+
+/**
+ * \brief   Returns the ms from uiNowMs until the wheel has work, 0 if it is
+ *          late, THINKEY_OSAL_FOREVER if it has none
+ */
+THINKey_UINT32 THINKey_OSAL_uiWheelNextMs(THINKey_OSAL_TimerWheel_t *psWheel,
+        THINKey_UINT32 uiNowMs);
+
+/*
+ * Timer service port, provided with the rest of each OSAL port
+ */
+/* RTOS time in ms */
+THINKey_UINT32 THINKey_OSAL_uiTimerPortNow(THINKey_VOID);
+
+/* Creates the task calling THINKey_OSAL_uiTimerService() */
+THINKey_eStatusType THINKey_OSAL_eTimerPortStart(THINKey_VOID);
+
+/* Makes the service task call THINKey_OSAL_uiTimerService() again */
+THINKey_VOID THINKey_OSAL_vTimerPortWake(THINKey_VOID);
+
+/**
+ * \brief   Processes the OSAL timers. The service task calls it, then
+ *          waits for the ms returned or until woken.
+ */
+THINKey_UINT32 THINKey_OSAL_uiTimerService(THINKey_UINT32 uiNowMs);
+
+#endif /* THINKEY_OSAL_TIMER_H */
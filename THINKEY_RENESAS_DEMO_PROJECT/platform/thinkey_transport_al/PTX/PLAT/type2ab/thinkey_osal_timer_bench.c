@@ -0,0 +1,619 @@
+/*
+ * \file thinkey_osal_timer_bench.c
+ *
+ * \brief OSAL timer wheel benchmark and check
+ *
+ * Runs on a wheel and a clock of its own, not on the OSAL timer service:
+ * the timers are processed by calling THINKey_OSAL_uiWheelProcess() with
+ * the simulated time, so thousands of timers and hours of time take well
+ * under a second. The per timer approach it is compared with is a model
+ * of the RTOS timer task's list, kept sorted by expiry, which is walked on
+ * each start; both take the OSAL critical section per operation.
+ *
+ * On the target call TKey_OsalTimerBench_Report() from a task; on a Linux
+ * host build with THINKEY_HOST_BUILD and THINKEY_OSAL_TIMER_BENCH_MAIN,
+ * linked with the host OSAL, to get a standalone program.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_osal_timer_bench.h"
+#include "thinkey_osal.h"
+#include "thinkey_osal_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(THINKEY_OSAL_TIMER_BENCH_MAIN)
+#include <stdlib.h>
+#endif
+
+/* Timers of the larger cases, and of the check */
+#ifndef TKEY_OSAL_TIMER_BENCH_TIMERS
+#if defined(THINKEY_HOST_BUILD)
+#define TKEY_OSAL_TIMER_BENCH_TIMERS TKEY_OSAL_TIMER_BENCH_MAX_TIMERS
+#else
+#define TKEY_OSAL_TIMER_BENCH_TIMERS 1000
+#endif
+#endif
+#if TKEY_OSAL_TIMER_BENCH_TIMERS > TKEY_OSAL_TIMER_BENCH_MAX_TIMERS
+#error "TKEY_OSAL_TIMER_BENCH_TIMERS above TKEY_OSAL_TIMER_BENCH_MAX_TIMERS"
+#endif
+
+#define TKEY_OSAL_TIMER_BENCH_CASES 6
+#define TKEY_OSAL_TIMER_BENCH_NAME_SIZE 32
+#define TKEY_OSAL_TIMER_CHECK_START_MS 0xFFF00000u  /* wraps during the check */
+#define TKEY_OSAL_TIMER_CHECK_OPS 4                 /* per step */
+#define TKEY_OSAL_TIMER_CHECK_SEED 0x2545F491u
+
+/* Check failure bits */
+#define TKEY_OSAL_TIMER_CHECK_UNEXPECTED 0x01   /* not due, stopped or twice */
+#define TKEY_OSAL_TIMER_CHECK_TIME 0x02         /* not at its expiry */
+#define TKEY_OSAL_TIMER_CHECK_ORDER 0x04
+#define TKEY_OSAL_TIMER_CHECK_MISSED 0x08
+#define TKEY_OSAL_TIMER_CHECK_WAKE 0x10         /* would sleep past an expiry */
+#define TKEY_OSAL_TIMER_CHECK_RELEASE 0x20
+
+typedef enum
+{
+    E_TKEY_OSAL_TIMER_BENCH_START_STOP,
+    E_TKEY_OSAL_TIMER_BENCH_RESTART,
+    E_TKEY_OSAL_TIMER_BENCH_EXPIRE
+} TKey_OsalTimerBenchCase_t;
+
+static const TKey_CHAR *gapcBenchCases[] = {
+    "start_stop", "restart", "start_expire"
+};
+
+/* A timer of the sorted list model */
+typedef struct tkey_osal_timer_bench_item_s
+{
+    struct tkey_osal_timer_bench_item_s *psNext;
+    struct tkey_osal_timer_bench_item_s *psPrev;
+    TKey_UINT32 uiExpiry;
+    TKey_BOOL bArmed;
+} TKey_OsalTimerBenchItem_t;
+
+/* What the check expects of a timer */
+typedef struct
+{
+    TKey_UINT32 uiExpiry;
+    TKey_UINT32 uiPeriod;
+    TKey_BOOL bArmed;
+    TKey_BOOL bDue;             /* to be called back in this step */
+    TKey_BOOL bFired;
+} TKey_OsalTimerCheckModel_t;
+
+typedef struct
+{
+    TKey_UINT32 uiNow;
+    TKey_UINT32 uiLastExpiry;   /* of the previous callback in the step */
+    TKey_UINT32 uiRandom;
+    TKey_BOOL bExact;           /* the clock moved by one ms */
+    TKey_BOOL bAnyFired;
+    TKey_INT32 iStatus;
+    TKey_UINT32 uiCallbacks;
+    TKey_UINT32 uiStarts;
+    TKey_UINT32 uiStops;
+    TKey_UINT32 uiJumps;
+} TKey_OsalTimerCheck_t;
+
+static THINKey_OSAL_TimerWheel_t gsBenchWheel;
+static THINKey_OSAL_Timer_t gasBenchTimers[TKEY_OSAL_TIMER_BENCH_TIMERS];
+static TKey_OsalTimerBenchItem_t gasBenchItems[TKEY_OSAL_TIMER_BENCH_TIMERS];
+static TKey_OsalTimerBenchItem_t gsBenchList;
+static TKey_UINT32 gauiBenchDelay[TKEY_OSAL_TIMER_BENCH_TIMERS];
+static TKey_UINT32 guiBenchFired;
+static TKey_CHAR gaacBenchNames[TKEY_OSAL_TIMER_BENCH_CASES * 2][TKEY_OSAL_TIMER_BENCH_NAME_SIZE];
+
+static TKey_OsalTimerCheckModel_t gasCheckModel[TKEY_OSAL_TIMER_BENCH_TIMERS];
+static TKey_OsalTimerCheck_t gsCheck;
+
+THINKEY_OSAL_BUFPOOL_STORAGE(bench, gsCheckPool, 2, sizeof(THINKey_OSAL_TimerCb_t));
+static THINKey_OSAL_BufPool_t gsCheckPool;
+
+static TKey_UINT32 tkey_osal_timer_bench_random(TKey_UINT32 *puiState)
+{
+    TKey_UINT32 uiX = *puiState;
+
+    uiX ^= uiX << 13;
+    uiX ^= uiX >> 17;
+    uiX ^= uiX << 5;
+    *puiState = uiX;
+    return uiX;
+}
+
+/* Sorted list model */
+
+static TKey_VOID tkey_osal_timer_bench_list_init(TKey_UINT32 uiTimers)
+{
+    TKey_UINT32 uiIndex;
+
+    gsBenchList.psNext = &gsBenchList;
+    gsBenchList.psPrev = &gsBenchList;
+    for(uiIndex = 0; uiIndex < uiTimers; uiIndex++) {
+        gasBenchItems[uiIndex].bArmed = TKey_FALSE;
+    }
+}
+
+static TKey_VOID tkey_osal_timer_bench_list_unlink(TKey_OsalTimerBenchItem_t *psItem)
+{
+    psItem->psPrev->psNext = psItem->psNext;
+    psItem->psNext->psPrev = psItem->psPrev;
+    psItem->bArmed = TKey_FALSE;
+}
+
+static TKey_VOID tkey_osal_timer_bench_list_stop(TKey_OsalTimerBenchItem_t *psItem)
+{
+    THINKey_OSAL_vEnterCritical();
+    if(psItem->bArmed) {
+        tkey_osal_timer_bench_list_unlink(psItem);
+    }
+    THINKey_OSAL_vExitCritical();
+}
+
+/* Inserted after the timers expiring at the same time, as by the RTOS */
+static TKey_VOID tkey_osal_timer_bench_list_start(TKey_OsalTimerBenchItem_t *psItem,
+        TKey_UINT32 uiExpiry)
+{
+    TKey_OsalTimerBenchItem_t *psAfter;
+
+    THINKey_OSAL_vEnterCritical();
+    if(psItem->bArmed) {
+        tkey_osal_timer_bench_list_unlink(psItem);
+    }
+    psItem->uiExpiry = uiExpiry;
+    for(psAfter = &gsBenchList; psAfter->psNext != &gsBenchList;
+        psAfter = psAfter->psNext) {
+        if(psAfter->psNext->uiExpiry > uiExpiry) {
+            break;
+        }
+    }
+    psItem->psNext = psAfter->psNext;
+    psItem->psPrev = psAfter;
+    psAfter->psNext->psPrev = psItem;
+    psAfter->psNext = psItem;
+    psItem->bArmed = TKey_TRUE;
+    THINKey_OSAL_vExitCritical();
+}
+
+static TKey_VOID tkey_osal_timer_bench_list_process(TKey_UINT32 uiNowMs)
+{
+    TKey_OsalTimerBenchItem_t *psItem;
+
+    for(;;) {
+        THINKey_OSAL_vEnterCritical();
+        psItem = gsBenchList.psNext;
+        if((psItem == &gsBenchList) || (psItem->uiExpiry > uiNowMs)) {
+            THINKey_OSAL_vExitCritical();
+            return;
+        }
+        tkey_osal_timer_bench_list_unlink(psItem);
+        THINKey_OSAL_vExitCritical();
+        guiBenchFired++;
+    }
+}
+
+/* Wheel */
+
+static TKey_VOID tkey_osal_timer_bench_count(THINKey_HANDLE hTimer)
+{
+    (void)hTimer;
+    guiBenchFired++;
+}
+
+static TKey_VOID tkey_osal_timer_bench_wheel_init(TKey_UINT32 uiTimers)
+{
+    TKey_UINT32 uiIndex;
+
+    THINKey_OSAL_vWheelInit(&gsBenchWheel, 0);
+    for(uiIndex = 0; uiIndex < uiTimers; uiIndex++) {
+        THINKey_OSAL_vWheelTimerInit(&gasBenchTimers[uiIndex], "bench",
+                                     tkey_osal_timer_bench_count, THINKey_NULL,
+                                     THINKey_FALSE, THINKey_NULL);
+    }
+}
+
+/* Runs one iteration of a case and returns 0 when all the timers were
+ * stopped or fired */
+static TKey_INT32 tkey_osal_timer_bench_iteration(TKey_BenchResult_t *psRes,
+        TKey_OsalTimerBenchCase_t eCase, TKey_BOOL bWheel, TKey_UINT32 uiTimers,
+        TKey_UINT32 *puiRandom)
+{
+    TKey_UINT64 ullStart = 0;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiNow;
+
+    for(uiIndex = 0; uiIndex < uiTimers; uiIndex++) {
+        gauiBenchDelay[uiIndex] = 1 + tkey_osal_timer_bench_random(puiRandom) %
+                                      TKEY_OSAL_TIMER_BENCH_SPAN_MS;
+    }
+    if(bWheel) {
+        tkey_osal_timer_bench_wheel_init(uiTimers);
+    } else {
+        tkey_osal_timer_bench_list_init(uiTimers);
+    }
+    guiBenchFired = 0;
+
+    if(E_TKEY_OSAL_TIMER_BENCH_RESTART != eCase) {
+        ullStart = TKey_Bench_Now();
+    }
+    for(uiIndex = 0; uiIndex < uiTimers; uiIndex++) {
+        if(bWheel) {
+            (void)THINKey_OSAL_bWheelStart(&gsBenchWheel, &gasBenchTimers[uiIndex],
+                                           gauiBenchDelay[uiIndex], 0);
+        } else {
+            tkey_osal_timer_bench_list_start(&gasBenchItems[uiIndex],
+                                             gauiBenchDelay[uiIndex]);
+        }
+    }
+
+    if(E_TKEY_OSAL_TIMER_BENCH_RESTART == eCase) {
+        /* Every timer pushed back, as a protocol timeout would be */
+        ullStart = TKey_Bench_Now();
+        for(uiIndex = 0; uiIndex < uiTimers; uiIndex++) {
+            if(bWheel) {
+                (void)THINKey_OSAL_bWheelStart(&gsBenchWheel, &gasBenchTimers[uiIndex],
+                        gauiBenchDelay[uiTimers - 1 - uiIndex], 0);
+            } else {
+                tkey_osal_timer_bench_list_start(&gasBenchItems[uiIndex],
+                        gauiBenchDelay[uiTimers - 1 - uiIndex]);
+            }
+        }
+        TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+    }
+
+    if(E_TKEY_OSAL_TIMER_BENCH_EXPIRE == eCase) {
+        /* Ticked every ms, as the RTOS timer task would be */
+        for(uiNow = 1; uiNow <= TKEY_OSAL_TIMER_BENCH_SPAN_MS; uiNow++) {
+            if(bWheel) {
+                (void)THINKey_OSAL_uiWheelProcess(&gsBenchWheel, uiNow);
+            } else {
+                tkey_osal_timer_bench_list_process(uiNow);
+            }
+        }
+        TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+        return (guiBenchFired == uiTimers) ? 0 : 1;
+    }
+
+    for(uiIndex = 0; uiIndex < uiTimers; uiIndex++) {
+        if(bWheel) {
+            THINKey_OSAL_vWheelStop(&gsBenchWheel, &gasBenchTimers[uiIndex]);
+        } else {
+            tkey_osal_timer_bench_list_stop(&gasBenchItems[uiIndex]);
+        }
+    }
+    if(E_TKEY_OSAL_TIMER_BENCH_START_STOP == eCase) {
+        TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+    }
+
+    if(bWheel) {
+        return (THINKEY_OSAL_FOREVER == THINKey_OSAL_uiWheelNextMs(&gsBenchWheel, 0)) ? 0 : 1;
+    }
+    return (gsBenchList.psNext == &gsBenchList) ? 0 : 1;
+}
+
+/* Check */
+
+static TKey_UINT32 tkey_osal_timer_check_delay(TKey_UINT32 uiMin)
+{
+    TKey_UINT32 uiRoll = tkey_osal_timer_bench_random(&gsCheck.uiRandom) % 100;
+    TKey_UINT32 uiRange = 5000;
+
+    /* Mostly short, some for the higher levels, a few beyond the wheel */
+    if(uiRoll == 0) {
+        uiRange = 1u << 25;
+    } else if(uiRoll < 10) {
+        uiRange = 300000;
+    }
+    return uiMin + tkey_osal_timer_bench_random(&gsCheck.uiRandom) % uiRange;
+}
+
+static TKey_VOID tkey_osal_timer_check_start(TKey_UINT32 uiIndex, TKey_UINT32 uiDelay)
+{
+    TKey_OsalTimerCheckModel_t *psModel = &gasCheckModel[uiIndex];
+
+    (void)THINKey_OSAL_bWheelStart(&gsBenchWheel, &gasBenchTimers[uiIndex],
+                                   uiDelay, gsCheck.uiNow);
+    psModel->uiPeriod = (uiDelay != 0) ? uiDelay : 1;
+    psModel->uiExpiry = gsCheck.uiNow + psModel->uiPeriod;
+    psModel->bArmed = TKey_TRUE;
+    psModel->bDue = TKey_FALSE;
+    gsCheck.uiStarts++;
+}
+
+static TKey_VOID tkey_osal_timer_check_stop(TKey_UINT32 uiIndex)
+{
+    THINKey_OSAL_vWheelStop(&gsBenchWheel, &gasBenchTimers[uiIndex]);
+    gasCheckModel[uiIndex].bArmed = TKey_FALSE;
+    gasCheckModel[uiIndex].bDue = TKey_FALSE;
+    gsCheck.uiStops++;
+}
+
+static TKey_VOID tkey_osal_timer_check_callback(THINKey_HANDLE hTimer)
+{
+    THINKey_OSAL_Timer_t *psTimer = (THINKey_OSAL_Timer_t *)hTimer;
+    TKey_UINT32 uiIndex = (TKey_UINT32)(psTimer - gasBenchTimers);
+    TKey_OsalTimerCheckModel_t *psModel = &gasCheckModel[uiIndex];
+    TKey_UINT32 uiRoll;
+
+    gsCheck.uiCallbacks++;
+    if(!psModel->bArmed || !psModel->bDue || psModel->bFired) {
+        gsCheck.iStatus |= TKEY_OSAL_TIMER_CHECK_UNEXPECTED;
+        return;
+    }
+    if(gsCheck.bExact && (psModel->uiExpiry != gsCheck.uiNow)) {
+        gsCheck.iStatus |= TKEY_OSAL_TIMER_CHECK_TIME;
+    }
+    if(gsCheck.bAnyFired &&
+       ((TKey_INT32)(psModel->uiExpiry - gsCheck.uiLastExpiry) < 0)) {
+        gsCheck.iStatus |= TKEY_OSAL_TIMER_CHECK_ORDER;
+    }
+    gsCheck.uiLastExpiry = psModel->uiExpiry;
+    gsCheck.bAnyFired = TKey_TRUE;
+    psModel->bFired = TKey_TRUE;
+
+    if(psTimer->hCaller != THINKey_NULL) {
+        /* Periodic: the periods already gone are skipped */
+        psModel->uiExpiry += psModel->uiPeriod;
+        if((TKey_INT32)(psModel->uiExpiry - gsCheck.uiNow) <= 0) {
+            psModel->uiExpiry = gsCheck.uiNow + psModel->uiPeriod;
+        }
+    } else {
+        psModel->bArmed = TKey_FALSE;
+    }
+
+    /* Timers changed from callbacks, including ones still to be called */
+    uiRoll = tkey_osal_timer_bench_random(&gsCheck.uiRandom) % 8;
+    if(uiRoll == 0) {
+        tkey_osal_timer_check_start(uiIndex, tkey_osal_timer_check_delay(psTimer->hCaller ? 1 : 0));
+    } else if(uiRoll == 1) {
+        tkey_osal_timer_check_stop(tkey_osal_timer_bench_random(&gsCheck.uiRandom) %
+                                   TKEY_OSAL_TIMER_BENCH_TIMERS);
+    }
+}
+
+static TKey_VOID tkey_osal_timer_check_released(THINKey_HANDLE hTimer)
+{
+    (void)hTimer;
+    gsCheck.iStatus |= TKEY_OSAL_TIMER_CHECK_RELEASE;
+}
+
+/* Releases the pool timer after it, which is due in the same run */
+static TKey_VOID tkey_osal_timer_check_release(THINKey_HANDLE hTimer)
+{
+    THINKey_OSAL_vWheelRelease(&gsBenchWheel, (THINKey_OSAL_Timer_t *)
+                               ((THINKey_OSAL_Timer_t *)hTimer)->hCaller);
+    gsCheck.uiCallbacks++;
+}
+
+/* A pool timer released while its callback is pending is not called back,
+ * and goes back to the pool once the service has dropped it */
+static TKey_INT32 tkey_osal_timer_check_pool(TKey_VOID)
+{
+    THINKey_OSAL_BufPoolStats_t sStats;
+    THINKey_OSAL_BufDesc_t sDescA;
+    THINKey_OSAL_BufDesc_t sDescB;
+    THINKey_OSAL_Timer_t *psFirst;
+    THINKey_OSAL_Timer_t *psSecond;
+
+    if((E_THINKEY_SUCCESS != THINKEY_OSAL_INIT_STATIC_BUFPOOL(&gsCheckPool,
+            gsCheckPool, sizeof(THINKey_OSAL_TimerCb_t))) ||
+       (E_THINKEY_SUCCESS != THINKey_OSAL_eBufAlloc(&gsCheckPool, &sDescA)) ||
+       (E_THINKEY_SUCCESS != THINKey_OSAL_eBufAlloc(&gsCheckPool, &sDescB))) {
+        return TKEY_OSAL_TIMER_CHECK_RELEASE;
+    }
+    psFirst = (THINKey_OSAL_Timer_t *)sDescA.pbData;
+    psSecond = (THINKey_OSAL_Timer_t *)sDescB.pbData;
+
+    THINKey_OSAL_vWheelInit(&gsBenchWheel, gsCheck.uiNow);
+    THINKey_OSAL_vWheelTimerInit(psFirst, "first", tkey_osal_timer_check_release,
+                                 psSecond, THINKey_FALSE, &gsCheckPool);
+    THINKey_OSAL_vWheelTimerInit(psSecond, "second", tkey_osal_timer_check_released,
+                                 THINKey_NULL, THINKey_TRUE, &gsCheckPool);
+    (void)THINKey_OSAL_bWheelStart(&gsBenchWheel, psFirst, 5, gsCheck.uiNow);
+    (void)THINKey_OSAL_bWheelStart(&gsBenchWheel, psSecond, 6, gsCheck.uiNow);
+    gsCheck.uiNow += 10;
+    (void)THINKey_OSAL_uiWheelProcess(&gsBenchWheel, gsCheck.uiNow);
+    THINKey_OSAL_vWheelRelease(&gsBenchWheel, psFirst);
+
+    THINKey_OSAL_vBufPoolGetStats(&gsCheckPool, &sStats);
+    if((sStats.uiFree != sStats.uiBlocks) ||
+       (THINKEY_OSAL_FOREVER != THINKey_OSAL_uiWheelNextMs(&gsBenchWheel, gsCheck.uiNow))) {
+        return TKEY_OSAL_TIMER_CHECK_RELEASE;
+    }
+    return 0;
+}
+
+static TKey_INT32 tkey_osal_timer_check_run(TKey_BenchResult_t *psRes)
+{
+    TKey_OsalTimerCheckModel_t *psModel;
+    TKey_UINT64 ullStart;
+    TKey_UINT32 uiStep;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiOp;
+    TKey_UINT32 uiWait;
+    TKey_UINT32 uiNext;
+    TKey_BOOL bArmed;
+
+    memset(&gsCheck, 0, sizeof(gsCheck));
+    gsCheck.uiRandom = TKEY_OSAL_TIMER_CHECK_SEED;
+    gsCheck.uiNow = TKEY_OSAL_TIMER_CHECK_START_MS;
+    THINKey_OSAL_vWheelInit(&gsBenchWheel, gsCheck.uiNow);
+    /* The first half periodic, marked by a caller handle */
+    for(uiIndex = 0; uiIndex < TKEY_OSAL_TIMER_BENCH_TIMERS; uiIndex++) {
+        TKey_BOOL bPeriodic = (uiIndex < TKEY_OSAL_TIMER_BENCH_TIMERS / 2);
+
+        THINKey_OSAL_vWheelTimerInit(&gasBenchTimers[uiIndex], "check",
+                                     tkey_osal_timer_check_callback,
+                                     bPeriodic ? (THINKey_HANDLE)&gsCheck : THINKey_NULL,
+                                     bPeriodic, THINKey_NULL);
+        memset(&gasCheckModel[uiIndex], 0, sizeof(TKey_OsalTimerCheckModel_t));
+    }
+
+    ullStart = TKey_Bench_Now();
+    for(uiStep = 0; uiStep < TKEY_OSAL_TIMER_CHECK_STEPS; uiStep++) {
+        for(uiOp = 0; uiOp < TKEY_OSAL_TIMER_CHECK_OPS; uiOp++) {
+            uiIndex = tkey_osal_timer_bench_random(&gsCheck.uiRandom) %
+                      TKEY_OSAL_TIMER_BENCH_TIMERS;
+            if(tkey_osal_timer_bench_random(&gsCheck.uiRandom) % 10 < 7) {
+                tkey_osal_timer_check_start(uiIndex,
+                    tkey_osal_timer_check_delay(gasBenchTimers[uiIndex].hCaller ? 1 : 0));
+            } else {
+                tkey_osal_timer_check_stop(uiIndex);
+            }
+        }
+
+        /* Mostly one ms, some jumps, now and then beyond the wheel */
+        uiOp = tkey_osal_timer_bench_random(&gsCheck.uiRandom) % 10000;
+        if(uiOp == 0) {
+            gsCheck.uiNow += 1u << 24;
+            gsCheck.uiJumps++;
+            gsCheck.bExact = TKey_FALSE;
+        } else if(uiOp < 1000) {
+            gsCheck.uiNow += 2 + tkey_osal_timer_bench_random(&gsCheck.uiRandom) % 4000;
+            gsCheck.uiJumps++;
+            gsCheck.bExact = TKey_FALSE;
+        } else {
+            gsCheck.uiNow++;
+            gsCheck.bExact = TKey_TRUE;
+        }
+
+        for(uiIndex = 0; uiIndex < TKEY_OSAL_TIMER_BENCH_TIMERS; uiIndex++) {
+            psModel = &gasCheckModel[uiIndex];
+            psModel->bDue = psModel->bArmed &&
+                            ((TKey_INT32)(psModel->uiExpiry - gsCheck.uiNow) <= 0);
+            psModel->bFired = TKey_FALSE;
+        }
+        gsCheck.bAnyFired = TKey_FALSE;
+        uiWait = THINKey_OSAL_uiWheelProcess(&gsBenchWheel, gsCheck.uiNow);
+
+        /* Every due timer called back, and a wake before the next expiry */
+        bArmed = TKey_FALSE;
+        uiNext = THINKEY_OSAL_FOREVER;
+        for(uiIndex = 0; uiIndex < TKEY_OSAL_TIMER_BENCH_TIMERS; uiIndex++) {
+            psModel = &gasCheckModel[uiIndex];
+            if(psModel->bDue && !psModel->bFired) {
+                gsCheck.iStatus |= TKEY_OSAL_TIMER_CHECK_MISSED;
+            }
+            if(psModel->bArmed && (psModel->uiExpiry - gsCheck.uiNow < uiNext)) {
+                uiNext = psModel->uiExpiry - gsCheck.uiNow;
+                bArmed = TKey_TRUE;
+            }
+        }
+        if((bArmed && ((uiWait == 0) || (uiWait > uiNext))) ||
+           (!bArmed && (uiWait != THINKEY_OSAL_FOREVER))) {
+            gsCheck.iStatus |= TKEY_OSAL_TIMER_CHECK_WAKE;
+        }
+        if(gsCheck.iStatus != 0) {
+            break;
+        }
+    }
+    TKey_Bench_Record(psRes, ullStart, TKey_Bench_Now());
+
+    return gsCheck.iStatus | tkey_osal_timer_check_pool();
+}
+
+TKey_UINT32 TKey_OsalTimerBench_Run(TKey_BenchResult_t *psResults,
+                                    TKey_UINT32 uiMaxResults,
+                                    TKey_UINT32 uiIterations)
+{
+    static const TKey_UINT32 auiTimers[] = {
+        TKEY_OSAL_TIMER_BENCH_TIMERS / 4, TKEY_OSAL_TIMER_BENCH_TIMERS
+    };
+    TKey_BenchResult_t *psRes;
+    TKey_UINT32 uiCount = 0;
+    TKey_UINT32 uiRandom;
+    TKey_UINT32 uiSize;
+    TKey_UINT32 uiCase;
+    TKey_UINT32 uiWheel;
+    TKey_UINT32 uiIter;
+    TKey_CHAR *pcName;
+
+    if(0 == uiIterations) {
+        uiIterations = TKEY_OSAL_TIMER_BENCH_ITERATIONS;
+    }
+    TKey_Bench_TimerInit();
+
+    for(uiSize = 0; uiSize < sizeof(auiTimers) / sizeof(auiTimers[0]); uiSize++) {
+        for(uiCase = E_TKEY_OSAL_TIMER_BENCH_START_STOP;
+            uiCase <= E_TKEY_OSAL_TIMER_BENCH_EXPIRE; uiCase++) {
+            for(uiWheel = 0; uiWheel < 2; uiWheel++) {
+                if(uiCount >= uiMaxResults) {
+                    return uiCount;
+                }
+                psRes = &psResults[uiCount];
+                pcName = gaacBenchNames[uiCount++];
+                memset(psRes, 0, sizeof(TKey_BenchResult_t));
+                snprintf(pcName, TKEY_OSAL_TIMER_BENCH_NAME_SIZE, "%s_%s_%u",
+                         uiWheel ? "wheel" : "list", gapcBenchCases[uiCase],
+                         (unsigned)auiTimers[uiSize]);
+                psRes->pcSuite = "osal_timer";
+                psRes->pcName = pcName;
+
+                /* The same delays for the list and the wheel */
+                uiRandom = TKEY_OSAL_TIMER_CHECK_SEED + uiCase;
+                for(uiIter = 0; uiIter < uiIterations; uiIter++) {
+                    psRes->iStatus |= tkey_osal_timer_bench_iteration(psRes,
+                            (TKey_OsalTimerBenchCase_t)uiCase, (TKey_BOOL)uiWheel,
+                            auiTimers[uiSize], &uiRandom);
+                }
+            }
+        }
+    }
+
+    if(uiCount < uiMaxResults) {
+        psRes = &psResults[uiCount++];
+        memset(psRes, 0, sizeof(TKey_BenchResult_t));
+        psRes->pcSuite = "osal_timer";
+        psRes->pcName = "wheel_check";
+        psRes->iStatus = tkey_osal_timer_check_run(psRes);
+    }
+    return uiCount;
+}
+
+TKey_INT32 TKey_OsalTimerBench_Report(TKey_BenchPrint_t pfnPrint,
+                                      TKey_UINT32 uiIterations)
+{
+    static TKey_BenchResult_t sasResults[TKEY_OSAL_TIMER_BENCH_MAX_RESULTS];
+    TKey_CHAR acLine[TKEY_BENCH_LINE_SIZE];
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiIndex;
+    TKey_INT32 iFailed = 0;
+
+    uiCount = TKey_OsalTimerBench_Run(sasResults, TKEY_OSAL_TIMER_BENCH_MAX_RESULTS,
+                                      uiIterations);
+    TKey_Bench_PrintHeader(pfnPrint);
+    TKey_Bench_PrintResults(pfnPrint, sasResults, uiCount);
+    snprintf(acLine, sizeof(acLine),
+             "TKTIMER,check,timers=%u,callbacks=%u,starts=%u,stops=%u,jumps=%u,"
+             "status=0x%02x\n", (unsigned)TKEY_OSAL_TIMER_BENCH_TIMERS,
+             (unsigned)gsCheck.uiCallbacks, (unsigned)gsCheck.uiStarts,
+             (unsigned)gsCheck.uiStops, (unsigned)gsCheck.uiJumps,
+             (unsigned)gsCheck.iStatus);
+    pfnPrint(acLine);
+    for(uiIndex = 0; uiIndex < uiCount; uiIndex++) {
+        if(0 != sasResults[uiIndex].iStatus) {
+            iFailed++;
+        }
+    }
+    return iFailed;
+}
+
+#if defined(THINKEY_OSAL_TIMER_BENCH_MAIN)
+static TKey_VOID tkey_osal_timer_bench_print(const TKey_CHAR *pcLine)
+{
+    fputs(pcLine, stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    TKey_UINT32 uiIterations = 0;
+
+    if(argc > 1) {
+        uiIterations = (TKey_UINT32)strtoul(argv[1], TKey_NULL, 0);
+    }
+    return (0 == TKey_OsalTimerBench_Report(tkey_osal_timer_bench_print,
+                                            uiIterations)) ? 0 : 1;
+}
+#endif /* THINKEY_OSAL_TIMER_BENCH_MAIN */
@@ -0,0 +1,67 @@
+/*
+ * \file thinkey_osal_timer_bench.h
+ *
+ * \brief Header file for the OSAL timer wheel benchmark and check
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_OSAL_TIMER_BENCH_H
+#define THINKEY_OSAL_TIMER_BENCH_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_bench.h"
+
+/**
+ *  @brief Benchmark configuration. Each iteration starts every timer, at
+ *         up to TKEY_OSAL_TIMER_BENCH_SPAN_MS, and stops it or runs the
+ *         clock until they have all expired.
+ */
+#ifndef TKEY_OSAL_TIMER_BENCH_ITERATIONS
+#define TKEY_OSAL_TIMER_BENCH_ITERATIONS 10
+#endif
+#ifndef TKEY_OSAL_TIMER_BENCH_SPAN_MS
+#define TKEY_OSAL_TIMER_BENCH_SPAN_MS 10000
+#endif
+#define TKEY_OSAL_TIMER_BENCH_MAX_TIMERS 4000
+
+/**
+ *  @brief Check configuration: timers under random starts, stops and
+ *         clock jumps
+ */
+#ifndef TKEY_OSAL_TIMER_CHECK_TIMERS
+#define TKEY_OSAL_TIMER_CHECK_TIMERS 4000
+#endif
+#ifndef TKEY_OSAL_TIMER_CHECK_STEPS
+#define TKEY_OSAL_TIMER_CHECK_STEPS 200000
+#endif
+
+/**
+ *  @brief Three cases on the wheel and on the sorted list for each of
+ *         1000 and 4000 timers, and the check
+ */
+#define TKEY_OSAL_TIMER_BENCH_MAX_RESULTS 13
+
+/**
+ * \brief   Times starting and stopping, restarting and expiring many timers
+ *          on a timer wheel against a model of the sorted list of the RTOS
+ *          timer task, then runs the check: thousands of periodic and one
+ *          shot timers, started, restarted and stopped at random, also from
+ *          their callbacks, with the clock stepped by one ms or jumped. It
+ *          fails when a timer fires at the wrong time, out of order, twice,
+ *          after being stopped or not at all, when the wheel would sleep
+ *          past the next expiry, or when a released pool timer is called
+ *          back or not returned. Returns the number of results written.
+ */
+TKey_UINT32 TKey_OsalTimerBench_Run(TKey_BenchResult_t *psResults,
+                                    TKey_UINT32 uiMaxResults,
+                                    TKey_UINT32 uiIterations);
+
+/**
+ * \brief   Runs the suite and emits the CSV table through pfnPrint, with a
+ *          line of counters for the check. Returns 0 when every case passed.
+ */
+TKey_INT32 TKey_OsalTimerBench_Report(TKey_BenchPrint_t pfnPrint,
+                                      TKey_UINT32 uiIterations);
+
+#endif /* THINKEY_OSAL_TIMER_BENCH_H */
@@ -0,0 +1,164 @@
+/*
+ * \file thinkey_ble_conn.h
+ *
+ * \brief BLE connection context table header file
+ *
+ * One context per connected link holds its role, L2CAP channel, receive
+ * flow control, link policy and security state. Contexts live in a table
+ * sized at build time and are found from the connection handle in constant
+ * time through an open addressed map. A context is opened on connect and evicted on
+ * disconnect; its slot is then cleared and reused, with a new generation
+ * number so stale references can be told apart.
+ *
+ * The table is changed only by the task handling the BLE events, which may
+ * use the context pointers. Other tasks use TKey_BleConn_GetL2capCid().
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_BLE_CONN_H
+#define THINKEY_BLE_CONN_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_l2cap_flow.h"
+#include "thinkey_ble_link_policy.h"
+
+/**
+ *  @brief Table configuration
+ */
+#ifndef TKEY_BLE_CONN_MAX
+#define TKEY_BLE_CONN_MAX 8
+#endif
+#ifndef TKEY_BLE_CONN_HASH_SLOTS            /* power of two, >= 2 * TKEY_BLE_CONN_MAX */
+#define TKEY_BLE_CONN_HASH_SLOTS 16
+#endif
+
+#define TKEY_BLE_CONN_HANDLE_INVALID 0xFFFF /* BLE_CONN_HANDLE_INVALID */
+
+#if TKEY_BLE_CONN_MAX > 255
+#error "TKEY_BLE_CONN_MAX must fit the map entries"
+#endif
+#if TKEY_L2CAP_POOL_LINKS < TKEY_BLE_CONN_MAX
+#error "TKEY_L2CAP_POOL_LINKS must give every link its share of the L2CAP pool"
+#endif
+#if (TKEY_BLE_CONN_HASH_SLOTS & (TKEY_BLE_CONN_HASH_SLOTS - 1)) != 0 || \
+    TKEY_BLE_CONN_HASH_SLOTS < 2 * TKEY_BLE_CONN_MAX
+#error "TKEY_BLE_CONN_HASH_SLOTS must be a power of two of at least 2 * TKEY_BLE_CONN_MAX"
+#endif
+
+/**
+ *  @brief Connection table status codes
+ */
+typedef enum
+{
+    E_TKEY_BLE_CONN_SUCCESS,
+    E_TKEY_BLE_CONN_FAILURE,
+    E_TKEY_BLE_CONN_INVALID_ARG,
+    E_TKEY_BLE_CONN_NOT_FOUND,
+    E_TKEY_BLE_CONN_FULL
+} TKey_BleConnStatus_t;
+
+/**
+ *  @brief Peer of a connection
+ */
+typedef enum
+{
+    E_TKEY_BLE_CONN_ROLE_PHONE,         /* key device, over L2CAP */
+    E_TKEY_BLE_CONN_ROLE_TAB            /* dashboard tablet, over GATT */
+} TKey_BleConnRole_t;
+
+/**
+ *  @brief Link security state
+ */
+typedef enum
+{
+    E_TKEY_BLE_CONN_SEC_NONE,
+    E_TKEY_BLE_CONN_SEC_PAIRING,
+    E_TKEY_BLE_CONN_SEC_ENCRYPTED,
+    E_TKEY_BLE_CONN_SEC_BONDED
+} TKey_BleConnSecState_t;
+
+/**
+ *  @brief Connection context
+ */
+typedef struct
+{
+    TKey_UINT16 usConnHandle;
+    TKey_UINT16 usL2capCid;             /* 0 while no channel is set up */
+    TKey_UINT32 uiGeneration;
+    TKey_BYTE ucSlot;
+    TKey_BYTE ucRole;                   /* TKey_BleConnRole_t */
+    TKey_BYTE ucSecState;               /* TKey_BleConnSecState_t */
+    TKey_L2capFlow_t sL2capFlow;
+    TKey_BleLinkPolicy_t sLinkPolicy;   /* key devices only */
+} TKey_BleConn_t;
+
+/**
+ *  @brief Connection table statistics
+ */
+typedef struct
+{
+    TKey_UINT32 uiOpened;
+    TKey_UINT32 uiClosed;
+    TKey_UINT32 uiRejected;             /* connects finding the table full */
+    TKey_UINT32 uiActive;
+    TKey_UINT32 uiMaxActive;
+} TKey_BleConnStats_t;
+
+/**
+ * \brief   Closes all contexts
+ */
+TKey_VOID TKey_BleConn_Init(TKey_VOID);
+
+/**
+ * \brief   Opens the context of a new connection. A context still open for
+ *          the handle, from a missed disconnect, is reset and reused.
+ *
+ * \param   usConnHandle    Connection handle
+ * \param   eRole           Peer of the connection
+ * \param   ppsConn         Set to the context
+ *
+ * \return  E_TKEY_BLE_CONN_FULL when all contexts are in use; the caller
+ *          should then disconnect the link
+ */
+TKey_BleConnStatus_t TKey_BleConn_Open(TKey_UINT16 usConnHandle,
+        TKey_BleConnRole_t eRole, TKey_BleConn_t **ppsConn);
+
+/**
+ * \brief   Evicts the context of a closed connection, freeing its slot
+ */
+TKey_BleConnStatus_t TKey_BleConn_Close(TKey_UINT16 usConnHandle);
+
+/**
+ * \brief   Returns the context of a connection, TKey_NULL if none
+ */
+TKey_BleConn_t* TKey_BleConn_Find(TKey_UINT16 usConnHandle);
+
+/**
+ * \brief   Returns the first context with the given role, TKey_NULL if none
+ */
+TKey_BleConn_t* TKey_BleConn_FindByRole(TKey_BleConnRole_t eRole);
+
+/**
+ * \brief   Returns the uiIndex-th open context, TKey_NULL past the last
+ */
+TKey_BleConn_t* TKey_BleConn_GetByIndex(TKey_UINT32 uiIndex);
+
+/**
+ * \brief   Returns the L2CAP channel of a connection, for use outside the
+ *          BLE event task
+ */
+TKey_BleConnStatus_t TKey_BleConn_GetL2capCid(TKey_UINT16 usConnHandle,
+        TKey_UINT16 *pusCid);
+
+/**
+ * \brief   Returns the number of open contexts
+ */
+TKey_UINT32 TKey_BleConn_GetCount(TKey_VOID);
+
+/**
+ * \brief   Returns the connection table statistics
+ */
+TKey_VOID TKey_BleConn_GetStats(TKey_BleConnStats_t *psStats);
+
+#endif /* THINKEY_BLE_CONN_H */
@@ -0,0 +1,91 @@
+/*
+ * \file thinkey_ble_evt.h
+ *
+ * \brief BLE stack event batching header file
+ *
+ * The stack interrupt only marks events as pending and, when they were not
+ * already, asks for one wakeup of the task handling the BLE events. That
+ * task then drains whatever the stack has queued, at most
+ * TKEY_BLE_EVT_BATCH_MAX events per wakeup so other work on its queue is
+ * not held off, and asks for another wakeup when the batch was cut short.
+ * Events raised while a batch is drained are caught by a later wakeup, as
+ * the pending mark is cleared before the first event is fetched.
+ *
+ * Counters give the size of the batches and the time from the interrupt
+ * to the start of their drain, in TKey_Bench_TickUnit() ticks.
+ *
+ * Only host builds use the batching for now, against the BLE simulator:
+ * this port links no BLE stack, so thinkey_btal.c registers no fetch and
+ * its SD_EVT_IRQHandler still queues a wakeup per interrupt.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_BLE_EVT_H
+#define THINKEY_BLE_EVT_H
+
+#include "thinkey_platform_types.h"
+
+/**
+ *  @brief Batching configuration
+ */
+#ifndef TKEY_BLE_EVT_BATCH_MAX              /* events drained per wakeup */
+#define TKEY_BLE_EVT_BATCH_MAX 16
+#endif
+
+#if TKEY_BLE_EVT_BATCH_MAX == 0
+#error "TKEY_BLE_EVT_BATCH_MAX must be non zero"
+#endif
+
+/**
+ *  @brief Fetches one event from the stack and dispatches it
+ *         (sd_ble_evt_get and the observers). Returns TKey_FALSE when the
+ *         stack has none left.
+ */
+typedef TKey_BOOL (*TKey_BleEvtFetch_t)(TKey_VOID *pvContext);
+
+/**
+ *  @brief Event batching statistics
+ */
+typedef struct
+{
+    TKey_UINT32 uiIrqs;                 /* stack interrupts */
+    TKey_UINT32 uiWakeups;              /* task wakeups asked for */
+    TKey_UINT32 uiDrains;               /* batches drained */
+    TKey_UINT32 uiEvents;               /* events dispatched */
+    TKey_UINT32 uiEmptyDrains;          /* batches finding no event */
+    TKey_UINT32 uiCutShort;             /* batches stopped at the limit */
+    TKey_UINT32 uiMaxBatch;
+    TKey_UINT64 ullLatencyTotal;        /* interrupt to drain, summed */
+    TKey_UINT32 uiLatencyMax;
+} TKey_BleEvtStats_t;
+
+/**
+ * \brief   Sets the function draining the stack and clears the counters
+ */
+TKey_VOID TKey_BleEvt_Init(TKey_BleEvtFetch_t pfnFetch, TKey_VOID *pvContext);
+
+/**
+ * \brief   Marks stack events as pending. Called from the stack interrupt;
+ *          does not log or block.
+ *
+ * \return  TKey_TRUE if the task must be woken, once per batch
+ */
+TKey_BOOL TKey_BleEvt_IsrSignal(TKey_VOID);
+
+/**
+ * \brief   Drains the pending stack events, up to TKEY_BLE_EVT_BATCH_MAX.
+ *          Called by the task on each wakeup, and when it wakes for other
+ *          reasons, in case a wakeup could not be queued. Does nothing when
+ *          no event is pending.
+ *
+ * \return  TKey_TRUE if events were left for another wakeup
+ */
+TKey_BOOL TKey_BleEvt_Drain(TKey_VOID);
+
+/**
+ * \brief   Returns the event batching statistics
+ */
+TKey_VOID TKey_BleEvt_GetStats(TKey_BleEvtStats_t *psStats);
+
+#endif /* THINKEY_BLE_EVT_H */
@@ -0,0 +1,188 @@
+/*
+ * \file thinkey_ble_link_policy.h
+ *
+ * \brief BLE connection parameter and PHY policy header file
+ *
+ * Adapts a key device link to what it is doing. While a transaction is
+ * running (SDUs queued or exchanged in the last TKEY_BLE_POLICY_IDLE_MS)
+ * the link asks for a short interval without latency; once it has been
+ * quiet that long it falls back to a long interval with slave latency, so
+ * the radio wakes rarely but the peer can still reach us. The PHY is 2M,
+ * which halves the air time of each packet, and LE Coded (S8) while the
+ * filtered RSSI is below TKEY_BLE_POLICY_CODED_ENTER_DBM, to keep a
+ * distant device connected.
+ *
+ * Parameter and PHY requests are rate limited: the peer and the stack take
+ * several connection events to apply each one, and may refuse them.
+ *
+ * All calls for a link must come from the task handling the BLE events.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_BLE_LINK_POLICY_H
+#define THINKEY_BLE_LINK_POLICY_H
+
+#include "thinkey_platform_types.h"
+
+/**
+ *  @brief Policy configuration. Intervals in 1.25 ms units, timeouts in
+ *         10 ms units, as on the air.
+ */
+#ifndef TKEY_BLE_POLICY_BURST_INTERVAL_MIN
+#define TKEY_BLE_POLICY_BURST_INTERVAL_MIN 6    /* 7.5 ms */
+#endif
+#ifndef TKEY_BLE_POLICY_BURST_INTERVAL_MAX
+#define TKEY_BLE_POLICY_BURST_INTERVAL_MAX 12   /* 15 ms */
+#endif
+#ifndef TKEY_BLE_POLICY_IDLE_INTERVAL_MIN
+#define TKEY_BLE_POLICY_IDLE_INTERVAL_MIN 24    /* 30 ms */
+#endif
+#ifndef TKEY_BLE_POLICY_IDLE_INTERVAL_MAX
+#define TKEY_BLE_POLICY_IDLE_INTERVAL_MAX 40    /* 50 ms */
+#endif
+#ifndef TKEY_BLE_POLICY_IDLE_LATENCY
+#define TKEY_BLE_POLICY_IDLE_LATENCY 7
+#endif
+#ifndef TKEY_BLE_POLICY_SUP_TIMEOUT
+#define TKEY_BLE_POLICY_SUP_TIMEOUT 400         /* 4 s */
+#endif
+#ifndef TKEY_BLE_POLICY_IDLE_MS             /* quiet time before idling */
+#define TKEY_BLE_POLICY_IDLE_MS 2000
+#endif
+#ifndef TKEY_BLE_POLICY_BURST_GUARD_MS      /* between requests, entering a burst */
+#define TKEY_BLE_POLICY_BURST_GUARD_MS 250
+#endif
+#ifndef TKEY_BLE_POLICY_GUARD_MS            /* between other parameter requests */
+#define TKEY_BLE_POLICY_GUARD_MS 2000
+#endif
+#ifndef TKEY_BLE_POLICY_PHY_GUARD_MS        /* between PHY requests */
+#define TKEY_BLE_POLICY_PHY_GUARD_MS 5000
+#endif
+#ifndef TKEY_BLE_POLICY_CODED_ENTER_DBM
+#define TKEY_BLE_POLICY_CODED_ENTER_DBM (-85)
+#endif
+#ifndef TKEY_BLE_POLICY_CODED_EXIT_DBM
+#define TKEY_BLE_POLICY_CODED_EXIT_DBM (-77)
+#endif
+
+#if TKEY_BLE_POLICY_SUP_TIMEOUT * 10 <= \
+    2 * (1 + TKEY_BLE_POLICY_IDLE_LATENCY) * TKEY_BLE_POLICY_IDLE_INTERVAL_MAX * 5 / 4
+#error "TKEY_BLE_POLICY_SUP_TIMEOUT is too short for the idle interval and latency"
+#endif
+#if TKEY_BLE_POLICY_CODED_EXIT_DBM <= TKEY_BLE_POLICY_CODED_ENTER_DBM
+#error "TKEY_BLE_POLICY_CODED_EXIT_DBM must be above TKEY_BLE_POLICY_CODED_ENTER_DBM"
+#endif
+
+#define TKEY_BLE_POLICY_RSSI_NONE (-128)
+
+/**
+ *  @brief Link modes
+ */
+typedef enum
+{
+    E_TKEY_BLE_POLICY_MODE_NONE,        /* nothing requested yet */
+    E_TKEY_BLE_POLICY_MODE_BURST,
+    E_TKEY_BLE_POLICY_MODE_IDLE
+} TKey_BleLinkMode_t;
+
+/**
+ *  @brief PHYs, as the BLE_GAP_PHY_* bits
+ */
+typedef enum
+{
+    E_TKEY_BLE_POLICY_PHY_1M = 0x01,
+    E_TKEY_BLE_POLICY_PHY_2M = 0x02,
+    E_TKEY_BLE_POLICY_PHY_CODED = 0x04
+} TKey_BleLinkPhy_t;
+
+/**
+ *  @brief Connection parameters to request
+ */
+typedef struct
+{
+    TKey_UINT16 usIntervalMin;
+    TKey_UINT16 usIntervalMax;
+    TKey_UINT16 usLatency;
+    TKey_UINT16 usSupTimeout;
+} TKey_BleLinkParams_t;
+
+/**
+ *  @brief Requests connection parameters (sd_ble_gap_conn_param_update).
+ *         Returns TKey_FALSE if the request could not be made.
+ */
+typedef TKey_BOOL (*TKey_BleLinkSetParams_t)(TKey_VOID *pvContext,
+        const TKey_BleLinkParams_t *psParams);
+
+/**
+ *  @brief Requests a PHY (sd_ble_gap_phy_update). Returns TKey_FALSE if
+ *         the request could not be made.
+ */
+typedef TKey_BOOL (*TKey_BleLinkSetPhy_t)(TKey_VOID *pvContext,
+        TKey_BleLinkPhy_t ePhy);
+
+/**
+ *  @brief Policy statistics
+ */
+typedef struct
+{
+    TKey_UINT32 uiParamRequests;
+    TKey_UINT32 uiPhyRequests;
+    TKey_UINT32 uiRefused;              /* requests the stack did not take */
+    TKey_UINT32 uiDeferred;             /* updates holding a change back */
+    TKey_UINT32 uiBursts;
+} TKey_BleLinkStats_t;
+
+/**
+ *  @brief Policy state of one link, owned by the caller
+ */
+typedef struct
+{
+    TKey_BleLinkSetParams_t pfnSetParams;
+    TKey_BleLinkSetPhy_t pfnSetPhy;
+    TKey_VOID *pvContext;
+    TKey_BYTE ucMode;                   /* TKey_BleLinkMode_t requested */
+    TKey_BYTE ucPhy;                    /* TKey_BleLinkPhy_t requested */
+    TKey_INT32 iRssiQ;                  /* filtered, 1/16 dBm */
+    TKey_UINT32 uiLastActivityMs;
+    TKey_UINT32 uiLastParamsMs;
+    TKey_UINT32 uiLastPhyMs;
+    TKey_BleLinkStats_t sStats;
+} TKey_BleLinkPolicy_t;
+
+/**
+ * \brief   Starts the policy of a new link. The first Update() requests the
+ *          idle parameters and the 2M PHY.
+ */
+TKey_VOID TKey_BleLinkPolicy_Init(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_BleLinkSetParams_t pfnSetParams, TKey_BleLinkSetPhy_t pfnSetPhy,
+        TKey_VOID *pvContext, TKey_UINT32 uiNowMs);
+
+/**
+ * \brief   Notes an SDU sent or received on the link
+ */
+TKey_VOID TKey_BleLinkPolicy_Activity(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_UINT32 uiNowMs);
+
+/**
+ * \brief   Feeds an RSSI sample of the link, dBm
+ */
+TKey_VOID TKey_BleLinkPolicy_Rssi(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_INT32 iRssi);
+
+/**
+ * \brief   Chooses the mode and PHY and makes the requests the rate limits
+ *          allow. Called on activity and periodically.
+ *
+ * \param   uiQueueDepth    SDUs waiting on the link, either direction
+ */
+TKey_VOID TKey_BleLinkPolicy_Update(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_UINT32 uiQueueDepth, TKey_UINT32 uiNowMs);
+
+/**
+ * \brief   Returns the policy statistics of a link
+ */
+TKey_VOID TKey_BleLinkPolicy_GetStats(const TKey_BleLinkPolicy_t *psPolicy,
+        TKey_BleLinkStats_t *psStats);
+
+#endif /* THINKEY_BLE_LINK_POLICY_H */
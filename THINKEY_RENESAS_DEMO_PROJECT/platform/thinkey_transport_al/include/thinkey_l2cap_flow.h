@@ -0,0 +1,152 @@
+/*
+ * \file thinkey_l2cap_flow.h
+ *
+ * \brief L2CAP CoC receive flow control header file
+ *
+ * Sizes the receive side of an LE credit based channel to what the
+ * consumer of the L2CAP pool can take. MPS and MTU are fixed when the
+ * channel is set up: the MPS fills a link layer PDU of the negotiated data
+ * length so an SDU is not cut into many small K-frames, and the MTU is the
+ * pool buffer size. While the channel is open the number of receive
+ * buffers given to the stack follows the measured drain rate of the
+ * consumer and its queue depth (Little's law against
+ * TKEY_L2CAP_FLOW_LATENCY_MS), and the credits the stack keeps with the
+ * peer follow the buffers. When the consumer falls behind no buffer is
+ * given back, the stack stops granting credits and the peer waits; nothing
+ * is dropped. A channel never holds more than TKEY_L2CAP_POOL_LINK_BUFFERS,
+ * its share of the pool, so every open channel can have its full window.
+ *
+ * All calls for a channel must come from the task handling the BLE events.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_L2CAP_FLOW_H
+#define THINKEY_L2CAP_FLOW_H
+
+#include "thinkey_platform_types.h"
+#include "thinkey_l2cap_pool.h"
+
+/**
+ *  @brief Flow control configuration
+ */
+#define TKEY_L2CAP_FLOW_MTU_MIN 23          /* BLE_L2CAP_MTU_MIN */
+#define TKEY_L2CAP_FLOW_HEADER_SIZE 4       /* basic L2CAP header per K-frame */
+#define TKEY_L2CAP_FLOW_SDU_LEN_SIZE 2      /* SDU length in the first K-frame */
+#define TKEY_L2CAP_FLOW_CREDITS_DEFAULT 1   /* BLE_L2CAP_CREDITS_DEFAULT */
+
+#ifndef TKEY_L2CAP_FLOW_LATENCY_MS          /* queueing allowed per SDU */
+#define TKEY_L2CAP_FLOW_LATENCY_MS 40
+#endif
+#ifndef TKEY_L2CAP_FLOW_WINDOW_MS           /* drain rate sampling window */
+#define TKEY_L2CAP_FLOW_WINDOW_MS 20
+#endif
+
+#if TKEY_L2CAP_POOL_SDU_SIZE < TKEY_L2CAP_FLOW_MTU_MIN
+#error "TKEY_L2CAP_POOL_SDU_SIZE is below the minimum L2CAP MTU"
+#endif
+#if TKEY_L2CAP_FLOW_WINDOW_MS == 0 || TKEY_L2CAP_FLOW_LATENCY_MS == 0
+#error "TKEY_L2CAP_FLOW_WINDOW_MS and TKEY_L2CAP_FLOW_LATENCY_MS must be non zero"
+#endif
+
+/**
+ *  @brief Flow control status codes
+ */
+typedef enum
+{
+    E_TKEY_L2CAP_FLOW_SUCCESS,
+    E_TKEY_L2CAP_FLOW_FAILURE,
+    E_TKEY_L2CAP_FLOW_INVALID_ARG
+} TKey_L2capFlowStatus_t;
+
+/**
+ *  @brief Gives a receive buffer of usSize bytes to the stack
+ *         (sd_ble_l2cap_ch_rx). Returns TKey_FALSE if the stack refused it.
+ */
+typedef TKey_BOOL (*TKey_L2capFlowPost_t)(TKey_VOID *pvContext,
+        TKey_BYTE *pucBuf, TKey_UINT16 usSize);
+
+/**
+ *  @brief Sets the credits the stack keeps with the peer
+ *         (sd_ble_l2cap_ch_flow_control)
+ */
+typedef TKey_VOID (*TKey_L2capFlowCredits_t)(TKey_VOID *pvContext,
+        TKey_UINT16 usCredits);
+
+/**
+ *  @brief Receive parameters for the channel setup
+ */
+typedef struct
+{
+    TKey_UINT16 usRxMps;
+    TKey_UINT16 usRxMtu;
+} TKey_L2capFlowParams_t;
+
+/**
+ *  @brief Flow control statistics
+ */
+typedef struct
+{
+    TKey_UINT32 uiDrainRate;            /* SDUs per second, smoothed */
+    TKey_UINT32 uiQueueDepth;
+    TKey_UINT32 uiMaxQueueDepth;
+    TKey_UINT32 uiBackPressure;         /* times the buffers were withheld */
+    TKey_UINT16 usPosted;               /* buffers with the stack */
+    TKey_UINT16 usTarget;               /* receive window */
+    TKey_UINT16 usCredits;              /* credit target set on the stack */
+} TKey_L2capFlowStats_t;
+
+/**
+ *  @brief Flow control state of one channel, owned by the caller
+ */
+typedef struct
+{
+    TKey_L2capFlowPost_t pfnPost;
+    TKey_L2capFlowCredits_t pfnCredits;
+    TKey_VOID *pvContext;
+    TKey_L2capFlowParams_t sParams;
+    TKey_UINT32 uiWindowStartMs;
+    TKey_UINT32 uiWindowTaken;
+    TKey_BOOL bBackPressure;
+    TKey_L2capFlowStats_t sStats;
+} TKey_L2capFlow_t;
+
+/**
+ * \brief   Prepares the flow control of a channel being set up and returns
+ *          its receive parameters in psParams
+ *
+ * \param   psFlow          Channel state
+ * \param   usLinkPayload   Negotiated link layer data length (27..251)
+ * \param   pfnPost         Gives a receive buffer to the stack
+ * \param   pfnCredits      Sets the credits the stack keeps with the peer
+ * \param   pvContext       Passed to pfnPost and pfnCredits
+ * \param   uiNowMs         Current time
+ * \param   psParams        Receive parameters for the setup reply
+ */
+TKey_L2capFlowStatus_t TKey_L2capFlow_Init(TKey_L2capFlow_t *psFlow,
+        TKey_UINT16 usLinkPayload, TKey_L2capFlowPost_t pfnPost,
+        TKey_L2capFlowCredits_t pfnCredits, TKey_VOID *pvContext,
+        TKey_UINT32 uiNowMs, TKey_L2capFlowParams_t *psParams);
+
+/**
+ * \brief   Called when the stack is done with a receive buffer: filled with
+ *          an SDU, after TKey_L2capPool_RxDone() or
+ *          TKey_L2capPool_RxEvent(), or given back unused
+ */
+TKey_VOID TKey_L2capFlow_BufferDone(TKey_L2capFlow_t *psFlow);
+
+/**
+ * \brief   Samples the consumer, resizes the receive window and gives the
+ *          stack buffers up to it. Called after each received SDU and
+ *          periodically, so a stalled window reopens once the consumer
+ *          catches up.
+ */
+TKey_VOID TKey_L2capFlow_Update(TKey_L2capFlow_t *psFlow, TKey_UINT32 uiNowMs);
+
+/**
+ * \brief   Returns the flow control statistics of a channel
+ */
+TKey_VOID TKey_L2capFlow_GetStats(const TKey_L2capFlow_t *psFlow,
+        TKey_L2capFlowStats_t *psStats);
+
+#endif /* THINKEY_L2CAP_FLOW_H */
@@ -0,0 +1,160 @@
+/*
+ * \file thinkey_l2cap_pool.h
+ *
+ * \brief L2CAP SDU buffer pool header file
+ *
+ * Received L2CAP CoC SDUs are written by the BLE stack straight into pool
+ * buffers: a buffer is taken with TKey_L2capPool_Alloc() and handed to the
+ * stack (sd_ble_l2cap_ch_rx), and when the stack reports it filled,
+ * TKey_L2capPool_RxDone() queues a small descriptor of it to the consumer.
+ * The payload is never copied. Buffers are reference counted: the consumer
+ * releases the descriptor when done, and any task keeping the data longer
+ * retains it first.
+ *
+ * A receive path that signals data with its own event, such as
+ * E_THINKEY_DATA_RECEIVED on the transport event queue, passes the
+ * descriptor in the two event parameters instead: TKey_L2capPool_RxEvent()
+ * packs it in place of TKey_L2capPool_RxDone(), and the event handler
+ * unpacks it with TKey_L2capPool_FromEvent() and releases it once the
+ * payload is consumed. The low half of each parameter is the cid and the
+ * SDU length, as before the descriptor was added.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_L2CAP_POOL_H
+#define THINKEY_L2CAP_POOL_H
+
+#include "thinkey_platform_types.h"
+
+/**
+ *  @brief Pool configuration. Every channel has its own share of the pool,
+ *         so the credits one channel grants never take a buffer another
+ *         has promised its peer.
+ */
+#ifndef TKEY_L2CAP_POOL_LINKS               /* channels receiving at once */
+#define TKEY_L2CAP_POOL_LINKS 8
+#endif
+#ifndef TKEY_L2CAP_POOL_LINK_BUFFERS        /* receive buffers per channel */
+#define TKEY_L2CAP_POOL_LINK_BUFFERS 4
+#endif
+#define TKEY_L2CAP_POOL_BUFFERS \
+    (TKEY_L2CAP_POOL_LINKS * TKEY_L2CAP_POOL_LINK_BUFFERS)
+#ifndef TKEY_L2CAP_POOL_SDU_SIZE
+#define TKEY_L2CAP_POOL_SDU_SIZE 260
+#endif
+
+/**
+ *  @brief Pool status codes
+ */
+typedef enum
+{
+    E_TKEY_L2CAP_POOL_SUCCESS,
+    E_TKEY_L2CAP_POOL_FAILURE,
+    E_TKEY_L2CAP_POOL_INVALID_ARG,
+    E_TKEY_L2CAP_POOL_EMPTY,
+    E_TKEY_L2CAP_POOL_TIMEOUT
+} TKey_L2capPoolStatus_t;
+
+/**
+ *  @brief Descriptor of a received SDU, passed through the receive queue
+ */
+typedef struct
+{
+    TKey_BYTE *pucData;         /* in a pool buffer */
+    TKey_UINT16 usLen;
+    TKey_UINT16 usConnHandle;
+    TKey_UINT16 usCid;
+    TKey_UINT16 usBuffer;       /* pool index */
+} TKey_L2capSdu_t;
+
+/**
+ *  @brief Pool statistics
+ */
+typedef struct
+{
+    TKey_UINT32 uiAllocs;
+    TKey_UINT32 uiAllocFails;
+    TKey_UINT32 uiRxSdus;
+    TKey_UINT32 uiRxBytes;
+    TKey_UINT32 uiRxTaken;      /* descriptors taken by the consumer,
+                                   from the queue or from an event */
+    TKey_UINT32 uiFree;
+    TKey_UINT32 uiMinFree;
+} TKey_L2capPoolStats_t;
+
+/**
+ * \brief   Marks all buffers free and creates the receive queue
+ */
+TKey_L2capPoolStatus_t TKey_L2capPool_Init(TKey_VOID);
+
+/**
+ * \brief   Takes a free buffer of TKEY_L2CAP_POOL_SDU_SIZE bytes for the
+ *          stack to receive into, with one reference. Returns TKey_NULL
+ *          when none is free.
+ */
+TKey_BYTE* TKey_L2capPool_Alloc(TKey_VOID);
+
+/**
+ * \brief   Called when the stack filled a buffer with an SDU of usLen
+ *          bytes: queues its descriptor to the consumer, passing on the
+ *          reference taken by TKey_L2capPool_Alloc()
+ */
+TKey_L2capPoolStatus_t TKey_L2capPool_RxDone(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_BYTE *pucData, TKey_UINT16 usLen);
+
+/**
+ * \brief   Called when the stack filled a buffer with an SDU of usLen
+ *          bytes, for a receive path that posts its own event: packs the
+ *          descriptor into *puiParam1 and *puiParam2 of the event, passing
+ *          on the reference taken by TKey_L2capPool_Alloc(). If the event
+ *          cannot be posted, the caller takes the descriptor back with
+ *          TKey_L2capPool_FromEvent() and releases it.
+ */
+TKey_L2capPoolStatus_t TKey_L2capPool_RxEvent(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_BYTE *pucData, TKey_UINT16 usLen,
+        TKey_UINT32 *puiParam1, TKey_UINT32 *puiParam2);
+
+/**
+ * \brief   Unpacks the descriptor carried by an event parameter pair from
+ *          TKey_L2capPool_RxEvent(). The event handler owns one reference
+ *          and must release it.
+ */
+TKey_L2capPoolStatus_t TKey_L2capPool_FromEvent(TKey_UINT32 uiParam1,
+        TKey_UINT32 uiParam2, TKey_L2capSdu_t *psSdu);
+
+/**
+ * \brief   Takes the next received SDU, waiting up to uiTimeoutMs. The
+ *          consumer owns one reference and must release it.
+ */
+TKey_L2capPoolStatus_t TKey_L2capPool_Receive(TKey_L2capSdu_t *psSdu,
+        TKey_UINT32 uiTimeoutMs);
+
+/**
+ * \brief   Adds a reference to the buffer of a received SDU
+ */
+TKey_VOID TKey_L2capPool_Retain(const TKey_L2capSdu_t *psSdu);
+
+/**
+ * \brief   Drops a reference to the buffer of a received SDU; the buffer
+ *          is free again when the last one is dropped
+ */
+TKey_VOID TKey_L2capPool_Release(const TKey_L2capSdu_t *psSdu);
+
+/**
+ * \brief   Frees a buffer taken by TKey_L2capPool_Alloc() that the stack
+ *          gave back unused, such as on channel release
+ */
+TKey_VOID TKey_L2capPool_Free(TKey_BYTE *pucData);
+
+/**
+ * \brief   Returns the number of free buffers
+ */
+TKey_UINT32 TKey_L2capPool_GetFree(TKey_VOID);
+
+/**
+ * \brief   Returns the pool statistics
+ */
+TKey_VOID TKey_L2capPool_GetStats(TKey_L2capPoolStats_t *psStats);
+
+#endif /* THINKEY_L2CAP_POOL_H */
@@ -0,0 +1,256 @@
+/*
+ * \file thinkey_ble_conn.c
+ *
+ * \brief BLE connection context table
+ *
+ * aucByHandle is a linear probing hash table of slot + 1 (0 when empty)
+ * keyed by the connection handle. Connections come and go all the time, so
+ * an entry is removed by shifting the rest of its cluster back rather than
+ * by rebuilding the table or leaving tombstones. aucOpen lists the open
+ * slots densely, for iteration. The map is changed in critical sections so
+ * other tasks can look up a channel while it changes.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_BLE
+
+#include "thinkey_ble_conn.h"
+#include "thinkey_osal.h"
+#include "thinkey_debug.h"
+#include <string.h>
+
+typedef struct
+{
+    TKey_UINT32 uiCount;
+    TKey_UINT32 uiGeneration;
+    TKey_BYTE aucByHandle[TKEY_BLE_CONN_HASH_SLOTS];
+    TKey_BYTE aucOpen[TKEY_BLE_CONN_MAX];
+    TKey_BOOL abUsed[TKEY_BLE_CONN_MAX];
+    TKey_BleConn_t asConn[TKEY_BLE_CONN_MAX];
+    TKey_BleConnStats_t sStats;
+} TKey_BleConnTable_t;
+
+static TKey_BleConnTable_t gsBleConn;
+
+static TKey_UINT32 tkey_ble_conn_bucket(TKey_UINT16 usConnHandle)
+{
+    return ((usConnHandle * 0x9E3779B1u) >> 16) & (TKEY_BLE_CONN_HASH_SLOTS - 1);
+}
+
+/* Map position of a handle, TKEY_BLE_CONN_HASH_SLOTS if absent */
+static TKey_UINT32 tkey_ble_conn_lookup(TKey_UINT16 usConnHandle)
+{
+    TKey_UINT32 uiBucket = tkey_ble_conn_bucket(usConnHandle);
+
+    while(0 != gsBleConn.aucByHandle[uiBucket]) {
+        if(gsBleConn.asConn[gsBleConn.aucByHandle[uiBucket] - 1].usConnHandle ==
+           usConnHandle) {
+            return uiBucket;
+        }
+        uiBucket = (uiBucket + 1) & (TKEY_BLE_CONN_HASH_SLOTS - 1);
+    }
+    return TKEY_BLE_CONN_HASH_SLOTS;
+}
+
+static TKey_VOID tkey_ble_conn_map_insert(TKey_BYTE ucSlot)
+{
+    TKey_UINT32 uiBucket = tkey_ble_conn_bucket(gsBleConn.asConn[ucSlot].usConnHandle);
+
+    while(0 != gsBleConn.aucByHandle[uiBucket]) {
+        uiBucket = (uiBucket + 1) & (TKEY_BLE_CONN_HASH_SLOTS - 1);
+    }
+    gsBleConn.aucByHandle[uiBucket] = ucSlot + 1;
+}
+
+static TKey_VOID tkey_ble_conn_map_remove(TKey_UINT32 uiHole)
+{
+    TKey_UINT32 uiNext = uiHole;
+    TKey_UINT32 uiHome;
+
+    gsBleConn.aucByHandle[uiHole] = 0;
+    for(;;) {
+        uiNext = (uiNext + 1) & (TKEY_BLE_CONN_HASH_SLOTS - 1);
+        if(0 == gsBleConn.aucByHandle[uiNext]) {
+            break;
+        }
+        uiHome = tkey_ble_conn_bucket(
+                gsBleConn.asConn[gsBleConn.aucByHandle[uiNext] - 1].usConnHandle);
+        /* Stays unless its home lies cyclically outside (hole, next] */
+        if(((uiNext - uiHome) & (TKEY_BLE_CONN_HASH_SLOTS - 1)) >=
+           ((uiNext - uiHole) & (TKEY_BLE_CONN_HASH_SLOTS - 1))) {
+            gsBleConn.aucByHandle[uiHole] = gsBleConn.aucByHandle[uiNext];
+            gsBleConn.aucByHandle[uiNext] = 0;
+            uiHole = uiNext;
+        }
+    }
+}
+
+static TKey_VOID tkey_ble_conn_reset(TKey_BleConn_t *psConn,
+        TKey_UINT16 usConnHandle, TKey_BleConnRole_t eRole)
+{
+    TKey_BYTE ucSlot = psConn->ucSlot;
+
+    memset(psConn, 0, sizeof(*psConn));
+    psConn->usConnHandle = usConnHandle;
+    psConn->uiGeneration = ++gsBleConn.uiGeneration;
+    psConn->ucSlot = ucSlot;
+    psConn->ucRole = (TKey_BYTE)eRole;
+    psConn->ucSecState = E_TKEY_BLE_CONN_SEC_NONE;
+}
+
+TKey_VOID TKey_BleConn_Init(TKey_VOID)
+{
+    TKey_UINT32 uiSlot;
+
+    THINKey_OSAL_vEnterCritical();
+    memset(&gsBleConn, 0, sizeof(gsBleConn));
+    for(uiSlot = 0; uiSlot < TKEY_BLE_CONN_MAX; uiSlot++) {
+        gsBleConn.asConn[uiSlot].ucSlot = (TKey_BYTE)uiSlot;
+        gsBleConn.asConn[uiSlot].usConnHandle = TKEY_BLE_CONN_HANDLE_INVALID;
+    }
+    THINKey_OSAL_vExitCritical();
+}
+
+TKey_BleConnStatus_t TKey_BleConn_Open(TKey_UINT16 usConnHandle,
+        TKey_BleConnRole_t eRole, TKey_BleConn_t **ppsConn)
+{
+    TKey_BleConn_t *psConn;
+    TKey_UINT32 uiPos;
+    TKey_UINT32 uiSlot;
+
+    if(TKEY_BLE_CONN_HANDLE_INVALID == usConnHandle || TKey_NULL == ppsConn) {
+        return E_TKEY_BLE_CONN_INVALID_ARG;
+    }
+    uiPos = tkey_ble_conn_lookup(usConnHandle);
+    if(TKEY_BLE_CONN_HASH_SLOTS != uiPos) {
+        psConn = &gsBleConn.asConn[gsBleConn.aucByHandle[uiPos] - 1];
+        THINKEY_DEBUG_WARNING("BLE conn: handle %d reopened", usConnHandle);
+        THINKey_OSAL_vEnterCritical();
+        tkey_ble_conn_reset(psConn, usConnHandle, eRole);
+        THINKey_OSAL_vExitCritical();
+        *ppsConn = psConn;
+        return E_TKEY_BLE_CONN_SUCCESS;
+    }
+    for(uiSlot = 0; uiSlot < TKEY_BLE_CONN_MAX; uiSlot++) {
+        if(!gsBleConn.abUsed[uiSlot]) {
+            break;
+        }
+    }
+    if(TKEY_BLE_CONN_MAX == uiSlot) {
+        gsBleConn.sStats.uiRejected++;
+        return E_TKEY_BLE_CONN_FULL;
+    }
+
+    psConn = &gsBleConn.asConn[uiSlot];
+    THINKey_OSAL_vEnterCritical();
+    tkey_ble_conn_reset(psConn, usConnHandle, eRole);
+    gsBleConn.abUsed[uiSlot] = TKey_TRUE;
+    gsBleConn.aucOpen[gsBleConn.uiCount++] = (TKey_BYTE)uiSlot;
+    tkey_ble_conn_map_insert((TKey_BYTE)uiSlot);
+    gsBleConn.sStats.uiOpened++;
+    gsBleConn.sStats.uiActive = gsBleConn.uiCount;
+    if(gsBleConn.uiCount > gsBleConn.sStats.uiMaxActive) {
+        gsBleConn.sStats.uiMaxActive = gsBleConn.uiCount;
+    }
+    THINKey_OSAL_vExitCritical();
+    *ppsConn = psConn;
+    return E_TKEY_BLE_CONN_SUCCESS;
+}
+
+TKey_BleConnStatus_t TKey_BleConn_Close(TKey_UINT16 usConnHandle)
+{
+    TKey_BleConn_t *psConn;
+    TKey_UINT32 uiPos;
+    TKey_UINT32 uiIndex;
+
+    uiPos = tkey_ble_conn_lookup(usConnHandle);
+    if(TKEY_BLE_CONN_HASH_SLOTS == uiPos) {
+        return E_TKEY_BLE_CONN_NOT_FOUND;
+    }
+    psConn = &gsBleConn.asConn[gsBleConn.aucByHandle[uiPos] - 1];
+    if(0 != psConn->sL2capFlow.sStats.usPosted) {
+        THINKEY_DEBUG_WARNING("BLE conn: handle %d closed holding %d buffers",
+                              usConnHandle, psConn->sL2capFlow.sStats.usPosted);
+    }
+
+    THINKey_OSAL_vEnterCritical();
+    tkey_ble_conn_map_remove(uiPos);
+    for(uiIndex = 0; uiIndex < gsBleConn.uiCount; uiIndex++) {
+        if(gsBleConn.aucOpen[uiIndex] == psConn->ucSlot) {
+            gsBleConn.aucOpen[uiIndex] = gsBleConn.aucOpen[--gsBleConn.uiCount];
+            break;
+        }
+    }
+    gsBleConn.abUsed[psConn->ucSlot] = TKey_FALSE;
+    tkey_ble_conn_reset(psConn, TKEY_BLE_CONN_HANDLE_INVALID,
+                        E_TKEY_BLE_CONN_ROLE_PHONE);
+    gsBleConn.sStats.uiClosed++;
+    gsBleConn.sStats.uiActive = gsBleConn.uiCount;
+    THINKey_OSAL_vExitCritical();
+    return E_TKEY_BLE_CONN_SUCCESS;
+}
+
+TKey_BleConn_t* TKey_BleConn_Find(TKey_UINT16 usConnHandle)
+{
+    TKey_UINT32 uiPos = tkey_ble_conn_lookup(usConnHandle);
+
+    if(TKEY_BLE_CONN_HASH_SLOTS == uiPos) {
+        return TKey_NULL;
+    }
+    return &gsBleConn.asConn[gsBleConn.aucByHandle[uiPos] - 1];
+}
+
+TKey_BleConn_t* TKey_BleConn_FindByRole(TKey_BleConnRole_t eRole)
+{
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < gsBleConn.uiCount; uiIndex++) {
+        if(gsBleConn.asConn[gsBleConn.aucOpen[uiIndex]].ucRole == (TKey_BYTE)eRole) {
+            return &gsBleConn.asConn[gsBleConn.aucOpen[uiIndex]];
+        }
+    }
+    return TKey_NULL;
+}
+
+TKey_BleConn_t* TKey_BleConn_GetByIndex(TKey_UINT32 uiIndex)
+{
+    if(uiIndex >= gsBleConn.uiCount) {
+        return TKey_NULL;
+    }
+    return &gsBleConn.asConn[gsBleConn.aucOpen[uiIndex]];
+}
+
+TKey_BleConnStatus_t TKey_BleConn_GetL2capCid(TKey_UINT16 usConnHandle,
+        TKey_UINT16 *pusCid)
+{
+    TKey_BleConnStatus_t eStatus = E_TKEY_BLE_CONN_NOT_FOUND;
+    TKey_UINT32 uiPos;
+
+    if(TKey_NULL == pusCid) {
+        return E_TKEY_BLE_CONN_INVALID_ARG;
+    }
+    THINKey_OSAL_vEnterCritical();
+    uiPos = tkey_ble_conn_lookup(usConnHandle);
+    if(TKEY_BLE_CONN_HASH_SLOTS != uiPos) {
+        *pusCid = gsBleConn.asConn[gsBleConn.aucByHandle[uiPos] - 1].usL2capCid;
+        if(0 != *pusCid) {
+            eStatus = E_TKEY_BLE_CONN_SUCCESS;
+        }
+    }
+    THINKey_OSAL_vExitCritical();
+    return eStatus;
+}
+
+TKey_UINT32 TKey_BleConn_GetCount(TKey_VOID)
+{
+    return gsBleConn.uiCount;
+}
+
+TKey_VOID TKey_BleConn_GetStats(TKey_BleConnStats_t *psStats)
+{
+    THINKey_OSAL_vEnterCritical();
+    *psStats = gsBleConn.sStats;
+    THINKey_OSAL_vExitCritical();
+}
@@ -0,0 +1,129 @@
+/*
+ * \file thinkey_ble_evt.c
+ *
+ * \brief BLE stack event batching
+ *
+ * The pending mark and the time it was set are shared with the stack
+ * interrupt. The task takes them in a critical section, which masks that
+ * interrupt; the interrupt itself needs no lock on the target. On host
+ * builds the interrupt is simulated by another thread, so it takes the
+ * critical section too.
+ *
+ * The interrupt is time stamped from the low word of the DWT cycle counter
+ * rather than TKey_Bench_Now(), whose wrap tracking is not reentrant.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_ble_evt.h"
+#include "thinkey_osal.h"
+#include "thinkey_bench.h"
+#include <string.h>
+
+#if defined(THINKEY_HOST_BUILD)
+#define TKEY_BLE_EVT_NOW()          ((TKey_UINT32)TKey_Bench_Now())
+#define TKEY_BLE_EVT_ISR_ENTER()    THINKey_OSAL_vEnterCritical()
+#define TKEY_BLE_EVT_ISR_EXIT()     THINKey_OSAL_vExitCritical()
+#else
+#include "bsp_api.h"
+#define TKEY_BLE_EVT_NOW()          (DWT->CYCCNT)
+#define TKEY_BLE_EVT_ISR_ENTER()
+#define TKEY_BLE_EVT_ISR_EXIT()
+#endif
+
+typedef struct
+{
+    TKey_BleEvtFetch_t pfnFetch;
+    TKey_VOID *pvContext;
+    volatile TKey_BOOL bPending;
+    volatile TKey_UINT32 uiPendingSince;
+    TKey_BleEvtStats_t sStats;
+} TKey_BleEvtState_t;
+
+static TKey_BleEvtState_t gsBleEvt;
+
+TKey_VOID TKey_BleEvt_Init(TKey_BleEvtFetch_t pfnFetch, TKey_VOID *pvContext)
+{
+    TKey_Bench_TimerInit();
+    THINKey_OSAL_vEnterCritical();
+    memset(&gsBleEvt, 0, sizeof(gsBleEvt));
+    gsBleEvt.pfnFetch = pfnFetch;
+    gsBleEvt.pvContext = pvContext;
+    THINKey_OSAL_vExitCritical();
+}
+
+TKey_BOOL TKey_BleEvt_IsrSignal(TKey_VOID)
+{
+    TKey_BOOL bWake = TKey_FALSE;
+
+    TKEY_BLE_EVT_ISR_ENTER();
+    gsBleEvt.sStats.uiIrqs++;
+    if(!gsBleEvt.bPending) {
+        gsBleEvt.uiPendingSince = TKEY_BLE_EVT_NOW();
+        gsBleEvt.bPending = TKey_TRUE;
+        gsBleEvt.sStats.uiWakeups++;
+        bWake = TKey_TRUE;
+    }
+    TKEY_BLE_EVT_ISR_EXIT();
+    return bWake;
+}
+
+TKey_BOOL TKey_BleEvt_Drain(TKey_VOID)
+{
+    TKey_UINT32 uiLatency;
+    TKey_UINT32 uiBatch = 0;
+    TKey_BOOL bMore = TKey_FALSE;
+
+    if(TKey_NULL == gsBleEvt.pfnFetch) {
+        return TKey_FALSE;
+    }
+    THINKey_OSAL_vEnterCritical();
+    if(!gsBleEvt.bPending) {
+        THINKey_OSAL_vExitCritical();
+        return TKey_FALSE;
+    }
+    /* Cleared before fetching: an interrupt from here on wakes us again */
+    gsBleEvt.bPending = TKey_FALSE;
+    uiLatency = TKEY_BLE_EVT_NOW() - gsBleEvt.uiPendingSince;
+    THINKey_OSAL_vExitCritical();
+
+    while(uiBatch < TKEY_BLE_EVT_BATCH_MAX) {
+        if(!gsBleEvt.pfnFetch(gsBleEvt.pvContext)) {
+            break;
+        }
+        uiBatch++;
+    }
+
+    THINKey_OSAL_vEnterCritical();
+    if(TKEY_BLE_EVT_BATCH_MAX == uiBatch) {
+        /* Possibly more queued: keep them pending for the next wakeup */
+        if(!gsBleEvt.bPending) {
+            gsBleEvt.uiPendingSince = TKEY_BLE_EVT_NOW();
+            gsBleEvt.bPending = TKey_TRUE;
+            bMore = TKey_TRUE;
+        }
+        gsBleEvt.sStats.uiCutShort++;
+    }
+    gsBleEvt.sStats.uiDrains++;
+    gsBleEvt.sStats.uiEvents += uiBatch;
+    if(0 == uiBatch) {
+        gsBleEvt.sStats.uiEmptyDrains++;
+    }
+    if(uiBatch > gsBleEvt.sStats.uiMaxBatch) {
+        gsBleEvt.sStats.uiMaxBatch = uiBatch;
+    }
+    gsBleEvt.sStats.ullLatencyTotal += uiLatency;
+    if(uiLatency > gsBleEvt.sStats.uiLatencyMax) {
+        gsBleEvt.sStats.uiLatencyMax = uiLatency;
+    }
+    THINKey_OSAL_vExitCritical();
+    return bMore;
+}
+
+TKey_VOID TKey_BleEvt_GetStats(TKey_BleEvtStats_t *psStats)
+{
+    THINKey_OSAL_vEnterCritical();
+    *psStats = gsBleEvt.sStats;
+    THINKey_OSAL_vExitCritical();
+}
@@ -0,0 +1,132 @@
+/*
+ * \file thinkey_ble_link_policy.c
+ *
+ * \brief BLE connection parameter and PHY policy
+ *
+ * Entering a burst only waits TKEY_BLE_POLICY_BURST_GUARD_MS after the
+ * previous request, as the transaction is waiting on it; going back to
+ * idle waits TKEY_BLE_POLICY_GUARD_MS, which also keeps a link with
+ * sparse traffic from bouncing between the two. A change held back is
+ * made by a later update.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#include "thinkey_ble_link_policy.h"
+#include <string.h>
+
+#define TKEY_BLE_POLICY_RSSI_Q 16
+#define TKEY_BLE_POLICY_RSSI_SHIFT 3        /* average weight 1/8 */
+
+static const TKey_BleLinkParams_t gasModeParams[] = {
+    [E_TKEY_BLE_POLICY_MODE_BURST] = {
+        TKEY_BLE_POLICY_BURST_INTERVAL_MIN, TKEY_BLE_POLICY_BURST_INTERVAL_MAX,
+        0, TKEY_BLE_POLICY_SUP_TIMEOUT
+    },
+    [E_TKEY_BLE_POLICY_MODE_IDLE] = {
+        TKEY_BLE_POLICY_IDLE_INTERVAL_MIN, TKEY_BLE_POLICY_IDLE_INTERVAL_MAX,
+        TKEY_BLE_POLICY_IDLE_LATENCY, TKEY_BLE_POLICY_SUP_TIMEOUT
+    }
+};
+
+static TKey_BleLinkPhy_t tkey_ble_policy_phy(const TKey_BleLinkPolicy_t *psPolicy)
+{
+    if(TKEY_BLE_POLICY_RSSI_NONE * TKEY_BLE_POLICY_RSSI_Q == psPolicy->iRssiQ) {
+        return E_TKEY_BLE_POLICY_PHY_2M;
+    }
+    if(E_TKEY_BLE_POLICY_PHY_CODED == psPolicy->ucPhy) {
+        return (psPolicy->iRssiQ > TKEY_BLE_POLICY_CODED_EXIT_DBM * TKEY_BLE_POLICY_RSSI_Q) ?
+               E_TKEY_BLE_POLICY_PHY_2M : E_TKEY_BLE_POLICY_PHY_CODED;
+    }
+    return (psPolicy->iRssiQ < TKEY_BLE_POLICY_CODED_ENTER_DBM * TKEY_BLE_POLICY_RSSI_Q) ?
+           E_TKEY_BLE_POLICY_PHY_CODED : E_TKEY_BLE_POLICY_PHY_2M;
+}
+
+TKey_VOID TKey_BleLinkPolicy_Init(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_BleLinkSetParams_t pfnSetParams, TKey_BleLinkSetPhy_t pfnSetPhy,
+        TKey_VOID *pvContext, TKey_UINT32 uiNowMs)
+{
+    memset(psPolicy, 0, sizeof(*psPolicy));
+    psPolicy->pfnSetParams = pfnSetParams;
+    psPolicy->pfnSetPhy = pfnSetPhy;
+    psPolicy->pvContext = pvContext;
+    psPolicy->ucMode = E_TKEY_BLE_POLICY_MODE_NONE;
+    psPolicy->ucPhy = E_TKEY_BLE_POLICY_PHY_1M;
+    psPolicy->iRssiQ = TKEY_BLE_POLICY_RSSI_NONE * TKEY_BLE_POLICY_RSSI_Q;
+    /* The link starts with the parameters of the connection request */
+    psPolicy->uiLastActivityMs = uiNowMs - TKEY_BLE_POLICY_IDLE_MS;
+    psPolicy->uiLastParamsMs = uiNowMs - TKEY_BLE_POLICY_GUARD_MS;
+    psPolicy->uiLastPhyMs = uiNowMs - TKEY_BLE_POLICY_PHY_GUARD_MS;
+}
+
+TKey_VOID TKey_BleLinkPolicy_Activity(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_UINT32 uiNowMs)
+{
+    psPolicy->uiLastActivityMs = uiNowMs;
+}
+
+TKey_VOID TKey_BleLinkPolicy_Rssi(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_INT32 iRssi)
+{
+    if(TKEY_BLE_POLICY_RSSI_NONE * TKEY_BLE_POLICY_RSSI_Q == psPolicy->iRssiQ) {
+        psPolicy->iRssiQ = iRssi * TKEY_BLE_POLICY_RSSI_Q;
+        return;
+    }
+    psPolicy->iRssiQ += (iRssi * TKEY_BLE_POLICY_RSSI_Q - psPolicy->iRssiQ) /
+                        (1 << TKEY_BLE_POLICY_RSSI_SHIFT);
+}
+
+TKey_VOID TKey_BleLinkPolicy_Update(TKey_BleLinkPolicy_t *psPolicy,
+        TKey_UINT32 uiQueueDepth, TKey_UINT32 uiNowMs)
+{
+    TKey_BleLinkMode_t eMode;
+    TKey_BleLinkPhy_t ePhy;
+    TKey_UINT32 uiGuard;
+
+    if(0 != uiQueueDepth) {
+        psPolicy->uiLastActivityMs = uiNowMs;
+    }
+    eMode = (uiNowMs - psPolicy->uiLastActivityMs < TKEY_BLE_POLICY_IDLE_MS) ?
+            E_TKEY_BLE_POLICY_MODE_BURST : E_TKEY_BLE_POLICY_MODE_IDLE;
+
+    if(eMode != psPolicy->ucMode) {
+        uiGuard = (E_TKEY_BLE_POLICY_MODE_BURST == eMode) ?
+                  TKEY_BLE_POLICY_BURST_GUARD_MS : TKEY_BLE_POLICY_GUARD_MS;
+        if(uiNowMs - psPolicy->uiLastParamsMs < uiGuard) {
+            psPolicy->sStats.uiDeferred++;
+        } else {
+            psPolicy->uiLastParamsMs = uiNowMs;
+            psPolicy->sStats.uiParamRequests++;
+            if(psPolicy->pfnSetParams(psPolicy->pvContext, &gasModeParams[eMode])) {
+                psPolicy->ucMode = (TKey_BYTE)eMode;
+                if(E_TKEY_BLE_POLICY_MODE_BURST == eMode) {
+                    psPolicy->sStats.uiBursts++;
+                }
+            } else {
+                psPolicy->sStats.uiRefused++;
+            }
+        }
+    }
+
+    ePhy = tkey_ble_policy_phy(psPolicy);
+    if(ePhy != psPolicy->ucPhy) {
+        if(uiNowMs - psPolicy->uiLastPhyMs < TKEY_BLE_POLICY_PHY_GUARD_MS) {
+            psPolicy->sStats.uiDeferred++;
+        } else {
+            psPolicy->uiLastPhyMs = uiNowMs;
+            psPolicy->sStats.uiPhyRequests++;
+            if(psPolicy->pfnSetPhy(psPolicy->pvContext, ePhy)) {
+                psPolicy->ucPhy = (TKey_BYTE)ePhy;
+            } else {
+                psPolicy->sStats.uiRefused++;
+            }
+        }
+    }
+}
+
+TKey_VOID TKey_BleLinkPolicy_GetStats(const TKey_BleLinkPolicy_t *psPolicy,
+        TKey_BleLinkStats_t *psStats)
+{
+    *psStats = psPolicy->sStats;
+}
@@ -9,6 +9,9 @@
  *  Created on: 13-Oct-2021
  *      Author: adarshhegde
  */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_BLE
+
 #include "FreeRTOS.h"
 #include "task.h"
 
@@ -18,6 +21,11 @@
 #include "thinkey_transport_event_handler.h"
 #include "thinkey_tab_app.h"
 #include "thinkey_osal.h"
+#include "thinkey_l2cap_pool.h"
+#include "thinkey_l2cap_flow.h"
+#include "thinkey_ble_conn.h"
+#include "thinkey_rssi_ranging.h"
+#include "thinkey_ble_link_policy.h"
 
 
 //#include "nrf_sdm.h"
@@ -54,21 +62,15 @@
 #define MAX_CONN_PARAMS_UPDATE_COUNT        10000                                       /**< Number of attempts before giving up the connection parameter negotiation. */
 
 
-#define MAX_BLE_CONN_HANDLES 2
-#define BLE_CONN_TAB_HANDLE 0
-#define BLE_CONN_PHONE_HANDLE 1
-
-#define L2CAP_RX_MPS                         60                                /**< Size of L2CAP Rx MPS (must be at least BLE_L2CAP_MPS_MIN).*/
+#define L2CAP_LINK_PAYLOAD                   251                                /**< Link layer data length requested; the channel MPS is sized from it.*/
+#define L2CAP_RX_MPS                         (L2CAP_LINK_PAYLOAD - TKEY_L2CAP_FLOW_HEADER_SIZE) /**< Largest L2CAP Rx MPS a channel can get (must be at least BLE_L2CAP_MPS_MIN).*/
 #define L2CAP_TX_MPS                         512                                /**< Size of L2CAP Tx MPS (must be at least BLE_L2CAP_MPS_MIN).*/
-#define L2CAP_RX_MTU                         512                                /**< Rx L2CAP MTU size (must be at least BLE_L2CAP_MTU_MIN).*/
+#define L2CAP_NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
 
-#define L2CAP_SDU_MAX_BUFFER_SIZE 260
 
 #define RANGING_DATA_MAX_LENGTH 2 * 4 /* Max Size of ranging data send to tab app in bytes  */
 #define STATUS_MESSAGE_MAX_LENGTH 64 /* Max Size of message status messsage printed on Tab in bytes*/
 
-//static uint16_t m_conn_handle[MAX_BLE_CONN_HANDLES] = {BLE_CONN_HANDLE_INVALID, BLE_CONN_HANDLE_INVALID};    /**< Handle of the current connection. */
-static uint16_t m_l2cap_cid;
 //static ble_uuid_t mDigitalKeyOPUUID =
 //{
 //    .uuid = 0xFFF5 ,
@@ -102,8 +104,6 @@ static uint16_t muTabServiceHandle;
 //static ble_gatts_char_handles_t msStartEngineThresholdValueCharHandle;
 static THINKey_UINT16 usPcmInitialValue = 129;
 static THINKey_UINT32 uiRangingDataInitialValue = 100;
-static uint16_t usL2capChannelId = 0;
-static THINKey_BYTE acL2capSDUData[L2CAP_SDU_MAX_BUFFER_SIZE];
 static TKey_BOOL bOPStatus = TKey_FALSE;
 
 NRF_BLE_GATT_DEF(m_gatt);                                           /**< GATT module instance. */
@@ -115,10 +115,15 @@ BLE_ADVERTISING_DEF(mTabAdv);
 #define THIKEY_BTAL_EVENT_PRIORITY 5
 #define THINKEY_BTAL_STACK_SIZE 2048
 #define PRINT_DATA 0
+#define BTAL_EVENT_SEND_TIMEOUT_MS 100  /* for the transport to make room for an event */
 
 THINKey_VOID task_process_events(THINKey_VOID* param);
 THINKey_VOID* vProcessQueue;//TODO: for experimentation
 
+THINKEY_OSAL_QUEUE_STORAGE(btal, gsBtalQueue, BLE_QUEUE_LENGTH,
+                           sizeof(THINKey_sBleProcessEvents));
+THINKEY_OSAL_TASK_STORAGE(btal, gsBtalTask, THINKEY_BTAL_STACK_SIZE);
+
 THINKey_BOOL bBtInitDone = THINKey_FALSE;
 THINKey_BOOL bTabConnected = THINKey_FALSE;
 
@@ -136,16 +141,26 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //    sTabAppMessageType sTabAppMessage;
 //    THINKey_sEventQueueMsgType sMessage;
 //    THINKey_sTransportSSHandleType *psTransportSSHandle;
+//    TKey_BleConn_t *psConn;
 //	THINKEY_DEBUG_INFO("ble_evt_handler: 0x%x",p_ble_evt->header.evt_id);
 //    switch (p_ble_evt->header.evt_id)
 //    {
 //        case BLE_GAP_EVT_CONNECTED:
-//            if (!bTabConnected)
+//            /* The first link is the tab, the others key devices */
+//            if (E_TKEY_BLE_CONN_SUCCESS != TKey_BleConn_Open(p_ble_evt->evt.gap_evt.conn_handle,
+//                    bTabConnected ? E_TKEY_BLE_CONN_ROLE_PHONE : E_TKEY_BLE_CONN_ROLE_TAB,
+//                    &psConn))
+//            {
+//                THINKEY_DEBUG_ERROR("No context for connection %d", p_ble_evt->evt.gap_evt.conn_handle);
+//                eNrfErrorCode = sd_ble_gap_disconnect(p_ble_evt->evt.gap_evt.conn_handle,
+//                                                 BLE_HCI_CONN_REJECTED_DUE_TO_LIMITED_RESOURCES);
+//                break;
+//            }
+//            if (E_TKEY_BLE_CONN_ROLE_TAB == psConn->ucRole)
 //            {
 //                sTabAppMessage.eEvent = E_TAB_DEVICE_CONNECTED;
 //
-//                m_conn_handle[BLE_CONN_TAB_HANDLE] = p_ble_evt->evt.gap_evt.conn_handle;
-//                THINKEY_DEBUG_INFO("Tab connected:%d", m_conn_handle[BLE_CONN_TAB_HANDLE]);
+//                THINKEY_DEBUG_INFO("Tab connected:%d", psConn->usConnHandle);
 //                THINKey_sTabAppParamType *psTabTaskParams = hGetTabAppHandle();
 //                bTabConnected = THINKey_TRUE;
 //                eTkeyResult = THINKey_OSAL_eQueueSend
@@ -156,16 +171,41 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //                }
 //
 //            }
+//            else
+//            {
+//                /* Interval, latency and PHY follow the traffic and the RSSI */
+//                TKey_BleLinkPolicy_Init(&psConn->sLinkPolicy, tkey_btal_set_conn_params,
+//                        tkey_btal_set_phy, psConn, L2CAP_NOW_MS());
+//                /* Coarse ranging of the key device from its connection events */
+//                TKey_RssiRanging_Start((TKey_HANDLE)(TKey_UINT32)psConn->usConnHandle, 0);
+//                eNrfErrorCode = sd_ble_gap_rssi_start(psConn->usConnHandle, 0, 0);
+//            }
+//            break;
+//
+//        case BLE_GAP_EVT_RSSI_CHANGED:
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.gap_evt.conn_handle);
+//            if (NULL != psConn && E_TKEY_BLE_CONN_ROLE_PHONE == psConn->ucRole)
+//            {
+//                TKey_BleLinkPolicy_Rssi(&psConn->sLinkPolicy,
+//                        p_ble_evt->evt.gap_evt.params.rssi_changed.rssi);
+//            }
+//            TKey_RssiRanging_AddSample((TKey_HANDLE)(TKey_UINT32)p_ble_evt->evt.gap_evt.conn_handle,
+//                    TKEY_RSSI_ANCHOR_LOCAL, p_ble_evt->evt.gap_evt.params.rssi_changed.rssi,
+//                    L2CAP_NOW_MS());
 //            break;
 //
 //        case BLE_GAP_EVT_DISCONNECTED:
 //            THINKEY_DEBUG_INFO("Disconnected, reason %d.",
 //                          p_ble_evt->evt.gap_evt.params.disconnected.reason);
-//            if (p_ble_evt->evt.gap_evt.conn_handle == m_conn_handle[BLE_CONN_TAB_HANDLE])
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.gap_evt.conn_handle);
+//            if (NULL != psConn && E_TKEY_BLE_CONN_ROLE_TAB == psConn->ucRole)
 //            {
-//                m_conn_handle[BLE_CONN_TAB_HANDLE] = BLE_CONN_HANDLE_INVALID;
+//                bTabConnected = THINKey_FALSE;
 //                THINKEY_DEBUG_ERROR("Tab bt disconnected! :%d", p_ble_evt->evt.gap_evt.conn_handle);
 //            }
+//            /* The stack released the channel and its buffers before this */
+//            TKey_RssiRanging_Stop((TKey_HANDLE)(TKey_UINT32)p_ble_evt->evt.gap_evt.conn_handle);
+//            TKey_BleConn_Close(p_ble_evt->evt.gap_evt.conn_handle);
 //            break;
 //
 //        case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
@@ -236,6 +276,11 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //                     psPeerSecParam->kdist_own.sign,  psPeerSecParam->kdist_own.link);
 //            THINKEY_DEBUG_INFO("kdist_peer: enc:%d id:%d sign:%d link:%d", psPeerSecParam->kdist_peer.enc, psPeerSecParam->kdist_peer.id,
 //                     psPeerSecParam->kdist_peer.sign,  psPeerSecParam->kdist_peer.link);
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.gap_evt.conn_handle);
+//            if (NULL != psConn)
+//            {
+//                psConn->ucSecState = E_TKEY_BLE_CONN_SEC_PAIRING;
+//            }
 //            psTransportSSHandle = hGetTransportSSHandle();
 //            sMessage.eCommand = E_THINKEY_START_PAIRING;
 //            sMessage.uiParam1 = p_ble_evt->evt.gap_evt.conn_handle;
@@ -257,6 +302,14 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //                          p_ble_evt->evt.gap_evt.params.auth_status.sm1_levels.lv4,
 //                          *((uint8_t *)&p_ble_evt->evt.gap_evt.params.auth_status.kdist_own),
 //                          *((uint8_t *)&p_ble_evt->evt.gap_evt.params.auth_status.kdist_peer));
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.gap_evt.conn_handle);
+//            if (NULL != psConn)
+//            {
+//                psConn->ucSecState = p_ble_evt->evt.gap_evt.params.auth_status.bonded ?
+//                        E_TKEY_BLE_CONN_SEC_BONDED :
+//                        (BLE_GAP_SEC_STATUS_SUCCESS == p_ble_evt->evt.gap_evt.params.auth_status.auth_status ?
+//                         E_TKEY_BLE_CONN_SEC_ENCRYPTED : E_TKEY_BLE_CONN_SEC_NONE);
+//            }
 //            if (p_ble_evt->evt.gap_evt.params.auth_status.bonded) {
 //                psTransportSSHandle = hGetTransportSSHandle();
 //                sMessage.eCommand = E_THINKEY_START_BONDING;
@@ -274,34 +327,38 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //
 //			break;
 //        case BLE_L2CAP_EVT_CH_SETUP_REQUEST:
+//        {
+//            uint16_t usL2capChannelId;
 //            THINKEY_DEBUG_INFO("l2cap channel setup request for psm: %d connectionHandle:%d",
 //                p_ble_evt->evt.l2cap_evt.params.ch_setup_request.le_psm, p_ble_evt->evt.l2cap_evt.conn_handle);
-//            m_conn_handle[BLE_CONN_PHONE_HANDLE] = p_ble_evt->evt.l2cap_evt.conn_handle;
-//            ble_l2cap_ch_setup_params_t ch_setup_params = {{0}};
-//            ch_setup_params.status = BLE_L2CAP_CH_STATUS_CODE_SUCCESS;
-//            ch_setup_params.rx_params.rx_mps = L2CAP_RX_MPS;
-//            if (ch_setup_params.rx_params.rx_mps < BLE_L2CAP_MPS_MIN)
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.l2cap_evt.conn_handle);
+//            if (NULL == psConn || E_TKEY_BLE_CONN_ROLE_PHONE != psConn->ucRole)
 //            {
-//                ch_setup_params.rx_params.rx_mps = BLE_L2CAP_MPS_MIN;
-//            }
-//            ch_setup_params.rx_params.rx_mtu = L2CAP_RX_MTU;
-//            if (ch_setup_params.rx_params.rx_mtu < BLE_L2CAP_MTU_MIN)
-//            {
-//                ch_setup_params.rx_params.rx_mtu = BLE_L2CAP_MTU_MIN;
+//                break;
 //            }
+//            ble_l2cap_ch_setup_params_t ch_setup_params = {{0}};
+//            TKey_L2capFlowParams_t sFlowParams;
+//            ch_setup_params.status = BLE_L2CAP_CH_STATUS_CODE_SUCCESS;
+//            /* MPS from the negotiated data length, MTU the pool buffer size */
+//            TKey_L2capFlow_Init(&psConn->sL2capFlow,
+//                    nrf_ble_gatt_data_length_get(&m_gatt, psConn->usConnHandle),
+//                    tkey_l2cap_post_rx_buffer, tkey_l2cap_set_credits,
+//                    psConn, L2CAP_NOW_MS(), &sFlowParams);
+//            ch_setup_params.rx_params.rx_mps = sFlowParams.usRxMps;
+//            ch_setup_params.rx_params.rx_mtu = sFlowParams.usRxMtu;
 //            ch_setup_params.rx_params.sdu_buf.p_data = NULL;
 //            ch_setup_params.rx_params.sdu_buf.len = 0;
 //            usL2capChannelId = p_ble_evt->evt.l2cap_evt.local_cid;
 //            vTaskDelay(50/portTICK_PERIOD_MS);
-//            THINKEY_DEBUG_INFO("ConnectionHandle: %d channelId:%d ",m_conn_handle[BLE_CONN_PHONE_HANDLE], usL2capChannelId );
-//            eNrfErrorCode = sd_ble_l2cap_ch_setup(m_conn_handle[BLE_CONN_PHONE_HANDLE],
+//            THINKEY_DEBUG_INFO("ConnectionHandle: %d channelId:%d ",psConn->usConnHandle, usL2capChannelId );
+//            eNrfErrorCode = sd_ble_l2cap_ch_setup(psConn->usConnHandle,
 //                                     &usL2capChannelId,
 //                                     &ch_setup_params);
 //            if (eNrfErrorCode != NRF_SUCCESS)
 //            {
 //                THINKEY_DEBUG_ERROR("sd_ble_l2cap_ch_setup retruned:%d", eNrfErrorCode);
 //            }
-//            break;
+//        } break;
 //        case BLE_L2CAP_EVT_CH_SETUP:
 //            THINKEY_DEBUG_INFO("l2cap channel setup done.conn Handle: %d Cid: %d, credits: %d, tx_mps:%d, tc_mtu:%d",
 //            p_ble_evt->evt.l2cap_evt.conn_handle,
@@ -310,16 +367,13 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //            p_ble_evt->evt.l2cap_evt.params.ch_setup.tx_params.tx_mps,
 //            p_ble_evt->evt.l2cap_evt.params.ch_setup.tx_params.tx_mtu);
 //            /* TODO: Handle credits */
-//            if (m_conn_handle[BLE_CONN_PHONE_HANDLE] == p_ble_evt->evt.l2cap_evt.conn_handle)
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.l2cap_evt.conn_handle);
+//            if (NULL != psConn)
 //            {
-//                m_l2cap_cid = p_ble_evt->evt.l2cap_evt.local_cid;
-//                ble_data_t sL2capSDUBuffer = {
-//                    .p_data = acL2capSDUData,
-//                    .len = L2CAP_SDU_MAX_BUFFER_SIZE
-//                };
-//                vTaskDelay(50/portTICK_PERIOD_MS);
-//                eNrfErrorCode = sd_ble_l2cap_ch_rx(m_conn_handle[BLE_CONN_PHONE_HANDLE], m_l2cap_cid,&sL2capSDUBuffer);
-//                THINKEY_DEBUG_INFO("sd_ble_l2cap_ch_rx retruned :%d", eNrfErrorCode);
+//                psConn->usL2capCid = p_ble_evt->evt.l2cap_evt.local_cid;
+//                /* The stack receives straight into pool buffers, as many
+//                   as the flow control lets it have */
+//                TKey_L2capFlow_Update(&psConn->sL2capFlow, L2CAP_NOW_MS());
 //                 /*Send to event queue*/
 //                psTransportSSHandle = hGetTransportSSHandle();
 //                if (bOPStatus) {
@@ -328,6 +382,7 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //                    sMessage.eCommand = E_THINKEY_DEVICE_CONNECTED;
 //                }
 //                sMessage.uiParam1 = p_ble_evt->evt.l2cap_evt.local_cid;
+//                sMessage.uiParam2 = psConn->usConnHandle;
 //                eTkeyResult = THINKey_OSAL_eQueueSend
 //                            (psTransportSSHandle->hTPEventQueue, &sMessage);
 //                if (E_THINKEY_SUCCESS == eTkeyResult)
@@ -359,48 +414,80 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //                THINKEY_DEBUG_INFO("%BLEData[%d]:%x",i, *(p_ble_evt->evt.l2cap_evt.params.rx.sdu_buf.p_data+i));
 //            }
 //#endif
-//			psTransportSSHandle = hGetTransportSSHandle();
-//			sMessage.eCommand = E_THINKEY_DATA_RECEIVED;
-//			sMessage.uiParam1 = p_ble_evt->evt.l2cap_evt.local_cid;
-//			sMessage.uiParam2 = p_ble_evt->evt.l2cap_evt.params.rx.sdu_len;
-//
-//			//TODO: This results in double copy. Can we optimize?
-//			memcpy(sMessage.abData, p_ble_evt->evt.l2cap_evt.params.rx.sdu_buf.p_data, p_ble_evt->evt.l2cap_evt.params.rx.sdu_len);
-//			eTkeyResult = THINKey_OSAL_eQueueSend
-//					(psTransportSSHandle->hTPEventQueue, &sMessage);
-//			if(E_THINKEY_SUCCESS != eTkeyResult)
-//			{
-//				THINKEY_DEBUG_ERROR("Sending data to queue failed %d",
-//						eTkeyResult);
-//			}
-//            ble_data_t sL2capSDUBuffer = {
-//                .p_data = acL2capSDUData,
-//                .len = L2CAP_SDU_MAX_BUFFER_SIZE
-//            };
-//            //vTaskDelay(500/portTICK_PERIOD_MS);
-//            eNrfErrorCode = sd_ble_l2cap_ch_rx(m_conn_handle[BLE_CONN_PHONE_HANDLE], m_l2cap_cid,&sL2capSDUBuffer);
-//            THINKEY_DEBUG_INFO("sd_ble_l2cap_ch_rx retruned :%d", eNrfErrorCode);
+//            /* Only the descriptor travels, in the event parameters; the
+//               handler of E_THINKEY_DATA_RECEIVED takes it with
+//               TKey_L2capPool_FromEvent() and releases it once the payload
+//               is consumed */
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.l2cap_evt.conn_handle);
+//            if (NULL != psConn)
+//            {
+//                TKey_L2capFlow_BufferDone(&psConn->sL2capFlow);
+//                TKey_BleLinkPolicy_Activity(&psConn->sLinkPolicy, L2CAP_NOW_MS());
+//            }
+//            sMessage.eCommand = E_THINKEY_DATA_RECEIVED;
+//            if (E_TKEY_L2CAP_POOL_SUCCESS == TKey_L2capPool_RxEvent(
+//                    p_ble_evt->evt.l2cap_evt.conn_handle,
+//                    p_ble_evt->evt.l2cap_evt.local_cid,
+//                    p_ble_evt->evt.l2cap_evt.params.rx.sdu_buf.p_data,
+//                    p_ble_evt->evt.l2cap_evt.params.rx.sdu_len,
+//                    &sMessage.uiParam1, &sMessage.uiParam2))
+//            {
+//                psTransportSSHandle = hGetTransportSSHandle();
+//                eTkeyResult = THINKey_OSAL_eQueueSend
+//                        (psTransportSSHandle->hTPEventQueue, &sMessage);
+//                if(E_THINKEY_SUCCESS != eTkeyResult)
+//                {
+//                    TKey_L2capSdu_t sSdu;
+//                    THINKEY_DEBUG_ERROR("Sending data to queue failed %d",
+//                            eTkeyResult);
+//                    if (E_TKEY_L2CAP_POOL_SUCCESS == TKey_L2capPool_FromEvent(
+//                            sMessage.uiParam1, sMessage.uiParam2, &sSdu))
+//                    {
+//                        TKey_L2capPool_Release(&sSdu);
+//                    }
+//                }
+//            }
+//            if (NULL != psConn)
+//            {
+//                TKey_L2capFlow_Update(&psConn->sL2capFlow, L2CAP_NOW_MS());
+//            }
+//            break;
+//        case BLE_L2CAP_EVT_CH_SDU_BUF_RELEASED:
+//            /* A receive buffer the stack held when the channel went */
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.l2cap_evt.conn_handle);
+//            if (NULL != psConn)
+//            {
+//                TKey_L2capFlow_BufferDone(&psConn->sL2capFlow);
+//            }
+//            TKey_L2capPool_Free(p_ble_evt->evt.l2cap_evt.params.ch_sdu_buf_released.sdu_buf.p_data);
 //            break;
 //        case BLE_L2CAP_EVT_CH_TX:
 //            THINKEY_DEBUG_INFO("lcap tx done. cid:%d dataLen:%d", p_ble_evt->evt.l2cap_evt.local_cid,
 //                p_ble_evt->evt.l2cap_evt.params.tx.sdu_buf.len);
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.l2cap_evt.conn_handle);
+//            if (NULL != psConn)
+//            {
+//                TKey_BleLinkPolicy_Activity(&psConn->sLinkPolicy, L2CAP_NOW_MS());
+//            }
 //            break;
 //            case BLE_L2CAP_EVT_CH_RELEASED:
 //            THINKEY_DEBUG_INFO("L2cap disconnected ConnHandel:%d cid:%d", p_ble_evt->evt.l2cap_evt.conn_handle,
 //                                p_ble_evt->evt.l2cap_evt.local_cid);
-//            if (m_conn_handle[BLE_CONN_PHONE_HANDLE] == p_ble_evt->evt.l2cap_evt.conn_handle &&
-//                usL2capChannelId == p_ble_evt->evt.l2cap_evt.local_cid)
+//            psConn = TKey_BleConn_Find(p_ble_evt->evt.l2cap_evt.conn_handle);
+//            if (NULL != psConn &&
+//                psConn->usL2capCid == p_ble_evt->evt.l2cap_evt.local_cid)
 //            {
-//                m_conn_handle[BLE_CONN_PHONE_HANDLE] = BLE_CONN_HANDLE_INVALID;
+//                psConn->usL2capCid = 0;
 //                psTransportSSHandle = hGetTransportSSHandle();
 //                sMessage.eCommand = E_THINKEY_DEVICE_DISCONNECTED;
-//                sMessage.uiParam1 = m_l2cap_cid;
+//                sMessage.uiParam1 = p_ble_evt->evt.l2cap_evt.local_cid;
+//                sMessage.uiParam2 = psConn->usConnHandle;
 //                eTkeyResult = THINKey_OSAL_eQueueSend
 //                        (psTransportSSHandle->hTPEventQueue, &sMessage);
 //                if(E_THINKEY_SUCCESS == eTkeyResult)
 //                {
 //                    THINKEY_DEBUG_INFO ("Device disconnected with Handle %x",
-//                            m_l2cap_cid);
+//                            p_ble_evt->evt.l2cap_evt.local_cid);
 //                }
 //            }
 //            break;
@@ -415,6 +502,59 @@ static void ble_evt_handler(/*ble_evt_t const * p_ble_evt, void * p_context*/)
 //    }
 }
 
+//static TKey_BOOL tkey_l2cap_post_rx_buffer(TKey_VOID *pvContext, TKey_BYTE *pucBuf,
+//                                           TKey_UINT16 usSize)
+//{
+//    const TKey_BleConn_t *psConn = pvContext;
+//    ble_data_t sL2capSDUBuffer = {
+//        .p_data = pucBuf,
+//        .len = usSize
+//    };
+//    return (NRF_SUCCESS == sd_ble_l2cap_ch_rx(psConn->usConnHandle,
+//                                              psConn->usL2capCid, &sL2capSDUBuffer));
+//}
+//
+//static TKey_VOID tkey_l2cap_set_credits(TKey_VOID *pvContext, TKey_UINT16 usCredits)
+//{
+//    const TKey_BleConn_t *psConn = pvContext;
+//    ret_code_t eNrfErrorCode;
+//    eNrfErrorCode = sd_ble_l2cap_ch_flow_control(psConn->usConnHandle,
+//                                                 psConn->usL2capCid, usCredits, NULL);
+//    if (NRF_SUCCESS != eNrfErrorCode)
+//    {
+//        THINKEY_DEBUG_ERROR("sd_ble_l2cap_ch_flow_control retruned:%d", eNrfErrorCode);
+//    }
+//}
+
+//static TKey_BOOL tkey_btal_set_conn_params(TKey_VOID *pvContext,
+//                                           const TKey_BleLinkParams_t *psParams)
+//{
+//    const TKey_BleConn_t *psConn = pvContext;
+//    ble_gap_conn_params_t sConnParams = {
+//        .min_conn_interval = psParams->usIntervalMin,
+//        .max_conn_interval = psParams->usIntervalMax,
+//        .slave_latency = psParams->usLatency,
+//        .conn_sup_timeout = psParams->usSupTimeout
+//    };
+//    return (NRF_SUCCESS == sd_ble_gap_conn_param_update(psConn->usConnHandle, &sConnParams));
+//}
+//
+//static TKey_BOOL tkey_btal_set_phy(TKey_VOID *pvContext, TKey_BleLinkPhy_t ePhy)
+//{
+//    const TKey_BleConn_t *psConn = pvContext;
+//    ble_gap_phys_t const sPhys = {
+//        .tx_phys = ePhy,
+//        .rx_phys = ePhy
+//    };
+//    return (NRF_SUCCESS == sd_ble_gap_phy_update(psConn->usConnHandle, &sPhys));
+//}
+//
+//static uint16_t tkey_btal_tab_conn_handle(void)
+//{
+//    const TKey_BleConn_t *psConn = TKey_BleConn_FindByRole(E_TKEY_BLE_CONN_ROLE_TAB);
+//    return (NULL != psConn) ? psConn->usConnHandle : BLE_CONN_HANDLE_INVALID;
+//}
+
 static void l2cap_params_init(void)
 {
 //	ret_code_t              eNrfErrorCode;
@@ -424,10 +564,10 @@ static void l2cap_params_init(void)
 //	ble_cfg.conn_cfg.conn_cfg_tag = APP_BLE_CONN_CFG_TAG;
 //    THINKEY_DEBUG_ERROR("config tag: %d",ble_cfg.conn_cfg.conn_cfg_tag);
 //    ble_cfg.conn_cfg.params.l2cap_conn_cfg.rx_mps        = L2CAP_RX_MPS;
-//    ble_cfg.conn_cfg.params.l2cap_conn_cfg.rx_queue_size = 1;
+//    ble_cfg.conn_cfg.params.l2cap_conn_cfg.rx_queue_size = TKEY_L2CAP_POOL_LINK_BUFFERS;
 //    ble_cfg.conn_cfg.params.l2cap_conn_cfg.tx_mps        = L2CAP_TX_MPS;
 //    ble_cfg.conn_cfg.params.l2cap_conn_cfg.tx_queue_size = 1;
-//    ble_cfg.conn_cfg.params.l2cap_conn_cfg.ch_count      = 1;
+//    ble_cfg.conn_cfg.params.l2cap_conn_cfg.ch_count      = 1;    /* per link; NRF_SDH_BLE_PERIPHERAL_LINK_COUNT = TKEY_BLE_CONN_MAX */
 //	eNrfErrorCode = sd_ble_cfg_set(BLE_CONN_CFG_L2CAP, &ble_cfg, 0);
 //	if (eNrfErrorCode != NRF_SUCCESS)
 //	{
@@ -868,6 +1008,11 @@ THINKey_eStatusType THINKey_BTAL_eBleStackInit()
             eRetStatus = E_THINKEY_SUCCESS;
             break;
         }
+        if(E_TKEY_L2CAP_POOL_SUCCESS != TKey_L2capPool_Init())
+        {
+            break;
+        }
+        TKey_BleConn_Init();
         ble_stack_init();
         THINKEY_DEBUG_INFO("ble_stack_init done");
         gap_params_init();
@@ -882,15 +1027,16 @@ THINKey_eStatusType THINKey_BTAL_eBleStackInit()
         THINKEY_DEBUG_INFO("connection param init done");
 
 
-        vProcessQueue = THINKey_OSAL_hCreateQueue(BLE_QUEUE_LENGTH,
-                                              sizeof(THINKey_sBleProcessEvents));
+        vProcessQueue = THINKEY_OSAL_CREATE_STATIC_QUEUE(gsBtalQueue,
+                BLE_QUEUE_LENGTH, sizeof(THINKey_sBleProcessEvents));
+        THINKey_OSAL_vQueueSetName(vProcessQueue, "BTAL Events");
         THINKEY_DEBUG_INFO("THINKey_OSAL_hCreateQueue retruned");
 
-        eRetStatus = THINKey_OSAL_eCreateTask(BTAL_EVENT_TASK_NAME,
+        eRetStatus = THINKEY_OSAL_CREATE_STATIC_TASK(gsBtalTask,
+                BTAL_EVENT_TASK_NAME,
                 task_process_events,
                 THINKey_NULL,
                 THIKEY_BTAL_EVENT_PRIORITY,
-                THINKEY_BTAL_STACK_SIZE,
                 &uiTaskID);
         THINKEY_DEBUG_INFO("BTAL THINKey_OSAL_eCreateTask retrined:%d", eRetStatus);
         if (E_THINKEY_SUCCESS == eRetStatus)
@@ -995,11 +1141,19 @@ THINKey_eStatusType THINKey_BTAL_SendData(THINKey_HANDLE hKeyTransportHandle,
     THINKey_eStatusType eRetStatus = E_THINKEY_SUCCESS;
 //    uint32_t              eNrfErrorCode;
 //    ble_data_t sL2capData;
+//    /* The transport handle is the connection handle given in uiParam2 of
+//       E_THINKEY_DEVICE_CONNECTED */
+//    TKey_UINT16 usConnHandle = (TKey_UINT16)(THINKey_UINT32)hKeyTransportHandle;
+//    TKey_UINT16 usCid;
+//    if (E_TKEY_BLE_CONN_SUCCESS != TKey_BleConn_GetL2capCid(usConnHandle, &usCid))
+//    {
+//        return E_THINKEY_FAILURE;
+//    }
 //    sL2capData.p_data = bDataBuffer;
 //    sL2capData.len = uiLength;
 //    THINKEY_DEBUG_INFO("Send data of length %d to transport %x",
 //            uiLength, (THINKey_UINT32)hKeyTransportHandle);
-//    eNrfErrorCode = sd_ble_l2cap_ch_tx(m_conn_handle[BLE_CONN_PHONE_HANDLE], m_l2cap_cid, &sL2capData);
+//    eNrfErrorCode = sd_ble_l2cap_ch_tx(usConnHandle, usCid, &sL2capData);
 //    if (NRF_SUCCESS != eNrfErrorCode)
 //    {
 //        eRetStatus = E_THINKEY_FAILURE;
@@ -1016,7 +1170,6 @@ void SD_EVT_IRQHandler(void)
 
     THINKey_OSAL_eQueueSendToFromISR(vProcessQueue, &sBleEvent,
                 &yield_req);
-    THINKEY_DEBUG_INFO("task reshedule required : %d",yield_req);
     /* Switch the task if required. */
     portYIELD_FROM_ISR(yield_req);
 }
@@ -1026,12 +1179,27 @@ THINKey_VOID task_process_events (THINKey_VOID* param)
 //    THINKey_eStatusType eRetStatus = E_THINKEY_SUCCESS;
 //    ret_code_t eNrfErrorCode;
 //    THINKey_sBleProcessEvents sBleEvent;
+//    TKey_BleConn_t *psConn;
 //    THINKEY_DEBUG_INFO("Polling for ealier sd events");
 //    nrf_sdh_evts_poll(); /* let the handlers run first, incase the EVENT occured before creating this task */
 //    for(;;)
 //    {
-//        /* Block until a BLE command has been received over bleQueueHandle */
-//        eRetStatus = THINKey_OSAL_eQueueReceive(vProcessQueue, &sBleEvent);
+//        /* Block until a BLE command has been received over bleQueueHandle,
+//           waking up to let the L2CAP receive window follow the consumer */
+//        eRetStatus = THINKey_OSAL_eTimedQueueReceive(vProcessQueue, &sBleEvent,
+//                                                     TKEY_L2CAP_FLOW_WINDOW_MS);
+//        for (TKey_UINT32 uiConn = 0; NULL != (psConn = TKey_BleConn_GetByIndex(uiConn)); uiConn++)
+//        {
+//            if (0 != psConn->usL2capCid)
+//            {
+//                TKey_L2capFlow_Update(&psConn->sL2capFlow, L2CAP_NOW_MS());
+//            }
+//            if (E_TKEY_BLE_CONN_ROLE_PHONE == psConn->ucRole)
+//            {
+//                TKey_BleLinkPolicy_Update(&psConn->sLinkPolicy,
+//                        psConn->sL2capFlow.sStats.uiQueueDepth, L2CAP_NOW_MS());
+//            }
+//        }
 //        if(E_THINKEY_SUCCESS == eRetStatus)
 //        {
 //            switch(sBleEvent.eCommand)
@@ -1055,7 +1223,7 @@ THINKey_VOID task_process_events (THINKey_VOID* param)
 //                        .p_data = ucData
 //                    };
 //                    THINKEY_DEBUG_ERROR("Calling sd_ble_gatts_hvx %d", gattNotficationData.handle);
-//                    eNrfErrorCode = sd_ble_gatts_hvx(m_conn_handle[BLE_CONN_TAB_HANDLE], &gattNotficationData);
+//                    eNrfErrorCode = sd_ble_gatts_hvx(tkey_btal_tab_conn_handle(), &gattNotficationData);
 //                    THINKEY_DEBUG_ERROR("sd_ble_gatts_hvx returned:%d len:%d", eNrfErrorCode, *(gattNotficationData.p_len));
 //                    break;
 //                }
@@ -1073,7 +1241,7 @@ THINKey_VOID task_process_events (THINKey_VOID* param)
 //                        .p_data = ucData
 //                    };
 //                    THINKEY_DEBUG_ERROR("Calling sd_ble_gatts_hvx %d", gattNotficationData.handle);
-//                    eNrfErrorCode = sd_ble_gatts_hvx(m_conn_handle[BLE_CONN_TAB_HANDLE], &gattNotficationData);
+//                    eNrfErrorCode = sd_ble_gatts_hvx(tkey_btal_tab_conn_handle(), &gattNotficationData);
 //                    THINKEY_DEBUG_ERROR("sd_ble_gatts_hvx returned:%d len:%d", eNrfErrorCode, *(gattNotficationData.p_len));
 //                    break;
 //                }
@@ -1098,8 +1266,9 @@ TKey_Status_t tkey_BTAL_BondDevice() {
 	THINKey_sEventQueueMsgType sMessage;
 	THINKey_sTransportSSHandleType *psTransportSSHandle = hGetTransportSSHandle();
     sMessage.eCommand = E_THINKEY_PAIR_AND_BOND_DONE;
-	eRetStatus = THINKey_OSAL_eQueueSend(
-					psTransportSSHandle->hTPEventQueue, &sMessage);
+	eRetStatus = THINKey_OSAL_eQueueSendTimed(
+					psTransportSSHandle->hTPEventQueue, &sMessage,
+					BTAL_EVENT_SEND_TIMEOUT_MS, E_THINKEY_OSAL_QUEUE_BACK);
     return eRetStatus;
 }
 
@@ -0,0 +1,174 @@
+/*
+ * \file thinkey_l2cap_flow.c
+ *
+ * \brief L2CAP CoC receive flow control
+ *
+ * The drain rate is sampled every TKEY_L2CAP_FLOW_WINDOW_MS from the count
+ * of descriptors the consumer took from the pool. Only a window in which
+ * the consumer had a backlog measures it; one without says it kept up with
+ * what was let in, so the estimate is raised by a quarter to probe for
+ * more. The receive window is the number of SDUs the consumer drains in
+ * TKEY_L2CAP_FLOW_LATENCY_MS less those already queued to it, and at least
+ * one while its queue is empty.
+ *
+ * The credit target is the number of buffers the stack holds, so the peer
+ * never has credits to start an SDU there is no buffer for. An SDU longer
+ * than the MPS takes its further credits as the stack tops them up.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_BLE
+
+#include "thinkey_l2cap_flow.h"
+#include "thinkey_debug.h"
+
+#define TKEY_L2CAP_FLOW_LINK_PAYLOAD_MIN 27
+#define TKEY_L2CAP_FLOW_LINK_PAYLOAD_MAX 251
+/* Above what fills the channel's share within the latency budget */
+#define TKEY_L2CAP_FLOW_RATE_MAX (2 * TKEY_L2CAP_POOL_LINK_BUFFERS * 1000 / \
+                                  TKEY_L2CAP_FLOW_LATENCY_MS)
+
+static TKey_VOID tkey_l2cap_flow_sample(TKey_L2capFlow_t *psFlow,
+        TKey_UINT32 uiNowMs, TKey_UINT32 uiTaken, TKey_UINT32 uiDepth)
+{
+    TKey_UINT32 uiElapsed = uiNowMs - psFlow->uiWindowStartMs;
+    TKey_UINT32 uiSample;
+
+    if(uiElapsed < TKEY_L2CAP_FLOW_WINDOW_MS) {
+        return;
+    }
+    uiSample = (uiTaken - psFlow->uiWindowTaken) * 1000 / uiElapsed;
+    if(0 != uiDepth || 0 != psFlow->sStats.uiQueueDepth) {
+        psFlow->sStats.uiDrainRate = (3 * psFlow->sStats.uiDrainRate +
+                                      uiSample + 3) / 4;
+    } else {
+        /* Kept up with what the window let in: probe upwards */
+        if(uiSample < psFlow->sStats.uiDrainRate) {
+            uiSample = psFlow->sStats.uiDrainRate;
+        }
+        psFlow->sStats.uiDrainRate = uiSample + uiSample / 4 + 1;
+        if(psFlow->sStats.uiDrainRate > TKEY_L2CAP_FLOW_RATE_MAX) {
+            psFlow->sStats.uiDrainRate = TKEY_L2CAP_FLOW_RATE_MAX;
+        }
+    }
+    psFlow->uiWindowStartMs = uiNowMs;
+    psFlow->uiWindowTaken = uiTaken;
+}
+
+TKey_L2capFlowStatus_t TKey_L2capFlow_Init(TKey_L2capFlow_t *psFlow,
+        TKey_UINT16 usLinkPayload, TKey_L2capFlowPost_t pfnPost,
+        TKey_L2capFlowCredits_t pfnCredits, TKey_VOID *pvContext,
+        TKey_UINT32 uiNowMs, TKey_L2capFlowParams_t *psParams)
+{
+    TKey_L2capPoolStats_t sPool;
+    TKey_UINT32 uiMps;
+
+    if(TKey_NULL == psFlow || TKey_NULL == pfnPost || TKey_NULL == pfnCredits ||
+       TKey_NULL == psParams) {
+        return E_TKEY_L2CAP_FLOW_INVALID_ARG;
+    }
+    if(usLinkPayload < TKEY_L2CAP_FLOW_LINK_PAYLOAD_MIN) {
+        usLinkPayload = TKEY_L2CAP_FLOW_LINK_PAYLOAD_MIN;
+    } else if(usLinkPayload > TKEY_L2CAP_FLOW_LINK_PAYLOAD_MAX) {
+        usLinkPayload = TKEY_L2CAP_FLOW_LINK_PAYLOAD_MAX;
+    }
+    /* One K-frame per link layer PDU, and no larger than a whole SDU */
+    uiMps = usLinkPayload - TKEY_L2CAP_FLOW_HEADER_SIZE;
+    if(uiMps > TKEY_L2CAP_POOL_SDU_SIZE + TKEY_L2CAP_FLOW_SDU_LEN_SIZE) {
+        uiMps = TKEY_L2CAP_POOL_SDU_SIZE + TKEY_L2CAP_FLOW_SDU_LEN_SIZE;
+    }
+
+    TKey_L2capPool_GetStats(&sPool);
+    psFlow->pfnPost = pfnPost;
+    psFlow->pfnCredits = pfnCredits;
+    psFlow->pvContext = pvContext;
+    psFlow->sParams.usRxMps = (TKey_UINT16)uiMps;
+    psFlow->sParams.usRxMtu = TKEY_L2CAP_POOL_SDU_SIZE;
+    psFlow->uiWindowStartMs = uiNowMs;
+    psFlow->uiWindowTaken = sPool.uiRxTaken;
+    psFlow->bBackPressure = TKey_FALSE;
+    /* Start with the whole share until the consumer has been measured */
+    psFlow->sStats.uiDrainRate = TKEY_L2CAP_POOL_LINK_BUFFERS * 1000 /
+                                 TKEY_L2CAP_FLOW_LATENCY_MS;
+    psFlow->sStats.uiQueueDepth = 0;
+    psFlow->sStats.uiMaxQueueDepth = 0;
+    psFlow->sStats.uiBackPressure = 0;
+    psFlow->sStats.usPosted = 0;
+    psFlow->sStats.usTarget = 0;
+    psFlow->sStats.usCredits = TKEY_L2CAP_FLOW_CREDITS_DEFAULT;
+    *psParams = psFlow->sParams;
+    return E_TKEY_L2CAP_FLOW_SUCCESS;
+}
+
+TKey_VOID TKey_L2capFlow_BufferDone(TKey_L2capFlow_t *psFlow)
+{
+    if(0 != psFlow->sStats.usPosted) {
+        psFlow->sStats.usPosted--;
+    }
+}
+
+TKey_VOID TKey_L2capFlow_Update(TKey_L2capFlow_t *psFlow, TKey_UINT32 uiNowMs)
+{
+    TKey_L2capPoolStats_t sPool;
+    TKey_UINT32 uiDepth;
+    TKey_UINT32 uiWindow;
+    TKey_BYTE *pucBuf;
+
+    TKey_L2capPool_GetStats(&sPool);
+    uiDepth = sPool.uiRxSdus - sPool.uiRxTaken;
+    tkey_l2cap_flow_sample(psFlow, uiNowMs, sPool.uiRxTaken, uiDepth);
+    psFlow->sStats.uiQueueDepth = uiDepth;
+    if(uiDepth > psFlow->sStats.uiMaxQueueDepth) {
+        psFlow->sStats.uiMaxQueueDepth = uiDepth;
+    }
+
+    /* SDUs the consumer gets through within the latency budget */
+    uiWindow = (psFlow->sStats.uiDrainRate * TKEY_L2CAP_FLOW_LATENCY_MS + 999) /
+               1000;
+    if(uiWindow > TKEY_L2CAP_POOL_LINK_BUFFERS) {
+        uiWindow = TKEY_L2CAP_POOL_LINK_BUFFERS;
+    }
+    uiWindow = (uiWindow > uiDepth) ? (uiWindow - uiDepth) : 0;
+    if(0 == uiWindow && 0 == uiDepth) {
+        uiWindow = 1;
+    }
+    psFlow->sStats.usTarget = (TKey_UINT16)uiWindow;
+
+    if(0 == uiWindow) {
+        /* Give nothing back: the stack runs out of credits for the peer */
+        if(!psFlow->bBackPressure) {
+            psFlow->bBackPressure = TKey_TRUE;
+            psFlow->sStats.uiBackPressure++;
+        }
+    } else {
+        psFlow->bBackPressure = TKey_FALSE;
+    }
+
+    while(psFlow->sStats.usPosted < uiWindow) {
+        pucBuf = TKey_L2capPool_Alloc();
+        if(TKey_NULL == pucBuf) {
+            break;
+        }
+        if(!psFlow->pfnPost(psFlow->pvContext, pucBuf, TKEY_L2CAP_POOL_SDU_SIZE)) {
+            TKey_L2capPool_Free(pucBuf);
+            THINKEY_DEBUG_ERROR("L2CAP flow: receive buffer refused");
+            break;
+        }
+        psFlow->sStats.usPosted++;
+    }
+    /* Also while closed: the buffers filled since the last update took
+     * their credits with them */
+    if(0 != psFlow->sStats.usPosted &&
+       psFlow->sStats.usPosted != psFlow->sStats.usCredits) {
+        psFlow->sStats.usCredits = psFlow->sStats.usPosted;
+        psFlow->pfnCredits(psFlow->pvContext, psFlow->sStats.usCredits);
+    }
+}
+
+TKey_VOID TKey_L2capFlow_GetStats(const TKey_L2capFlow_t *psFlow,
+        TKey_L2capFlowStats_t *psStats)
+{
+    *psStats = psFlow->sStats;
+}
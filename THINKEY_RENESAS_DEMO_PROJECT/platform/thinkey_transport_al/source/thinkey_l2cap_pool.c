@@ -0,0 +1,238 @@
+/*
+ * \file thinkey_l2cap_pool.c
+ *
+ * \brief L2CAP SDU buffer pool
+ *
+ * A buffer is free when its reference count is 0. Reference counts and
+ * statistics change in short critical sections. The receive queue holds
+ * one descriptor per buffer at most, so it can never be full.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_BLE
+
+#include "thinkey_l2cap_pool.h"
+#include "thinkey_osal.h"
+#include "thinkey_debug.h"
+
+typedef struct
+{
+    TKey_UINT32 auiData[(TKEY_L2CAP_POOL_SDU_SIZE + 3) / 4];
+    volatile TKey_UINT16 usRefs;
+} TKey_L2capBuffer_t;
+
+typedef struct
+{
+    TKey_HANDLE hRxQueue;
+    TKey_L2capBuffer_t asBuffer[TKEY_L2CAP_POOL_BUFFERS];
+    TKey_L2capPoolStats_t sStats;
+} TKey_L2capPool_t;
+
+static TKey_L2capPool_t gsL2capPool;
+
+/* Pool index of a buffer, TKEY_L2CAP_POOL_BUFFERS if not from the pool */
+static TKey_UINT32 tkey_l2cap_pool_index(const TKey_BYTE *pucData)
+{
+    TKey_UINT32 uiIndex;
+
+    for(uiIndex = 0; uiIndex < TKEY_L2CAP_POOL_BUFFERS; uiIndex++) {
+        if(pucData == (const TKey_BYTE *)gsL2capPool.asBuffer[uiIndex].auiData) {
+            break;
+        }
+    }
+    return uiIndex;
+}
+
+static TKey_VOID tkey_l2cap_pool_put(TKey_UINT32 uiIndex)
+{
+    TKey_L2capBuffer_t *psBuffer = &gsL2capPool.asBuffer[uiIndex];
+
+    THINKey_OSAL_vEnterCritical();
+    if(0 != psBuffer->usRefs && 0 == --psBuffer->usRefs) {
+        gsL2capPool.sStats.uiFree++;
+    }
+    THINKey_OSAL_vExitCritical();
+}
+
+THINKEY_OSAL_QUEUE_STORAGE(l2cap, gsL2capRxQueue, TKEY_L2CAP_POOL_BUFFERS,
+                           sizeof(TKey_L2capSdu_t));
+
+TKey_L2capPoolStatus_t TKey_L2capPool_Init(TKey_VOID)
+{
+    TKey_UINT32 uiIndex;
+
+    if(TKey_NULL == gsL2capPool.hRxQueue) {
+        gsL2capPool.hRxQueue = THINKEY_OSAL_CREATE_STATIC_QUEUE(gsL2capRxQueue,
+                                TKEY_L2CAP_POOL_BUFFERS, sizeof(TKey_L2capSdu_t));
+        if(TKey_NULL == gsL2capPool.hRxQueue) {
+            THINKEY_DEBUG_ERROR("L2CAP pool: queue creation failed");
+            return E_TKEY_L2CAP_POOL_FAILURE;
+        }
+        THINKey_OSAL_vQueueSetName(gsL2capPool.hRxQueue, "L2CAP Rx");
+    }
+    THINKey_OSAL_vEnterCritical();
+    for(uiIndex = 0; uiIndex < TKEY_L2CAP_POOL_BUFFERS; uiIndex++) {
+        gsL2capPool.asBuffer[uiIndex].usRefs = 0;
+    }
+    gsL2capPool.sStats.uiFree = TKEY_L2CAP_POOL_BUFFERS;
+    gsL2capPool.sStats.uiMinFree = TKEY_L2CAP_POOL_BUFFERS;
+    THINKey_OSAL_vExitCritical();
+    return E_TKEY_L2CAP_POOL_SUCCESS;
+}
+
+TKey_BYTE* TKey_L2capPool_Alloc(TKey_VOID)
+{
+    TKey_BYTE *pucData = TKey_NULL;
+    TKey_UINT32 uiIndex;
+
+    THINKey_OSAL_vEnterCritical();
+    for(uiIndex = 0; uiIndex < TKEY_L2CAP_POOL_BUFFERS; uiIndex++) {
+        if(0 == gsL2capPool.asBuffer[uiIndex].usRefs) {
+            gsL2capPool.asBuffer[uiIndex].usRefs = 1;
+            pucData = (TKey_BYTE *)gsL2capPool.asBuffer[uiIndex].auiData;
+            break;
+        }
+    }
+    if(TKey_NULL != pucData) {
+        gsL2capPool.sStats.uiAllocs++;
+        gsL2capPool.sStats.uiFree--;
+        if(gsL2capPool.sStats.uiFree < gsL2capPool.sStats.uiMinFree) {
+            gsL2capPool.sStats.uiMinFree = gsL2capPool.sStats.uiFree;
+        }
+    } else {
+        gsL2capPool.sStats.uiAllocFails++;
+    }
+    THINKey_OSAL_vExitCritical();
+    return pucData;
+}
+
+static TKey_VOID tkey_l2cap_pool_count_rx(TKey_UINT16 usLen)
+{
+    THINKey_OSAL_vEnterCritical();
+    gsL2capPool.sStats.uiRxSdus++;
+    gsL2capPool.sStats.uiRxBytes += usLen;
+    THINKey_OSAL_vExitCritical();
+}
+
+static TKey_VOID tkey_l2cap_pool_count_taken(TKey_VOID)
+{
+    THINKey_OSAL_vEnterCritical();
+    gsL2capPool.sStats.uiRxTaken++;
+    THINKey_OSAL_vExitCritical();
+}
+
+TKey_L2capPoolStatus_t TKey_L2capPool_RxDone(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_BYTE *pucData, TKey_UINT16 usLen)
+{
+    TKey_L2capSdu_t sSdu;
+    TKey_UINT32 uiIndex = tkey_l2cap_pool_index(pucData);
+
+    if(TKEY_L2CAP_POOL_BUFFERS == uiIndex || usLen > TKEY_L2CAP_POOL_SDU_SIZE) {
+        return E_TKEY_L2CAP_POOL_INVALID_ARG;
+    }
+    sSdu.pucData = pucData;
+    sSdu.usLen = usLen;
+    sSdu.usConnHandle = usConnHandle;
+    sSdu.usCid = usCid;
+    sSdu.usBuffer = (TKey_UINT16)uiIndex;
+    if(E_THINKEY_SUCCESS != THINKey_OSAL_eQueueSend(gsL2capPool.hRxQueue, &sSdu)) {
+        tkey_l2cap_pool_put(uiIndex);
+        THINKEY_DEBUG_ERROR("L2CAP pool: SDU on cid %d dropped", usCid);
+        return E_TKEY_L2CAP_POOL_FAILURE;
+    }
+    tkey_l2cap_pool_count_rx(usLen);
+    return E_TKEY_L2CAP_POOL_SUCCESS;
+}
+
+TKey_L2capPoolStatus_t TKey_L2capPool_RxEvent(TKey_UINT16 usConnHandle,
+        TKey_UINT16 usCid, TKey_BYTE *pucData, TKey_UINT16 usLen,
+        TKey_UINT32 *puiParam1, TKey_UINT32 *puiParam2)
+{
+    TKey_UINT32 uiIndex = tkey_l2cap_pool_index(pucData);
+
+    if(TKEY_L2CAP_POOL_BUFFERS == uiIndex || usLen > TKEY_L2CAP_POOL_SDU_SIZE ||
+       TKey_NULL == puiParam1 || TKey_NULL == puiParam2) {
+        return E_TKEY_L2CAP_POOL_INVALID_ARG;
+    }
+    *puiParam1 = ((TKey_UINT32)usConnHandle << 16) | usCid;
+    *puiParam2 = (uiIndex << 16) | usLen;
+    tkey_l2cap_pool_count_rx(usLen);
+    return E_TKEY_L2CAP_POOL_SUCCESS;
+}
+
+TKey_L2capPoolStatus_t TKey_L2capPool_FromEvent(TKey_UINT32 uiParam1,
+        TKey_UINT32 uiParam2, TKey_L2capSdu_t *psSdu)
+{
+    TKey_UINT32 uiIndex = uiParam2 >> 16;
+
+    /* A buffer with no reference was never handed out by RxEvent */
+    if(TKey_NULL == psSdu || uiIndex >= TKEY_L2CAP_POOL_BUFFERS ||
+       0 == gsL2capPool.asBuffer[uiIndex].usRefs ||
+       (uiParam2 & 0xFFFF) > TKEY_L2CAP_POOL_SDU_SIZE) {
+        return E_TKEY_L2CAP_POOL_INVALID_ARG;
+    }
+    psSdu->pucData = (TKey_BYTE *)gsL2capPool.asBuffer[uiIndex].auiData;
+    psSdu->usLen = (TKey_UINT16)(uiParam2 & 0xFFFF);
+    psSdu->usConnHandle = (TKey_UINT16)(uiParam1 >> 16);
+    psSdu->usCid = (TKey_UINT16)(uiParam1 & 0xFFFF);
+    psSdu->usBuffer = (TKey_UINT16)uiIndex;
+    tkey_l2cap_pool_count_taken();
+    return E_TKEY_L2CAP_POOL_SUCCESS;
+}
+
+TKey_L2capPoolStatus_t TKey_L2capPool_Receive(TKey_L2capSdu_t *psSdu,
+        TKey_UINT32 uiTimeoutMs)
+{
+    if(TKey_NULL == psSdu) {
+        return E_TKEY_L2CAP_POOL_INVALID_ARG;
+    }
+    if(E_THINKEY_SUCCESS != THINKey_OSAL_eTimedQueueReceive(gsL2capPool.hRxQueue,
+                                psSdu, uiTimeoutMs)) {
+        return E_TKEY_L2CAP_POOL_TIMEOUT;
+    }
+    tkey_l2cap_pool_count_taken();
+    return E_TKEY_L2CAP_POOL_SUCCESS;
+}
+
+TKey_VOID TKey_L2capPool_Retain(const TKey_L2capSdu_t *psSdu)
+{
+    if(TKey_NULL == psSdu || psSdu->usBuffer >= TKEY_L2CAP_POOL_BUFFERS) {
+        return;
+    }
+    THINKey_OSAL_vEnterCritical();
+    if(0 != gsL2capPool.asBuffer[psSdu->usBuffer].usRefs) {
+        gsL2capPool.asBuffer[psSdu->usBuffer].usRefs++;
+    }
+    THINKey_OSAL_vExitCritical();
+}
+
+TKey_VOID TKey_L2capPool_Release(const TKey_L2capSdu_t *psSdu)
+{
+    if(TKey_NULL == psSdu || psSdu->usBuffer >= TKEY_L2CAP_POOL_BUFFERS) {
+        return;
+    }
+    tkey_l2cap_pool_put(psSdu->usBuffer);
+}
+
+TKey_VOID TKey_L2capPool_Free(TKey_BYTE *pucData)
+{
+    TKey_UINT32 uiIndex = tkey_l2cap_pool_index(pucData);
+
+    if(TKEY_L2CAP_POOL_BUFFERS != uiIndex) {
+        tkey_l2cap_pool_put(uiIndex);
+    }
+}
+
+TKey_UINT32 TKey_L2capPool_GetFree(TKey_VOID)
+{
+    return gsL2capPool.sStats.uiFree;
+}
+
+TKey_VOID TKey_L2capPool_GetStats(TKey_L2capPoolStats_t *psStats)
+{
+    THINKey_OSAL_vEnterCritical();
+    *psStats = gsL2capPool.sStats;
+    THINKey_OSAL_vExitCritical();
+}
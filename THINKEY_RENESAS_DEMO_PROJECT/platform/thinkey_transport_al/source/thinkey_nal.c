@@ -1,3 +1,4 @@
+#define THINKEY_DEBUG_MODULE THINKEY_DEBUG_MODULE_NAL
 
 #include "thinkey_nal.h"
 #include "thinkey_debug.h"
@@ -50,13 +51,19 @@ typedef struct {
     ptxIoTRd_t        sIotRd;
 
     TKey_DiscoveryStates eDiscoveryState;
+    TKey_Handle       hDetectStart;     /* wakes the detect task per discovery */
 } TKey_NalHandleType;
 
 TKey_NalHandleType sNalHandle;
 
+/* The detect task is created once and sleeps between discoveries */
+THINKEY_OSAL_TASK_STORAGE(nal, gsNfcDetectTask, THINKEY_DETECT_TASK_STACK_SIZE);
+THINKEY_OSAL_QUEUE_STORAGE(nal, gsNfcDetectStart, 1, sizeof(TKey_UINT32));
+
 
 TKey_VOID tkey_NotifyDisconnection(TKey_NalHandleType* psNalHandle);
 TKey_VOID tkey_Nfc_DetectTask(TKey_VOID* pvTaskParam);
+static TKey_VOID tkey_Nfc_Detect(TKey_NalHandleType* psNalHandle);
 static void ptxIoTRdInt_Print_Revision_Info(ptxIoTRd_t *iotRd);
 static TKey_VOID tkey_DiscoveryHandler(TKey_NalHandleType* psNalHandle,
         uint8_t discover_status, ptxIoTRd_CardRegistry_t* card_registry);
@@ -160,6 +167,7 @@ TKey_Status_t tkey_NAL_NfcStackDeInit(TKey_Handle hNalHandle, TKey_Transport_t e
 TKey_StatusType	tkey_NAL_StartDiscovery(TKey_Handle hNalHandle) {
     TKey_NalHandleType* psNalHandle = (TKey_NalHandleType*)hNalHandle;
     TKey_UINT32 uiTaskID;
+    TKey_UINT32 uiStart = 1;
     TKey_StatusType eRetStatus = E_TKEY_FAILURE;
 
     ptxIoTRd_DiscConfig_t rf_disc_config;
@@ -186,10 +194,22 @@ TKey_StatusType	tkey_NAL_StartDiscovery(TKey_Handle hNalHandle) {
         }
 
         /* Start thread to listen to detect card */
-        eRetStatus = THINKey_OSAL_eCreateTask(THINKEY_NFC_DETECT_TASK_NAME, &tkey_Nfc_DetectTask,
-                hNalHandle, THINKEY_DETECT_TASK_PRIORITY, THINKEY_DETECT_TASK_STACK_SIZE,
-                &uiTaskID);
-        /* Store task ID or task handle in NalHandle */
+        if(TKey_NULL == psNalHandle->hDetectStart) {
+            psNalHandle->hDetectStart = THINKEY_OSAL_CREATE_STATIC_QUEUE(
+                    gsNfcDetectStart, 1, sizeof(TKey_UINT32));
+            THINKey_OSAL_vQueueSetName(psNalHandle->hDetectStart, "NFC Detect");
+            eRetStatus = THINKEY_OSAL_CREATE_STATIC_TASK(gsNfcDetectTask,
+                    THINKEY_NFC_DETECT_TASK_NAME, &tkey_Nfc_DetectTask,
+                    hNalHandle, THINKEY_DETECT_TASK_PRIORITY, &uiTaskID);
+            if(E_TKEY_SUCCESS != eRetStatus) {
+                /* Nothing will detect a card, so no discovery is ongoing */
+                THINKEY_DEBUG_ERROR("NFC detect task not created");
+                psNalHandle->bDiscovering = 0;
+                break;
+            }
+        }
+        /* A start still pending from a previous discovery is harmless */
+        (void)THINKey_OSAL_eQueueSend(psNalHandle->hDetectStart, &uiStart);
     } while(TKey_EXIT);
 
     return eRetStatus;
@@ -199,10 +219,9 @@ TKey_StatusType tkey_NAL_StopDiscovery(TKey_Handle hNalHandle) {
     TKey_StatusType eRetStatus = E_TKEY_FAILURE;
     TKey_NalHandleType* psNalHandle = (TKey_NalHandleType*)hNalHandle;
 
+    /* The detect task leaves its loop and waits for the next discovery */
     psNalHandle->bDiscovering = 0;
 
-    /* TODO: Delete task */
-
     return eRetStatus;
 }
 
@@ -216,7 +235,7 @@ TKey_StatusType tkey_NAL_SendData(TKey_Handle hNalHandle,
     ptxStatus_t st = ptxStatus_Success;
 
     THINKEY_DEBUG_INFO("NAL Send Data called");
-    printbuf(pucDataBuffer, uiLength);
+    THINKEY_DEBUG_DUMP("NAL send", pucDataBuffer, uiLength);
 
     if(TKey_NULL != psNalHandle && TKey_NULL != pucDataBuffer) {
 
@@ -229,7 +248,7 @@ TKey_StatusType tkey_NAL_SendData(TKey_Handle hNalHandle,
                     (NULL != psNalHandle->psNfcCallbacks->TKey_pfnNfcDataReceived)) {
                 psNalHandle->psNfcCallbacks->TKey_pfnNfcDataReceived(
                         hKeyHandle, psNalHandle, acReadBuffer, uiRxLen);
-                printbuf(acReadBuffer, uiRxLen);
+                THINKEY_DEBUG_DUMP("NAL received", acReadBuffer, uiRxLen);
             }
         }
     }
@@ -261,6 +280,17 @@ TKey_Status_t tkey_NAL_DeactivateDevice(TKey_Handle_t hNalHandle,
 TKey_VOID tkey_Nfc_DetectTask(TKey_VOID* pvTaskParam) {
 
     TKey_NalHandleType* psNalHandle = (TKey_NalHandleType*)pvTaskParam;
+    TKey_UINT32 uiStart;
+
+    for(;;) {
+        (void)THINKey_OSAL_eQueueReceive(psNalHandle->hDetectStart, &uiStart);
+        tkey_Nfc_Detect(psNalHandle);
+    }
+}
+
+/* Runs one discovery, until it is stopped or the reader fails */
+static TKey_VOID tkey_Nfc_Detect(TKey_NalHandleType* psNalHandle) {
+
     ptxStatus_t st = ptxStatus_Success;
     TKey_BOOL bExitLoop = TKey_FALSE;    
     uint8_t system_state = PTX_SYSTEM_STATUS_OK;
@@ -369,12 +399,7 @@ TKey_VOID tkey_Nfc_DetectTask(TKey_VOID* pvTaskParam) {
         vTaskDelay(1);
     }
 
-    THINKEY_DEBUG_INFO("Exiting Card detection task\n");
-
-    vTaskDelete( NULL );    
-    /*TODO: Exit task gracefully */
-
-    return;
+    THINKEY_DEBUG_INFO("Card detection stopped\n");
 }
 
 TKey_VOID tkey_NotifyDisconnection(TKey_NalHandleType* psNalHandle) {
@@ -389,6 +414,22 @@ TKey_VOID tkey_NotifyDisconnection(TKey_NalHandleType* psNalHandle) {
     }
 }
 
+/* Key ID of a type A card: FNV-1a over the whole NFCID1 (4, 7 or 10 bytes),
+   so that cards sharing the first UID byte get different IDs */
+static TKey_UINT32 tkey_NfcKeyId(const ptxIoTRd_CardAParams_t* psCardA) {
+    TKey_UINT32 uiKeyId = 0x811C9DC5;
+    TKey_UINT32 uiIndex;
+    TKey_UINT32 uiLen = psCardA->NFCID1_LEN;
+
+    if(uiLen > PTX_IOTRD_TECH_A_NFCID1_MAX_SIZE) {
+        uiLen = PTX_IOTRD_TECH_A_NFCID1_MAX_SIZE;
+    }
+    for(uiIndex = 0; uiIndex < uiLen; uiIndex++) {
+        uiKeyId = (uiKeyId ^ psCardA->NFCID1[uiIndex]) * 0x01000193;
+    }
+    return uiKeyId;
+}
+
 TKey_VOID tkey_DiscoveryHandler(TKey_NalHandleType* psNalHandle,
         uint8_t discover_status, ptxIoTRd_CardRegistry_t* card_registry) {
 
@@ -407,9 +448,8 @@ TKey_VOID tkey_DiscoveryHandler(TKey_NalHandleType* psNalHandle,
                     THINKEY_DEBUG_INFO("card detected!!!");
                     if((card_registry->ActiveCard->TechType == Tech_TypeA) &&
                             (card_registry->ActiveCardProtType == Prot_ISODEP)) {
-                        TKey_UINT32 uiKeyId = 0;
-                        uiKeyId = 
-                            (TKey_UINT32)*card_registry->ActiveCard->TechParams.CardAParams.NFCID1;
+                        TKey_UINT32 uiKeyId = tkey_NfcKeyId(
+                            &card_registry->ActiveCard->TechParams.CardAParams);
                         psNalHandle->asKeyHandle[1].uiKeyId = uiKeyId;
                         hKeyHandle = &psNalHandle->sIotRd;
 #ifdef TAB_UI_DEMO
@@ -13,6 +13,7 @@
  * See http://www.freertos.org/a00110.html
  *----------------------------------------------------------*/
 #include "bsp_api.h"
+#include "thinkey_freertos_config.h"
 
 /* Common macro for FSP header files. There is also a corresponding FSP_FOOTER macro at the end of this file. */
 FSP_HEADER
@@ -57,7 +58,7 @@ FSP_HEADER
 #define configMAX_TASK_NAME_LEN (16)
 #endif
 #ifndef configUSE_TRACE_FACILITY
-#define configUSE_TRACE_FACILITY (0)
+#define configUSE_TRACE_FACILITY (1)
 #endif
 #ifndef configUSE_STATS_FORMATTING_FUNCTIONS
 #define configUSE_STATS_FORMATTING_FUNCTIONS (0)
@@ -84,7 +85,7 @@ FSP_HEADER
 #define configUSE_ALTERNATIVE_API (0U)
 #endif
 #ifndef configCHECK_FOR_STACK_OVERFLOW
-#define configCHECK_FOR_STACK_OVERFLOW (0)
+#define configCHECK_FOR_STACK_OVERFLOW (2)
 #endif
 #ifndef configQUEUE_REGISTRY_SIZE
 #define configQUEUE_REGISTRY_SIZE (10)
@@ -111,7 +112,7 @@ FSP_HEADER
 #define configMESSAGE_BUFFER_LENGTH_TYPE size_t
 #endif
 #ifndef configSUPPORT_STATIC_ALLOCATION
-#define configSUPPORT_STATIC_ALLOCATION (0)
+#define configSUPPORT_STATIC_ALLOCATION (1)
 #endif
 #ifndef configSUPPORT_DYNAMIC_ALLOCATION
 #define configSUPPORT_DYNAMIC_ALLOCATION (1)
@@ -123,7 +124,7 @@ FSP_HEADER
 #define configAPPLICATION_ALLOCATED_HEAP (0)
 #endif
 #ifndef configGENERATE_RUN_TIME_STATS
-#define configGENERATE_RUN_TIME_STATS (0)
+#define configGENERATE_RUN_TIME_STATS (1)
 #endif
 #ifndef configUSE_CO_ROUTINES
 #define configUSE_CO_ROUTINES (0)
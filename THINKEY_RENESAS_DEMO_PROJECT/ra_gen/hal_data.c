@@ -281,6 +281,116 @@ const timer_cfg_t g_periodic_timer_msgq_cfg =
 /* Instance structure to use this module. */
 const timer_instance_t g_periodic_timer_msgq =
 { .p_ctrl = &g_periodic_timer_msgq_ctrl, .p_cfg = &g_periodic_timer_msgq_cfg, .p_api = &g_timer_on_gpt };
+gpt_instance_ctrl_t g_run_time_counter_ctrl;
+#if 0
+const gpt_extended_pwm_cfg_t g_run_time_counter_pwm_extend =
+{
+    .trough_ipl          = (BSP_IRQ_DISABLED),
+#if defined(VECTOR_NUMBER_GPT1_COUNTER_UNDERFLOW)
+    .trough_irq          = VECTOR_NUMBER_GPT1_COUNTER_UNDERFLOW,
+#else
+    .trough_irq          = FSP_INVALID_VECTOR,
+#endif
+    .poeg_link           = GPT_POEG_LINK_POEG0,
+    .output_disable      = (gpt_output_disable_t) ( GPT_OUTPUT_DISABLE_NONE),
+    .adc_trigger         = (gpt_adc_trigger_t) ( GPT_ADC_TRIGGER_NONE),
+    .dead_time_count_up  = 0,
+    .dead_time_count_down = 0,
+    .adc_a_compare_match = 0,
+    .adc_b_compare_match = 0,
+    .interrupt_skip_source = GPT_INTERRUPT_SKIP_SOURCE_NONE,
+    .interrupt_skip_count  = GPT_INTERRUPT_SKIP_COUNT_0,
+    .interrupt_skip_adc    = GPT_INTERRUPT_SKIP_ADC_NONE,
+    .gtioca_disable_setting = GPT_GTIOC_DISABLE_PROHIBITED,
+    .gtiocb_disable_setting = GPT_GTIOC_DISABLE_PROHIBITED,
+};
+#endif
+const gpt_extended_cfg_t g_run_time_counter_extend =
+        { .gtioca =
+        { .output_enabled = false, .stop_level = GPT_PIN_LEVEL_LOW },
+          .gtiocb =
+          { .output_enabled = false, .stop_level = GPT_PIN_LEVEL_LOW },
+          .start_source = (gpt_source_t) (GPT_SOURCE_NONE), .stop_source = (gpt_source_t) (GPT_SOURCE_NONE), .clear_source =
+                  (gpt_source_t) (GPT_SOURCE_NONE),
+          .count_up_source = (gpt_source_t) (GPT_SOURCE_NONE), .count_down_source = (gpt_source_t) (GPT_SOURCE_NONE), .capture_a_source =
+                  (gpt_source_t) (GPT_SOURCE_NONE),
+          .capture_b_source = (gpt_source_t) (GPT_SOURCE_NONE), .capture_a_ipl = (BSP_IRQ_DISABLED), .capture_b_ipl =
+                  (BSP_IRQ_DISABLED),
+#if defined(VECTOR_NUMBER_GPT1_CAPTURE_COMPARE_A)
+    .capture_a_irq       = VECTOR_NUMBER_GPT1_CAPTURE_COMPARE_A,
+#else
+          .capture_a_irq = FSP_INVALID_VECTOR,
+#endif
+#if defined(VECTOR_NUMBER_GPT1_CAPTURE_COMPARE_B)
+    .capture_b_irq       = VECTOR_NUMBER_GPT1_CAPTURE_COMPARE_B,
+#else
+          .capture_b_irq = FSP_INVALID_VECTOR,
+#endif
+          .capture_filter_gtioca = GPT_CAPTURE_FILTER_NONE,
+          .capture_filter_gtiocb = GPT_CAPTURE_FILTER_NONE,
+#if 0
+    .p_pwm_cfg                   = &g_run_time_counter_pwm_extend,
+#else
+          .p_pwm_cfg = NULL,
+#endif
+#if 0
+    .gtior_setting.gtior_b.gtioa  = (0U << 4U) | (0U << 2U) | (0U << 0U),
+    .gtior_setting.gtior_b.oadflt = (uint32_t) GPT_PIN_LEVEL_LOW,
+    .gtior_setting.gtior_b.oahld  = 0U,
+    .gtior_setting.gtior_b.oae    = (uint32_t) false,
+    .gtior_setting.gtior_b.oadf   = (uint32_t) GPT_GTIOC_DISABLE_PROHIBITED,
+    .gtior_setting.gtior_b.nfaen  = ((uint32_t) GPT_CAPTURE_FILTER_NONE & 1U),
+    .gtior_setting.gtior_b.nfcsa  = ((uint32_t) GPT_CAPTURE_FILTER_NONE >> 1U),
+    .gtior_setting.gtior_b.gtiob  = (0U << 4U) | (0U << 2U) | (0U << 0U),
+    .gtior_setting.gtior_b.obdflt = (uint32_t) GPT_PIN_LEVEL_LOW,
+    .gtior_setting.gtior_b.obhld  = 0U,
+    .gtior_setting.gtior_b.obe    = (uint32_t) false,
+    .gtior_setting.gtior_b.obdf   = (uint32_t) GPT_GTIOC_DISABLE_PROHIBITED,
+    .gtior_setting.gtior_b.nfben  = ((uint32_t) GPT_CAPTURE_FILTER_NONE & 1U),
+    .gtior_setting.gtior_b.nfcsb  = ((uint32_t) GPT_CAPTURE_FILTER_NONE >> 1U),
+#else
+          .gtior_setting.gtior = 0U,
+#endif
+        };
+const timer_cfg_t g_run_time_counter_cfg =
+{ .mode = TIMER_MODE_PERIODIC,
+/* Actual period: 42.94967296 seconds. Actual duty: 50%. */.period_counts = (uint32_t) 0x100000000,
+  .duty_cycle_counts = 0x80000000, .source_div = (timer_source_div_t) 0, .channel = 1, .p_callback = NULL,
+  /** If NULL then do not add & */
+#if defined(NULL)
+    .p_context           = NULL,
+#else
+  .p_context = &NULL,
+#endif
+  .p_extend = &g_run_time_counter_extend,
+  .cycle_end_ipl = (BSP_IRQ_DISABLED),
+#if defined(VECTOR_NUMBER_GPT1_COUNTER_OVERFLOW)
+    .cycle_end_irq       = VECTOR_NUMBER_GPT1_COUNTER_OVERFLOW,
+#else
+  .cycle_end_irq = FSP_INVALID_VECTOR,
+#endif
+        };
+/* Instance structure to use this module. */
+const timer_instance_t g_run_time_counter =
+{ .p_ctrl = &g_run_time_counter_ctrl, .p_cfg = &g_run_time_counter_cfg, .p_api = &g_timer_on_gpt };
+flash_hp_instance_ctrl_t g_flash0_ctrl;
+const flash_cfg_t g_flash0_cfg =
+{ .data_flash_bgo = false, .p_callback = NULL, .p_context = NULL,
+#if defined(VECTOR_NUMBER_FCU_FRDYI)
+    .irq                 = VECTOR_NUMBER_FCU_FRDYI,
+#else
+  .irq = FSP_INVALID_VECTOR,
+#endif
+#if defined(VECTOR_NUMBER_FCU_FIFERR)
+    .err_irq             = VECTOR_NUMBER_FCU_FIFERR,
+#else
+  .err_irq = FSP_INVALID_VECTOR,
+#endif
+  .err_ipl = (BSP_IRQ_DISABLED),
+  .ipl = (BSP_IRQ_DISABLED), };
+/* Instance structure to use this module. */
+const flash_instance_t g_flash0 =
+{ .p_ctrl = &g_flash0_ctrl, .p_cfg = &g_flash0_cfg, .p_api = &g_flash_on_flash_hp };
 void g_hal_init(void)
 {
     g_common_init ();
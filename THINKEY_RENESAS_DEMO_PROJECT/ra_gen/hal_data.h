@@ -7,6 +7,8 @@
 #include "r_spi.h"
 #include "r_gpt.h"
 #include "r_timer_api.h"
+#include "r_flash_hp.h"
+#include "r_flash_api.h"
 FSP_HEADER
 /** SPI on SPI Instance. */
 extern const spi_instance_t g_spi0;
@@ -52,6 +54,26 @@ extern const timer_cfg_t g_periodic_timer_msgq_cfg;
 #ifndef periodic_timer_msgq_cb
 void periodic_timer_msgq_cb(timer_callback_args_t *p_args);
 #endif
+/** Timer on GPT Instance. */
+extern const timer_instance_t g_run_time_counter;
+
+/** Access the GPT instance using these structures when calling API functions directly (::p_api is not used). */
+extern gpt_instance_ctrl_t g_run_time_counter_ctrl;
+extern const timer_cfg_t g_run_time_counter_cfg;
+
+#ifndef NULL
+void NULL(timer_callback_args_t *p_args);
+#endif
+/* Flash on Flash HP Instance */
+extern const flash_instance_t g_flash0;
+
+/** Access the Flash HP instance using these structures when calling API functions directly (::p_api is not used). */
+extern flash_hp_instance_ctrl_t g_flash0_ctrl;
+extern const flash_cfg_t g_flash0_cfg;
+
+#ifndef NULL
+void NULL(flash_callback_args_t *p_args);
+#endif
 void hal_entry(void);
 void g_hal_init(void);
 FSP_FOOTER
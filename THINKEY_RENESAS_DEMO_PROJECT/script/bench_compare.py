@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+#
+# bench_compare.py
+#
+# Compares two THINKey benchmark reports (TKBENCH CSV lines, as printed by
+# thinkey_bench.c over RTT/UART or by the host benchmark programs) and
+# fails when a case got slower than the allowed threshold.
+#
+#   bench_compare.py baseline.log current.log [--threshold 10]
+#
+# Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+# All Rights Reserved.
+#
+
+import argparse
+import csv
+import sys
+
+TAG = "TKBENCH"
+
+
+def load(path):
+    rows = {}
+    header = None
+    with open(path, newline="") as f:
+        for line in f:
+            start = line.find(TAG + ",")
+            if start < 0:
+                continue
+            fields = next(csv.reader([line[start:].strip()]))
+            if fields[1] == "suite":
+                header = fields
+                continue
+            if header is None:
+                continue
+            row = dict(zip(header, fields))
+            rows[(row["suite"], row["name"])] = row
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed slowdown in percent (default 10)")
+    parser.add_argument("--metric", choices=("min", "avg"), default="min",
+                        help="column to compare; min is the least noisy "
+                             "(default min)")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cur = load(args.current)
+    failed = False
+
+    print("%-10s %-24s %12s %12s %8s" % ("suite", "name", "baseline",
+                                         "current", "delta"))
+    for key in sorted(cur):
+        row = cur[key]
+        if row["status"] != "0":
+            print("%-10s %-24s %12s %12s %8s" % (key[0], key[1], "-", "-",
+                                                 "ERROR"))
+            failed = True
+            continue
+        if key not in base:
+            print("%-10s %-24s %12s %12s %8s" % (key[0], key[1], "-",
+                                                 row[args.metric], "new"))
+            continue
+        ref = base[key]
+        if ref["unit"] != row["unit"]:
+            print("%-10s %-24s unit mismatch (%s vs %s)" %
+                  (key[0], key[1], ref["unit"], row["unit"]))
+            continue
+        old_val = float(ref[args.metric])
+        new_val = float(row[args.metric])
+        delta = 0.0 if old_val == 0 else (new_val - old_val) * 100.0 / old_val
+        mark = ""
+        if delta > args.threshold:
+            mark = "  REGRESSION"
+            failed = True
+        print("%-10s %-24s %12s %12s %+7.1f%%%s" % (key[0], key[1],
+              ref[args.metric], row[args.metric], delta, mark))
+    for key in sorted(set(base) - set(cur)):
+        print("%-10s %-24s missing from current report" % key)
+        failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
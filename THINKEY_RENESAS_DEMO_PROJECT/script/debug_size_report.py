@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+#
+# debug_size_report.py
+#
+# Reports the code, read only data and deferred log format strings of each
+# object file, from the GNU ld map file of a firmware build, to see what the
+# debug prints cost. The formats of TKEY_DLOG() and of the THINKEY_DEBUG_*
+# prints are in the tkey_dlog_fmt section, so that column only counts
+# prints the compile time levels of thinkey_debug.h kept. Give the map of
+# a build at another level with --compare to see the difference.
+#
+#   debug_size_report.py Release/THINKEY_RENESAS_DEMO_PROJECT.map
+#       [--compare Debug/THINKEY_RENESAS_DEMO_PROJECT.map]
+#       [--max-formats 4096] [--all]
+#
+# Fails when the formats take more than --max-formats bytes.
+#
+# Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+# All Rights Reserved.
+#
+
+import argparse
+import os
+import re
+import sys
+
+FMT_SECTION = "tkey_dlog_fmt"
+KINDS = ("text", "rodata", "formats")
+
+SECTION_RE = re.compile(r"^ ([.\w]\S*)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+ADDR_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+
+def input_sections(path):
+    """Yields (section, size, object) for the sections placed by the link."""
+    with open(path) as f:
+        lines = f.read().splitlines()
+    try:
+        start = lines.index("Linker script and memory map")
+    except ValueError:
+        sys.exit("%s: not a GNU ld map file" % path)
+
+    pending = None
+    for line in lines[start:]:
+        if pending is not None:
+            m = ADDR_RE.match(line)
+            if m:
+                yield pending, int(m.group(2), 16), m.group(3)
+            pending = None
+            continue
+        m = SECTION_RE.match(line)
+        if not m:
+            continue
+        if m.group(2) is None:
+            pending = m.group(1)      # long name, address on the next line
+        else:
+            yield m.group(1), int(m.group(3), 16), m.group(4)
+
+
+def classify(section):
+    if section == FMT_SECTION:
+        return "formats"
+    if section.startswith(".text"):
+        return "text"
+    if section.startswith(".rodata"):
+        return "rodata"
+    return None
+
+
+def object_name(obj):
+    """The member of an archive, or the file name of an object."""
+    m = re.search(r"\(([^)]+)\)$", obj)
+    return m.group(1) if m else os.path.basename(obj)
+
+
+def sizes(path):
+    """Returns {object: {kind: bytes}}."""
+    result = {}
+    for section, size, obj in input_sections(path):
+        kind = classify(section)
+        if kind is None or size == 0:
+            continue
+        counts = result.setdefault(object_name(obj), dict.fromkeys(KINDS, 0))
+        counts[kind] += size
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("map")
+    parser.add_argument("--compare", metavar="MAP",
+                        help="map of another build, printed as the change "
+                             "from it")
+    parser.add_argument("--max-formats", type=lambda v: int(v, 0),
+                        metavar="BYTES",
+                        help="fail when the formats take more")
+    parser.add_argument("--all", action="store_true",
+                        help="list the objects without formats too")
+    args = parser.parse_args()
+
+    current = sizes(args.map)
+    base = sizes(args.compare) if args.compare else None
+
+    def row(name, counts, other):
+        cells = ["%-32s" % name]
+        for kind in KINDS:
+            cells.append("%9d" % counts[kind])
+            if other is not None:
+                cells.append("%+8d" % (counts[kind] - other[kind]))
+        print(" ".join(cells))
+
+    header = ["%-32s" % "object"]
+    for kind in KINDS:
+        header.append("%9s" % kind)
+        if base is not None:
+            header.append("%8s" % "change")
+    print(" ".join(header))
+
+    empty = dict.fromkeys(KINDS, 0)
+    names = set(current) | (set(base) if base else set())
+    totals = dict.fromkeys(KINDS, 0)
+    base_totals = dict.fromkeys(KINDS, 0)
+    for name in sorted(names, key=lambda n: (-current.get(n, empty)["formats"], n)):
+        counts = current.get(name, empty)
+        other = base.get(name, empty) if base is not None else None
+        for kind in KINDS:
+            totals[kind] += counts[kind]
+            if other is not None:
+                base_totals[kind] += other[kind]
+        if args.all or counts["formats"] or (other and other["formats"]):
+            row(name, counts, other)
+    row("total", totals, base_totals if base is not None else None)
+
+    if args.max_formats is not None and totals["formats"] > args.max_formats:
+        print("formats take %d bytes, over %d" % (totals["formats"],
+                                                  args.max_formats),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+#
+# dlog_decode.py
+#
+# Formats the binary records of thinkey_dlog.c from a capture of its RTT
+# channel (for instance JLinkRTTLogger with -RTTChannel 2, or the log file
+# of script/rtt_demux.py) or from the file written by the host dlog_bench
+# program, with the format strings of the ELF file that produced them. The
+# record format is described in thinkey_dlog.h. Bytes that do not start a
+# plausible record are skipped, so a capture may begin mid-record.
+#
+#   dlog_decode.py dlog.bin --elf Debug/THINKEY_RENESAS_DEMO_PROJECT.elf
+#       [--objcopy arm-none-eabi-objcopy] [--raw]
+#
+# The formats lie between the symbols __start_tkey_dlog_fmt and
+# __stop_tkey_dlog_fmt, inside .text on the target (script/fsp.ld). A %s
+# argument is looked up in the ELF sections when its address falls in one,
+# which holds for string literals in flash; otherwise it is shown as
+# <0x...>, as for host captures whose pointers do not fit a word.
+#
+# Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+# All Rights Reserved.
+#
+
+import argparse
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+
+MAGIC = 0xD1
+FLAG_BUF = 0x00100000
+ID_INFO = 0xFFFFFFFF
+HEADER_WORDS = 3
+FMT_START = "__start_tkey_dlog_fmt"
+FMT_STOP = "__stop_tkey_dlog_fmt"
+LEVELS = "?EWID"
+
+SPEC_RE = re.compile(r"%(%|[-+ #0]*\d*(?:\.\d*)?[hljztL]*[diucxXopsfeEgGaAn])")
+SECTION_RE = re.compile(r"^\s*\d+\s+(\S+)\s+([0-9a-fA-F]+)\s+([0-9a-fA-F]+)")
+
+
+def dump_section(objcopy, elf, section):
+    """Returns the contents of an ELF section."""
+    with tempfile.TemporaryDirectory() as tmp:
+        out = os.path.join(tmp, "section.bin")
+        subprocess.run([objcopy, "-O", "binary", "--only-section=" + section,
+                        elf, out], check=True)
+        with open(out, "rb") as f:
+            return f.read()
+
+
+def run(tool, *args):
+    return subprocess.run([tool] + list(args), check=True,
+                          stdout=subprocess.PIPE,
+                          universal_newlines=True).stdout.splitlines()
+
+
+class Image:
+    """Reads the loaded sections of an ELF file by address."""
+
+    def __init__(self, objcopy, elf):
+        self.objcopy = objcopy
+        self.elf = elf
+        self.sections = []
+        self.data = {}
+        lines = run(objcopy.replace("objcopy", "objdump"), "-h", elf)
+        for i, line in enumerate(lines):
+            m = SECTION_RE.match(line)
+            if m and i + 1 < len(lines) and "CONTENTS" in lines[i + 1]:
+                self.sections.append((m.group(1), int(m.group(3), 16),
+                                      int(m.group(2), 16)))
+        self.symbols = {}
+        for line in run(objcopy.replace("objcopy", "nm"), elf):
+            fields = line.split()
+            if len(fields) == 3:
+                self.symbols[fields[2]] = int(fields[0], 16)
+
+    def read(self, address, size):
+        for name, vma, length in self.sections:
+            if vma <= address < vma + length:
+                if name not in self.data:
+                    self.data[name] = dump_section(self.objcopy, self.elf, name)
+                return self.data[name][address - vma:address - vma + size]
+        return None
+
+    def string(self, address):
+        data = self.read(address, 256)
+        if data is None:
+            return None
+        end = data.find(b"\0")
+        return data[:end if end >= 0 else len(data)].decode("ascii", "replace")
+
+    def formats(self):
+        if FMT_START not in self.symbols or FMT_STOP not in self.symbols:
+            sys.exit("%s: no %s, not linked with thinkey_dlog.c" % (
+                self.elf, FMT_START))
+        start = self.symbols[FMT_START]
+        return self.read(start, self.symbols[FMT_STOP] - start) or b""
+
+
+def convert(spec, arg, image):
+    """Formats one conversion with a 32-bit argument, as tkey_dlog_convert."""
+    conversion = spec[-1]
+    spec = re.sub(r"[hljztL]", "", spec)
+    if conversion in "dic":
+        return spec % (arg - (1 << 32) if arg & 0x80000000 else arg)
+    if conversion in "uxXo":
+        return spec.replace("u", "d") % arg
+    if conversion == "s":
+        text = image.string(arg)
+        return "<0x%08x>" % arg if text is None else spec % text
+    if conversion == "p":
+        return "0x%08x" % arg
+    return spec
+
+
+def format_args(fmt, args, image):
+    args = list(args)
+
+    def replace(m):
+        if m.group(1) == "%":
+            return "%"
+        return convert("%" + m.group(1), args.pop(0) if args else 0, image)
+
+    return SPEC_RE.sub(replace, fmt)
+
+
+def records(data):
+    """Yields the words of every plausible record, and counts the skipped
+    bytes in records.skipped."""
+    records.skipped = 0
+    i = 0
+    while i + 4 * HEADER_WORDS <= len(data):
+        header = struct.unpack_from("<I", data, i)[0]
+        words = header & 0xFF
+        if (header >> 24) != MAGIC or words < HEADER_WORDS or \
+                i + 4 * words > len(data):
+            i += 1
+            records.skipped += 1
+            continue
+        yield struct.unpack_from("<%dI" % words, data, i)
+        i += 4 * words
+    records.skipped += len(data) - i
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("capture")
+    parser.add_argument("--elf", required=True,
+                        help="the ELF file the capture was logged by")
+    parser.add_argument("--objcopy", default="arm-none-eabi-objcopy",
+                        help="objcopy of the toolchain, objdump is found "
+                             "alongside; objcopy for a host capture")
+    parser.add_argument("--raw", action="store_true",
+                        help="print the timestamps in counter ticks")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        data = f.read()
+    image = Image(args.objcopy, args.elf)
+    formats = image.formats()
+
+    hz = None
+    dropped = sink_dropped = 0
+    count = 0
+    for record in records(data):
+        header, ident, ticks = record[:HEADER_WORDS]
+        if ident == ID_INFO:
+            hz, dropped, sink_dropped = (list(record[HEADER_WORDS:]) + [0] * 3)[:3]
+            if dropped or sink_dropped:
+                print("dlog: %d dropped, %d lost by the sink" % (dropped,
+                                                                sink_dropped))
+            continue
+        count += 1
+        level = (header >> 16) & 0xF
+        line = "%s " % LEVELS[level if level < len(LEVELS) else 0]
+        if args.raw or not hz:
+            line += "%d " % ticks
+        else:
+            us = ticks * 1000000 // hz
+            line += "%d.%06d " % (us // 1000000, us % 1000000)
+
+        if ident >= len(formats):
+            line += "<format 0x%x>" % ident
+        else:
+            fmt = formats[ident:formats.index(b"\0", ident)].decode(
+                "ascii", "replace")
+            if header & FLAG_BUF:
+                length = record[HEADER_WORDS]
+                kept = struct.pack("<%dI" % (len(record) - HEADER_WORDS - 1),
+                                   *record[HEADER_WORDS + 1:])[:length]
+                line += format_args(fmt, [], image)
+                line += " [%d]" % length + "".join(" %02x" % b for b in kept)
+            else:
+                line += format_args(fmt, record[HEADER_WORDS:], image)
+        print(line.rstrip("\r\n"))
+
+    print("%d records, %d dropped, %d lost by the sink, %d bytes skipped" % (
+        count, dropped, sink_dropped, records.skipped), file=sys.stderr)
+    return 0 if count else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
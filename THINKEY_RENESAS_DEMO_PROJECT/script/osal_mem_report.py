@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+#
+# osal_mem_report.py
+#
+# Reports the RAM taken by the statically allocated OSAL tasks, queues and
+# timers of each subsystem, from the GNU ld map file of a firmware build.
+# The THINKEY_OSAL_*_STORAGE macros place that storage in sections named
+# .bss.tkey_osal.<subsystem>.<name>; the FreeRTOS heap and the stacks of
+# the threads generated by the RA configurator are listed alongside.
+#
+#   osal_mem_report.py Debug/THINKEY_RENESAS_DEMO_PROJECT.map
+#       [--budget btal=12288 --budget nal=8448 ...] [--verbose]
+#
+# Fails when a subsystem is over its budget.
+#
+# Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+# All Rights Reserved.
+#
+
+import argparse
+import re
+import sys
+
+OSAL_PREFIX = ".bss.tkey_osal."
+HEAP_SECTION = ".bss.ucHeap"
+STACK_PREFIX = ".stack."
+
+SECTION_RE = re.compile(r"^ (\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+ADDR_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+
+def input_sections(path):
+    """Yields (section, size, object) for the sections placed by the link."""
+    with open(path) as f:
+        lines = f.read().splitlines()
+    try:
+        start = lines.index("Linker script and memory map")
+    except ValueError:
+        sys.exit("%s: not a GNU ld map file" % path)
+
+    pending = None
+    for line in lines[start:]:
+        if pending is not None:
+            m = ADDR_RE.match(line)
+            if m:
+                yield pending, int(m.group(2), 16), m.group(3)
+            pending = None
+            continue
+        m = SECTION_RE.match(line)
+        if not m:
+            continue
+        if m.group(2) is None:
+            pending = m.group(1)      # long name, address on the next line
+        else:
+            yield m.group(1), int(m.group(3), 16), m.group(4)
+
+
+def classify(section):
+    if section.startswith(OSAL_PREFIX):
+        subsys, _, name = section[len(OSAL_PREFIX):].partition(".")
+        return subsys, name
+    if section == HEAP_SECTION:
+        return "(heap)", "ucHeap"
+    if section.startswith(STACK_PREFIX):
+        return "(fsp threads)", section[len(STACK_PREFIX):]
+    return None, None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("map")
+    parser.add_argument("--budget", action="append", default=[],
+                        metavar="SUBSYS=BYTES",
+                        help="fail when the subsystem takes more RAM")
+    parser.add_argument("--verbose", action="store_true",
+                        help="list the objects of each subsystem")
+    args = parser.parse_args()
+
+    budgets = {}
+    for item in args.budget:
+        subsys, _, size = item.partition("=")
+        budgets[subsys] = int(size, 0)
+
+    groups = {}
+    for section, size, obj in input_sections(args.map):
+        subsys, name = classify(section)
+        if subsys is None or size == 0:
+            continue
+        groups.setdefault(subsys, []).append((name, size, obj))
+
+    failed = False
+    total = 0
+    print("%-16s %8s %10s %10s" % ("subsystem", "objects", "bytes", "budget"))
+    for subsys in sorted(groups):
+        used = sum(size for _, size, _ in groups[subsys])
+        total += used
+        budget = budgets.get(subsys)
+        flag = ""
+        if budget is not None and used > budget:
+            flag = "  OVER"
+            failed = True
+        print("%-16s %8d %10d %10s%s" % (subsys, len(groups[subsys]), used,
+                                         "-" if budget is None else budget,
+                                         flag))
+        if args.verbose:
+            for name, size, obj in sorted(groups[subsys]):
+                print("    %-28s %10d  %s" % (name, size, obj))
+    for subsys in sorted(set(budgets) - set(groups)):
+        print("%-16s %8d %10d %10d" % (subsys, 0, 0, budgets[subsys]))
+    print("%-16s %8s %10d" % ("total", "", total))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+#
+# rtt_demux.py
+#
+# Splits a capture of the mux of thinkey_rtt.c (TKey_Rtt_SetMux(), as
+# written by the host rtt_check program) into one file per channel, and
+# prints the terminal text, the ranging reports and the trace events. The
+# frame and record formats are described in thinkey_rtt.h. Bytes that do
+# not start a frame with a good checksum are skipped, so a capture may
+# begin mid-frame.
+#
+#   rtt_demux.py capture.bin [--out PREFIX] [--show terminal,report,trace]
+#   rtt_demux.py report.bin --channel report
+#
+# With --channel the capture is of that channel alone, unframed, as from
+# JLinkRTTLogger with -RTTChannel 3. The files written for the sysmon and
+# log channels are for script/sysmon_decode.py and script/dlog_decode.py.
+#
+# Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+# All Rights Reserved.
+#
+
+import argparse
+import struct
+import sys
+
+MUX_SYNC = 0xA7
+CHANNELS = ("terminal", "sysmon", "log", "report", "trace")
+REPORT_TWR = ord("T")
+TRACE_CLOCK = 0
+TRACE_EVENTS = {0: "clock", 1: "status message", 2: "twr report"}
+TRACE_USER = 0x100
+
+
+def frames(data):
+    """Yields (channel, payload) for every good frame, and counts the
+    skipped bytes in frames.skipped."""
+    frames.skipped = 0
+    i = 0
+    while i + 5 <= len(data):
+        if data[i] != MUX_SYNC or data[i + 1] >= len(CHANNELS):
+            i += 1
+            frames.skipped += 1
+            continue
+        length = data[i + 2] | (data[i + 3] << 8)
+        end = i + 5 + length
+        if end > len(data) or sum(data[i + 1:end]) & 0xFF:
+            i += 1
+            frames.skipped += 1
+            continue
+        yield data[i + 1], data[i + 4:end - 1]
+        i = end
+    frames.skipped += len(data) - i
+
+
+def show_terminal(data):
+    for line in data.decode("ascii", "replace").splitlines():
+        print("terminal %s" % line)
+
+
+def show_report(data):
+    i = 0
+    while i + 2 <= len(data):
+        kind, length = data[i], data[i + 1]
+        payload = data[i + 2:i + 2 + length]
+        if len(payload) < length:
+            break
+        i += 2 + length
+        if kind == REPORT_TWR and length >= 34:
+            (addr, rng, time_us, dist, x, y, pdoa, pdoa_p, offset, flag,
+             ax, ay, az) = struct.unpack_from("<HHIiiihhhHhhh", payload)
+            print("report twr a16=%04X R=%d T=%d D=%d Xcm=%d Ycm=%d "
+                  "P=%.2f P'=%.2f O=%d V=0x%04X X=%d Y=%d Z=%d" % (
+                      addr, rng, time_us, dist, x, y, pdoa / 100.0,
+                      pdoa_p / 100.0, offset, flag, ax, ay, az))
+        else:
+            print("report type 0x%02x [%d] %s" % (kind, length, payload.hex()))
+
+
+def show_trace(data, raw):
+    hz = None
+    for i in range(0, len(data) - 11, 12):
+        ticks, event, arg = struct.unpack_from("<III", data, i)
+        if event == TRACE_CLOCK:
+            hz = arg
+        if raw or not hz:
+            when = "%d" % ticks
+        else:
+            us = ticks * 1000000 // hz
+            when = "%d.%06d" % (us // 1000000, us % 1000000)
+        if event >= TRACE_USER:
+            name = "user %d" % (event - TRACE_USER)
+        else:
+            name = TRACE_EVENTS.get(event, "event %d" % event)
+        print("trace %s %s %d" % (when, name, arg))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("capture")
+    parser.add_argument("--out", metavar="PREFIX",
+                        help="write PREFIX.<channel>.bin for every channel "
+                             "in the capture")
+    parser.add_argument("--show", default="terminal,report,trace",
+                        help="channels to print, of terminal, report, trace")
+    parser.add_argument("--channel", choices=CHANNELS,
+                        help="the capture is of this channel alone")
+    parser.add_argument("--raw", action="store_true",
+                        help="print the trace timestamps in counter ticks")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        data = f.read()
+
+    streams = {}
+    counts = {}
+    if args.channel:
+        streams[CHANNELS.index(args.channel)] = data
+        frames.skipped = 0
+    else:
+        parts = {}
+        for channel, payload in frames(data):
+            parts.setdefault(channel, []).append(payload)
+            counts[channel] = counts.get(channel, 0) + 1
+        streams = {channel: b"".join(p) for channel, p in parts.items()}
+
+    if args.out:
+        for channel, stream in streams.items():
+            with open("%s.%s.bin" % (args.out, CHANNELS[channel]), "wb") as f:
+                f.write(stream)
+
+    show = set(args.show.split(",")) if args.show else set()
+    if "terminal" in show and 0 in streams:
+        show_terminal(streams[0])
+    if "report" in show and 3 in streams:
+        show_report(streams[3])
+    if "trace" in show and 4 in streams:
+        show_trace(streams[4], args.raw)
+
+    for channel in sorted(streams):
+        print("%-8s %6d frames %8d bytes" % (CHANNELS[channel],
+                                              counts.get(channel, 0),
+                                              len(streams[channel])),
+              file=sys.stderr)
+    print("%d bytes skipped" % frames.skipped, file=sys.stderr)
+    return 0 if streams else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+#
+# sysmon_decode.py
+#
+# Decodes the periodic task, stack and queue report of thinkey_sysmon.c
+# from a capture of its RTT channel (for instance JLinkRTTLogger with
+# -RTTChannel 1, or the sysmon file of script/rtt_demux.py) or from the file
+# written by the host sysmon_check program. The frame format is described
+# in thinkey_sysmon.h. Bytes that do not start a frame with a good checksum
+# are skipped, so a capture may begin mid-frame.
+#
+#   sysmon_decode.py sysmon.bin [--last] [--csv]
+#
+# Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+# All Rights Reserved.
+#
+
+import argparse
+import struct
+import sys
+
+FRAME_SYNC = 0xA5
+FRAME_STATS = ord("S")
+FRAME_NAMES = ord("N")
+KIND_TASK = 0
+KIND_QUEUE = 1
+
+
+def frames(data):
+    """Yields (type, payload) for every good frame, and counts the skipped
+    bytes in frames.skipped."""
+    frames.skipped = 0
+    i = 0
+    while i + 5 <= len(data):
+        if data[i] != FRAME_SYNC:
+            i += 1
+            frames.skipped += 1
+            continue
+        length = data[i + 2] | (data[i + 3] << 8)
+        end = i + 5 + length
+        if end > len(data) or sum(data[i + 1:end]) & 0xFF:
+            i += 1
+            frames.skipped += 1
+            continue
+        yield data[i + 1], data[i + 4:end - 1]
+        i = end
+    frames.skipped += len(data) - i
+
+
+def decode_names(payload, names):
+    count, pos = payload[0], 1
+    for _ in range(count):
+        kind, ident, length = payload[pos:pos + 3]
+        names[(kind, ident)] = payload[pos + 3:pos + 3 + length].decode(
+            "ascii", "replace")
+        pos += 3 + length
+
+
+def decode_stats(payload):
+    seq, window = struct.unpack_from("<HI", payload, 0)
+    pos = 6
+    tasks = []
+    for _ in range(payload[pos]):
+        tasks.append(struct.unpack_from("<BBHH", payload, pos + 1))
+        pos += 6
+    pos += 1
+    queues = []
+    for _ in range(payload[pos]):
+        queues.append(struct.unpack_from("<BHHH", payload, pos + 1))
+        pos += 7
+    return seq, window, tasks, queues
+
+
+def print_table(report, names):
+    seq, window, tasks, queues = report
+    print("seq %d, window %d us" % (seq, window))
+    print("  %-16s %4s %4s %7s %10s" % ("task", "num", "pri", "cpu%",
+                                        "stackfree"))
+    for num, prio, cpu, free in tasks:
+        print("  %-16s %4d %4d %7.2f %10d" % (
+            names.get((KIND_TASK, num), "?"), num, prio, cpu / 100.0, free))
+    print("  %-16s %6s %6s %8s" % ("queue", "depth", "peak", "dropped"))
+    for idx, depth, peak, dropped in queues:
+        print("  %-16s %6d %6d %8d" % (
+            names.get((KIND_QUEUE, idx), "?"), depth, peak, dropped))
+
+
+def print_csv(report, names):
+    seq, window, tasks, queues = report
+    for num, prio, cpu, free in tasks:
+        print("%d,%d,task,%s,%d,%.2f,%d" % (
+            seq, window, names.get((KIND_TASK, num), "?"), prio, cpu / 100.0,
+            free))
+    for idx, depth, peak, dropped in queues:
+        print("%d,%d,queue,%s,%d,%d,%d" % (
+            seq, window, names.get((KIND_QUEUE, idx), "?"), depth, peak,
+            dropped))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("capture")
+    parser.add_argument("--last", action="store_true",
+                        help="print the last report only")
+    parser.add_argument("--csv", action="store_true",
+                        help="one line per task and queue: seq, window, kind, "
+                             "name, then priority, cpu%%, stack free or "
+                             "depth, peak, dropped")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        data = f.read()
+
+    names = {}
+    reports = []
+    last_seq = None
+    lost = 0
+    for kind, payload in frames(data):
+        if kind == FRAME_NAMES:
+            decode_names(payload, names)
+        elif kind == FRAME_STATS:
+            report = decode_stats(payload)
+            if last_seq is not None:
+                lost += (report[0] - last_seq - 1) & 0xFFFF
+            last_seq = report[0]
+            reports.append((report, dict(names)))
+
+    if args.last:
+        reports = reports[-1:]
+    if args.csv:
+        print("seq,window_us,kind,name,a,b,c")
+    for report, report_names in reports:
+        if args.csv:
+            print_csv(report, report_names)
+        else:
+            print_table(report, report_names)
+
+    print("%d reports, %d lost, %d bytes skipped" % (
+        len(reports), lost, frames.skipped), file=sys.stderr)
+    return 0 if reports else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
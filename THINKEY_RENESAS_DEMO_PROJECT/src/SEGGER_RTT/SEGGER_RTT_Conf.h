@@ -75,12 +75,15 @@ Revision: $Rev: 24316 $
 //#define SEGGER_RTT_CPU_CACHE_LINE_SIZE            (32)          // Largest cache line size (in bytes) in the current system
 //#define SEGGER_RTT_UNCACHED_OFF                   (0xFB000000)  // Address alias where RTT CB and buffers can be accessed uncached
 //
-// Most common case:
-// Up-channel 0: RTT
-// Up-channel 1: SystemView
+// THINKey (thinkey_rtt.h):
+// Up-channel 0: RTT terminal
+// Up-channel 1: task and stack monitor
+// Up-channel 2: deferred log
+// Up-channel 3: ranging reports
+// Up-channel 4: trace events
 //
 #ifndef   SEGGER_RTT_MAX_NUM_UP_BUFFERS
-  #define SEGGER_RTT_MAX_NUM_UP_BUFFERS             (3)     // Max. number of up-buffers (T->H) available on this target    (Default: 3)
+  #define SEGGER_RTT_MAX_NUM_UP_BUFFERS             (5)     // Max. number of up-buffers (T->H) available on this target    (Default: 3)
 #endif
 //
 // Most common case:
@@ -0,0 +1,26 @@
+/*
+ * \file thinkey_freertos_config.h
+ *
+ * \brief FreeRTOS settings of the THINKey platform
+ *
+ * The custom FreeRTOSConfig of the RA configurator, included by the
+ * generated FreeRTOSConfig.h ahead of its defaults. The trace facility, the run time stats and
+ * the stack overflow check are set in configuration.xml; this file only
+ * holds what the configurator cannot express.
+ *
+ * Copyright (C) 2021-2022, ThinkSeed Systems Private Limited.
+ * All Rights Reserved.
+ */
+#ifndef THINKEY_FREERTOS_CONFIG_H
+#define THINKEY_FREERTOS_CONFIG_H
+
+#include <stdint.h>
+
+/* The run time counter is the g_run_time_counter GPT instance, started in
+ * thinkey_osal.c */
+void THINKey_OSAL_vRunTimeCounterInit(void);
+uint32_t THINKey_OSAL_uiRunTimeCounter(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() THINKey_OSAL_vRunTimeCounterInit()
+#define portGET_RUN_TIME_COUNTER_VALUE() THINKey_OSAL_uiRunTimeCounter()
+
+#endif /* THINKEY_FREERTOS_CONFIG_H */
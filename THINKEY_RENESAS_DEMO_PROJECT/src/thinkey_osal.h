@@ -9,11 +9,17 @@
 #define THINKEY_OSAL_H
 
 #include "thinkey_platform_types.h"
+#if !defined(THINKEY_HOST_BUILD)
 #include "FreeRTOSConfig.h"
+#endif
 
 #define THINKEY_OSAL_ZERO 0
 #define THINKEY_OSAL_FOREVER 0xFFFFFFFF
+#if defined(THINKEY_HOST_BUILD)
+#define THINKEY_OSAL_GET_MAX_TASK_PRIORITY 5    /* configMAX_PRIORITIES */
+#else
 #define THINKEY_OSAL_GET_MAX_TASK_PRIORITY configMAX_PRIORITIES
+#endif
 
 typedef THINKey_VOID (*THINKey_pfnTaskFunction)(THINKey_VOID*);
 typedef THINKey_VOID (*THINKey_pfnTimerCallback)(THINKey_HANDLE);
@@ -54,28 +60,185 @@ THINKey_VOID* pvMessage);
 THINKey_eStatusType	THINKey_OSAL_eTimedQueueReceive
 (THINKey_HANDLE hQHandle,THINKey_VOID* pvMessage, TKey_UINT32 uiTimeout);
 
+/* Queues
+ *
+ * Every queue keeps its statistics next to the kernel queue; a send that
+ * times out or finds the queue full is counted as dropped. Handles are
+ * only valid for the OSAL queue calls.
+ */
+typedef enum
+{
+    E_THINKEY_OSAL_QUEUE_BACK,
+    E_THINKEY_OSAL_QUEUE_FRONT           /* ahead of the waiting messages */
+} THINKey_OSAL_eQueuePosType;
+
+typedef struct
+{
+    THINKey_UINT32 uiSent;
+    THINKey_UINT32 uiDropped;
+    THINKey_UINT32 uiMaxDepth;           /* messages waiting, high water */
+    THINKey_UINT32 uiDepth;              /* messages waiting now */
+} THINKey_OSAL_QueueStats_t;
+
+/* Sends to the back without waiting */
 THINKey_eStatusType
 THINKey_OSAL_eQueueSend
 (THINKey_HANDLE,
 THINKey_VOID* pvMessage);
 
+/* Parameters:
+ * Queue
+ * Message, copied
+ * Time to wait for space, in ms; THINKEY_OSAL_ZERO to not wait,
+ * THINKEY_OSAL_FOREVER to wait until there is
+ * Where the message goes
+ */
+THINKey_eStatusType
+THINKey_OSAL_eQueueSendTimed
+(THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
+THINKey_UINT32 uiTimeoutMs, THINKey_OSAL_eQueuePosType ePos);
+
+/* Sends to the back from an ISR */
 THINKey_eStatusType
 THINKey_OSAL_eQueueSendToFromISR
 (THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
 THINKey_HANDLE hHigherPriorityTaskWoken);
 
+THINKey_eStatusType
+THINKey_OSAL_eQueueSendFromISR
+(THINKey_HANDLE hQHandle, THINKey_VOID* pvMessage,
+THINKey_OSAL_eQueuePosType ePos, THINKey_HANDLE hHigherPriorityTaskWoken);
+
+THINKey_VOID
+THINKey_OSAL_vQueueGetStats
+(THINKey_HANDLE hQHandle, THINKey_OSAL_QueueStats_t* psStats);
+
+/* Names the queue in the reports and in the kernel queue registry */
+THINKey_VOID
+THINKey_OSAL_vQueueSetName
+(THINKey_HANDLE hQHandle, THINKey_CONST_STRING strName);
+
+THINKey_CONST_STRING
+THINKey_OSAL_strQueueGetName
+(THINKey_HANDLE hQHandle);
+
+/* Fills phQueues with up to uiMaxQueues queues, in creation order, and
+ * returns the number of queues created */
+THINKey_UINT32
+THINKey_OSAL_uiQueueList
+(THINKey_HANDLE* phQueues, THINKey_UINT32 uiMaxQueues);
+
+/* Buffer pools
+ *
+ * Large messages are not copied into the queue storage: the sender takes
+ * a block from a pool, fills it and posts its descriptor to a queue of
+ * sizeof(THINKey_OSAL_BufDesc_t) elements; the receiver frees the block
+ * once done with it. THINKey_OSAL_eQueueSendBuf frees the block itself
+ * when the send fails, so the block belongs to the queue either way.
+ * Blocks are taken and freed in short critical sections, from tasks only.
+ */
+typedef struct
+{
+    THINKey_UINT32 uiBlocks;
+    THINKey_UINT32 uiFree;
+    THINKey_UINT32 uiMinFree;
+    THINKey_UINT32 uiAllocFails;
+} THINKey_OSAL_BufPoolStats_t;
+
+typedef struct
+{
+    THINKey_BYTE* pbStorage;
+    THINKey_UINT32 uiStorageSize;
+    THINKey_UINT32 uiBlockSize;
+    THINKey_VOID* pvFreeList;            /* linked through the free blocks */
+    THINKey_OSAL_BufPoolStats_t sStats;
+} THINKey_OSAL_BufPool_t;
+
+typedef struct
+{
+    THINKey_BYTE* pbData;
+    THINKey_UINT32 uiLength;             /* bytes used, set by the sender */
+    THINKey_OSAL_BufPool_t* psPool;
+} THINKey_OSAL_BufDesc_t;
+
+/* Parameters:
+ * Pool
+ * Block storage and its size in bytes, 8 byte aligned
+ * Block size in bytes, rounded up to 8
+ */
+THINKey_eStatusType
+THINKey_OSAL_eBufPoolInit
+(THINKey_OSAL_BufPool_t* psPool, THINKey_BYTE* pbStorage,
+THINKey_UINT32 uiStorageSize, THINKey_UINT32 uiBlockSize);
+
+/* Fills the descriptor with a free block; fails when there is none */
+THINKey_eStatusType
+THINKey_OSAL_eBufAlloc
+(THINKey_OSAL_BufPool_t* psPool, THINKey_OSAL_BufDesc_t* psDesc);
+
+THINKey_VOID
+THINKey_OSAL_vBufFree
+(THINKey_OSAL_BufDesc_t* psDesc);
+
+/* Sends the descriptor to the back, freeing the block if that fails */
+THINKey_eStatusType
+THINKey_OSAL_eQueueSendBuf
+(THINKey_HANDLE hQHandle, THINKey_OSAL_BufDesc_t* psDesc,
+THINKey_UINT32 uiTimeoutMs);
+
+THINKey_VOID
+THINKey_OSAL_vBufPoolGetStats
+(THINKey_OSAL_BufPool_t* psPool, THINKey_OSAL_BufPoolStats_t* psStats);
+
 THINKey_VOID
 THINKey_OSAL_vOSStart
 (THINKey_VOID);
 
+/* Copies uiSize bytes; the buffers must not overlap */
 THINKey_eStatusType THINKey_OSAL_eMemCpy
 (THINKey_BYTE* pbTarget, const THINKey_BYTE* pbSource,
 		THINKey_UINT32 uiSize);
 
+/* Returns THINKey_TRUE if the buffers are equal. Returns as soon as they
+ * differ, so the time taken tells where: do not use it on keys, MACs,
+ * cryptograms or anything else secret. */
 THINKey_BOOL THINKey_OSAL_eMemCmp
 (const THINKey_BYTE* pbMem1, const THINKey_BYTE* pbMem2,
 		THINKey_UINT32 uiSize);
 
+/* Returns THINKey_TRUE if the buffers are equal, in a time that only
+ * depends on uiSize. For secret data. */
+THINKey_BOOL THINKey_OSAL_bMemCmpConstTime
+(const THINKey_BYTE* pbMem1, const THINKey_BYTE* pbMem2,
+		THINKey_UINT32 uiSize);
+
+/* Timers
+ *
+ * All the OSAL timers run off one timer service: a hierarchical timing
+ * wheel, advanced from the RTOS tick by a single task, which sleeps until
+ * the next expiry. Starting and stopping a timer take constant time
+ * whatever the number of timers. The callbacks get the timer handle and
+ * run in the service task one after the other, so they must not block.
+ */
+typedef struct
+{
+    THINKey_UINT32 uiStarts;
+    THINKey_UINT32 uiStops;
+    THINKey_UINT32 uiExpiries;
+    THINKey_UINT32 uiOverruns;           /* periods skipped as the service was late */
+    THINKey_UINT32 uiMaxLateMs;          /* from the expiry to the callback */
+} THINKey_OSAL_TimerStats_t;
+
+/* Parameters:
+ * Name, kept by reference, for the statistics
+ * Callback
+ * Caller handle, kept with the timer
+ * THINKey_TRUE for a periodic timer
+ */
+THINKey_HANDLE THINKey_OSAL_hCreateTimer
+(THINKey_CONST_STRING strName, THINKey_pfnTimerCallback pfnTimerCallback,
+		THINKey_HANDLE hCallerHandle, THINKey_BOOL bPeriodic);
+
 THINKey_HANDLE THINKey_OSAL_hCreatePeriodicTimer
 (THINKey_pfnTimerCallback pfnTimerCallback,
 		THINKey_HANDLE hCallerHandle);
@@ -94,7 +257,171 @@ THINKey_eStatusType THINKey_OSAL_eStopTimer
 THINKey_eStatusType THINKey_OSAL_eDestroyTimer
 (THINKey_HANDLE hTimerHandle);
 
+THINKey_CONST_STRING THINKey_OSAL_strTimerGetName
+(THINKey_HANDLE hTimerHandle);
+
+THINKey_VOID THINKey_OSAL_vTimerGetStats
+(THINKey_HANDLE hTimerHandle, THINKey_OSAL_TimerStats_t* psStats);
+
+/* Returns the ms until the timer service has work, THINKEY_OSAL_FOREVER
+ * when no timer runs: a tickless idle may sleep that long */
+THINKey_UINT32 THINKey_OSAL_uiTimerNextExpiryMs(THINKey_VOID);
+
+/* Static allocation
+ *
+ * The Static variants create the object in storage provided by the caller
+ * instead of the FreeRTOS heap, so they cannot fail for lack of memory.
+ * The storage is normally defined with the THINKEY_OSAL_*_STORAGE macros,
+ * which place it in a .bss.tkey_osal.<subsystem>.<name> section; run
+ * script/osal_mem_report.py on the map file for the budget per subsystem.
+ * Static objects are never deleted: tasks run forever and timers are only
+ * stopped, as their storage cannot be reused while the kernel holds it.
+ */
+/* Control block sizes, in pointer sized words */
+#ifndef THINKEY_OSAL_TASK_CB_WORDS
+#define THINKEY_OSAL_TASK_CB_WORDS 32       /* >= sizeof(StaticTask_t) */
+#endif
+#ifndef THINKEY_OSAL_QUEUE_CB_WORDS
+#define THINKEY_OSAL_QUEUE_CB_WORDS 24      /* >= sizeof(StaticQueue_t) */
+#endif
+#ifndef THINKEY_OSAL_TIMER_CB_WORDS
+#define THINKEY_OSAL_TIMER_CB_WORDS 16      /* >= the OSAL timer */
+#endif
+
+typedef struct
+{
+    THINKey_VOID* apvCb[THINKEY_OSAL_TASK_CB_WORDS];
+} THINKey_OSAL_TaskCb_t;
+
+typedef struct
+{
+    THINKey_VOID* apvCb[THINKEY_OSAL_QUEUE_CB_WORDS];
+    THINKey_OSAL_QueueStats_t sStats;
+    THINKey_CONST_STRING strName;
+    THINKey_VOID* pvNext;                /* the queue created after this */
+} THINKey_OSAL_QueueCb_t;
+
+typedef struct
+{
+    THINKey_VOID* apvCb[THINKEY_OSAL_TIMER_CB_WORDS];
+} THINKey_OSAL_TimerCb_t;
+
+#define THINKEY_OSAL_SECTION(subsys, name) \
+    __attribute__((section(".bss.tkey_osal." #subsys "." #name), aligned(8)))
+
+/* Defines the control block and stack (in words) of a static task */
+#define THINKEY_OSAL_TASK_STORAGE(subsys, name, uiStackWords) \
+    static THINKey_OSAL_TaskCb_t name##_sCb THINKEY_OSAL_SECTION(subsys, name); \
+    static THINKey_UINT32 name##_auiStack[uiStackWords] THINKEY_OSAL_SECTION(subsys, name)
+
+/* Defines the control block and item storage of a static queue */
+#define THINKEY_OSAL_QUEUE_STORAGE(subsys, name, uiNumQElements, uiQElementSize) \
+    static THINKey_OSAL_QueueCb_t name##_sCb THINKEY_OSAL_SECTION(subsys, name); \
+    static THINKey_UINT64 name##_aullItems[((uiNumQElements) * (uiQElementSize) + 7) / 8] \
+        THINKEY_OSAL_SECTION(subsys, name)
+
+/* Defines the blocks of a static buffer pool */
+#define THINKEY_OSAL_BUFPOOL_STORAGE(subsys, name, uiBlocks, uiBlockSize) \
+    static THINKey_UINT64 name##_aullBlocks[(uiBlocks) * (((uiBlockSize) + 7) / 8)] \
+        THINKEY_OSAL_SECTION(subsys, name)
+
+/* Defines the control block of a static timer */
+#define THINKEY_OSAL_TIMER_STORAGE(subsys, name) \
+    static THINKey_OSAL_TimerCb_t name##_sCb THINKEY_OSAL_SECTION(subsys, name)
+
+#define THINKEY_OSAL_CREATE_STATIC_TASK(name, strTaskName, pfnTaskFunction, \
+        pvTaskParams, uiTaskPriority, puiTaskID) \
+    THINKey_OSAL_eCreateStaticTask(strTaskName, pfnTaskFunction, pvTaskParams, \
+        uiTaskPriority, sizeof(name##_auiStack) / sizeof(name##_auiStack[0]), \
+        name##_auiStack, &name##_sCb, puiTaskID)
+
+#define THINKEY_OSAL_CREATE_STATIC_QUEUE(name, uiNumQElements, uiQElementSize) \
+    THINKey_OSAL_hCreateStaticQueue(uiNumQElements, uiQElementSize, \
+        (THINKey_BYTE*)name##_aullItems, sizeof(name##_aullItems), &name##_sCb)
+
+#define THINKEY_OSAL_INIT_STATIC_BUFPOOL(psPool, name, uiBlockSize) \
+    THINKey_OSAL_eBufPoolInit(psPool, (THINKey_BYTE*)name##_aullBlocks, \
+        sizeof(name##_aullBlocks), uiBlockSize)
+
+/* Parameters as THINKey_OSAL_eCreateTask, plus:
+ * Stack, of uiTaskStackSize words
+ * Task control block
+ */
+THINKey_eStatusType
+THINKey_OSAL_eCreateStaticTask
+(THINKey_CONST_STRING strTaskName,
+THINKey_pfnTaskFunction,
+THINKey_VOID* pvTaskParams,
+THINKey_UINT32 uiTaskPriority,
+THINKey_UINT32 uiTaskStackSize,
+THINKey_UINT32* puiStack,
+THINKey_OSAL_TaskCb_t* psTaskCb,
+THINKey_UINT32* puiTaskID);
+
+/* Parameters as THINKey_OSAL_hCreateQueue, plus:
+ * Item storage and its size in bytes
+ * Queue control block
+ */
+THINKey_HANDLE
+THINKey_OSAL_hCreateStaticQueue
+(THINKey_UINT32 uiNumQElements,
+THINKey_UINT32 uiQElementSize,
+THINKey_BYTE* pbStorage,
+THINKey_UINT32 uiStorageSize,
+THINKey_OSAL_QueueCb_t* psQueueCb);
+
+/* Parameters as THINKey_OSAL_hCreateTimer, plus:
+ * Timer control block
+ */
+THINKey_HANDLE THINKey_OSAL_hCreateStaticTimer
+(THINKey_CONST_STRING strName, THINKey_pfnTimerCallback pfnTimerCallback,
+		THINKey_HANDLE hCallerHandle, THINKey_BOOL bPeriodic,
+		THINKey_OSAL_TimerCb_t* psTimerCb);
+
+THINKey_HANDLE THINKey_OSAL_hCreateStaticPeriodicTimer
+(THINKey_pfnTimerCallback pfnTimerCallback,
+		THINKey_HANDLE hCallerHandle, THINKey_OSAL_TimerCb_t* psTimerCb);
+
+THINKey_HANDLE THINKey_OSAL_hCreateStaticOneShotTimer
+(THINKey_pfnTimerCallback pfnTimerCallback,
+		THINKey_HANDLE hCallerHandle, THINKey_OSAL_TimerCb_t* psTimerCb);
+
 TKey_VOID THINKey_OSAL_Delay(TKey_UINT32 uiDelayMs);
 
+/* Task statistics
+ *
+ * The run time counter runs at THINKey_OSAL_uiRunTimeCounterHz() and
+ * wraps; a task's share of the CPU over a window is the growth of its
+ * uiRunTime over that of the counter. On the target the counter is a GPT
+ * channel, started by the kernel through portCONFIGURE_TIMER_FOR_RUN_TIME_STATS.
+ */
+typedef struct
+{
+    THINKey_CONST_STRING strName;
+    THINKey_UINT32 uiTaskNumber;         /* unique, never reused */
+    THINKey_UINT32 uiPriority;
+    THINKey_UINT32 uiRunTime;            /* run time counter ticks */
+    THINKey_UINT32 uiStackFreeMin;       /* stack words never used */
+} THINKey_OSAL_TaskStats_t;
+
+/* Fills pasStats with up to uiMaxTasks tasks and *puiRunTime, if given,
+ * with the run time counter. Returns the number of entries filled. */
+THINKey_UINT32
+THINKey_OSAL_uiTaskGetStats
+(THINKey_OSAL_TaskStats_t* pasStats, THINKey_UINT32 uiMaxTasks,
+		THINKey_UINT32* puiRunTime);
+
+THINKey_VOID THINKey_OSAL_vRunTimeCounterInit(THINKey_VOID);
+
+THINKey_UINT32 THINKey_OSAL_uiRunTimeCounter(THINKey_VOID);
+
+THINKey_UINT32 THINKey_OSAL_uiRunTimeCounterHz(THINKey_VOID);
+
+/* Critical section for short updates of data shared between tasks.
+ * Nestable; do not block inside. */
+TKey_VOID THINKey_OSAL_vEnterCritical(TKey_VOID);
+
+TKey_VOID THINKey_OSAL_vExitCritical(TKey_VOID);
+
 
 #endif /* SOURCE_OS_BSP_THINKEY_OSAL_H_ */
@@ -50,11 +50,17 @@
 //#include "cy_retarget_io.h"
 #include <stdio.h>
 
-/* (true) enables UART based debug and (false) disables it.
- * Note that enabling debug reduces performance, power efficiency and
- * increases code size.
+/* (1) sends the task prints to the deferred binary log of thinkey_dlog.h,
+ * drained by a low priority task; (0) prints them in place with printf.
+ * The host build prints in place.
  */
-#define DEBUG_ENABLE    (false)
+#ifndef DEBUG_ENABLE
+#if defined(THINKEY_HOST_BUILD)
+#define DEBUG_ENABLE    (0)
+#else
+#define DEBUG_ENABLE    (1)
+#endif
+#endif
 
 /* Debug message type */
 typedef enum
@@ -67,10 +73,14 @@ typedef enum
 
 #if (DEBUG_ENABLE)
 
-#define task_print(...)         task_debug_printf(NONE, __VA_ARGS__)
-#define task_print_info(...)    task_debug_printf(INFO, __VA_ARGS__)
-#define task_print_warning(...) task_debug_printf(WARNING, __VA_ARGS__)
-#define task_print_error(...)   task_debug_printf(ERROR, __VA_ARGS__)
+#include "thinkey_dlog.h"
+
+/* Formats must be literals and take at most TKEY_DLOG_MAX_ARGS integer,
+ * character or pointer arguments, see thinkey_dlog.h */
+#define task_print(...)         TKEY_DLOG(TKEY_DLOG_LEVEL_DEBUG, __VA_ARGS__)
+#define task_print_info(...)    TKEY_DLOG(TKEY_DLOG_LEVEL_INFO, __VA_ARGS__)
+#define task_print_warning(...) TKEY_DLOG(TKEY_DLOG_LEVEL_WARNING, __VA_ARGS__)
+#define task_print_error(...)   TKEY_DLOG(TKEY_DLOG_LEVEL_ERROR, __VA_ARGS__)
 
 /* DebugPrintf is not thread-safe, and should not be used inside task */
 #define debug_printf(...)       printf(__VA_ARGS__)
@@ -78,7 +88,6 @@ typedef enum
 /*******************************************************************************
  * Function prototype
  ******************************************************************************/
-void task_debug_printf(debug_message_type_t messageType, char* stringPtr, ...);
 void task_debug_init(void);
 
 